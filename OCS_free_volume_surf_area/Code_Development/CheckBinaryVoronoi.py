@@ -0,0 +1,73 @@
+#The purpose of this program is to check that the binary Voronoi cells
+#written by tetgen -wvU are the same as the ASCII ones written by -wv
+#usage: python CheckBinaryVoronoi.py <tetgen> <file.node>
+
+import os
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+
+HEADERSIZE = 16 #64-bit integers in the binary header
+BIN_ITEMS = 3
+BIN_LISTSIZE = 9
+
+def padded(nbytes):
+    return (nbytes + 7) // 8 * 8
+
+def run_tetgen(tetgen, node, switches):
+    #run tetgen on a copy of the .node file, return the .v.cell filename
+    dirname = tempfile.mkdtemp()
+    shutil.copy(node, dirname)
+    basename = os.path.basename(node)
+    subprocess.check_call([tetgen, switches, basename], cwd=dirname)
+    return os.path.join(dirname, basename[:-len('.node')] + '.1.v.cell')
+
+def read_ascii_cells(filename):
+    data = []
+    f = open(filename)
+    ncells = int(f.readline().split()[0])
+    for line in f:
+        line = line.strip().split()
+        if line and not line[0][0] == '#':
+            data.append([int(x) for x in line[2:]])
+    f.close()
+    if len(data) != ncells:
+        sys.exit('ASCII header says %d cells, found %d' %(ncells, len(data)))
+    return data
+
+def read_binary_cells(filename):
+    f = open(filename, 'rb')
+    raw = f.read()
+    f.close()
+    if raw[:7] != b'TetGenB':
+        sys.exit('%s is not a binary tetgen file' %filename)
+    header = struct.unpack('<%dq' %HEADERSIZE, raw[:8 * HEADERSIZE])
+    ncells = header[BIN_ITEMS]
+    listsize = header[BIN_LISTSIZE]
+    pos = 8 * HEADERSIZE
+    offsets = struct.unpack('<%di' %(ncells + 1),
+                            raw[pos:pos + 4 * (ncells + 1)])
+    pos += padded(4 * (ncells + 1))
+    faces = struct.unpack('<%di' %listsize, raw[pos:pos + 4 * listsize])
+    return [list(faces[offsets[i]:offsets[i + 1]]) for i in range(ncells)]
+
+#main program
+
+if len(sys.argv) != 3:
+    sys.exit('usage: python CheckBinaryVoronoi.py <tetgen> <file.node>')
+tetgen = os.path.abspath(sys.argv[1])
+node = sys.argv[2]
+
+ascii_cells = read_ascii_cells(run_tetgen(tetgen, node, '-Qwv'))
+binary_cells = read_binary_cells(run_tetgen(tetgen, node, '-QwvU'))
+
+if len(ascii_cells) != len(binary_cells):
+    sys.exit('Number of cells differs: %d (ASCII), %d (binary)'
+             %(len(ascii_cells), len(binary_cells)))
+for i in range(len(ascii_cells)):
+    if ascii_cells[i] != binary_cells[i]:
+        sys.exit('Cell %d differs' %i)
+
+print('Number of Voronoi cells checked: %d' %len(ascii_cells))
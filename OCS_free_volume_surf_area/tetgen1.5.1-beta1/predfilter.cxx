@@ -0,0 +1,625 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// predfilter.cxx                                                            //
+//                                                                           //
+// Floating-point filters for the geometric predicates of predicates.cxx.    //
+//                                                                           //
+// predicates.cxx must be compiled without optimization (PREDCXXFLAGS=-O0),  //
+// otherwise the compiler may break the exact arithmetic of the adaptive     //
+// routines.  The price is that the filters in front of them, which decide   //
+// almost every call, run unoptimized as well.  This file holds a copy of    //
+// these filters (the static filter of orient3d() and insphere(), and the    //
+// first error bound of orient3d(), insphere(), and orient4d()) which can be //
+// compiled with full optimization.  Only when a filter cannot certify the   //
+// sign of a determinant, the adaptive routine of predicates.cxx is called.  //
+//                                                                           //
+// The filters only rely on each floating-point operation being correctly    //
+// rounded.  It is safe to optimize this file as long as the compiler does   //
+// not reassociate operations (no -ffast-math) and does not contract a*b+c   //
+// into fused multiply-adds (use -ffp-contract=off).                         //
+//                                                                           //
+// The batched routines evaluate the filters of a group of predicates which  //
+// share the query point in one tight loop (a filter pass), and resolve the  //
+// uncertain ones afterwards.  They return exactly the same values as the    //
+// corresponding single predicates.                                          //
+//                                                                           //
+// The numbers of calls and of exact fallbacks (calls of adaptive routines)  //
+// are counted, see filterstatistics().                                      //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+
+#include "tetgen.h"            // Defines the symbol REAL (float or double).
+
+#define Absolute(a)  fabs(a)
+
+// The maximal number of predicates evaluated in one filter pass.
+#define FILTERBATCHSIZE 16
+
+#ifndef USE_CGAL_PREDICATES
+
+// The adaptive routines in predicates.cxx.
+REAL orient3dadapt(REAL *pa, REAL *pb, REAL *pc, REAL *pd, REAL permanent);
+REAL insphereadapt(REAL *pa, REAL *pb, REAL *pc, REAL *pd, REAL *pe,
+                   REAL permanent);
+REAL orient4dadapt(REAL* pa, REAL* pb, REAL* pc, REAL* pd, REAL* pe,
+                   REAL aheight, REAL bheight, REAL cheight, REAL dheight,
+                   REAL eheight, REAL permanent);
+
+// Copies of the options and constants set by exactinit().
+static int  _use_inexact_arith;
+static int  _use_static_filter;
+static REAL o3derrboundA;
+static REAL isperrboundA;
+static REAL o3dstaticfilter;
+static REAL ispstaticfilter;
+
+// The numbers of calls and of exact fallbacks of orient3d, insphere, and
+//   orient4d.  They are kept per thread if TetGen is compiled with OpenMP.
+static long filtercalls[3], filterexacts[3];
+#ifdef _OPENMP
+  #pragma omp threadprivate(filtercalls, filterexacts)
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// filterinit()    Initialize the filters.  Called by exactinit().           //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+void filterinit(int noexact, int nofilter, REAL epsilon, REAL o3dfilter,
+                REAL ispfilter)
+{
+  _use_inexact_arith = noexact;
+  _use_static_filter = !nofilter;
+  o3derrboundA = (7.0 + 56.0 * epsilon) * epsilon;
+  isperrboundA = (16.0 + 224.0 * epsilon) * epsilon;
+  o3dstaticfilter = o3dfilter;
+  ispstaticfilter = ispfilter;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// filterstatistics()    Return the numbers of calls and of exact fallbacks  //
+//                       of the filtered predicates.                         //
+//                                                                           //
+// 'calls[i]' and 'exacts[i]' (i = 0, 1, 2) are for orient3d, insphere, and  //
+// orient4d.  The counters are cumulative, take the difference of two calls  //
+// to measure a part of a run.  With OpenMP, they count the calling thread.  //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+void filterstatistics(long *calls, long *exacts)
+{
+  int i;
+
+  for (i = 0; i < 3; i++) {
+    calls[i] = filtercalls[i];
+    exacts[i] = filterexacts[i];
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// orient3dfilter()    Filtered orient3d().                                  //
+// inspherefilter()    Filtered insphere().                                  //
+// orient4dfilter()    Filtered orient4d().                                  //
+//                                                                           //
+// The '*value()' functions evaluate the determinant and return 1 if its     //
+// sign is certified by the filters.  Otherwise they return 0 and set the    //
+// permanent needed by the adaptive routine.  If 'robust' is set, the -X     //
+// switch and the static filter are ignored (see orient3drobust()).          //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+static inline int orient3dvalue(REAL *pa, REAL *pb, REAL *pc, REAL *pd,
+                                REAL *det, REAL *permanent, int robust)
+{
+  REAL adx, bdx, cdx, ady, bdy, cdy, adz, bdz, cdz;
+  REAL bdxcdy, cdxbdy, cdxady, adxcdy, adxbdy, bdxady;
+
+  adx = pa[0] - pd[0];
+  ady = pa[1] - pd[1];
+  adz = pa[2] - pd[2];
+  bdx = pb[0] - pd[0];
+  bdy = pb[1] - pd[1];
+  bdz = pb[2] - pd[2];
+  cdx = pc[0] - pd[0];
+  cdy = pc[1] - pd[1];
+  cdz = pc[2] - pd[2];
+
+  bdxcdy = bdx * cdy;
+  cdxbdy = cdx * bdy;
+
+  cdxady = cdx * ady;
+  adxcdy = adx * cdy;
+
+  adxbdy = adx * bdy;
+  bdxady = bdx * ady;
+
+  *det = adz * (bdxcdy - cdxbdy)
+       + bdz * (cdxady - adxcdy)
+       + cdz * (adxbdy - bdxady);
+
+  if (!robust) {
+    if (_use_inexact_arith) {
+      return 1;
+    }
+    if (_use_static_filter) {
+      if ((*det > o3dstaticfilter) || (*det < -o3dstaticfilter)) return 1;
+    }
+  }
+
+  *permanent = (Absolute(bdxcdy) + Absolute(cdxbdy)) * Absolute(adz)
+             + (Absolute(cdxady) + Absolute(adxcdy)) * Absolute(bdz)
+             + (Absolute(adxbdy) + Absolute(bdxady)) * Absolute(cdz);
+
+  return (Absolute(*det) > o3derrboundA * *permanent);
+}
+
+static inline int inspherevalue(REAL *pa, REAL *pb, REAL *pc, REAL *pd,
+                                REAL *pe, REAL *det, REAL *permanent)
+{
+  REAL aex, bex, cex, dex;
+  REAL aey, bey, cey, dey;
+  REAL aez, bez, cez, dez;
+  REAL aexbey, bexaey, bexcey, cexbey, cexdey, dexcey, dexaey, aexdey;
+  REAL aexcey, cexaey, bexdey, dexbey;
+  REAL alift, blift, clift, dlift;
+  REAL ab, bc, cd, da, ac, bd;
+  REAL abc, bcd, cda, dab;
+  REAL aezplus, bezplus, cezplus, dezplus;
+  REAL aexbeyplus, bexaeyplus, bexceyplus, cexbeyplus;
+  REAL cexdeyplus, dexceyplus, dexaeyplus, aexdeyplus;
+  REAL aexceyplus, cexaeyplus, bexdeyplus, dexbeyplus;
+
+  aex = pa[0] - pe[0];
+  bex = pb[0] - pe[0];
+  cex = pc[0] - pe[0];
+  dex = pd[0] - pe[0];
+  aey = pa[1] - pe[1];
+  bey = pb[1] - pe[1];
+  cey = pc[1] - pe[1];
+  dey = pd[1] - pe[1];
+  aez = pa[2] - pe[2];
+  bez = pb[2] - pe[2];
+  cez = pc[2] - pe[2];
+  dez = pd[2] - pe[2];
+
+  aexbey = aex * bey;
+  bexaey = bex * aey;
+  ab = aexbey - bexaey;
+  bexcey = bex * cey;
+  cexbey = cex * bey;
+  bc = bexcey - cexbey;
+  cexdey = cex * dey;
+  dexcey = dex * cey;
+  cd = cexdey - dexcey;
+  dexaey = dex * aey;
+  aexdey = aex * dey;
+  da = dexaey - aexdey;
+
+  aexcey = aex * cey;
+  cexaey = cex * aey;
+  ac = aexcey - cexaey;
+  bexdey = bex * dey;
+  dexbey = dex * bey;
+  bd = bexdey - dexbey;
+
+  abc = aez * bc - bez * ac + cez * ab;
+  bcd = bez * cd - cez * bd + dez * bc;
+  cda = cez * da + dez * ac + aez * cd;
+  dab = dez * ab + aez * bd + bez * da;
+
+  alift = aex * aex + aey * aey + aez * aez;
+  blift = bex * bex + bey * bey + bez * bez;
+  clift = cex * cex + cey * cey + cez * cez;
+  dlift = dex * dex + dey * dey + dez * dez;
+
+  *det = (dlift * abc - clift * dab) + (blift * cda - alift * bcd);
+
+  if (_use_inexact_arith) {
+    return 1;
+  }
+
+  if (_use_static_filter) {
+    if (Absolute(*det) > ispstaticfilter) return 1;
+  }
+
+  aezplus = Absolute(aez);
+  bezplus = Absolute(bez);
+  cezplus = Absolute(cez);
+  dezplus = Absolute(dez);
+  aexbeyplus = Absolute(aexbey);
+  bexaeyplus = Absolute(bexaey);
+  bexceyplus = Absolute(bexcey);
+  cexbeyplus = Absolute(cexbey);
+  cexdeyplus = Absolute(cexdey);
+  dexceyplus = Absolute(dexcey);
+  dexaeyplus = Absolute(dexaey);
+  aexdeyplus = Absolute(aexdey);
+  aexceyplus = Absolute(aexcey);
+  cexaeyplus = Absolute(cexaey);
+  bexdeyplus = Absolute(bexdey);
+  dexbeyplus = Absolute(dexbey);
+  *permanent = ((cexdeyplus + dexceyplus) * bezplus
+                + (dexbeyplus + bexdeyplus) * cezplus
+                + (bexceyplus + cexbeyplus) * dezplus)
+             * alift
+             + ((dexaeyplus + aexdeyplus) * cezplus
+                + (aexceyplus + cexaeyplus) * dezplus
+                + (cexdeyplus + dexceyplus) * aezplus)
+             * blift
+             + ((aexbeyplus + bexaeyplus) * dezplus
+                + (bexdeyplus + dexbeyplus) * aezplus
+                + (dexaeyplus + aexdeyplus) * bezplus)
+             * clift
+             + ((bexceyplus + cexbeyplus) * aezplus
+                + (cexaeyplus + aexceyplus) * bezplus
+                + (aexbeyplus + bexaeyplus) * cezplus)
+             * dlift;
+
+  return (Absolute(*det) > isperrboundA * *permanent);
+}
+
+static inline int orient4dvalue(REAL *pa, REAL *pb, REAL *pc, REAL *pd,
+                                REAL *pe, REAL aheight, REAL bheight,
+                                REAL cheight, REAL dheight, REAL eheight,
+                                REAL *det, REAL *permanent)
+{
+  REAL aex, bex, cex, dex;
+  REAL aey, bey, cey, dey;
+  REAL aez, bez, cez, dez;
+  REAL aexbey, bexaey, bexcey, cexbey, cexdey, dexcey, dexaey, aexdey;
+  REAL aexcey, cexaey, bexdey, dexbey;
+  REAL aeheight, beheight, ceheight, deheight;
+  REAL ab, bc, cd, da, ac, bd;
+  REAL abc, bcd, cda, dab;
+  REAL aezplus, bezplus, cezplus, dezplus;
+  REAL aexbeyplus, bexaeyplus, bexceyplus, cexbeyplus;
+  REAL cexdeyplus, dexceyplus, dexaeyplus, aexdeyplus;
+  REAL aexceyplus, cexaeyplus, bexdeyplus, dexbeyplus;
+
+  aex = pa[0] - pe[0];
+  bex = pb[0] - pe[0];
+  cex = pc[0] - pe[0];
+  dex = pd[0] - pe[0];
+  aey = pa[1] - pe[1];
+  bey = pb[1] - pe[1];
+  cey = pc[1] - pe[1];
+  dey = pd[1] - pe[1];
+  aez = pa[2] - pe[2];
+  bez = pb[2] - pe[2];
+  cez = pc[2] - pe[2];
+  dez = pd[2] - pe[2];
+  aeheight = aheight - eheight;
+  beheight = bheight - eheight;
+  ceheight = cheight - eheight;
+  deheight = dheight - eheight;
+
+  aexbey = aex * bey;
+  bexaey = bex * aey;
+  ab = aexbey - bexaey;
+  bexcey = bex * cey;
+  cexbey = cex * bey;
+  bc = bexcey - cexbey;
+  cexdey = cex * dey;
+  dexcey = dex * cey;
+  cd = cexdey - dexcey;
+  dexaey = dex * aey;
+  aexdey = aex * dey;
+  da = dexaey - aexdey;
+
+  aexcey = aex * cey;
+  cexaey = cex * aey;
+  ac = aexcey - cexaey;
+  bexdey = bex * dey;
+  dexbey = dex * bey;
+  bd = bexdey - dexbey;
+
+  abc = aez * bc - bez * ac + cez * ab;
+  bcd = bez * cd - cez * bd + dez * bc;
+  cda = cez * da + dez * ac + aez * cd;
+  dab = dez * ab + aez * bd + bez * da;
+
+  *det = (deheight * abc - ceheight * dab) + (beheight * cda - aeheight * bcd);
+
+  // orient4d() has no static filter (the heights are not bounded).
+  aezplus = Absolute(aez);
+  bezplus = Absolute(bez);
+  cezplus = Absolute(cez);
+  dezplus = Absolute(dez);
+  aexbeyplus = Absolute(aexbey);
+  bexaeyplus = Absolute(bexaey);
+  bexceyplus = Absolute(bexcey);
+  cexbeyplus = Absolute(cexbey);
+  cexdeyplus = Absolute(cexdey);
+  dexceyplus = Absolute(dexcey);
+  dexaeyplus = Absolute(dexaey);
+  aexdeyplus = Absolute(aexdey);
+  aexceyplus = Absolute(aexcey);
+  cexaeyplus = Absolute(cexaey);
+  bexdeyplus = Absolute(bexdey);
+  dexbeyplus = Absolute(dexbey);
+  *permanent = ((cexdeyplus + dexceyplus) * bezplus
+                + (dexbeyplus + bexdeyplus) * cezplus
+                + (bexceyplus + cexbeyplus) * dezplus)
+             * Absolute(aeheight)
+             + ((dexaeyplus + aexdeyplus) * cezplus
+                + (aexceyplus + cexaeyplus) * dezplus
+                + (cexdeyplus + dexceyplus) * aezplus)
+             * Absolute(beheight)
+             + ((aexbeyplus + bexaeyplus) * dezplus
+                + (bexdeyplus + dexbeyplus) * aezplus
+                + (dexaeyplus + aexdeyplus) * bezplus)
+             * Absolute(ceheight)
+             + ((bexceyplus + cexbeyplus) * aezplus
+                + (cexaeyplus + aexceyplus) * bezplus
+                + (aexbeyplus + bexaeyplus) * cezplus)
+             * Absolute(deheight);
+
+  return (Absolute(*det) > isperrboundA * *permanent);
+}
+
+REAL orient3dfilter(REAL *pa, REAL *pb, REAL *pc, REAL *pd)
+{
+  REAL det, permanent;
+
+  filtercalls[0]++;
+  if (orient3dvalue(pa, pb, pc, pd, &det, &permanent, 0)) {
+    return det;
+  }
+  filterexacts[0]++;
+  return orient3dadapt(pa, pb, pc, pd, permanent);
+}
+
+REAL inspherefilter(REAL *pa, REAL *pb, REAL *pc, REAL *pd, REAL *pe)
+{
+  REAL det, permanent;
+
+  filtercalls[1]++;
+  if (inspherevalue(pa, pb, pc, pd, pe, &det, &permanent)) {
+    return det;
+  }
+  filterexacts[1]++;
+  return insphereadapt(pa, pb, pc, pd, pe, permanent);
+}
+
+REAL orient4dfilter(REAL *pa, REAL *pb, REAL *pc, REAL *pd, REAL *pe,
+                    REAL aheight, REAL bheight, REAL cheight, REAL dheight,
+                    REAL eheight)
+{
+  REAL det, permanent;
+
+  filtercalls[2]++;
+  if (orient4dvalue(pa, pb, pc, pd, pe, aheight, bheight, cheight, dheight,
+                    eheight, &det, &permanent)) {
+    return det;
+  }
+  filterexacts[2]++;
+  return orient4dadapt(pa, pb, pc, pd, pe, aheight, bheight, cheight,
+                       dheight, eheight, permanent);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// orient3dbatch()    Batched orient3d() with a common point.                //
+//                                                                           //
+// Computes ori[i] = orient3d(pts[3i], pts[3i+1], pts[3i+2], pd) for i = 0,  //
+// ..., n - 1.                                                               //
+//                                                                           //
+// inspherebatch()    Batched insphere() with a common point.                //
+//                                                                           //
+// Computes det[i] = insphere(pts[4i], ..., pts[4i+3], pe).                  //
+//                                                                           //
+// orient4dbatch()    Batched orient4d() with a common point.                //
+//                                                                           //
+// Computes det[i] = orient4d(pts[4i], ..., pts[4i+3], pe, ...), where the   //
+// heights are taken from the fourth coordinate of the points, i.e., the     //
+// lifted heights of weighted points (see tetgenmesh::transfernodes()).      //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+void orient3dbatch(int n, REAL **pts, REAL *pd, REAL *ori)
+{
+  REAL permanent[FILTERBATCHSIZE];
+  int certain[FILTERBATCHSIZE];
+  int m, i;
+
+  for (; n > 0; n -= m, pts += 3 * m, ori += m) {
+    m = n < FILTERBATCHSIZE ? n : FILTERBATCHSIZE;
+    filtercalls[0] += m;
+    // The filter pass.
+    for (i = 0; i < m; i++) {
+      certain[i] = orient3dvalue(pts[3 * i], pts[3 * i + 1], pts[3 * i + 2],
+                                 pd, &(ori[i]), &(permanent[i]), 0);
+    }
+    // Resolve the uncertain signs.
+    for (i = 0; i < m; i++) {
+      if (!certain[i]) {
+        filterexacts[0]++;
+        ori[i] = orient3dadapt(pts[3 * i], pts[3 * i + 1], pts[3 * i + 2],
+                               pd, permanent[i]);
+      }
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// orient3drobust()    orient3d() with the dynamic filter only.              //
+// orient3drobustbatch()    orient3dbatch() with the dynamic filter only.    //
+//                                                                           //
+// The static filter is only valid inside the bounding box given to          //
+// exactinit(), and -X turns off the exact arithmetic. These ones ignore     //
+// both, so their signs are exact for any points, and they do not depend on  //
+// the options of the mesh being built (only on exactinit() having been      //
+// called once).  They are used by tetgenlocator.                            //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+REAL orient3drobust(REAL *pa, REAL *pb, REAL *pc, REAL *pd)
+{
+  REAL det, permanent;
+
+  filtercalls[0]++;
+  if (orient3dvalue(pa, pb, pc, pd, &det, &permanent, 1)) {
+    return det;
+  }
+  filterexacts[0]++;
+  return orient3dadapt(pa, pb, pc, pd, permanent);
+}
+
+void orient3drobustbatch(int n, REAL **pts, REAL *pd, REAL *ori)
+{
+  REAL permanent[FILTERBATCHSIZE];
+  int certain[FILTERBATCHSIZE];
+  int m, i;
+
+  for (; n > 0; n -= m, pts += 3 * m, ori += m) {
+    m = n < FILTERBATCHSIZE ? n : FILTERBATCHSIZE;
+    filtercalls[0] += m;
+    for (i = 0; i < m; i++) {
+      certain[i] = orient3dvalue(pts[3 * i], pts[3 * i + 1], pts[3 * i + 2],
+                                 pd, &(ori[i]), &(permanent[i]), 1);
+    }
+    for (i = 0; i < m; i++) {
+      if (!certain[i]) {
+        filterexacts[0]++;
+        ori[i] = orient3dadapt(pts[3 * i], pts[3 * i + 1], pts[3 * i + 2],
+                               pd, permanent[i]);
+      }
+    }
+  }
+}
+
+void inspherebatch(int n, REAL **pts, REAL *pe, REAL *det)
+{
+  REAL permanent[FILTERBATCHSIZE];
+  int certain[FILTERBATCHSIZE];
+  int m, i;
+
+  for (; n > 0; n -= m, pts += 4 * m, det += m) {
+    m = n < FILTERBATCHSIZE ? n : FILTERBATCHSIZE;
+    filtercalls[1] += m;
+    for (i = 0; i < m; i++) {
+      certain[i] = inspherevalue(pts[4 * i], pts[4 * i + 1], pts[4 * i + 2],
+                                 pts[4 * i + 3], pe, &(det[i]),
+                                 &(permanent[i]));
+    }
+    for (i = 0; i < m; i++) {
+      if (!certain[i]) {
+        filterexacts[1]++;
+        det[i] = insphereadapt(pts[4 * i], pts[4 * i + 1], pts[4 * i + 2],
+                               pts[4 * i + 3], pe, permanent[i]);
+      }
+    }
+  }
+}
+
+void orient4dbatch(int n, REAL **pts, REAL *pe, REAL *det)
+{
+  REAL permanent[FILTERBATCHSIZE];
+  int certain[FILTERBATCHSIZE];
+  REAL **p;
+  int m, i;
+
+  for (; n > 0; n -= m, pts += 4 * m, det += m) {
+    m = n < FILTERBATCHSIZE ? n : FILTERBATCHSIZE;
+    filtercalls[2] += m;
+    for (i = 0; i < m; i++) {
+      p = &(pts[4 * i]);
+      certain[i] = orient4dvalue(p[0], p[1], p[2], p[3], pe, p[0][3],
+                                 p[1][3], p[2][3], p[3][3], pe[3],
+                                 &(det[i]), &(permanent[i]));
+    }
+    for (i = 0; i < m; i++) {
+      if (!certain[i]) {
+        filterexacts[2]++;
+        p = &(pts[4 * i]);
+        det[i] = orient4dadapt(p[0], p[1], p[2], p[3], pe, p[0][3], p[1][3],
+                               p[2][3], p[3][3], pe[3], permanent[i]);
+      }
+    }
+  }
+}
+
+#else // #ifndef USE_CGAL_PREDICATES
+
+// The CGAL predicates have their own filters.
+
+void filterinit(int, int, REAL, REAL, REAL)
+{
+}
+
+void filterstatistics(long *calls, long *exacts)
+{
+  int i;
+
+  // The CGAL filters are not counted.
+  for (i = 0; i < 3; i++) {
+    calls[i] = exacts[i] = 0l;
+  }
+}
+
+REAL orient3dfilter(REAL *pa, REAL *pb, REAL *pc, REAL *pd)
+{
+  return orient3d(pa, pb, pc, pd);
+}
+
+REAL inspherefilter(REAL *pa, REAL *pb, REAL *pc, REAL *pd, REAL *pe)
+{
+  return insphere(pa, pb, pc, pd, pe);
+}
+
+REAL orient4dfilter(REAL *pa, REAL *pb, REAL *pc, REAL *pd, REAL *pe,
+                    REAL aheight, REAL bheight, REAL cheight, REAL dheight,
+                    REAL eheight)
+{
+  return orient4d(pa, pb, pc, pd, pe, aheight, bheight, cheight, dheight,
+                  eheight);
+}
+
+void orient3dbatch(int n, REAL **pts, REAL *pd, REAL *ori)
+{
+  int i;
+
+  for (i = 0; i < n; i++) {
+    ori[i] = orient3d(pts[3 * i], pts[3 * i + 1], pts[3 * i + 2], pd);
+  }
+}
+
+REAL orient3drobust(REAL *pa, REAL *pb, REAL *pc, REAL *pd)
+{
+  return orient3d(pa, pb, pc, pd);
+}
+
+void orient3drobustbatch(int n, REAL **pts, REAL *pd, REAL *ori)
+{
+  orient3dbatch(n, pts, pd, ori);
+}
+
+void inspherebatch(int n, REAL **pts, REAL *pe, REAL *det)
+{
+  int i;
+
+  for (i = 0; i < n; i++) {
+    det[i] = insphere(pts[4 * i], pts[4 * i + 1], pts[4 * i + 2],
+                      pts[4 * i + 3], pe);
+  }
+}
+
+void orient4dbatch(int n, REAL **pts, REAL *pe, REAL *det)
+{
+  REAL **p;
+  int i;
+
+  for (i = 0; i < n; i++) {
+    p = &(pts[4 * i]);
+    det[i] = orient4d(p[0], p[1], p[2], p[3], pe, p[0][3], p[1][3], p[2][3],
+                      p[3][3], pe[3]);
+  }
+}
+
+#endif // #ifndef USE_CGAL_PREDICATES
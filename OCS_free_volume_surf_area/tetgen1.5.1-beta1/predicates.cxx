@@ -642,6 +642,9 @@ void exactinit(int verbose, int noexact, int nofilter, REAL maxx, REAL maxy,
   o3dstaticfilter = 5.1107127829973299e-15 * maxx * maxy * maxz;
   ispstaticfilter = 1.2466136531027298e-13 * maxx * maxy * maxz * (maxz * maxz);
 
+  // Pass the options and the filters to the optimized filters.
+  filterinit(noexact, nofilter, epsilon, o3dstaticfilter, ispstaticfilter);
+
 }
 
 /*****************************************************************************/
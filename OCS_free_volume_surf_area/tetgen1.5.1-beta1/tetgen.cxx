@@ -194,6 +194,7 @@ bool tetgenio::load_node(char* filebasename)
   char innodefilename[FILENAMESIZE];
   char inputline[INPUTLINESIZE];
   char *stringptr;
+  long long header[BINHEADERSIZE];
   bool okflag;
   int markers;
   int uvflag; // for psc input.
@@ -203,13 +204,22 @@ bool tetgenio::load_node(char* filebasename)
   strcat(innodefilename, ".node");
 
   // Try to open a .node file.
-  infile = fopen(innodefilename, "r");
+  infile = fopen(innodefilename, "rb");
   if (infile == (FILE *) NULL) {
     printf("  Cannot access file %s.\n", innodefilename);
     return false;
   }
   printf("Opening %s.\n", innodefilename); 
 
+  // Is it a binary file (-U)?
+  if (read_binary_header(infile, header, BIN_NODE, innodefilename)) {
+    okflag = load_node_binary(infile, header, innodefilename);
+    fclose(infile);
+    return okflag;
+  }
+  fclose(infile);
+  infile = fopen(innodefilename, "r");
+
   // Set initial flags.
   mesh_dim = 3;
   numberofpointattributes = 0;  // no point attribute.
@@ -449,7 +459,9 @@ bool tetgenio::load_tet(char* filebasename)
   char infilename[FILENAMESIZE];
   char inputline[INPUTLINESIZE];
   char *stringptr;
+  long long header[BINHEADERSIZE];
   REAL attrib;
+  bool okflag;
   int corner;
   int index, attribindex;
   int i, j;
@@ -457,13 +469,22 @@ bool tetgenio::load_tet(char* filebasename)
   strcpy(infilename, filebasename);
   strcat(infilename, ".ele");
 
-  infile = fopen(infilename, "r");
+  infile = fopen(infilename, "rb");
   if (infile != (FILE *) NULL) {
     printf("Opening %s.\n", infilename);
   } else {
     return false;
   }
 
+  // Is it a binary file (-U)?
+  if (read_binary_header(infile, header, BIN_ELE, infilename)) {
+    okflag = load_tet_binary(infile, header, infilename);
+    fclose(infile);
+    return okflag;
+  }
+  fclose(infile);
+  infile = fopen(infilename, "r");
+
   // Read number of elements, number of corners (4 or 10), number of
   //   element attributes.
   stringptr = readnumberline(inputline, infile, infilename);
@@ -2724,257 +2745,966 @@ void tetgenio::save_faces2smesh(char* filebasename)
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// readline()   Read a nonempty line from a file.                            //
+// save_statistics()    Save the phase timings and counters of a run (-j) to //
+//                      a .json file.                                        //
 //                                                                           //
-// A line is considered "nonempty" if it contains something more than white  //
-// spaces.  If a line is considered empty, it will be dropped and the next   //
-// line will be read, this process ends until reaching the end-of-file or a  //
-// non-empty line.  Return NULL if it is the end-of-file, otherwise, return  //
-// a pointer to the first non-whitespace character of the line.              //
+// The file has three objects.  "phases" maps each phase to its wall-clock   //
+// seconds and the peak memory (bytes) at its end, "counters" holds the raw  //
+// counters, and "rates" the mean walk length of point location and the      //
+// fractions of the filtered predicates which needed exact arithmetic.       //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-char* tetgenio::readline(char *string, FILE *infile, int *linenumber)
+const char *tetgenio::statphasenames[tetgenio::NUMPHASES] = {
+  "initialization", "delaunay", "surface_mesh", "background_mesh",
+  "boundary_recovery", "coarsening", "delaunay_recovery",
+  "constrained_points", "refinement", "optimization", "output"
+};
+
+const char *tetgenio::statcounternames[tetgenio::NUMSTATCOUNTERS] = {
+  "locate_calls", "locate_walk_steps", "locate_max_walk", "orient3d_calls",
+  "orient3d_exact", "insphere_calls", "insphere_exact", "orient4d_calls",
+  "orient4d_exact", "flip14", "flip26", "flipn2n", "flip23", "flip32",
+  "flip44", "flip41", "flip31", "flip22", "nonregular_points"
+};
+
+void tetgenio::save_statistics(char* filebasename)
 {
-  char *result;
+  FILE *fout;
+  char outstatfilename[FILENAMESIZE];
+  long *c;
+  int i;
 
-  // Search for a non-empty line.
-  do {
-    result = fgets(string, INPUTLINESIZE - 1, infile);
-    if (linenumber) (*linenumber)++;
-    if (result == (char *) NULL) {
-      return (char *) NULL;
-    }
-    // Skip white spaces.
-    while ((*result == ' ') || (*result == '\t')) result++;
-    // If it's end of line, read another line and try again.
-  } while ((*result == '\0') || (*result == '\r') || (*result == '\n'));
-  return result;
+  if ((phasetimelist == (REAL *) NULL) || (statcountlist == (long *) NULL)) {
+    return;
+  }
+
+  sprintf(outstatfilename, "%s.json", filebasename);
+  printf("Saving statistics to %s\n", outstatfilename);
+  fout = fopen(outstatfilename, "w");
+  if (fout == (FILE *) NULL) {
+    printf("File I/O Error:  Cannot create file %s.\n", outstatfilename);
+    terminatetetgen(NULL, 3);
+  }
+
+  fprintf(fout, "{\n  \"phases\": {\n");
+  for (i = 0; i < NUMPHASES; i++) {
+    fprintf(fout, "    \"%s\": {\"seconds\": %.6f, \"peak_bytes\": %.0f}%s\n",
+            statphasenames[i], phasetimelist[i], phasememorylist[i],
+            i < NUMPHASES - 1 ? "," : "");
+  }
+  fprintf(fout, "  },\n  \"counters\": {\n");
+  for (i = 0; i < NUMSTATCOUNTERS; i++) {
+    fprintf(fout, "    \"%s\": %ld%s\n", statcounternames[i],
+            statcountlist[i], i < NUMSTATCOUNTERS - 1 ? "," : "");
+  }
+  c = statcountlist;
+  fprintf(fout, "  },\n  \"rates\": {\n");
+  fprintf(fout, "    \"locate_mean_walk\": %.6g,\n", c[STAT_LOCATE] > 0 ?
+          (REAL) c[STAT_WALKSTEPS] / (REAL) c[STAT_LOCATE] : 0.0);
+  fprintf(fout, "    \"orient3d_exact_rate\": %.6g,\n", c[STAT_ORIENT3D] > 0
+          ? (REAL) c[STAT_ORIENT3DEXACT] / (REAL) c[STAT_ORIENT3D] : 0.0);
+  fprintf(fout, "    \"insphere_exact_rate\": %.6g,\n", c[STAT_INSPHERE] > 0
+          ? (REAL) c[STAT_INSPHEREEXACT] / (REAL) c[STAT_INSPHERE] : 0.0);
+  fprintf(fout, "    \"orient4d_exact_rate\": %.6g\n", c[STAT_ORIENT4D] > 0
+          ? (REAL) c[STAT_ORIENT4DEXACT] / (REAL) c[STAT_ORIENT4D] : 0.0);
+  fprintf(fout, "  }\n}\n");
+
+  fclose(fout);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// findnextfield()   Find the next field of a string.                        //
+// write_binary_header()    Write the header of a binary mesh file (-U).     //
 //                                                                           //
-// Jumps past the current field by searching for whitespace or a comma, then //
-// jumps past the whitespace or the comma to find the next field.            //
+// 'header' contains BINHEADERSIZE integers indexed by 'binaryfield'.  The   //
+// four fields starting at BIN_OFFSET hold the byte sizes of the arrays (see //
+// binarybytes()) which follow the header, a size is zero if the array is    //
+// not present.  They are replaced by the byte offsets of the arrays in the  //
+// file (zero for absent arrays).  The integers are written in little-endian //
+// byte order, regardless of the byte order of this machine.                 //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-char* tetgenio::findnextfield(char *string)
+void tetgenio::write_binary_header(FILE* fout, long long* header)
 {
-  char *result;
+  unsigned char bytes[BINHEADERSIZE * 8];
+  unsigned long long value;
+  long long offset, size;
+  int i, j;
 
-  result = string;
-  // Skip the current field.  Stop upon reaching whitespace or a comma.
-  while ((*result != '\0') && (*result != ' ') &&  (*result != '\t') && 
-         (*result != ',') && (*result != ';')) {
-    result++;
+  header[BIN_VERSION] = 1;
+  header[BIN_REALSIZE] = sizeof(REAL);
+  header[BIN_CHUNKSIZE] = BINCHUNKSIZE;
+  offset = BINHEADERSIZE * 8;
+  for (i = 0; i < 4; i++) {
+    size = header[BIN_OFFSET + i];
+    header[BIN_OFFSET + i] = (size > 0) ? offset : 0;
+    offset += size;
   }
-  // Now skip the whitespace or the comma, stop at anything else that looks
-  //   like a character, or the end of a line. 
-  while ((*result == ' ') || (*result == '\t') || (*result == ',') ||
-         (*result == ';')) {
-    result++;
+
+  memset(bytes, 0, sizeof(bytes));
+  memcpy(bytes, "TetGenB", 7);
+  for (i = 1; i < BINHEADERSIZE; i++) {
+    value = (unsigned long long) header[i];
+    for (j = 0; j < 8; j++) {
+      bytes[i * 8 + j] = (unsigned char) ((value >> (8 * j)) & 255);
+    }
   }
-  return result;
+  fwrite(bytes, 1, sizeof(bytes), fout);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// readnumberline()   Read a nonempty number line from a file.               //
+// read_binary_header()    Read the header of a binary mesh file (-U).       //
 //                                                                           //
-// A line is considered "nonempty" if it contains something that looks like  //
-// a number.  Comments (prefaced by `#') are ignored.                        //
+// Return FALSE if the file does not start with the magic string "TetGenB",  //
+// i.e., it is an ASCII file. Otherwise, the header is checked against the   //
+// expected file type 'filetype' and the size of REAL, and TRUE is returned. //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-char* tetgenio::readnumberline(char *string, FILE *infile, char *infilename)
+bool tetgenio::read_binary_header(FILE* infile, long long* header, 
+                                  int filetype, char* infilename)
 {
-  char *result;
+  unsigned char bytes[BINHEADERSIZE * 8];
+  unsigned long long value;
+  int i, j;
 
-  // Search for something that looks like a number.
-  do {
-    result = fgets(string, INPUTLINESIZE, infile);
-    if (result == (char *) NULL) {
-      return result;
-    }
-    // Skip anything that doesn't look like a number, a comment, 
-    //   or the end of a line. 
-    while ((*result != '\0') && (*result != '#')
-           && (*result != '.') && (*result != '+') && (*result != '-')
-           && ((*result < '0') || (*result > '9'))) {
-      result++;
+  if (fread(bytes, 1, sizeof(bytes), infile) != sizeof(bytes)) {
+    return false;
+  }
+  if (memcmp(bytes, "TetGenB", 8) != 0) {
+    return false;
+  }
+
+  header[0] = 0;
+  for (i = 1; i < BINHEADERSIZE; i++) {
+    value = 0;
+    for (j = 7; j >= 0; j--) {
+      value = (value << 8) | bytes[i * 8 + j];
     }
-    // If it's a comment or end of line, read another line and try again.
-  } while ((*result == '#') || (*result == '\0'));
-  return result;
+    header[i] = (long long) value;
+  }
+
+  if (header[BIN_VERSION] != 1) {
+    printf("Error:  Unknown version %lld of binary file %s.\n",
+           header[BIN_VERSION], infilename);
+    terminatetetgen(NULL, 1);
+  }
+  if (header[BIN_FILETYPE] != filetype) {
+    printf("Error:  Binary file %s has a wrong file type %lld.\n", 
+           infilename, header[BIN_FILETYPE]);
+    terminatetetgen(NULL, 1);
+  }
+  if (header[BIN_REALSIZE] != (long long) sizeof(REAL)) {
+    printf("Error:  Binary file %s uses %lld-byte reals, not %d-byte.\n",
+           infilename, header[BIN_REALSIZE], (int) sizeof(REAL));
+    terminatetetgen(NULL, 1);
+  }
+  if ((header[BIN_ITEMS] < 0) || (header[BIN_ITEMS] > 2147483647ll)) {
+    printf("Error:  Invalid number of items in binary file %s.\n",
+           infilename);
+    terminatetetgen(NULL, 1);
+  }
+
+  return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// findnextnumber()   Find the next field of a number string.                //
+// write_binary_array()    Write an array to a binary mesh file (-U).        //
 //                                                                           //
-// Jumps past the current field by searching for whitespace or a comma, then //
-// jumps past the whitespace or the comma to find the next field that looks  //
-// like a number.                                                            //
+// 'data' holds 'count' items of 'size' bytes (an int or a REAL).  They are  //
+// written in chunks of BINCHUNKSIZE items in little-endian byte order.  The //
+// array is padded by zeros to a multiple of 8 bytes (see binarybytes()).    //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-char* tetgenio::findnextnumber(char *string)
+void tetgenio::write_binary_array(FILE* fout, void* data, int size, 
+                                  long long count)
 {
-  char *result;
+  unsigned char *buffer = NULL, *src;
+  char zeros[8];
+  long long written, n, bytes;
+  int one = 1, swap;
+  int i, j;
 
-  result = string;
-  // Skip the current field.  Stop upon reaching whitespace or a comma.
-  while ((*result != '\0') && (*result != '#') && (*result != ' ') && 
-         (*result != '\t') && (*result != ',')) {
-    result++;
+  // Is this machine big-endian?
+  swap = (* (char *) &one == 0);
+  if (swap) {
+    buffer = new unsigned char[BINCHUNKSIZE * size];
   }
-  // Now skip the whitespace and anything else that doesn't look like a
-  //   number, a comment, or the end of a line. 
-  while ((*result != '\0') && (*result != '#')
-         && (*result != '.') && (*result != '+') && (*result != '-')
-         && ((*result < '0') || (*result > '9'))) {
-    result++;
-  }
-  // Check for a comment (prefixed with `#').
-  if (*result == '#') {
-    *result = '\0';
-  }
-  return result;
-}
 
-////                                                                       ////
-////                                                                       ////
-//// io_cxx ///////////////////////////////////////////////////////////////////
+  src = (unsigned char *) data;
+  for (written = 0; written < count; written += n) {
+    n = count - written;
+    if (n > BINCHUNKSIZE) n = BINCHUNKSIZE;
+    if (swap) {
+      for (i = 0; i < n; i++) {
+        for (j = 0; j < size; j++) {
+          buffer[i * size + j] = src[i * size + (size - 1 - j)];
+        }
+      }
+      fwrite(buffer, size, (size_t) n, fout);
+    } else {
+      fwrite(src, size, (size_t) n, fout);
+    }
+    src += n * size;
+  }
 
+  bytes = binarybytes(size, count) - size * count;
+  if (bytes > 0) {
+    memset(zeros, 0, 8);
+    fwrite(zeros, 1, (size_t) bytes, fout);
+  }
 
-//// behavior_cxx /////////////////////////////////////////////////////////////
-////                                                                       ////
-////                                                                       ////
+  if (buffer != NULL) {
+    delete [] buffer;
+  }
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// syntax()    Print list of command line switches.                          //
+// read_binary_array()    Read an array from a binary mesh file (-U).        //
+//                                                                           //
+// It is the reverse of write_binary_array().  Return FALSE if the file ends //
+// before 'count' items are read.                                            //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-void tetgenbehavior::syntax()
+bool tetgenio::read_binary_array(FILE* infile, void* data, int size, 
+                                 long long count)
 {
-  printf("  tetgen [-pYrq_Aa_miO_S_T_XMwcdzfenvgkJBNEFICQVh] input_file\n");
-  printf("    -p  Tetrahedralizes a piecewise linear complex (PLC).\n");
-  printf("    -Y  Preserves the input surface mesh (does not modify it).\n");
-  printf("    -r  Reconstructs a previously generated mesh.\n");
-  printf("    -q  Refines mesh (to improve mesh quality).\n");
-  printf("    -R  Mesh coarsening (to reduce the mesh elements).\n");
-  printf("    -A  Assigns attributes to tetrahedra in different regions.\n");
-  printf("    -a  Applies a maximum tetrahedron volume constraint.\n");
-  printf("    -m  Applies a mesh sizing function.\n");
-  printf("    -i  Inserts a list of additional points.\n");
-  printf("    -O  Specifies the level of mesh optimization.\n");
-  printf("    -S  Specifies maximum number of added points.\n");
-  printf("    -T  Sets a tolerance for coplanar test (default 1e-8).\n");
-  printf("    -X  Suppresses use of exact arithmetic.\n");
-  printf("    -M  No merge of coplanar facets or very close vertices.\n");
-  printf("    -w  Generates weighted Delaunay (regular) triangulation.\n");
-  printf("    -c  Retains the convex hull of the PLC.\n");
-  printf("    -d  Detects self-intersections of facets of the PLC.\n");
-  printf("    -z  Numbers all output items starting from zero.\n");
-  printf("    -f  Outputs all faces to .face file.\n");
-  printf("    -e  Outputs all edges to .edge file.\n");
-  printf("    -n  Outputs tetrahedra neighbors to .neigh file.\n");
-  printf("    -v  Outputs Voronoi diagram to files.\n");
-  printf("    -g  Outputs mesh to .mesh file for viewing by Medit.\n");
-  printf("    -k  Outputs mesh to .vtk file for viewing by Paraview.\n");
-  printf("    -J  No jettison of unused vertices from output .node file.\n");
-  printf("    -B  Suppresses output of boundary information.\n");
-  printf("    -N  Suppresses output of .node file.\n");
-  printf("    -E  Suppresses output of .ele file.\n");
-  printf("    -F  Suppresses output of .face and .edge file.\n");
-  printf("    -I  Suppresses mesh iteration numbers.\n");
-  printf("    -C  Checks the consistency of the final mesh.\n");
-  printf("    -Q  Quiet:  No terminal output except errors.\n");
-  printf("    -V  Verbose:  Detailed information, more terminal output.\n");
-  printf("    -h  Help:  A brief instruction for using TetGen.\n");
-}
+  unsigned char *dst, c;
+  char padding[8];
+  long long readitems, n, bytes;
+  int one = 1, swap;
+  int i, j;
 
-///////////////////////////////////////////////////////////////////////////////
-//                                                                           //
-// usage()    Print a brief instruction for using TetGen.                    //
-//                                                                           //
-///////////////////////////////////////////////////////////////////////////////
+  swap = (* (char *) &one == 0);
 
-void tetgenbehavior::usage()
-{
-  printf("TetGen\n");
-  printf("A Quality Tetrahedral Mesh Generator and 3D Delaunay ");
-  printf("Triangulator\n");
-  printf("Version 1.5\n");
-  printf("May 31, 2014\n");
-  printf("\n");
-  printf("Copyright (C) 2002 - 2014\n");
-  printf("\n");
-  printf("What Can TetGen Do?\n");
-  printf("\n");
-  printf("  TetGen generates Delaunay tetrahedralizations, constrained\n");
-  printf("  Delaunay tetrahedralizations, and quality tetrahedral meshes.\n");
-  printf("\n");
-  printf("Command Line Syntax:\n");
-  printf("\n");
-  printf("  Below is the basic command line syntax of TetGen with a list of ");
-  printf("short\n");
-  printf("  descriptions. Underscores indicate that numbers may optionally\n");
-  printf("  follow certain switches.  Do not leave any space between a ");
-  printf("switch\n");
-  printf("  and its numeric parameter.  \'input_file\' contains input data\n");
-  printf("  depending on the switches you supplied which may be a ");
-  printf("  piecewise\n");
-  printf("  linear complex or a list of nodes.  File formats and detailed\n");
-  printf("  description of command line switches are found in user's ");
-  printf("manual.\n");
-  printf("\n");
-  syntax();
-  printf("\n");
-  printf("Examples of How to Use TetGen:\n");
-  printf("\n");
-  printf("  \'tetgen object\' reads vertices from object.node, and writes ");
-  printf("their\n  Delaunay tetrahedralization to object.1.node, ");
-  printf("object.1.ele\n  (tetrahedra), and object.1.face");
-  printf(" (convex hull faces).\n");
-  printf("\n");
-  printf("  \'tetgen -p object\' reads a PLC from object.poly or object.");
-  printf("smesh (and\n  possibly object.node) and writes its constrained ");
-  printf("Delaunay\n  tetrahedralization to object.1.node, object.1.ele, ");
-  printf("object.1.face,\n");
-  printf("  (boundary faces) and object.1.edge (boundary edges).\n");
-  printf("\n");
-  printf("  \'tetgen -pq1.414a.1 object\' reads a PLC from object.poly or\n");
-  printf("  object.smesh (and possibly object.node), generates a mesh ");
-  printf("whose\n  tetrahedra have radius-edge ratio smaller than 1.414 and ");
-  printf("have volume\n  of 0.1 or less, and writes the mesh to ");
-  printf("object.1.node, object.1.ele,\n  object.1.face, and object.1.edge\n");
-  printf("\n");
-  printf("Please send bugs/comments to Hang Si <si@wias-berlin.de>\n");
-  terminatetetgen(NULL, 0);
+  dst = (unsigned char *) data;
+  for (readitems = 0; readitems < count; readitems += n) {
+    n = count - readitems;
+    if (n > BINCHUNKSIZE) n = BINCHUNKSIZE;
+    if (fread(dst, size, (size_t) n, infile) != (size_t) n) {
+      return false;
+    }
+    if (swap) {
+      for (i = 0; i < n; i++) {
+        for (j = 0; j < size / 2; j++) {
+          c = dst[i * size + j];
+          dst[i * size + j] = dst[i * size + (size - 1 - j)];
+          dst[i * size + (size - 1 - j)] = c;
+        }
+      }
+    }
+    dst += n * size;
+  }
+
+  bytes = binarybytes(size, count) - size * count;
+  if (bytes > 0) {
+    if (fread(padding, 1, (size_t) bytes, infile) != (size_t) bytes) {
+      return false;
+    }
+  }
+
+  return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// parse_commandline()    Read the command line, identify switches, and set  //
-//                        up options and file names.                         //
+// load_node_binary()    Load a list of points from a binary .node file.     //
 //                                                                           //
-// 'argc' and 'argv' are the same parameters passed to the function main()   //
-// of a C/C++ program. They together represent the command line user invoked //
-// from an environment in which TetGen is running.                           //
+// 'header' is the header which has been read by read_binary_header().       //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-bool tetgenbehavior::parse_commandline(int argc, char **argv)
+bool tetgenio::load_node_binary(FILE* infile, long long* header, 
+                                char* infilename)
 {
-  int startindex;
-  int increment;
-  int meshnumber;
+  bool okflag = true;
+
+  mesh_dim = 3;
+  numberofpoints = (int) header[BIN_ITEMS];
+  numberofpointattributes = (int) header[BIN_ATTRIBS];
+  firstnumber = (int) header[BIN_FIRSTNUMBER];
+
+  pointlist = new REAL[numberofpoints * 3];
+  if (pointlist == (REAL *) NULL) {
+    terminatetetgen(NULL, 1);
+  }
+  okflag = read_binary_array(infile, pointlist, sizeof(REAL), 
+                             (long long) numberofpoints * 3);
+  if (okflag && (numberofpointattributes > 0)) {
+    pointattributelist = new REAL[numberofpoints * numberofpointattributes];
+    if (pointattributelist == (REAL *) NULL) {
+      terminatetetgen(NULL, 1);
+    }
+    okflag = read_binary_array(infile, pointattributelist, sizeof(REAL),
+               (long long) numberofpoints * numberofpointattributes);
+  }
+  if (okflag && header[BIN_MARKERS]) {
+    pointmarkerlist = new int[numberofpoints];
+    if (pointmarkerlist == (int *) NULL) {
+      terminatetetgen(NULL, 1);
+    }
+    okflag = read_binary_array(infile, pointmarkerlist, sizeof(int), 
+                               numberofpoints);
+  }
+
+  if (!okflag) {
+    printf("Error:  Binary file %s is truncated.\n", infilename);
+  }
+  return okflag;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// load_tet_binary()    Load a list of tetrahedra from a binary .ele file.   //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+bool tetgenio::load_tet_binary(FILE* infile, long long* header, 
+                               char* infilename)
+{
+  int corner;
+  int i;
+
+  numberoftetrahedra = (int) header[BIN_ITEMS];
+  numberofcorners = (int) header[BIN_ITEMSIZE];
+  numberoftetrahedronattributes = (int) header[BIN_ATTRIBS];
+  if (numberoftetrahedra <= 0) {
+    printf("Error:  Invalid number of tetrahedra.\n");
+    return false;
+  }
+  if (numberofcorners != 4 && numberofcorners != 10) {
+    printf("Error:  Wrong number of corners %d (should be 4 or 10).\n", 
+           numberofcorners);
+    return false;
+  }
+
+  tetrahedronlist = new int[numberoftetrahedra * numberofcorners];
+  if (tetrahedronlist == (int *) NULL) {
+    terminatetetgen(NULL, 1);
+  }
+  if (!read_binary_array(infile, tetrahedronlist, sizeof(int),
+                         (long long) numberoftetrahedra * numberofcorners)) {
+    printf("Error:  Binary file %s is truncated.\n", infilename);
+    return false;
+  }
+  for (i = 0; i < numberoftetrahedra * numberofcorners; i++) {
+    corner = tetrahedronlist[i];
+    if (corner < firstnumber || corner >= numberofpoints + firstnumber) {
+      printf("Error:  Tetrahedron %d has an invalid vertex index.\n",
+             i / numberofcorners + firstnumber);
+      terminatetetgen(NULL, 1);
+    }
+  }
+
+  if (numberoftetrahedronattributes > 0) {
+    tetrahedronattributelist = new REAL[numberoftetrahedra *
+                                        numberoftetrahedronattributes];
+    if (tetrahedronattributelist == (REAL *) NULL) {
+      terminatetetgen(NULL, 1);
+    }
+    if (!read_binary_array(infile, tetrahedronattributelist, sizeof(REAL),
+          (long long) numberoftetrahedra * numberoftetrahedronattributes)) {
+      printf("Error:  Binary file %s is truncated.\n", infilename);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// save_nodes_binary()    Save points to a binary .node file (-U).           //
+//                                                                           //
+// A binary mesh file has a header (see write_binary_header()) followed by   //
+// up to four arrays.  Each array is stored contiguously and starts at an    //
+// 8-byte aligned offset, so it can be read in chunks or mapped into memory  //
+// directly.  The arrays of each file type are:                              //
+//                                                                           //
+//   .node    [0] x, y, z (REAL), [1] attributes (REAL), [2] markers (int).  //
+//   .ele     [0] corners (int), [1] attributes (REAL).                      //
+//   .neigh   [0] four neighbors (int), [1] CSR offsets (int, n + 1), and    //
+//            [2] CSR adjacency (int, BIN_LISTSIZE).                         //
+//   .v.node  [0] x, y, z (REAL).                                            //
+//   .v.edge  [0] v1, v2 (int), [1] normals of rays (REAL, 3 per edge).      //
+//   .v.face  [0] c1, c2 (int), [1] offsets (int, n + 1), [2] edges (int).   //
+//   .v.cell  [1] offsets (int, n + 1), [2] faces (int).                     //
+//   .pcell   [0] volumes (REAL), [1] offsets (int, n + 1), [2] neighbors    //
+//            (int), [3] face areas (REAL).  See outpowercells().            //
+//                                                                           //
+// Indices in the arrays start from BIN_FIRSTNUMBER.                         //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+void tetgenio::save_nodes_binary(char* filebasename)
+{
+  FILE *fout;
+  char outnodefilename[FILENAMESIZE];
+  long long header[BINHEADERSIZE];
+  long long n = numberofpoints;
+
+  sprintf(outnodefilename, "%s.node", filebasename);
+  printf("Saving nodes to %s\n", outnodefilename);
+  fout = fopen(outnodefilename, "wb");
+  if (fout == (FILE *) NULL) {
+    printf("File I/O Error:  Cannot create file %s.\n", outnodefilename);
+    terminatetetgen(NULL, 3);
+  }
+
+  memset(header, 0, sizeof(header));
+  header[BIN_FILETYPE] = BIN_NODE;
+  header[BIN_ITEMS] = n;
+  header[BIN_ITEMSIZE] = 3;
+  header[BIN_ATTRIBS] = numberofpointattributes;
+  header[BIN_MARKERS] = (pointmarkerlist != NULL) ? 1 : 0;
+  header[BIN_FIRSTNUMBER] = firstnumber;
+  header[BIN_OFFSET] = binarybytes(sizeof(REAL), n * 3);
+  header[BIN_OFFSET + 1] = binarybytes(sizeof(REAL), 
+                                       n * numberofpointattributes);
+  header[BIN_OFFSET + 2] = header[BIN_MARKERS] ? 
+                           binarybytes(sizeof(int), n) : 0;
+  write_binary_header(fout, header);
+
+  write_binary_array(fout, pointlist, sizeof(REAL), n * 3);
+  if (numberofpointattributes > 0) {
+    write_binary_array(fout, pointattributelist, sizeof(REAL), 
+                       n * numberofpointattributes);
+  }
+  if (pointmarkerlist != NULL) {
+    write_binary_array(fout, pointmarkerlist, sizeof(int), n);
+  }
+
+  fclose(fout);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// save_elements_binary()    Save elements to a binary .ele file (-U).       //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+void tetgenio::save_elements_binary(char* filebasename)
+{
+  FILE *fout;
+  char outelefilename[FILENAMESIZE];
+  long long header[BINHEADERSIZE];
+  long long n = numberoftetrahedra;
+
+  sprintf(outelefilename, "%s.ele", filebasename);
+  printf("Saving elements to %s\n", outelefilename);
+  fout = fopen(outelefilename, "wb");
+  if (fout == (FILE *) NULL) {
+    printf("File I/O Error:  Cannot create file %s.\n", outelefilename);
+    terminatetetgen(NULL, 3);
+  }
+
+  memset(header, 0, sizeof(header));
+  header[BIN_FILETYPE] = BIN_ELE;
+  header[BIN_ITEMS] = n;
+  header[BIN_ITEMSIZE] = numberofcorners;
+  header[BIN_ATTRIBS] = numberoftetrahedronattributes;
+  header[BIN_FIRSTNUMBER] = firstnumber;
+  header[BIN_OFFSET] = binarybytes(sizeof(int), n * numberofcorners);
+  header[BIN_OFFSET + 1] = binarybytes(sizeof(REAL), 
+                                       n * numberoftetrahedronattributes);
+  write_binary_header(fout, header);
+
+  write_binary_array(fout, tetrahedronlist, sizeof(int), 
+                     n * numberofcorners);
+  if (numberoftetrahedronattributes > 0) {
+    write_binary_array(fout, tetrahedronattributelist, sizeof(REAL),
+                       n * numberoftetrahedronattributes);
+  }
+
+  fclose(fout);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// save_neighbors_binary()    Save neighbors to a binary .neigh file (-U).   //
+//                                                                           //
+// The CSR adjacency (if it exists) is saved after the list of neighbors.    //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+void tetgenio::save_neighbors_binary(char* filebasename)
+{
+  FILE *fout;
+  char outneighborfilename[FILENAMESIZE];
+  long long header[BINHEADERSIZE];
+  long long n = numberoftetrahedra;
+  int csr;
+
+  sprintf(outneighborfilename, "%s.neigh", filebasename);
+  printf("Saving neighbors to %s\n", outneighborfilename);
+  fout = fopen(outneighborfilename, "wb");
+  if (fout == (FILE *) NULL) {
+    printf("File I/O Error:  Cannot create file %s.\n", outneighborfilename);
+    terminatetetgen(NULL, 3);
+  }
+
+  csr = (neighboroffsetlist != NULL) && (neighboradjlist != NULL);
+
+  memset(header, 0, sizeof(header));
+  header[BIN_FILETYPE] = BIN_NEIGH;
+  header[BIN_ITEMS] = n;
+  header[BIN_ITEMSIZE] = 4;
+  header[BIN_FIRSTNUMBER] = firstnumber;
+  header[BIN_LISTSIZE] = csr ? neighboroffsetlist[n] : 0;
+  header[BIN_OFFSET] = binarybytes(sizeof(int), n * 4);
+  if (csr) {
+    header[BIN_OFFSET + 1] = binarybytes(sizeof(int), n + 1);
+    header[BIN_OFFSET + 2] = binarybytes(sizeof(int), header[BIN_LISTSIZE]);
+  }
+  write_binary_header(fout, header);
+
+  write_binary_array(fout, neighborlist, sizeof(int), n * 4);
+  if (csr) {
+    write_binary_array(fout, neighboroffsetlist, sizeof(int), n + 1);
+    write_binary_array(fout, neighboradjlist, sizeof(int), 
+                       header[BIN_LISTSIZE]);
+  }
+
+  fclose(fout);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// save_voronoi_binary()    Save the Voronoi diagram to binary .v.node,      //
+//                          .v.edge, .v.face, and .v.cell files (-U).        //
+//                                                                           //
+// The variable-length Voronoi faces and cells are saved as an array of      //
+// offsets and a list of indices (the CSR format).  The edges (or faces) of  //
+// the i-th face (or cell) are list[offsets[i]], ..., list[offsets[i+1]-1].  //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+void tetgenio::save_voronoi_binary(char* filebasename)
+{
+  FILE *fout;
+  char outfilename[FILENAMESIZE];
+  long long header[BINHEADERSIZE];
+  REAL *normals;
+  int *ilist, *offsets, *list;
+  long long n, listsize;
+  int i, j;
+
+  for (i = 0; i < 4; i++) {
+    if (i == 0) {
+      sprintf(outfilename, "%s.v.node", filebasename);
+      printf("Saving Voronoi vertices to %s\n", outfilename);
+    } else if (i == 1) {
+      sprintf(outfilename, "%s.v.edge", filebasename);
+      printf("Saving Voronoi edges to %s\n", outfilename);
+    } else if (i == 2) {
+      sprintf(outfilename, "%s.v.face", filebasename);
+      printf("Saving Voronoi faces to %s\n", outfilename);
+    } else {
+      sprintf(outfilename, "%s.v.cell", filebasename);
+      printf("Saving Voronoi cells to %s\n", outfilename);
+    }
+    fout = fopen(outfilename, "wb");
+    if (fout == (FILE *) NULL) {
+      printf("File I/O Error:  Cannot create file %s.\n", outfilename);
+      terminatetetgen(NULL, 3);
+    }
+    memset(header, 0, sizeof(header));
+    header[BIN_FIRSTNUMBER] = firstnumber;
+
+    if (i == 0) {
+      n = numberofvpoints;
+      header[BIN_FILETYPE] = BIN_VNODE;
+      header[BIN_ITEMS] = n;
+      header[BIN_ITEMSIZE] = 3;
+      header[BIN_OFFSET] = binarybytes(sizeof(REAL), n * 3);
+      write_binary_header(fout, header);
+      write_binary_array(fout, vpointlist, sizeof(REAL), n * 3);
+    } else if (i == 1) {
+      n = numberofvedges;
+      ilist = new int[n * 2];
+      normals = new REAL[n * 3];
+      for (j = 0; j < n; j++) {
+        ilist[j * 2] = vedgelist[j].v1;
+        ilist[j * 2 + 1] = vedgelist[j].v2;
+        normals[j * 3] = vedgelist[j].vnormal[0];
+        normals[j * 3 + 1] = vedgelist[j].vnormal[1];
+        normals[j * 3 + 2] = vedgelist[j].vnormal[2];
+      }
+      header[BIN_FILETYPE] = BIN_VEDGE;
+      header[BIN_ITEMS] = n;
+      header[BIN_ITEMSIZE] = 2;
+      header[BIN_ATTRIBS] = 3;
+      header[BIN_OFFSET] = binarybytes(sizeof(int), n * 2);
+      header[BIN_OFFSET + 1] = binarybytes(sizeof(REAL), n * 3);
+      write_binary_header(fout, header);
+      write_binary_array(fout, ilist, sizeof(int), n * 2);
+      write_binary_array(fout, normals, sizeof(REAL), n * 3);
+      delete [] normals;
+      delete [] ilist;
+    } else {
+      n = (i == 2) ? numberofvfacets : numberofvcells;
+      ilist = NULL;
+      offsets = new int[n + 1];
+      listsize = 0;
+      for (j = 0; j < n; j++) {
+        offsets[j] = (int) listsize;
+        listsize += (i == 2) ? vfacetlist[j].elist[0] : vcelllist[j][0];
+      }
+      offsets[n] = (int) listsize;
+      list = new int[listsize > 0 ? listsize : 1];
+      for (j = 0; j < n; j++) {
+        if (i == 2) {
+          memcpy(&(list[offsets[j]]), &(vfacetlist[j].elist[1]),
+                 vfacetlist[j].elist[0] * sizeof(int));
+        } else {
+          memcpy(&(list[offsets[j]]), &(vcelllist[j][1]),
+                 vcelllist[j][0] * sizeof(int));
+        }
+      }
+      if (i == 2) {
+        ilist = new int[n * 2];
+        for (j = 0; j < n; j++) {
+          ilist[j * 2] = vfacetlist[j].c1;
+          ilist[j * 2 + 1] = vfacetlist[j].c2;
+        }
+        header[BIN_FILETYPE] = BIN_VFACE;
+        header[BIN_ITEMSIZE] = 2;
+        header[BIN_OFFSET] = binarybytes(sizeof(int), n * 2);
+      } else {
+        header[BIN_FILETYPE] = BIN_VCELL;
+      }
+      header[BIN_ITEMS] = n;
+      header[BIN_LISTSIZE] = listsize;
+      header[BIN_OFFSET + 1] = binarybytes(sizeof(int), n + 1);
+      header[BIN_OFFSET + 2] = binarybytes(sizeof(int), listsize);
+      write_binary_header(fout, header);
+      if (ilist != NULL) {
+        write_binary_array(fout, ilist, sizeof(int), n * 2);
+        delete [] ilist;
+      }
+      write_binary_array(fout, offsets, sizeof(int), n + 1);
+      write_binary_array(fout, list, sizeof(int), listsize);
+      delete [] list;
+      delete [] offsets;
+    }
+
+    fclose(fout);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// save_powercells_binary()    Save the power cells to a binary .pcell file. //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+void tetgenio::save_powercells_binary(char* filebasename)
+{
+  FILE *fout;
+  char outfilename[FILENAMESIZE];
+  long long header[BINHEADERSIZE];
+  long long n = numberofpcells;
+
+  sprintf(outfilename, "%s.pcell", filebasename);
+  printf("Saving power cells to %s\n", outfilename);
+  fout = fopen(outfilename, "wb");
+  if (fout == (FILE *) NULL) {
+    printf("File I/O Error:  Cannot create file %s.\n", outfilename);
+    terminatetetgen(NULL, 3);
+  }
+
+  memset(header, 0, sizeof(header));
+  header[BIN_FILETYPE] = BIN_PCELL;
+  header[BIN_ITEMS] = n;
+  header[BIN_ITEMSIZE] = 1;
+  header[BIN_FIRSTNUMBER] = firstnumber;
+  header[BIN_LISTSIZE] = pcelloffsetlist[n];
+  header[BIN_OFFSET] = binarybytes(sizeof(REAL), n);
+  header[BIN_OFFSET + 1] = binarybytes(sizeof(int), n + 1);
+  header[BIN_OFFSET + 2] = binarybytes(sizeof(int), header[BIN_LISTSIZE]);
+  header[BIN_OFFSET + 3] = binarybytes(sizeof(REAL), header[BIN_LISTSIZE]);
+  write_binary_header(fout, header);
+
+  write_binary_array(fout, pcellvolumelist, sizeof(REAL), n);
+  write_binary_array(fout, pcelloffsetlist, sizeof(int), n + 1);
+  write_binary_array(fout, pcellneighborlist, sizeof(int), 
+                     header[BIN_LISTSIZE]);
+  write_binary_array(fout, pcellarealist, sizeof(REAL), header[BIN_LISTSIZE]);
+
+  fclose(fout);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// readline()   Read a nonempty line from a file.                            //
+//                                                                           //
+// A line is considered "nonempty" if it contains something more than white  //
+// spaces.  If a line is considered empty, it will be dropped and the next   //
+// line will be read, this process ends until reaching the end-of-file or a  //
+// non-empty line.  Return NULL if it is the end-of-file, otherwise, return  //
+// a pointer to the first non-whitespace character of the line.              //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+char* tetgenio::readline(char *string, FILE *infile, int *linenumber)
+{
+  char *result;
+
+  // Search for a non-empty line.
+  do {
+    result = fgets(string, INPUTLINESIZE - 1, infile);
+    if (linenumber) (*linenumber)++;
+    if (result == (char *) NULL) {
+      return (char *) NULL;
+    }
+    // Skip white spaces.
+    while ((*result == ' ') || (*result == '\t')) result++;
+    // If it's end of line, read another line and try again.
+  } while ((*result == '\0') || (*result == '\r') || (*result == '\n'));
+  return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// findnextfield()   Find the next field of a string.                        //
+//                                                                           //
+// Jumps past the current field by searching for whitespace or a comma, then //
+// jumps past the whitespace or the comma to find the next field.            //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+char* tetgenio::findnextfield(char *string)
+{
+  char *result;
+
+  result = string;
+  // Skip the current field.  Stop upon reaching whitespace or a comma.
+  while ((*result != '\0') && (*result != ' ') &&  (*result != '\t') && 
+         (*result != ',') && (*result != ';')) {
+    result++;
+  }
+  // Now skip the whitespace or the comma, stop at anything else that looks
+  //   like a character, or the end of a line. 
+  while ((*result == ' ') || (*result == '\t') || (*result == ',') ||
+         (*result == ';')) {
+    result++;
+  }
+  return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// readnumberline()   Read a nonempty number line from a file.               //
+//                                                                           //
+// A line is considered "nonempty" if it contains something that looks like  //
+// a number.  Comments (prefaced by `#') are ignored.                        //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+char* tetgenio::readnumberline(char *string, FILE *infile, char *infilename)
+{
+  char *result;
+
+  // Search for something that looks like a number.
+  do {
+    result = fgets(string, INPUTLINESIZE, infile);
+    if (result == (char *) NULL) {
+      return result;
+    }
+    // Skip anything that doesn't look like a number, a comment, 
+    //   or the end of a line. 
+    while ((*result != '\0') && (*result != '#')
+           && (*result != '.') && (*result != '+') && (*result != '-')
+           && ((*result < '0') || (*result > '9'))) {
+      result++;
+    }
+    // If it's a comment or end of line, read another line and try again.
+  } while ((*result == '#') || (*result == '\0'));
+  return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// findnextnumber()   Find the next field of a number string.                //
+//                                                                           //
+// Jumps past the current field by searching for whitespace or a comma, then //
+// jumps past the whitespace or the comma to find the next field that looks  //
+// like a number.                                                            //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+char* tetgenio::findnextnumber(char *string)
+{
+  char *result;
+
+  result = string;
+  // Skip the current field.  Stop upon reaching whitespace or a comma.
+  while ((*result != '\0') && (*result != '#') && (*result != ' ') && 
+         (*result != '\t') && (*result != ',')) {
+    result++;
+  }
+  // Now skip the whitespace and anything else that doesn't look like a
+  //   number, a comment, or the end of a line. 
+  while ((*result != '\0') && (*result != '#')
+         && (*result != '.') && (*result != '+') && (*result != '-')
+         && ((*result < '0') || (*result > '9'))) {
+    result++;
+  }
+  // Check for a comment (prefixed with `#').
+  if (*result == '#') {
+    *result = '\0';
+  }
+  return result;
+}
+
+////                                                                       ////
+////                                                                       ////
+//// io_cxx ///////////////////////////////////////////////////////////////////
+
+
+//// behavior_cxx /////////////////////////////////////////////////////////////
+////                                                                       ////
+////                                                                       ////
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// syntax()    Print list of command line switches.                          //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+void tetgenbehavior::syntax()
+{
+  printf("  tetgen [-pYrq_Aa_miO_S_T_XMwcdzfenvu_UWK_gkjt_JBNEFICQVh]");
+  printf(" input_file\n");
+  printf("    -p  Tetrahedralizes a piecewise linear complex (PLC).\n");
+  printf("    -Y  Preserves the input surface mesh (does not modify it).\n");
+  printf("    -r  Reconstructs a previously generated mesh.\n");
+  printf("    -q  Refines mesh (to improve mesh quality).\n");
+  printf("    -R  Mesh coarsening (to reduce the mesh elements).\n");
+  printf("    -A  Assigns attributes to tetrahedra in different regions.\n");
+  printf("    -a  Applies a maximum tetrahedron volume constraint.\n");
+  printf("    -m  Applies a mesh sizing function.\n");
+  printf("    -i  Inserts a list of additional points.\n");
+  printf("    -O  Specifies the level of mesh optimization.\n");
+  printf("    -S  Specifies maximum number of added points.\n");
+  printf("    -T  Sets a tolerance for coplanar test (default 1e-8).\n");
+  printf("    -X  Suppresses use of exact arithmetic.\n");
+  printf("    -M  No merge of coplanar facets or very close vertices.\n");
+  printf("    -w  Generates weighted Delaunay (regular) triangulation.\n");
+  printf("    -c  Retains the convex hull of the PLC.\n");
+  printf("    -d  Detects self-intersections of facets of the PLC.\n");
+  printf("    -z  Numbers all output items starting from zero.\n");
+  printf("    -f  Outputs all faces to .face file.\n");
+  printf("    -e  Outputs all edges to .edge file.\n");
+  printf("    -n  Outputs tetrahedra neighbors to .neigh file.\n");
+  printf("    -v  Outputs Voronoi diagram to files.\n");
+  printf("    -u  Clusters free tetrahedra into voids for a probe radius.\n");
+  printf("    -U  Writes .node, .ele, .neigh, and .v.* files in binary.\n");
+  printf("    -W  Outputs power cells (volumes, face areas) to .pcell file.\n");
+  printf("    -K  Outputs alpha filtration and pore surfaces (.alf, .psf).\n");
+  printf("    -g  Outputs mesh to .mesh file for viewing by Medit.\n");
+  printf("    -k  Outputs mesh to .vtk file for viewing by Paraview.\n");
+  printf("    -j  Outputs phase timings and counters to .json file.\n");
+  printf("    -t  Meshes all given input files concurrently (batch mode).\n");
+  printf("    -J  No jettison of unused vertices from output .node file.\n");
+  printf("    -B  Suppresses output of boundary information.\n");
+  printf("    -N  Suppresses output of .node file.\n");
+  printf("    -E  Suppresses output of .ele file.\n");
+  printf("    -F  Suppresses output of .face and .edge file.\n");
+  printf("    -I  Suppresses mesh iteration numbers.\n");
+  printf("    -C  Checks the consistency of the final mesh.\n");
+  printf("    -Q  Quiet:  No terminal output except errors.\n");
+  printf("    -V  Verbose:  Detailed information, more terminal output.\n");
+  printf("    -h  Help:  A brief instruction for using TetGen.\n");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// usage()    Print a brief instruction for using TetGen.                    //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+void tetgenbehavior::usage()
+{
+  printf("TetGen\n");
+  printf("A Quality Tetrahedral Mesh Generator and 3D Delaunay ");
+  printf("Triangulator\n");
+  printf("Version 1.5\n");
+  printf("May 31, 2014\n");
+  printf("\n");
+  printf("Copyright (C) 2002 - 2014\n");
+  printf("\n");
+  printf("What Can TetGen Do?\n");
+  printf("\n");
+  printf("  TetGen generates Delaunay tetrahedralizations, constrained\n");
+  printf("  Delaunay tetrahedralizations, and quality tetrahedral meshes.\n");
+  printf("\n");
+  printf("Command Line Syntax:\n");
+  printf("\n");
+  printf("  Below is the basic command line syntax of TetGen with a list of ");
+  printf("short\n");
+  printf("  descriptions. Underscores indicate that numbers may optionally\n");
+  printf("  follow certain switches.  Do not leave any space between a ");
+  printf("switch\n");
+  printf("  and its numeric parameter.  \'input_file\' contains input data\n");
+  printf("  depending on the switches you supplied which may be a ");
+  printf("  piecewise\n");
+  printf("  linear complex or a list of nodes.  File formats and detailed\n");
+  printf("  description of command line switches are found in user's ");
+  printf("manual.\n");
+  printf("\n");
+  syntax();
+  printf("\n");
+  printf("Examples of How to Use TetGen:\n");
+  printf("\n");
+  printf("  \'tetgen object\' reads vertices from object.node, and writes ");
+  printf("their\n  Delaunay tetrahedralization to object.1.node, ");
+  printf("object.1.ele\n  (tetrahedra), and object.1.face");
+  printf(" (convex hull faces).\n");
+  printf("\n");
+  printf("  \'tetgen -p object\' reads a PLC from object.poly or object.");
+  printf("smesh (and\n  possibly object.node) and writes its constrained ");
+  printf("Delaunay\n  tetrahedralization to object.1.node, object.1.ele, ");
+  printf("object.1.face,\n");
+  printf("  (boundary faces) and object.1.edge (boundary edges).\n");
+  printf("\n");
+  printf("  \'tetgen -pq1.414a.1 object\' reads a PLC from object.poly or\n");
+  printf("  object.smesh (and possibly object.node), generates a mesh ");
+  printf("whose\n  tetrahedra have radius-edge ratio smaller than 1.414 and ");
+  printf("have volume\n  of 0.1 or less, and writes the mesh to ");
+  printf("object.1.node, object.1.ele,\n  object.1.face, and object.1.edge\n");
+  printf("\n");
+  printf("  \'tetgen -Qt4 a.node b.node c.node\' tetrahedralizes the three ");
+  printf("point sets\n  on four threads, and writes a.1.*, b.1.*, and ");
+  printf("c.1.*.\n");
+  printf("\n");
+  printf("Please send bugs/comments to Hang Si <si@wias-berlin.de>\n");
+  terminatetetgen(NULL, 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// parse_commandline()    Read the command line, identify switches, and set  //
+//                        up options and file names.                         //
+//                                                                           //
+// 'argc' and 'argv' are the same parameters passed to the function main()   //
+// of a C/C++ program. They together represent the command line user invoked //
+// from an environment in which TetGen is running.                           //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+bool tetgenbehavior::parse_commandline(int argc, char **argv)
+{
+  int startindex;
+  int increment;
+  int meshnumber;
   int i, j, k;
   char workstring[1024];
 
@@ -3268,10 +3998,90 @@ bool tetgenbehavior::parse_commandline(int argc, char **argv)
         neighout++;
       } else if (argv[i][j] == 'v') {
         voroout = 1;
+      } else if (argv[i][j] == 'U') {
+        binaryout = 1;
+      } else if (argv[i][j] == 'W') {
+        powercellout = 1;
+      } else if (argv[i][j] == 'u') {
+        voidout = 1;
+        if (((argv[i][j + 1] >= '0') && (argv[i][j + 1] <= '9')) ||
+            (argv[i][j + 1] == '.')) {
+          k = 0;
+          while (((argv[i][j + 1] >= '0') && (argv[i][j + 1] <= '9')) ||
+                 (argv[i][j + 1] == '.') || (argv[i][j + 1] == 'e') ||
+                 (argv[i][j + 1] == '-') || (argv[i][j + 1] == '+')) {
+            j++;
+            workstring[k] = argv[i][j];
+            k++;
+          }
+          workstring[k] = '\0';
+          proberadius = (REAL) strtod(workstring, (char **) NULL);
+        }
+      } else if (argv[i][j] == 'K') {
+        alphaout = 1;
+        if (((argv[i][j + 1] >= '0') && (argv[i][j + 1] <= '9')) ||
+            (argv[i][j + 1] == '.')) {
+          k = 0;
+          while (((argv[i][j + 1] >= '0') && (argv[i][j + 1] <= '9')) ||
+                 (argv[i][j + 1] == '.') || (argv[i][j + 1] == 'e') ||
+                 (argv[i][j + 1] == '-') || (argv[i][j + 1] == '+')) {
+            j++;
+            workstring[k] = argv[i][j];
+            k++;
+          }
+          workstring[k] = '\0';
+          alphamin = (REAL) strtod(workstring, (char **) NULL);
+          alphamax = alphamin;
+          alphasteps = 1;
+        }
+        if ((argv[i][j + 1] == '/') || (argv[i][j + 1] == ',')) {
+          j++;
+          if (((argv[i][j + 1] >= '0') && (argv[i][j + 1] <= '9')) ||
+              (argv[i][j + 1] == '.')) {
+            k = 0;
+            while (((argv[i][j + 1] >= '0') && (argv[i][j + 1] <= '9')) ||
+                   (argv[i][j + 1] == '.') || (argv[i][j + 1] == 'e') ||
+                   (argv[i][j + 1] == '-') || (argv[i][j + 1] == '+')) {
+              j++;
+              workstring[k] = argv[i][j];
+              k++;
+            }
+            workstring[k] = '\0';
+            alphamax = (REAL) strtod(workstring, (char **) NULL);
+            alphasteps = 2;
+          }
+        }
+        if ((argv[i][j + 1] == '/') || (argv[i][j + 1] == ',')) {
+          j++;
+          if ((argv[i][j + 1] >= '0') && (argv[i][j + 1] <= '9')) {
+            k = 0;
+            while ((argv[i][j + 1] >= '0') && (argv[i][j + 1] <= '9')) {
+              j++;
+              workstring[k] = argv[i][j];
+              k++;
+            }
+            workstring[k] = '\0';
+            alphasteps = (int) strtol(workstring, (char **) NULL, 0);
+          }
+        }
       } else if (argv[i][j] == 'g') {
         meditview = 1;
       } else if (argv[i][j] == 'k') {
         vtkview = 1;  
+      } else if (argv[i][j] == 'j') {
+        statsout = 1;
+      } else if (argv[i][j] == 't') {
+        batch = 1;
+        if ((argv[i][j + 1] >= '0') && (argv[i][j + 1] <= '9')) {
+          k = 0;
+          while ((argv[i][j + 1] >= '0') && (argv[i][j + 1] <= '9')) {
+            j++;
+            workstring[k] = argv[i][j];
+            k++;
+          }
+          workstring[k] = '\0';
+          batchthreads = (int) strtol(workstring, (char **) NULL, 0);
+        }
       } else if (argv[i][j] == 'J') {
         nojettison = 1;
       } else if (argv[i][j] == 'B') {
@@ -3602,6 +4412,8 @@ int tetgenmesh::sorgpivot [6] = {3, 4, 4, 5, 5, 3};
 int tetgenmesh::sdestpivot[6] = {4, 3, 5, 4, 3, 5};
 int tetgenmesh::sapexpivot[6] = {5, 5, 3, 3, 4, 4};
 
+int tetgenmesh::tablesready = 0;
+
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
 // inittable()    Initialize the look-up tables.                             //
@@ -3613,6 +4425,11 @@ void tetgenmesh::inittables()
   int soffset, toffset;
   int i, j;
 
+  if (tablesready) {
+    // The tables are shared by all meshes. Do not write them again, other
+    //   threads may be reading them (see tetrahedralizebatch()).
+    return;
+  }
 
   // i = t1.ver; j = t2.ver;
   for (i = 0; i < 12; i++) {
@@ -3685,6 +4502,8 @@ void tetgenmesh::inittables()
       stpivottbl[i][j] = (i & 3) + (((i & 12) + toffset) % 12);
     }
   }
+
+  tablesready = 1;
 }
 
 
@@ -3918,6 +4737,8 @@ tetgenmesh::memorypool::memorypool()
 tetgenmesh::memorypool::memorypool(int bytecount, int itemcount, int wsize, 
                                    int alignment)
 {
+  firstblock = (void **) NULL;
+  alignbytes = itembytes = itemsperblock = 0;
   poolinit(bytecount, itemcount, wsize, alignment);
 }
 
@@ -3950,11 +4771,18 @@ tetgenmesh::memorypool::~memorypool()
 // `alignment' is normally used to create a few unused bits at the bottom of //
 // each item's pointer, in which information may be stored.                  //
 //                                                                           //
+// If the pool already owns blocks of the same item and block size (it was   //
+// used by a previous mesh), they are kept and reused by restart().          //
+//                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
 void tetgenmesh::memorypool::poolinit(int bytecount,int itemcount,int wordsize,
                                       int alignment)
 {
+  int oldalignbytes = alignbytes;
+  int olditembytes = itembytes;
+  int olditemsperblock = itemsperblock;
+
   // Find the proper alignment, which must be at least as large as:
   //   - The parameter `alignment'.
   //   - The primary word type, to avoid unaligned accesses.
@@ -3973,6 +4801,20 @@ void tetgenmesh::memorypool::poolinit(int bytecount,int itemcount,int wordsize,
   itembytes = itemwords * wordsize;
   itemsperblock = itemcount;
 
+  if (firstblock != (void **) NULL) {
+    if ((alignbytes == oldalignbytes) && (itembytes == olditembytes) &&
+        (itemsperblock == olditemsperblock)) {
+      restart(); // Reuse all blocks.
+      return;
+    }
+    // The block size is changed. Free the old blocks.
+    while (firstblock != (void **) NULL) {
+      nowblock = (void **) *(firstblock);
+      free(firstblock);
+      firstblock = nowblock;
+    }
+  }
+
   // Allocate a block of items.  Space for `itemsperblock' items and one
   //   pointer (to point to the next block) are allocated, as well as space
   //   to ensure alignment of the items. 
@@ -4287,11 +5129,13 @@ void tetgenmesh::tetrahedrondealloc(tetrahedron *dyingtetrahedron)
   dyingtetrahedron[4] = (tetrahedron) NULL;
 
   // Dealloc the space to subfaces/subsegments.
-  if (dyingtetrahedron[8] != NULL) {
-    tet2segpool->dealloc((shellface *) dyingtetrahedron[8]);
-  }
-  if (dyingtetrahedron[9] != NULL) {
-    tet2subpool->dealloc((shellface *) dyingtetrahedron[9]);
+  if (!compacttets) {
+    if (dyingtetrahedron[8] != NULL) {
+      tet2segpool->dealloc((shellface *) dyingtetrahedron[8]);
+    }
+    if (dyingtetrahedron[9] != NULL) {
+      tet2subpool->dealloc((shellface *) dyingtetrahedron[9]);
+    }
   }
 
   tetrahedrons->dealloc((void *) dyingtetrahedron);
@@ -4420,8 +5264,10 @@ void tetgenmesh::maketetrahedron(triface *newtet)
   newtet->tet[6] = NULL;
   newtet->tet[7] = NULL;
   // No attached segments and subfaces yet.
-  newtet->tet[8] = NULL; 
-  newtet->tet[9] = NULL; 
+  if (!compacttets) {
+    newtet->tet[8] = NULL; 
+    newtet->tet[9] = NULL; 
+  }
   // Initialize the marker (clear all flags).
   setelemmarker(newtet->tet, 0);
   for (int i = 0; i < numelemattrib; i++) {
@@ -4609,7 +5455,7 @@ void tetgenmesh::initializepools()
   //   sizeof(tetrahedron)-byte address.
   point2simindex = ((pointmtrindex + sizeoftensor) * sizeof(REAL)
                  + sizeof(tetrahedron) - 1) / sizeof(tetrahedron);
-  if (b->plc || b->refine || b->voroout) {
+  if (b->plc || b->refine) {
     // Increase the point size by three pointers, which are:
     //   - a pointer to a tet, read by point2tet();
     //   - a pointer to a parent point, read by point2ppt()).
@@ -4635,8 +5481,14 @@ void tetgenmesh::initializepools()
   //   - an integer for geometry tag (optional, -s option).
   pointsize = (pointmarkindex + 2 + (b->psc ? 1 : 0)) * sizeof(tetrahedron);
 
-  // Initialize the pool of vertices.
-  points = new memorypool(pointsize, b->vertexperblock, sizeof(REAL), 0);
+  // Initialize the pool of vertices. Reuse the pool of a recycled mesh.
+  if (sparepoints != NULL) {
+    points = sparepoints;
+    sparepoints = NULL;
+    points->poolinit(pointsize, b->vertexperblock, sizeof(REAL), 0);
+  } else {
+    points = new memorypool(pointsize, b->vertexperblock, sizeof(REAL), 0);
+  }
 
   if (b->verbose) {
     printf("  Size of a point: %d bytes.\n", points->itembytes);
@@ -4686,8 +5538,19 @@ void tetgenmesh::initializepools()
   //     [9]  |__ subfaces array __| (used by -p)
   //    [10]  |_____ reserved _____|
   //    [11]  |___ elem marker ____| (used as an integer)
-
-  elesize = 12 * sizeof(tetrahedron); 
+  // If there are no segments and subfaces (a Delaunay tetrahedralization or
+  //   a regular triangulation, no -p, -r, and -R), the tets are compact, i.e.,
+  //   the two slots [8] and [9] are omitted, the reserved slot and the elem
+  //   marker are moved to [8] and [9]. It saves 16 bytes per tet.
+
+  compacttets = !(b->plc || b->refine || b->coarsen);
+  if (compacttets) {
+    elesize = 10 * sizeof(tetrahedron);
+  } else {
+    elesize = 12 * sizeof(tetrahedron); 
+  }
+  // The index to find the element index (for output), measured in pointers.
+  elemindexindex = elesize / sizeof(tetrahedron) - 2;
 
   // The index to find the element markers. An integer containing varies
   //   flags and element counter. 
@@ -4717,8 +5580,14 @@ void tetgenmesh::initializepools()
 
 
   // Having determined the memory size of an element, initialize the pool.
-  tetrahedrons = new memorypool(elesize, b->tetrahedraperblock, sizeof(void *),
-                                16);
+  if (sparetetrahedrons != NULL) {
+    tetrahedrons = sparetetrahedrons;
+    sparetetrahedrons = NULL;
+    tetrahedrons->poolinit(elesize, b->tetrahedraperblock, sizeof(void *), 16);
+  } else {
+    tetrahedrons = new memorypool(elesize, b->tetrahedraperblock,
+                                  sizeof(void *), 16);
+  }
 
   if (b->verbose) {
     printf("  Size of a tetrahedron: %d (%d) bytes.\n", elesize,
@@ -4786,7 +5655,13 @@ void tetgenmesh::initializepools()
   }
 
   // Initialize the pools for flips.
-  flippool = new memorypool(sizeof(badface), 1024, sizeof(void *), 0);
+  if (spareflippool != NULL) {
+    flippool = spareflippool;
+    spareflippool = NULL;
+    flippool->restart();
+  } else {
+    flippool = new memorypool(sizeof(badface), 1024, sizeof(void *), 0);
+  }
   unflipqueue = new arraypool(sizeof(badface), 10);
 
   // Initialize the arraypools for point insertion.
@@ -4827,7 +5702,7 @@ REAL tetgenmesh::insphere_s(REAL* pa, REAL* pb, REAL* pc, REAL* pd, REAL* pe)
 {
   REAL sign;
 
-  sign = insphere(pa, pb, pc, pd, pe);
+  sign = inspherefilter(pa, pb, pc, pd, pe);
   if (sign != 0.0) {
     return sign;
   }
@@ -4900,8 +5775,8 @@ REAL tetgenmesh::orient4d_s(REAL* pa, REAL* pb, REAL* pc, REAL* pd, REAL* pe,
 {
   REAL sign;
 
-  sign = orient4d(pa, pb, pc, pd, pe, 
-                  aheight, bheight, cheight, dheight, eheight);
+  sign = orient4dfilter(pa, pb, pc, pd, pe,
+                        aheight, bheight, cheight, dheight, eheight);
   if (sign != 0.0) {
     return sign;
   }
@@ -9323,6 +10198,12 @@ int tetgenmesh::insertpoint(point insertpt, triface *searchtet, face *splitsh,
   int t1ver;
   int i, j, k, s;
 
+  // A batch of (at most 16) in-sphere tests of the Bowyer-Watson cavity.
+  point batchpts[64];
+  REAL batchsign[16];
+  long batchidx[16], batchend;
+  int batchnum, batchpos;
+
   if (b->verbose > 2) {
     printf("      Insert point %d\n", pointmark(insertpt));
   }
@@ -9524,6 +10405,7 @@ int tetgenmesh::insertpoint(point insertpt, triface *searchtet, face *splitsh,
     swaplist = cavetetlist;
     cavetetlist = cavebdrylist;
     cavebdrylist = swaplist;
+    batchend = batchpos = 0;
     for (i = 0; i < cavetetlist->objects; i++) {
       // 'cavetet' is an adjacent tet at outside of the cavity.
       cavetet = (triface *) fastlookup(cavetetlist, i);
@@ -9538,18 +10420,49 @@ int tetgenmesh::insertpoint(point insertpt, triface *searchtet, face *splitsh,
           pts = (point *) cavetet->tet;
           if (pts[7] != dummypoint) {
             // A volume tet. Operate on it.
-            if (b->weighted) {
-              sign = orient4d_s(pts[4], pts[5], pts[6], pts[7], insertpt,
-                                pts[4][3], pts[5][3], pts[6][3], pts[7][3],
-                                insertpt[3]);
-            } else {
-              sign = insphere_s(pts[4], pts[5], pts[6], pts[7], insertpt);
+            if (i >= batchend) {
+              // Test this and the next untested volume tets in a batch.
+              //   Tets are only marked (not unmarked) in this loop, hence
+              //   the result of every tet we will visit is in the batch.
+              batchnum = 0;
+              for (batchend = i; batchend < cavetetlist->objects; 
+                   batchend++) {
+                if (batchnum == 16) break;
+                parytet = (triface *) fastlookup(cavetetlist, batchend);
+                if (!infected(*parytet) && !marktested(*parytet)) {
+                  parypt = (point *) parytet->tet;
+                  if (parypt[7] != dummypoint) {
+                    for (j = 0; j < 4; j++) {
+                      batchpts[batchnum * 4 + j] = parypt[4 + j];
+                    }
+                    batchidx[batchnum++] = batchend;
+                  }
+                }
+              }
+              if (b->weighted) {
+                orient4dbatch(batchnum, batchpts, insertpt, batchsign);
+              } else {
+                inspherebatch(batchnum, batchpts, insertpt, batchsign);
+              }
+              batchpos = 0;
+            }
+            while (batchidx[batchpos] < i) batchpos++;
+            sign = batchsign[batchpos];
+            if (sign == 0.0) {
+              // Degenerate case. Use symbolic perturbation.
+              if (b->weighted) {
+                sign = orient4d_s(pts[4], pts[5], pts[6], pts[7], insertpt,
+                                  pts[4][3], pts[5][3], pts[6][3], pts[7][3],
+                                  insertpt[3]);
+              } else {
+                sign = insphere_s(pts[4], pts[5], pts[6], pts[7], insertpt);
+              }
             }
             enqflag = (sign < 0.0);
           } else {
             if (!nonconvex) {
               // Test if this hull face is visible by the new point. 
-              ori = orient3d(pts[4], pts[5], pts[6], insertpt); 
+              ori = orient3dfilter(pts[4], pts[5], pts[6], insertpt); 
               if (ori < 0) {
                 // A visible hull face. 
                 // Include it in the cavity. The convex hull will be enlarged.
@@ -11309,6 +12222,9 @@ enum tetgenmesh::locateresult
   enum {ORGMOVE, DESTMOVE, APEXMOVE} nextmove;
   REAL ori, oriorg, oridest, oriapex;
   enum locateresult loc = OUTSIDE;
+  point pts[9];
+  REAL oris[3];
+  long walksteps = 0l;
   int t1ver;
   int s;
 
@@ -11329,7 +12245,7 @@ enum tetgenmesh::locateresult
     torg = org(*searchtet);
     tdest = dest(*searchtet);
     tapex = apex(*searchtet);
-    ori = orient3d(torg, tdest, tapex, searchpt); 
+    ori = orient3dfilter(torg, tdest, tapex, searchpt); 
     if (ori < 0.0) break;
   }
   if (searchtet->ver == 4) {
@@ -11351,9 +12267,15 @@ enum tetgenmesh::locateresult
     }
 
     // We enter from one of serarchtet's faces, which face do we exit?
-    oriorg = orient3d(tdest, tapex, toppo, searchpt); 
-    oridest = orient3d(tapex, torg, toppo, searchpt);
-    oriapex = orient3d(torg, tdest, toppo, searchpt);
+    //   The three orientations share 'toppo' and 'searchpt', evaluate
+    //   them in one batch.
+    pts[0] = tdest; pts[1] = tapex; pts[2] = toppo;
+    pts[3] = tapex; pts[4] = torg;  pts[5] = toppo;
+    pts[6] = torg;  pts[7] = tdest; pts[8] = toppo;
+    orient3dbatch(3, pts, searchpt, oris);
+    oriorg = oris[0];
+    oridest = oris[1];
+    oriapex = oris[2];
 
     // Now decide which face to move. It is possible there are more than one
     //   faces are viable moves. If so, randomly choose one.
@@ -11474,6 +12396,7 @@ enum tetgenmesh::locateresult
     }
     // Move to the adjacent tetrahedron (maybe a hull tetrahedron).
     fsymself(*searchtet);
+    walksteps++;
     if (oppo(*searchtet) == dummypoint) {
       loc = OUTSIDE; // return OUTSIDE;
       break;
@@ -11486,6 +12409,10 @@ enum tetgenmesh::locateresult
 
   } // while (true)
 
+  ptloccount++;
+  ptlocsteps += walksteps;
+  if (walksteps > ptlocmaxsteps) ptlocmaxsteps = walksteps;
+
   return loc;
 }
 
@@ -20087,7 +21014,7 @@ int tetgenmesh::getvertexstar(int fullstar, point searchpt, arraypool* tetlist,
 
   collectflag = 1;
   esym(searchtet, neightet);
-  if (issubface(neightet)) {
+  if (!compacttets && issubface(neightet)) {
     if (shlist != NULL) {
       tspivot(neightet, checksh);
       if (!sinfected(checksh)) {
@@ -20127,7 +21054,7 @@ int tetgenmesh::getvertexstar(int fullstar, point searchpt, arraypool* tetlist,
       collectflag = 1;
       enextself(searchtet);
       esym(searchtet, neightet);
-      if (issubface(neightet)) {
+      if (!compacttets && issubface(neightet)) {
         if (shlist != NULL) {
           tspivot(neightet, checksh);
           if (!sinfected(checksh)) {
@@ -21392,2893 +22319,3251 @@ int tetgenmesh::suppressbdrysteinerpoint(point steinerpt)
   if (steinerleft > 0) steinerleft++;  // We've removed a Steiner points.
 
 
-  point *parypt;
-  int steinercount = 0;
+  point *parypt;
+  int steinercount = 0;
+
+  int bak_fliplinklevel = b->fliplinklevel;
+  b->fliplinklevel = 100000; // Unlimited flip level.
+
+  // Try to remove newly added Steiner points.
+  for (i = 0; i < n; i++) {
+    if (newsteiners[i] != NULL) {
+      if (!removevertexbyflips(newsteiners[i])) {
+        if (b->supsteiner_level > 0) { // Not -Y/0
+          // Save it in subvertstack for removal.
+          subvertstack->newindex((void **) &parypt);
+          *parypt = newsteiners[i];
+        }
+        steinercount++;
+      }
+    }
+  }
+
+  b->fliplinklevel = bak_fliplinklevel;
+
+  if (steinercount > 0) {
+    if (b->verbose > 2) {
+      printf("      Added %d interior Steiner points.\n", steinercount);
+    }
+  }
+
+  delete [] newsteiners;
+
+  return 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// suppresssteinerpoints()    Suppress Steiner points.                       //
+//                                                                           //
+// All Steiner points have been saved in 'subvertstack' in the routines      //
+// carveholes() and suppresssteinerpoint().                                  //
+// Each Steiner point is either removed or shifted into the interior.        //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+int tetgenmesh::suppresssteinerpoints()
+{
+
+  if (!b->quiet) {
+    printf("Suppressing Steiner points ...\n");
+  }
+
+  point rempt, *parypt;
+
+  int bak_fliplinklevel = b->fliplinklevel;
+  b->fliplinklevel = 100000; // Unlimited flip level.
+  int suppcount = 0, remcount = 0;
+  int i;
+
+  // Try to suppress boundary Steiner points.
+  for (i = 0; i < subvertstack->objects; i++) {
+    parypt = (point *) fastlookup(subvertstack, i);
+    rempt = *parypt;
+    if (pointtype(rempt) != UNUSEDVERTEX) {
+      if ((pointtype(rempt) == FREESEGVERTEX) || 
+          (pointtype(rempt) == FREEFACETVERTEX)) {
+        if (suppressbdrysteinerpoint(rempt)) {
+          suppcount++;
+        }
+      }
+    }
+  } // i
+
+  if (suppcount > 0) {
+    if (b->verbose) {
+      printf("  Suppressed %d boundary Steiner points.\n", suppcount);
+    }
+  }
+
+  if (b->supsteiner_level > 0) { // -Y/1
+    for (i = 0; i < subvertstack->objects; i++) {
+      parypt = (point *) fastlookup(subvertstack, i);
+      rempt = *parypt;
+      if (pointtype(rempt) != UNUSEDVERTEX) {
+        if (pointtype(rempt) == FREEVOLVERTEX) {
+          if (removevertexbyflips(rempt)) {
+            remcount++;
+          }
+        }
+      }
+    }
+  }
+
+  if (remcount > 0) {
+    if (b->verbose) {
+      printf("  Removed %d interior Steiner points.\n", remcount);
+    }
+  }
+
+  b->fliplinklevel = bak_fliplinklevel;
+
+  if (b->supsteiner_level > 1) { // -Y/2
+    // Smooth interior Steiner points.
+    optparameters opm;
+    triface *parytet;
+    point *ppt;
+    REAL ori;
+    int smtcount, count, ivcount;
+    int nt, j;
+
+    // Point smooth options.
+    opm.max_min_volume = 1;
+    opm.numofsearchdirs = 20;
+    opm.searchstep = 0.001;
+    opm.maxiter = 30; // Limit the maximum iterations.
+
+    smtcount = 0;
+
+    do {
+
+      nt = 0;
+
+      while (1) {
+        count = 0;
+        ivcount = 0; // Clear the inverted count.
+
+        for (i = 0; i < subvertstack->objects; i++) {
+          parypt = (point *) fastlookup(subvertstack, i);
+          rempt = *parypt;
+          if (pointtype(rempt) == FREEVOLVERTEX) {
+            getvertexstar(1, rempt, cavetetlist, NULL, NULL);
+            // Calculate the initial smallest volume (maybe zero or negative).
+            for (j = 0; j < cavetetlist->objects; j++) {
+              parytet = (triface *) fastlookup(cavetetlist, j);
+              ppt = (point *) &(parytet->tet[4]);
+              ori = orient3dfast(ppt[1], ppt[0], ppt[2], ppt[3]);
+              if (j == 0) {
+                opm.initval = ori;
+              } else {
+                if (opm.initval > ori) opm.initval = ori; 
+              }
+            }
+            if (smoothpoint(rempt, cavetetlist, 1, &opm)) {
+              count++;
+            }
+            if (opm.imprval <= 0.0) {
+              ivcount++; // The mesh contains inverted elements.
+            }
+            cavetetlist->restart();
+          }
+        } // i
+
+        smtcount += count;
+
+        if (count == 0) {
+          // No point has been smoothed.
+          break;
+        }
 
-  int bak_fliplinklevel = b->fliplinklevel;
-  b->fliplinklevel = 100000; // Unlimited flip level.
+        nt++;
+        if (nt > 2) {
+          break; // Already three iterations.
+        }
+      } // while
 
-  // Try to remove newly added Steiner points.
-  for (i = 0; i < n; i++) {
-    if (newsteiners[i] != NULL) {
-      if (!removevertexbyflips(newsteiners[i])) {
-        if (b->supsteiner_level > 0) { // Not -Y/0
-          // Save it in subvertstack for removal.
-          subvertstack->newindex((void **) &parypt);
-          *parypt = newsteiners[i];
+      if (ivcount > 0) {
+        // There are inverted elements!
+        if (opm.maxiter > 0) {
+          // Set unlimited smoothing steps. Try again.
+          opm.numofsearchdirs = 30;
+          opm.searchstep = 0.0001;
+          opm.maxiter = -1;
+          continue;
         }
-        steinercount++;
       }
-    }
-  }
 
-  b->fliplinklevel = bak_fliplinklevel;
+      break;
+    } while (1); // Additional loop for (ivcount > 0)
 
-  if (steinercount > 0) {
-    if (b->verbose > 2) {
-      printf("      Added %d interior Steiner points.\n", steinercount);
+    if (ivcount > 0) {
+      printf("BUG Report!  The mesh contain inverted elements.\n");
     }
-  }
 
-  delete [] newsteiners;
+    if (b->verbose) {
+      if (smtcount > 0) {
+        printf("  Smoothed %d Steiner points.\n", smtcount); 
+      }
+    }
+  } // -Y2
+
+  subvertstack->restart();
 
   return 1;
 }
 
-
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// suppresssteinerpoints()    Suppress Steiner points.                       //
-//                                                                           //
-// All Steiner points have been saved in 'subvertstack' in the routines      //
-// carveholes() and suppresssteinerpoint().                                  //
-// Each Steiner point is either removed or shifted into the interior.        //
+// recoverboundary()    Recover segments and facets.                         //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-int tetgenmesh::suppresssteinerpoints()
+void tetgenmesh::recoverboundary(clock_t& tv)
 {
+  arraypool *misseglist, *misshlist;
+  arraypool *bdrysteinerptlist;
+  face searchsh, *parysh;
+  face searchseg, *paryseg;
+  point rempt, *parypt;
+  long ms; // The number of missing segments/subfaces.
+  int nit; // The number of iterations.
+  int s, i;
+
+  // Counters.
+  long bak_segref_count, bak_facref_count, bak_volref_count;
 
   if (!b->quiet) {
-    printf("Suppressing Steiner points ...\n");
+    printf("Recovering boundaries...\n");
   }
 
-  point rempt, *parypt;
 
-  int bak_fliplinklevel = b->fliplinklevel;
-  b->fliplinklevel = 100000; // Unlimited flip level.
-  int suppcount = 0, remcount = 0;
-  int i;
+  if (b->verbose) {
+    printf("  Recovering segments.\n");
+  }
 
-  // Try to suppress boundary Steiner points.
-  for (i = 0; i < subvertstack->objects; i++) {
-    parypt = (point *) fastlookup(subvertstack, i);
-    rempt = *parypt;
-    if (pointtype(rempt) != UNUSEDVERTEX) {
-      if ((pointtype(rempt) == FREESEGVERTEX) || 
-          (pointtype(rempt) == FREEFACETVERTEX)) {
-        if (suppressbdrysteinerpoint(rempt)) {
-          suppcount++;
+  // Segments will be introduced.
+  checksubsegflag = 1;
+
+  misseglist = new arraypool(sizeof(face), 8);
+  bdrysteinerptlist = new arraypool(sizeof(point), 8);
+
+  // In random order.
+  subsegs->traversalinit();
+  for (i = 0; i < subsegs->items; i++) {
+    s = randomnation(i + 1);
+    // Move the s-th seg to the i-th.
+    subsegstack->newindex((void **) &paryseg);
+    *paryseg = * (face *) fastlookup(subsegstack, s);
+    // Put i-th seg to be the s-th.
+    searchseg.sh = shellfacetraverse(subsegs);
+    paryseg = (face *) fastlookup(subsegstack, s);
+    *paryseg = searchseg;
+  }
+
+  // The init number of missing segments.
+  ms = subsegs->items;
+  nit = 0; 
+  if (b->fliplinklevel < 0) {
+    autofliplinklevel = 1; // Init value.
+  }
+
+  // First, trying to recover segments by only doing flips.
+  while (1) {
+    recoversegments(misseglist, 0, 0);
+
+    if (misseglist->objects > 0) {
+      if (b->fliplinklevel >= 0) {
+        break;
+      } else {
+        if (misseglist->objects >= ms) {
+          nit++;
+          if (nit >= 3) {
+            //break;
+            // Do the last round with unbounded flip link level.
+            b->fliplinklevel = 100000;
+          }
+        } else {
+          ms = misseglist->objects;
+          if (nit > 0) {
+            nit--;
+          }
+        }
+        for (i = 0; i < misseglist->objects; i++) {
+          subsegstack->newindex((void **) &paryseg);
+          *paryseg = * (face *) fastlookup(misseglist, i);
         }
+        misseglist->restart();
+        autofliplinklevel+=b->fliplinklevelinc;
       }
+    } else {
+      // All segments are recovered.
+      break;
     }
-  } // i
+  } // while (1)
 
-  if (suppcount > 0) {
+  if (b->verbose) {
+    printf("  %ld (%ld) segments are recovered (missing).\n", 
+           subsegs->items - misseglist->objects, misseglist->objects);
+  }
+
+  if (misseglist->objects > 0) {
+    // Second, trying to recover segments by doing more flips (fullsearch).
+    while (misseglist->objects > 0) {
+      ms = misseglist->objects;
+      for (i = 0; i < misseglist->objects; i++) {
+        subsegstack->newindex((void **) &paryseg);
+        *paryseg = * (face *) fastlookup(misseglist, i);
+      }
+      misseglist->restart();
+
+      recoversegments(misseglist, 1, 0);
+
+      if (misseglist->objects < ms) {
+        // The number of missing segments is reduced.
+        continue;
+      } else {
+        break;
+      }
+    }
     if (b->verbose) {
-      printf("  Suppressed %d boundary Steiner points.\n", suppcount);
+      printf("  %ld (%ld) segments are recovered (missing).\n", 
+             subsegs->items - misseglist->objects, misseglist->objects);
     }
   }
 
-  if (b->supsteiner_level > 0) { // -Y/1
+  if (misseglist->objects > 0) {
+    // Third, trying to recover segments by doing more flips (fullsearch)
+    //   and adding Steiner points in the volume.
+    while (misseglist->objects > 0) {
+      ms = misseglist->objects;
+      for (i = 0; i < misseglist->objects; i++) {
+        subsegstack->newindex((void **) &paryseg);
+        *paryseg = * (face *) fastlookup(misseglist, i);
+      }
+      misseglist->restart();
+
+      recoversegments(misseglist, 1, 1);
+
+      if (misseglist->objects < ms) {
+        // The number of missing segments is reduced.
+        continue;
+      } else {
+        break;
+      }
+    }
+    if (b->verbose) {
+      printf("  Added %ld Steiner points in volume.\n", st_volref_count);
+    }
+  }
+
+  if (misseglist->objects > 0) {
+    // Last, trying to recover segments by doing more flips (fullsearch),
+    //   and adding Steiner points in the volume, and splitting segments.
+    long bak_inpoly_count = st_volref_count; //st_inpoly_count;
+    for (i = 0; i < misseglist->objects; i++) {
+      subsegstack->newindex((void **) &paryseg);
+      *paryseg = * (face *) fastlookup(misseglist, i);
+    }
+    misseglist->restart();
+
+    recoversegments(misseglist, 1, 2);
+
+    if (b->verbose) {
+      printf("  Added %ld Steiner points in segments.\n", st_segref_count);
+      if (st_volref_count > bak_inpoly_count) {
+        printf("  Added another %ld Steiner points in volume.\n", 
+               st_volref_count - bak_inpoly_count);
+      }
+    }
+  }
+
+
+  if (st_segref_count > 0) {
+    // Try to remove the Steiner points added in segments.
+    bak_segref_count = st_segref_count;
+    bak_volref_count = st_volref_count;
     for (i = 0; i < subvertstack->objects; i++) {
+      // Get the Steiner point.
       parypt = (point *) fastlookup(subvertstack, i);
       rempt = *parypt;
-      if (pointtype(rempt) != UNUSEDVERTEX) {
-        if (pointtype(rempt) == FREEVOLVERTEX) {
-          if (removevertexbyflips(rempt)) {
-            remcount++;
-          }
+      if (!removevertexbyflips(rempt)) {
+        // Save it in list.
+        bdrysteinerptlist->newindex((void **) &parypt);
+        *parypt = rempt;
+      }
+    }
+    if (b->verbose) {
+      if (st_segref_count < bak_segref_count) {
+        if (bak_volref_count < st_volref_count) {
+          printf("  Suppressed %ld Steiner points in segments.\n", 
+                 st_volref_count - bak_volref_count);
+        }
+        if ((st_segref_count + (st_volref_count - bak_volref_count)) <
+            bak_segref_count) {
+          printf("  Removed %ld Steiner points in segments.\n", 
+                 bak_segref_count - 
+                   (st_segref_count + (st_volref_count - bak_volref_count)));
         }
       }
     }
+    subvertstack->restart();
   }
 
-  if (remcount > 0) {
-    if (b->verbose) {
-      printf("  Removed %d interior Steiner points.\n", remcount);
-    }
-  }
 
-  b->fliplinklevel = bak_fliplinklevel;
+  tv = clock();
 
-  if (b->supsteiner_level > 1) { // -Y/2
-    // Smooth interior Steiner points.
-    optparameters opm;
-    triface *parytet;
-    point *ppt;
-    REAL ori;
-    int smtcount, count, ivcount;
-    int nt, j;
+  if (b->verbose) {
+    printf("  Recovering facets.\n");
+  }
 
-    // Point smooth options.
-    opm.max_min_volume = 1;
-    opm.numofsearchdirs = 20;
-    opm.searchstep = 0.001;
-    opm.maxiter = 30; // Limit the maximum iterations.
+  // Subfaces will be introduced.
+  checksubfaceflag = 1;
 
-    smtcount = 0;
+  misshlist = new arraypool(sizeof(face), 8);
 
-    do {
+  // Randomly order the subfaces.
+  subfaces->traversalinit();
+  for (i = 0; i < subfaces->items; i++) {
+    s = randomnation(i + 1);
+    // Move the s-th subface to the i-th.
+    subfacstack->newindex((void **) &parysh);
+    *parysh = * (face *) fastlookup(subfacstack, s);
+    // Put i-th subface to be the s-th.
+    searchsh.sh = shellfacetraverse(subfaces);
+    parysh = (face *) fastlookup(subfacstack, s);
+    *parysh = searchsh;
+  }
 
-      nt = 0;
+  ms = subfaces->items;
+  nit = 0; 
+  b->fliplinklevel = -1; // Init.
+  if (b->fliplinklevel < 0) {
+    autofliplinklevel = 1; // Init value.
+  }
 
-      while (1) {
-        count = 0;
-        ivcount = 0; // Clear the inverted count.
+  while (1) {
+    recoversubfaces(misshlist, 0);
 
-        for (i = 0; i < subvertstack->objects; i++) {
-          parypt = (point *) fastlookup(subvertstack, i);
-          rempt = *parypt;
-          if (pointtype(rempt) == FREEVOLVERTEX) {
-            getvertexstar(1, rempt, cavetetlist, NULL, NULL);
-            // Calculate the initial smallest volume (maybe zero or negative).
-            for (j = 0; j < cavetetlist->objects; j++) {
-              parytet = (triface *) fastlookup(cavetetlist, j);
-              ppt = (point *) &(parytet->tet[4]);
-              ori = orient3dfast(ppt[1], ppt[0], ppt[2], ppt[3]);
-              if (j == 0) {
-                opm.initval = ori;
-              } else {
-                if (opm.initval > ori) opm.initval = ori; 
-              }
-            }
-            if (smoothpoint(rempt, cavetetlist, 1, &opm)) {
-              count++;
-            }
-            if (opm.imprval <= 0.0) {
-              ivcount++; // The mesh contains inverted elements.
-            }
-            cavetetlist->restart();
+    if (misshlist->objects > 0) {
+      if (b->fliplinklevel >= 0) {
+        break;
+      } else {
+        if (misshlist->objects >= ms) {
+          nit++;
+          if (nit >= 3) {
+            //break;
+            // Do the last round with unbounded flip link level.
+            b->fliplinklevel = 100000;
+          }
+        } else {
+          ms = misshlist->objects;
+          if (nit > 0) {
+            nit--;
           }
-        } // i
-
-        smtcount += count;
-
-        if (count == 0) {
-          // No point has been smoothed.
-          break;
-        }
-
-        nt++;
-        if (nt > 2) {
-          break; // Already three iterations.
         }
-      } // while
-
-      if (ivcount > 0) {
-        // There are inverted elements!
-        if (opm.maxiter > 0) {
-          // Set unlimited smoothing steps. Try again.
-          opm.numofsearchdirs = 30;
-          opm.searchstep = 0.0001;
-          opm.maxiter = -1;
-          continue;
+        for (i = 0; i < misshlist->objects; i++) {
+          subfacstack->newindex((void **) &parysh);
+          *parysh = * (face *) fastlookup(misshlist, i);
         }
+        misshlist->restart();
+        autofliplinklevel+=b->fliplinklevelinc;
       }
-
+    } else {
+      // All subfaces are recovered.
       break;
-    } while (1); // Additional loop for (ivcount > 0)
+    }
+  } // while (1)
 
-    if (ivcount > 0) {
-      printf("BUG Report!  The mesh contain inverted elements.\n");
+  if (b->verbose) {
+    printf("  %ld (%ld) subfaces are recovered (missing).\n", 
+           subfaces->items - misshlist->objects, misshlist->objects);
+  }
+
+  if (misshlist->objects > 0) {
+    // There are missing subfaces. Add Steiner points.
+    for (i = 0; i < misshlist->objects; i++) {
+      subfacstack->newindex((void **) &parysh);
+      *parysh = * (face *) fastlookup(misshlist, i);
     }
+    misshlist->restart();
+
+    recoversubfaces(NULL, 1);
 
     if (b->verbose) {
-      if (smtcount > 0) {
-        printf("  Smoothed %d Steiner points.\n", smtcount); 
-      }
+      printf("  Added %ld Steiner points in facets.\n", st_facref_count);
     }
-  } // -Y2
+  }
 
-  subvertstack->restart();
 
-  return 1;
-}
+  if (st_facref_count > 0) {
+    // Try to remove the Steiner points added in facets.
+    bak_facref_count = st_facref_count;
+    for (i = 0; i < subvertstack->objects; i++) {
+      // Get the Steiner point.
+      parypt = (point *) fastlookup(subvertstack, i);
+      rempt = *parypt;
+      if (!removevertexbyflips(*parypt)) {
+        // Save it in list.
+        bdrysteinerptlist->newindex((void **) &parypt);
+        *parypt = rempt;
+      }
+    }
+    if (b->verbose) {
+      if (st_facref_count < bak_facref_count) {
+        printf("  Removed %ld Steiner points in facets.\n", 
+               bak_facref_count - st_facref_count);
+      }
+    }
+    subvertstack->restart();
+  }
 
-///////////////////////////////////////////////////////////////////////////////
-//                                                                           //
-// recoverboundary()    Recover segments and facets.                         //
-//                                                                           //
-///////////////////////////////////////////////////////////////////////////////
 
-void tetgenmesh::recoverboundary(clock_t& tv)
-{
-  arraypool *misseglist, *misshlist;
-  arraypool *bdrysteinerptlist;
-  face searchsh, *parysh;
-  face searchseg, *paryseg;
-  point rempt, *parypt;
-  long ms; // The number of missing segments/subfaces.
-  int nit; // The number of iterations.
-  int s, i;
+  if (bdrysteinerptlist->objects > 0) {
+    if (b->verbose) {
+      printf("  %ld Steiner points remained in boundary.\n",
+             bdrysteinerptlist->objects);
+    }
+  } // if
 
-  // Counters.
-  long bak_segref_count, bak_facref_count, bak_volref_count;
 
-  if (!b->quiet) {
-    printf("Recovering boundaries...\n");
-  }
+  // Accumulate the dynamic memory.
+  totalworkmemory += (misseglist->totalmemory + misshlist->totalmemory +
+                      bdrysteinerptlist->totalmemory);
 
+  delete bdrysteinerptlist;
+  delete misseglist;
+  delete misshlist;
+}
 
-  if (b->verbose) {
-    printf("  Recovering segments.\n");
-  }
+////                                                                       ////
+////                                                                       ////
+//// steiner_cxx //////////////////////////////////////////////////////////////
 
-  // Segments will be introduced.
-  checksubsegflag = 1;
 
-  misseglist = new arraypool(sizeof(face), 8);
-  bdrysteinerptlist = new arraypool(sizeof(point), 8);
+//// reconstruct_cxx //////////////////////////////////////////////////////////
+////                                                                       ////
+////                                                                       ////
 
-  // In random order.
-  subsegs->traversalinit();
-  for (i = 0; i < subsegs->items; i++) {
-    s = randomnation(i + 1);
-    // Move the s-th seg to the i-th.
-    subsegstack->newindex((void **) &paryseg);
-    *paryseg = * (face *) fastlookup(subsegstack, s);
-    // Put i-th seg to be the s-th.
-    searchseg.sh = shellfacetraverse(subsegs);
-    paryseg = (face *) fastlookup(subsegstack, s);
-    *paryseg = searchseg;
-  }
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// carveholes()    Remove tetrahedra not in the mesh domain.                 //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
 
-  // The init number of missing segments.
-  ms = subsegs->items;
-  nit = 0; 
-  if (b->fliplinklevel < 0) {
-    autofliplinklevel = 1; // Init value.
+
+void tetgenmesh::carveholes()
+{
+  arraypool *tetarray, *hullarray;
+  triface tetloop, neightet, *parytet, *parytet1;
+  triface *regiontets = NULL;
+  face checksh, *parysh;
+  face checkseg;
+  point ptloop, *parypt;
+  int t1ver;
+  int i, j, k;
+
+  if (!b->quiet) {
+    if (b->convex) {
+      printf("Marking exterior tetrahedra ...\n");
+    } else {
+      printf("Removing exterior tetrahedra ...\n");
+    }
   }
 
-  // First, trying to recover segments by only doing flips.
-  while (1) {
-    recoversegments(misseglist, 0, 0);
+  // Initialize the pool of exterior tets.
+  tetarray = new arraypool(sizeof(triface), 10);
+  hullarray = new arraypool(sizeof(triface), 10);
 
-    if (misseglist->objects > 0) {
-      if (b->fliplinklevel >= 0) {
-        break;
-      } else {
-        if (misseglist->objects >= ms) {
-          nit++;
-          if (nit >= 3) {
-            //break;
-            // Do the last round with unbounded flip link level.
-            b->fliplinklevel = 100000;
-          }
-        } else {
-          ms = misseglist->objects;
-          if (nit > 0) {
-            nit--;
-          }
-        }
-        for (i = 0; i < misseglist->objects; i++) {
-          subsegstack->newindex((void **) &paryseg);
-          *paryseg = * (face *) fastlookup(misseglist, i);
+  // Collect unprotected tets and hull tets.
+  tetrahedrons->traversalinit();
+  tetloop.ver = 11; // The face opposite to dummypoint.
+  tetloop.tet = alltetrahedrontraverse();
+  while (tetloop.tet != (tetrahedron *) NULL) {
+    if (ishulltet(tetloop)) {
+      // Is this side protected by a subface?
+      if (!issubface(tetloop)) {
+        // Collect an unprotected hull tet and tet.
+        infect(tetloop);
+        hullarray->newindex((void **) &parytet);
+        *parytet = tetloop;
+        // tetloop's face number is 11 & 3 = 3.
+        decode(tetloop.tet[3], neightet);
+        if (!infected(neightet)) {
+          infect(neightet);
+          tetarray->newindex((void **) &parytet);
+          *parytet = neightet;
         }
-        misseglist->restart();
-        autofliplinklevel+=b->fliplinklevelinc;
       }
-    } else {
-      // All segments are recovered.
-      break;
     }
-  } // while (1)
-
-  if (b->verbose) {
-    printf("  %ld (%ld) segments are recovered (missing).\n", 
-           subsegs->items - misseglist->objects, misseglist->objects);
+    tetloop.tet = alltetrahedrontraverse();
   }
 
-  if (misseglist->objects > 0) {
-    // Second, trying to recover segments by doing more flips (fullsearch).
-    while (misseglist->objects > 0) {
-      ms = misseglist->objects;
-      for (i = 0; i < misseglist->objects; i++) {
-        subsegstack->newindex((void **) &paryseg);
-        *paryseg = * (face *) fastlookup(misseglist, i);
+  if (in->numberofholes > 0) {
+    // Mark as infected any tets inside volume holes.
+    for (i = 0; i < 3 * in->numberofholes; i += 3) {
+      // Search a tet containing the i-th hole point.
+      neightet.tet = NULL;
+      randomsample(&(in->holelist[i]), &neightet);
+      if (locate(&(in->holelist[i]), &neightet) != OUTSIDE) {
+        // The tet 'neightet' contain this point.
+        if (!infected(neightet)) {
+          infect(neightet);
+          tetarray->newindex((void **) &parytet);
+          *parytet = neightet;
+          // Add its adjacent tet if it is not protected.
+          if (!issubface(neightet)) {
+            decode(neightet.tet[neightet.ver & 3], tetloop);
+            if (!infected(tetloop)) {
+              infect(tetloop);
+              if (ishulltet(tetloop)) {
+                hullarray->newindex((void **) &parytet);
+              } else {
+                tetarray->newindex((void **) &parytet);
+              }
+              *parytet = tetloop;
+            }
+          }
+          else {
+            // It is protected. Check if its adjacent tet is a hull tet.
+            decode(neightet.tet[neightet.ver & 3], tetloop);
+            if (ishulltet(tetloop)) {
+              // It is hull tet, add it into the list. Moreover, the subface
+              //   is dead, i.e., both sides are in exterior.
+              if (!infected(tetloop)) {
+                infect(tetloop);
+                hullarray->newindex((void **) &parytet);
+                *parytet = tetloop;
+              }
+            }
+            if (infected(tetloop)) {
+              // Both sides of this subface are in exterior.
+              tspivot(neightet, checksh);
+              sinfect(checksh); // Only queue it once.
+              subfacstack->newindex((void **) &parysh);
+              *parysh = checksh;
+            }
+          }
+        } // if (!infected(neightet))
+      } else {
+        // A hole point locates outside of the convex hull.
+        if (!b->quiet) {
+          printf("Warning:  The %d-th hole point ", i/3 + 1);
+          printf("lies outside the convex hull.\n");
+        }
       }
-      misseglist->restart();
-
-      recoversegments(misseglist, 1, 0);
+    } // i
+  } // if (in->numberofholes > 0)
 
-      if (misseglist->objects < ms) {
-        // The number of missing segments is reduced.
-        continue;
+  if (b->regionattrib && (in->numberofregions > 0)) { // -A option.
+    // Record the tetrahedra that contains the region points for assigning
+    //   region attributes after the holes have been carved.
+    regiontets = new triface[in->numberofregions];
+    // Mark as marktested any tetrahedra inside volume regions.
+    for (i = 0; i < 5 * in->numberofregions; i += 5) {
+      // Search a tet containing the i-th region point.
+      neightet.tet = NULL;
+      randomsample(&(in->regionlist[i]), &neightet);
+      if (locate(&(in->regionlist[i]), &neightet) != OUTSIDE) {
+        regiontets[i/5] = neightet;
       } else {
-        break;
+        if (!b->quiet) {
+          printf("Warning:  The %d-th region point ", i/5+1);
+          printf("lies outside the convex hull.\n");
+        }
+        regiontets[i/5].tet = NULL;
       }
     }
-    if (b->verbose) {
-      printf("  %ld (%ld) segments are recovered (missing).\n", 
-             subsegs->items - misseglist->objects, misseglist->objects);
-    }
   }
 
-  if (misseglist->objects > 0) {
-    // Third, trying to recover segments by doing more flips (fullsearch)
-    //   and adding Steiner points in the volume.
-    while (misseglist->objects > 0) {
-      ms = misseglist->objects;
-      for (i = 0; i < misseglist->objects; i++) {
-        subsegstack->newindex((void **) &paryseg);
-        *paryseg = * (face *) fastlookup(misseglist, i);
+  // Collect all exterior tets (in concave place and in holes).
+  for (i = 0; i < tetarray->objects; i++) {
+    parytet = (triface *) fastlookup(tetarray, i);
+    j = (parytet->ver & 3); // j is the current face number.
+    // Check the other three adjacent tets.
+    for (k = 1; k < 4; k++) {
+      decode(parytet->tet[(j + k) % 4], neightet); 
+      // neightet may be a hull tet.
+      if (!infected(neightet)) {
+        // Is neightet protected by a subface.
+        if (!issubface(neightet)) {
+          // Not proected. Collect it. (It must not be a hull tet).
+          infect(neightet);
+          tetarray->newindex((void **) &parytet1);
+          *parytet1 = neightet;
+        } else {
+          // Protected. Check if it is a hull tet.
+          if (ishulltet(neightet)) {
+            // A hull tet. Collect it.
+            infect(neightet);
+            hullarray->newindex((void **) &parytet1);
+            *parytet1 = neightet;
+            // Both sides of this subface are exterior.
+            tspivot(neightet, checksh);
+            // Queue this subface (to be deleted later).
+            sinfect(checksh); // Only queue it once.
+            subfacstack->newindex((void **) &parysh);
+            *parysh = checksh;
+          }
+        }
+      } else {
+        // Both sides of this face are in exterior.
+        // If there is a subface. It should be collected.
+        if (issubface(neightet)) {
+          tspivot(neightet, checksh);
+          if (!sinfected(checksh)) {
+            sinfect(checksh);
+            subfacstack->newindex((void **) &parysh);
+            *parysh = checksh;
+          }
+        }
       }
-      misseglist->restart();
-
-      recoversegments(misseglist, 1, 1);
+    } // j, k
+  } // i
 
-      if (misseglist->objects < ms) {
-        // The number of missing segments is reduced.
-        continue;
-      } else {
-        break;
+  if (b->regionattrib && (in->numberofregions > 0)) {
+    // Re-check saved region tets to see if they lie outside.
+    for (i = 0; i < in->numberofregions; i++) {
+      if (infected(regiontets[i])) {
+        if (b->verbose) {
+          printf("Warning:  The %d-th region point ", i+1);
+          printf("lies in the exterior of the domain.\n");
+        }
+        regiontets[i].tet = NULL;
       }
     }
-    if (b->verbose) {
-      printf("  Added %ld Steiner points in volume.\n", st_volref_count);
-    }
   }
 
-  if (misseglist->objects > 0) {
-    // Last, trying to recover segments by doing more flips (fullsearch),
-    //   and adding Steiner points in the volume, and splitting segments.
-    long bak_inpoly_count = st_volref_count; //st_inpoly_count;
-    for (i = 0; i < misseglist->objects; i++) {
-      subsegstack->newindex((void **) &paryseg);
-      *paryseg = * (face *) fastlookup(misseglist, i);
-    }
-    misseglist->restart();
-
-    recoversegments(misseglist, 1, 2);
-
-    if (b->verbose) {
-      printf("  Added %ld Steiner points in segments.\n", st_segref_count);
-      if (st_volref_count > bak_inpoly_count) {
-        printf("  Added another %ld Steiner points in volume.\n", 
-               st_volref_count - bak_inpoly_count);
+  // Collect vertices which point to infected tets. These vertices
+  //   may get deleted after the removal of exterior tets.
+  //   If -Y1 option is used, collect all Steiner points for removal.
+  //   The lists 'cavetetvertlist' and 'subvertstack' are re-used.
+  points->traversalinit();
+  ptloop = pointtraverse();
+  while (ptloop != NULL) {
+    if ((pointtype(ptloop) != UNUSEDVERTEX) &&
+        (pointtype(ptloop) != DUPLICATEDVERTEX)) {
+      decode(point2tet(ptloop), neightet);
+      if (infected(neightet)) {
+        cavetetvertlist->newindex((void **) &parypt);
+        *parypt = ptloop;
+      }
+      if (b->nobisect && (b->supsteiner_level > 0)) { // -Y/1
+        // Queue it if it is a Steiner point.
+        if (pointmark(ptloop) > 
+              (in->numberofpoints - (in->firstnumber ? 0 : 1))) {
+          subvertstack->newindex((void **) &parypt);
+          *parypt = ptloop;
+        }
       }
     }
+    ptloop = pointtraverse();
   }
 
-
-  if (st_segref_count > 0) {
-    // Try to remove the Steiner points added in segments.
-    bak_segref_count = st_segref_count;
-    bak_volref_count = st_volref_count;
-    for (i = 0; i < subvertstack->objects; i++) {
-      // Get the Steiner point.
-      parypt = (point *) fastlookup(subvertstack, i);
-      rempt = *parypt;
-      if (!removevertexbyflips(rempt)) {
-        // Save it in list.
-        bdrysteinerptlist->newindex((void **) &parypt);
-        *parypt = rempt;
-      }
-    }
-    if (b->verbose) {
-      if (st_segref_count < bak_segref_count) {
-        if (bak_volref_count < st_volref_count) {
-          printf("  Suppressed %ld Steiner points in segments.\n", 
-                 st_volref_count - bak_volref_count);
-        }
-        if ((st_segref_count + (st_volref_count - bak_volref_count)) <
-            bak_segref_count) {
-          printf("  Removed %ld Steiner points in segments.\n", 
-                 bak_segref_count - 
-                   (st_segref_count + (st_volref_count - bak_volref_count)));
-        }
+  if (!b->convex && (tetarray->objects > 0l)) { // No -c option.
+    // Remove exterior tets. Hull tets are updated.
+    arraypool *newhullfacearray;
+    triface hulltet, casface;
+    face segloop, *paryseg;
+    point pa, pb, pc;
+    long delsegcount = 0l;
+ 
+    // Collect segments which point to infected tets. Some segments
+    //   may get deleted after the removal of exterior tets.
+    subsegs->traversalinit();
+    segloop.sh = shellfacetraverse(subsegs);
+    while (segloop.sh != NULL) {
+      sstpivot1(segloop, neightet);
+      if (infected(neightet)) {
+        subsegstack->newindex((void **) &paryseg);
+        *paryseg = segloop;
       }
+      segloop.sh = shellfacetraverse(subsegs);
     }
-    subvertstack->restart();
-  }
 
+    newhullfacearray = new arraypool(sizeof(triface), 10);
 
-  tv = clock();
+    // Create and save new hull tets.
+    for (i = 0; i < tetarray->objects; i++) {
+      parytet = (triface *) fastlookup(tetarray, i);
+      for (j = 0; j < 4; j++) {
+        decode(parytet->tet[j], tetloop);
+        if (!infected(tetloop)) {
+          // Found a new hull face (must be a subface).
+          tspivot(tetloop, checksh);
+          maketetrahedron(&hulltet);
+          pa = org(tetloop);
+          pb = dest(tetloop);
+          pc = apex(tetloop);
+          setvertices(hulltet, pb, pa, pc, dummypoint);
+          bond(tetloop, hulltet);
+          // Update the subface-to-tet map.
+          sesymself(checksh);
+          tsbond(hulltet, checksh);
+          // Update the segment-to-tet map.
+          for (k = 0; k < 3; k++) {
+            if (issubseg(tetloop)) {
+              tsspivot1(tetloop, checkseg);
+              tssbond1(hulltet, checkseg);
+              sstbond1(checkseg, hulltet);
+            }
+            enextself(tetloop);
+            eprevself(hulltet);
+          }
+          // Update the point-to-tet map.
+          setpoint2tet(pa, (tetrahedron) tetloop.tet);
+          setpoint2tet(pb, (tetrahedron) tetloop.tet);
+          setpoint2tet(pc, (tetrahedron) tetloop.tet);
+          // Save the exterior tet at this hull face. It still holds pointer
+          //   to the adjacent interior tet. Use it to connect new hull tets. 
+          newhullfacearray->newindex((void **) &parytet1);
+          parytet1->tet = parytet->tet;
+          parytet1->ver = j;
+        } // if (!infected(tetloop))
+      } // j
+    } // i
 
-  if (b->verbose) {
-    printf("  Recovering facets.\n");
-  }
+    // Connect new hull tets.
+    for (i = 0; i < newhullfacearray->objects; i++) {
+      parytet = (triface *) fastlookup(newhullfacearray, i);
+      fsym(*parytet, neightet);
+      // Get the new hull tet.
+      fsym(neightet, hulltet);
+      for (j = 0; j < 3; j++) {
+        esym(hulltet, casface);
+        if (casface.tet[casface.ver & 3] == NULL) {
+          // Since the boundary of the domain may not be a manifold, we
+          //   find the adjacent hull face by traversing the tets in the
+          //   exterior (which are all infected tets).
+          neightet = *parytet;
+          while (1) {
+            fnextself(neightet);
+            if (!infected(neightet)) break;
+          }
+          if (!ishulltet(neightet)) {
+            // An interior tet. Get the new hull tet.
+            fsymself(neightet);
+            esymself(neightet);
+          } 
+          // Bond them together.
+          bond(casface, neightet);
+        }
+        enextself(hulltet);
+        enextself(*parytet);
+      } // j
+    } // i
 
-  // Subfaces will be introduced.
-  checksubfaceflag = 1;
+    if (subfacstack->objects > 0l) {
+      // Remove all subfaces which do not attach to any tetrahedron.
+      //   Segments which are not attached to any subfaces and tets
+      //   are deleted too.
+      face casingout, casingin;
 
-  misshlist = new arraypool(sizeof(face), 8);
+      for (i = 0; i < subfacstack->objects; i++) {
+        parysh = (face *) fastlookup(subfacstack, i);
+        if (i == 0) {
+          if (b->verbose) {
+            printf("Warning:  Removed an exterior face (%d, %d, %d) #%d\n",
+                   pointmark(sorg(*parysh)), pointmark(sdest(*parysh)),
+                   pointmark(sapex(*parysh)), shellmark(*parysh));
+          }
+        }
+        // Dissolve this subface from face links.
+        for (j = 0; j < 3; j++) {         
+          spivot(*parysh, casingout);
+          sspivot(*parysh, checkseg);
+          if (casingout.sh != NULL) {
+            casingin = casingout;
+            while (1) {
+              spivot(casingin, checksh);
+              if (checksh.sh == parysh->sh) break;
+              casingin = checksh;
+            }
+            if (casingin.sh != casingout.sh) {
+              // Update the link: ... -> casingin -> casingout ->...
+              sbond1(casingin, casingout);
+            } else {
+              // Only one subface at this edge is left.
+              sdissolve(casingout);
+            }
+            if (checkseg.sh != NULL) {
+              // Make sure the segment does not connect to a dead one.
+              ssbond(casingout, checkseg);
+            }
+          } else {
+            if (checkseg.sh != NULL) {
+              //if (checkseg.sh[3] != NULL) {
+              if (delsegcount == 0) {
+                if (b->verbose) {
+                  printf("Warning:  Removed an exterior segment (%d, %d) #%d\n",
+                         pointmark(sorg(checkseg)), pointmark(sdest(checkseg)),
+                         shellmark(checkseg));
+                }
+              }
+              shellfacedealloc(subsegs, checkseg.sh);
+              delsegcount++;
+            }
+          }
+          senextself(*parysh);
+        } // j
+        // Delete this subface.
+        shellfacedealloc(subfaces, parysh->sh);
+      } // i
+      if (b->verbose) {
+        printf("  Deleted %ld subfaces.\n", subfacstack->objects);
+      }
+      subfacstack->restart();
+    } // if (subfacstack->objects > 0l)
 
-  // Randomly order the subfaces.
-  subfaces->traversalinit();
-  for (i = 0; i < subfaces->items; i++) {
-    s = randomnation(i + 1);
-    // Move the s-th subface to the i-th.
-    subfacstack->newindex((void **) &parysh);
-    *parysh = * (face *) fastlookup(subfacstack, s);
-    // Put i-th subface to be the s-th.
-    searchsh.sh = shellfacetraverse(subfaces);
-    parysh = (face *) fastlookup(subfacstack, s);
-    *parysh = searchsh;
-  }
+    if (subsegstack->objects > 0l) {
+      for (i = 0; i < subsegstack->objects; i++) {
+        paryseg = (face *) fastlookup(subsegstack, i);
+        if (paryseg->sh && (paryseg->sh[3] != NULL)) {
+          sstpivot1(*paryseg, neightet);
+          if (infected(neightet)) {
+            if (b->verbose) {
+              printf("Warning:  Removed an exterior segment (%d, %d) #%d\n",
+                     pointmark(sorg(*paryseg)), pointmark(sdest(*paryseg)),
+                     shellmark(*paryseg));
+            }
+            shellfacedealloc(subsegs, paryseg->sh);
+            delsegcount++;
+          }
+        }
+      }
+      subsegstack->restart();
+    } // if (subsegstack->objects > 0l)
 
-  ms = subfaces->items;
-  nit = 0; 
-  b->fliplinklevel = -1; // Init.
-  if (b->fliplinklevel < 0) {
-    autofliplinklevel = 1; // Init value.
-  }
+    if (delsegcount > 0) {
+      if (b->verbose) {
+        printf("  Deleted %ld segments.\n", delsegcount);
+      }
+    }
 
-  while (1) {
-    recoversubfaces(misshlist, 0);
+    if (cavetetvertlist->objects > 0l) {
+      // Some vertices may lie in exterior. Marke them as UNUSEDVERTEX.
+      long delvertcount = unuverts;
+      long delsteinercount = 0l;
 
-    if (misshlist->objects > 0) {
-      if (b->fliplinklevel >= 0) {
-        break;
-      } else {
-        if (misshlist->objects >= ms) {
-          nit++;
-          if (nit >= 3) {
-            //break;
-            // Do the last round with unbounded flip link level.
-            b->fliplinklevel = 100000;
-          }
-        } else {
-          ms = misshlist->objects;
-          if (nit > 0) {
-            nit--;
+      for (i = 0; i < cavetetvertlist->objects; i++) {
+        parypt = (point *) fastlookup(cavetetvertlist, i);
+        decode(point2tet(*parypt), neightet);
+        if (infected(neightet)) {
+          // Found an exterior vertex.
+          if (pointmark(*parypt) > 
+                (in->numberofpoints - (in->firstnumber ? 0 : 1))) {
+            // A Steiner point.
+            if (pointtype(*parypt) == FREESEGVERTEX) {
+              st_segref_count--;
+            } else if (pointtype(*parypt) == FREEFACETVERTEX) {
+              st_facref_count--;
+            } else {
+              st_volref_count--;
+            }
+            delsteinercount++;
+            if (steinerleft > 0) steinerleft++;
           }
+          setpointtype(*parypt, UNUSEDVERTEX);
+          unuverts++;
         }
-        for (i = 0; i < misshlist->objects; i++) {
-          subfacstack->newindex((void **) &parysh);
-          *parysh = * (face *) fastlookup(misshlist, i);
+      }
+
+      if (b->verbose) {
+        if (unuverts > delvertcount) {
+          if (delsteinercount > 0l) {
+            if (unuverts > (delvertcount + delsteinercount)) {
+              printf("  Removed %ld exterior input vertices.\n", 
+                     unuverts - delvertcount - delsteinercount);
+            }
+            printf("  Removed %ld exterior Steiner vertices.\n", 
+                   delsteinercount);
+          } else {
+            printf("  Removed %ld exterior input vertices.\n", 
+                   unuverts - delvertcount);
+          }
         }
-        misshlist->restart();
-        autofliplinklevel+=b->fliplinklevelinc;
       }
-    } else {
-      // All subfaces are recovered.
-      break;
-    }
-  } // while (1)
+      cavetetvertlist->restart();
+      // Comment: 'subvertstack' will be cleaned in routine
+      //   suppresssteinerpoints().
+    } // if (cavetetvertlist->objects > 0l)
 
-  if (b->verbose) {
-    printf("  %ld (%ld) subfaces are recovered (missing).\n", 
-           subfaces->items - misshlist->objects, misshlist->objects);
-  }
+    // Update the hull size.
+    hullsize += (newhullfacearray->objects - hullarray->objects);
 
-  if (misshlist->objects > 0) {
-    // There are missing subfaces. Add Steiner points.
-    for (i = 0; i < misshlist->objects; i++) {
-      subfacstack->newindex((void **) &parysh);
-      *parysh = * (face *) fastlookup(misshlist, i);
+    // Delete all exterior tets and old hull tets.
+    for (i = 0; i < tetarray->objects; i++) {
+      parytet = (triface *) fastlookup(tetarray, i);
+      tetrahedrondealloc(parytet->tet);
     }
-    misshlist->restart();
+    tetarray->restart();
 
-    recoversubfaces(NULL, 1);
+    for (i = 0; i < hullarray->objects; i++) {
+      parytet = (triface *) fastlookup(hullarray, i);
+      tetrahedrondealloc(parytet->tet);
+    }
+    hullarray->restart();
 
-    if (b->verbose) {
-      printf("  Added %ld Steiner points in facets.\n", st_facref_count);
+    delete newhullfacearray;
+  } // if (!b->convex && (tetarray->objects > 0l))
+
+  if (b->convex && (tetarray->objects > 0l)) { // With -c option
+    // In this case, all exterior tets get a region marker '-1'.
+    int attrnum = numelemattrib - 1;
+
+    for (i = 0; i < tetarray->objects; i++) {
+      parytet = (triface *) fastlookup(tetarray, i);
+      setelemattribute(parytet->tet, attrnum, -1);
     }
-  }
+    tetarray->restart();
 
+    for (i = 0; i < hullarray->objects; i++) {
+      parytet = (triface *) fastlookup(hullarray, i);
+      uninfect(*parytet);
+    }
+    hullarray->restart();
 
-  if (st_facref_count > 0) {
-    // Try to remove the Steiner points added in facets.
-    bak_facref_count = st_facref_count;
-    for (i = 0; i < subvertstack->objects; i++) {
-      // Get the Steiner point.
-      parypt = (point *) fastlookup(subvertstack, i);
-      rempt = *parypt;
-      if (!removevertexbyflips(*parypt)) {
-        // Save it in list.
-        bdrysteinerptlist->newindex((void **) &parypt);
-        *parypt = rempt;
+    if (subfacstack->objects > 0l) {
+      for (i = 0; i < subfacstack->objects; i++) {
+        parysh = (face *) fastlookup(subfacstack, i);
+        suninfect(*parysh);
       }
+      subfacstack->restart();
     }
-    if (b->verbose) {
-      if (st_facref_count < bak_facref_count) {
-        printf("  Removed %ld Steiner points in facets.\n", 
-               bak_facref_count - st_facref_count);
+
+    if (cavetetvertlist->objects > 0l) {
+      cavetetvertlist->restart();
+    }
+  } // if (b->convex && (tetarray->objects > 0l))
+
+  if (b->regionattrib) { // With -A option.
+    if (!b->quiet) {
+      printf("Spreading region attributes.\n");
+    }
+    REAL volume;
+    int attr, maxattr = 0; // Choose a small number here.
+    int attrnum = numelemattrib - 1; 
+    // Comment: The element region marker is at the end of the list of
+    //   the element attributes.
+    int regioncount = 0;
+
+    // If has user-defined region attributes.
+    if (in->numberofregions > 0) {
+      // Spread region attributes.
+      for (i = 0; i < 5 * in->numberofregions; i += 5) {
+        if (regiontets[i/5].tet != NULL) {
+          attr = (int) in->regionlist[i + 3];
+          if (attr > maxattr) {
+            maxattr = attr;
+          }
+          volume = in->regionlist[i + 4];
+          tetarray->restart(); // Re-use this array.
+          infect(regiontets[i/5]);
+          tetarray->newindex((void **) &parytet);
+          *parytet = regiontets[i/5];
+          // Collect and set attrs for all tets of this region.
+          for (j = 0; j < tetarray->objects; j++) {
+            parytet = (triface *) fastlookup(tetarray, j);
+            tetloop = *parytet;
+            setelemattribute(tetloop.tet, attrnum, attr);
+            if (b->varvolume) { // If has -a option.
+              setvolumebound(tetloop.tet, volume);
+            }
+            for (k = 0; k < 4; k++) {
+              decode(tetloop.tet[k], neightet);
+              // Is the adjacent already checked?
+              if (!infected(neightet)) {
+                // Is this side protected by a subface?
+                if (!issubface(neightet)) {
+                  infect(neightet);
+                  tetarray->newindex((void **) &parytet);
+                  *parytet = neightet;
+                }
+              }
+            } // k
+          } // j
+          regioncount++;
+        } // if (regiontets[i/5].tet != NULL)
+      } // i
+    }
+
+    // Set attributes for all tetrahedra.
+    attr = maxattr + 1;
+    tetrahedrons->traversalinit();
+    tetloop.tet = tetrahedrontraverse();
+    while (tetloop.tet != (tetrahedron *) NULL) {
+      if (!infected(tetloop)) {
+        // An unmarked region.
+        tetarray->restart(); // Re-use this array.
+        infect(tetloop);
+        tetarray->newindex((void **) &parytet);
+        *parytet = tetloop;
+        // Find and mark all tets.
+        for (j = 0; j < tetarray->objects; j++) {
+          parytet = (triface *) fastlookup(tetarray, j);
+          tetloop = *parytet;
+          setelemattribute(tetloop.tet, attrnum, attr);
+          for (k = 0; k < 4; k++) {
+            decode(tetloop.tet[k], neightet);
+            // Is the adjacent tet already checked?
+            if (!infected(neightet)) {
+              // Is this side protected by a subface?
+              if (!issubface(neightet)) {
+                infect(neightet);
+                tetarray->newindex((void **) &parytet);
+                *parytet = neightet;
+              }
+            }
+          } // k
+        } // j
+        attr++; // Increase the attribute.
+        regioncount++;
       }
+      tetloop.tet = tetrahedrontraverse();
     }
-    subvertstack->restart();
-  }
+    // Until here, every tet has a region attribute.
 
+    // Uninfect processed tets.
+    tetrahedrons->traversalinit();
+    tetloop.tet = tetrahedrontraverse();
+    while (tetloop.tet != (tetrahedron *) NULL) {
+      uninfect(tetloop);
+      tetloop.tet = tetrahedrontraverse();
+    }
 
-  if (bdrysteinerptlist->objects > 0) {
     if (b->verbose) {
-      printf("  %ld Steiner points remained in boundary.\n",
-             bdrysteinerptlist->objects);
+      //assert(regioncount > 0);
+      if (regioncount > 1) {
+        printf("  Found %d subdomains.\n", regioncount);
+      } else {
+        printf("  Found %d domain.\n", regioncount);
+      }
     }
-  } // if
-
+  } // if (b->regionattrib)
 
-  // Accumulate the dynamic memory.
-  totalworkmemory += (misseglist->totalmemory + misshlist->totalmemory +
-                      bdrysteinerptlist->totalmemory);
+  if (regiontets != NULL) {
+    delete [] regiontets;
+  }
+  delete tetarray;
+  delete hullarray;
 
-  delete bdrysteinerptlist;
-  delete misseglist;
-  delete misshlist;
-}
+  if (!b->convex) { // No -c option
+    // The mesh is non-convex now.
+    nonconvex = 1;
 
-////                                                                       ////
-////                                                                       ////
-//// steiner_cxx //////////////////////////////////////////////////////////////
+    // Push all hull tets into 'flipstack'.
+    tetrahedrons->traversalinit();
+    tetloop.ver = 11; // The face opposite to dummypoint.
+    tetloop.tet = alltetrahedrontraverse();
+    while (tetloop.tet != (tetrahedron *) NULL) {
+      if ((point) tetloop.tet[7] == dummypoint) {
+        fsym(tetloop, neightet);
+        flippush(flipstack, &neightet);
+      }
+      tetloop.tet = alltetrahedrontraverse();
+    }
 
+    flipconstraints fc;
+    fc.enqflag = 2;
+    long sliver_peel_count = lawsonflip3d(&fc);
 
-//// reconstruct_cxx //////////////////////////////////////////////////////////
-////                                                                       ////
-////                                                                       ////
+    if (sliver_peel_count > 0l) {
+      if (b->verbose) {
+        printf("  Removed %ld hull slivers.\n", sliver_peel_count);
+      }
+    }
+    unflipqueue->restart();
+  } // if (!b->convex)
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// carveholes()    Remove tetrahedra not in the mesh domain.                 //
+// reconstructmesh()    Reconstruct a tetrahedral mesh.                      //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-
-void tetgenmesh::carveholes()
+void tetgenmesh::reconstructmesh()
 {
-  arraypool *tetarray, *hullarray;
-  triface tetloop, neightet, *parytet, *parytet1;
-  triface *regiontets = NULL;
-  face checksh, *parysh;
-  face checkseg;
-  point ptloop, *parypt;
+  tetrahedron *ver2tetarray;
+  point *idx2verlist;
+  triface tetloop, checktet, prevchktet;
+  triface hulltet, face1, face2;
+  tetrahedron tptr;
+  face subloop, neighsh, nextsh;
+  face segloop;
+  shellface sptr;
+  point p[4], q[3];
+  REAL ori, attrib, volume;
+  REAL cosang_tol, cosang;
+  REAL n1[3], n2[3];
+  int eextras, marker = 0;
+  int bondflag;
   int t1ver;
-  int i, j, k;
+  int idx, i, j, k;
 
   if (!b->quiet) {
-    if (b->convex) {
-      printf("Marking exterior tetrahedra ...\n");
-    } else {
-      printf("Removing exterior tetrahedra ...\n");
+    printf("Reconstructing mesh ...\n");
+  }
+
+  if (b->convex) { // -c option.
+    // Assume the mesh is convex. Exterior tets have region attribute -1.
+    if (!(in->numberoftetrahedronattributes > 0)) {
+      terminatetetgen(this, 2);
     }
+  } else {
+    // Assume the mesh is non-convex.
+    nonconvex = 1;
   }
 
-  // Initialize the pool of exterior tets.
-  tetarray = new arraypool(sizeof(triface), 10);
-  hullarray = new arraypool(sizeof(triface), 10);
+  // Create a map from indices to vertices. 
+  makeindex2pointmap(idx2verlist);
+  // 'idx2verlist' has length 'in->numberofpoints + 1'.
+  if (in->firstnumber == 1) {
+    idx2verlist[0] = dummypoint; // Let 0th-entry be dummypoint.
+  }
+
+  // Allocate an array that maps each vertex to its adjacent tets.
+  ver2tetarray = new tetrahedron[in->numberofpoints + 1];
+  //for (i = 0; i < in->numberofpoints + 1; i++) {
+  for (i = in->firstnumber; i < in->numberofpoints + in->firstnumber; i++) {
+    setpointtype(idx2verlist[i], VOLVERTEX); // initial type.
+    ver2tetarray[i] = NULL;
+  }
+
+  // Create the tetrahedra and connect those that share a common face.
+  for (i = 0; i < in->numberoftetrahedra; i++) {
+    // Get the four vertices.
+    idx = i * in->numberofcorners;
+    for (j = 0; j < 4; j++) {
+      p[j] = idx2verlist[in->tetrahedronlist[idx++]];
+    }
+    // Check the orientation.
+    ori = orient3d(p[0], p[1], p[2], p[3]);
+    if (ori > 0.0) {
+      // Swap the first two vertices.
+      q[0] = p[0]; p[0] = p[1]; p[1] = q[0];
+    } else if (ori == 0.0) {
+      if (!b->quiet) {
+        printf("Warning:  Tet #%d is degenerate.\n", i + in->firstnumber);
+      }
+    }
+    // Create a new tetrahedron.
+    maketetrahedron(&tetloop); // tetloop.ver = 11.
+    setvertices(tetloop, p[0], p[1], p[2], p[3]);
+    // Set element attributes if they exist.
+    for (j = 0; j < in->numberoftetrahedronattributes; j++) {
+      idx = i * in->numberoftetrahedronattributes;
+      attrib = in->tetrahedronattributelist[idx + j];
+      setelemattribute(tetloop.tet, j, attrib);
+    }
+    // If -a switch is used (with no number follows) Set a volume
+    //   constraint if it exists.
+    if (b->varvolume) {
+      if (in->tetrahedronvolumelist != (REAL *) NULL) {
+        volume = in->tetrahedronvolumelist[i];
+      } else {
+        volume = -1.0;
+      }
+      setvolumebound(tetloop.tet, volume);
+    }
+    // Try connecting this tet to others that share the common faces.
+    for (tetloop.ver = 0; tetloop.ver < 4; tetloop.ver++) {
+      p[3] = oppo(tetloop);
+      // Look for other tets having this vertex.
+      idx = pointmark(p[3]);
+      tptr = ver2tetarray[idx];
+      // Link the current tet to the next one in the stack.
+      tetloop.tet[8 + tetloop.ver] = tptr;
+      // Push the current tet onto the stack.
+      ver2tetarray[idx] = encode(tetloop);
+      decode(tptr, checktet);
+      if (checktet.tet != NULL) {
+        p[0] =  org(tetloop); // a
+        p[1] = dest(tetloop); // b
+        p[2] = apex(tetloop); // c
+        prevchktet = tetloop;
+        do {
+          q[0] =  org(checktet); // a'
+          q[1] = dest(checktet); // b'
+          q[2] = apex(checktet); // c'
+          // Check the three faces at 'd' in 'checktet'.
+          bondflag = 0;
+          for (j = 0; j < 3; j++) {
+            // Go to the face [b',a',d], or [c',b',d], or [a',c',d].
+            esym(checktet, face2);
+            if (face2.tet[face2.ver & 3] == NULL) {
+              k = ((j + 1) % 3);
+              if (q[k] == p[0]) {   // b', c', a' = a
+                if (q[j] == p[1]) { // a', b', c' = b
+                  // [#,#,d] is matched to [b,a,d].
+                  esym(tetloop, face1);
+                  bond(face1, face2);
+                  bondflag++;
+                }
+              }
+              if (q[k] == p[1]) {   // b',c',a' = b
+                if (q[j] == p[2]) { // a',b',c' = c
+                  // [#,#,d] is matched to [c,b,d].
+                  enext(tetloop, face1);
+                  esymself(face1);
+                  bond(face1, face2);
+                  bondflag++;
+                }
+              }
+              if (q[k] == p[2]) {   // b',c',a' = c
+                if (q[j] == p[0]) { // a',b',c' = a
+                  // [#,#,d] is matched to [a,c,d].
+                  eprev(tetloop, face1);
+                  esymself(face1);
+                  bond(face1, face2);
+                  bondflag++;
+                }
+              }
+            } else {
+              bondflag++;
+            }
+            enextself(checktet);
+          } // j
+          // Go to the next tet in the link.
+          tptr = checktet.tet[8 + checktet.ver];
+          if (bondflag == 3) {
+            // All three faces at d in 'checktet' have been connected.
+            // It can be removed from the link.            
+            prevchktet.tet[8 + prevchktet.ver] = tptr;
+          } else {
+            // Bakup the previous tet in the link.
+            prevchktet = checktet;
+          }
+          decode(tptr, checktet);
+        } while (checktet.tet != NULL);
+      } // if (checktet.tet != NULL)
+    } // for (tetloop.ver = 0; ...
+  } // i
+
+  // Remember a tet of the mesh.
+  recenttet = tetloop;
+
+  // Create hull tets, create the point-to-tet map, and clean up the
+  //   temporary spaces used in each tet. 
+  hullsize = tetrahedrons->items;
 
-  // Collect unprotected tets and hull tets.
   tetrahedrons->traversalinit();
-  tetloop.ver = 11; // The face opposite to dummypoint.
-  tetloop.tet = alltetrahedrontraverse();
+  tetloop.tet = tetrahedrontraverse();
   while (tetloop.tet != (tetrahedron *) NULL) {
-    if (ishulltet(tetloop)) {
-      // Is this side protected by a subface?
-      if (!issubface(tetloop)) {
-        // Collect an unprotected hull tet and tet.
-        infect(tetloop);
-        hullarray->newindex((void **) &parytet);
-        *parytet = tetloop;
-        // tetloop's face number is 11 & 3 = 3.
-        decode(tetloop.tet[3], neightet);
-        if (!infected(neightet)) {
-          infect(neightet);
-          tetarray->newindex((void **) &parytet);
-          *parytet = neightet;
+    tptr = encode(tetloop);
+    for (tetloop.ver = 0; tetloop.ver < 4; tetloop.ver++) {
+      if (tetloop.tet[tetloop.ver] == NULL) {
+        // Create a hull tet.
+        maketetrahedron(&hulltet);
+        p[0] =  org(tetloop);
+        p[1] = dest(tetloop);
+        p[2] = apex(tetloop);
+        setvertices(hulltet, p[1], p[0], p[2], dummypoint);
+        bond(tetloop, hulltet);
+        // Try connecting this to others that share common hull edges.
+        for (j = 0; j < 3; j++) {
+          fsym(hulltet, face2);
+          while (1) {
+            if (face2.tet == NULL) break;
+            esymself(face2);
+            if (apex(face2) == dummypoint) break;
+            fsymself(face2);
+          }
+          if (face2.tet != NULL) {
+            // Found an adjacent hull tet.
+            esym(hulltet, face1);
+            bond(face1, face2);
+          }
+          enextself(hulltet);
+        }
+      }
+      // Create the point-to-tet map.
+      setpoint2tet((point) (tetloop.tet[4 + tetloop.ver]), tptr);
+      // Clean the temporary used space.
+      tetloop.tet[8 + tetloop.ver] = NULL;
+    }
+    tetloop.tet = tetrahedrontraverse();
+  }
+
+  hullsize = tetrahedrons->items - hullsize;
+
+  // Subfaces will be inserted into the mesh. 
+  if (in->trifacelist != NULL) {
+    // A .face file is given. It may contain boundary faces. Insert them.
+    for (i = 0; i < in->numberoftrifaces; i++) {
+      // Is it a subface?
+      if (in->trifacemarkerlist != NULL) {
+        marker = in->trifacemarkerlist[i];
+      } else {
+        // Face markers are not available. Assume all of them are subfaces.
+        marker = -1; // The default marker.
+      }
+      if (marker != 0) {
+        idx = i * 3;
+        for (j = 0; j < 3; j++) {
+          p[j] = idx2verlist[in->trifacelist[idx++]];
+        }
+        // Search the subface.
+        bondflag = 0;
+        neighsh.sh = NULL;
+        // Make sure all vertices are in the mesh. Avoid crash.
+        for (j = 0; j < 3; j++) {
+          decode(point2tet(p[j]), checktet);
+          if (checktet.tet == NULL) break;
         }
-      }
-    }
-    tetloop.tet = alltetrahedrontraverse();
-  }
-
-  if (in->numberofholes > 0) {
-    // Mark as infected any tets inside volume holes.
-    for (i = 0; i < 3 * in->numberofholes; i += 3) {
-      // Search a tet containing the i-th hole point.
-      neightet.tet = NULL;
-      randomsample(&(in->holelist[i]), &neightet);
-      if (locate(&(in->holelist[i]), &neightet) != OUTSIDE) {
-        // The tet 'neightet' contain this point.
-        if (!infected(neightet)) {
-          infect(neightet);
-          tetarray->newindex((void **) &parytet);
-          *parytet = neightet;
-          // Add its adjacent tet if it is not protected.
-          if (!issubface(neightet)) {
-            decode(neightet.tet[neightet.ver & 3], tetloop);
-            if (!infected(tetloop)) {
-              infect(tetloop);
-              if (ishulltet(tetloop)) {
-                hullarray->newindex((void **) &parytet);
+        if ((j == 3) && getedge(p[0], p[1], &checktet)) {
+          tetloop = checktet;
+          q[2] = apex(checktet);
+          while (1) {
+            if (apex(tetloop) == p[2]) {
+              // Found the face.
+              // Check if there exist a subface already?
+              tspivot(tetloop, neighsh); 
+              if (neighsh.sh != NULL) {
+                // Found a duplicated subface. 
+                // This happens when the mesh was generated by other mesher.
+                bondflag = 0;
               } else {
-                tetarray->newindex((void **) &parytet);
+                bondflag = 1;
               }
-              *parytet = tetloop;
+              break;
             }
+            fnextself(tetloop);
+            if (apex(tetloop) == q[2]) break;
           }
-          else {
-            // It is protected. Check if its adjacent tet is a hull tet.
-            decode(neightet.tet[neightet.ver & 3], tetloop);
-            if (ishulltet(tetloop)) {
-              // It is hull tet, add it into the list. Moreover, the subface
-              //   is dead, i.e., both sides are in exterior.
-              if (!infected(tetloop)) {
-                infect(tetloop);
-                hullarray->newindex((void **) &parytet);
-                *parytet = tetloop;
-              }
-            }
-            if (infected(tetloop)) {
-              // Both sides of this subface are in exterior.
-              tspivot(neightet, checksh);
-              sinfect(checksh); // Only queue it once.
-              subfacstack->newindex((void **) &parysh);
-              *parysh = checksh;
+        }
+        if (bondflag) {
+          // Create a new subface.
+          makeshellface(subfaces, &subloop);
+          setshvertices(subloop, p[0], p[1], p[2]);
+          // Create the point-to-subface map.
+          sptr = sencode(subloop);
+          for (j = 0; j < 3; j++) {
+            setpointtype(p[j], FACETVERTEX); // initial type.
+            setpoint2sh(p[j], sptr);
+          }
+          setshellmark(subloop, marker);
+          // Insert the subface into the mesh.
+          tsbond(tetloop, subloop);
+          fsymself(tetloop);
+          sesymself(subloop);
+          tsbond(tetloop, subloop);
+        } else {
+          if (neighsh.sh != NULL) {
+            // The subface already exists. Only set its mark.
+            setshellmark(neighsh, marker);
+          } else {
+            if (!b->quiet) {
+              if (neighsh.sh == NULL) {
+                printf("Warning:  Subface #%d [%d,%d,%d] is missing.\n", 
+                       i + in->firstnumber, pointmark(p[0]), pointmark(p[1]),
+                       pointmark(p[2]));
+              } 
             }
           }
-        } // if (!infected(neightet))
-      } else {
-        // A hole point locates outside of the convex hull.
-        if (!b->quiet) {
-          printf("Warning:  The %d-th hole point ", i/3 + 1);
-          printf("lies outside the convex hull.\n");
-        }
-      }
+        } // if (bondflag)
+      } // if (marker != 0)
     } // i
-  } // if (in->numberofholes > 0)
-
-  if (b->regionattrib && (in->numberofregions > 0)) { // -A option.
-    // Record the tetrahedra that contains the region points for assigning
-    //   region attributes after the holes have been carved.
-    regiontets = new triface[in->numberofregions];
-    // Mark as marktested any tetrahedra inside volume regions.
-    for (i = 0; i < 5 * in->numberofregions; i += 5) {
-      // Search a tet containing the i-th region point.
-      neightet.tet = NULL;
-      randomsample(&(in->regionlist[i]), &neightet);
-      if (locate(&(in->regionlist[i]), &neightet) != OUTSIDE) {
-        regiontets[i/5] = neightet;
-      } else {
-        if (!b->quiet) {
-          printf("Warning:  The %d-th region point ", i/5+1);
-          printf("lies outside the convex hull.\n");
-        }
-        regiontets[i/5].tet = NULL;
-      }
-    }
-  }
+  } // if (in->trifacelist)
 
-  // Collect all exterior tets (in concave place and in holes).
-  for (i = 0; i < tetarray->objects; i++) {
-    parytet = (triface *) fastlookup(tetarray, i);
-    j = (parytet->ver & 3); // j is the current face number.
-    // Check the other three adjacent tets.
-    for (k = 1; k < 4; k++) {
-      decode(parytet->tet[(j + k) % 4], neightet); 
-      // neightet may be a hull tet.
-      if (!infected(neightet)) {
-        // Is neightet protected by a subface.
-        if (!issubface(neightet)) {
-          // Not proected. Collect it. (It must not be a hull tet).
-          infect(neightet);
-          tetarray->newindex((void **) &parytet1);
-          *parytet1 = neightet;
+  // Indentify subfaces from the mesh.
+  // Create subfaces for hull faces (if they're not subface yet) and
+  //   interior faces which separate two different materials.
+  eextras = in->numberoftetrahedronattributes;
+  tetrahedrons->traversalinit();
+  tetloop.tet = tetrahedrontraverse();
+  while (tetloop.tet != (tetrahedron *) NULL) {
+    for (tetloop.ver = 0; tetloop.ver < 4; tetloop.ver++) {
+      tspivot(tetloop, neighsh);
+      if (neighsh.sh == NULL) {
+        bondflag = 0;
+        fsym(tetloop, checktet);
+        if (ishulltet(checktet)) {
+          // A hull face.
+          if (!b->convex) {
+            bondflag = 1;  // Insert a hull subface.
+          }
         } else {
-          // Protected. Check if it is a hull tet.
-          if (ishulltet(neightet)) {
-            // A hull tet. Collect it.
-            infect(neightet);
-            hullarray->newindex((void **) &parytet1);
-            *parytet1 = neightet;
-            // Both sides of this subface are exterior.
-            tspivot(neightet, checksh);
-            // Queue this subface (to be deleted later).
-            sinfect(checksh); // Only queue it once.
-            subfacstack->newindex((void **) &parysh);
-            *parysh = checksh;
+          if (eextras > 0) {
+            if (elemattribute(tetloop.tet, eextras - 1) !=
+                elemattribute(checktet.tet, eextras - 1)) {
+              bondflag = 1; // Insert an interior interface.
+            }
           }
         }
-      } else {
-        // Both sides of this face are in exterior.
-        // If there is a subface. It should be collected.
-        if (issubface(neightet)) {
-          tspivot(neightet, checksh);
-          if (!sinfected(checksh)) {
-            sinfect(checksh);
-            subfacstack->newindex((void **) &parysh);
-            *parysh = checksh;
+        if (bondflag) {
+          // Create a new subface.
+          makeshellface(subfaces, &subloop);
+          p[0] = org(tetloop);
+          p[1] = dest(tetloop);
+          p[2] = apex(tetloop);
+          setshvertices(subloop, p[0], p[1], p[2]);
+          // Create the point-to-subface map.
+          sptr = sencode(subloop);
+          for (j = 0; j < 3; j++) {
+            setpointtype(p[j], FACETVERTEX); // initial type.
+            setpoint2sh(p[j], sptr);
           }
-        }
-      }
-    } // j, k
-  } // i
-
-  if (b->regionattrib && (in->numberofregions > 0)) {
-    // Re-check saved region tets to see if they lie outside.
-    for (i = 0; i < in->numberofregions; i++) {
-      if (infected(regiontets[i])) {
-        if (b->verbose) {
-          printf("Warning:  The %d-th region point ", i+1);
-          printf("lies in the exterior of the domain.\n");
-        }
-        regiontets[i].tet = NULL;
-      }
+          setshellmark(subloop, -1); // Default marker.
+          // Insert the subface into the mesh.
+          tsbond(tetloop, subloop);
+          sesymself(subloop);
+          tsbond(checktet, subloop);
+        } // if (bondflag)
+      } // if (neighsh.sh == NULL)
     }
+    tetloop.tet = tetrahedrontraverse();
   }
 
-  // Collect vertices which point to infected tets. These vertices
-  //   may get deleted after the removal of exterior tets.
-  //   If -Y1 option is used, collect all Steiner points for removal.
-  //   The lists 'cavetetvertlist' and 'subvertstack' are re-used.
-  points->traversalinit();
-  ptloop = pointtraverse();
-  while (ptloop != NULL) {
-    if ((pointtype(ptloop) != UNUSEDVERTEX) &&
-        (pointtype(ptloop) != DUPLICATEDVERTEX)) {
-      decode(point2tet(ptloop), neightet);
-      if (infected(neightet)) {
-        cavetetvertlist->newindex((void **) &parypt);
-        *parypt = ptloop;
-      }
-      if (b->nobisect && (b->supsteiner_level > 0)) { // -Y/1
-        // Queue it if it is a Steiner point.
-        if (pointmark(ptloop) > 
-              (in->numberofpoints - (in->firstnumber ? 0 : 1))) {
-          subvertstack->newindex((void **) &parypt);
-          *parypt = ptloop;
-        }
-      }
+  // Connect subfaces together. 
+  subfaces->traversalinit();
+  subloop.shver = 0;
+  subloop.sh = shellfacetraverse(subfaces);
+  while (subloop.sh != (shellface *) NULL) {
+    for (i = 0; i < 3; i++) {
+      spivot(subloop, neighsh);
+      if (neighsh.sh == NULL) {
+        // Form a subface ring by linking all subfaces at this edge.
+        // Traversing all faces of the tets at this edge.
+        stpivot(subloop, tetloop);
+        q[2] = apex(tetloop);
+        neighsh = subloop;
+        while (1) {
+          fnextself(tetloop);
+          tspivot(tetloop, nextsh);
+          if (nextsh.sh != NULL) {
+            // Do not connect itself.
+            if (nextsh.sh != neighsh.sh) {
+              // Link neighsh <= nextsh.
+              sbond1(neighsh, nextsh);
+              neighsh = nextsh;
+            }
+          }
+          if (apex(tetloop) == q[2]) {
+            break;
+          }
+        } // while (1)
+      } // if (neighsh.sh == NULL)
+      senextself(subloop);
     }
-    ptloop = pointtraverse();
+    subloop.sh = shellfacetraverse(subfaces);
   }
 
-  if (!b->convex && (tetarray->objects > 0l)) { // No -c option.
-    // Remove exterior tets. Hull tets are updated.
-    arraypool *newhullfacearray;
-    triface hulltet, casface;
-    face segloop, *paryseg;
-    point pa, pb, pc;
-    long delsegcount = 0l;
- 
-    // Collect segments which point to infected tets. Some segments
-    //   may get deleted after the removal of exterior tets.
-    subsegs->traversalinit();
-    segloop.sh = shellfacetraverse(subsegs);
-    while (segloop.sh != NULL) {
-      sstpivot1(segloop, neightet);
-      if (infected(neightet)) {
-        subsegstack->newindex((void **) &paryseg);
-        *paryseg = segloop;
-      }
-      segloop.sh = shellfacetraverse(subsegs);
-    }
-
-    newhullfacearray = new arraypool(sizeof(triface), 10);
 
-    // Create and save new hull tets.
-    for (i = 0; i < tetarray->objects; i++) {
-      parytet = (triface *) fastlookup(tetarray, i);
-      for (j = 0; j < 4; j++) {
-        decode(parytet->tet[j], tetloop);
-        if (!infected(tetloop)) {
-          // Found a new hull face (must be a subface).
-          tspivot(tetloop, checksh);
-          maketetrahedron(&hulltet);
-          pa = org(tetloop);
-          pb = dest(tetloop);
-          pc = apex(tetloop);
-          setvertices(hulltet, pb, pa, pc, dummypoint);
-          bond(tetloop, hulltet);
-          // Update the subface-to-tet map.
-          sesymself(checksh);
-          tsbond(hulltet, checksh);
-          // Update the segment-to-tet map.
-          for (k = 0; k < 3; k++) {
-            if (issubseg(tetloop)) {
-              tsspivot1(tetloop, checkseg);
-              tssbond1(hulltet, checkseg);
-              sstbond1(checkseg, hulltet);
-            }
-            enextself(tetloop);
-            eprevself(hulltet);
+  // Segments will be introduced. 
+  if (in->edgelist != NULL) {
+    // A .edge file is given. It may contain boundary edges. Insert them.
+    for (i = 0; i < in->numberofedges; i++) {
+      // Is it a segment?
+      if (in->edgemarkerlist != NULL) {
+        marker = in->edgemarkerlist[i];
+      } else {
+        // Edge markers are not available. Assume all of them are segments.
+        marker = -1; // Default marker.
+      }
+      if (marker != 0) { 
+        // Insert a segment.
+        idx = i * 2;
+        for (j = 0; j < 2; j++) {
+          p[j] = idx2verlist[in->edgelist[idx++]];
+        }
+        // Make sure all vertices are in the mesh. Avoid crash.
+        for (j = 0; j < 2; j++) {
+          decode(point2tet(p[j]), checktet);
+          if (checktet.tet == NULL) break;
+        }
+        // Search the segment.
+        if ((j == 2) && getedge(p[0], p[1], &checktet)) {
+          // Create a new segment.
+          makeshellface(subsegs, &segloop);
+          setshvertices(segloop, p[0], p[1], NULL);
+          // Create the point-to-segment map.
+          sptr = sencode(segloop);
+          for (j = 0; j < 2; j++) {
+            setpointtype(p[j], RIDGEVERTEX); // initial type.
+            setpoint2sh(p[j], sptr);
           }
-          // Update the point-to-tet map.
-          setpoint2tet(pa, (tetrahedron) tetloop.tet);
-          setpoint2tet(pb, (tetrahedron) tetloop.tet);
-          setpoint2tet(pc, (tetrahedron) tetloop.tet);
-          // Save the exterior tet at this hull face. It still holds pointer
-          //   to the adjacent interior tet. Use it to connect new hull tets. 
-          newhullfacearray->newindex((void **) &parytet1);
-          parytet1->tet = parytet->tet;
-          parytet1->ver = j;
-        } // if (!infected(tetloop))
-      } // j
-    } // i
-
-    // Connect new hull tets.
-    for (i = 0; i < newhullfacearray->objects; i++) {
-      parytet = (triface *) fastlookup(newhullfacearray, i);
-      fsym(*parytet, neightet);
-      // Get the new hull tet.
-      fsym(neightet, hulltet);
-      for (j = 0; j < 3; j++) {
-        esym(hulltet, casface);
-        if (casface.tet[casface.ver & 3] == NULL) {
-          // Since the boundary of the domain may not be a manifold, we
-          //   find the adjacent hull face by traversing the tets in the
-          //   exterior (which are all infected tets).
-          neightet = *parytet;
+          setshellmark(segloop, marker);
+          // Insert the segment into the mesh.
+          tetloop = checktet;
+          q[2] = apex(checktet);
+          subloop.sh = NULL;
           while (1) {
-            fnextself(neightet);
-            if (!infected(neightet)) break;
+            tssbond1(tetloop, segloop);
+            tspivot(tetloop, subloop);
+            if (subloop.sh != NULL) {
+              ssbond1(subloop, segloop);
+              sbond1(segloop, subloop);
+            }
+            fnextself(tetloop);
+            if (apex(tetloop) == q[2]) break;
+          } // while (1)
+          // Remember an adjacent tet for this segment.
+          sstbond1(segloop, tetloop);
+        } else {
+          if (!b->quiet) {
+            printf("Warning:  Segment #%d [%d,%d] is missing.\n", 
+                   i + in->firstnumber, pointmark(p[0]), pointmark(p[1]));
           }
-          if (!ishulltet(neightet)) {
-            // An interior tet. Get the new hull tet.
-            fsymself(neightet);
-            esymself(neightet);
-          } 
-          // Bond them together.
-          bond(casface, neightet);
         }
-        enextself(hulltet);
-        enextself(*parytet);
-      } // j
+      } // if (marker != 0)
     } // i
+  } // if (in->edgelist)
 
-    if (subfacstack->objects > 0l) {
-      // Remove all subfaces which do not attach to any tetrahedron.
-      //   Segments which are not attached to any subfaces and tets
-      //   are deleted too.
-      face casingout, casingin;
-
-      for (i = 0; i < subfacstack->objects; i++) {
-        parysh = (face *) fastlookup(subfacstack, i);
-        if (i == 0) {
-          if (b->verbose) {
-            printf("Warning:  Removed an exterior face (%d, %d, %d) #%d\n",
-                   pointmark(sorg(*parysh)), pointmark(sdest(*parysh)),
-                   pointmark(sapex(*parysh)), shellmark(*parysh));
-          }
+  // Identify segments from the mesh. 
+  // Create segments for non-manifold edges (which are shared by more 
+  //   than two subfaces), and for non-coplanar edges, i.e., two subfaces
+  //   form an dihedral angle > 'b->facet_separate_ang_tol' (degree).
+  cosang_tol = cos(b->facet_separate_ang_tol / 180.0 * PI);
+  subfaces->traversalinit();
+  subloop.shver = 0;
+  subloop.sh = shellfacetraverse(subfaces);
+  while (subloop.sh != (shellface *) NULL) {
+    for (i = 0; i < 3; i++) {
+      sspivot(subloop, segloop);
+      if (segloop.sh == NULL) {
+        // Check if this edge is a segment.
+        bondflag = 0;
+        // Counter the number of subfaces at this edge.
+        idx = 0;
+        nextsh = subloop;
+        while (1) {
+          idx++;
+          spivotself(nextsh);
+          if (nextsh.sh == subloop.sh) break;
         }
-        // Dissolve this subface from face links.
-        for (j = 0; j < 3; j++) {         
-          spivot(*parysh, casingout);
-          sspivot(*parysh, checkseg);
-          if (casingout.sh != NULL) {
-            casingin = casingout;
-            while (1) {
-              spivot(casingin, checksh);
-              if (checksh.sh == parysh->sh) break;
-              casingin = checksh;
-            }
-            if (casingin.sh != casingout.sh) {
-              // Update the link: ... -> casingin -> casingout ->...
-              sbond1(casingin, casingout);
-            } else {
-              // Only one subface at this edge is left.
-              sdissolve(casingout);
-            }
-            if (checkseg.sh != NULL) {
-              // Make sure the segment does not connect to a dead one.
-              ssbond(casingout, checkseg);
-            }
+        if (idx != 2) {
+          // It's a non-manifold edge. Insert a segment.
+          p[0] = sorg(subloop);
+          p[1] = sdest(subloop);
+          bondflag = 1;
+        } else {
+          spivot(subloop, neighsh);
+          if (shellmark(subloop) != shellmark(neighsh)) {
+            // It's an interior interface. Insert a segment.
+            p[0] = sorg(subloop);
+            p[1] = sdest(subloop);
+            bondflag = 1;
           } else {
-            if (checkseg.sh != NULL) {
-              //if (checkseg.sh[3] != NULL) {
-              if (delsegcount == 0) {
-                if (b->verbose) {
-                  printf("Warning:  Removed an exterior segment (%d, %d) #%d\n",
-                         pointmark(sorg(checkseg)), pointmark(sdest(checkseg)),
-                         shellmark(checkseg));
-                }
-              }
-              shellfacedealloc(subsegs, checkseg.sh);
-              delsegcount++;
-            }
-          }
-          senextself(*parysh);
-        } // j
-        // Delete this subface.
-        shellfacedealloc(subfaces, parysh->sh);
-      } // i
-      if (b->verbose) {
-        printf("  Deleted %ld subfaces.\n", subfacstack->objects);
-      }
-      subfacstack->restart();
-    } // if (subfacstack->objects > 0l)
-
-    if (subsegstack->objects > 0l) {
-      for (i = 0; i < subsegstack->objects; i++) {
-        paryseg = (face *) fastlookup(subsegstack, i);
-        if (paryseg->sh && (paryseg->sh[3] != NULL)) {
-          sstpivot1(*paryseg, neightet);
-          if (infected(neightet)) {
-            if (b->verbose) {
-              printf("Warning:  Removed an exterior segment (%d, %d) #%d\n",
-                     pointmark(sorg(*paryseg)), pointmark(sdest(*paryseg)),
-                     shellmark(*paryseg));
+            if (!b->convex) {
+              // Check the dihedral angle formed by the two subfaces.
+              p[0] = sorg(subloop);
+              p[1] = sdest(subloop);
+              p[2] = sapex(subloop);
+              p[3] = sapex(neighsh);
+              facenormal(p[0], p[1], p[2], n1, 1, NULL);
+              facenormal(p[0], p[1], p[3], n2, 1, NULL);
+              cosang = dot(n1, n2) / (sqrt(dot(n1, n1)) * sqrt(dot(n2, n2)));
+              // Rounding.
+              if (cosang > 1.0) cosang = 1.0;
+              else if (cosang < -1.0) cosang = -1.0;  
+              if (cosang > cosang_tol) {
+                bondflag = 1;
+              }
             }
-            shellfacedealloc(subsegs, paryseg->sh);
-            delsegcount++;
           }
         }
-      }
-      subsegstack->restart();
-    } // if (subsegstack->objects > 0l)
-
-    if (delsegcount > 0) {
-      if (b->verbose) {
-        printf("  Deleted %ld segments.\n", delsegcount);
-      }
-    }
-
-    if (cavetetvertlist->objects > 0l) {
-      // Some vertices may lie in exterior. Marke them as UNUSEDVERTEX.
-      long delvertcount = unuverts;
-      long delsteinercount = 0l;
-
-      for (i = 0; i < cavetetvertlist->objects; i++) {
-        parypt = (point *) fastlookup(cavetetvertlist, i);
-        decode(point2tet(*parypt), neightet);
-        if (infected(neightet)) {
-          // Found an exterior vertex.
-          if (pointmark(*parypt) > 
-                (in->numberofpoints - (in->firstnumber ? 0 : 1))) {
-            // A Steiner point.
-            if (pointtype(*parypt) == FREESEGVERTEX) {
-              st_segref_count--;
-            } else if (pointtype(*parypt) == FREEFACETVERTEX) {
-              st_facref_count--;
-            } else {
-              st_volref_count--;
-            }
-            delsteinercount++;
-            if (steinerleft > 0) steinerleft++;
+        if (bondflag) {
+          // Create a new segment.
+          makeshellface(subsegs, &segloop);
+          setshvertices(segloop, p[0], p[1], NULL);
+          // Create the point-to-segment map.
+          sptr = sencode(segloop);
+          for (j = 0; j < 2; j++) {
+            setpointtype(p[j], RIDGEVERTEX); // initial type.
+            setpoint2sh(p[j], sptr);
           }
-          setpointtype(*parypt, UNUSEDVERTEX);
-          unuverts++;
-        }
-      }
-
-      if (b->verbose) {
-        if (unuverts > delvertcount) {
-          if (delsteinercount > 0l) {
-            if (unuverts > (delvertcount + delsteinercount)) {
-              printf("  Removed %ld exterior input vertices.\n", 
-                     unuverts - delvertcount - delsteinercount);
+          setshellmark(segloop, -1); // Default marker.
+          // Insert the subface into the mesh.
+          stpivot(subloop, tetloop);
+          q[2] = apex(tetloop);
+          while (1) {
+            tssbond1(tetloop, segloop);
+            tspivot(tetloop, neighsh);
+            if (neighsh.sh != NULL) {
+              ssbond1(neighsh, segloop);
             }
-            printf("  Removed %ld exterior Steiner vertices.\n", 
-                   delsteinercount);
-          } else {
-            printf("  Removed %ld exterior input vertices.\n", 
-                   unuverts - delvertcount);
-          }
-        }
-      }
-      cavetetvertlist->restart();
-      // Comment: 'subvertstack' will be cleaned in routine
-      //   suppresssteinerpoints().
-    } // if (cavetetvertlist->objects > 0l)
-
-    // Update the hull size.
-    hullsize += (newhullfacearray->objects - hullarray->objects);
-
-    // Delete all exterior tets and old hull tets.
-    for (i = 0; i < tetarray->objects; i++) {
-      parytet = (triface *) fastlookup(tetarray, i);
-      tetrahedrondealloc(parytet->tet);
-    }
-    tetarray->restart();
-
-    for (i = 0; i < hullarray->objects; i++) {
-      parytet = (triface *) fastlookup(hullarray, i);
-      tetrahedrondealloc(parytet->tet);
-    }
-    hullarray->restart();
-
-    delete newhullfacearray;
-  } // if (!b->convex && (tetarray->objects > 0l))
-
-  if (b->convex && (tetarray->objects > 0l)) { // With -c option
-    // In this case, all exterior tets get a region marker '-1'.
-    int attrnum = numelemattrib - 1;
-
-    for (i = 0; i < tetarray->objects; i++) {
-      parytet = (triface *) fastlookup(tetarray, i);
-      setelemattribute(parytet->tet, attrnum, -1);
-    }
-    tetarray->restart();
-
-    for (i = 0; i < hullarray->objects; i++) {
-      parytet = (triface *) fastlookup(hullarray, i);
-      uninfect(*parytet);
-    }
-    hullarray->restart();
-
-    if (subfacstack->objects > 0l) {
-      for (i = 0; i < subfacstack->objects; i++) {
-        parysh = (face *) fastlookup(subfacstack, i);
-        suninfect(*parysh);
-      }
-      subfacstack->restart();
-    }
+            fnextself(tetloop);
+            if (apex(tetloop) == q[2]) break;
+          } // while (1)
+          // Remember an adjacent tet for this segment.
+          sstbond1(segloop, tetloop);
+          sbond1(segloop, subloop);
+        } // if (bondflag)
+      } // if (neighsh.sh == NULL)
+      senextself(subloop);
+    } // i
+    subloop.sh = shellfacetraverse(subfaces);
+  }
 
-    if (cavetetvertlist->objects > 0l) {
-      cavetetvertlist->restart();
-    }
-  } // if (b->convex && (tetarray->objects > 0l))
+  // Remember the number of input segments.
+  insegments = subsegs->items;
 
-  if (b->regionattrib) { // With -A option.
-    if (!b->quiet) {
-      printf("Spreading region attributes.\n");
-    }
-    REAL volume;
-    int attr, maxattr = 0; // Choose a small number here.
-    int attrnum = numelemattrib - 1; 
-    // Comment: The element region marker is at the end of the list of
-    //   the element attributes.
-    int regioncount = 0;
+  if (!b->nobisect || checkconstraints) {
+    // Mark Steiner points on segments and facets.
+    //   - all vertices which remaining type FEACTVERTEX become
+    //     Steiner points in facets (= FREEFACERVERTEX).
+    //   - vertices on segment need to be checked.
+    face* segperverlist;
+    int* idx2seglist;
+    face parentseg, nextseg;
+    verttype vt;
+    REAL area, len, l1, l2;
+    int fmarker;
 
-    // If has user-defined region attributes.
-    if (in->numberofregions > 0) {
-      // Spread region attributes.
-      for (i = 0; i < 5 * in->numberofregions; i += 5) {
-        if (regiontets[i/5].tet != NULL) {
-          attr = (int) in->regionlist[i + 3];
-          if (attr > maxattr) {
-            maxattr = attr;
-          }
-          volume = in->regionlist[i + 4];
-          tetarray->restart(); // Re-use this array.
-          infect(regiontets[i/5]);
-          tetarray->newindex((void **) &parytet);
-          *parytet = regiontets[i/5];
-          // Collect and set attrs for all tets of this region.
-          for (j = 0; j < tetarray->objects; j++) {
-            parytet = (triface *) fastlookup(tetarray, j);
-            tetloop = *parytet;
-            setelemattribute(tetloop.tet, attrnum, attr);
-            if (b->varvolume) { // If has -a option.
-              setvolumebound(tetloop.tet, volume);
-            }
-            for (k = 0; k < 4; k++) {
-              decode(tetloop.tet[k], neightet);
-              // Is the adjacent already checked?
-              if (!infected(neightet)) {
-                // Is this side protected by a subface?
-                if (!issubface(neightet)) {
-                  infect(neightet);
-                  tetarray->newindex((void **) &parytet);
-                  *parytet = neightet;
-                }
-              }
-            } // k
-          } // j
-          regioncount++;
-        } // if (regiontets[i/5].tet != NULL)
-      } // i
-    }
+    makepoint2submap(subsegs, idx2seglist, segperverlist);
 
-    // Set attributes for all tetrahedra.
-    attr = maxattr + 1;
-    tetrahedrons->traversalinit();
-    tetloop.tet = tetrahedrontraverse();
-    while (tetloop.tet != (tetrahedron *) NULL) {
-      if (!infected(tetloop)) {
-        // An unmarked region.
-        tetarray->restart(); // Re-use this array.
-        infect(tetloop);
-        tetarray->newindex((void **) &parytet);
-        *parytet = tetloop;
-        // Find and mark all tets.
-        for (j = 0; j < tetarray->objects; j++) {
-          parytet = (triface *) fastlookup(tetarray, j);
-          tetloop = *parytet;
-          setelemattribute(tetloop.tet, attrnum, attr);
-          for (k = 0; k < 4; k++) {
-            decode(tetloop.tet[k], neightet);
-            // Is the adjacent tet already checked?
-            if (!infected(neightet)) {
-              // Is this side protected by a subface?
-              if (!issubface(neightet)) {
-                infect(neightet);
-                tetarray->newindex((void **) &parytet);
-                *parytet = neightet;
-              }
-            }
-          } // k
-        } // j
-        attr++; // Increase the attribute.
-        regioncount++;
+    points->traversalinit();
+    point ptloop = pointtraverse();
+    while (ptloop != NULL) {
+      vt = pointtype(ptloop);
+      if (vt == VOLVERTEX) {
+        setpointtype(ptloop, FREEVOLVERTEX);
+        st_volref_count++;
+      } else if (vt == FACETVERTEX) {
+        setpointtype(ptloop, FREEFACETVERTEX);
+        st_facref_count++;
+      } else if (vt == RIDGEVERTEX) {
+        idx = pointmark(ptloop) - in->firstnumber;
+        if ((idx2seglist[idx + 1] - idx2seglist[idx]) == 2) {
+          i = idx2seglist[idx];
+          parentseg = segperverlist[i];
+          nextseg = segperverlist[i + 1];
+          sesymself(nextseg);
+          p[0] = sorg(nextseg);
+          p[1] = sdest(parentseg);
+          // Check if three points p[0], ptloop, p[2] are (nearly) collinear.
+          len = distance(p[0], p[1]);
+          l1 = distance(p[0], ptloop);
+          l2 = distance(ptloop, p[1]);
+          if (((l1 + l2 - len) / len) < b->epsilon) {
+            // They are (nearly) collinear.
+            setpointtype(ptloop, FREESEGVERTEX);
+            // Connect nextseg and parentseg together at ptloop.
+            senextself(nextseg);
+            senext2self(parentseg);
+            sbond(nextseg, parentseg);
+            st_segref_count++;
+          }
+        }
       }
-      tetloop.tet = tetrahedrontraverse();
+      ptloop = pointtraverse();
     }
-    // Until here, every tet has a region attribute.
 
-    // Uninfect processed tets.
-    tetrahedrons->traversalinit();
-    tetloop.tet = tetrahedrontraverse();
-    while (tetloop.tet != (tetrahedron *) NULL) {
-      uninfect(tetloop);
-      tetloop.tet = tetrahedrontraverse();
+    // Are there area constraints?
+    if (b->quality && (in->facetconstraintlist != (REAL *) NULL)) {
+      // Set maximum area constraints on facets.
+      for (i = 0; i < in->numberoffacetconstraints; i++) {
+        fmarker = (int) in->facetconstraintlist[i * 2];
+        area = in->facetconstraintlist[i * 2 + 1];
+        subfaces->traversalinit();
+        subloop.sh = shellfacetraverse(subfaces);
+        while (subloop.sh != NULL) {
+          if (shellmark(subloop) == fmarker) {
+            setareabound(subloop, area);
+          }
+          subloop.sh = shellfacetraverse(subfaces);
+        }
+      }
     }
 
-    if (b->verbose) {
-      //assert(regioncount > 0);
-      if (regioncount > 1) {
-        printf("  Found %d subdomains.\n", regioncount);
-      } else {
-        printf("  Found %d domain.\n", regioncount);
+    // Are there length constraints?
+    if (b->quality && (in->segmentconstraintlist != (REAL *) NULL)) {
+      // Set maximum length constraints on segments.
+      int e1, e2;
+      for (i = 0; i < in->numberofsegmentconstraints; i++) {
+        e1 = (int) in->segmentconstraintlist[i * 3];
+        e2 = (int) in->segmentconstraintlist[i * 3 + 1];
+        len = in->segmentconstraintlist[i * 3 + 2];
+        // Search for edge [e1, e2].
+        idx = e1 - in->firstnumber;
+        for (j = idx2seglist[idx]; j <  idx2seglist[idx + 1]; j++) {
+          parentseg = segperverlist[j];
+          if (pointmark(sdest(parentseg)) == e2) {
+            setareabound(parentseg, len);
+            break;
+          }
+        }
       }
     }
-  } // if (b->regionattrib)
 
-  if (regiontets != NULL) {
-    delete [] regiontets;
+    delete [] idx2seglist;
+    delete [] segperverlist;
   }
-  delete tetarray;
-  delete hullarray;
 
-  if (!b->convex) { // No -c option
-    // The mesh is non-convex now.
-    nonconvex = 1;
 
-    // Push all hull tets into 'flipstack'.
+  // Set global flags.
+  checksubsegflag = 1;
+  checksubfaceflag = 1;
+
+  delete [] idx2verlist;
+  delete [] ver2tetarray;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// scoutpoint()    Search a point in mesh.                                   //
+//                                                                           //
+// This function searches the point in a mesh whose domain may be not convex.//
+// In case of a convex domain, the locate() function is sufficient.          //
+//                                                                           //
+// If 'randflag' is used, randomly select a start searching tet.  Otherwise, //
+// start searching directly from 'searchtet'.                                //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+int tetgenmesh::scoutpoint(point searchpt, triface *searchtet, int randflag)
+{
+  point pa, pb, pc, pd;
+  enum locateresult loc = OUTSIDE;
+  REAL vol, ori1, ori2 = 0, ori3 = 0, ori4 = 0;
+  int t1ver;
+
+
+  // Randomly select a good starting tet.
+  if (randflag) {
+    randomsample(searchpt, searchtet);
+  } else {
+    if (searchtet->tet == NULL) {
+      *searchtet = recenttet;
+    }
+  }
+  loc = locate(searchpt, searchtet);
+
+  if (loc == OUTSIDE) {
+    if (b->convex) { // -c option
+      // The point lies outside of the convex hull.
+      return (int) loc;
+    }
+    // Test if it lies nearly on the hull face.
+    // Reuse vol, ori1.
+    pa = org(*searchtet);
+    pb = dest(*searchtet);
+    pc = apex(*searchtet);
+    vol = triarea(pa, pb, pc);
+    ori1 = orient3dfast(pa, pb, pc, searchpt);
+    if (fabs(ori1 / vol) < b->epsilon) {
+      loc = ONFACE; // On face (or on edge, or on vertex).
+      fsymself(*searchtet);
+    }
+  }
+
+  if (loc != OUTSIDE) {
+    // Round the result of location.
+    pa = org(*searchtet);
+    pb = dest(*searchtet);
+    pc = apex(*searchtet);
+    pd = oppo(*searchtet);
+    vol = orient3dfast(pa, pb, pc, pd);
+    ori1 = orient3dfast(pa, pb, pc, searchpt);
+    ori2 = orient3dfast(pb, pa, pd, searchpt);
+    ori3 = orient3dfast(pc, pb, pd, searchpt);
+    ori4 = orient3dfast(pa, pc, pd, searchpt);
+    if (fabs(ori1 / vol) < b->epsilon) ori1 = 0;
+    if (fabs(ori2 / vol) < b->epsilon) ori2 = 0;
+    if (fabs(ori3 / vol) < b->epsilon) ori3 = 0;
+    if (fabs(ori4 / vol) < b->epsilon) ori4 = 0;
+  } else { // if (loc == OUTSIDE) {
+    // Do a brute force search for the point (with rounding).
     tetrahedrons->traversalinit();
-    tetloop.ver = 11; // The face opposite to dummypoint.
-    tetloop.tet = alltetrahedrontraverse();
-    while (tetloop.tet != (tetrahedron *) NULL) {
-      if ((point) tetloop.tet[7] == dummypoint) {
-        fsym(tetloop, neightet);
-        flippush(flipstack, &neightet);
+    searchtet->tet = tetrahedrontraverse();
+    while (searchtet->tet != NULL) {
+      pa = org(*searchtet);
+      pb = dest(*searchtet);
+      pc = apex(*searchtet);
+      pd = oppo(*searchtet);
+
+      vol = orient3dfast(pa, pb, pc, pd); 
+      if (vol < 0) {
+        ori1 = orient3dfast(pa, pb, pc, searchpt);
+        if (fabs(ori1 / vol) < b->epsilon) ori1 = 0; // Rounding.
+        if (ori1 <= 0) {
+          ori2 = orient3dfast(pb, pa, pd, searchpt);
+          if (fabs(ori2 / vol) < b->epsilon) ori2 = 0;
+          if (ori2 <= 0) {
+            ori3 = orient3dfast(pc, pb, pd, searchpt);
+            if (fabs(ori3 / vol) < b->epsilon) ori3 = 0;
+            if (ori3 <= 0) {
+              ori4 = orient3dfast(pa, pc, pd, searchpt);
+              if (fabs(ori4 / vol) < b->epsilon) ori4 = 0;
+              if (ori4 <= 0) {
+                // Found the tet. Return its location. 
+                break;
+              } // ori4
+            } // ori3
+          } // ori2
+        } // ori1
       }
-      tetloop.tet = alltetrahedrontraverse();
-    }
 
-    flipconstraints fc;
-    fc.enqflag = 2;
-    long sliver_peel_count = lawsonflip3d(&fc);
+      searchtet->tet = tetrahedrontraverse();
+    } // while (searchtet->tet != NULL)
+    nonregularcount++;  // Re-use this counter.
+  }
+
+  if (searchtet->tet != NULL) {
+    // Return the point location.
+    if (ori1 == 0) { // on face [a,b,c]
+      if (ori2 == 0) { // on edge [a,b].
+        if (ori3 == 0) { // on vertex [b].
+          enextself(*searchtet); // [b,c,a,d]
+          loc = ONVERTEX;
+        } else {
+          if (ori4 == 0) { // on vertex [a]
+            loc =  ONVERTEX; // [a,b,c,d]
+          } else {    
+            loc =  ONEDGE; // [a,b,c,d]
+          }
+        }
+      } else { // ori2 != 0
+        if (ori3 == 0) { // on edge [b,c]
+          if (ori4 == 0) { // on vertex [c]
+            eprevself(*searchtet); // [c,a,b,d]
+            loc =  ONVERTEX;
+          } else {
+            enextself(*searchtet); // [b,c,a,d]
+            loc =  ONEDGE;
+          }
+        } else { // ori3 != 0
+          if (ori4 == 0) { // on edge [c,a]
+            eprevself(*searchtet); // [c,a,b,d]
+            loc =  ONEDGE;
+          } else {
+            loc =  ONFACE;
+          }
+        }
+      }
+    } else { // ori1 != 0
+      if (ori2 == 0) { // on face [b,a,d]
+        esymself(*searchtet); // [b,a,d,c]
+        if (ori3 == 0) { // on edge [b,d]
+          eprevself(*searchtet); // [d,b,a,c]
+          if (ori4 == 0) { // on vertex [d]                      
+            loc =  ONVERTEX;
+          } else {
+            loc =  ONEDGE;
+          }
+        } else { // ori3 != 0
+          if (ori4 == 0) { // on edge [a,d]
+            enextself(*searchtet); // [a,d,b,c]
+            loc =  ONEDGE;
+          } else {
+            loc =  ONFACE;
+          }
+        }
+      } else { // ori2 != 0
+        if (ori3 == 0) { // on face [c,b,d]
+          enextself(*searchtet);
+          esymself(*searchtet);
+          if (ori4 == 0) { // on edge [c,d]
+            eprevself(*searchtet);
+            loc =  ONEDGE;
+          } else {
+            loc =  ONFACE;
+          }
+        } else {
+          if (ori4 == 0) { // on face [a,c,d]
+            eprevself(*searchtet);
+            esymself(*searchtet);
+            loc =  ONFACE;
+          } else { // inside tet [a,b,c,d]
+            loc =  INTETRAHEDRON;
+          } // ori4
+        } // ori3
+      } // ori2
+    } // ori1
+  } else {
+    loc = OUTSIDE;
+  }
 
-    if (sliver_peel_count > 0l) {
-      if (b->verbose) {
-        printf("  Removed %ld hull slivers.\n", sliver_peel_count);
-      }
-    }
-    unflipqueue->restart();
-  } // if (!b->convex)
+  return (int) loc;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// reconstructmesh()    Reconstruct a tetrahedral mesh.                      //
+// getpointmeshsize()    Interpolate the mesh size at given point.           //
+//                                                                           //
+// 'iloc' indicates the location of the point w.r.t. 'searchtet'.  The size  //
+// is obtained by linear interpolation on the vertices of the tet.           //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-void tetgenmesh::reconstructmesh()
+REAL tetgenmesh::getpointmeshsize(point searchpt, triface *searchtet, int iloc)
 {
-  tetrahedron *ver2tetarray;
-  point *idx2verlist;
-  triface tetloop, checktet, prevchktet;
-  triface hulltet, face1, face2;
-  tetrahedron tptr;
-  face subloop, neighsh, nextsh;
-  face segloop;
-  shellface sptr;
-  point p[4], q[3];
-  REAL ori, attrib, volume;
-  REAL cosang_tol, cosang;
-  REAL n1[3], n2[3];
-  int eextras, marker = 0;
-  int bondflag;
-  int t1ver;
-  int idx, i, j, k;
-
-  if (!b->quiet) {
-    printf("Reconstructing mesh ...\n");
-  }
-
-  if (b->convex) { // -c option.
-    // Assume the mesh is convex. Exterior tets have region attribute -1.
-    if (!(in->numberoftetrahedronattributes > 0)) {
-      terminatetetgen(this, 2);
-    }
-  } else {
-    // Assume the mesh is non-convex.
-    nonconvex = 1;
-  }
-
-  // Create a map from indices to vertices. 
-  makeindex2pointmap(idx2verlist);
-  // 'idx2verlist' has length 'in->numberofpoints + 1'.
-  if (in->firstnumber == 1) {
-    idx2verlist[0] = dummypoint; // Let 0th-entry be dummypoint.
-  }
+  point *pts, pa, pb, pc;
+  REAL volume, vol[4], wei[4];
+  REAL size;
+  int i;
 
-  // Allocate an array that maps each vertex to its adjacent tets.
-  ver2tetarray = new tetrahedron[in->numberofpoints + 1];
-  //for (i = 0; i < in->numberofpoints + 1; i++) {
-  for (i = in->firstnumber; i < in->numberofpoints + in->firstnumber; i++) {
-    setpointtype(idx2verlist[i], VOLVERTEX); // initial type.
-    ver2tetarray[i] = NULL;
-  }
+  size = 0;
 
-  // Create the tetrahedra and connect those that share a common face.
-  for (i = 0; i < in->numberoftetrahedra; i++) {
-    // Get the four vertices.
-    idx = i * in->numberofcorners;
-    for (j = 0; j < 4; j++) {
-      p[j] = idx2verlist[in->tetrahedronlist[idx++]];
-    }
-    // Check the orientation.
-    ori = orient3d(p[0], p[1], p[2], p[3]);
-    if (ori > 0.0) {
-      // Swap the first two vertices.
-      q[0] = p[0]; p[0] = p[1]; p[1] = q[0];
-    } else if (ori == 0.0) {
-      if (!b->quiet) {
-        printf("Warning:  Tet #%d is degenerate.\n", i + in->firstnumber);
+  if (iloc == (int) INTETRAHEDRON) {
+    pts = (point *) &(searchtet->tet[4]);
+    // Only do interpolation if all vertices have non-zero sizes.
+    if ((pts[0][pointmtrindex] > 0) && (pts[1][pointmtrindex] > 0) &&
+        (pts[2][pointmtrindex] > 0) && (pts[3][pointmtrindex] > 0)) {
+      // P1 interpolation.
+      volume = orient3dfast(pts[0], pts[1], pts[2], pts[3]);
+      vol[0] = orient3dfast(searchpt, pts[1], pts[2], pts[3]);
+      vol[1] = orient3dfast(pts[0], searchpt, pts[2], pts[3]);
+      vol[2] = orient3dfast(pts[0], pts[1], searchpt, pts[3]);
+      vol[3] = orient3dfast(pts[0], pts[1], pts[2], searchpt);
+      for (i = 0; i < 4; i++) {
+        wei[i] = fabs(vol[i] / volume);
+        size += (wei[i] * pts[i][pointmtrindex]);
       }
     }
-    // Create a new tetrahedron.
-    maketetrahedron(&tetloop); // tetloop.ver = 11.
-    setvertices(tetloop, p[0], p[1], p[2], p[3]);
-    // Set element attributes if they exist.
-    for (j = 0; j < in->numberoftetrahedronattributes; j++) {
-      idx = i * in->numberoftetrahedronattributes;
-      attrib = in->tetrahedronattributelist[idx + j];
-      setelemattribute(tetloop.tet, j, attrib);
-    }
-    // If -a switch is used (with no number follows) Set a volume
-    //   constraint if it exists.
-    if (b->varvolume) {
-      if (in->tetrahedronvolumelist != (REAL *) NULL) {
-        volume = in->tetrahedronvolumelist[i];
-      } else {
-        volume = -1.0;
-      }
-      setvolumebound(tetloop.tet, volume);
+  } else if (iloc == (int) ONFACE) {
+    pa = org(*searchtet);
+    pb = dest(*searchtet);
+    pc = apex(*searchtet);
+    if ((pa[pointmtrindex] > 0) && (pb[pointmtrindex] > 0) &&
+        (pc[pointmtrindex] > 0)) {
+      volume = triarea(pa, pb, pc);
+      vol[0] = triarea(searchpt, pb, pc);
+      vol[1] = triarea(pa, searchpt, pc);
+      vol[2] = triarea(pa, pb, searchpt);
+      size = (vol[0] / volume) * pa[pointmtrindex]
+           + (vol[1] / volume) * pb[pointmtrindex]
+           + (vol[2] / volume) * pc[pointmtrindex];
     }
-    // Try connecting this tet to others that share the common faces.
-    for (tetloop.ver = 0; tetloop.ver < 4; tetloop.ver++) {
-      p[3] = oppo(tetloop);
-      // Look for other tets having this vertex.
-      idx = pointmark(p[3]);
-      tptr = ver2tetarray[idx];
-      // Link the current tet to the next one in the stack.
-      tetloop.tet[8 + tetloop.ver] = tptr;
-      // Push the current tet onto the stack.
-      ver2tetarray[idx] = encode(tetloop);
-      decode(tptr, checktet);
-      if (checktet.tet != NULL) {
-        p[0] =  org(tetloop); // a
-        p[1] = dest(tetloop); // b
-        p[2] = apex(tetloop); // c
-        prevchktet = tetloop;
-        do {
-          q[0] =  org(checktet); // a'
-          q[1] = dest(checktet); // b'
-          q[2] = apex(checktet); // c'
-          // Check the three faces at 'd' in 'checktet'.
-          bondflag = 0;
-          for (j = 0; j < 3; j++) {
-            // Go to the face [b',a',d], or [c',b',d], or [a',c',d].
-            esym(checktet, face2);
-            if (face2.tet[face2.ver & 3] == NULL) {
-              k = ((j + 1) % 3);
-              if (q[k] == p[0]) {   // b', c', a' = a
-                if (q[j] == p[1]) { // a', b', c' = b
-                  // [#,#,d] is matched to [b,a,d].
-                  esym(tetloop, face1);
-                  bond(face1, face2);
-                  bondflag++;
-                }
-              }
-              if (q[k] == p[1]) {   // b',c',a' = b
-                if (q[j] == p[2]) { // a',b',c' = c
-                  // [#,#,d] is matched to [c,b,d].
-                  enext(tetloop, face1);
-                  esymself(face1);
-                  bond(face1, face2);
-                  bondflag++;
-                }
-              }
-              if (q[k] == p[2]) {   // b',c',a' = c
-                if (q[j] == p[0]) { // a',b',c' = a
-                  // [#,#,d] is matched to [a,c,d].
-                  eprev(tetloop, face1);
-                  esymself(face1);
-                  bond(face1, face2);
-                  bondflag++;
-                }
-              }
-            } else {
-              bondflag++;
-            }
-            enextself(checktet);
-          } // j
-          // Go to the next tet in the link.
-          tptr = checktet.tet[8 + checktet.ver];
-          if (bondflag == 3) {
-            // All three faces at d in 'checktet' have been connected.
-            // It can be removed from the link.            
-            prevchktet.tet[8 + prevchktet.ver] = tptr;
-          } else {
-            // Bakup the previous tet in the link.
-            prevchktet = checktet;
-          }
-          decode(tptr, checktet);
-        } while (checktet.tet != NULL);
-      } // if (checktet.tet != NULL)
-    } // for (tetloop.ver = 0; ...
-  } // i
-
-  // Remember a tet of the mesh.
-  recenttet = tetloop;
-
-  // Create hull tets, create the point-to-tet map, and clean up the
-  //   temporary spaces used in each tet. 
-  hullsize = tetrahedrons->items;
-
-  tetrahedrons->traversalinit();
-  tetloop.tet = tetrahedrontraverse();
-  while (tetloop.tet != (tetrahedron *) NULL) {
-    tptr = encode(tetloop);
-    for (tetloop.ver = 0; tetloop.ver < 4; tetloop.ver++) {
-      if (tetloop.tet[tetloop.ver] == NULL) {
-        // Create a hull tet.
-        maketetrahedron(&hulltet);
-        p[0] =  org(tetloop);
-        p[1] = dest(tetloop);
-        p[2] = apex(tetloop);
-        setvertices(hulltet, p[1], p[0], p[2], dummypoint);
-        bond(tetloop, hulltet);
-        // Try connecting this to others that share common hull edges.
-        for (j = 0; j < 3; j++) {
-          fsym(hulltet, face2);
-          while (1) {
-            if (face2.tet == NULL) break;
-            esymself(face2);
-            if (apex(face2) == dummypoint) break;
-            fsymself(face2);
-          }
-          if (face2.tet != NULL) {
-            // Found an adjacent hull tet.
-            esym(hulltet, face1);
-            bond(face1, face2);
-          }
-          enextself(hulltet);
-        }
-      }
-      // Create the point-to-tet map.
-      setpoint2tet((point) (tetloop.tet[4 + tetloop.ver]), tptr);
-      // Clean the temporary used space.
-      tetloop.tet[8 + tetloop.ver] = NULL;
+  } else if (iloc == (int) ONEDGE) {
+    pa = org(*searchtet);
+    pb = dest(*searchtet);
+    if ((pa[pointmtrindex] > 0) && (pb[pointmtrindex] > 0)) {
+      volume = distance(pa, pb);
+      vol[0] = distance(searchpt, pb);
+      vol[1] = distance(pa, searchpt);
+      size = (vol[0] / volume) * pa[pointmtrindex]
+           + (vol[1] / volume) * pb[pointmtrindex];
+    }
+  } else if (iloc == (int) ONVERTEX) {
+    pa = org(*searchtet);
+    if (pa[pointmtrindex] > 0) {
+      size = pa[pointmtrindex];
     }
-    tetloop.tet = tetrahedrontraverse();
   }
 
-  hullsize = tetrahedrons->items - hullsize;
+  return size;
+}
 
-  // Subfaces will be inserted into the mesh. 
-  if (in->trifacelist != NULL) {
-    // A .face file is given. It may contain boundary faces. Insert them.
-    for (i = 0; i < in->numberoftrifaces; i++) {
-      // Is it a subface?
-      if (in->trifacemarkerlist != NULL) {
-        marker = in->trifacemarkerlist[i];
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// interpolatemeshsize()    Interpolate the mesh size from a background mesh //
+//                          (source) to the current mesh (destination).      //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+void tetgenmesh::interpolatemeshsize()
+{
+  triface searchtet;
+  point ploop;
+  REAL minval = 0.0, maxval = 0.0;
+  int iloc;
+  int count;
+
+  if (!b->quiet) {
+    printf("Interpolating mesh size ...\n");
+  }
+
+  long bak_nonregularcount = nonregularcount;
+  nonregularcount = 0l; // Count the number of (slow) global searches.
+  long baksmaples = bgm->samples;
+  bgm->samples = 3l;
+  count = 0; // Count the number of interpolated points.
+
+  // Interpolate sizes for all points in the current mesh.
+  points->traversalinit();
+  ploop = pointtraverse();
+  while (ploop != NULL) {
+    // Search a tet in bgm which containing this point.
+    searchtet.tet = NULL;
+    iloc = bgm->scoutpoint(ploop, &searchtet, 1); // randflag = 1
+    if (iloc != (int) OUTSIDE) {
+      // Interpolate the mesh size.
+      ploop[pointmtrindex] = bgm->getpointmeshsize(ploop, &searchtet, iloc);
+      setpoint2bgmtet(ploop, bgm->encode(searchtet));
+      if (count == 0) {
+        // This is the first interpolated point.
+        minval = maxval = ploop[pointmtrindex];
       } else {
-        // Face markers are not available. Assume all of them are subfaces.
-        marker = -1; // The default marker.
-      }
-      if (marker != 0) {
-        idx = i * 3;
-        for (j = 0; j < 3; j++) {
-          p[j] = idx2verlist[in->trifacelist[idx++]];
-        }
-        // Search the subface.
-        bondflag = 0;
-        neighsh.sh = NULL;
-        // Make sure all vertices are in the mesh. Avoid crash.
-        for (j = 0; j < 3; j++) {
-          decode(point2tet(p[j]), checktet);
-          if (checktet.tet == NULL) break;
+        if (ploop[pointmtrindex] < minval) {
+          minval = ploop[pointmtrindex];
         }
-        if ((j == 3) && getedge(p[0], p[1], &checktet)) {
-          tetloop = checktet;
-          q[2] = apex(checktet);
-          while (1) {
-            if (apex(tetloop) == p[2]) {
-              // Found the face.
-              // Check if there exist a subface already?
-              tspivot(tetloop, neighsh); 
-              if (neighsh.sh != NULL) {
-                // Found a duplicated subface. 
-                // This happens when the mesh was generated by other mesher.
-                bondflag = 0;
-              } else {
-                bondflag = 1;
-              }
-              break;
-            }
-            fnextself(tetloop);
-            if (apex(tetloop) == q[2]) break;
-          }
+        if (ploop[pointmtrindex] > maxval) {
+          maxval = ploop[pointmtrindex];
         }
-        if (bondflag) {
-          // Create a new subface.
-          makeshellface(subfaces, &subloop);
-          setshvertices(subloop, p[0], p[1], p[2]);
-          // Create the point-to-subface map.
-          sptr = sencode(subloop);
-          for (j = 0; j < 3; j++) {
-            setpointtype(p[j], FACETVERTEX); // initial type.
-            setpoint2sh(p[j], sptr);
-          }
-          setshellmark(subloop, marker);
-          // Insert the subface into the mesh.
-          tsbond(tetloop, subloop);
-          fsymself(tetloop);
-          sesymself(subloop);
-          tsbond(tetloop, subloop);
-        } else {
-          if (neighsh.sh != NULL) {
-            // The subface already exists. Only set its mark.
-            setshellmark(neighsh, marker);
-          } else {
-            if (!b->quiet) {
-              if (neighsh.sh == NULL) {
-                printf("Warning:  Subface #%d [%d,%d,%d] is missing.\n", 
-                       i + in->firstnumber, pointmark(p[0]), pointmark(p[1]),
-                       pointmark(p[2]));
-              } 
-            }
-          }
-        } // if (bondflag)
-      } // if (marker != 0)
-    } // i
-  } // if (in->trifacelist)
+      }
+      count++;
+    } else {
+      if (!b->quiet) {
+        printf("Warnning:  Failed to locate point %d in source mesh.\n",
+               pointmark(ploop));
+      }
+    }
+    ploop = pointtraverse();
+  }
 
-  // Indentify subfaces from the mesh.
-  // Create subfaces for hull faces (if they're not subface yet) and
-  //   interior faces which separate two different materials.
-  eextras = in->numberoftetrahedronattributes;
-  tetrahedrons->traversalinit();
-  tetloop.tet = tetrahedrontraverse();
-  while (tetloop.tet != (tetrahedron *) NULL) {
-    for (tetloop.ver = 0; tetloop.ver < 4; tetloop.ver++) {
-      tspivot(tetloop, neighsh);
-      if (neighsh.sh == NULL) {
-        bondflag = 0;
-        fsym(tetloop, checktet);
-        if (ishulltet(checktet)) {
-          // A hull face.
-          if (!b->convex) {
-            bondflag = 1;  // Insert a hull subface.
-          }
-        } else {
-          if (eextras > 0) {
-            if (elemattribute(tetloop.tet, eextras - 1) !=
-                elemattribute(checktet.tet, eextras - 1)) {
-              bondflag = 1; // Insert an interior interface.
-            }
-          }
-        }
-        if (bondflag) {
-          // Create a new subface.
-          makeshellface(subfaces, &subloop);
-          p[0] = org(tetloop);
-          p[1] = dest(tetloop);
-          p[2] = apex(tetloop);
-          setshvertices(subloop, p[0], p[1], p[2]);
-          // Create the point-to-subface map.
-          sptr = sencode(subloop);
-          for (j = 0; j < 3; j++) {
-            setpointtype(p[j], FACETVERTEX); // initial type.
-            setpoint2sh(p[j], sptr);
-          }
-          setshellmark(subloop, -1); // Default marker.
-          // Insert the subface into the mesh.
-          tsbond(tetloop, subloop);
-          sesymself(subloop);
-          tsbond(checktet, subloop);
-        } // if (bondflag)
-      } // if (neighsh.sh == NULL)
+  if (b->verbose) {
+    printf("  Interoplated %d points.\n", count);
+    if (nonregularcount > 0l) {
+      printf("  Performed %ld brute-force searches.\n", nonregularcount);
     }
-    tetloop.tet = tetrahedrontraverse();
+    printf("  Size rangle [%.17g, %.17g].\n", minval, maxval);
   }
 
-  // Connect subfaces together. 
-  subfaces->traversalinit();
-  subloop.shver = 0;
-  subloop.sh = shellfacetraverse(subfaces);
-  while (subloop.sh != (shellface *) NULL) {
-    for (i = 0; i < 3; i++) {
-      spivot(subloop, neighsh);
-      if (neighsh.sh == NULL) {
-        // Form a subface ring by linking all subfaces at this edge.
-        // Traversing all faces of the tets at this edge.
-        stpivot(subloop, tetloop);
-        q[2] = apex(tetloop);
-        neighsh = subloop;
-        while (1) {
-          fnextself(tetloop);
-          tspivot(tetloop, nextsh);
-          if (nextsh.sh != NULL) {
-            // Do not connect itself.
-            if (nextsh.sh != neighsh.sh) {
-              // Link neighsh <= nextsh.
-              sbond1(neighsh, nextsh);
-              neighsh = nextsh;
-            }
-          }
-          if (apex(tetloop) == q[2]) {
-            break;
-          }
-        } // while (1)
-      } // if (neighsh.sh == NULL)
-      senextself(subloop);
+  bgm->samples = baksmaples;
+  nonregularcount = bak_nonregularcount;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// insertconstrainedpoints()    Insert a list of points into the mesh.       //
+//                                                                           //
+// Assumption:  The bounding box of the insert point set should be no larger //
+// than the bounding box of the mesh.  (Required by point sorting).          //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+void tetgenmesh::insertconstrainedpoints(point *insertarray, int arylen,
+                                         int rejflag)
+{
+  triface searchtet, spintet;
+  face splitsh;
+  face splitseg;
+  insertvertexflags ivf;
+  flipconstraints fc;
+  int randflag = 0;
+  int t1ver;
+  int i;
+
+  if (b->verbose) {
+    printf("  Inserting %d constrained points\n", arylen);
+  }
+
+  if (b->no_sort) { // -b/1 option.
+    if (b->verbose) {
+      printf("  Using the input order.\n"); 
+    }
+  } else {
+    if (b->verbose) {
+      printf("  Permuting vertices.\n"); 
     }
-    subloop.sh = shellfacetraverse(subfaces);
-  }
+    point swappoint;
+    int randindex;
+    srand(arylen);
+    for (i = 0; i < arylen; i++) {
+      randindex = rand() % (i + 1); 
+      swappoint = insertarray[i];
+      insertarray[i] = insertarray[randindex];
+      insertarray[randindex] = swappoint;
+    }
+    if (b->brio_hilbert) { // -b1 option
+      if (b->verbose) {
+        printf("  Sorting vertices.\n"); 
+      }
+      hilbert_init(in->mesh_dim);
+      int ngroup = 0; 
+      brio_multiscale_sort(insertarray, arylen, b->brio_threshold, 
+                           b->brio_ratio, &ngroup);
+    } else { // -b0 option.
+      randflag = 1;
+    } // if (!b->brio_hilbert)
+  } // if (!b->no_sort)
 
+  long bak_nonregularcount = nonregularcount;
+  nonregularcount = 0l;
+  long baksmaples = samples;
+  samples = 3l; // Use at least 3 samples. Updated in randomsample().
 
-  // Segments will be introduced. 
-  if (in->edgelist != NULL) {
-    // A .edge file is given. It may contain boundary edges. Insert them.
-    for (i = 0; i < in->numberofedges; i++) {
-      // Is it a segment?
-      if (in->edgemarkerlist != NULL) {
-        marker = in->edgemarkerlist[i];
-      } else {
-        // Edge markers are not available. Assume all of them are segments.
-        marker = -1; // Default marker.
-      }
-      if (marker != 0) { 
-        // Insert a segment.
-        idx = i * 2;
-        for (j = 0; j < 2; j++) {
-          p[j] = idx2verlist[in->edgelist[idx++]];
-        }
-        // Make sure all vertices are in the mesh. Avoid crash.
-        for (j = 0; j < 2; j++) {
-          decode(point2tet(p[j]), checktet);
-          if (checktet.tet == NULL) break;
-        }
-        // Search the segment.
-        if ((j == 2) && getedge(p[0], p[1], &checktet)) {
-          // Create a new segment.
-          makeshellface(subsegs, &segloop);
-          setshvertices(segloop, p[0], p[1], NULL);
-          // Create the point-to-segment map.
-          sptr = sencode(segloop);
-          for (j = 0; j < 2; j++) {
-            setpointtype(p[j], RIDGEVERTEX); // initial type.
-            setpoint2sh(p[j], sptr);
-          }
-          setshellmark(segloop, marker);
-          // Insert the segment into the mesh.
-          tetloop = checktet;
-          q[2] = apex(checktet);
-          subloop.sh = NULL;
-          while (1) {
-            tssbond1(tetloop, segloop);
-            tspivot(tetloop, subloop);
-            if (subloop.sh != NULL) {
-              ssbond1(subloop, segloop);
-              sbond1(segloop, subloop);
-            }
-            fnextself(tetloop);
-            if (apex(tetloop) == q[2]) break;
-          } // while (1)
-          // Remember an adjacent tet for this segment.
-          sstbond1(segloop, tetloop);
-        } else {
-          if (!b->quiet) {
-            printf("Warning:  Segment #%d [%d,%d] is missing.\n", 
-                   i + in->firstnumber, pointmark(p[0]), pointmark(p[1]));
-          }
-        }
-      } // if (marker != 0)
-    } // i
-  } // if (in->edgelist)
+  long bak_seg_count = st_segref_count;
+  long bak_fac_count = st_facref_count;
+  long bak_vol_count = st_volref_count;
 
-  // Identify segments from the mesh. 
-  // Create segments for non-manifold edges (which are shared by more 
-  //   than two subfaces), and for non-coplanar edges, i.e., two subfaces
-  //   form an dihedral angle > 'b->facet_separate_ang_tol' (degree).
-  cosang_tol = cos(b->facet_separate_ang_tol / 180.0 * PI);
-  subfaces->traversalinit();
-  subloop.shver = 0;
-  subloop.sh = shellfacetraverse(subfaces);
-  while (subloop.sh != (shellface *) NULL) {
-    for (i = 0; i < 3; i++) {
-      sspivot(subloop, segloop);
-      if (segloop.sh == NULL) {
-        // Check if this edge is a segment.
-        bondflag = 0;
-        // Counter the number of subfaces at this edge.
-        idx = 0;
-        nextsh = subloop;
-        while (1) {
-          idx++;
-          spivotself(nextsh);
-          if (nextsh.sh == subloop.sh) break;
-        }
-        if (idx != 2) {
-          // It's a non-manifold edge. Insert a segment.
-          p[0] = sorg(subloop);
-          p[1] = sdest(subloop);
-          bondflag = 1;
-        } else {
-          spivot(subloop, neighsh);
-          if (shellmark(subloop) != shellmark(neighsh)) {
-            // It's an interior interface. Insert a segment.
-            p[0] = sorg(subloop);
-            p[1] = sdest(subloop);
-            bondflag = 1;
-          } else {
-            if (!b->convex) {
-              // Check the dihedral angle formed by the two subfaces.
-              p[0] = sorg(subloop);
-              p[1] = sdest(subloop);
-              p[2] = sapex(subloop);
-              p[3] = sapex(neighsh);
-              facenormal(p[0], p[1], p[2], n1, 1, NULL);
-              facenormal(p[0], p[1], p[3], n2, 1, NULL);
-              cosang = dot(n1, n2) / (sqrt(dot(n1, n1)) * sqrt(dot(n2, n2)));
-              // Rounding.
-              if (cosang > 1.0) cosang = 1.0;
-              else if (cosang < -1.0) cosang = -1.0;  
-              if (cosang > cosang_tol) {
-                bondflag = 1;
-              }
-            }
-          }
-        }
-        if (bondflag) {
-          // Create a new segment.
-          makeshellface(subsegs, &segloop);
-          setshvertices(segloop, p[0], p[1], NULL);
-          // Create the point-to-segment map.
-          sptr = sencode(segloop);
-          for (j = 0; j < 2; j++) {
-            setpointtype(p[j], RIDGEVERTEX); // initial type.
-            setpoint2sh(p[j], sptr);
-          }
-          setshellmark(segloop, -1); // Default marker.
-          // Insert the subface into the mesh.
-          stpivot(subloop, tetloop);
-          q[2] = apex(tetloop);
-          while (1) {
-            tssbond1(tetloop, segloop);
-            tspivot(tetloop, neighsh);
-            if (neighsh.sh != NULL) {
-              ssbond1(neighsh, segloop);
-            }
-            fnextself(tetloop);
-            if (apex(tetloop) == q[2]) break;
-          } // while (1)
-          // Remember an adjacent tet for this segment.
-          sstbond1(segloop, tetloop);
-          sbond1(segloop, subloop);
-        } // if (bondflag)
-      } // if (neighsh.sh == NULL)
-      senextself(subloop);
-    } // i
-    subloop.sh = shellfacetraverse(subfaces);
+  // Initialize the insertion parameters. 
+  if (b->incrflip) { // -l option
+    // Use incremental flip algorithm.
+    ivf.bowywat = 0; 
+    ivf.lawson = 1;
+    ivf.validflag = 0; // No need to validate the cavity.
+    fc.enqflag = 2;
+  } else {
+    // Use Bowyer-Watson algorithm.
+    ivf.bowywat = 1; 
+    ivf.lawson = 0;
+    ivf.validflag = 1; // Validate the B-W cavity.
   }
+  ivf.rejflag = rejflag;
+  ivf.chkencflag = 0; 
+  ivf.sloc = (int) INSTAR;
+  ivf.sbowywat = 3; 
+  ivf.splitbdflag = 1;
+  ivf.respectbdflag = 1;
+  ivf.assignmeshsize = b->metric;
 
-  // Remember the number of input segments.
-  insegments = subsegs->items;
-
-  if (!b->nobisect || checkconstraints) {
-    // Mark Steiner points on segments and facets.
-    //   - all vertices which remaining type FEACTVERTEX become
-    //     Steiner points in facets (= FREEFACERVERTEX).
-    //   - vertices on segment need to be checked.
-    face* segperverlist;
-    int* idx2seglist;
-    face parentseg, nextseg;
-    verttype vt;
-    REAL area, len, l1, l2;
-    int fmarker;
+  encseglist = new arraypool(sizeof(face), 8);
+  encshlist = new arraypool(sizeof(badface), 8);
 
-    makepoint2submap(subsegs, idx2seglist, segperverlist);
+  // Insert the points.
+  for (i = 0; i < arylen; i++) {
+    // Find the location of the inserted point.
+    // Do not use 'recenttet', since the mesh may be non-convex.
+    searchtet.tet = NULL; 
+    ivf.iloc = scoutpoint(insertarray[i], &searchtet, randflag);
 
-    points->traversalinit();
-    point ptloop = pointtraverse();
-    while (ptloop != NULL) {
-      vt = pointtype(ptloop);
-      if (vt == VOLVERTEX) {
-        setpointtype(ptloop, FREEVOLVERTEX);
-        st_volref_count++;
-      } else if (vt == FACETVERTEX) {
-        setpointtype(ptloop, FREEFACETVERTEX);
-        st_facref_count++;
-      } else if (vt == RIDGEVERTEX) {
-        idx = pointmark(ptloop) - in->firstnumber;
-        if ((idx2seglist[idx + 1] - idx2seglist[idx]) == 2) {
-          i = idx2seglist[idx];
-          parentseg = segperverlist[i];
-          nextseg = segperverlist[i + 1];
-          sesymself(nextseg);
-          p[0] = sorg(nextseg);
-          p[1] = sdest(parentseg);
-          // Check if three points p[0], ptloop, p[2] are (nearly) collinear.
-          len = distance(p[0], p[1]);
-          l1 = distance(p[0], ptloop);
-          l2 = distance(ptloop, p[1]);
-          if (((l1 + l2 - len) / len) < b->epsilon) {
-            // They are (nearly) collinear.
-            setpointtype(ptloop, FREESEGVERTEX);
-            // Connect nextseg and parentseg together at ptloop.
-            senextself(nextseg);
-            senext2self(parentseg);
-            sbond(nextseg, parentseg);
-            st_segref_count++;
+    // Decide the right type for this point.
+    setpointtype(insertarray[i], FREEVOLVERTEX); // Default.
+    splitsh.sh = NULL;
+    splitseg.sh = NULL;
+    if (ivf.iloc == (int) ONEDGE) {
+      if (issubseg(searchtet)) {
+        tsspivot1(searchtet, splitseg);
+        setpointtype(insertarray[i], FREESEGVERTEX);
+        //ivf.rejflag = 0;
+      } else {
+        // Check if it is a subface edge.
+        spintet = searchtet;
+        while (1) {
+          if (issubface(spintet)) {
+            tspivot(spintet, splitsh);
+            setpointtype(insertarray[i], FREEFACETVERTEX);
+            //ivf.rejflag |= 1;
+            break;
           }
+          fnextself(spintet);
+          if (spintet.tet == searchtet.tet) break;
         }
       }
-      ptloop = pointtraverse();
-    }
-
-    // Are there area constraints?
-    if (b->quality && (in->facetconstraintlist != (REAL *) NULL)) {
-      // Set maximum area constraints on facets.
-      for (i = 0; i < in->numberoffacetconstraints; i++) {
-        fmarker = (int) in->facetconstraintlist[i * 2];
-        area = in->facetconstraintlist[i * 2 + 1];
-        subfaces->traversalinit();
-        subloop.sh = shellfacetraverse(subfaces);
-        while (subloop.sh != NULL) {
-          if (shellmark(subloop) == fmarker) {
-            setareabound(subloop, area);
-          }
-          subloop.sh = shellfacetraverse(subfaces);
-        }
+    } else if (ivf.iloc == (int) ONFACE) {
+      if (issubface(searchtet)) {
+        tspivot(searchtet, splitsh);
+        setpointtype(insertarray[i], FREEFACETVERTEX);
+        //ivf.rejflag |= 1;
       }
     }
 
-    // Are there length constraints?
-    if (b->quality && (in->segmentconstraintlist != (REAL *) NULL)) {
-      // Set maximum length constraints on segments.
-      int e1, e2;
-      for (i = 0; i < in->numberofsegmentconstraints; i++) {
-        e1 = (int) in->segmentconstraintlist[i * 3];
-        e2 = (int) in->segmentconstraintlist[i * 3 + 1];
-        len = in->segmentconstraintlist[i * 3 + 2];
-        // Search for edge [e1, e2].
-        idx = e1 - in->firstnumber;
-        for (j = idx2seglist[idx]; j <  idx2seglist[idx + 1]; j++) {
-          parentseg = segperverlist[j];
-          if (pointmark(sdest(parentseg)) == e2) {
-            setareabound(parentseg, len);
-            break;
-          }
-        }
+    // Now insert the point.
+    if (insertpoint(insertarray[i], &searchtet, &splitsh, &splitseg, &ivf)) {
+      if (flipstack != NULL) {
+        // There are queued faces. Use flips to recover Delaunayness.
+        lawsonflip3d(&fc);
+        // There may be unflippable edges. Ignore them.
+        unflipqueue->restart();
+      }
+      // Update the Steiner counters.
+      if (pointtype(insertarray[i]) == FREESEGVERTEX) {
+        st_segref_count++;
+      } else if (pointtype(insertarray[i]) == FREEFACETVERTEX) {
+        st_facref_count++;
+      } else {
+        st_volref_count++;
       }
+    } else {
+      // Point is not inserted.
+      //pointdealloc(insertarray[i]);
+      setpointtype(insertarray[i], UNUSEDVERTEX);
+      unuverts++;
+      encseglist->restart();
+      encshlist->restart();
     }
+  } // i
 
-    delete [] idx2seglist;
-    delete [] segperverlist;
-  }
-
+  delete encseglist;
+  delete encshlist;
 
-  // Set global flags.
-  checksubsegflag = 1;
-  checksubfaceflag = 1;
+  if (b->verbose) {
+    printf("  Inserted %ld (%ld, %ld, %ld) vertices.\n", 
+           st_segref_count + st_facref_count + st_volref_count - 
+           (bak_seg_count + bak_fac_count + bak_vol_count),
+           st_segref_count - bak_seg_count, st_facref_count - bak_fac_count,
+           st_volref_count - bak_vol_count);
+    if (nonregularcount > 0l) {
+      printf("  Performed %ld brute-force searches.\n", nonregularcount);
+    }
+  }
 
-  delete [] idx2verlist;
-  delete [] ver2tetarray;
+  nonregularcount = bak_nonregularcount;
+  samples = baksmaples; 
 }
 
-///////////////////////////////////////////////////////////////////////////////
-//                                                                           //
-// scoutpoint()    Search a point in mesh.                                   //
-//                                                                           //
-// This function searches the point in a mesh whose domain may be not convex.//
-// In case of a convex domain, the locate() function is sufficient.          //
-//                                                                           //
-// If 'randflag' is used, randomly select a start searching tet.  Otherwise, //
-// start searching directly from 'searchtet'.                                //
-//                                                                           //
-///////////////////////////////////////////////////////////////////////////////
-
-int tetgenmesh::scoutpoint(point searchpt, triface *searchtet, int randflag)
+void tetgenmesh::insertconstrainedpoints(tetgenio *addio)
 {
-  point pa, pb, pc, pd;
-  enum locateresult loc = OUTSIDE;
-  REAL vol, ori1, ori2 = 0, ori3 = 0, ori4 = 0;
-  int t1ver;
-
-
-  // Randomly select a good starting tet.
-  if (randflag) {
-    randomsample(searchpt, searchtet);
-  } else {
-    if (searchtet->tet == NULL) {
-      *searchtet = recenttet;
-    }
-  }
-  loc = locate(searchpt, searchtet);
+  point *insertarray, newpt;
+  REAL x, y, z, w;
+  int index, attribindex, mtrindex;
+  int arylen, i, j;
 
-  if (loc == OUTSIDE) {
-    if (b->convex) { // -c option
-      // The point lies outside of the convex hull.
-      return (int) loc;
-    }
-    // Test if it lies nearly on the hull face.
-    // Reuse vol, ori1.
-    pa = org(*searchtet);
-    pb = dest(*searchtet);
-    pc = apex(*searchtet);
-    vol = triarea(pa, pb, pc);
-    ori1 = orient3dfast(pa, pb, pc, searchpt);
-    if (fabs(ori1 / vol) < b->epsilon) {
-      loc = ONFACE; // On face (or on edge, or on vertex).
-      fsymself(*searchtet);
-    }
+  if (!b->quiet) {
+    printf("Inserting constrained points ...\n");
   }
 
-  if (loc != OUTSIDE) {
-    // Round the result of location.
-    pa = org(*searchtet);
-    pb = dest(*searchtet);
-    pc = apex(*searchtet);
-    pd = oppo(*searchtet);
-    vol = orient3dfast(pa, pb, pc, pd);
-    ori1 = orient3dfast(pa, pb, pc, searchpt);
-    ori2 = orient3dfast(pb, pa, pd, searchpt);
-    ori3 = orient3dfast(pc, pb, pd, searchpt);
-    ori4 = orient3dfast(pa, pc, pd, searchpt);
-    if (fabs(ori1 / vol) < b->epsilon) ori1 = 0;
-    if (fabs(ori2 / vol) < b->epsilon) ori2 = 0;
-    if (fabs(ori3 / vol) < b->epsilon) ori3 = 0;
-    if (fabs(ori4 / vol) < b->epsilon) ori4 = 0;
-  } else { // if (loc == OUTSIDE) {
-    // Do a brute force search for the point (with rounding).
-    tetrahedrons->traversalinit();
-    searchtet->tet = tetrahedrontraverse();
-    while (searchtet->tet != NULL) {
-      pa = org(*searchtet);
-      pb = dest(*searchtet);
-      pc = apex(*searchtet);
-      pd = oppo(*searchtet);
+  insertarray = new point[addio->numberofpoints];
+  arylen = 0;
+  index = 0;
+  attribindex = 0;
+  mtrindex = 0;
 
-      vol = orient3dfast(pa, pb, pc, pd); 
-      if (vol < 0) {
-        ori1 = orient3dfast(pa, pb, pc, searchpt);
-        if (fabs(ori1 / vol) < b->epsilon) ori1 = 0; // Rounding.
-        if (ori1 <= 0) {
-          ori2 = orient3dfast(pb, pa, pd, searchpt);
-          if (fabs(ori2 / vol) < b->epsilon) ori2 = 0;
-          if (ori2 <= 0) {
-            ori3 = orient3dfast(pc, pb, pd, searchpt);
-            if (fabs(ori3 / vol) < b->epsilon) ori3 = 0;
-            if (ori3 <= 0) {
-              ori4 = orient3dfast(pa, pc, pd, searchpt);
-              if (fabs(ori4 / vol) < b->epsilon) ori4 = 0;
-              if (ori4 <= 0) {
-                // Found the tet. Return its location. 
-                break;
-              } // ori4
-            } // ori3
-          } // ori2
-        } // ori1
+  for (i = 0; i < addio->numberofpoints; i++) {
+    x = addio->pointlist[index++];
+    y = addio->pointlist[index++];
+    z = addio->pointlist[index++];
+    // Test if this point lies inside the bounding box.
+    if ((x < xmin) || (x > xmax) || (y < ymin) || (y > ymax) ||
+        (z < zmin) || (z > zmax)) {
+      if (b->verbose) {
+        printf("Warning:  Point #%d lies outside the bounding box. Ignored\n",
+               i + in->firstnumber);
       }
-
-      searchtet->tet = tetrahedrontraverse();
-    } // while (searchtet->tet != NULL)
-    nonregularcount++;  // Re-use this counter.
-  }
-
-  if (searchtet->tet != NULL) {
-    // Return the point location.
-    if (ori1 == 0) { // on face [a,b,c]
-      if (ori2 == 0) { // on edge [a,b].
-        if (ori3 == 0) { // on vertex [b].
-          enextself(*searchtet); // [b,c,a,d]
-          loc = ONVERTEX;
-        } else {
-          if (ori4 == 0) { // on vertex [a]
-            loc =  ONVERTEX; // [a,b,c,d]
-          } else {    
-            loc =  ONEDGE; // [a,b,c,d]
-          }
-        }
-      } else { // ori2 != 0
-        if (ori3 == 0) { // on edge [b,c]
-          if (ori4 == 0) { // on vertex [c]
-            eprevself(*searchtet); // [c,a,b,d]
-            loc =  ONVERTEX;
-          } else {
-            enextself(*searchtet); // [b,c,a,d]
-            loc =  ONEDGE;
-          }
-        } else { // ori3 != 0
-          if (ori4 == 0) { // on edge [c,a]
-            eprevself(*searchtet); // [c,a,b,d]
-            loc =  ONEDGE;
-          } else {
-            loc =  ONFACE;
-          }
-        }
+      continue;
+    }
+    makepoint(&newpt, UNUSEDVERTEX);
+    newpt[0] = x;
+    newpt[1] = y;
+    newpt[2] = z;
+    // Read the point attributes. (Including point weights.)
+    for (j = 0; j < addio->numberofpointattributes; j++) {
+      newpt[3 + j] = addio->pointattributelist[attribindex++];
+    }
+    // Read the point metric tensor.
+    for (j = 0; j < addio->numberofpointmtrs; j++) {
+      newpt[pointmtrindex + j] = addio->pointmtrlist[mtrindex++];
+    }
+    if (b->weighted) { // -w option
+      if (addio->numberofpointattributes > 0) {
+        // The first point attribute is its weight.
+        w = newpt[3];
+      } else {
+        // No given weight available. Default choose the maximum
+        //   absolute value among its coordinates.        
+        w = fabs(x);
+        if (w < fabs(y)) w = fabs(y);
+        if (w < fabs(z)) w = fabs(z);
       }
-    } else { // ori1 != 0
-      if (ori2 == 0) { // on face [b,a,d]
-        esymself(*searchtet); // [b,a,d,c]
-        if (ori3 == 0) { // on edge [b,d]
-          eprevself(*searchtet); // [d,b,a,c]
-          if (ori4 == 0) { // on vertex [d]                      
-            loc =  ONVERTEX;
-          } else {
-            loc =  ONEDGE;
-          }
-        } else { // ori3 != 0
-          if (ori4 == 0) { // on edge [a,d]
-            enextself(*searchtet); // [a,d,b,c]
-            loc =  ONEDGE;
-          } else {
-            loc =  ONFACE;
-          }
-        }
-      } else { // ori2 != 0
-        if (ori3 == 0) { // on face [c,b,d]
-          enextself(*searchtet);
-          esymself(*searchtet);
-          if (ori4 == 0) { // on edge [c,d]
-            eprevself(*searchtet);
-            loc =  ONEDGE;
-          } else {
-            loc =  ONFACE;
-          }
-        } else {
-          if (ori4 == 0) { // on face [a,c,d]
-            eprevself(*searchtet);
-            esymself(*searchtet);
-            loc =  ONFACE;
-          } else { // inside tet [a,b,c,d]
-            loc =  INTETRAHEDRON;
-          } // ori4
-        } // ori3
-      } // ori2
-    } // ori1
-  } else {
-    loc = OUTSIDE;
+      if (b->weighted_param == 0) {
+        newpt[3] = x * x + y * y + z * z - w; // Weighted DT.
+      } else { // -w1 option
+        newpt[3] = w;  // Regular tetrahedralization.
+      }
+    }
+    insertarray[arylen] = newpt;
+    arylen++;
+  } // i
+
+  // Insert the points.
+  int rejflag = 0;  // Do not check encroachment.
+  if (b->metric) { // -m option.
+    rejflag |= 4; // Reject it if it lies in some protecting balls.
   }
 
-  return (int) loc;
+  insertconstrainedpoints(insertarray, arylen, rejflag);
+
+  delete [] insertarray;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// getpointmeshsize()    Interpolate the mesh size at given point.           //
-//                                                                           //
-// 'iloc' indicates the location of the point w.r.t. 'searchtet'.  The size  //
-// is obtained by linear interpolation on the vertices of the tet.           //
+// meshcoarsening()    Deleting (selected) vertices.                         //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-REAL tetgenmesh::getpointmeshsize(point searchpt, triface *searchtet, int iloc)
+void tetgenmesh::collectremovepoints(arraypool *remptlist)
 {
-  point *pts, pa, pb, pc;
-  REAL volume, vol[4], wei[4];
-  REAL size;
-  int i;
+  point ptloop, *parypt;
+  verttype vt;
 
-  size = 0;
+  // If a mesh sizing function is given. Collect vertices whose mesh size
+  //   is greater than its smallest edge length.
+  if (b->metric) { // -m option
+    REAL len, smlen;
+    int i;
+    points->traversalinit();
+    ptloop = pointtraverse();
+    while (ptloop != NULL) {
+      if (ptloop[pointmtrindex] > 0) {
+        // Get the smallest edge length at this vertex.
+        getvertexstar(1, ptloop, cavetetlist, cavetetvertlist, NULL);
+        parypt = (point *) fastlookup(cavetetvertlist, 0);
+        smlen = distance(ptloop, *parypt);
+        for (i = 1; i < cavetetvertlist->objects; i++) {
+          parypt = (point *) fastlookup(cavetetvertlist, i);
+          len = distance(ptloop, *parypt);
+          if (len < smlen) {
+            smlen = len;
+          }
+        }
+        cavetetvertlist->restart();
+        cavetetlist->restart();
+        if (smlen < ptloop[pointmtrindex]) {
+          pinfect(ptloop);
+          remptlist->newindex((void **) &parypt);
+          *parypt = ptloop;
+        }
+      }
+      ptloop = pointtraverse();
+    }
+    if (b->verbose > 1) {
+      printf("    Coarsen %ld oversized points.\n", remptlist->objects); 
+    }
+  }
 
-  if (iloc == (int) INTETRAHEDRON) {
-    pts = (point *) &(searchtet->tet[4]);
-    // Only do interpolation if all vertices have non-zero sizes.
-    if ((pts[0][pointmtrindex] > 0) && (pts[1][pointmtrindex] > 0) &&
-        (pts[2][pointmtrindex] > 0) && (pts[3][pointmtrindex] > 0)) {
-      // P1 interpolation.
-      volume = orient3dfast(pts[0], pts[1], pts[2], pts[3]);
-      vol[0] = orient3dfast(searchpt, pts[1], pts[2], pts[3]);
-      vol[1] = orient3dfast(pts[0], searchpt, pts[2], pts[3]);
-      vol[2] = orient3dfast(pts[0], pts[1], searchpt, pts[3]);
-      vol[3] = orient3dfast(pts[0], pts[1], pts[2], searchpt);
-      for (i = 0; i < 4; i++) {
-        wei[i] = fabs(vol[i] / volume);
-        size += (wei[i] * pts[i][pointmtrindex]);
+  // If 'in->pointmarkerlist' exists, Collect vertices with markers '-1'.
+  if (in->pointmarkerlist != NULL) {
+    long bak_count = remptlist->objects;
+    points->traversalinit();
+    ptloop = pointtraverse();
+    int index = 0;
+    while (ptloop != NULL) {
+      if (index < in->numberofpoints) {
+        if (in->pointmarkerlist[index] == -1) {
+          pinfect(ptloop);
+          remptlist->newindex((void **) &parypt);
+          *parypt = ptloop;
+        }
+      } else {
+        // Remaining are not input points. Stop here.
+        break; 
       }
+      index++;
+      ptloop = pointtraverse();
     }
-  } else if (iloc == (int) ONFACE) {
-    pa = org(*searchtet);
-    pb = dest(*searchtet);
-    pc = apex(*searchtet);
-    if ((pa[pointmtrindex] > 0) && (pb[pointmtrindex] > 0) &&
-        (pc[pointmtrindex] > 0)) {
-      volume = triarea(pa, pb, pc);
-      vol[0] = triarea(searchpt, pb, pc);
-      vol[1] = triarea(pa, searchpt, pc);
-      vol[2] = triarea(pa, pb, searchpt);
-      size = (vol[0] / volume) * pa[pointmtrindex]
-           + (vol[1] / volume) * pb[pointmtrindex]
-           + (vol[2] / volume) * pc[pointmtrindex];
+    if (b->verbose > 1) {
+      printf("    Coarsen %ld marked points.\n", remptlist->objects - bak_count); 
     }
-  } else if (iloc == (int) ONEDGE) {
-    pa = org(*searchtet);
-    pb = dest(*searchtet);
-    if ((pa[pointmtrindex] > 0) && (pb[pointmtrindex] > 0)) {
-      volume = distance(pa, pb);
-      vol[0] = distance(searchpt, pb);
-      vol[1] = distance(pa, searchpt);
-      size = (vol[0] / volume) * pa[pointmtrindex]
-           + (vol[1] / volume) * pb[pointmtrindex];
+  } // if (in->pointmarkerlist != NULL)
+
+  if (b->coarsen_param > 0) { // -R1/#
+    // Remove a coarsen_percent number of interior points.
+    if (b->verbose > 1) {
+      printf("    Coarsen %g percent of interior points.\n", 
+             b->coarsen_percent * 100.0);
     }
-  } else if (iloc == (int) ONVERTEX) {
-    pa = org(*searchtet);
-    if (pa[pointmtrindex] > 0) {
-      size = pa[pointmtrindex];
+    arraypool *intptlist = new arraypool(sizeof(point *), 10);
+    // Count the total number of interior points.
+    points->traversalinit();
+    ptloop = pointtraverse();
+    while (ptloop != NULL) {
+      vt = pointtype(ptloop);
+      if ((vt == VOLVERTEX) || (vt == FREEVOLVERTEX) || 
+          (vt == FREEFACETVERTEX) || (vt == FREESEGVERTEX)) {
+        intptlist->newindex((void **) &parypt);
+        *parypt = ptloop;
+      }
+      ptloop = pointtraverse();
+    }
+    if (intptlist->objects > 0l) {
+      // Sort the list of points randomly.
+      point *parypt_i, swappt;
+      int randindex, i;
+      srand(intptlist->objects);
+      for (i = 0; i < intptlist->objects; i++) {
+        randindex = rand() % (i + 1); // randomnation(i + 1);
+        parypt_i = (point *) fastlookup(intptlist, i); 
+        parypt = (point *) fastlookup(intptlist, randindex);
+        // Swap this two points.
+        swappt = *parypt_i;
+        *parypt_i = *parypt;
+        *parypt = swappt;
+      }
+      int remcount = (int) ((REAL) intptlist->objects * b->coarsen_percent);
+      // Return the first remcount points.
+      for (i = 0; i < remcount; i++) {
+        parypt_i = (point *) fastlookup(intptlist, i);
+        if (!pinfected(*parypt_i)) {
+          pinfected(*parypt_i);
+          remptlist->newindex((void **) &parypt);
+          *parypt = *parypt_i;
+        }
+      }
     }
+    delete intptlist;
   }
 
-  return size;
+  // Unmark all collected vertices.
+  for (int i = 0; i < remptlist->objects; i++) {
+    parypt = (point *) fastlookup(remptlist, i);
+    puninfect(*parypt);
+  }
 }
 
-///////////////////////////////////////////////////////////////////////////////
-//                                                                           //
-// interpolatemeshsize()    Interpolate the mesh size from a background mesh //
-//                          (source) to the current mesh (destination).      //
-//                                                                           //
-///////////////////////////////////////////////////////////////////////////////
-
-void tetgenmesh::interpolatemeshsize()
+void tetgenmesh::meshcoarsening()
 {
-  triface searchtet;
-  point ploop;
-  REAL minval = 0.0, maxval = 0.0;
-  int iloc;
-  int count;
+  arraypool *remptlist;
 
   if (!b->quiet) {
-    printf("Interpolating mesh size ...\n");
+    printf("Mesh coarsening ...\n");
+  }
+
+  // Collect the set of points to be removed
+  remptlist = new arraypool(sizeof(point *), 10);
+  collectremovepoints(remptlist);
+
+  if (remptlist->objects == 0l) {
+    delete remptlist;
+    return;
+  }
+
+  if (b->verbose) {
+    if (remptlist->objects > 0l) {
+      printf("  Removing %ld points...\n", remptlist->objects);
+    }
   }
 
-  long bak_nonregularcount = nonregularcount;
-  nonregularcount = 0l; // Count the number of (slow) global searches.
-  long baksmaples = bgm->samples;
-  bgm->samples = 3l;
-  count = 0; // Count the number of interpolated points.
+  point *parypt, *plastpt;
+  long ms = remptlist->objects;
+  int nit = 0; 
+  int bak_fliplinklevel = b->fliplinklevel;
+  b->fliplinklevel = -1;
+  autofliplinklevel = 1; // Init value.
+  int i;
 
-  // Interpolate sizes for all points in the current mesh.
-  points->traversalinit();
-  ploop = pointtraverse();
-  while (ploop != NULL) {
-    // Search a tet in bgm which containing this point.
-    searchtet.tet = NULL;
-    iloc = bgm->scoutpoint(ploop, &searchtet, 1); // randflag = 1
-    if (iloc != (int) OUTSIDE) {
-      // Interpolate the mesh size.
-      ploop[pointmtrindex] = bgm->getpointmeshsize(ploop, &searchtet, iloc);
-      setpoint2bgmtet(ploop, bgm->encode(searchtet));
-      if (count == 0) {
-        // This is the first interpolated point.
-        minval = maxval = ploop[pointmtrindex];
-      } else {
-        if (ploop[pointmtrindex] < minval) {
-          minval = ploop[pointmtrindex];
+  while (1) {
+  
+    if (b->verbose > 1) {
+      printf("    Removing points [%s level = %2d] #:  %ld.\n", 
+             (b->fliplinklevel > 0) ? "fixed" : "auto",
+             (b->fliplinklevel > 0) ? b->fliplinklevel : autofliplinklevel,
+             remptlist->objects);
+    }
+
+    // Remove the list of points.
+    for (i = 0; i < remptlist->objects; i++) {
+      parypt = (point *) fastlookup(remptlist, i);
+      if (removevertexbyflips(*parypt)) {
+        // Move the last entry to the current place.
+        plastpt = (point *) fastlookup(remptlist, remptlist->objects - 1);
+        *parypt = *plastpt;
+        remptlist->objects--;
+        i--;
+      }
+    }
+
+    if (remptlist->objects > 0l) {
+      if (b->fliplinklevel >= 0) {
+        break; // We have tried all levels.
+      }
+      if (remptlist->objects == ms) {
+        nit++;
+        if (nit >= 3) {
+          // Do the last round with unbounded flip link level.
+          b->fliplinklevel = 100000;
         }
-        if (ploop[pointmtrindex] > maxval) {
-          maxval = ploop[pointmtrindex];
+      } else {
+        ms = remptlist->objects;
+        if (nit > 0) {
+          nit--;
         }
       }
-      count++;
+      autofliplinklevel+=b->fliplinklevelinc;
     } else {
-      if (!b->quiet) {
-        printf("Warnning:  Failed to locate point %d in source mesh.\n",
-               pointmark(ploop));
-      }
+      // All points are removed.
+      break;
     }
-    ploop = pointtraverse();
-  }
+  } // while (1)
 
-  if (b->verbose) {
-    printf("  Interoplated %d points.\n", count);
-    if (nonregularcount > 0l) {
-      printf("  Performed %ld brute-force searches.\n", nonregularcount);
+  if (remptlist->objects > 0l) {
+    if (b->verbose) {
+      printf("  %ld points are not removed !\n", remptlist->objects);
     }
-    printf("  Size rangle [%.17g, %.17g].\n", minval, maxval);
   }
 
-  bgm->samples = baksmaples;
-  nonregularcount = bak_nonregularcount;
+  b->fliplinklevel = bak_fliplinklevel;
+  delete remptlist;
 }
 
+////                                                                       ////
+////                                                                       ////
+//// reconstruct_cxx //////////////////////////////////////////////////////////
+
+//// refine_cxx ///////////////////////////////////////////////////////////////
+////                                                                       ////
+////                                                                       ////
+
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// insertconstrainedpoints()    Insert a list of points into the mesh.       //
+// makefacetverticesmap()    Create a map from facet to its vertices.        //
 //                                                                           //
-// Assumption:  The bounding box of the insert point set should be no larger //
-// than the bounding box of the mesh.  (Required by point sorting).          //
+// All facets will be indexed (starting from 0).  The map is saved in two    //
+// global arrays: 'idx2facetlist' and 'facetverticeslist'.                   //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-void tetgenmesh::insertconstrainedpoints(point *insertarray, int arylen,
-                                         int rejflag)
+void tetgenmesh::makefacetverticesmap()
 {
-  triface searchtet, spintet;
-  face splitsh;
-  face splitseg;
-  insertvertexflags ivf;
-  flipconstraints fc;
-  int randflag = 0;
-  int t1ver;
-  int i;
+  arraypool *facetvertexlist, *vertlist, **paryvertlist;
+  face subloop, neighsh, *parysh, *parysh1;
+  point pa, *ppt, *parypt;
+  verttype vt;
+  int facetindex, totalvertices;
+  int i, j, k;
 
   if (b->verbose) {
-    printf("  Inserting %d constrained points\n", arylen);
-  }
-
-  if (b->no_sort) { // -b/1 option.
-    if (b->verbose) {
-      printf("  Using the input order.\n"); 
-    }
-  } else {
-    if (b->verbose) {
-      printf("  Permuting vertices.\n"); 
-    }
-    point swappoint;
-    int randindex;
-    srand(arylen);
-    for (i = 0; i < arylen; i++) {
-      randindex = rand() % (i + 1); 
-      swappoint = insertarray[i];
-      insertarray[i] = insertarray[randindex];
-      insertarray[randindex] = swappoint;
-    }
-    if (b->brio_hilbert) { // -b1 option
-      if (b->verbose) {
-        printf("  Sorting vertices.\n"); 
-      }
-      hilbert_init(in->mesh_dim);
-      int ngroup = 0; 
-      brio_multiscale_sort(insertarray, arylen, b->brio_threshold, 
-                           b->brio_ratio, &ngroup);
-    } else { // -b0 option.
-      randflag = 1;
-    } // if (!b->brio_hilbert)
-  } // if (!b->no_sort)
-
-  long bak_nonregularcount = nonregularcount;
-  nonregularcount = 0l;
-  long baksmaples = samples;
-  samples = 3l; // Use at least 3 samples. Updated in randomsample().
-
-  long bak_seg_count = st_segref_count;
-  long bak_fac_count = st_facref_count;
-  long bak_vol_count = st_volref_count;
-
-  // Initialize the insertion parameters. 
-  if (b->incrflip) { // -l option
-    // Use incremental flip algorithm.
-    ivf.bowywat = 0; 
-    ivf.lawson = 1;
-    ivf.validflag = 0; // No need to validate the cavity.
-    fc.enqflag = 2;
-  } else {
-    // Use Bowyer-Watson algorithm.
-    ivf.bowywat = 1; 
-    ivf.lawson = 0;
-    ivf.validflag = 1; // Validate the B-W cavity.
+    printf("  Creating the facet vertices map.\n");
   }
-  ivf.rejflag = rejflag;
-  ivf.chkencflag = 0; 
-  ivf.sloc = (int) INSTAR;
-  ivf.sbowywat = 3; 
-  ivf.splitbdflag = 1;
-  ivf.respectbdflag = 1;
-  ivf.assignmeshsize = b->metric;
-
-  encseglist = new arraypool(sizeof(face), 8);
-  encshlist = new arraypool(sizeof(badface), 8);
 
-  // Insert the points.
-  for (i = 0; i < arylen; i++) {
-    // Find the location of the inserted point.
-    // Do not use 'recenttet', since the mesh may be non-convex.
-    searchtet.tet = NULL; 
-    ivf.iloc = scoutpoint(insertarray[i], &searchtet, randflag);
+  facetvertexlist = new arraypool(sizeof(arraypool *), 10);
+  facetindex = totalvertices = 0;
 
-    // Decide the right type for this point.
-    setpointtype(insertarray[i], FREEVOLVERTEX); // Default.
-    splitsh.sh = NULL;
-    splitseg.sh = NULL;
-    if (ivf.iloc == (int) ONEDGE) {
-      if (issubseg(searchtet)) {
-        tsspivot1(searchtet, splitseg);
-        setpointtype(insertarray[i], FREESEGVERTEX);
-        //ivf.rejflag = 0;
-      } else {
-        // Check if it is a subface edge.
-        spintet = searchtet;
-        while (1) {
-          if (issubface(spintet)) {
-            tspivot(spintet, splitsh);
-            setpointtype(insertarray[i], FREEFACETVERTEX);
-            //ivf.rejflag |= 1;
-            break;
-          }
-          fnextself(spintet);
-          if (spintet.tet == searchtet.tet) break;
+  subfaces->traversalinit();
+  subloop.sh = shellfacetraverse(subfaces);
+  while (subloop.sh != NULL) {
+    if (!sinfected(subloop)) {
+      // A new facet. Create its vertices list.
+      vertlist = new arraypool(sizeof(point *), 8);
+      ppt = (point *) &(subloop.sh[3]);
+      for (k = 0; k < 3; k++) {
+        vt = pointtype(ppt[k]);
+        if ((vt != FREESEGVERTEX) && (vt != FREEFACETVERTEX)) {
+          pinfect(ppt[k]);
+          vertlist->newindex((void **) &parypt);
+          *parypt = ppt[k];
+        }
+      }
+      sinfect(subloop);
+      caveshlist->newindex((void **) &parysh);
+      *parysh = subloop;
+      for (i = 0; i < caveshlist->objects; i++) {
+        parysh = (face *) fastlookup(caveshlist, i);
+        setfacetindex(*parysh, facetindex);
+        for (j = 0; j < 3; j++) {
+          if (!isshsubseg(*parysh)) {
+            spivot(*parysh, neighsh);
+            if (!sinfected(neighsh)) {
+              pa = sapex(neighsh);
+              if (!pinfected(pa)) {
+                vt = pointtype(pa);
+                if ((vt != FREESEGVERTEX) && (vt != FREEFACETVERTEX)) {
+                  pinfect(pa);
+                  vertlist->newindex((void **) &parypt);
+                  *parypt = pa;
+                }
+              }
+              sinfect(neighsh);
+              caveshlist->newindex((void **) &parysh1);
+              *parysh1 = neighsh;
+            }
+          }
+          senextself(*parysh);
         }
+      } // i
+      totalvertices += (int) vertlist->objects;
+      // Uninfect facet vertices.
+      for (k = 0; k < vertlist->objects; k++) {
+        parypt = (point *) fastlookup(vertlist, k);
+        puninfect(*parypt);
       }
-    } else if (ivf.iloc == (int) ONFACE) {
-      if (issubface(searchtet)) {
-        tspivot(searchtet, splitsh);
-        setpointtype(insertarray[i], FREEFACETVERTEX);
-        //ivf.rejflag |= 1;
-      }
-    }
-
-    // Now insert the point.
-    if (insertpoint(insertarray[i], &searchtet, &splitsh, &splitseg, &ivf)) {
-      if (flipstack != NULL) {
-        // There are queued faces. Use flips to recover Delaunayness.
-        lawsonflip3d(&fc);
-        // There may be unflippable edges. Ignore them.
-        unflipqueue->restart();
-      }
-      // Update the Steiner counters.
-      if (pointtype(insertarray[i]) == FREESEGVERTEX) {
-        st_segref_count++;
-      } else if (pointtype(insertarray[i]) == FREEFACETVERTEX) {
-        st_facref_count++;
-      } else {
-        st_volref_count++;
-      }
-    } else {
-      // Point is not inserted.
-      //pointdealloc(insertarray[i]);
-      setpointtype(insertarray[i], UNUSEDVERTEX);
-      unuverts++;
-      encseglist->restart();
-      encshlist->restart();
-    }
-  } // i
+      caveshlist->restart();
+      // Save this vertex list.
+      facetvertexlist->newindex((void **) &paryvertlist);
+      *paryvertlist = vertlist;
+      facetindex++;
+    } 
+    subloop.sh = shellfacetraverse(subfaces);
+  }
 
-  delete encseglist;
-  delete encshlist;
+  // All subfaces are infected. Uninfect them.
+  subfaces->traversalinit();
+  subloop.sh = shellfacetraverse(subfaces);
+  while (subloop.sh != NULL) {
+    suninfect(subloop);
+    subloop.sh = shellfacetraverse(subfaces);
+  }
 
   if (b->verbose) {
-    printf("  Inserted %ld (%ld, %ld, %ld) vertices.\n", 
-           st_segref_count + st_facref_count + st_volref_count - 
-           (bak_seg_count + bak_fac_count + bak_vol_count),
-           st_segref_count - bak_seg_count, st_facref_count - bak_fac_count,
-           st_volref_count - bak_vol_count);
-    if (nonregularcount > 0l) {
-      printf("  Performed %ld brute-force searches.\n", nonregularcount);
+    printf("  Found %ld facets.\n", facetvertexlist->objects);
+  }
+
+  idx2facetlist = new int[facetindex + 1];
+  facetverticeslist = new point[totalvertices];
+
+  totalworkmemory += ((facetindex + 1) * sizeof(int) + 
+                      totalvertices * sizeof(point *));
+
+  idx2facetlist[0] = 0;
+  for (i = 0, k = 0; i < facetindex; i++) {
+    paryvertlist = (arraypool **) fastlookup(facetvertexlist, i);
+    vertlist = *paryvertlist;
+    idx2facetlist[i + 1] = (idx2facetlist[i] + (int) vertlist->objects);
+    for (j = 0; j < vertlist->objects; j++) {
+      parypt = (point *) fastlookup(vertlist, j);
+      facetverticeslist[k] = *parypt;
+      k++;
     }
   }
 
-  nonregularcount = bak_nonregularcount;
-  samples = baksmaples; 
+  // Free the lists.
+  for (i = 0; i < facetvertexlist->objects; i++) {
+    paryvertlist = (arraypool **) fastlookup(facetvertexlist, i);
+    vertlist = *paryvertlist;
+    delete vertlist;
+  }
+  delete facetvertexlist;
 }
 
-void tetgenmesh::insertconstrainedpoints(tetgenio *addio)
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// Check whether two segments, or a segment and a facet, or two facets are   //
+// adjacent to each other.                                                   //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+int tetgenmesh::segsegadjacent(face *seg1, face *seg2)
 {
-  point *insertarray, newpt;
-  REAL x, y, z, w;
-  int index, attribindex, mtrindex;
-  int arylen, i, j;
+  int segidx1 = getfacetindex(*seg1);
+  int segidx2 = getfacetindex(*seg2);
 
-  if (!b->quiet) {
-    printf("Inserting constrained points ...\n");
+  if (segidx1 == segidx2) return 0;
+
+  point pa1 = segmentendpointslist[segidx1 * 2];
+  point pb1 = segmentendpointslist[segidx1 * 2 + 1];
+  point pa2 = segmentendpointslist[segidx2 * 2];
+  point pb2 = segmentendpointslist[segidx2 * 2 + 1];
+
+  if ((pa1 == pa2) || (pa1 == pb2) || (pb1 == pa2) || (pb1 == pb2)) {
+    return 1;
   }
+  return 0; 
+}
 
-  insertarray = new point[addio->numberofpoints];
-  arylen = 0;
-  index = 0;
-  attribindex = 0;
-  mtrindex = 0;
+int tetgenmesh::segfacetadjacent(face *subseg, face *subsh)
+{
+  int segidx = getfacetindex(*subseg);
+  point pa = segmentendpointslist[segidx * 2];
+  point pb = segmentendpointslist[segidx * 2 + 1];
 
-  for (i = 0; i < addio->numberofpoints; i++) {
-    x = addio->pointlist[index++];
-    y = addio->pointlist[index++];
-    z = addio->pointlist[index++];
-    // Test if this point lies inside the bounding box.
-    if ((x < xmin) || (x > xmax) || (y < ymin) || (y > ymax) ||
-        (z < zmin) || (z > zmax)) {
-      if (b->verbose) {
-        printf("Warning:  Point #%d lies outside the bounding box. Ignored\n",
-               i + in->firstnumber);
-      }
-      continue;
-    }
-    makepoint(&newpt, UNUSEDVERTEX);
-    newpt[0] = x;
-    newpt[1] = y;
-    newpt[2] = z;
-    // Read the point attributes. (Including point weights.)
-    for (j = 0; j < addio->numberofpointattributes; j++) {
-      newpt[3 + j] = addio->pointattributelist[attribindex++];
-    }
-    // Read the point metric tensor.
-    for (j = 0; j < addio->numberofpointmtrs; j++) {
-      newpt[pointmtrindex + j] = addio->pointmtrlist[mtrindex++];
-    }
-    if (b->weighted) { // -w option
-      if (addio->numberofpointattributes > 0) {
-        // The first point attribute is its weight.
-        w = newpt[3];
-      } else {
-        // No given weight available. Default choose the maximum
-        //   absolute value among its coordinates.        
-        w = fabs(x);
-        if (w < fabs(y)) w = fabs(y);
-        if (w < fabs(z)) w = fabs(z);
-      }
-      if (b->weighted_param == 0) {
-        newpt[3] = x * x + y * y + z * z - w; // Weighted DT.
-      } else { // -w1 option
-        newpt[3] = w;  // Regular tetrahedralization.
-      }
-    }
-    insertarray[arylen] = newpt;
-    arylen++;
-  } // i
+  pinfect(pa);
+  pinfect(pb);
 
-  // Insert the points.
-  int rejflag = 0;  // Do not check encroachment.
-  if (b->metric) { // -m option.
-    rejflag |= 4; // Reject it if it lies in some protecting balls.
-  }
+  int fidx = getfacetindex(*subsh);
+  int count = 0, i;
 
-  insertconstrainedpoints(insertarray, arylen, rejflag);
+  for (i = idx2facetlist[fidx]; i < idx2facetlist[fidx+1]; i++) {
+    if (pinfected(facetverticeslist[i])) count++;
+  } 
 
-  delete [] insertarray;
-}
+  puninfect(pa);
+  puninfect(pb);
 
-///////////////////////////////////////////////////////////////////////////////
-//                                                                           //
-// meshcoarsening()    Deleting (selected) vertices.                         //
-//                                                                           //
-///////////////////////////////////////////////////////////////////////////////
+  return count == 1;
+}
 
-void tetgenmesh::collectremovepoints(arraypool *remptlist)
+int tetgenmesh::facetfacetadjacent(face *subsh1, face *subsh2)
 {
-  point ptloop, *parypt;
-  verttype vt;
+  int count = 0, i;
 
-  // If a mesh sizing function is given. Collect vertices whose mesh size
-  //   is greater than its smallest edge length.
-  if (b->metric) { // -m option
-    REAL len, smlen;
-    int i;
-    points->traversalinit();
-    ptloop = pointtraverse();
-    while (ptloop != NULL) {
-      if (ptloop[pointmtrindex] > 0) {
-        // Get the smallest edge length at this vertex.
-        getvertexstar(1, ptloop, cavetetlist, cavetetvertlist, NULL);
-        parypt = (point *) fastlookup(cavetetvertlist, 0);
-        smlen = distance(ptloop, *parypt);
-        for (i = 1; i < cavetetvertlist->objects; i++) {
-          parypt = (point *) fastlookup(cavetetvertlist, i);
-          len = distance(ptloop, *parypt);
-          if (len < smlen) {
-            smlen = len;
-          }
-        }
-        cavetetvertlist->restart();
-        cavetetlist->restart();
-        if (smlen < ptloop[pointmtrindex]) {
-          pinfect(ptloop);
-          remptlist->newindex((void **) &parypt);
-          *parypt = ptloop;
-        }
-      }
-      ptloop = pointtraverse();
-    }
-    if (b->verbose > 1) {
-      printf("    Coarsen %ld oversized points.\n", remptlist->objects); 
-    }
+  int fidx1 = getfacetindex(*subsh1);
+  int fidx2 = getfacetindex(*subsh2);
+
+  if (fidx1 == fidx2) return 0;
+
+  for (i = idx2facetlist[fidx1]; i < idx2facetlist[fidx1+1]; i++) {
+    pinfect(facetverticeslist[i]);
+  }
+
+  for (i = idx2facetlist[fidx2]; i < idx2facetlist[fidx2+1]; i++) {
+    if (pinfected(facetverticeslist[i])) count++;
   }
 
-  // If 'in->pointmarkerlist' exists, Collect vertices with markers '-1'.
-  if (in->pointmarkerlist != NULL) {
-    long bak_count = remptlist->objects;
-    points->traversalinit();
-    ptloop = pointtraverse();
-    int index = 0;
-    while (ptloop != NULL) {
-      if (index < in->numberofpoints) {
-        if (in->pointmarkerlist[index] == -1) {
-          pinfect(ptloop);
-          remptlist->newindex((void **) &parypt);
-          *parypt = ptloop;
-        }
-      } else {
-        // Remaining are not input points. Stop here.
-        break; 
-      }
-      index++;
-      ptloop = pointtraverse();
-    }
-    if (b->verbose > 1) {
-      printf("    Coarsen %ld marked points.\n", remptlist->objects - bak_count); 
-    }
-  } // if (in->pointmarkerlist != NULL)
+  // Uninfect the vertices.
+  for (i = idx2facetlist[fidx1]; i < idx2facetlist[fidx1+1]; i++) {
+    puninfect(facetverticeslist[i]);
+  }
+
+  return count > 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// save_segmentpoint_insradius(), save_facetpoint_insradius()                //
+//                                                                           //
+// Determine and save the relaxed insertion radius of a Steiner point on a   //
+// segment or a facet.  By default, it is the closet distance to the parent  //
+// point of this Steiner point. But may be larger than it.                   //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
 
-  if (b->coarsen_param > 0) { // -R1/#
-    // Remove a coarsen_percent number of interior points.
-    if (b->verbose > 1) {
-      printf("    Coarsen %g percent of interior points.\n", 
-             b->coarsen_percent * 100.0);
-    }
-    arraypool *intptlist = new arraypool(sizeof(point *), 10);
-    // Count the total number of interior points.
-    points->traversalinit();
-    ptloop = pointtraverse();
-    while (ptloop != NULL) {
-      vt = pointtype(ptloop);
-      if ((vt == VOLVERTEX) || (vt == FREEVOLVERTEX) || 
-          (vt == FREEFACETVERTEX) || (vt == FREESEGVERTEX)) {
-        intptlist->newindex((void **) &parypt);
-        *parypt = ptloop;
+void tetgenmesh::save_segmentpoint_insradius(point segpt,point parentpt,REAL r)
+{
+  REAL rv = r, rp;
+  if (pointtype(parentpt) == FREESEGVERTEX) {
+    face parentseg1, parentseg2;
+    sdecode(point2sh(segpt), parentseg1);
+    sdecode(point2sh(parentpt), parentseg2);
+    if (segsegadjacent(&parentseg1, &parentseg2)) {
+      rp = getpointinsradius(parentpt);
+      if (rv < rp) {
+        // The relaxed insertion radius of 'newpt'.
+        rv = rp; 
       }
-      ptloop = pointtraverse();
     }
-    if (intptlist->objects > 0l) {
-      // Sort the list of points randomly.
-      point *parypt_i, swappt;
-      int randindex, i;
-      srand(intptlist->objects);
-      for (i = 0; i < intptlist->objects; i++) {
-        randindex = rand() % (i + 1); // randomnation(i + 1);
-        parypt_i = (point *) fastlookup(intptlist, i); 
-        parypt = (point *) fastlookup(intptlist, randindex);
-        // Swap this two points.
-        swappt = *parypt_i;
-        *parypt_i = *parypt;
-        *parypt = swappt;
-      }
-      int remcount = (int) ((REAL) intptlist->objects * b->coarsen_percent);
-      // Return the first remcount points.
-      for (i = 0; i < remcount; i++) {
-        parypt_i = (point *) fastlookup(intptlist, i);
-        if (!pinfected(*parypt_i)) {
-          pinfected(*parypt_i);
-          remptlist->newindex((void **) &parypt);
-          *parypt = *parypt_i;
-        }
+  } else if (pointtype(parentpt) == FREEFACETVERTEX) {
+    face parentseg, parentsh;
+    sdecode(point2sh(segpt), parentseg);
+    sdecode(point2sh(parentpt), parentsh);
+    if (segfacetadjacent(&parentseg, &parentsh)) {
+      rp = getpointinsradius(parentpt);
+      if ((sqrt(2.0) * rv) < rp) { // if (rv < rp) {
+        // The relaxed insertion radius of 'newpt'.
+        rv = rp / sqrt(2.0); // rv = rp; 
       }
     }
-    delete intptlist;
-  }
-
-  // Unmark all collected vertices.
-  for (int i = 0; i < remptlist->objects; i++) {
-    parypt = (point *) fastlookup(remptlist, i);
-    puninfect(*parypt);
   }
+  setpointinsradius(segpt, rv);
 }
 
-void tetgenmesh::meshcoarsening()
+void tetgenmesh::save_facetpoint_insradius(point facpt,point parentpt,REAL r)
 {
-  arraypool *remptlist;
-
-  if (!b->quiet) {
-    printf("Mesh coarsening ...\n");
+  REAL rv = r, rp; 
+  if (pointtype(parentpt) == FREESEGVERTEX) {
+    face parentseg, parentsh;
+    sdecode(point2sh(parentpt), parentseg);
+    sdecode(point2sh(facpt), parentsh);
+    if (segfacetadjacent(&parentseg, &parentsh)) {
+      rp = getpointinsradius(parentpt);
+      if (rv < (sqrt(2.0) * rp)) {
+        rv = sqrt(2.0) * rp; // The relaxed insertion radius of 'newpt'.
+      }
+    }
+  } else if (pointtype(parentpt) == FREEFACETVERTEX) {
+    face parentsh1, parentsh2;
+    sdecode(point2sh(parentpt), parentsh1);
+    sdecode(point2sh(facpt), parentsh2);
+    if (facetfacetadjacent(&parentsh1, &parentsh2)) {
+      rp = getpointinsradius(parentpt);
+      if (rv < rp) {
+        rv = rp; // The relaxed insertion radius of 'newpt'.
+      }          
+    }
   }
+  setpointinsradius(facpt, rv);
+}
 
-  // Collect the set of points to be removed
-  remptlist = new arraypool(sizeof(point *), 10);
-  collectremovepoints(remptlist);
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// enqueuesubface()    Queue a subface or a subsegment for encroachment chk. //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
 
-  if (remptlist->objects == 0l) {
-    delete remptlist;
-    return;
+void tetgenmesh::enqueuesubface(memorypool *pool, face *chkface)
+{
+  if (!smarktest2ed(*chkface)) {
+    smarktest2(*chkface); // Only queue it once.
+    face *queface = (face *) pool->alloc();
+    *queface = *chkface;
   }
+}
 
-  if (b->verbose) {
-    if (remptlist->objects > 0l) {
-      printf("  Removing %ld points...\n", remptlist->objects);
-    }
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// enqueuetetrahedron()    Queue a tetrahedron for quality check.            //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+void tetgenmesh::enqueuetetrahedron(triface *chktet)
+{
+  if (!marktest2ed(*chktet)) {
+    marktest2(*chktet); // Only queue it once.
+    triface *quetet = (triface *) badtetrahedrons->alloc();
+    *quetet = *chktet;
   }
+}
 
-  point *parypt, *plastpt;
-  long ms = remptlist->objects;
-  int nit = 0; 
-  int bak_fliplinklevel = b->fliplinklevel;
-  b->fliplinklevel = -1;
-  autofliplinklevel = 1; // Init value.
-  int i;
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// checkseg4encroach()    Check if an edge is encroached upon by a point.    //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
 
-  while (1) {
-  
-    if (b->verbose > 1) {
-      printf("    Removing points [%s level = %2d] #:  %ld.\n", 
-             (b->fliplinklevel > 0) ? "fixed" : "auto",
-             (b->fliplinklevel > 0) ? b->fliplinklevel : autofliplinklevel,
-             remptlist->objects);
-    }
+int tetgenmesh::checkseg4encroach(point pa, point pb, point checkpt)
+{
+  // Check if the point lies inside the diametrical sphere of this seg. 
+  REAL v1[3], v2[3];
 
-    // Remove the list of points.
-    for (i = 0; i < remptlist->objects; i++) {
-      parypt = (point *) fastlookup(remptlist, i);
-      if (removevertexbyflips(*parypt)) {
-        // Move the last entry to the current place.
-        plastpt = (point *) fastlookup(remptlist, remptlist->objects - 1);
-        *parypt = *plastpt;
-        remptlist->objects--;
-        i--;
-      }
-    }
+  v1[0] = pa[0] - checkpt[0];
+  v1[1] = pa[1] - checkpt[1];
+  v1[2] = pa[2] - checkpt[2];
+  v2[0] = pb[0] - checkpt[0];
+  v2[1] = pb[1] - checkpt[1];
+  v2[2] = pb[2] - checkpt[2];
 
-    if (remptlist->objects > 0l) {
-      if (b->fliplinklevel >= 0) {
-        break; // We have tried all levels.
-      }
-      if (remptlist->objects == ms) {
-        nit++;
-        if (nit >= 3) {
-          // Do the last round with unbounded flip link level.
-          b->fliplinklevel = 100000;
+  if (dot(v1, v2) < 0) {
+    // Inside.
+    if (b->metric) { // -m option.
+      if ((pa[pointmtrindex] > 0) && (pb[pointmtrindex] > 0)) {
+        // The projection of 'checkpt' lies inside the segment [a,b].
+        REAL prjpt[3], u, v, t;
+        projpt2edge(checkpt, pa, pb, prjpt);
+        // Interoplate the mesh size at the location 'prjpt'.
+        u = distance(pa, pb);
+        v = distance(pa, prjpt);
+        t = v / u;
+        // 'u' is the mesh size at 'prjpt'
+        u = pa[pointmtrindex] + t * (pb[pointmtrindex] - pa[pointmtrindex]);
+        v = distance(checkpt, prjpt);
+        if (v < u) {
+          return 1; // Encroached prot-ball!
         }
       } else {
-        ms = remptlist->objects;
-        if (nit > 0) {
-          nit--;
-        }
+        return 1; // NO protecting ball. Encroached.
       }
-      autofliplinklevel+=b->fliplinklevelinc;
     } else {
-      // All points are removed.
-      break;
-    }
-  } // while (1)
-
-  if (remptlist->objects > 0l) {
-    if (b->verbose) {
-      printf("  %ld points are not removed !\n", remptlist->objects);
+      return 1; // Inside! Encroached.
     }
-  }
-
-  b->fliplinklevel = bak_fliplinklevel;
-  delete remptlist;
-}
-
-////                                                                       ////
-////                                                                       ////
-//// reconstruct_cxx //////////////////////////////////////////////////////////
+  }
 
-//// refine_cxx ///////////////////////////////////////////////////////////////
-////                                                                       ////
-////                                                                       ////
+  return 0;
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// makefacetverticesmap()    Create a map from facet to its vertices.        //
+// checkseg4split()    Check if we need to split a segment.                  //
 //                                                                           //
-// All facets will be indexed (starting from 0).  The map is saved in two    //
-// global arrays: 'idx2facetlist' and 'facetverticeslist'.                   //
+// A segment needs to be split if it is in the following case:               //
+//  (1) It is encroached by an existing vertex.                              //
+//  (2) It has bad quality (too long).                                       //
+//  (3) Its length is larger than the mesh sizes at its endpoints.           //
+//                                                                           //
+// Return 1 if it needs to be split, otherwise, return 0.  'pencpt' returns  //
+// an encroaching point if there exists. 'qflag' returns '1' if the segment  //
+// has a length larger than the desired edge length.                         //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-void tetgenmesh::makefacetverticesmap()
+int tetgenmesh::checkseg4split(face *chkseg, point& encpt, int& qflag)
 {
-  arraypool *facetvertexlist, *vertlist, **paryvertlist;
-  face subloop, neighsh, *parysh, *parysh1;
-  point pa, *ppt, *parypt;
-  verttype vt;
-  int facetindex, totalvertices;
-  int i, j, k;
+  REAL ccent[3], len, r;
+  int i;
 
-  if (b->verbose) {
-    printf("  Creating the facet vertices map.\n");
-  }
+  point forg = sorg(*chkseg);
+  point fdest = sdest(*chkseg);
 
-  facetvertexlist = new arraypool(sizeof(arraypool *), 10);
-  facetindex = totalvertices = 0;
+  // Initialize the return values.
+  encpt = NULL;
+  qflag = 0;
 
-  subfaces->traversalinit();
-  subloop.sh = shellfacetraverse(subfaces);
-  while (subloop.sh != NULL) {
-    if (!sinfected(subloop)) {
-      // A new facet. Create its vertices list.
-      vertlist = new arraypool(sizeof(point *), 8);
-      ppt = (point *) &(subloop.sh[3]);
-      for (k = 0; k < 3; k++) {
-        vt = pointtype(ppt[k]);
-        if ((vt != FREESEGVERTEX) && (vt != FREEFACETVERTEX)) {
-          pinfect(ppt[k]);
-          vertlist->newindex((void **) &parypt);
-          *parypt = ppt[k];
-        }
-      }
-      sinfect(subloop);
-      caveshlist->newindex((void **) &parysh);
-      *parysh = subloop;
-      for (i = 0; i < caveshlist->objects; i++) {
-        parysh = (face *) fastlookup(caveshlist, i);
-        setfacetindex(*parysh, facetindex);
-        for (j = 0; j < 3; j++) {
-          if (!isshsubseg(*parysh)) {
-            spivot(*parysh, neighsh);
-            if (!sinfected(neighsh)) {
-              pa = sapex(neighsh);
-              if (!pinfected(pa)) {
-                vt = pointtype(pa);
-                if ((vt != FREESEGVERTEX) && (vt != FREEFACETVERTEX)) {
-                  pinfect(pa);
-                  vertlist->newindex((void **) &parypt);
-                  *parypt = pa;
-                }
-              }
-              sinfect(neighsh);
-              caveshlist->newindex((void **) &parysh1);
-              *parysh1 = neighsh;
-            }
-          }
-          senextself(*parysh);
-        }
-      } // i
-      totalvertices += (int) vertlist->objects;
-      // Uninfect facet vertices.
-      for (k = 0; k < vertlist->objects; k++) {
-        parypt = (point *) fastlookup(vertlist, k);
-        puninfect(*parypt);
-      }
-      caveshlist->restart();
-      // Save this vertex list.
-      facetvertexlist->newindex((void **) &paryvertlist);
-      *paryvertlist = vertlist;
-      facetindex++;
-    } 
-    subloop.sh = shellfacetraverse(subfaces);
+  len = distance(forg, fdest);
+  r = 0.5 * len;
+  for (i = 0; i < 3; i++) {
+    ccent[i] = 0.5 * (forg[i] + fdest[i]);
   }
 
-  // All subfaces are infected. Uninfect them.
-  subfaces->traversalinit();
-  subloop.sh = shellfacetraverse(subfaces);
-  while (subloop.sh != NULL) {
-    suninfect(subloop);
-    subloop.sh = shellfacetraverse(subfaces);
+  // First check its quality.
+  if (checkconstraints && (areabound(*chkseg) > 0.0)) {
+    if (len > areabound(*chkseg)) {
+      qflag = 1;
+      return 1;
+    }
   }
 
-  if (b->verbose) {
-    printf("  Found %ld facets.\n", facetvertexlist->objects);
+  if (b->fixedvolume) {
+    if ((len * len * len) > b->maxvolume) {
+      qflag = 1;
+      return 1;
+    }
   }
 
-  idx2facetlist = new int[facetindex + 1];
-  facetverticeslist = new point[totalvertices];
+  if (b->metric) { // -m option. Check mesh size. 
+    // Check if the ccent lies outside one of the prot.balls at vertices.
+    if (((forg[pointmtrindex] > 0) && (r > forg[pointmtrindex])) ||
+        ((fdest[pointmtrindex]) > 0 && (r > fdest[pointmtrindex]))) {
+      qflag = 1; // Enforce mesh size.
+      return 1;
+    }
+  }
 
-  totalworkmemory += ((facetindex + 1) * sizeof(int) + 
-                      totalvertices * sizeof(point *));
 
-  idx2facetlist[0] = 0;
-  for (i = 0, k = 0; i < facetindex; i++) {
-    paryvertlist = (arraypool **) fastlookup(facetvertexlist, i);
-    vertlist = *paryvertlist;
-    idx2facetlist[i + 1] = (idx2facetlist[i] + (int) vertlist->objects);
-    for (j = 0; j < vertlist->objects; j++) {
-      parypt = (point *) fastlookup(vertlist, j);
-      facetverticeslist[k] = *parypt;
-      k++;
+  // Second check if it is encroached.
+  // Comment: There may exist more than one encroaching points of this segment. 
+  //   The 'encpt' returns the one which is closet to it.
+  triface searchtet, spintet;
+  point eapex;
+  REAL d, diff, smdist = 0;
+  int t1ver;
+
+  sstpivot1(*chkseg, searchtet);
+  spintet = searchtet;
+  while (1) {
+    eapex = apex(spintet);
+    if (eapex != dummypoint) {
+      d = distance(ccent, eapex);
+      diff = d - r;
+      if (fabs(diff) / r < b->epsilon) diff = 0.0; // Rounding.
+      if (diff < 0) {
+        // This segment is encroached by eapex.
+        if (useinsertradius) {
+          if (encpt == NULL) {
+            encpt = eapex;
+            smdist = d;
+          } else {
+            // Choose the closet encroaching point.
+            if (d < smdist) {
+              encpt = eapex;
+              smdist = d;
+            }
+          }
+        } else {
+          encpt = eapex;
+          break;
+        }
+      }
     }
-  }
+    fnextself(spintet);
+    if (spintet.tet == searchtet.tet) break;
+  } // while (1)
 
-  // Free the lists.
-  for (i = 0; i < facetvertexlist->objects; i++) {
-    paryvertlist = (arraypool **) fastlookup(facetvertexlist, i);
-    vertlist = *paryvertlist;
-    delete vertlist;
+  if (encpt != NULL) {
+    return 1;
   }
-  delete facetvertexlist;
+
+  return 0; // No need to split it.
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// Check whether two segments, or a segment and a facet, or two facets are   //
-// adjacent to each other.                                                   //
+// splitsegment()    Split a segment.                                        //
+//                                                                           //
+// The segment 'splitseg' is intended to be split. It will be split if it    //
+// is in one of the following cases:                                         //
+//   (1) It is encroached by an existing vertex 'encpt != NULL'; or          //
+//   (2) It is in bad quality 'qflag == 1'; or                               //
+//   (3) Its length is larger than the mesh sizes at its endpoints.          //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-int tetgenmesh::segsegadjacent(face *seg1, face *seg2)
+int tetgenmesh::splitsegment(face *splitseg, point encpt, REAL rrp, 
+                             point encpt1, point encpt2, int qflag, 
+                             int chkencflag)
 {
-  int segidx1 = getfacetindex(*seg1);
-  int segidx2 = getfacetindex(*seg2);
 
-  if (segidx1 == segidx2) return 0;
-
-  point pa1 = segmentendpointslist[segidx1 * 2];
-  point pb1 = segmentendpointslist[segidx1 * 2 + 1];
-  point pa2 = segmentendpointslist[segidx2 * 2];
-  point pb2 = segmentendpointslist[segidx2 * 2 + 1];
-
-  if ((pa1 == pa2) || (pa1 == pb2) || (pb1 == pa2) || (pb1 == pb2)) {
-    return 1;
+  if (!qflag && smarktest3ed(*splitseg)) {
+    // Do not try to re-split a marked segment.
+    return 0;
   }
-  return 0; 
-}
-
-int tetgenmesh::segfacetadjacent(face *subseg, face *subsh)
-{
-  int segidx = getfacetindex(*subseg);
-  point pa = segmentendpointslist[segidx * 2];
-  point pb = segmentendpointslist[segidx * 2 + 1];
-
-  pinfect(pa);
-  pinfect(pb);
-
-  int fidx = getfacetindex(*subsh);
-  int count = 0, i;
-
-  for (i = idx2facetlist[fidx]; i < idx2facetlist[fidx+1]; i++) {
-    if (pinfected(facetverticeslist[i])) count++;
-  } 
-
-  puninfect(pa);
-  puninfect(pb);
-
-  return count == 1;
-}
 
-int tetgenmesh::facetfacetadjacent(face *subsh1, face *subsh2)
-{
-  int count = 0, i;
+  if (b->nobisect) { // With -Y option.
+    // Only split this segment if it is allowed to be split.
+    if (checkconstraints) {
+      // Check if it has a non-zero length bound. 
+      if (areabound(*splitseg) == 0) {
+        // It is not allowed.  However, if all of facets containing this seg
+        //   is allowed to be split, we still split it.
+        face parentsh, spinsh;
+        //splitseg.shver = 0;
+        spivot(*splitseg, parentsh);
+        if (parentsh.sh == NULL) {
+          return 0; // A dangling segment. Do not split it.
+        }
+        spinsh = parentsh;
+        while (1) {
+          if (areabound(spinsh) == 0) break;
+          spivotself(spinsh);
+          if (spinsh.sh == parentsh.sh) break;
+		  if (spinsh.sh == NULL) break;  // It belongs to only one facet.
+        }
+        if ((!spinsh.sh) || (areabound(spinsh) == 0)) {
+          // All facets at this seg are not allowed to be split.
+          return 0;  // Do not split it.
+        }
+      }
+    } else {
+      return 0; // Do not split this segment.
+    }
+  } // if (b->nobisect)
 
-  int fidx1 = getfacetindex(*subsh1);
-  int fidx2 = getfacetindex(*subsh2);
+  triface searchtet;
+  face searchsh;
+  point newpt;
+  insertvertexflags ivf;
 
-  if (fidx1 == fidx2) return 0;
+  makepoint(&newpt, FREESEGVERTEX);
+  getsteinerptonsegment(splitseg, encpt, newpt);
 
-  for (i = idx2facetlist[fidx1]; i < idx2facetlist[fidx1+1]; i++) {
-    pinfect(facetverticeslist[i]);
+  if (!qflag && !b->cdtrefine) {
+    // Do not insert the point if it encroaches upon an adjacent segment.
+    face parentsh;
+    spivot(*splitseg, parentsh);
+    if (parentsh.sh != NULL) {
+      face spinsh, neighsh;
+      face neighseg;
+      spinsh = parentsh;
+      while (1) {
+        for (int i = 0; i < 2; i++) {
+          if (i == 0) {
+            senext(spinsh, neighsh);
+          } else {
+            senext2(spinsh, neighsh);
+          }
+          if (isshsubseg(neighsh)) {
+            sspivot(neighsh, neighseg);
+            if (checkseg4encroach(sorg(neighseg), sdest(neighseg), newpt)) {
+              pointdealloc(newpt);
+              return 0; // Do not split this segment.
+            }
+          }
+        } // i
+        spivotself(spinsh);
+        if (spinsh.sh == NULL) break;
+        if (spinsh.sh == parentsh.sh) break;
+      } // while (1)
+    }
   }
 
-  for (i = idx2facetlist[fidx2]; i < idx2facetlist[fidx2+1]; i++) {
-    if (pinfected(facetverticeslist[i])) count++;
+  // Split the segment by the Bowyer-Watson algorithm.
+  sstpivot1(*splitseg, searchtet);
+  ivf.iloc = (int) ONEDGE;
+  ivf.bowywat = 3; // Use Bowyer-Watson, preserve subsegments and subfaces;
+  ivf.validflag = 1; // Validate the B-W cavity.
+  ivf.lawson = 2; // Do flips to recover Delaunayness.
+  ivf.rejflag = 0;     // Do not check encroachment of new segments/facets.
+  if (b->metric) {
+    ivf.rejflag |= 4;  // Do check encroachment of protecting balls.
   }
+  ivf.chkencflag = chkencflag;
+  ivf.sloc = (int) INSTAR; // ivf.iloc;
+  ivf.sbowywat = 3; // ivf.bowywat;  // Surface mesh options.
+  ivf.splitbdflag = 1;
+  ivf.respectbdflag = 1;
+  ivf.assignmeshsize = b->metric;
+  ivf.smlenflag = useinsertradius; // Return the closet mesh vertex.
 
-  // Uninfect the vertices.
-  for (i = idx2facetlist[fidx1]; i < idx2facetlist[fidx1+1]; i++) {
-    puninfect(facetverticeslist[i]);
-  }
 
-  return count > 0;
+  if (insertpoint(newpt, &searchtet, &searchsh, splitseg, &ivf)) {
+    st_segref_count++;
+    if (steinerleft > 0) steinerleft--;
+    if (useinsertradius) {
+      save_segmentpoint_insradius(newpt, ivf.parentpt, ivf.smlen);
+    }
+    if (flipstack != NULL) {
+      flipconstraints fc;
+      fc.chkencflag = chkencflag;
+      fc.enqflag = 2;
+      lawsonflip3d(&fc);
+      unflipqueue->restart();
+    }
+    return 1;
+  } else {
+    // Point is not inserted.
+    if (ivf.iloc == (int) NEARVERTEX) {
+      terminatetetgen(this, 2);
+    }
+    pointdealloc(newpt);
+    // Mark this segment to avoid splitting in the future.
+	smarktest3(*splitseg);
+    return 0;
+  }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// save_segmentpoint_insradius(), save_facetpoint_insradius()                //
-//                                                                           //
-// Determine and save the relaxed insertion radius of a Steiner point on a   //
-// segment or a facet.  By default, it is the closet distance to the parent  //
-// point of this Steiner point. But may be larger than it.                   //
+// repairencsegs()    Repair encroached (sub) segments.                      //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-void tetgenmesh::save_segmentpoint_insradius(point segpt,point parentpt,REAL r)
+void tetgenmesh::repairencsegs(int chkencflag)
 {
-  REAL rv = r, rp;
-  if (pointtype(parentpt) == FREESEGVERTEX) {
-    face parentseg1, parentseg2;
-    sdecode(point2sh(segpt), parentseg1);
-    sdecode(point2sh(parentpt), parentseg2);
-    if (segsegadjacent(&parentseg1, &parentseg2)) {
-      rp = getpointinsradius(parentpt);
-      if (rv < rp) {
-        // The relaxed insertion radius of 'newpt'.
-        rv = rp; 
-      }
-    }
-  } else if (pointtype(parentpt) == FREEFACETVERTEX) {
-    face parentseg, parentsh;
-    sdecode(point2sh(segpt), parentseg);
-    sdecode(point2sh(parentpt), parentsh);
-    if (segfacetadjacent(&parentseg, &parentsh)) {
-      rp = getpointinsradius(parentpt);
-      if ((sqrt(2.0) * rv) < rp) { // if (rv < rp) {
-        // The relaxed insertion radius of 'newpt'.
-        rv = rp / sqrt(2.0); // rv = rp; 
+  face *bface;
+  point encpt = NULL;
+  int qflag = 0;
+
+  // Loop until the pool 'badsubsegs' is empty. Note that steinerleft == -1
+  //   if an unlimited number of Steiner points is allowed.
+  while ((badsubsegs->items > 0) && (steinerleft != 0)) {
+    badsubsegs->traversalinit();
+    bface = (face *) badsubsegs->traverse();
+    while ((bface != NULL) && (steinerleft != 0)) {
+      // Skip a deleleted element.
+      if (bface->shver >= 0) {
+        // A queued segment may have been deleted (split).
+        if ((bface->sh != NULL) && (bface->sh[3] != NULL)) {
+          // A queued segment may have been processed. 
+          if (smarktest2ed(*bface)) {
+            sunmarktest2(*bface);
+            if (checkseg4split(bface, encpt, qflag)) {
+              splitsegment(bface, encpt, 0, NULL, NULL, qflag, chkencflag);
+            }
+          }
+        }
+        // Remove this entry from list.
+        bface->shver = -1; // Signal it as a deleted element.
+        badsubsegs->dealloc((void *) bface);
       }
+      bface = (face *) badsubsegs->traverse();
     }
   }
-  setpointinsradius(segpt, rv);
-}
 
-void tetgenmesh::save_facetpoint_insradius(point facpt,point parentpt,REAL r)
-{
-  REAL rv = r, rp; 
-  if (pointtype(parentpt) == FREESEGVERTEX) {
-    face parentseg, parentsh;
-    sdecode(point2sh(parentpt), parentseg);
-    sdecode(point2sh(facpt), parentsh);
-    if (segfacetadjacent(&parentseg, &parentsh)) {
-      rp = getpointinsradius(parentpt);
-      if (rv < (sqrt(2.0) * rp)) {
-        rv = sqrt(2.0) * rp; // The relaxed insertion radius of 'newpt'.
-      }
+  if (badsubsegs->items > 0) {
+    if (b->verbose) {
+      printf("The desired number of Steiner points is reached.\n");
     }
-  } else if (pointtype(parentpt) == FREEFACETVERTEX) {
-    face parentsh1, parentsh2;
-    sdecode(point2sh(parentpt), parentsh1);
-    sdecode(point2sh(facpt), parentsh2);
-    if (facetfacetadjacent(&parentsh1, &parentsh2)) {
-      rp = getpointinsradius(parentpt);
-      if (rv < rp) {
-        rv = rp; // The relaxed insertion radius of 'newpt'.
-      }          
+    badsubsegs->traversalinit();
+    bface = (face *) badsubsegs->traverse();
+    while (bface  != NULL) {
+      // Skip a deleleted element.
+      if (bface->shver >= 0) {
+        if ((bface->sh != NULL) && (bface->sh[3] != NULL)) {
+          if (smarktest2ed(*bface)) {
+            sunmarktest2(*bface);
+          }
+        }
+      }
+      bface = (face *) badsubsegs->traverse();
     }
+    badsubsegs->restart();
   }
-  setpointinsradius(facpt, rv);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// enqueuesubface()    Queue a subface or a subsegment for encroachment chk. //
+// checkfac4encroach()    Check if a subface is encroached by a point.       //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-void tetgenmesh::enqueuesubface(memorypool *pool, face *chkface)
+int tetgenmesh::checkfac4encroach(point pa, point pb, point pc, point checkpt,
+                                  REAL* cent, REAL* r)
 {
-  if (!smarktest2ed(*chkface)) {
-    smarktest2(*chkface); // Only queue it once.
-    face *queface = (face *) pool->alloc();
-    *queface = *chkface;
-  }
-}
-
-///////////////////////////////////////////////////////////////////////////////
-//                                                                           //
-// enqueuetetrahedron()    Queue a tetrahedron for quality check.            //
-//                                                                           //
-///////////////////////////////////////////////////////////////////////////////
+  REAL rd, len;
 
-void tetgenmesh::enqueuetetrahedron(triface *chktet)
-{
-  if (!marktest2ed(*chktet)) {
-    marktest2(*chktet); // Only queue it once.
-    triface *quetet = (triface *) badtetrahedrons->alloc();
-    *quetet = *chktet;
+  circumsphere(pa, pb, pc, NULL, cent, &rd);
+  if (rd == 0) {
+    terminatetetgen(this, 2);
   }
-}
-
-///////////////////////////////////////////////////////////////////////////////
-//                                                                           //
-// checkseg4encroach()    Check if an edge is encroached upon by a point.    //
-//                                                                           //
-///////////////////////////////////////////////////////////////////////////////
-
-int tetgenmesh::checkseg4encroach(point pa, point pb, point checkpt)
-{
-  // Check if the point lies inside the diametrical sphere of this seg. 
-  REAL v1[3], v2[3];
-
-  v1[0] = pa[0] - checkpt[0];
-  v1[1] = pa[1] - checkpt[1];
-  v1[2] = pa[2] - checkpt[2];
-  v2[0] = pb[0] - checkpt[0];
-  v2[1] = pb[1] - checkpt[1];
-  v2[2] = pb[2] - checkpt[2];
-
-  if (dot(v1, v2) < 0) {
-    // Inside.
-    if (b->metric) { // -m option.
-      if ((pa[pointmtrindex] > 0) && (pb[pointmtrindex] > 0)) {
-        // The projection of 'checkpt' lies inside the segment [a,b].
-        REAL prjpt[3], u, v, t;
-        projpt2edge(checkpt, pa, pb, prjpt);
-        // Interoplate the mesh size at the location 'prjpt'.
-        u = distance(pa, pb);
-        v = distance(pa, prjpt);
-        t = v / u;
-        // 'u' is the mesh size at 'prjpt'
-        u = pa[pointmtrindex] + t * (pb[pointmtrindex] - pa[pointmtrindex]);
-        v = distance(checkpt, prjpt);
-        if (v < u) {
-          return 1; // Encroached prot-ball!
+  len = distance(cent, checkpt);
+  if ((fabs(len - rd) / rd) < b->epsilon) len = rd; // Rounding.
+ 
+  if (len < rd) {
+    // The point lies inside the circumsphere of this face.
+    if (b->metric) { // -m option.
+      if ((pa[pointmtrindex] > 0) && (pb[pointmtrindex] > 0) &&
+          (pc[pointmtrindex] > 0)) {
+        // Get the projection of 'checkpt' in the plane of pa, pb, and pc.
+        REAL prjpt[3], n[3];
+        REAL a, a1, a2, a3;
+        projpt2face(checkpt, pa, pb, pc, prjpt);
+        // Get the face area of [a,b,c].
+        facenormal(pa, pb, pc, n, 1, NULL);
+        a = sqrt(dot(n,n));
+        // Get the face areas of [a,b,p], [b,c,p], and [c,a,p].
+        facenormal(pa, pb, prjpt, n, 1, NULL);
+        a1 = sqrt(dot(n,n));
+        facenormal(pb, pc, prjpt, n, 1, NULL);
+        a2 = sqrt(dot(n,n));
+        facenormal(pc, pa, prjpt, n, 1, NULL);
+        a3 = sqrt(dot(n,n));
+        if ((fabs(a1 + a2 + a3 - a) / a) < b->epsilon) {
+          // This face contains the projection.
+          // Get the mesh size at the location of the projection point.
+          rd = a1 / a * pc[pointmtrindex]
+             + a2 / a * pa[pointmtrindex]
+             + a3 / a * pb[pointmtrindex];
+          len = distance(prjpt, checkpt);
+          if (len < rd) {
+            return 1; // Encroached.
+          }
         }
       } else {
-        return 1; // NO protecting ball. Encroached.
+        return 1;  // No protecting ball. Encroached.
       }
     } else {
-      return 1; // Inside! Encroached.
+      *r = rd;
+      return 1;  // Encroached.
     }
   }
 
@@ -24287,223 +25572,266 @@ int tetgenmesh::checkseg4encroach(point pa, point pb, point checkpt)
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// checkseg4split()    Check if we need to split a segment.                  //
+// checkfac4split()    Check if a subface needs to be split.                 //
 //                                                                           //
-// A segment needs to be split if it is in the following case:               //
+// A subface needs to be split if it is in the following case:               //
 //  (1) It is encroached by an existing vertex.                              //
-//  (2) It has bad quality (too long).                                       //
-//  (3) Its length is larger than the mesh sizes at its endpoints.           //
+//  (2) It has bad quality (has a small angle, -q).                          //
+//  (3) It's area is larger than a prescribed value (.var).                  //
 //                                                                           //
-// Return 1 if it needs to be split, otherwise, return 0.  'pencpt' returns  //
-// an encroaching point if there exists. 'qflag' returns '1' if the segment  //
-// has a length larger than the desired edge length.                         //
+// Return 1 if it needs to be split, otherwise, return 0.                    //
+// 'chkfac' represents its longest edge.                                     //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-int tetgenmesh::checkseg4split(face *chkseg, point& encpt, int& qflag)
+int tetgenmesh::checkfac4split(face *chkfac, point& encpt, int& qflag, 
+                               REAL *cent)
 {
-  REAL ccent[3], len, r;
+  point pa, pb, pc;
+  REAL area, rd, len;
+  REAL A[4][4], rhs[4], D;
+  int indx[4];
   int i;
 
-  point forg = sorg(*chkseg);
-  point fdest = sdest(*chkseg);
-
-  // Initialize the return values.
   encpt = NULL;
   qflag = 0;
 
-  len = distance(forg, fdest);
-  r = 0.5 * len;
-  for (i = 0; i < 3; i++) {
-    ccent[i] = 0.5 * (forg[i] + fdest[i]);
+  pa = sorg(*chkfac);
+  pb = sdest(*chkfac);
+  pc = sapex(*chkfac);
+
+  // Compute the coefficient matrix A (3x3).
+  A[0][0] = pb[0] - pa[0];
+  A[0][1] = pb[1] - pa[1];
+  A[0][2] = pb[2] - pa[2]; // vector V1 (pa->pb)
+  A[1][0] = pc[0] - pa[0];
+  A[1][1] = pc[1] - pa[1];
+  A[1][2] = pc[2] - pa[2]; // vector V2 (pa->pc)
+  cross(A[0], A[1], A[2]); // vector V3 (V1 X V2)
+
+  area = 0.5 * sqrt(dot(A[2], A[2])); // The area of [a,b,c].
+
+  // Compute the right hand side vector b (3x1).
+  rhs[0] = 0.5 * dot(A[0], A[0]); // edge [a,b]
+  rhs[1] = 0.5 * dot(A[1], A[1]); // edge [a,c]
+  rhs[2] = 0.0;
+
+  // Solve the 3 by 3 equations use LU decomposition with partial 
+  //   pivoting and backward and forward substitute.
+  if (!lu_decmp(A, 3, indx, &D, 0)) {
+    // A degenerate triangle. 
+    terminatetetgen(this, 2);
   }
 
-  // First check its quality.
-  if (checkconstraints && (areabound(*chkseg) > 0.0)) {
-    if (len > areabound(*chkseg)) {
+  lu_solve(A, 3, indx, rhs, 0);
+  cent[0] = pa[0] + rhs[0];
+  cent[1] = pa[1] + rhs[1];
+  cent[2] = pa[2] + rhs[2];
+  rd = sqrt(rhs[0] * rhs[0] + rhs[1] * rhs[1] + rhs[2] * rhs[2]);
+
+  if (checkconstraints && (areabound(*chkfac) > 0.0)) {
+    // Check if the subface has too big area.
+    if (area > areabound(*chkfac)) {
       qflag = 1;
       return 1;
     }
   }
 
   if (b->fixedvolume) {
-    if ((len * len * len) > b->maxvolume) {
+    if ((area * sqrt(area)) > b->maxvolume) {
       qflag = 1;
       return 1;
     }
   }
 
+  if (b->varvolume) {
+    triface adjtet;
+    REAL volbnd;
+    int t1ver;
+
+    stpivot(*chkfac, adjtet);
+    if (!ishulltet(adjtet)) {
+      volbnd = volumebound(adjtet.tet);
+      if ((volbnd > 0) && (area * sqrt(area)) > volbnd) {
+        qflag = 1;
+        return 1;
+      }
+    }
+    fsymself(adjtet);
+    if (!ishulltet(adjtet)) {
+      volbnd = volumebound(adjtet.tet);
+      if ((volbnd > 0) && (area * sqrt(area)) > volbnd) {
+        qflag = 1;
+        return 1;
+      }
+    }
+  }
+
   if (b->metric) { // -m option. Check mesh size. 
     // Check if the ccent lies outside one of the prot.balls at vertices.
-    if (((forg[pointmtrindex] > 0) && (r > forg[pointmtrindex])) ||
-        ((fdest[pointmtrindex]) > 0 && (r > fdest[pointmtrindex]))) {
+    if (((pa[pointmtrindex] > 0) && (rd > pa[pointmtrindex])) ||
+        ((pb[pointmtrindex] > 0) && (rd > pb[pointmtrindex])) ||
+        ((pc[pointmtrindex] > 0) && (rd > pc[pointmtrindex]))) {
       qflag = 1; // Enforce mesh size.
       return 1;
     }
   }
 
+  triface searchtet;
+  REAL smlen = 0;
 
-  // Second check if it is encroached.
-  // Comment: There may exist more than one encroaching points of this segment. 
-  //   The 'encpt' returns the one which is closet to it.
-  triface searchtet, spintet;
-  point eapex;
-  REAL d, diff, smdist = 0;
-  int t1ver;
-
-  sstpivot1(*chkseg, searchtet);
-  spintet = searchtet;
-  while (1) {
-    eapex = apex(spintet);
-    if (eapex != dummypoint) {
-      d = distance(ccent, eapex);
-      diff = d - r;
-      if (fabs(diff) / r < b->epsilon) diff = 0.0; // Rounding.
-      if (diff < 0) {
-        // This segment is encroached by eapex.
-        if (useinsertradius) {
-          if (encpt == NULL) {
-            encpt = eapex;
-            smdist = d;
-          } else {
-            // Choose the closet encroaching point.
-            if (d < smdist) {
-              encpt = eapex;
-              smdist = d;
-            }
-          }
+  // Check if this subface is locally encroached.
+  for (i = 0; i < 2; i++) {
+    stpivot(*chkfac, searchtet);
+    if (!ishulltet(searchtet)) {
+      len = distance(oppo(searchtet), cent);
+      if ((fabs(len - rd) / rd) < b->epsilon) len = rd;// Rounding.
+      if (len < rd) {
+        if (smlen == 0) {
+          smlen = len;
+          encpt = oppo(searchtet);
         } else {
-          encpt = eapex;
-          break;
+          if (len < smlen) {
+            smlen = len;
+            encpt = oppo(searchtet);
+          }
         }
+        //return 1;
       }
     }
-    fnextself(spintet);
-    if (spintet.tet == searchtet.tet) break;
-  } // while (1)
-
-  if (encpt != NULL) {
-    return 1;
+    sesymself(*chkfac);
   }
 
-  return 0; // No need to split it.
+  return encpt != NULL; //return 0;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// splitsegment()    Split a segment.                                        //
+// splitsubface()    Split a subface.                                        //
 //                                                                           //
-// The segment 'splitseg' is intended to be split. It will be split if it    //
-// is in one of the following cases:                                         //
-//   (1) It is encroached by an existing vertex 'encpt != NULL'; or          //
-//   (2) It is in bad quality 'qflag == 1'; or                               //
-//   (3) Its length is larger than the mesh sizes at its endpoints.          //
+// The subface may be encroached, or in bad-quality. It is split at its cir- //
+// cumcenter ('ccent'). Do not split it if 'ccent' encroaches upon any seg-  //
+// ment. Instead, one of the encroached segments is split.  It is possible   //
+// that none of the encroached segments can be split.                        //
+//                                                                           //
+// The return value indicates whether a new point is inserted (> 0) or not   //
+// (= 0).  Furthermore, it is inserted on an encroached segment (= 1) or     //
+// in-side the facet (= 2).                                                  //
+//                                                                           //
+// 'encpt' is a vertex encroaching upon this subface, i.e., it causes the    //
+// split of this subface. If 'encpt' is NULL, then the cause of the split    //
+// this subface is a rejected tet circumcenter 'p', and 'encpt1' is the      //
+// parent of 'p'.                                                            //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-int tetgenmesh::splitsegment(face *splitseg, point encpt, REAL rrp, 
-                             point encpt1, point encpt2, int qflag, 
-                             int chkencflag)
+int tetgenmesh::splitsubface(face *splitfac, point encpt, point encpt1, 
+                             int qflag, REAL *ccent, int chkencflag)
 {
 
-  if (!qflag && smarktest3ed(*splitseg)) {
-    // Do not try to re-split a marked segment.
+  if (!qflag && smarktest3ed(*splitfac)) {
+    // Do not try to re-split a marked subface.
     return 0;
   }
 
   if (b->nobisect) { // With -Y option.
-    // Only split this segment if it is allowed to be split.
     if (checkconstraints) {
-      // Check if it has a non-zero length bound. 
-      if (areabound(*splitseg) == 0) {
-        // It is not allowed.  However, if all of facets containing this seg
-        //   is allowed to be split, we still split it.
-        face parentsh, spinsh;
-        //splitseg.shver = 0;
-        spivot(*splitseg, parentsh);
-        if (parentsh.sh == NULL) {
-          return 0; // A dangling segment. Do not split it.
-        }
-        spinsh = parentsh;
-        while (1) {
-          if (areabound(spinsh) == 0) break;
-          spivotself(spinsh);
-          if (spinsh.sh == parentsh.sh) break;
-		  if (spinsh.sh == NULL) break;  // It belongs to only one facet.
+      // Only split if it is allowed to be split.
+      // Check if this facet has a non-zero constraint.
+      if (areabound(*splitfac) == 0) {
+        return 0; // Do not split it.
+      }
+    } else {
+      return 0;
+    }
+  } // if (b->nobisect)
+
+  if (useinsertradius) {
+    if (encpt != NULL) {
+      REAL rp; // Insertion radius of newpt.
+      REAL rv = distance(encpt, ccent);
+      if (pointtype(encpt) == FREESEGVERTEX) {
+        face parentseg;
+        sdecode(point2sh(encpt), parentseg);
+        if (segfacetadjacent(&parentseg, splitfac)) {
+          rp = getpointinsradius(encpt);
+          if (rv < (sqrt(2.0) * rp)) {
+            // This insertion may cause no termination. 
+            return 0; // Reject the insertion of newpt.
+          }
         }
-        if ((!spinsh.sh) || (areabound(spinsh) == 0)) {
-          // All facets at this seg are not allowed to be split.
-          return 0;  // Do not split it.
+      } else if (pointtype(encpt) == FREEFACETVERTEX) {
+        face parentsh;
+        sdecode(point2sh(encpt), parentsh);
+        if (facetfacetadjacent(&parentsh, splitfac)) {
+          rp = getpointinsradius(encpt);
+          if (rv < rp) {
+            return 0; // Reject the insertion of newpt.
+          }
         }
       }
-    } else {
-      return 0; // Do not split this segment.
     }
-  } // if (b->nobisect)
+  } // if (useinsertradius)
 
-  triface searchtet;
   face searchsh;
-  point newpt;
   insertvertexflags ivf;
+  point newpt;
+  int i;
 
-  makepoint(&newpt, FREESEGVERTEX);
-  getsteinerptonsegment(splitseg, encpt, newpt);
+  // Initialize the inserting point.
+  makepoint(&newpt, FREEFACETVERTEX);
+  // Split the subface at its circumcenter.
+  for (i = 0; i < 3; i++) newpt[i] = ccent[i];
 
-  if (!qflag && !b->cdtrefine) {
-    // Do not insert the point if it encroaches upon an adjacent segment.
-    face parentsh;
-    spivot(*splitseg, parentsh);
-    if (parentsh.sh != NULL) {
-      face spinsh, neighsh;
-      face neighseg;
-      spinsh = parentsh;
-      while (1) {
-        for (int i = 0; i < 2; i++) {
-          if (i == 0) {
-            senext(spinsh, neighsh);
-          } else {
-            senext2(spinsh, neighsh);
-          }
-          if (isshsubseg(neighsh)) {
-            sspivot(neighsh, neighseg);
-            if (checkseg4encroach(sorg(neighseg), sdest(neighseg), newpt)) {
-              pointdealloc(newpt);
-              return 0; // Do not split this segment.
-            }
-          }
-        } // i
-        spivotself(spinsh);
-        if (spinsh.sh == NULL) break;
-        if (spinsh.sh == parentsh.sh) break;
-      } // while (1)
-    }
+  // Search a subface which contains 'newpt'.
+  searchsh = *splitfac;
+  // Calculate an above point. It lies above the plane containing
+  //   the subface [a,b,c], and save it in dummypoint. Moreover,
+  //   the vector cent->dummypoint is the normal of the plane.
+  calculateabovepoint4(newpt, sorg(*splitfac), sdest(*splitfac), 
+                       sapex(*splitfac));
+  //   Parameters: 'aflag' = 1, - above point exists.
+  //   'cflag' = 0, - non-convex, check co-planarity of the result.
+  //   'rflag' = 0, - no need to round the locating result.
+  ivf.iloc = (int) slocate(newpt, &searchsh, 1, 0, 0);
+
+  if (!((ivf.iloc == (int) ONFACE) || (ivf.iloc == (int) ONEDGE))) {
+    // Point location failed.
+    pointdealloc(newpt);
+    // Mark this subface to avoid splitting in the future.
+    smarktest3(*splitfac);
+    return 0;
   }
 
-  // Split the segment by the Bowyer-Watson algorithm.
-  sstpivot1(*splitseg, searchtet);
-  ivf.iloc = (int) ONEDGE;
-  ivf.bowywat = 3; // Use Bowyer-Watson, preserve subsegments and subfaces;
-  ivf.validflag = 1; // Validate the B-W cavity.
-  ivf.lawson = 2; // Do flips to recover Delaunayness.
-  ivf.rejflag = 0;     // Do not check encroachment of new segments/facets.
+
+  triface searchtet;
+
+  // Insert the point.
+  stpivot(searchsh, searchtet);
+  ivf.bowywat = 3; // Use Bowyer-Watson. Preserve subsegments and subfaces;
+  ivf.lawson = 2;
+  ivf.rejflag = 1; // Do check the encroachment of segments.
   if (b->metric) {
     ivf.rejflag |= 4;  // Do check encroachment of protecting balls.
   }
   ivf.chkencflag = chkencflag;
   ivf.sloc = (int) INSTAR; // ivf.iloc;
-  ivf.sbowywat = 3; // ivf.bowywat;  // Surface mesh options.
+  ivf.sbowywat = 3; // ivf.bowywat;
   ivf.splitbdflag = 1;
+  ivf.validflag = 1;
   ivf.respectbdflag = 1;
   ivf.assignmeshsize = b->metric;
-  ivf.smlenflag = useinsertradius; // Return the closet mesh vertex.
+  ivf.refineflag = 2;
+  ivf.refinesh = *splitfac;
+  ivf.smlenflag = useinsertradius; // Update the insertion radius.
 
 
-  if (insertpoint(newpt, &searchtet, &searchsh, splitseg, &ivf)) {
-    st_segref_count++;
+  if (insertpoint(newpt, &searchtet, &searchsh, NULL, &ivf)) {
+    st_facref_count++;
     if (steinerleft > 0) steinerleft--;
     if (useinsertradius) {
-      save_segmentpoint_insradius(newpt, ivf.parentpt, ivf.smlen);
-    }
+      save_facetpoint_insradius(newpt, ivf.parentpt, ivf.smlen);
+    } // if (useinsertradius)
     if (flipstack != NULL) {
       flipconstraints fc;
       fc.chkencflag = chkencflag;
@@ -24513,63 +25841,89 @@ int tetgenmesh::splitsegment(face *splitseg, point encpt, REAL rrp,
     }
     return 1;
   } else {
-    // Point is not inserted.
-    if (ivf.iloc == (int) NEARVERTEX) {
-      terminatetetgen(this, 2);
-    }
+    // Point was not inserted.
     pointdealloc(newpt);
-    // Mark this segment to avoid splitting in the future.
-	smarktest3(*splitseg);
+    if (ivf.iloc == (int) ENCSEGMENT) {
+      // Select an encroached segment and split it.
+      face *paryseg;
+      int splitflag = 0;
+      for (i = 0; i < encseglist->objects; i++) {
+        paryseg = (face *) fastlookup(encseglist, i);
+        if (splitsegment(paryseg, NULL, 0.0, encpt, encpt1, qflag, 
+                         chkencflag | 1)) {
+          splitflag = 1; // A point is inserted on a segment.
+          break;
+        }
+      } // i
+      encseglist->restart();
+      if (splitflag) {
+        // Some segments may need to be repaired.
+        if (badsubsegs->items > 0) {
+          repairencsegs(chkencflag | 1);
+        }
+        return 1;
+      }
+    } else {
+      if (ivf.iloc == (int) NEARVERTEX) {
+        terminatetetgen(this, 2);
+      }
+    }
+    // Mark this subface to avoid splitting in the future.
+	smarktest3(*splitfac);
     return 0;
   }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// repairencsegs()    Repair encroached (sub) segments.                      //
+// repairencfacs()    Repair encroached subfaces.                            //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-void tetgenmesh::repairencsegs(int chkencflag)
+void tetgenmesh::repairencfacs(int chkencflag)
 {
   face *bface;
   point encpt = NULL;
   int qflag = 0;
+  REAL ccent[3];
 
-  // Loop until the pool 'badsubsegs' is empty. Note that steinerleft == -1
+  // Loop until the pool 'badsubfacs' is empty. Note that steinerleft == -1
   //   if an unlimited number of Steiner points is allowed.
-  while ((badsubsegs->items > 0) && (steinerleft != 0)) {
-    badsubsegs->traversalinit();
-    bface = (face *) badsubsegs->traverse();
+  while ((badsubfacs->items > 0) && (steinerleft != 0)) {
+    badsubfacs->traversalinit();
+    bface = (face *) badsubfacs->traverse();
     while ((bface != NULL) && (steinerleft != 0)) {
-      // Skip a deleleted element.
+      // Skip a deleted element.
       if (bface->shver >= 0) {
-        // A queued segment may have been deleted (split).
+        // A queued subface may have been deleted (split).
         if ((bface->sh != NULL) && (bface->sh[3] != NULL)) {
-          // A queued segment may have been processed. 
+          // A queued subface may have been processed. 
           if (smarktest2ed(*bface)) {
             sunmarktest2(*bface);
-            if (checkseg4split(bface, encpt, qflag)) {
-              splitsegment(bface, encpt, 0, NULL, NULL, qflag, chkencflag);
+            if (checkfac4split(bface, encpt, qflag, ccent)) {
+              splitsubface(bface, encpt, NULL, qflag, ccent, chkencflag);
             }
           }
         }
-        // Remove this entry from list.
         bface->shver = -1; // Signal it as a deleted element.
-        badsubsegs->dealloc((void *) bface);
+        badsubfacs->dealloc((void *) bface); // Remove this entry from list.
       }
-      bface = (face *) badsubsegs->traverse();
+      bface = (face *) badsubfacs->traverse();
     }
   }
 
-  if (badsubsegs->items > 0) {
-    if (b->verbose) {
-      printf("The desired number of Steiner points is reached.\n");
+  if (badsubfacs->items > 0) {
+    if (steinerleft == 0) {
+      if (b->verbose) {
+        printf("The desired number of Steiner points is reached.\n");
+      }
+    } else {
+      terminatetetgen(this, 2);
     }
-    badsubsegs->traversalinit();
-    bface = (face *) badsubsegs->traverse();
+    badsubfacs->traversalinit();
+    bface = (face *) badsubfacs->traverse();
     while (bface  != NULL) {
-      // Skip a deleleted element.
+      // Skip a deleted element.
       if (bface->shver >= 0) {
         if ((bface->sh != NULL) && (bface->sh[3] != NULL)) {
           if (smarktest2ed(*bface)) {
@@ -24577,334 +25931,364 @@ void tetgenmesh::repairencsegs(int chkencflag)
           }
         }
       }
-      bface = (face *) badsubsegs->traverse();
-    }
-    badsubsegs->restart();
-  }
-}
-
-///////////////////////////////////////////////////////////////////////////////
-//                                                                           //
-// checkfac4encroach()    Check if a subface is encroached by a point.       //
-//                                                                           //
-///////////////////////////////////////////////////////////////////////////////
-
-int tetgenmesh::checkfac4encroach(point pa, point pb, point pc, point checkpt,
-                                  REAL* cent, REAL* r)
-{
-  REAL rd, len;
-
-  circumsphere(pa, pb, pc, NULL, cent, &rd);
-  if (rd == 0) {
-    terminatetetgen(this, 2);
-  }
-  len = distance(cent, checkpt);
-  if ((fabs(len - rd) / rd) < b->epsilon) len = rd; // Rounding.
- 
-  if (len < rd) {
-    // The point lies inside the circumsphere of this face.
-    if (b->metric) { // -m option.
-      if ((pa[pointmtrindex] > 0) && (pb[pointmtrindex] > 0) &&
-          (pc[pointmtrindex] > 0)) {
-        // Get the projection of 'checkpt' in the plane of pa, pb, and pc.
-        REAL prjpt[3], n[3];
-        REAL a, a1, a2, a3;
-        projpt2face(checkpt, pa, pb, pc, prjpt);
-        // Get the face area of [a,b,c].
-        facenormal(pa, pb, pc, n, 1, NULL);
-        a = sqrt(dot(n,n));
-        // Get the face areas of [a,b,p], [b,c,p], and [c,a,p].
-        facenormal(pa, pb, prjpt, n, 1, NULL);
-        a1 = sqrt(dot(n,n));
-        facenormal(pb, pc, prjpt, n, 1, NULL);
-        a2 = sqrt(dot(n,n));
-        facenormal(pc, pa, prjpt, n, 1, NULL);
-        a3 = sqrt(dot(n,n));
-        if ((fabs(a1 + a2 + a3 - a) / a) < b->epsilon) {
-          // This face contains the projection.
-          // Get the mesh size at the location of the projection point.
-          rd = a1 / a * pc[pointmtrindex]
-             + a2 / a * pa[pointmtrindex]
-             + a3 / a * pb[pointmtrindex];
-          len = distance(prjpt, checkpt);
-          if (len < rd) {
-            return 1; // Encroached.
-          }
-        }
-      } else {
-        return 1;  // No protecting ball. Encroached.
-      }
-    } else {
-      *r = rd;
-      return 1;  // Encroached.
+      bface = (face *) badsubfacs->traverse();
     }
+    badsubfacs->restart();
   }
-
-  return 0;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// checkfac4split()    Check if a subface needs to be split.                 //
-//                                                                           //
-// A subface needs to be split if it is in the following case:               //
-//  (1) It is encroached by an existing vertex.                              //
-//  (2) It has bad quality (has a small angle, -q).                          //
-//  (3) It's area is larger than a prescribed value (.var).                  //
-//                                                                           //
-// Return 1 if it needs to be split, otherwise, return 0.                    //
-// 'chkfac' represents its longest edge.                                     //
-//                                                                           //
+// checktet4split()    Check if the tet needs to be split.                   //
+//                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-int tetgenmesh::checkfac4split(face *chkfac, point& encpt, int& qflag, 
-                               REAL *cent)
+int tetgenmesh::checktet4split(triface *chktet, int &qflag, REAL *ccent) 
 {
-  point pa, pb, pc;
-  REAL area, rd, len;
+  point pa, pb, pc, pd, *ppt;
+  REAL vda[3], vdb[3], vdc[3];
+  REAL vab[3], vbc[3], vca[3];
+  REAL N[4][3], L[4], cosd[6], elen[6];
+  REAL maxcosd, vol, volbnd, smlen = 0, rd;
   REAL A[4][4], rhs[4], D;
   int indx[4];
-  int i;
+  int i, j;
+
+  if (b->convex) { // -c
+    // Skip this tet if it lies in the exterior.
+    if (elemattribute(chktet->tet, numelemattrib - 1) == -1.0) {
+      return 0;
+    }
+  }
 
-  encpt = NULL;
   qflag = 0;
 
-  pa = sorg(*chkfac);
-  pb = sdest(*chkfac);
-  pc = sapex(*chkfac);
+  pd = (point) chktet->tet[7];
+  if (pd == dummypoint) {
+    return 0; // Do not split a hull tet.
+  }
 
-  // Compute the coefficient matrix A (3x3).
-  A[0][0] = pb[0] - pa[0];
-  A[0][1] = pb[1] - pa[1];
-  A[0][2] = pb[2] - pa[2]; // vector V1 (pa->pb)
-  A[1][0] = pc[0] - pa[0];
-  A[1][1] = pc[1] - pa[1];
-  A[1][2] = pc[2] - pa[2]; // vector V2 (pa->pc)
-  cross(A[0], A[1], A[2]); // vector V3 (V1 X V2)
+  pa = (point) chktet->tet[4];
+  pb = (point) chktet->tet[5];
+  pc = (point) chktet->tet[6];
 
-  area = 0.5 * sqrt(dot(A[2], A[2])); // The area of [a,b,c].
+  // Get the edge vectors vda: d->a, vdb: d->b, vdc: d->c.
+  // Set the matrix A = [vda, vdb, vdc]^T.
+  for (i = 0; i < 3; i++) A[0][i] = vda[i] = pa[i] - pd[i];
+  for (i = 0; i < 3; i++) A[1][i] = vdb[i] = pb[i] - pd[i];
+  for (i = 0; i < 3; i++) A[2][i] = vdc[i] = pc[i] - pd[i];
 
-  // Compute the right hand side vector b (3x1).
-  rhs[0] = 0.5 * dot(A[0], A[0]); // edge [a,b]
-  rhs[1] = 0.5 * dot(A[1], A[1]); // edge [a,c]
-  rhs[2] = 0.0;
+  // Get the other edge vectors.
+  for (i = 0; i < 3; i++) vab[i] = pb[i] - pa[i];
+  for (i = 0; i < 3; i++) vbc[i] = pc[i] - pb[i];
+  for (i = 0; i < 3; i++) vca[i] = pa[i] - pc[i];
 
-  // Solve the 3 by 3 equations use LU decomposition with partial 
-  //   pivoting and backward and forward substitute.
   if (!lu_decmp(A, 3, indx, &D, 0)) {
-    // A degenerate triangle. 
-    terminatetetgen(this, 2);
+    // A degenerated tet (vol = 0).
+    // This is possible due to the use of exact arithmetic.  We temporarily
+    //   leave this tet. It should be fixed by mesh optimization.
+    return 0; 
   }
 
-  lu_solve(A, 3, indx, rhs, 0);
-  cent[0] = pa[0] + rhs[0];
-  cent[1] = pa[1] + rhs[1];
-  cent[2] = pa[2] + rhs[2];
-  rd = sqrt(rhs[0] * rhs[0] + rhs[1] * rhs[1] + rhs[2] * rhs[2]);
-
-  if (checkconstraints && (areabound(*chkfac) > 0.0)) {
-    // Check if the subface has too big area.
-    if (area > areabound(*chkfac)) {
-      qflag = 1;
+  // Check volume if '-a#' and '-a' options are used.
+  if (b->varvolume || b->fixedvolume) {
+    vol = fabs(A[indx[0]][0] * A[indx[1]][1] * A[indx[2]][2]) / 6.0;
+    if (b->fixedvolume) {
+      if (vol > b->maxvolume) {
+        qflag = 1;
+      }
+    } 
+    if (!qflag && b->varvolume) {
+      volbnd = volumebound(chktet->tet);
+      if ((volbnd > 0.0) && (vol > volbnd)) {
+        qflag = 1;
+      }
+    }
+    if (qflag == 1) {
+      // Calculate the circumcenter of this tet.
+      rhs[0] = 0.5 * dot(vda, vda);
+      rhs[1] = 0.5 * dot(vdb, vdb);
+      rhs[2] = 0.5 * dot(vdc, vdc);
+      lu_solve(A, 3, indx, rhs, 0);            
+      for (i = 0; i < 3; i++) ccent[i] = pd[i] + rhs[i];
       return 1;
     }
   }
 
-  if (b->fixedvolume) {
-    if ((area * sqrt(area)) > b->maxvolume) {
-      qflag = 1;
+  if (b->metric) { // -m option. Check mesh size. 
+    // Calculate the circumradius of this tet.
+    rhs[0] = 0.5 * dot(vda, vda);
+    rhs[1] = 0.5 * dot(vdb, vdb);
+    rhs[2] = 0.5 * dot(vdc, vdc);
+    lu_solve(A, 3, indx, rhs, 0);            
+    for (i = 0; i < 3; i++) ccent[i] = pd[i] + rhs[i];
+    rd = sqrt(dot(rhs, rhs));
+    // Check if the ccent lies outside one of the prot.balls at vertices.
+    ppt = (point *) &(chktet->tet[4]);
+    for (i = 0; i < 4; i++) {
+      if (ppt[i][pointmtrindex] > 0) {
+        if (rd > ppt[i][pointmtrindex]) {
+          qflag = 1; // Enforce mesh size.
+          return 1;
+        }
+      }
+    }
+  }
+
+  if (in->tetunsuitable != NULL) {
+    // Execute the user-defined meshing sizing evaluation.
+    if ((*(in->tetunsuitable))(pa, pb, pc, pd, NULL, 0)) {
+      // Calculate the circumcenter of this tet.
+      rhs[0] = 0.5 * dot(vda, vda);
+      rhs[1] = 0.5 * dot(vdb, vdb);
+      rhs[2] = 0.5 * dot(vdc, vdc);
+      lu_solve(A, 3, indx, rhs, 0);            
+      for (i = 0; i < 3; i++) ccent[i] = pd[i] + rhs[i];
       return 1;
     }
   }
 
-  if (b->varvolume) {
-    triface adjtet;
-    REAL volbnd;
-    int t1ver;
+  if (useinsertradius) {
+    // Do not split this tet if the shortest edge is shorter than the
+    //   insertion radius of one of its endpoints.
+    triface checkedge;
+    point e1, e2;
+    REAL rrv, smrrv;
 
-    stpivot(*chkfac, adjtet);
-    if (!ishulltet(adjtet)) {
-      volbnd = volumebound(adjtet.tet);
-      if ((volbnd > 0) && (area * sqrt(area)) > volbnd) {
-        qflag = 1;
-        return 1;
+    // Get the shortest edge of this tet.
+    checkedge.tet = chktet->tet;
+    for (i = 0; i < 6; i++) {
+      checkedge.ver = edge2ver[i];
+      e1 = org(checkedge);
+      e2 = dest(checkedge);
+      elen[i] = distance(e1, e2);
+      if (i == 0) {
+        smlen = elen[i];
+        j = 0;
+      } else {
+        if (elen[i] < smlen) {
+          smlen = elen[i];
+          j = i;
+        }
       }
     }
-    fsymself(adjtet);
-    if (!ishulltet(adjtet)) {
-      volbnd = volumebound(adjtet.tet);
-      if ((volbnd > 0) && (area * sqrt(area)) > volbnd) {
-        qflag = 1;
-        return 1;
+    // Check if the edge is too short.
+    checkedge.ver = edge2ver[j];
+    // Get the smallest rrv of e1 and e2.
+    // Note: if rrv of e1 and e2 is zero. Do not use it.
+    e1 = org(checkedge);
+    smrrv = getpointinsradius(e1);
+    e2 = dest(checkedge);
+    rrv = getpointinsradius(e2);
+    if (rrv > 0) {
+      if (smrrv > 0) {
+        if (rrv < smrrv) {
+          smrrv = rrv;
+        }
+      } else {
+        smrrv = rrv;
       }
     }
-  }
+    if (smrrv > 0) {
+      // To avoid rounding error, round smrrv before doing comparison.
+      if ((fabs(smrrv - smlen) / smlen) < b->epsilon) {
+        smrrv = smlen;
+      }
+      if (smrrv > smlen) {
+        return 0;
+      }
+    }
+  } // if (useinsertradius)
 
-  if (b->metric) { // -m option. Check mesh size. 
-    // Check if the ccent lies outside one of the prot.balls at vertices.
-    if (((pa[pointmtrindex] > 0) && (rd > pa[pointmtrindex])) ||
-        ((pb[pointmtrindex] > 0) && (rd > pb[pointmtrindex])) ||
-        ((pc[pointmtrindex] > 0) && (rd > pc[pointmtrindex]))) {
-      qflag = 1; // Enforce mesh size.
+  // Check the radius-edge ratio. Set by -q#.
+  if (b->minratio > 0) { 
+    // Calculate the circumcenter and radius of this tet.
+    rhs[0] = 0.5 * dot(vda, vda);
+    rhs[1] = 0.5 * dot(vdb, vdb);
+    rhs[2] = 0.5 * dot(vdc, vdc);
+    lu_solve(A, 3, indx, rhs, 0);            
+    for (i = 0; i < 3; i++) ccent[i] = pd[i] + rhs[i];
+    rd = sqrt(dot(rhs, rhs));
+    if (!useinsertradius) {
+      // Calculate the shortest edge length.
+      elen[0] = dot(vda, vda);
+      elen[1] = dot(vdb, vdb);
+      elen[2] = dot(vdc, vdc);
+      elen[3] = dot(vab, vab);
+      elen[4] = dot(vbc, vbc);
+      elen[5] = dot(vca, vca);
+      smlen = elen[0]; //sidx = 0;
+      for (i = 1; i < 6; i++) {
+        if (smlen > elen[i]) { 
+          smlen = elen[i]; //sidx = i; 
+        }
+      }
+      smlen = sqrt(smlen);
+    }
+    D = rd / smlen;
+    if (D > b->minratio) {
+      // A bad radius-edge ratio.
       return 1;
     }
   }
 
-  triface searchtet;
-  REAL smlen = 0;
-
-  // Check if this subface is locally encroached.
-  for (i = 0; i < 2; i++) {
-    stpivot(*chkfac, searchtet);
-    if (!ishulltet(searchtet)) {
-      len = distance(oppo(searchtet), cent);
-      if ((fabs(len - rd) / rd) < b->epsilon) len = rd;// Rounding.
-      if (len < rd) {
-        if (smlen == 0) {
-          smlen = len;
-          encpt = oppo(searchtet);
-        } else {
-          if (len < smlen) {
-            smlen = len;
-            encpt = oppo(searchtet);
-          }
-        }
-        //return 1;
+  // Check the minimum dihedral angle. Set by -qq#.
+  if (b->mindihedral > 0) { 
+    // Compute the 4 face normals (N[0], ..., N[3]).
+    for (j = 0; j < 3; j++) {
+      for (i = 0; i < 3; i++) N[j][i] = 0.0;
+      N[j][j] = 1.0;  // Positive means the inside direction
+      lu_solve(A, 3, indx, N[j], 0);
+    }
+    for (i = 0; i < 3; i++) N[3][i] = - N[0][i] - N[1][i] - N[2][i];
+    // Normalize the normals.
+    for (i = 0; i < 4; i++) {
+      L[i] = sqrt(dot(N[i], N[i]));
+      if (L[i] == 0) {
+        terminatetetgen(this, 2);
       }
+      for (j = 0; j < 3; j++) N[i][j] /= L[i];
+    }
+    // Calculate the six dihedral angles.
+    cosd[0] = -dot(N[0], N[1]); // Edge cd, bd, bc.
+    cosd[1] = -dot(N[0], N[2]);
+    cosd[2] = -dot(N[0], N[3]);
+    cosd[3] = -dot(N[1], N[2]); // Edge ad, ac
+    cosd[4] = -dot(N[1], N[3]);
+    cosd[5] = -dot(N[2], N[3]); // Edge ab
+    // Get the smallest dihedral angle.
+    //maxcosd = mincosd = cosd[0];
+    maxcosd = cosd[0];
+    for (i = 1; i < 6; i++) {
+      //if (cosd[i] > maxcosd) maxcosd = cosd[i];
+      maxcosd = (cosd[i] > maxcosd ? cosd[i] : maxcosd);
+      //mincosd = (cosd[i] < mincosd ? cosd[i] : maxcosd);
+    }
+    if (maxcosd > cosmindihed) {
+      // Calculate the circumcenter of this tet.
+      // A bad dihedral angle.
+      //if ((b->quality & 1) == 0) {
+        rhs[0] = 0.5 * dot(vda, vda);
+        rhs[1] = 0.5 * dot(vdb, vdb);
+        rhs[2] = 0.5 * dot(vdc, vdc);
+        lu_solve(A, 3, indx, rhs, 0);            
+        for (i = 0; i < 3; i++) ccent[i] = pd[i] + rhs[i];
+        //*rd = sqrt(dot(rhs, rhs));
+      //}
+      return 1;
     }
-    sesymself(*chkfac);
   }
 
-  return encpt != NULL; //return 0;
+  return 0;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// splitsubface()    Split a subface.                                        //
-//                                                                           //
-// The subface may be encroached, or in bad-quality. It is split at its cir- //
-// cumcenter ('ccent'). Do not split it if 'ccent' encroaches upon any seg-  //
-// ment. Instead, one of the encroached segments is split.  It is possible   //
-// that none of the encroached segments can be split.                        //
-//                                                                           //
-// The return value indicates whether a new point is inserted (> 0) or not   //
-// (= 0).  Furthermore, it is inserted on an encroached segment (= 1) or     //
-// in-side the facet (= 2).                                                  //
-//                                                                           //
-// 'encpt' is a vertex encroaching upon this subface, i.e., it causes the    //
-// split of this subface. If 'encpt' is NULL, then the cause of the split    //
-// this subface is a rejected tet circumcenter 'p', and 'encpt1' is the      //
-// parent of 'p'.                                                            //
+// splittetrahedron()    Split a tetrahedron.                                //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-int tetgenmesh::splitsubface(face *splitfac, point encpt, point encpt1, 
-                             int qflag, REAL *ccent, int chkencflag)
+int tetgenmesh::splittetrahedron(triface* splittet, int qflag, REAL *ccent, 
+                                 int chkencflag)
 {
+  triface searchtet;
+  face *paryseg;
+  point newpt, *ppt;
+  badface *bface;
+  insertvertexflags ivf;
+  int splitflag = 0;
+  int i;
 
-  if (!qflag && smarktest3ed(*splitfac)) {
-    // Do not try to re-split a marked subface.
-    return 0;
-  }
-
-  if (b->nobisect) { // With -Y option.
-    if (checkconstraints) {
-      // Only split if it is allowed to be split.
-      // Check if this facet has a non-zero constraint.
-      if (areabound(*splitfac) == 0) {
-        return 0; // Do not split it.
-      }
-    } else {
-      return 0;
-    }
-  } // if (b->nobisect)
 
-  if (useinsertradius) {
-    if (encpt != NULL) {
-      REAL rp; // Insertion radius of newpt.
-      REAL rv = distance(encpt, ccent);
-      if (pointtype(encpt) == FREESEGVERTEX) {
-        face parentseg;
-        sdecode(point2sh(encpt), parentseg);
-        if (segfacetadjacent(&parentseg, splitfac)) {
-          rp = getpointinsradius(encpt);
-          if (rv < (sqrt(2.0) * rp)) {
-            // This insertion may cause no termination. 
-            return 0; // Reject the insertion of newpt.
-          }
-        }
-      } else if (pointtype(encpt) == FREEFACETVERTEX) {
-        face parentsh;
-        sdecode(point2sh(encpt), parentsh);
-        if (facetfacetadjacent(&parentsh, splitfac)) {
-          rp = getpointinsradius(encpt);
-          if (rv < rp) {
-            return 0; // Reject the insertion of newpt.
-          }
-        }
-      }
-    }
-  } // if (useinsertradius)
 
-  face searchsh;
-  insertvertexflags ivf;
-  point newpt;
-  int i;
+  REAL rv = 0.; // Insertion radius of 'newpt'.
 
-  // Initialize the inserting point.
-  makepoint(&newpt, FREEFACETVERTEX);
-  // Split the subface at its circumcenter.
+  makepoint(&newpt, FREEVOLVERTEX);
   for (i = 0; i < 3; i++) newpt[i] = ccent[i];
 
-  // Search a subface which contains 'newpt'.
-  searchsh = *splitfac;
-  // Calculate an above point. It lies above the plane containing
-  //   the subface [a,b,c], and save it in dummypoint. Moreover,
-  //   the vector cent->dummypoint is the normal of the plane.
-  calculateabovepoint4(newpt, sorg(*splitfac), sdest(*splitfac), 
-                       sapex(*splitfac));
-  //   Parameters: 'aflag' = 1, - above point exists.
-  //   'cflag' = 0, - non-convex, check co-planarity of the result.
-  //   'rflag' = 0, - no need to round the locating result.
-  ivf.iloc = (int) slocate(newpt, &searchsh, 1, 0, 0);
+  if (useinsertradius) {
+    rv = distance(newpt, org(*splittet));
+    setpointinsradius(newpt, rv);
+  }
 
-  if (!((ivf.iloc == (int) ONFACE) || (ivf.iloc == (int) ONEDGE))) {
-    // Point location failed.
-    pointdealloc(newpt);
-    // Mark this subface to avoid splitting in the future.
-    smarktest3(*splitfac);
-    return 0;
+  // Locate the new point. Starting from an interior point 'q' of the
+  //   splittet. We perform a walk from q to the 'newpt', stop walking
+  //   either we hit a subface or enter OUTSIDE.
+  searchtet = *splittet;
+  ivf.iloc = (int) OUTSIDE;
+  ivf.iloc = locate(newpt, &searchtet, 1); // 'chkencflag' = 1.
+
+  if ((ivf.iloc == (int) OUTSIDE) || (ivf.iloc == (int) ENCSUBFACE)) {
+    // The circumcenter 'c' is not visible from 'q' (the interior of the tet).
+// iffalse
+    if (b->verbose > 2) {
+      printf("    New point %d is blocked by a polygon.\n", pointmark(newpt));
+    }
+// \fi
+    pointdealloc(newpt);  // Do not insert this vertex.
+    if (b->nobisect) return 0; // -Y option.
+    // There must be a polygon that blocks the visibility.
+    // Search a subpolygon that contains the proj(c).
+    face searchsh;
+    REAL prjpt[3];
+    locateresult sloc = OUTSIDE;
+    tspivot(searchtet, searchsh);
+    ppt = (point *) &(searchsh.sh[3]);
+    projpt2face(ccent, ppt[0], ppt[1], ppt[2], prjpt);
+    // Locate proj(c) on polygon. 
+    sloc = slocate(prjpt, &searchsh, 0, 0, 1);
+    if ((sloc == ONEDGE) || (sloc == ONFACE)) {
+      // Found a subface/edge containing proj(c).
+      // Check if 'c' encoraches upon this subface.
+      REAL fcent[3], r = 0;
+      ppt = (point *) &(searchsh.sh[3]);
+      if (checkfac4encroach(ppt[0], ppt[1], ppt[2], ccent, fcent, &r)) {
+        // Encroached. Split this subface.
+        splitflag = splitsubface(&searchsh, NULL, org(*splittet), qflag, 
+                                 fcent, chkencflag | 2);
+        if (splitflag) {
+          // Some subfaces may need to be repaired.
+          repairencfacs(chkencflag | 2);
+        }
+      } 
+    }
+    else if ((sloc == OUTSIDE) || (sloc == ENCSEGMENT)) {
+      // Hit a segment. We should split it. 
+      // To be done...
+    } 
+    if (splitflag) {
+      // Queue the tet if it is still alive.
+      if ((splittet->tet != NULL) && (splittet->tet[4] != NULL)) {
+        enqueuetetrahedron(splittet);
+      }
+    }
+    return splitflag;
   }
 
 
-  triface searchtet;
 
-  // Insert the point.
-  stpivot(searchsh, searchtet);
-  ivf.bowywat = 3; // Use Bowyer-Watson. Preserve subsegments and subfaces;
+  // Use Bowyer-Watson algorithm. Preserve subsegments and subfaces;
+  ivf.bowywat = 3;
   ivf.lawson = 2;
-  ivf.rejflag = 1; // Do check the encroachment of segments.
+  ivf.rejflag = 3;  // Do check for encroached segments and subfaces.
   if (b->metric) {
-    ivf.rejflag |= 4;  // Do check encroachment of protecting balls.
+    ivf.rejflag |= 4; // Reject it if it lies in some protecting balls.
   }
   ivf.chkencflag = chkencflag;
-  ivf.sloc = (int) INSTAR; // ivf.iloc;
-  ivf.sbowywat = 3; // ivf.bowywat;
-  ivf.splitbdflag = 1;
+  ivf.sloc = ivf.sbowywat = 0; // No use.
+  ivf.splitbdflag = 0; // No use.
   ivf.validflag = 1;
   ivf.respectbdflag = 1;
   ivf.assignmeshsize = b->metric;
-  ivf.refineflag = 2;
-  ivf.refinesh = *splitfac;
-  ivf.smlenflag = useinsertradius; // Update the insertion radius.
 
+  ivf.refineflag = 1;
+  ivf.refinetet = *splittet;
 
-  if (insertpoint(newpt, &searchtet, &searchsh, NULL, &ivf)) {
-    st_facref_count++;
+
+  if (insertpoint(newpt, &searchtet, NULL, NULL, &ivf)) {
+    // Vertex is inserted.
+    st_volref_count++;
     if (steinerleft > 0) steinerleft--;
-    if (useinsertradius) {
-      save_facetpoint_insradius(newpt, ivf.parentpt, ivf.smlen);
-    } // if (useinsertradius)
     if (flipstack != NULL) {
       flipconstraints fc;
       fc.chkencflag = chkencflag;
@@ -24914,4125 +26298,5090 @@ int tetgenmesh::splitsubface(face *splitfac, point encpt, point encpt1,
     }
     return 1;
   } else {
-    // Point was not inserted.
+    // Point is not inserted.
     pointdealloc(newpt);
+    // Check if there are encroached segments/subfaces.
     if (ivf.iloc == (int) ENCSEGMENT) {
-      // Select an encroached segment and split it.
-      face *paryseg;
-      int splitflag = 0;
-      for (i = 0; i < encseglist->objects; i++) {
-        paryseg = (face *) fastlookup(encseglist, i);
-        if (splitsegment(paryseg, NULL, 0.0, encpt, encpt1, qflag, 
-                         chkencflag | 1)) {
-          splitflag = 1; // A point is inserted on a segment.
-          break;
+      if (!b->nobisect || checkconstraints) {  
+        // Select an encroached segment and split it.
+        for (i = 0; i < encseglist->objects; i++) {
+          paryseg = (face *) fastlookup(encseglist, i);
+          if (splitsegment(paryseg, NULL, rv, org(*splittet), NULL, qflag, 
+                           chkencflag | 3)) {
+            splitflag = 1; // A point is inserted on a segment.
+            break;
+          }
         }
-      } // i
+      } // if (!b->nobisect)
       encseglist->restart();
       if (splitflag) {
         // Some segments may need to be repaired.
         if (badsubsegs->items > 0) {
-          repairencsegs(chkencflag | 1);
+          repairencsegs(chkencflag | 3);
+        }
+        // Some subfaces may need to be repaired.
+        if (badsubfacs->items > 0) {
+          repairencfacs(chkencflag | 2);
+        }
+      }
+    } else if (ivf.iloc == (int) ENCSUBFACE) {
+      if (!b->nobisect || checkconstraints) {
+        // Select an encroached subface and split it.
+        for (i = 0; i < encshlist->objects; i++) {
+          bface = (badface *) fastlookup(encshlist, i);
+          if (splitsubface(&(bface->ss), NULL, org(*splittet), qflag, 
+                           bface->cent, chkencflag | 2)){
+            splitflag = 1; // A point is inserted on a subface or a segment.
+            break;
+          }
+        }
+      } // if (!b->nobisect)
+      encshlist->restart();
+      if (splitflag) {
+        // Some subfaces may need to be repaired.
+        if (badsubfacs->items > 0) {
+          repairencfacs(chkencflag | 2);
         }
-        return 1;
       }
     } else {
       if (ivf.iloc == (int) NEARVERTEX) {
         terminatetetgen(this, 2);
       }
     }
-    // Mark this subface to avoid splitting in the future.
-	smarktest3(*splitfac);
-    return 0;
+    if (splitflag) {
+      // Queue the tet if it is still alive.
+      if ((splittet->tet != NULL) && (splittet->tet[4] != NULL)) {
+        enqueuetetrahedron(splittet);
+      }
+    }
+    return splitflag;
   }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// repairencfacs()    Repair encroached subfaces.                            //
+// repairbadtets()    Repair bad quality tetrahedra.                         //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-void tetgenmesh::repairencfacs(int chkencflag)
+void tetgenmesh::repairbadtets(int chkencflag)
 {
-  face *bface;
-  point encpt = NULL;
-  int qflag = 0;
+  triface *bface;
   REAL ccent[3];
+  int qflag = 0;
+
 
   // Loop until the pool 'badsubfacs' is empty. Note that steinerleft == -1
   //   if an unlimited number of Steiner points is allowed.
-  while ((badsubfacs->items > 0) && (steinerleft != 0)) {
-    badsubfacs->traversalinit();
-    bface = (face *) badsubfacs->traverse();
+  while ((badtetrahedrons->items > 0) && (steinerleft != 0)) {
+    badtetrahedrons->traversalinit();
+    bface = (triface *) badtetrahedrons->traverse();
     while ((bface != NULL) && (steinerleft != 0)) {
       // Skip a deleted element.
-      if (bface->shver >= 0) {
-        // A queued subface may have been deleted (split).
-        if ((bface->sh != NULL) && (bface->sh[3] != NULL)) {
-          // A queued subface may have been processed. 
-          if (smarktest2ed(*bface)) {
-            sunmarktest2(*bface);
-            if (checkfac4split(bface, encpt, qflag, ccent)) {
-              splitsubface(bface, encpt, NULL, qflag, ccent, chkencflag);
+      if (bface->ver >= 0) {
+        // A queued tet may have been deleted.
+        if (!isdeadtet(*bface)) {
+          // A queued tet may have been processed.
+          if (marktest2ed(*bface)) {
+            unmarktest2(*bface);
+            if (checktet4split(bface, qflag, ccent)) {
+              splittetrahedron(bface, qflag, ccent, chkencflag);
             }
           }
         }
-        bface->shver = -1; // Signal it as a deleted element.
-        badsubfacs->dealloc((void *) bface); // Remove this entry from list.
+        bface->ver = -1; // Signal it as a deleted element.
+        badtetrahedrons->dealloc((void *) bface);
       }
-      bface = (face *) badsubfacs->traverse();
+      bface = (triface *) badtetrahedrons->traverse();
     }
   }
 
-  if (badsubfacs->items > 0) {
+  if (badtetrahedrons->items > 0) {
     if (steinerleft == 0) {
       if (b->verbose) {
         printf("The desired number of Steiner points is reached.\n");
       }
     } else {
-      terminatetetgen(this, 2);
+      terminatetetgen(this, 2); // Unknown case.
     }
-    badsubfacs->traversalinit();
-    bface = (face *) badsubfacs->traverse();
-    while (bface  != NULL) {
+    // Unmark all queued tet.
+    badtetrahedrons->traversalinit();
+    bface = (triface *) badtetrahedrons->traverse();
+    while (bface != NULL) {
       // Skip a deleted element.
-      if (bface->shver >= 0) {
-        if ((bface->sh != NULL) && (bface->sh[3] != NULL)) {
-          if (smarktest2ed(*bface)) {
-            sunmarktest2(*bface);
+      if (bface->ver >= 0) {
+        if (!isdeadtet(*bface)) {
+          if (marktest2ed(*bface)) {
+            unmarktest2(*bface);
           }
         }
       }
-      bface = (face *) badsubfacs->traverse();
+      bface = (triface *) badtetrahedrons->traverse();
     }
-    badsubfacs->restart();
+    // Clear the pool.
+    badtetrahedrons->restart();
   }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// checktet4split()    Check if the tet needs to be split.                   //
+// delaunayrefinement()    Refine the mesh by Delaunay refinement.           //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-int tetgenmesh::checktet4split(triface *chktet, int &qflag, REAL *ccent) 
+void tetgenmesh::delaunayrefinement()
 {
-  point pa, pb, pc, pd, *ppt;
-  REAL vda[3], vdb[3], vdc[3];
-  REAL vab[3], vbc[3], vca[3];
-  REAL N[4][3], L[4], cosd[6], elen[6];
-  REAL maxcosd, vol, volbnd, smlen = 0, rd;
-  REAL A[4][4], rhs[4], D;
-  int indx[4];
-  int i, j;
-
-  if (b->convex) { // -c
-    // Skip this tet if it lies in the exterior.
-    if (elemattribute(chktet->tet, numelemattrib - 1) == -1.0) {
-      return 0;
-    }
-  }
+  triface checktet;
+  face checksh;
+  face checkseg;
+  long steinercount;
+  int chkencflag;
 
-  qflag = 0;
+  long bak_segref_count, bak_facref_count, bak_volref_count;
+  long bak_flipcount = flip23count + flip32count + flip44count;
 
-  pd = (point) chktet->tet[7];
-  if (pd == dummypoint) {
-    return 0; // Do not split a hull tet.
+  if (!b->quiet) {
+    printf("Refining mesh...\n");
   }
 
-  pa = (point) chktet->tet[4];
-  pb = (point) chktet->tet[5];
-  pc = (point) chktet->tet[6];
-
-  // Get the edge vectors vda: d->a, vdb: d->b, vdc: d->c.
-  // Set the matrix A = [vda, vdb, vdc]^T.
-  for (i = 0; i < 3; i++) A[0][i] = vda[i] = pa[i] - pd[i];
-  for (i = 0; i < 3; i++) A[1][i] = vdb[i] = pb[i] - pd[i];
-  for (i = 0; i < 3; i++) A[2][i] = vdc[i] = pc[i] - pd[i];
-
-  // Get the other edge vectors.
-  for (i = 0; i < 3; i++) vab[i] = pb[i] - pa[i];
-  for (i = 0; i < 3; i++) vbc[i] = pc[i] - pb[i];
-  for (i = 0; i < 3; i++) vca[i] = pa[i] - pc[i];
-
-  if (!lu_decmp(A, 3, indx, &D, 0)) {
-    // A degenerated tet (vol = 0).
-    // This is possible due to the use of exact arithmetic.  We temporarily
-    //   leave this tet. It should be fixed by mesh optimization.
-    return 0; 
+  if (b->verbose) {
+    printf("  Min radiu-edge ratio = %g.\n", b->minratio);
+    printf("  Min dihedral   angle = %g.\n", b->mindihedral);
+    //printf("  Min Edge length = %g.\n", b->minedgelength);
   }
 
-  // Check volume if '-a#' and '-a' options are used.
-  if (b->varvolume || b->fixedvolume) {
-    vol = fabs(A[indx[0]][0] * A[indx[1]][1] * A[indx[2]][2]) / 6.0;
-    if (b->fixedvolume) {
-      if (vol > b->maxvolume) {
-        qflag = 1;
-      }
-    } 
-    if (!qflag && b->varvolume) {
-      volbnd = volumebound(chktet->tet);
-      if ((volbnd > 0.0) && (vol > volbnd)) {
-        qflag = 1;
+  steinerleft = b->steinerleft;  // Upperbound of # Steiner points (by -S#).
+  if (steinerleft > 0) {
+    // Check if we've already used up the given number of Steiner points.
+    steinercount = st_segref_count + st_facref_count + st_volref_count;
+    if (steinercount < steinerleft) {
+      steinerleft -= steinercount;
+    } else {
+      if (!b->quiet) {
+        printf("\nWarning:  ");
+        printf("The desired number of Steiner points (%d) has reached.\n\n",
+               b->steinerleft);
       }
-    }
-    if (qflag == 1) {
-      // Calculate the circumcenter of this tet.
-      rhs[0] = 0.5 * dot(vda, vda);
-      rhs[1] = 0.5 * dot(vdb, vdb);
-      rhs[2] = 0.5 * dot(vdc, vdc);
-      lu_solve(A, 3, indx, rhs, 0);            
-      for (i = 0; i < 3; i++) ccent[i] = pd[i] + rhs[i];
-      return 1;
+      return; // No more Steiner points.
     }
   }
 
-  if (b->metric) { // -m option. Check mesh size. 
-    // Calculate the circumradius of this tet.
-    rhs[0] = 0.5 * dot(vda, vda);
-    rhs[1] = 0.5 * dot(vdb, vdb);
-    rhs[2] = 0.5 * dot(vdc, vdc);
-    lu_solve(A, 3, indx, rhs, 0);            
-    for (i = 0; i < 3; i++) ccent[i] = pd[i] + rhs[i];
-    rd = sqrt(dot(rhs, rhs));
-    // Check if the ccent lies outside one of the prot.balls at vertices.
-    ppt = (point *) &(chktet->tet[4]);
-    for (i = 0; i < 4; i++) {
-      if (ppt[i][pointmtrindex] > 0) {
-        if (rd > ppt[i][pointmtrindex]) {
-          qflag = 1; // Enforce mesh size.
-          return 1;
-        }
-      }
+  if (useinsertradius) {
+    if ((b->plc && b->nobisect) || b->refine) { // '-pY' or '-r' option.
+      makesegmentendpointsmap();
+      makefacetverticesmap();
     }
   }
 
-  if (in->tetunsuitable != NULL) {
-    // Execute the user-defined meshing sizing evaluation.
-    if ((*(in->tetunsuitable))(pa, pb, pc, pd, NULL, 0)) {
-      // Calculate the circumcenter of this tet.
-      rhs[0] = 0.5 * dot(vda, vda);
-      rhs[1] = 0.5 * dot(vdb, vdb);
-      rhs[2] = 0.5 * dot(vdc, vdc);
-      lu_solve(A, 3, indx, rhs, 0);            
-      for (i = 0; i < 3; i++) ccent[i] = pd[i] + rhs[i];
-      return 1;
-    }
-  }
 
-  if (useinsertradius) {
-    // Do not split this tet if the shortest edge is shorter than the
-    //   insertion radius of one of its endpoints.
-    triface checkedge;
-    point e1, e2;
-    REAL rrv, smrrv;
+  encseglist = new arraypool(sizeof(face), 8);
+  encshlist = new arraypool(sizeof(badface), 8);
 
-    // Get the shortest edge of this tet.
-    checkedge.tet = chktet->tet;
-    for (i = 0; i < 6; i++) {
-      checkedge.ver = edge2ver[i];
-      e1 = org(checkedge);
-      e2 = dest(checkedge);
-      elen[i] = distance(e1, e2);
-      if (i == 0) {
-        smlen = elen[i];
-        j = 0;
-      } else {
-        if (elen[i] < smlen) {
-          smlen = elen[i];
-          j = i;
-        }
-      }
+
+  //if (!b->nobisect) { // if no '-Y' option
+  if (!b->nobisect || checkconstraints) {
+    if (b->verbose) {
+      printf("  Splitting encroached subsegments.\n");
     }
-    // Check if the edge is too short.
-    checkedge.ver = edge2ver[j];
-    // Get the smallest rrv of e1 and e2.
-    // Note: if rrv of e1 and e2 is zero. Do not use it.
-    e1 = org(checkedge);
-    smrrv = getpointinsradius(e1);
-    e2 = dest(checkedge);
-    rrv = getpointinsradius(e2);
-    if (rrv > 0) {
-      if (smrrv > 0) {
-        if (rrv < smrrv) {
-          smrrv = rrv;
-        }
-      } else {
-        smrrv = rrv;
-      }
+
+    chkencflag = 1; // Only check encroaching subsegments.
+    steinercount = points->items;
+
+    // Initialize the pool of encroached subsegments.
+    badsubsegs = new memorypool(sizeof(face), b->shellfaceperblock, 
+                                sizeof(void *), 0);
+
+    // Add all segments into the pool.
+    subsegs->traversalinit();
+    checkseg.sh = shellfacetraverse(subsegs);
+    while (checkseg.sh != (shellface *) NULL) {
+      enqueuesubface(badsubsegs, &checkseg);
+      checkseg.sh = shellfacetraverse(subsegs);
     }
-    if (smrrv > 0) {
-      // To avoid rounding error, round smrrv before doing comparison.
-      if ((fabs(smrrv - smlen) / smlen) < b->epsilon) {
-        smrrv = smlen;
+
+    // Split all encroached segments.
+    repairencsegs(chkencflag);
+
+    if (b->verbose) {
+      printf("  Added %ld Steiner points.\n", points->items - steinercount);
+    }
+
+    if (b->reflevel > 1) { // '-D2' option
+      if (b->verbose) {
+        printf("  Splitting encroached subfaces.\n");
       }
-      if (smrrv > smlen) {
-        return 0;
+
+      chkencflag = 2; // Only check encroaching subfaces.
+      steinercount = points->items;
+      bak_segref_count = st_segref_count;
+      bak_facref_count = st_facref_count;
+
+      // Initialize the pool of encroached subfaces.
+      badsubfacs = new memorypool(sizeof(face), b->shellfaceperblock, 
+                                  sizeof(void *), 0);
+
+      // Add all subfaces into the pool.
+      subfaces->traversalinit();
+      checksh.sh = shellfacetraverse(subfaces);
+      while (checksh.sh != (shellface *) NULL) {
+        enqueuesubface(badsubfacs, &checksh);
+        checksh.sh = shellfacetraverse(subfaces);
       }
-    }
-  } // if (useinsertradius)
 
-  // Check the radius-edge ratio. Set by -q#.
-  if (b->minratio > 0) { 
-    // Calculate the circumcenter and radius of this tet.
-    rhs[0] = 0.5 * dot(vda, vda);
-    rhs[1] = 0.5 * dot(vdb, vdb);
-    rhs[2] = 0.5 * dot(vdc, vdc);
-    lu_solve(A, 3, indx, rhs, 0);            
-    for (i = 0; i < 3; i++) ccent[i] = pd[i] + rhs[i];
-    rd = sqrt(dot(rhs, rhs));
-    if (!useinsertradius) {
-      // Calculate the shortest edge length.
-      elen[0] = dot(vda, vda);
-      elen[1] = dot(vdb, vdb);
-      elen[2] = dot(vdc, vdc);
-      elen[3] = dot(vab, vab);
-      elen[4] = dot(vbc, vbc);
-      elen[5] = dot(vca, vca);
-      smlen = elen[0]; //sidx = 0;
-      for (i = 1; i < 6; i++) {
-        if (smlen > elen[i]) { 
-          smlen = elen[i]; //sidx = i; 
-        }
+      // Split all encroached subfaces.
+      repairencfacs(chkencflag);
+
+      if (b->verbose) {
+        printf("  Added %ld (%ld,%ld) Steiner points.\n",  
+               points->items-steinercount, st_segref_count-bak_segref_count,
+               st_facref_count-bak_facref_count);
       }
-      smlen = sqrt(smlen);
-    }
-    D = rd / smlen;
-    if (D > b->minratio) {
-      // A bad radius-edge ratio.
-      return 1;
+    } // if (b->reflevel > 1)
+  } // if (!b->nobisect)
+
+  if (b->reflevel > 2) { // '-D3' option (The default option)
+    if (b->verbose) {
+      printf("  Splitting bad quality tets.\n");
     }
-  }
 
-  // Check the minimum dihedral angle. Set by -qq#.
-  if (b->mindihedral > 0) { 
-    // Compute the 4 face normals (N[0], ..., N[3]).
-    for (j = 0; j < 3; j++) {
-      for (i = 0; i < 3; i++) N[j][i] = 0.0;
-      N[j][j] = 1.0;  // Positive means the inside direction
-      lu_solve(A, 3, indx, N[j], 0);
+    chkencflag = 4; // Only check tetrahedra.
+    steinercount = points->items;
+    bak_segref_count = st_segref_count;
+    bak_facref_count = st_facref_count;
+    bak_volref_count = st_volref_count;
+
+    // The cosine value of the min dihedral angle (-qq) for tetrahedra.
+    cosmindihed = cos(b->mindihedral / 180.0 * PI);
+
+    // Initialize the pool of bad quality tetrahedra.
+    badtetrahedrons = new memorypool(sizeof(triface), b->tetrahedraperblock,
+                                     sizeof(void *), 0);
+    // Add all tetrahedra (no hull tets) into the pool.
+    tetrahedrons->traversalinit();
+    checktet.tet = tetrahedrontraverse();
+    while (checktet.tet != NULL) {
+      enqueuetetrahedron(&checktet);
+      checktet.tet = tetrahedrontraverse();
     }
-    for (i = 0; i < 3; i++) N[3][i] = - N[0][i] - N[1][i] - N[2][i];
-    // Normalize the normals.
-    for (i = 0; i < 4; i++) {
-      L[i] = sqrt(dot(N[i], N[i]));
-      if (L[i] == 0) {
-        terminatetetgen(this, 2);
-      }
-      for (j = 0; j < 3; j++) N[i][j] /= L[i];
+
+    // Split all bad quality tetrahedra.
+    repairbadtets(chkencflag);
+
+    if (b->verbose) {
+      printf("  Added %ld (%ld,%ld,%ld) Steiner points.\n", 
+             points->items - steinercount, 
+             st_segref_count - bak_segref_count,
+             st_facref_count - bak_facref_count,
+             st_volref_count - bak_volref_count);
     }
-    // Calculate the six dihedral angles.
-    cosd[0] = -dot(N[0], N[1]); // Edge cd, bd, bc.
-    cosd[1] = -dot(N[0], N[2]);
-    cosd[2] = -dot(N[0], N[3]);
-    cosd[3] = -dot(N[1], N[2]); // Edge ad, ac
-    cosd[4] = -dot(N[1], N[3]);
-    cosd[5] = -dot(N[2], N[3]); // Edge ab
-    // Get the smallest dihedral angle.
-    //maxcosd = mincosd = cosd[0];
-    maxcosd = cosd[0];
-    for (i = 1; i < 6; i++) {
-      //if (cosd[i] > maxcosd) maxcosd = cosd[i];
-      maxcosd = (cosd[i] > maxcosd ? cosd[i] : maxcosd);
-      //mincosd = (cosd[i] < mincosd ? cosd[i] : maxcosd);
+  } // if (b->reflevel > 2)
+
+  if (b->verbose) {
+    if (flip23count + flip32count + flip44count > bak_flipcount) {
+      printf("  Performed %ld flips.\n", flip23count + flip32count +
+             flip44count - bak_flipcount);
     }
-    if (maxcosd > cosmindihed) {
-      // Calculate the circumcenter of this tet.
-      // A bad dihedral angle.
-      //if ((b->quality & 1) == 0) {
-        rhs[0] = 0.5 * dot(vda, vda);
-        rhs[1] = 0.5 * dot(vdb, vdb);
-        rhs[2] = 0.5 * dot(vdc, vdc);
-        lu_solve(A, 3, indx, rhs, 0);            
-        for (i = 0; i < 3; i++) ccent[i] = pd[i] + rhs[i];
-        //*rd = sqrt(dot(rhs, rhs));
-      //}
-      return 1;
+  }
+
+  if (steinerleft == 0) {
+    if (!b->quiet) {
+      printf("\nWarnning:  ");
+      printf("The desired number of Steiner points (%d) is reached.\n\n",
+             b->steinerleft);
     }
   }
 
-  return 0;
+
+  delete encseglist;
+  delete encshlist;
+  encseglist = NULL;
+  encshlist = NULL;
+
+  if (!b->nobisect || checkconstraints) {
+    totalworkmemory += (badsubsegs->maxitems * badsubsegs->itembytes);
+    delete badsubsegs;
+    badsubsegs = NULL;
+    if (b->reflevel > 1) {
+      totalworkmemory += (badsubfacs->maxitems * badsubfacs->itembytes);
+      delete badsubfacs;
+      badsubfacs = NULL;
+    }
+  }
+  if (b->reflevel > 2) {
+    totalworkmemory += (badtetrahedrons->maxitems*badtetrahedrons->itembytes);
+    delete badtetrahedrons;
+    badtetrahedrons = NULL;
+  }
 }
 
+////                                                                       ////
+////                                                                       ////
+//// refine_cxx ///////////////////////////////////////////////////////////////
+
+//// optimize_cxx /////////////////////////////////////////////////////////////
+////                                                                       ////
+////                                                                       ////
+
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// splittetrahedron()    Split a tetrahedron.                                //
+// lawsonflip3d()    A three-dimensional Lawson's algorithm.                 //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-int tetgenmesh::splittetrahedron(triface* splittet, int qflag, REAL *ccent, 
-                                 int chkencflag)
+long tetgenmesh::lawsonflip3d(flipconstraints *fc)
 {
-  triface searchtet;
-  face *paryseg;
-  point newpt, *ppt;
-  badface *bface;
-  insertvertexflags ivf;
-  int splitflag = 0;
-  int i;
-
-
-
-  REAL rv = 0.; // Insertion radius of 'newpt'.
-
-  makepoint(&newpt, FREEVOLVERTEX);
-  for (i = 0; i < 3; i++) newpt[i] = ccent[i];
-
-  if (useinsertradius) {
-    rv = distance(newpt, org(*splittet));
-    setpointinsradius(newpt, rv);
-  }
-
-  // Locate the new point. Starting from an interior point 'q' of the
-  //   splittet. We perform a walk from q to the 'newpt', stop walking
-  //   either we hit a subface or enter OUTSIDE.
-  searchtet = *splittet;
-  ivf.iloc = (int) OUTSIDE;
-  ivf.iloc = locate(newpt, &searchtet, 1); // 'chkencflag' = 1.
-
-  if ((ivf.iloc == (int) OUTSIDE) || (ivf.iloc == (int) ENCSUBFACE)) {
-    // The circumcenter 'c' is not visible from 'q' (the interior of the tet).
-// iffalse
-    if (b->verbose > 2) {
-      printf("    New point %d is blocked by a polygon.\n", pointmark(newpt));
-    }
-// \fi
-    pointdealloc(newpt);  // Do not insert this vertex.
-    if (b->nobisect) return 0; // -Y option.
-    // There must be a polygon that blocks the visibility.
-    // Search a subpolygon that contains the proj(c).
-    face searchsh;
-    REAL prjpt[3];
-    locateresult sloc = OUTSIDE;
-    tspivot(searchtet, searchsh);
-    ppt = (point *) &(searchsh.sh[3]);
-    projpt2face(ccent, ppt[0], ppt[1], ppt[2], prjpt);
-    // Locate proj(c) on polygon. 
-    sloc = slocate(prjpt, &searchsh, 0, 0, 1);
-    if ((sloc == ONEDGE) || (sloc == ONFACE)) {
-      // Found a subface/edge containing proj(c).
-      // Check if 'c' encoraches upon this subface.
-      REAL fcent[3], r = 0;
-      ppt = (point *) &(searchsh.sh[3]);
-      if (checkfac4encroach(ppt[0], ppt[1], ppt[2], ccent, fcent, &r)) {
-        // Encroached. Split this subface.
-        splitflag = splitsubface(&searchsh, NULL, org(*splittet), qflag, 
-                                 fcent, chkencflag | 2);
-        if (splitflag) {
-          // Some subfaces may need to be repaired.
-          repairencfacs(chkencflag | 2);
-        }
-      } 
+  triface fliptets[5], neightet, hulltet;
+  face checksh, casingout;
+  badface *popface, *bface;
+  point pd, pe, *pts;
+  REAL sign, ori;
+  REAL vol, len3;
+  long flipcount, totalcount = 0l;
+  long sliver_peels = 0l;
+  int t1ver;
+  int i;
+
+
+  while (1) {
+
+    if (b->verbose > 2) {
+      printf("      Lawson flip %ld faces.\n", flippool->items);
     }
-    else if ((sloc == OUTSIDE) || (sloc == ENCSEGMENT)) {
-      // Hit a segment. We should split it. 
-      // To be done...
-    } 
-    if (splitflag) {
-      // Queue the tet if it is still alive.
-      if ((splittet->tet != NULL) && (splittet->tet[4] != NULL)) {
-        enqueuetetrahedron(splittet);
+    flipcount = 0l;
+
+    while (flipstack != (badface *) NULL) {
+      // Pop a face from the stack.
+      popface = flipstack;
+      fliptets[0] = popface->tt;
+      flipstack = flipstack->nextitem; // The next top item in stack.
+      flippool->dealloc((void *) popface);
+
+      // Skip it if it is a dead tet (destroyed by previous flips).
+      if (isdeadtet(fliptets[0])) continue;
+      // Skip it if it is not the same tet as we saved.
+      if (!facemarked(fliptets[0])) continue;
+
+      unmarkface(fliptets[0]);
+
+      if (ishulltet(fliptets[0])) continue;
+
+      fsym(fliptets[0], fliptets[1]);
+      if (ishulltet(fliptets[1])) {
+        if (nonconvex) {
+          // Check if 'fliptets[0]' it is a hull sliver.
+          tspivot(fliptets[0], checksh);
+          for (i = 0; i < 3; i++) {
+            if (!isshsubseg(checksh)) {
+              spivot(checksh, casingout);
+              //assert(casingout.sh != NULL);
+              if (sorg(checksh) != sdest(casingout)) sesymself(casingout);
+              stpivot(casingout, neightet);
+              if (neightet.tet == fliptets[0].tet) {
+                // Found a hull sliver 'neightet'. Let it be [e,d,a,b], where 
+                //   [e,d,a] and [d,e,b] are hull faces.
+                edestoppo(neightet, hulltet); // [a,b,e,d]
+                fsymself(hulltet); // [b,a,e,#]
+                if (oppo(hulltet) == dummypoint) {
+                  pe = org(neightet);
+                  if ((pointtype(pe) == FREEFACETVERTEX) ||
+                      (pointtype(pe) == FREESEGVERTEX)) {
+                    removevertexbyflips(pe);
+                  }
+                } else {
+                  eorgoppo(neightet, hulltet); // [b,a,d,e]
+                  fsymself(hulltet); // [a,b,d,#]
+                  if (oppo(hulltet) == dummypoint) {
+                    pd = dest(neightet);
+                    if ((pointtype(pd) == FREEFACETVERTEX) ||
+                        (pointtype(pd) == FREESEGVERTEX)) {
+                      removevertexbyflips(pd);
+                    }
+                  } else {
+                    // Perform a 3-to-2 flip to remove the sliver.
+                    fliptets[0] = neightet;          // [e,d,a,b]
+                    fnext(fliptets[0], fliptets[1]); // [e,d,b,c]
+                    fnext(fliptets[1], fliptets[2]); // [e,d,c,a]
+                    flip32(fliptets, 1, fc);
+                    // Update counters.
+                    flip32count--;
+                    flip22count--;
+                    sliver_peels++;
+                    if (fc->remove_ndelaunay_edge) {
+                      // Update the volume (must be decreased).
+                      //assert(fc->tetprism_vol_sum <= 0);
+                      tetprism_vol_sum += fc->tetprism_vol_sum;
+                      fc->tetprism_vol_sum = 0.0; // Clear it.
+                    }
+                  }
+                }
+                break;
+              } // if (neightet.tet == fliptets[0].tet)
+            } // if (!isshsubseg(checksh))
+            senextself(checksh);
+          } // i
+        } // if (nonconvex)
+        continue;
       }
-    }
-    return splitflag;
-  }
 
+      if (checksubfaceflag) {
+        // Do not flip if it is a subface.
+        if (issubface(fliptets[0])) continue;
+      }
 
+      // Test whether the face is locally Delaunay or not.
+      pts = (point *) fliptets[1].tet; 
+      sign = insphere_s(pts[4], pts[5], pts[6], pts[7], oppo(fliptets[0]));
 
-  // Use Bowyer-Watson algorithm. Preserve subsegments and subfaces;
-  ivf.bowywat = 3;
-  ivf.lawson = 2;
-  ivf.rejflag = 3;  // Do check for encroached segments and subfaces.
-  if (b->metric) {
-    ivf.rejflag |= 4; // Reject it if it lies in some protecting balls.
-  }
-  ivf.chkencflag = chkencflag;
-  ivf.sloc = ivf.sbowywat = 0; // No use.
-  ivf.splitbdflag = 0; // No use.
-  ivf.validflag = 1;
-  ivf.respectbdflag = 1;
-  ivf.assignmeshsize = b->metric;
+      if (sign < 0) {
+        // A non-Delaunay face. Try to flip it.
+        pd = oppo(fliptets[0]);
+        pe = oppo(fliptets[1]);
 
-  ivf.refineflag = 1;
-  ivf.refinetet = *splittet;
+        // Use the length of the edge [d,e] as a reference to determine
+        //   a nearly degenerated new tet.
+        len3 = distance(pd, pe);
+        len3 = (len3 * len3 * len3);
 
+        // Check the convexity of its three edges. Stop checking either a
+        //   locally non-convex edge (ori < 0) or a flat edge (ori = 0) is
+        //   encountered, and 'fliptet' represents that edge.
+        for (i = 0; i < 3; i++) {
+          ori = orient3d(org(fliptets[0]), dest(fliptets[0]), pd, pe);
+          if (ori > 0) {
+            // Avoid creating a nearly degenerated new tet at boundary.
+            //   Re-use fliptets[2], fliptets[3];
+            esym(fliptets[0], fliptets[2]);
+            esym(fliptets[1], fliptets[3]);
+            if (issubface(fliptets[2]) || issubface(fliptets[3])) {
+              vol = orient3dfast(org(fliptets[0]), dest(fliptets[0]), pd, pe);
+              if ((fabs(vol) / len3) < b->epsilon) {
+                ori = 0.0; // Do rounding.
+              }
+            }
+          } // Rounding check
+          if (ori <= 0) break;
+          enextself(fliptets[0]);
+          eprevself(fliptets[1]);
+        }
 
-  if (insertpoint(newpt, &searchtet, NULL, NULL, &ivf)) {
-    // Vertex is inserted.
-    st_volref_count++;
-    if (steinerleft > 0) steinerleft--;
-    if (flipstack != NULL) {
-      flipconstraints fc;
-      fc.chkencflag = chkencflag;
-      fc.enqflag = 2;
-      lawsonflip3d(&fc);
-      unflipqueue->restart();
-    }
-    return 1;
-  } else {
-    // Point is not inserted.
-    pointdealloc(newpt);
-    // Check if there are encroached segments/subfaces.
-    if (ivf.iloc == (int) ENCSEGMENT) {
-      if (!b->nobisect || checkconstraints) {  
-        // Select an encroached segment and split it.
-        for (i = 0; i < encseglist->objects; i++) {
-          paryseg = (face *) fastlookup(encseglist, i);
-          if (splitsegment(paryseg, NULL, rv, org(*splittet), NULL, qflag, 
-                           chkencflag | 3)) {
-            splitflag = 1; // A point is inserted on a segment.
-            break;
+        if (ori > 0) {
+          // A 2-to-3 flip is found.
+          //   [0] [a,b,c,d], 
+          //   [1] [b,a,c,e]. no dummypoint.
+          flip23(fliptets, 0, fc);
+          flipcount++;
+          if (fc->remove_ndelaunay_edge) {
+            // Update the volume (must be decreased).
+            //assert(fc->tetprism_vol_sum <= 0);
+            tetprism_vol_sum += fc->tetprism_vol_sum;
+            fc->tetprism_vol_sum = 0.0; // Clear it.
           }
-        }
-      } // if (!b->nobisect)
-      encseglist->restart();
-      if (splitflag) {
-        // Some segments may need to be repaired.
-        if (badsubsegs->items > 0) {
-          repairencsegs(chkencflag | 3);
-        }
-        // Some subfaces may need to be repaired.
-        if (badsubfacs->items > 0) {
-          repairencfacs(chkencflag | 2);
-        }
-      }
-    } else if (ivf.iloc == (int) ENCSUBFACE) {
-      if (!b->nobisect || checkconstraints) {
-        // Select an encroached subface and split it.
-        for (i = 0; i < encshlist->objects; i++) {
-          bface = (badface *) fastlookup(encshlist, i);
-          if (splitsubface(&(bface->ss), NULL, org(*splittet), qflag, 
-                           bface->cent, chkencflag | 2)){
-            splitflag = 1; // A point is inserted on a subface or a segment.
-            break;
+          continue;
+        } else { // ori <= 0
+          // The edge ('fliptets[0]' = [a',b',c',d]) is non-convex or flat,
+          //   where the edge [a',b'] is one of [a,b], [b,c], and [c,a].
+          if (checksubsegflag) {
+            // Do not flip if it is a segment.
+            if (issubseg(fliptets[0])) continue;
+          }
+          // Check if there are three or four tets sharing at this edge.        
+          esymself(fliptets[0]); // [b,a,d,c]
+          for (i = 0; i < 3; i++) {
+            fnext(fliptets[i], fliptets[i+1]);
+          }
+          if (fliptets[3].tet == fliptets[0].tet) {
+            // A 3-to-2 flip is found. (No hull tet.)
+            flip32(fliptets, 0, fc); 
+            flipcount++;
+            if (fc->remove_ndelaunay_edge) {
+              // Update the volume (must be decreased).
+              //assert(fc->tetprism_vol_sum <= 0);
+              tetprism_vol_sum += fc->tetprism_vol_sum;
+              fc->tetprism_vol_sum = 0.0; // Clear it.
+            }
+            continue;
+          } else {
+            // There are more than 3 tets at this edge.
+            fnext(fliptets[3], fliptets[4]);
+            if (fliptets[4].tet == fliptets[0].tet) {
+              // There are exactly 4 tets at this edge.
+              if (nonconvex) {
+                if (apex(fliptets[3]) == dummypoint) {
+                  // This edge is locally non-convex on the hull.
+                  // It can be removed by a 4-to-4 flip.                  
+                  ori = 0;
+                }
+              } // if (nonconvex)
+              if (ori == 0) {
+                // A 4-to-4 flip is found. (Two hull tets may be involved.)
+                // Current tets in 'fliptets':
+                //   [0] [b,a,d,c] (d may be newpt)
+                //   [1] [b,a,c,e]
+                //   [2] [b,a,e,f] (f may be dummypoint)
+                //   [3] [b,a,f,d]
+                esymself(fliptets[0]); // [a,b,c,d] 
+                // A 2-to-3 flip replaces face [a,b,c] by edge [e,d].
+                //   This creates a degenerate tet [e,d,a,b] (tmpfliptets[0]).
+                //   It will be removed by the followed 3-to-2 flip.
+                flip23(fliptets, 0, fc); // No hull tet.
+                fnext(fliptets[3], fliptets[1]);
+                fnext(fliptets[1], fliptets[2]);
+                // Current tets in 'fliptets':
+                //   [0] [...]
+                //   [1] [b,a,d,e] (degenerated, d may be new point).
+                //   [2] [b,a,e,f] (f may be dummypoint)
+                //   [3] [b,a,f,d]
+                // A 3-to-2 flip replaces edge [b,a] by face [d,e,f].
+                //   Hull tets may be involved (f may be dummypoint).
+                flip32(&(fliptets[1]), (apex(fliptets[3]) == dummypoint), fc);
+                flipcount++;
+                flip23count--;
+                flip32count--;
+                flip44count++;
+                if (fc->remove_ndelaunay_edge) {
+                  // Update the volume (must be decreased).
+                  //assert(fc->tetprism_vol_sum <= 0);
+                  tetprism_vol_sum += fc->tetprism_vol_sum;
+                  fc->tetprism_vol_sum = 0.0; // Clear it.
+                }
+                continue;
+              } // if (ori == 0)
+            }
           }
-        }
-      } // if (!b->nobisect)
-      encshlist->restart();
-      if (splitflag) {
-        // Some subfaces may need to be repaired.
-        if (badsubfacs->items > 0) {
-          repairencfacs(chkencflag | 2);
-        }
-      }
-    } else {
-      if (ivf.iloc == (int) NEARVERTEX) {
-        terminatetetgen(this, 2);
+        } // if (ori <= 0)
+
+        // This non-Delaunay face is unflippable. Save it.
+        unflipqueue->newindex((void **) &bface);
+        bface->tt = fliptets[0];
+        bface->forg  = org(fliptets[0]);
+        bface->fdest = dest(fliptets[0]);
+        bface->fapex = apex(fliptets[0]);
+      } // if (sign < 0)
+    } // while (flipstack)
+
+    if (b->verbose > 2) {
+      if (flipcount > 0) {
+        printf("      Performed %ld flips.\n", flipcount);
       }
     }
-    if (splitflag) {
-      // Queue the tet if it is still alive.
-      if ((splittet->tet != NULL) && (splittet->tet[4] != NULL)) {
-        enqueuetetrahedron(splittet);
+    // Accumulate the counter of flips.
+    totalcount += flipcount;
+
+    // Return if no unflippable faces left.
+    if (unflipqueue->objects == 0l) break; 
+    // Return if no flip has been performed.
+    if (flipcount == 0l) break;
+
+    // Try to flip the unflippable faces.
+    for (i = 0; i < unflipqueue->objects; i++) {
+      bface = (badface *) fastlookup(unflipqueue, i);
+      if (!isdeadtet(bface->tt) && 
+          (org(bface->tt) == bface->forg) &&
+          (dest(bface->tt) == bface->fdest) &&
+          (apex(bface->tt) == bface->fapex)) {
+        flippush(flipstack, &(bface->tt));
       }
     }
-    return splitflag;
+    unflipqueue->restart();
+
+  } // while (1)
+
+  if (b->verbose > 2) {
+    if (totalcount > 0) {
+      printf("      Performed %ld flips.\n", totalcount);
+    }
+    if (sliver_peels > 0) {
+      printf("      Removed %ld hull slivers.\n", sliver_peels);
+    }
+    if (unflipqueue->objects > 0l) {
+      printf("      %ld unflippable edges remained.\n", unflipqueue->objects);
+    }
   }
+
+  return totalcount + sliver_peels;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// repairbadtets()    Repair bad quality tetrahedra.                         //
+// recoverdelaunay()    Recovery the locally Delaunay property.              //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-void tetgenmesh::repairbadtets(int chkencflag)
+void tetgenmesh::recoverdelaunay()
 {
-  triface *bface;
-  REAL ccent[3];
-  int qflag = 0;
+  arraypool *flipqueue, *nextflipqueue, *swapqueue;
+  triface tetloop, neightet, *parytet;
+  badface *bface, *parybface;
+  point *ppt;
+  flipconstraints fc;
+  int i, j;
 
+  if (!b->quiet) {
+    printf("Recovering Delaunayness...\n");
+  }
 
-  // Loop until the pool 'badsubfacs' is empty. Note that steinerleft == -1
-  //   if an unlimited number of Steiner points is allowed.
-  while ((badtetrahedrons->items > 0) && (steinerleft != 0)) {
-    badtetrahedrons->traversalinit();
-    bface = (triface *) badtetrahedrons->traverse();
-    while ((bface != NULL) && (steinerleft != 0)) {
-      // Skip a deleted element.
-      if (bface->ver >= 0) {
-        // A queued tet may have been deleted.
-        if (!isdeadtet(*bface)) {
-          // A queued tet may have been processed.
-          if (marktest2ed(*bface)) {
-            unmarktest2(*bface);
-            if (checktet4split(bface, qflag, ccent)) {
-              splittetrahedron(bface, qflag, ccent, chkencflag);
+  tetprism_vol_sum = 0.0; // Initialize it.
+
+  // Put all interior faces of the mesh into 'flipstack'.
+  tetrahedrons->traversalinit();
+  tetloop.tet = tetrahedrontraverse();
+  while (tetloop.tet != NULL) {
+    for (tetloop.ver = 0; tetloop.ver < 4; tetloop.ver++) {
+      decode(tetloop.tet[tetloop.ver], neightet);
+      if (!facemarked(neightet)) {
+        flippush(flipstack, &tetloop);
+      }
+    }
+    ppt = (point *) &(tetloop.tet[4]);
+    tetprism_vol_sum += tetprismvol(ppt[0], ppt[1], ppt[2], ppt[3]);
+    tetloop.tet = tetrahedrontraverse();
+  }
+
+  // Calulate a relatively lower bound for small improvement. 
+  //   Used to avoid rounding error in volume calculation.
+  fc.bak_tetprism_vol = tetprism_vol_sum * b->epsilon * 1e-3;
+
+  if (b->verbose) {
+    printf("  Initial obj = %.17g\n", tetprism_vol_sum);
+  }
+
+  if (b->verbose > 1) {
+    printf("    Recover Delaunay [Lawson] : %ld\n", flippool->items);
+  }
+
+  // First only use the basic Lawson's flip.
+  fc.remove_ndelaunay_edge = 1;
+  fc.enqflag = 2;
+
+  lawsonflip3d(&fc);
+
+  if (b->verbose > 1) {
+    printf("    obj (after Lawson) = %.17g\n", tetprism_vol_sum);
+  }
+
+  if (unflipqueue->objects == 0l) {
+    return; // The mesh is Delaunay.
+  }
+
+  fc.unflip = 1; // Unflip if the edge is not flipped.
+  fc.collectnewtets = 1; // new tets are returned in 'cavetetlist'.
+  fc.enqflag = 0;
+
+  autofliplinklevel = 1; // Init level.
+  b->fliplinklevel = -1; // No fixed level.
+
+  // For efficiency reason, we limit the maximium size of the edge star.
+  int bakmaxflipstarsize = b->flipstarsize;
+  b->flipstarsize = 10; // default
+
+  flipqueue = new arraypool(sizeof(badface), 10);
+  nextflipqueue = new arraypool(sizeof(badface), 10);
+  
+  // Swap the two flip queues.
+  swapqueue = flipqueue;
+  flipqueue = unflipqueue;
+  unflipqueue = swapqueue;
+
+  while (flipqueue->objects > 0l) {
+
+    if (b->verbose > 1) {
+      printf("    Recover Delaunay [level = %2d] #:  %ld.\n",
+             autofliplinklevel, flipqueue->objects);
+    }
+
+    for (i = 0; i < flipqueue->objects; i++) {
+      bface  = (badface *) fastlookup(flipqueue, i);
+      if (getedge(bface->forg, bface->fdest, &bface->tt)) {
+        if (removeedgebyflips(&(bface->tt), &fc) == 2) {
+          tetprism_vol_sum += fc.tetprism_vol_sum;
+          fc.tetprism_vol_sum = 0.0; // Clear it.
+          // Queue new faces for flips.
+          for (j = 0; j < cavetetlist->objects; j++) {
+            parytet = (triface *) fastlookup(cavetetlist, j);
+            // A queued new tet may be dead.
+            if (!isdeadtet(*parytet)) {
+              for (parytet->ver = 0; parytet->ver < 4; parytet->ver++) {
+                // Avoid queue a face twice.
+                decode(parytet->tet[parytet->ver], neightet);
+                if (!facemarked(neightet)) {
+                  flippush(flipstack, parytet);
+                }
+              } // parytet->ver
             }
+          } // j
+          cavetetlist->restart();
+          // Remove locally non-Delaunay faces. New non-Delaunay edges
+          //   may be found. They are saved in 'unflipqueue'.
+          fc.enqflag = 2;
+          lawsonflip3d(&fc);
+          fc.enqflag = 0;
+          // There may be unflipable faces. Add them in flipqueue.
+          for (j = 0; j < unflipqueue->objects; j++) {
+            bface  = (badface *) fastlookup(unflipqueue, j);
+            flipqueue->newindex((void **) &parybface);
+            *parybface = *bface;
           }
+          unflipqueue->restart();
+        } else {
+          // Unable to remove this edge. Save it.
+          nextflipqueue->newindex((void **) &parybface);
+          *parybface = *bface;
+          // Normally, it should be zero. 
+          //assert(fc.tetprism_vol_sum == 0.0);
+          // However, due to rounding errors, a tiny value may appear.
+          fc.tetprism_vol_sum = 0.0;
         }
-        bface->ver = -1; // Signal it as a deleted element.
-        badtetrahedrons->dealloc((void *) bface);
       }
-      bface = (triface *) badtetrahedrons->traverse();
+    } // i
+
+    if (b->verbose > 1) {
+      printf("    obj (after level %d) = %.17g.\n", autofliplinklevel,
+             tetprism_vol_sum);
+    }
+    flipqueue->restart();
+
+    // Swap the two flip queues.
+    swapqueue = flipqueue;
+    flipqueue = nextflipqueue;
+    nextflipqueue = swapqueue;
+
+    if (flipqueue->objects > 0l) {
+      // default 'b->delmaxfliplevel' is 1.
+      if (autofliplinklevel >= b->delmaxfliplevel) {
+        // For efficiency reason, we do not search too far.
+        break;
+      }
+      autofliplinklevel+=b->fliplinklevelinc;
+    }
+  } // while (flipqueue->objects > 0l)
+
+  if (flipqueue->objects > 0l) {
+    if (b->verbose > 1) {
+      printf("    %ld non-Delaunay edges remained.\n", flipqueue->objects);
     }
   }
 
-  if (badtetrahedrons->items > 0) {
-    if (steinerleft == 0) {
-      if (b->verbose) {
-        printf("The desired number of Steiner points is reached.\n");
-      }
-    } else {
-      terminatetetgen(this, 2); // Unknown case.
-    }
-    // Unmark all queued tet.
-    badtetrahedrons->traversalinit();
-    bface = (triface *) badtetrahedrons->traverse();
-    while (bface != NULL) {
-      // Skip a deleted element.
-      if (bface->ver >= 0) {
-        if (!isdeadtet(*bface)) {
-          if (marktest2ed(*bface)) {
-            unmarktest2(*bface);
-          }
-        }
-      }
-      bface = (triface *) badtetrahedrons->traverse();
-    }
-    // Clear the pool.
-    badtetrahedrons->restart();
+  if (b->verbose) {
+    printf("  Final obj  = %.17g\n", tetprism_vol_sum);
   }
+
+  b->flipstarsize = bakmaxflipstarsize;
+  delete flipqueue;
+  delete nextflipqueue;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// delaunayrefinement()    Refine the mesh by Delaunay refinement.           //
+// gettetrahedron()    Get a tetrahedron which have the given vertices.      //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-void tetgenmesh::delaunayrefinement()
+int tetgenmesh::gettetrahedron(point pa, point pb, point pc, point pd, 
+                               triface *searchtet)
 {
-  triface checktet;
-  face checksh;
-  face checkseg;
-  long steinercount;
-  int chkencflag;
-
-  long bak_segref_count, bak_facref_count, bak_volref_count;
-  long bak_flipcount = flip23count + flip32count + flip44count;
-
-  if (!b->quiet) {
-    printf("Refining mesh...\n");
-  }
-
-  if (b->verbose) {
-    printf("  Min radiu-edge ratio = %g.\n", b->minratio);
-    printf("  Min dihedral   angle = %g.\n", b->mindihedral);
-    //printf("  Min Edge length = %g.\n", b->minedgelength);
-  }
+  triface spintet;
+  int t1ver; 
 
-  steinerleft = b->steinerleft;  // Upperbound of # Steiner points (by -S#).
-  if (steinerleft > 0) {
-    // Check if we've already used up the given number of Steiner points.
-    steinercount = st_segref_count + st_facref_count + st_volref_count;
-    if (steinercount < steinerleft) {
-      steinerleft -= steinercount;
-    } else {
-      if (!b->quiet) {
-        printf("\nWarning:  ");
-        printf("The desired number of Steiner points (%d) has reached.\n\n",
-               b->steinerleft);
+  if (getedge(pa, pb, searchtet)) {
+    spintet = *searchtet;
+    while (1) {
+      if (apex(spintet) == pc) {
+        *searchtet = spintet;
+        break;
       }
-      return; // No more Steiner points.
+      fnextself(spintet);
+      if (spintet.tet == searchtet->tet) break;
     }
-  }
-
-  if (useinsertradius) {
-    if ((b->plc && b->nobisect) || b->refine) { // '-pY' or '-r' option.
-      makesegmentendpointsmap();
-      makefacetverticesmap();
+    if (apex(*searchtet) == pc) {
+      if (oppo(*searchtet) == pd) {
+        return 1;
+      } else {
+        fsymself(*searchtet);
+        if (oppo(*searchtet) == pd) {
+          return 1;
+        }
+      }
     }
   }
 
+  return 0;
+}
 
-  encseglist = new arraypool(sizeof(face), 8);
-  encshlist = new arraypool(sizeof(badface), 8);
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// improvequalitybyflips()    Improve the mesh quality by flips.             //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
 
+long tetgenmesh::improvequalitybyflips()
+{
+  arraypool *flipqueue, *nextflipqueue, *swapqueue;
+  badface *bface, *parybface;
+  triface *parytet;
+  point *ppt;
+  flipconstraints fc;
+  REAL *cosdd, ncosdd[6], maxdd;
+  long totalremcount, remcount;
+  int remflag;
+  int n, i, j, k;
 
-  //if (!b->nobisect) { // if no '-Y' option
-  if (!b->nobisect || checkconstraints) {
-    if (b->verbose) {
-      printf("  Splitting encroached subsegments.\n");
-    }
+  //assert(unflipqueue->objects > 0l);
+  flipqueue = new arraypool(sizeof(badface), 10);
+  nextflipqueue = new arraypool(sizeof(badface), 10);
 
-    chkencflag = 1; // Only check encroaching subsegments.
-    steinercount = points->items;
+  // Backup flip edge options.
+  int bakautofliplinklevel = autofliplinklevel;
+  int bakfliplinklevel = b->fliplinklevel;
+  int bakmaxflipstarsize = b->flipstarsize;
 
-    // Initialize the pool of encroached subsegments.
-    badsubsegs = new memorypool(sizeof(face), b->shellfaceperblock, 
-                                sizeof(void *), 0);
+  // Set flip edge options.
+  autofliplinklevel = 1; 
+  b->fliplinklevel = -1;
+  b->flipstarsize = 10; // b->optmaxflipstarsize;
 
-    // Add all segments into the pool.
-    subsegs->traversalinit();
-    checkseg.sh = shellfacetraverse(subsegs);
-    while (checkseg.sh != (shellface *) NULL) {
-      enqueuesubface(badsubsegs, &checkseg);
-      checkseg.sh = shellfacetraverse(subsegs);
-    }
+  fc.remove_large_angle = 1;
+  fc.unflip = 1;
+  fc.collectnewtets = 1;
+  fc.checkflipeligibility = 1;
 
-    // Split all encroached segments.
-    repairencsegs(chkencflag);
+  totalremcount = 0l;
 
-    if (b->verbose) {
-      printf("  Added %ld Steiner points.\n", points->items - steinercount);
-    }
+  // Swap the two flip queues.
+  swapqueue = flipqueue;
+  flipqueue = unflipqueue;
+  unflipqueue = swapqueue;
 
-    if (b->reflevel > 1) { // '-D2' option
-      if (b->verbose) {
-        printf("  Splitting encroached subfaces.\n");
+  while (flipqueue->objects > 0l) {
+
+    remcount = 0l;
+
+    while (flipqueue->objects > 0l) {
+      if (b->verbose > 1) {
+        printf("    Improving mesh qualiy by flips [%d]#:  %ld.\n",
+               autofliplinklevel, flipqueue->objects);
       }
 
-      chkencflag = 2; // Only check encroaching subfaces.
-      steinercount = points->items;
-      bak_segref_count = st_segref_count;
-      bak_facref_count = st_facref_count;
+      for (k = 0; k < flipqueue->objects; k++) {
+        bface  = (badface *) fastlookup(flipqueue, k);
+        if (gettetrahedron(bface->forg, bface->fdest, bface->fapex,
+                           bface->foppo, &bface->tt)) {
+          //assert(!ishulltet(bface->tt));
+          // There are bad dihedral angles in this tet.
+          if (bface->tt.ver != 11) {
+            // The dihedral angles are permuted.
+            // Here we simply re-compute them. Slow!!.
+            ppt = (point *) & (bface->tt.tet[4]);
+            tetalldihedral(ppt[0], ppt[1], ppt[2], ppt[3], bface->cent, 
+                           &bface->key, NULL);
+            bface->forg = ppt[0];
+            bface->fdest = ppt[1];
+            bface->fapex = ppt[2];
+            bface->foppo = ppt[3];
+            bface->tt.ver = 11;
+          }
+          if (bface->key == 0) {
+            // Re-comput the quality values. Due to smoothing operations.
+            ppt = (point *) & (bface->tt.tet[4]);
+            tetalldihedral(ppt[0], ppt[1], ppt[2], ppt[3], bface->cent, 
+                           &bface->key, NULL);
+          }
+          cosdd = bface->cent;
+          remflag = 0;
+          for (i = 0; (i < 6) && !remflag; i++) {
+            if (cosdd[i] < cosmaxdihed) {
+              // Found a large dihedral angle.
+              bface->tt.ver = edge2ver[i]; // Go to the edge.
+              fc.cosdihed_in = cosdd[i];
+              fc.cosdihed_out = 0.0; // 90 degree.
+              n = removeedgebyflips(&(bface->tt), &fc);
+              if (n == 2) {
+                // Edge is flipped.
+                remflag = 1;
+                if (fc.cosdihed_out < cosmaxdihed) {
+                  // Queue new bad tets for further improvements.
+                  for (j = 0; j < cavetetlist->objects; j++) {
+                    parytet = (triface *) fastlookup(cavetetlist, j);
+                    if (!isdeadtet(*parytet)) {
+                      ppt = (point *) & (parytet->tet[4]);
+                      // Do not test a hull tet.
+                      if (ppt[3] != dummypoint) {
+                        tetalldihedral(ppt[0], ppt[1], ppt[2], ppt[3], ncosdd, 
+                                       &maxdd, NULL);
+                        if (maxdd < cosmaxdihed) {
+                          // There are bad dihedral angles in this tet.
+                          nextflipqueue->newindex((void **) &parybface); 
+                          parybface->tt.tet = parytet->tet;
+                          parybface->tt.ver = 11;
+                          parybface->forg = ppt[0];
+                          parybface->fdest = ppt[1];
+                          parybface->fapex = ppt[2];
+                          parybface->foppo = ppt[3];
+                          parybface->key = maxdd;
+                          for (n = 0; n < 6; n++) {
+                            parybface->cent[n] = ncosdd[n];
+                          }
+                        }
+                      } // if (ppt[3] != dummypoint) 
+                    }
+                  } // j
+                } // if (fc.cosdihed_out < cosmaxdihed)
+                cavetetlist->restart();
+                remcount++;
+              }
+            }
+          } // i          
+          if (!remflag) {
+            // An unremoved bad tet. Queue it again. 
+            unflipqueue->newindex((void **) &parybface);
+            *parybface = *bface;
+          }
+        } // if (gettetrahedron(...))
+      } // k
 
-      // Initialize the pool of encroached subfaces.
-      badsubfacs = new memorypool(sizeof(face), b->shellfaceperblock, 
-                                  sizeof(void *), 0);
+      flipqueue->restart();
 
-      // Add all subfaces into the pool.
-      subfaces->traversalinit();
-      checksh.sh = shellfacetraverse(subfaces);
-      while (checksh.sh != (shellface *) NULL) {
-        enqueuesubface(badsubfacs, &checksh);
-        checksh.sh = shellfacetraverse(subfaces);
-      }
+      // Swap the two flip queues.
+      swapqueue = flipqueue;
+      flipqueue = nextflipqueue;
+      nextflipqueue = swapqueue;
+    } // while (flipqueues->objects > 0)
 
-      // Split all encroached subfaces.
-      repairencfacs(chkencflag);
+    if (b->verbose > 1) {
+      printf("    Removed %ld bad tets.\n", remcount);
+    }
+    totalremcount += remcount;
 
-      if (b->verbose) {
-        printf("  Added %ld (%ld,%ld) Steiner points.\n",  
-               points->items-steinercount, st_segref_count-bak_segref_count,
-               st_facref_count-bak_facref_count);
+    if (unflipqueue->objects > 0l) {
+      //if (autofliplinklevel >= b->optmaxfliplevel) {
+      if (autofliplinklevel >= b->optlevel) {
+        break;
       }
-    } // if (b->reflevel > 1)
-  } // if (!b->nobisect)
-
-  if (b->reflevel > 2) { // '-D3' option (The default option)
-    if (b->verbose) {
-      printf("  Splitting bad quality tets.\n");
+      autofliplinklevel+=b->fliplinklevelinc;
+      //b->flipstarsize = 10 + (1 << (b->optlevel - 1));
     }
 
-    chkencflag = 4; // Only check tetrahedra.
-    steinercount = points->items;
-    bak_segref_count = st_segref_count;
-    bak_facref_count = st_facref_count;
-    bak_volref_count = st_volref_count;
+    // Swap the two flip queues.
+    swapqueue = flipqueue;
+    flipqueue = unflipqueue;
+    unflipqueue = swapqueue;
+  } // while (flipqueues->objects > 0)
 
-    // The cosine value of the min dihedral angle (-qq) for tetrahedra.
-    cosmindihed = cos(b->mindihedral / 180.0 * PI);
+  // Restore original flip edge options.
+  autofliplinklevel = bakautofliplinklevel;
+  b->fliplinklevel = bakfliplinklevel;
+  b->flipstarsize = bakmaxflipstarsize;
 
-    // Initialize the pool of bad quality tetrahedra.
-    badtetrahedrons = new memorypool(sizeof(triface), b->tetrahedraperblock,
-                                     sizeof(void *), 0);
-    // Add all tetrahedra (no hull tets) into the pool.
-    tetrahedrons->traversalinit();
-    checktet.tet = tetrahedrontraverse();
-    while (checktet.tet != NULL) {
-      enqueuetetrahedron(&checktet);
-      checktet.tet = tetrahedrontraverse();
-    }
+  delete flipqueue;
+  delete nextflipqueue;
 
-    // Split all bad quality tetrahedra.
-    repairbadtets(chkencflag);
+  return totalremcount;
+}
 
-    if (b->verbose) {
-      printf("  Added %ld (%ld,%ld,%ld) Steiner points.\n", 
-             points->items - steinercount, 
-             st_segref_count - bak_segref_count,
-             st_facref_count - bak_facref_count,
-             st_volref_count - bak_volref_count);
-    }
-  } // if (b->reflevel > 2)
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// smoothpoint()    Moving a vertex to improve the mesh quality.             //
+//                                                                           //
+// 'smtpt' (p) is a point to be smoothed. Generally, it is a Steiner point.  //
+// It may be not a vertex of the mesh.                                       //
+//                                                                           //
+// This routine tries to move 'p' inside its star until a selected objective //
+// function over all tetrahedra in the star is improved. The function may be //
+// the some quality measures, i.e., aspect ratio, maximum dihedral angel, or //
+// simply the volume of the tetrahedra.                                      //
+//                                                                           //
+// 'linkfacelist' contains the list of link faces of 'p'.  Since a link face //
+// has two orientations, ccw or cw, with respect to 'p'.  'ccw' indicates    //
+// the orientation is ccw (1) or not (0).                                    //
+//                                                                           //
+// 'opm' is a structure contains the parameters of the objective function.   //
+// It is needed by the evaluation of the function value.                     //
+//                                                                           //
+// The return value indicates weather the point is smoothed or not.          //
+//                                                                           //
+// ASSUMPTION: This routine assumes that all link faces are true faces, i.e, //
+// no face has 'dummypoint' as its vertex.                                   //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
 
-  if (b->verbose) {
-    if (flip23count + flip32count + flip44count > bak_flipcount) {
-      printf("  Performed %ld flips.\n", flip23count + flip32count +
-             flip44count - bak_flipcount);
-    }
+int tetgenmesh::smoothpoint(point smtpt, arraypool *linkfacelist, int ccw,
+                            optparameters *opm)
+{
+  triface *parytet, *parytet1, swaptet;
+  point pa, pb, pc;
+  REAL fcent[3], startpt[3], nextpt[3], bestpt[3];
+  REAL oldval, minval = 0.0, val;
+  REAL maxcosd; // oldang, newang;
+  REAL ori, diff;
+  int numdirs, iter;
+  int i, j, k;
+
+  // Decide the number of moving directions.
+  numdirs = (int) linkfacelist->objects;
+  if (numdirs > opm->numofsearchdirs) {
+    numdirs = opm->numofsearchdirs; // Maximum search directions.
   }
 
-  if (steinerleft == 0) {
-    if (!b->quiet) {
-      printf("\nWarnning:  ");
-      printf("The desired number of Steiner points (%d) is reached.\n\n",
-             b->steinerleft);
-    }
+  // Set the initial value.
+  opm->imprval = opm->initval;
+  iter = 0;
+
+  for (i = 0; i < 3; i++) {
+    bestpt[i] = startpt[i] = smtpt[i];
   }
 
+  // Iterate until the obj function is not improved.
+  while (1) {
 
-  delete encseglist;
-  delete encshlist;
-  encseglist = NULL;
-  encshlist = NULL;
+    // Find the best next location.
+    oldval = opm->imprval;
 
-  if (!b->nobisect || checkconstraints) {
-    totalworkmemory += (badsubsegs->maxitems * badsubsegs->itembytes);
-    delete badsubsegs;
-    badsubsegs = NULL;
-    if (b->reflevel > 1) {
-      totalworkmemory += (badsubfacs->maxitems * badsubfacs->itembytes);
-      delete badsubfacs;
-      badsubfacs = NULL;
+    for (i = 0; i < numdirs; i++) {
+      // Randomly pick a link face (0 <= k <= objects - i - 1).
+      k = (int) randomnation(linkfacelist->objects - i);
+      parytet = (triface *) fastlookup(linkfacelist, k);
+      // Calculate a new position from 'p' to the center of this face.
+      pa = org(*parytet);
+      pb = dest(*parytet);
+      pc = apex(*parytet);
+      for (j = 0; j < 3; j++) {
+        fcent[j] = (pa[j] + pb[j] + pc[j]) / 3.0;
+      }
+      for (j = 0; j < 3; j++) {
+        nextpt[j] = startpt[j] + opm->searchstep * (fcent[j] - startpt[j]); 
+      }
+      // Calculate the largest minimum function value for the new location.
+      for (j = 0; j < linkfacelist->objects; j++) {
+        parytet = (triface *) fastlookup(linkfacelist, j);
+        if (ccw) {
+          pa = org(*parytet);
+          pb = dest(*parytet);
+        } else {
+          pb = org(*parytet);
+          pa = dest(*parytet);
+        }
+        pc = apex(*parytet);
+        ori = orient3d(pa, pb, pc, nextpt);
+        if (ori < 0.0) {
+          // Calcuate the objective function value. 
+          if (opm->max_min_volume) {
+            //val = -ori;
+            val = - orient3dfast(pa, pb, pc, nextpt);
+          } else if (opm->min_max_aspectratio) {
+            val = 1.0 / tetaspectratio(pa, pb, pc, nextpt);
+          } else if (opm->min_max_dihedangle) {
+            tetalldihedral(pa, pb, pc, nextpt, NULL, &maxcosd, NULL);
+            if (maxcosd < -1) maxcosd = -1.0; // Rounding.
+            val = maxcosd + 1.0; // Make it be positive. 
+          } else {
+            // Unknown objective function.
+            val = 0.0;
+          }  
+        } else { // ori >= 0.0;
+          // An invalid new tet. 
+          // This may happen if the mesh contains inverted elements.
+          if (opm->max_min_volume) {
+            //val = -ori;
+            val = - orient3dfast(pa, pb, pc, nextpt);    
+          } else {
+            // Discard this point.
+            break; // j
+          }
+        } // if (ori >= 0.0)
+        // Stop looping when the object value is not improved.
+        if (val <= opm->imprval) {
+          break; // j
+        } else {
+          // Remember the smallest improved value.
+          if (j == 0) {
+            minval = val;
+          } else {
+            minval = (val < minval) ? val : minval;
+          }
+        }
+      } // j
+      if (j == linkfacelist->objects) {
+        // The function value has been improved.
+        opm->imprval = minval;
+        // Save the new location of the point.
+        for (j = 0; j < 3; j++) bestpt[j] = nextpt[j];
+      }
+      // Swap k-th and (object-i-1)-th entries.
+      j = linkfacelist->objects - i - 1;
+      parytet  = (triface *) fastlookup(linkfacelist, k);
+      parytet1 = (triface *) fastlookup(linkfacelist, j);
+      swaptet = *parytet1;
+      *parytet1 = *parytet;
+      *parytet = swaptet;
+    } // i
+
+    diff = opm->imprval - oldval;
+    if (diff > 0.0) {
+      // Is the function value improved effectively?
+      if (opm->max_min_volume) {
+        //if ((diff / oldval) < b->epsilon) diff = 0.0;  
+      } else if (opm->min_max_aspectratio) {
+        if ((diff / oldval) < 1e-3) diff = 0.0;
+      } else if (opm->min_max_dihedangle) {
+        //oldang = acos(oldval - 1.0);
+        //newang = acos(opm->imprval - 1.0);
+        //if ((oldang - newang) < 0.00174) diff = 0.0; // about 0.1 degree.
+      } else {
+        // Unknown objective function.
+        terminatetetgen(this, 2); 
+      }
     }
+
+    if (diff > 0.0) {
+      // Yes, move p to the new location and continue.
+      for (j = 0; j < 3; j++) startpt[j] = bestpt[j];
+      iter++;
+      if ((opm->maxiter > 0) && (iter >= opm->maxiter)) {
+        // Maximum smoothing iterations reached.
+        break;
+      }
+    } else {
+      break;
+    }
+
+  } // while (1)
+
+  if (iter > 0) {
+    // The point has been smoothed.
+    opm->smthiter = iter; // Remember the number of iterations. 
+    // The point has been smoothed. Update it to its new position.
+    for (i = 0; i < 3; i++) smtpt[i] = startpt[i];
   }
-  if (b->reflevel > 2) {
-    totalworkmemory += (badtetrahedrons->maxitems*badtetrahedrons->itembytes);
-    delete badtetrahedrons;
-    badtetrahedrons = NULL;
-  }
-}
 
-////                                                                       ////
-////                                                                       ////
-//// refine_cxx ///////////////////////////////////////////////////////////////
+  return iter;
+}
 
-//// optimize_cxx /////////////////////////////////////////////////////////////
-////                                                                       ////
-////                                                                       ////
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// lawsonflip3d()    A three-dimensional Lawson's algorithm.                 //
+// improvequalitysmoothing()    Improve mesh quality by smoothing.           //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-long tetgenmesh::lawsonflip3d(flipconstraints *fc)
+long tetgenmesh::improvequalitybysmoothing(optparameters *opm)
 {
-  triface fliptets[5], neightet, hulltet;
-  face checksh, casingout;
-  badface *popface, *bface;
-  point pd, pe, *pts;
-  REAL sign, ori;
-  REAL vol, len3;
-  long flipcount, totalcount = 0l;
-  long sliver_peels = 0l;
-  int t1ver;
-  int i;
-
-
-  while (1) {
-
-    if (b->verbose > 2) {
-      printf("      Lawson flip %ld faces.\n", flippool->items);
-    }
-    flipcount = 0l;
-
-    while (flipstack != (badface *) NULL) {
-      // Pop a face from the stack.
-      popface = flipstack;
-      fliptets[0] = popface->tt;
-      flipstack = flipstack->nextitem; // The next top item in stack.
-      flippool->dealloc((void *) popface);
-
-      // Skip it if it is a dead tet (destroyed by previous flips).
-      if (isdeadtet(fliptets[0])) continue;
-      // Skip it if it is not the same tet as we saved.
-      if (!facemarked(fliptets[0])) continue;
-
-      unmarkface(fliptets[0]);
-
-      if (ishulltet(fliptets[0])) continue;
+  arraypool *flipqueue, *swapqueue;
+  triface *parytet;
+  badface *bface, *parybface;
+  point *ppt;
+  long totalsmtcount, smtcount;
+  int smtflag;
+  int iter, i, j, k;
 
-      fsym(fliptets[0], fliptets[1]);
-      if (ishulltet(fliptets[1])) {
-        if (nonconvex) {
-          // Check if 'fliptets[0]' it is a hull sliver.
-          tspivot(fliptets[0], checksh);
-          for (i = 0; i < 3; i++) {
-            if (!isshsubseg(checksh)) {
-              spivot(checksh, casingout);
-              //assert(casingout.sh != NULL);
-              if (sorg(checksh) != sdest(casingout)) sesymself(casingout);
-              stpivot(casingout, neightet);
-              if (neightet.tet == fliptets[0].tet) {
-                // Found a hull sliver 'neightet'. Let it be [e,d,a,b], where 
-                //   [e,d,a] and [d,e,b] are hull faces.
-                edestoppo(neightet, hulltet); // [a,b,e,d]
-                fsymself(hulltet); // [b,a,e,#]
-                if (oppo(hulltet) == dummypoint) {
-                  pe = org(neightet);
-                  if ((pointtype(pe) == FREEFACETVERTEX) ||
-                      (pointtype(pe) == FREESEGVERTEX)) {
-                    removevertexbyflips(pe);
-                  }
-                } else {
-                  eorgoppo(neightet, hulltet); // [b,a,d,e]
-                  fsymself(hulltet); // [a,b,d,#]
-                  if (oppo(hulltet) == dummypoint) {
-                    pd = dest(neightet);
-                    if ((pointtype(pd) == FREEFACETVERTEX) ||
-                        (pointtype(pd) == FREESEGVERTEX)) {
-                      removevertexbyflips(pd);
-                    }
-                  } else {
-                    // Perform a 3-to-2 flip to remove the sliver.
-                    fliptets[0] = neightet;          // [e,d,a,b]
-                    fnext(fliptets[0], fliptets[1]); // [e,d,b,c]
-                    fnext(fliptets[1], fliptets[2]); // [e,d,c,a]
-                    flip32(fliptets, 1, fc);
-                    // Update counters.
-                    flip32count--;
-                    flip22count--;
-                    sliver_peels++;
-                    if (fc->remove_ndelaunay_edge) {
-                      // Update the volume (must be decreased).
-                      //assert(fc->tetprism_vol_sum <= 0);
-                      tetprism_vol_sum += fc->tetprism_vol_sum;
-                      fc->tetprism_vol_sum = 0.0; // Clear it.
-                    }
-                  }
-                }
-                break;
-              } // if (neightet.tet == fliptets[0].tet)
-            } // if (!isshsubseg(checksh))
-            senextself(checksh);
-          } // i
-        } // if (nonconvex)
-        continue;
-      }
+  //assert(unflipqueue->objects > 0l);
+  flipqueue = new arraypool(sizeof(badface), 10);
 
-      if (checksubfaceflag) {
-        // Do not flip if it is a subface.
-        if (issubface(fliptets[0])) continue;
-      }
+  // Swap the two flip queues.
+  swapqueue = flipqueue;
+  flipqueue = unflipqueue;
+  unflipqueue = swapqueue;
 
-      // Test whether the face is locally Delaunay or not.
-      pts = (point *) fliptets[1].tet; 
-      sign = insphere_s(pts[4], pts[5], pts[6], pts[7], oppo(fliptets[0]));
+  totalsmtcount = 0l;
+  iter = 0;
 
-      if (sign < 0) {
-        // A non-Delaunay face. Try to flip it.
-        pd = oppo(fliptets[0]);
-        pe = oppo(fliptets[1]);
+  while (flipqueue->objects > 0l) {
 
-        // Use the length of the edge [d,e] as a reference to determine
-        //   a nearly degenerated new tet.
-        len3 = distance(pd, pe);
-        len3 = (len3 * len3 * len3);
+    smtcount = 0l;
 
-        // Check the convexity of its three edges. Stop checking either a
-        //   locally non-convex edge (ori < 0) or a flat edge (ori = 0) is
-        //   encountered, and 'fliptet' represents that edge.
-        for (i = 0; i < 3; i++) {
-          ori = orient3d(org(fliptets[0]), dest(fliptets[0]), pd, pe);
-          if (ori > 0) {
-            // Avoid creating a nearly degenerated new tet at boundary.
-            //   Re-use fliptets[2], fliptets[3];
-            esym(fliptets[0], fliptets[2]);
-            esym(fliptets[1], fliptets[3]);
-            if (issubface(fliptets[2]) || issubface(fliptets[3])) {
-              vol = orient3dfast(org(fliptets[0]), dest(fliptets[0]), pd, pe);
-              if ((fabs(vol) / len3) < b->epsilon) {
-                ori = 0.0; // Do rounding.
-              }
-            }
-          } // Rounding check
-          if (ori <= 0) break;
-          enextself(fliptets[0]);
-          eprevself(fliptets[1]);
-        }
+    if (b->verbose > 1) {
+      printf("    Improving mesh quality by smoothing [%d]#:  %ld.\n",
+             iter, flipqueue->objects);
+    }
 
-        if (ori > 0) {
-          // A 2-to-3 flip is found.
-          //   [0] [a,b,c,d], 
-          //   [1] [b,a,c,e]. no dummypoint.
-          flip23(fliptets, 0, fc);
-          flipcount++;
-          if (fc->remove_ndelaunay_edge) {
-            // Update the volume (must be decreased).
-            //assert(fc->tetprism_vol_sum <= 0);
-            tetprism_vol_sum += fc->tetprism_vol_sum;
-            fc->tetprism_vol_sum = 0.0; // Clear it.
-          }
-          continue;
-        } else { // ori <= 0
-          // The edge ('fliptets[0]' = [a',b',c',d]) is non-convex or flat,
-          //   where the edge [a',b'] is one of [a,b], [b,c], and [c,a].
-          if (checksubsegflag) {
-            // Do not flip if it is a segment.
-            if (issubseg(fliptets[0])) continue;
-          }
-          // Check if there are three or four tets sharing at this edge.        
-          esymself(fliptets[0]); // [b,a,d,c]
-          for (i = 0; i < 3; i++) {
-            fnext(fliptets[i], fliptets[i+1]);
-          }
-          if (fliptets[3].tet == fliptets[0].tet) {
-            // A 3-to-2 flip is found. (No hull tet.)
-            flip32(fliptets, 0, fc); 
-            flipcount++;
-            if (fc->remove_ndelaunay_edge) {
-              // Update the volume (must be decreased).
-              //assert(fc->tetprism_vol_sum <= 0);
-              tetprism_vol_sum += fc->tetprism_vol_sum;
-              fc->tetprism_vol_sum = 0.0; // Clear it.
-            }
-            continue;
-          } else {
-            // There are more than 3 tets at this edge.
-            fnext(fliptets[3], fliptets[4]);
-            if (fliptets[4].tet == fliptets[0].tet) {
-              // There are exactly 4 tets at this edge.
-              if (nonconvex) {
-                if (apex(fliptets[3]) == dummypoint) {
-                  // This edge is locally non-convex on the hull.
-                  // It can be removed by a 4-to-4 flip.                  
-                  ori = 0;
-                }
-              } // if (nonconvex)
-              if (ori == 0) {
-                // A 4-to-4 flip is found. (Two hull tets may be involved.)
-                // Current tets in 'fliptets':
-                //   [0] [b,a,d,c] (d may be newpt)
-                //   [1] [b,a,c,e]
-                //   [2] [b,a,e,f] (f may be dummypoint)
-                //   [3] [b,a,f,d]
-                esymself(fliptets[0]); // [a,b,c,d] 
-                // A 2-to-3 flip replaces face [a,b,c] by edge [e,d].
-                //   This creates a degenerate tet [e,d,a,b] (tmpfliptets[0]).
-                //   It will be removed by the followed 3-to-2 flip.
-                flip23(fliptets, 0, fc); // No hull tet.
-                fnext(fliptets[3], fliptets[1]);
-                fnext(fliptets[1], fliptets[2]);
-                // Current tets in 'fliptets':
-                //   [0] [...]
-                //   [1] [b,a,d,e] (degenerated, d may be new point).
-                //   [2] [b,a,e,f] (f may be dummypoint)
-                //   [3] [b,a,f,d]
-                // A 3-to-2 flip replaces edge [b,a] by face [d,e,f].
-                //   Hull tets may be involved (f may be dummypoint).
-                flip32(&(fliptets[1]), (apex(fliptets[3]) == dummypoint), fc);
-                flipcount++;
-                flip23count--;
-                flip32count--;
-                flip44count++;
-                if (fc->remove_ndelaunay_edge) {
-                  // Update the volume (must be decreased).
-                  //assert(fc->tetprism_vol_sum <= 0);
-                  tetprism_vol_sum += fc->tetprism_vol_sum;
-                  fc->tetprism_vol_sum = 0.0; // Clear it.
-                }
-                continue;
-              } // if (ori == 0)
+    for (k = 0; k < flipqueue->objects; k++) {      
+      bface  = (badface *) fastlookup(flipqueue, k);
+      if (gettetrahedron(bface->forg, bface->fdest, bface->fapex,
+                         bface->foppo, &bface->tt)) {
+        // Operate on it if it is not in 'unflipqueue'.
+        if (!marktested(bface->tt)) {
+          // Here we simply re-compute the quality. Since other smoothing
+          //   operation may have moved the vertices of this tet.
+          ppt = (point *) & (bface->tt.tet[4]);
+          tetalldihedral(ppt[0], ppt[1], ppt[2], ppt[3], bface->cent, 
+                         &bface->key, NULL);
+          if (bface->key < cossmtdihed) { // if (maxdd < cosslidihed) {
+            // It is a sliver. Try to smooth its vertices.
+            smtflag = 0;
+            opm->initval = bface->key + 1.0; 
+            for (i = 0; (i < 4) && !smtflag; i++) {
+              if (pointtype(ppt[i]) == FREEVOLVERTEX) {
+                getvertexstar(1, ppt[i], cavetetlist, NULL, NULL);
+                opm->searchstep = 0.001; // Search step size
+                smtflag = smoothpoint(ppt[i], cavetetlist, 1, opm);
+                if (smtflag) {
+                  while (opm->smthiter == opm->maxiter) {
+                    opm->searchstep *= 10.0; // Increase the step size.
+                    opm->initval = opm->imprval;
+                    opm->smthiter = 0; // reset
+                    smoothpoint(ppt[i], cavetetlist, 1, opm);
+                  }
+                  // This tet is modifed.
+                  smtcount++;
+                  if ((opm->imprval - 1.0) < cossmtdihed) {
+                    // There are slivers in new tets. Queue them.
+                    for (j = 0; j < cavetetlist->objects; j++) {
+                      parytet = (triface *) fastlookup(cavetetlist, j);
+                      // Operate it if it is not in 'unflipqueue'.
+                      if (!marktested(*parytet)) {
+                        // Evaluate its quality.
+                        // Re-use ppt, bface->key, bface->cent.
+                        ppt = (point *) & (parytet->tet[4]);
+                        tetalldihedral(ppt[0], ppt[1], ppt[2], ppt[3], 
+                                       bface->cent, &bface->key, NULL);
+                        if (bface->key < cossmtdihed) {
+                          // A new sliver. Queue it.
+                          marktest(*parytet); // It is in unflipqueue.
+                          unflipqueue->newindex((void **) &parybface);
+                          parybface->tt = *parytet;
+                          parybface->forg = ppt[0];
+                          parybface->fdest = ppt[1];
+                          parybface->fapex = ppt[2];
+                          parybface->foppo = ppt[3];
+                          parybface->tt.ver = 11; 
+                          parybface->key = 0.0;
+                        }
+                      }
+                    } // j
+                  } // if ((opm->imprval - 1.0) < cossmtdihed)
+                } // if (smtflag)
+                cavetetlist->restart();
+              } // if (pointtype(ppt[i]) == FREEVOLVERTEX)
+            } // i
+            if (!smtflag) {
+              // Didn't smooth. Queue it again.
+              marktest(bface->tt); // It is in unflipqueue.
+              unflipqueue->newindex((void **) &parybface);
+              parybface->tt = bface->tt;
+              parybface->forg = ppt[0];
+              parybface->fdest = ppt[1];
+              parybface->fapex = ppt[2];
+              parybface->foppo = ppt[3];
+              parybface->tt.ver = 11;
+              parybface->key = 0.0;
             }
-          }
-        } // if (ori <= 0)
+	      } // if (maxdd < cosslidihed)
+        } // if (!marktested(...))
+      } // if (gettetrahedron(...))
+    } // k
 
-        // This non-Delaunay face is unflippable. Save it.
-        unflipqueue->newindex((void **) &bface);
-        bface->tt = fliptets[0];
-        bface->forg  = org(fliptets[0]);
-        bface->fdest = dest(fliptets[0]);
-        bface->fapex = apex(fliptets[0]);
-      } // if (sign < 0)
-    } // while (flipstack)
+    flipqueue->restart();
 
-    if (b->verbose > 2) {
-      if (flipcount > 0) {
-        printf("      Performed %ld flips.\n", flipcount);
-      }
+    // Unmark the tets in unflipqueue.
+    for (i = 0; i < unflipqueue->objects; i++) {
+      bface  = (badface *) fastlookup(unflipqueue, i);
+      unmarktest(bface->tt);
     }
-    // Accumulate the counter of flips.
-    totalcount += flipcount;
 
-    // Return if no unflippable faces left.
-    if (unflipqueue->objects == 0l) break; 
-    // Return if no flip has been performed.
-    if (flipcount == 0l) break;
+    if (b->verbose > 1) {
+      printf("    Smooth %ld points.\n", smtcount);
+    }
+    totalsmtcount += smtcount;
 
-    // Try to flip the unflippable faces.
-    for (i = 0; i < unflipqueue->objects; i++) {
-      bface = (badface *) fastlookup(unflipqueue, i);
-      if (!isdeadtet(bface->tt) && 
-          (org(bface->tt) == bface->forg) &&
-          (dest(bface->tt) == bface->fdest) &&
-          (apex(bface->tt) == bface->fapex)) {
-        flippush(flipstack, &(bface->tt));
+    if (smtcount == 0l) {
+      // No point has been smoothed. 
+      break;
+    } else {
+      iter++;
+      if (iter == 2) { //if (iter >= b->optpasses) {
+        break;
       }
     }
-    unflipqueue->restart();
 
-  } // while (1)
+    // Swap the two flip queues.
+    swapqueue = flipqueue;
+    flipqueue = unflipqueue;
+    unflipqueue = swapqueue;
+  } // while
 
-  if (b->verbose > 2) {
-    if (totalcount > 0) {
-      printf("      Performed %ld flips.\n", totalcount);
-    }
-    if (sliver_peels > 0) {
-      printf("      Removed %ld hull slivers.\n", sliver_peels);
-    }
-    if (unflipqueue->objects > 0l) {
-      printf("      %ld unflippable edges remained.\n", unflipqueue->objects);
-    }
-  }
+  delete flipqueue;
 
-  return totalcount + sliver_peels;
+  return totalsmtcount;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// recoverdelaunay()    Recovery the locally Delaunay property.              //
+// splitsliver()    Split a sliver.                                          //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-void tetgenmesh::recoverdelaunay()
+int tetgenmesh::splitsliver(triface *slitet, REAL cosd, int chkencflag)
 {
-  arraypool *flipqueue, *nextflipqueue, *swapqueue;
-  triface tetloop, neightet, *parytet;
-  badface *bface, *parybface;
-  point *ppt;
-  flipconstraints fc;
-  int i, j;
+  triface *abtets;
+  triface searchtet, spintet, *parytet;
+  point pa, pb, steinerpt;
+  optparameters opm;
+  insertvertexflags ivf;
+  REAL smtpt[3], midpt[3];
+  int success;
+  int t1ver;
+  int n, i;
 
-  if (!b->quiet) {
-    printf("Recovering Delaunayness...\n");
+  // 'slitet' is [c,d,a,b], where [c,d] has a big dihedral angle. 
+  // Go to the opposite edge [a,b].
+  edestoppo(*slitet, searchtet); // [a,b,c,d].
+
+  // Do not split a segment.
+  if (issubseg(searchtet)) {
+    return 0; 
   }
 
-  tetprism_vol_sum = 0.0; // Initialize it.
+  // Count the number of tets shared at [a,b].
+  // Do not split it if it is a hull edge.
+  spintet = searchtet;
+  n = 0; 
+  while (1) {
+    if (ishulltet(spintet)) break;
+    n++;
+    fnextself(spintet);
+    if (spintet.tet == searchtet.tet) break;
+  }
+  if (ishulltet(spintet)) {
+    return 0; // It is a hull edge.
+  }
 
-  // Put all interior faces of the mesh into 'flipstack'.
-  tetrahedrons->traversalinit();
-  tetloop.tet = tetrahedrontraverse();
-  while (tetloop.tet != NULL) {
-    for (tetloop.ver = 0; tetloop.ver < 4; tetloop.ver++) {
-      decode(tetloop.tet[tetloop.ver], neightet);
-      if (!facemarked(neightet)) {
-        flippush(flipstack, &tetloop);
-      }
+  // Get all tets at edge [a,b].
+  abtets = new triface[n];
+  spintet = searchtet;
+  for (i = 0; i < n; i++) {
+    abtets[i] = spintet;
+    fnextself(spintet);
+  }
+
+  // Initialize the list of 2n boundary faces.
+  for (i = 0; i < n; i++) {    
+    eprev(abtets[i], searchtet);
+    esymself(searchtet); // [a,p_i,p_i+1].
+    cavetetlist->newindex((void **) &parytet);
+    *parytet = searchtet;
+    enext(abtets[i], searchtet);
+    esymself(searchtet); // [p_i,b,p_i+1].
+    cavetetlist->newindex((void **) &parytet);
+    *parytet = searchtet;
+  }
+
+  // Init the Steiner point at the midpoint of edge [a,b].
+  pa = org(abtets[0]);
+  pb = dest(abtets[0]);
+  for (i = 0; i < 3; i++) {
+    smtpt[i] = midpt[i] = 0.5 * (pa[i] + pb[i]);
+  }
+
+  // Point smooth options.
+  opm.min_max_dihedangle = 1;
+  opm.initval = cosd + 1.0; // Initial volume is zero.
+  opm.numofsearchdirs = 20;
+  opm.searchstep = 0.001;  
+  opm.maxiter = 100; // Limit the maximum iterations.
+
+  success = smoothpoint(smtpt, cavetetlist, 1, &opm);
+
+  if (success) {
+    while (opm.smthiter == opm.maxiter) {
+      // It was relocated and the prescribed maximum iteration reached. 
+      // Try to increase the search stepsize.
+      opm.searchstep *= 10.0;
+      //opm.maxiter = 100; // Limit the maximum iterations.
+      opm.initval = opm.imprval;
+      opm.smthiter = 0; // Init.
+      smoothpoint(smtpt, cavetetlist, 1, &opm);  
     }
-    ppt = (point *) &(tetloop.tet[4]);
-    tetprism_vol_sum += tetprismvol(ppt[0], ppt[1], ppt[2], ppt[3]);
-    tetloop.tet = tetrahedrontraverse();
+  } // if (success)
+
+  cavetetlist->restart();
+
+  if (!success) {
+    delete [] abtets;
+    return 0;
   }
 
-  // Calulate a relatively lower bound for small improvement. 
-  //   Used to avoid rounding error in volume calculation.
-  fc.bak_tetprism_vol = tetprism_vol_sum * b->epsilon * 1e-3;
 
-  if (b->verbose) {
-    printf("  Initial obj = %.17g\n", tetprism_vol_sum);
+  // Insert the Steiner point.
+  makepoint(&steinerpt, FREEVOLVERTEX);
+  for (i = 0; i < 3; i++) steinerpt[i] = smtpt[i];
+
+  // Insert the created Steiner point.
+  for (i = 0; i < n; i++) {
+    infect(abtets[i]);
+    caveoldtetlist->newindex((void **) &parytet);
+    *parytet = abtets[i];
   }
 
-  if (b->verbose > 1) {
-    printf("    Recover Delaunay [Lawson] : %ld\n", flippool->items);
+  searchtet = abtets[0]; // No need point location.
+  if (b->metric) {
+    locate(steinerpt, &searchtet); // For size interpolation.
   }
 
-  // First only use the basic Lawson's flip.
-  fc.remove_ndelaunay_edge = 1;
-  fc.enqflag = 2;
+  delete [] abtets;
 
-  lawsonflip3d(&fc);
+  ivf.iloc = (int) INSTAR;
+  ivf.chkencflag = chkencflag;
+  ivf.assignmeshsize = b->metric; 
 
-  if (b->verbose > 1) {
-    printf("    obj (after Lawson) = %.17g\n", tetprism_vol_sum);
-  }
 
-  if (unflipqueue->objects == 0l) {
-    return; // The mesh is Delaunay.
+  if (insertpoint(steinerpt, &searchtet, NULL, NULL, &ivf)) {
+    // The vertex has been inserted.
+    st_volref_count++; 
+    if (steinerleft > 0) steinerleft--;
+    return 1;
+  } else {
+    // The Steiner point is too close to an existing vertex. Reject it.
+    pointdealloc(steinerpt);
+    return 0;
   }
+}
 
-  fc.unflip = 1; // Unflip if the edge is not flipped.
-  fc.collectnewtets = 1; // new tets are returned in 'cavetetlist'.
-  fc.enqflag = 0;
-
-  autofliplinklevel = 1; // Init level.
-  b->fliplinklevel = -1; // No fixed level.
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// removeslivers()    Remove slivers by adding Steiner points.               //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
 
-  // For efficiency reason, we limit the maximium size of the edge star.
-  int bakmaxflipstarsize = b->flipstarsize;
-  b->flipstarsize = 10; // default
+long tetgenmesh::removeslivers(int chkencflag)
+{
+  arraypool *flipqueue, *swapqueue;
+  badface *bface, *parybface;
+  triface slitet, *parytet;
+  point *ppt;
+  REAL cosdd[6], maxcosd;
+  long totalsptcount, sptcount;
+  int iter, i, j, k;
 
+  //assert(unflipqueue->objects > 0l);
   flipqueue = new arraypool(sizeof(badface), 10);
-  nextflipqueue = new arraypool(sizeof(badface), 10);
-  
+
   // Swap the two flip queues.
   swapqueue = flipqueue;
   flipqueue = unflipqueue;
   unflipqueue = swapqueue;
 
-  while (flipqueue->objects > 0l) {
+  totalsptcount = 0l;
+  iter = 0;
+
+  while ((flipqueue->objects > 0l) && (steinerleft != 0)) {
+
+    sptcount = 0l;
 
     if (b->verbose > 1) {
-      printf("    Recover Delaunay [level = %2d] #:  %ld.\n",
-             autofliplinklevel, flipqueue->objects);
+      printf("    Splitting bad quality tets [%d]#:  %ld.\n",
+             iter, flipqueue->objects);
     }
 
-    for (i = 0; i < flipqueue->objects; i++) {
-      bface  = (badface *) fastlookup(flipqueue, i);
-      if (getedge(bface->forg, bface->fdest, &bface->tt)) {
-        if (removeedgebyflips(&(bface->tt), &fc) == 2) {
-          tetprism_vol_sum += fc.tetprism_vol_sum;
-          fc.tetprism_vol_sum = 0.0; // Clear it.
-          // Queue new faces for flips.
-          for (j = 0; j < cavetetlist->objects; j++) {
-            parytet = (triface *) fastlookup(cavetetlist, j);
-            // A queued new tet may be dead.
-            if (!isdeadtet(*parytet)) {
-              for (parytet->ver = 0; parytet->ver < 4; parytet->ver++) {
-                // Avoid queue a face twice.
-                decode(parytet->tet[parytet->ver], neightet);
-                if (!facemarked(neightet)) {
-                  flippush(flipstack, parytet);
-                }
-              } // parytet->ver
+    for (k = 0; (k < flipqueue->objects) && (steinerleft != 0); k++) {      
+      bface  = (badface *) fastlookup(flipqueue, k);
+      if (gettetrahedron(bface->forg, bface->fdest, bface->fapex,
+                         bface->foppo, &bface->tt)) {
+        if ((bface->key == 0) || (bface->tt.ver != 11)) {
+          // Here we need to re-compute the quality. Since other smoothing
+          //   operation may have moved the vertices of this tet.
+          ppt = (point *) & (bface->tt.tet[4]);
+          tetalldihedral(ppt[0], ppt[1], ppt[2], ppt[3], bface->cent, 
+                         &bface->key, NULL);
+        }
+        if (bface->key < cosslidihed) { 
+          // It is a sliver. Try to split it.
+          slitet.tet = bface->tt.tet;
+          //cosdd = bface->cent;
+          for (j = 0; j < 6; j++) {
+            if (bface->cent[j] < cosslidihed) { 
+              // Found a large dihedral angle.
+              slitet.ver = edge2ver[j]; // Go to the edge.
+              if (splitsliver(&slitet, bface->cent[j], chkencflag)) {
+                sptcount++;
+                break;
+              }
             }
           } // j
-          cavetetlist->restart();
-          // Remove locally non-Delaunay faces. New non-Delaunay edges
-          //   may be found. They are saved in 'unflipqueue'.
-          fc.enqflag = 2;
-          lawsonflip3d(&fc);
-          fc.enqflag = 0;
-          // There may be unflipable faces. Add them in flipqueue.
-          for (j = 0; j < unflipqueue->objects; j++) {
-            bface  = (badface *) fastlookup(unflipqueue, j);
-            flipqueue->newindex((void **) &parybface);
+          if (j < 6) {
+            // A sliver is split. Queue new slivers.
+            badtetrahedrons->traversalinit();
+            parytet = (triface *) badtetrahedrons->traverse();
+            while (parytet != NULL) {
+              unmarktest2(*parytet);
+              ppt = (point *) & (parytet->tet[4]);
+              tetalldihedral(ppt[0], ppt[1], ppt[2], ppt[3], cosdd, 
+                             &maxcosd, NULL);
+              if (maxcosd < cosslidihed) {
+                // A new sliver. Queue it.
+                unflipqueue->newindex((void **) &parybface);
+                parybface->forg = ppt[0];
+                parybface->fdest = ppt[1];
+                parybface->fapex = ppt[2];
+                parybface->foppo = ppt[3];
+                parybface->tt.tet = parytet->tet;
+                parybface->tt.ver = 11;
+                parybface->key = maxcosd;
+                for (i = 0; i < 6; i++) {
+                  parybface->cent[i] = cosdd[i];
+                }
+              }
+              parytet = (triface *) badtetrahedrons->traverse();
+            }
+            badtetrahedrons->restart();
+          } else {
+            // Didn't split. Queue it again.
+            unflipqueue->newindex((void **) &parybface);
             *parybface = *bface;
-          }
-          unflipqueue->restart();
-        } else {
-          // Unable to remove this edge. Save it.
-          nextflipqueue->newindex((void **) &parybface);
-          *parybface = *bface;
-          // Normally, it should be zero. 
-          //assert(fc.tetprism_vol_sum == 0.0);
-          // However, due to rounding errors, a tiny value may appear.
-          fc.tetprism_vol_sum = 0.0;
-        }
-      }
-    } // i
+          } // if (j == 6)
+        } // if (bface->key < cosslidihed)
+      } // if (gettetrahedron(...))
+    } // k
 
-    if (b->verbose > 1) {
-      printf("    obj (after level %d) = %.17g.\n", autofliplinklevel,
-             tetprism_vol_sum);
-    }
     flipqueue->restart();
 
-    // Swap the two flip queues.
-    swapqueue = flipqueue;
-    flipqueue = nextflipqueue;
-    nextflipqueue = swapqueue;
+    if (b->verbose > 1) {
+      printf("    Split %ld tets.\n", sptcount);
+    }
+    totalsptcount += sptcount;
 
-    if (flipqueue->objects > 0l) {
-      // default 'b->delmaxfliplevel' is 1.
-      if (autofliplinklevel >= b->delmaxfliplevel) {
-        // For efficiency reason, we do not search too far.
+    if (sptcount == 0l) {
+      // No point has been smoothed. 
+      break;
+    } else {
+      iter++;
+      if (iter == 2) { //if (iter >= b->optpasses) {
         break;
       }
-      autofliplinklevel+=b->fliplinklevelinc;
-    }
-  } // while (flipqueue->objects > 0l)
-
-  if (flipqueue->objects > 0l) {
-    if (b->verbose > 1) {
-      printf("    %ld non-Delaunay edges remained.\n", flipqueue->objects);
     }
-  }
 
-  if (b->verbose) {
-    printf("  Final obj  = %.17g\n", tetprism_vol_sum);
-  }
+    // Swap the two flip queues.
+    swapqueue = flipqueue;
+    flipqueue = unflipqueue;
+    unflipqueue = swapqueue;
+  } // while
 
-  b->flipstarsize = bakmaxflipstarsize;
   delete flipqueue;
-  delete nextflipqueue;
-}
-
-///////////////////////////////////////////////////////////////////////////////
-//                                                                           //
-// gettetrahedron()    Get a tetrahedron which have the given vertices.      //
-//                                                                           //
-///////////////////////////////////////////////////////////////////////////////
-
-int tetgenmesh::gettetrahedron(point pa, point pb, point pc, point pd, 
-                               triface *searchtet)
-{
-  triface spintet;
-  int t1ver; 
-
-  if (getedge(pa, pb, searchtet)) {
-    spintet = *searchtet;
-    while (1) {
-      if (apex(spintet) == pc) {
-        *searchtet = spintet;
-        break;
-      }
-      fnextself(spintet);
-      if (spintet.tet == searchtet->tet) break;
-    }
-    if (apex(*searchtet) == pc) {
-      if (oppo(*searchtet) == pd) {
-        return 1;
-      } else {
-        fsymself(*searchtet);
-        if (oppo(*searchtet) == pd) {
-          return 1;
-        }
-      }
-    }
-  }
 
-  return 0;
+  return totalsptcount;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// improvequalitybyflips()    Improve the mesh quality by flips.             //
+// optimizemesh()    Optimize mesh for specified objective functions.        //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-long tetgenmesh::improvequalitybyflips()
+void tetgenmesh::optimizemesh()
 {
-  arraypool *flipqueue, *nextflipqueue, *swapqueue;
-  badface *bface, *parybface;
-  triface *parytet;
+  badface *parybface;
+  triface checktet;
   point *ppt;
-  flipconstraints fc;
-  REAL *cosdd, ncosdd[6], maxdd;
+  int optpasses;
+  optparameters opm;
+  REAL ncosdd[6], maxdd;
   long totalremcount, remcount;
-  int remflag;
-  int n, i, j, k;
+  long totalsmtcount, smtcount;
+  long totalsptcount, sptcount;
+  int chkencflag;
+  int iter;
+  int n;
+
+  if (!b->quiet) {
+    printf("Optimizing mesh...\n");
+  }
 
-  //assert(unflipqueue->objects > 0l);
-  flipqueue = new arraypool(sizeof(badface), 10);
-  nextflipqueue = new arraypool(sizeof(badface), 10);
+  optpasses = ((1 << b->optlevel) - 1);
 
-  // Backup flip edge options.
-  int bakautofliplinklevel = autofliplinklevel;
-  int bakfliplinklevel = b->fliplinklevel;
-  int bakmaxflipstarsize = b->flipstarsize;
+  if (b->verbose) {
+    printf("  Optimization level  = %d.\n", b->optlevel);
+    printf("  Optimization scheme = %d.\n", b->optscheme);
+    printf("  Number of iteration = %d.\n", optpasses);
+    printf("  Min_Max dihed angle = %g.\n", b->optmaxdihedral);
+  }
 
-  // Set flip edge options.
-  autofliplinklevel = 1; 
-  b->fliplinklevel = -1;
-  b->flipstarsize = 10; // b->optmaxflipstarsize;
+  totalsmtcount = totalsptcount = totalremcount = 0l;
 
-  fc.remove_large_angle = 1;
-  fc.unflip = 1;
-  fc.collectnewtets = 1;
-  fc.checkflipeligibility = 1;
+  cosmaxdihed = cos(b->optmaxdihedral / 180.0 * PI);
+  cossmtdihed = cos(b->optminsmtdihed / 180.0 * PI);
+  cosslidihed = cos(b->optminslidihed / 180.0 * PI);
 
-  totalremcount = 0l;
+  int attrnum = numelemattrib - 1; 
 
-  // Swap the two flip queues.
-  swapqueue = flipqueue;
-  flipqueue = unflipqueue;
-  unflipqueue = swapqueue;
+  // Put all bad tetrahedra into array.
+  tetrahedrons->traversalinit();
+  checktet.tet = tetrahedrontraverse();
+  while (checktet.tet != NULL) {
+    if (b->convex) { // -c
+      // Skip this tet if it lies in the exterior.
+      if (elemattribute(checktet.tet, attrnum) == -1.0) {
+        checktet.tet = tetrahedrontraverse();
+        continue;
+      }
+    }
+    ppt = (point *) & (checktet.tet[4]);
+    tetalldihedral(ppt[0], ppt[1], ppt[2], ppt[3], ncosdd, &maxdd, NULL);
+    if (maxdd < cosmaxdihed) {
+      // There are bad dihedral angles in this tet.
+      unflipqueue->newindex((void **) &parybface); 
+      parybface->tt.tet = checktet.tet;
+      parybface->tt.ver = 11;
+      parybface->forg = ppt[0];
+      parybface->fdest = ppt[1];
+      parybface->fapex = ppt[2];
+      parybface->foppo = ppt[3];
+      parybface->key = maxdd;
+      for (n = 0; n < 6; n++) {
+        parybface->cent[n] = ncosdd[n];
+      }
+    }
+    checktet.tet = tetrahedrontraverse();
+  }
 
-  while (flipqueue->objects > 0l) {
+  totalremcount = improvequalitybyflips();
 
-    remcount = 0l;
+  if ((unflipqueue->objects > 0l) && 
+      ((b->optscheme & 2) || (b->optscheme & 4))) {
+    // The pool is only used by removeslivers().
+    badtetrahedrons = new memorypool(sizeof(triface), b->tetrahedraperblock,
+                                     sizeof(void *), 0);
 
-    while (flipqueue->objects > 0l) {
-      if (b->verbose > 1) {
-        printf("    Improving mesh qualiy by flips [%d]#:  %ld.\n",
-               autofliplinklevel, flipqueue->objects);
-      }
+    // Smoothing options.
+    opm.min_max_dihedangle = 1;
+    opm.numofsearchdirs = 10;
+    // opm.searchstep = 0.001;  
+    opm.maxiter = 30; // Limit the maximum iterations.
+    //opm.checkencflag = 4; // Queue affected tets after smoothing.
+    chkencflag = 4; // Queue affected tets after splitting a sliver.
+    iter = 0;
 
-      for (k = 0; k < flipqueue->objects; k++) {
-        bface  = (badface *) fastlookup(flipqueue, k);
-        if (gettetrahedron(bface->forg, bface->fdest, bface->fapex,
-                           bface->foppo, &bface->tt)) {
-          //assert(!ishulltet(bface->tt));
-          // There are bad dihedral angles in this tet.
-          if (bface->tt.ver != 11) {
-            // The dihedral angles are permuted.
-            // Here we simply re-compute them. Slow!!.
-            ppt = (point *) & (bface->tt.tet[4]);
-            tetalldihedral(ppt[0], ppt[1], ppt[2], ppt[3], bface->cent, 
-                           &bface->key, NULL);
-            bface->forg = ppt[0];
-            bface->fdest = ppt[1];
-            bface->fapex = ppt[2];
-            bface->foppo = ppt[3];
-            bface->tt.ver = 11;
-          }
-          if (bface->key == 0) {
-            // Re-comput the quality values. Due to smoothing operations.
-            ppt = (point *) & (bface->tt.tet[4]);
-            tetalldihedral(ppt[0], ppt[1], ppt[2], ppt[3], bface->cent, 
-                           &bface->key, NULL);
-          }
-          cosdd = bface->cent;
-          remflag = 0;
-          for (i = 0; (i < 6) && !remflag; i++) {
-            if (cosdd[i] < cosmaxdihed) {
-              // Found a large dihedral angle.
-              bface->tt.ver = edge2ver[i]; // Go to the edge.
-              fc.cosdihed_in = cosdd[i];
-              fc.cosdihed_out = 0.0; // 90 degree.
-              n = removeedgebyflips(&(bface->tt), &fc);
-              if (n == 2) {
-                // Edge is flipped.
-                remflag = 1;
-                if (fc.cosdihed_out < cosmaxdihed) {
-                  // Queue new bad tets for further improvements.
-                  for (j = 0; j < cavetetlist->objects; j++) {
-                    parytet = (triface *) fastlookup(cavetetlist, j);
-                    if (!isdeadtet(*parytet)) {
-                      ppt = (point *) & (parytet->tet[4]);
-                      // Do not test a hull tet.
-                      if (ppt[3] != dummypoint) {
-                        tetalldihedral(ppt[0], ppt[1], ppt[2], ppt[3], ncosdd, 
-                                       &maxdd, NULL);
-                        if (maxdd < cosmaxdihed) {
-                          // There are bad dihedral angles in this tet.
-                          nextflipqueue->newindex((void **) &parybface); 
-                          parybface->tt.tet = parytet->tet;
-                          parybface->tt.ver = 11;
-                          parybface->forg = ppt[0];
-                          parybface->fdest = ppt[1];
-                          parybface->fapex = ppt[2];
-                          parybface->foppo = ppt[3];
-                          parybface->key = maxdd;
-                          for (n = 0; n < 6; n++) {
-                            parybface->cent[n] = ncosdd[n];
-                          }
-                        }
-                      } // if (ppt[3] != dummypoint) 
-                    }
-                  } // j
-                } // if (fc.cosdihed_out < cosmaxdihed)
-                cavetetlist->restart();
-                remcount++;
-              }
-            }
-          } // i          
-          if (!remflag) {
-            // An unremoved bad tet. Queue it again. 
-            unflipqueue->newindex((void **) &parybface);
-            *parybface = *bface;
+    while (iter < optpasses) {
+      smtcount = sptcount = remcount = 0l;
+      if (b->optscheme & 2) {
+        smtcount += improvequalitybysmoothing(&opm);
+        totalsmtcount += smtcount;
+        if (smtcount > 0l) {
+          remcount = improvequalitybyflips();
+          totalremcount += remcount;
+        }
+      }
+      if (unflipqueue->objects > 0l) {
+        if (b->optscheme & 4) {
+          sptcount += removeslivers(chkencflag);
+          totalsptcount += sptcount;
+          if (sptcount > 0l) {
+            remcount = improvequalitybyflips();
+            totalremcount += remcount;
           }
-        } // if (gettetrahedron(...))
-      } // k
-
-      flipqueue->restart();
+        }
+      }
+      if (unflipqueue->objects > 0l) {
+        if (remcount > 0l) {
+          iter++;
+        } else {
+          break;
+        }
+      } else {
+        break;
+      }
+    } // while (iter)
 
-      // Swap the two flip queues.
-      swapqueue = flipqueue;
-      flipqueue = nextflipqueue;
-      nextflipqueue = swapqueue;
-    } // while (flipqueues->objects > 0)
+    delete badtetrahedrons;
+    badtetrahedrons = NULL;
+  }
 
+  if (unflipqueue->objects > 0l) {
     if (b->verbose > 1) {
-      printf("    Removed %ld bad tets.\n", remcount);
+      printf("    %ld bad tets remained.\n", unflipqueue->objects);
     }
-    totalremcount += remcount;
+    unflipqueue->restart();
+  }
 
-    if (unflipqueue->objects > 0l) {
-      //if (autofliplinklevel >= b->optmaxfliplevel) {
-      if (autofliplinklevel >= b->optlevel) {
-        break;
-      }
-      autofliplinklevel+=b->fliplinklevelinc;
-      //b->flipstarsize = 10 + (1 << (b->optlevel - 1));
+  if (b->verbose) {
+    if (totalremcount > 0l) {
+      printf("  Removed %ld edges.\n", totalremcount);
+    }
+    if (totalsmtcount > 0l) {
+      printf("  Smoothed %ld points.\n", totalsmtcount);
     }
+    if (totalsptcount > 0l) {
+      printf("  Split %ld slivers.\n", totalsptcount);
+    }
+  }
+}
 
-    // Swap the two flip queues.
-    swapqueue = flipqueue;
-    flipqueue = unflipqueue;
-    unflipqueue = swapqueue;
-  } // while (flipqueues->objects > 0)
+////                                                                       ////
+////                                                                       ////
+//// optimize_cxx /////////////////////////////////////////////////////////////
 
-  // Restore original flip edge options.
-  autofliplinklevel = bakautofliplinklevel;
-  b->fliplinklevel = bakfliplinklevel;
-  b->flipstarsize = bakmaxflipstarsize;
+//// meshstat_cxx /////////////////////////////////////////////////////////////
+////                                                                       ////
+////                                                                       ////
 
-  delete flipqueue;
-  delete nextflipqueue;
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// printfcomma()    Print a (large) number with the 'thousands separator'.   // 
+//                                                                           //
+// The following code was simply copied from "stackoverflow".                //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
 
-  return totalremcount;
+void tetgenmesh::printfcomma(unsigned long n)
+{
+  unsigned long n2 = 0;
+  int scale = 1;
+  while (n >= 1000) {
+    n2 = n2 + scale * (n % 1000);
+    n /= 1000;
+    scale *= 1000;
+  }
+  printf ("%ld", n);
+  while (scale != 1) {
+    scale /= 1000;
+    n = n2 / scale;
+    n2 = n2  % scale;
+    printf (",%03ld", n);
+  }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// smoothpoint()    Moving a vertex to improve the mesh quality.             //
-//                                                                           //
-// 'smtpt' (p) is a point to be smoothed. Generally, it is a Steiner point.  //
-// It may be not a vertex of the mesh.                                       //
-//                                                                           //
-// This routine tries to move 'p' inside its star until a selected objective //
-// function over all tetrahedra in the star is improved. The function may be //
-// the some quality measures, i.e., aspect ratio, maximum dihedral angel, or //
-// simply the volume of the tetrahedra.                                      //
-//                                                                           //
-// 'linkfacelist' contains the list of link faces of 'p'.  Since a link face //
-// has two orientations, ccw or cw, with respect to 'p'.  'ccw' indicates    //
-// the orientation is ccw (1) or not (0).                                    //
-//                                                                           //
-// 'opm' is a structure contains the parameters of the objective function.   //
-// It is needed by the evaluation of the function value.                     //
-//                                                                           //
-// The return value indicates weather the point is smoothed or not.          //
+// checkmesh()    Test the mesh for topological consistency.                 //
 //                                                                           //
-// ASSUMPTION: This routine assumes that all link faces are true faces, i.e, //
-// no face has 'dummypoint' as its vertex.                                   //
+// If 'topoflag' is set, only check the topological connection of the mesh,  //
+// i.e., do not report degenerated or inverted elements.                     //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-int tetgenmesh::smoothpoint(point smtpt, arraypool *linkfacelist, int ccw,
-                            optparameters *opm)
+int tetgenmesh::checkmesh(int topoflag)
 {
-  triface *parytet, *parytet1, swaptet;
-  point pa, pb, pc;
-  REAL fcent[3], startpt[3], nextpt[3], bestpt[3];
-  REAL oldval, minval = 0.0, val;
-  REAL maxcosd; // oldang, newang;
-  REAL ori, diff;
-  int numdirs, iter;
-  int i, j, k;
-
-  // Decide the number of moving directions.
-  numdirs = (int) linkfacelist->objects;
-  if (numdirs > opm->numofsearchdirs) {
-    numdirs = opm->numofsearchdirs; // Maximum search directions.
-  }
-
-  // Set the initial value.
-  opm->imprval = opm->initval;
-  iter = 0;
+  triface tetloop, neightet, symtet;
+  point pa, pb, pc, pd;
+  REAL ori;
+  int horrors, i;
 
-  for (i = 0; i < 3; i++) {
-    bestpt[i] = startpt[i] = smtpt[i];
+  if (!b->quiet) {
+    printf("  Checking consistency of mesh...\n");
   }
 
-  // Iterate until the obj function is not improved.
-  while (1) {
-
-    // Find the best next location.
-    oldval = opm->imprval;
-
-    for (i = 0; i < numdirs; i++) {
-      // Randomly pick a link face (0 <= k <= objects - i - 1).
-      k = (int) randomnation(linkfacelist->objects - i);
-      parytet = (triface *) fastlookup(linkfacelist, k);
-      // Calculate a new position from 'p' to the center of this face.
-      pa = org(*parytet);
-      pb = dest(*parytet);
-      pc = apex(*parytet);
-      for (j = 0; j < 3; j++) {
-        fcent[j] = (pa[j] + pb[j] + pc[j]) / 3.0;
-      }
-      for (j = 0; j < 3; j++) {
-        nextpt[j] = startpt[j] + opm->searchstep * (fcent[j] - startpt[j]); 
-      }
-      // Calculate the largest minimum function value for the new location.
-      for (j = 0; j < linkfacelist->objects; j++) {
-        parytet = (triface *) fastlookup(linkfacelist, j);
-        if (ccw) {
-          pa = org(*parytet);
-          pb = dest(*parytet);
-        } else {
-          pb = org(*parytet);
-          pa = dest(*parytet);
+  horrors = 0;
+  tetloop.ver = 0;
+  // Run through the list of tetrahedra, checking each one.
+  tetrahedrons->traversalinit();
+  tetloop.tet = alltetrahedrontraverse();
+  while (tetloop.tet != (tetrahedron *) NULL) {
+    // Check all four faces of the tetrahedron.
+    for (tetloop.ver = 0; tetloop.ver < 4; tetloop.ver++) {
+      pa = org(tetloop);
+      pb = dest(tetloop);
+      pc = apex(tetloop);
+      pd = oppo(tetloop);
+      if (tetloop.ver == 0) {  // Only test for inversion once.
+        if (!ishulltet(tetloop)) {  // Only do test if it is not a hull tet.
+          if (!topoflag) {
+            ori = orient3d(pa, pb, pc, pd);
+            if (ori >= 0.0) {
+              printf("  !! !! %s ", ori > 0.0 ? "Inverted" : "Degenerated");
+              printf("  (%d, %d, %d, %d) (ori = %.17g)\n", pointmark(pa),
+                     pointmark(pb), pointmark(pc), pointmark(pd), ori);
+              horrors++;
+            }
+          }
         }
-        pc = apex(*parytet);
-        ori = orient3d(pa, pb, pc, nextpt);
-        if (ori < 0.0) {
-          // Calcuate the objective function value. 
-          if (opm->max_min_volume) {
-            //val = -ori;
-            val = - orient3dfast(pa, pb, pc, nextpt);
-          } else if (opm->min_max_aspectratio) {
-            val = 1.0 / tetaspectratio(pa, pb, pc, nextpt);
-          } else if (opm->min_max_dihedangle) {
-            tetalldihedral(pa, pb, pc, nextpt, NULL, &maxcosd, NULL);
-            if (maxcosd < -1) maxcosd = -1.0; // Rounding.
-            val = maxcosd + 1.0; // Make it be positive. 
-          } else {
-            // Unknown objective function.
-            val = 0.0;
-          }  
-        } else { // ori >= 0.0;
-          // An invalid new tet. 
-          // This may happen if the mesh contains inverted elements.
-          if (opm->max_min_volume) {
-            //val = -ori;
-            val = - orient3dfast(pa, pb, pc, nextpt);    
-          } else {
-            // Discard this point.
-            break; // j
+        if (infected(tetloop)) { 
+          // This may be a bug. Report it.
+          printf("  !! (%d, %d, %d, %d) is infected.\n", pointmark(pa),
+                 pointmark(pb), pointmark(pc), pointmark(pd));
+          horrors++;
+        }
+        if (marktested(tetloop)) {
+          // This may be a bug. Report it.
+          printf("  !! (%d, %d, %d, %d) is marked.\n", pointmark(pa),
+                 pointmark(pb), pointmark(pc), pointmark(pd));
+          horrors++;
+        }
+      }
+      if (tetloop.tet[tetloop.ver] == NULL) {
+        printf("  !! !! No neighbor at face (%d, %d, %d).\n", pointmark(pa),
+               pointmark(pb), pointmark(pc));
+        horrors++;
+      } else {
+        // Find the neighboring tetrahedron on this face.
+        fsym(tetloop, neightet);
+        if (neightet.tet != NULL) {
+          // Check that the tetrahedron's neighbor knows it's a neighbor.
+          fsym(neightet, symtet);
+          if ((tetloop.tet != symtet.tet) || (tetloop.ver != symtet.ver)) {
+            printf("  !! !! Asymmetric tetra-tetra bond:\n");
+            if (tetloop.tet == symtet.tet) {
+              printf("   (Right tetrahedron, wrong orientation)\n");
+            }
+            printf("    First:  (%d, %d, %d, %d)\n", pointmark(pa),
+                   pointmark(pb), pointmark(pc), pointmark(pd));
+            printf("    Second: (%d, %d, %d, %d)\n", pointmark(org(neightet)),
+                   pointmark(dest(neightet)), pointmark(apex(neightet)),
+                   pointmark(oppo(neightet)));
+            horrors++;
           }
-        } // if (ori >= 0.0)
-        // Stop looping when the object value is not improved.
-        if (val <= opm->imprval) {
-          break; // j
-        } else {
-          // Remember the smallest improved value.
-          if (j == 0) {
-            minval = val;
-          } else {
-            minval = (val < minval) ? val : minval;
+          // Check if they have the same edge (the bond() operation).
+          if ((org(neightet) != pb) || (dest(neightet) != pa)) {
+            printf("  !! !! Wrong edge-edge bond:\n");
+            printf("    First:  (%d, %d, %d, %d)\n", pointmark(pa),
+                   pointmark(pb), pointmark(pc), pointmark(pd));
+            printf("    Second: (%d, %d, %d, %d)\n", pointmark(org(neightet)),
+                   pointmark(dest(neightet)), pointmark(apex(neightet)),
+                   pointmark(oppo(neightet)));
+            horrors++;
+          }
+          // Check if they have the same apex.
+          if (apex(neightet) != pc) {
+            printf("  !! !! Wrong face-face bond:\n");
+            printf("    First:  (%d, %d, %d, %d)\n", pointmark(pa),
+                   pointmark(pb), pointmark(pc), pointmark(pd));
+            printf("    Second: (%d, %d, %d, %d)\n", pointmark(org(neightet)),
+                   pointmark(dest(neightet)), pointmark(apex(neightet)),
+                   pointmark(oppo(neightet)));
+            horrors++;
+          }
+          // Check if they have the same opposite.
+          if (oppo(neightet) == pd) {
+            printf("  !! !! Two identical tetra:\n");
+            printf("    First:  (%d, %d, %d, %d)\n", pointmark(pa),
+                   pointmark(pb), pointmark(pc), pointmark(pd));
+            printf("    Second: (%d, %d, %d, %d)\n", pointmark(org(neightet)),
+                   pointmark(dest(neightet)), pointmark(apex(neightet)),
+                   pointmark(oppo(neightet)));
+            horrors++;
           }
+        } else {
+          printf("  !! !! Tet-face has no neighbor (%d, %d, %d) - %d:\n",
+                 pointmark(pa), pointmark(pb), pointmark(pc), pointmark(pd));
+          horrors++;
         }
-      } // j
-      if (j == linkfacelist->objects) {
-        // The function value has been improved.
-        opm->imprval = minval;
-        // Save the new location of the point.
-        for (j = 0; j < 3; j++) bestpt[j] = nextpt[j];
       }
-      // Swap k-th and (object-i-1)-th entries.
-      j = linkfacelist->objects - i - 1;
-      parytet  = (triface *) fastlookup(linkfacelist, k);
-      parytet1 = (triface *) fastlookup(linkfacelist, j);
-      swaptet = *parytet1;
-      *parytet1 = *parytet;
-      *parytet = swaptet;
-    } // i
-
-    diff = opm->imprval - oldval;
-    if (diff > 0.0) {
-      // Is the function value improved effectively?
-      if (opm->max_min_volume) {
-        //if ((diff / oldval) < b->epsilon) diff = 0.0;  
-      } else if (opm->min_max_aspectratio) {
-        if ((diff / oldval) < 1e-3) diff = 0.0;
-      } else if (opm->min_max_dihedangle) {
-        //oldang = acos(oldval - 1.0);
-        //newang = acos(opm->imprval - 1.0);
-        //if ((oldang - newang) < 0.00174) diff = 0.0; // about 0.1 degree.
-      } else {
-        // Unknown objective function.
-        terminatetetgen(this, 2); 
+      if (facemarked(tetloop)) {
+        // This may be a bug. Report it.
+        printf("  !! tetface (%d, %d, %d) %d is marked.\n", pointmark(pa),
+               pointmark(pb), pointmark(pc), pointmark(pd));
+      }
+    }
+    // Check the six edges of this tet.
+    for (i = 0; i < 6; i++) {
+      tetloop.ver = edge2ver[i];
+      if (edgemarked(tetloop)) {
+        // This may be a bug. Report it.
+        printf("  !! tetedge (%d, %d) %d, %d is marked.\n", 
+               pointmark(org(tetloop)), pointmark(dest(tetloop)), 
+               pointmark(apex(tetloop)), pointmark(oppo(tetloop)));
       }
     }
-
-    if (diff > 0.0) {
-      // Yes, move p to the new location and continue.
-      for (j = 0; j < 3; j++) startpt[j] = bestpt[j];
-      iter++;
-      if ((opm->maxiter > 0) && (iter >= opm->maxiter)) {
-        // Maximum smoothing iterations reached.
-        break;
-      }
-    } else {
-      break;
+    tetloop.tet = alltetrahedrontraverse();
+  }
+  if (horrors == 0) {
+    if (!b->quiet) {
+      printf("  In my studied opinion, the mesh appears to be consistent.\n");
     }
-
-  } // while (1)
-
-  if (iter > 0) {
-    // The point has been smoothed.
-    opm->smthiter = iter; // Remember the number of iterations. 
-    // The point has been smoothed. Update it to its new position.
-    for (i = 0; i < 3; i++) smtpt[i] = startpt[i];
+  } else {
+    printf("  !! !! !! !! %d %s witnessed.\n", horrors, 
+           horrors > 1 ? "abnormity" : "abnormities");
   }
 
-  return iter;
+  return horrors;
 }
 
-
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// improvequalitysmoothing()    Improve mesh quality by smoothing.           //
+// checkshells()       Test the boundary mesh for topological consistency.   //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-long tetgenmesh::improvequalitybysmoothing(optparameters *opm)
+int tetgenmesh::checkshells()
 {
-  arraypool *flipqueue, *swapqueue;
-  triface *parytet;
-  badface *bface, *parybface;
-  point *ppt;
-  long totalsmtcount, smtcount;
-  int smtflag;
-  int iter, i, j, k;
-
-  //assert(unflipqueue->objects > 0l);
-  flipqueue = new arraypool(sizeof(badface), 10);
-
-  // Swap the two flip queues.
-  swapqueue = flipqueue;
-  flipqueue = unflipqueue;
-  unflipqueue = swapqueue;
-
-  totalsmtcount = 0l;
-  iter = 0;
+  triface neightet, symtet;
+  face shloop, spinsh, nextsh;
+  face checkseg;
+  point pa, pb;
+  int bakcount;
+  int horrors, i;
 
-  while (flipqueue->objects > 0l) {
+  if (!b->quiet) {
+    printf("  Checking consistency of the mesh boundary...\n");
+  }
+  horrors = 0;
 
-    smtcount = 0l;
+  void **bakpathblock = subfaces->pathblock;
+  void *bakpathitem = subfaces->pathitem;
+  int bakpathitemsleft = subfaces->pathitemsleft;
+  int bakalignbytes = subfaces->alignbytes;
 
-    if (b->verbose > 1) {
-      printf("    Improving mesh quality by smoothing [%d]#:  %ld.\n",
-             iter, flipqueue->objects);
+  subfaces->traversalinit();
+  shloop.sh = shellfacetraverse(subfaces);
+  while (shloop.sh != NULL) {
+    shloop.shver = 0;
+    for (i = 0; i < 3; i++) {
+      // Check the face ring at this edge.
+      pa = sorg(shloop);
+      pb = sdest(shloop);
+      spinsh = shloop;
+      spivot(spinsh, nextsh);
+      bakcount = horrors;
+      while ((nextsh.sh != NULL) && (nextsh.sh != shloop.sh)) {
+        if (nextsh.sh[3] == NULL) {
+          printf("  !! !! Wrong subface-subface connection (Dead subface).\n");
+          printf("    First: x%lx (%d, %d, %d).\n", (uintptr_t) spinsh.sh,
+                 pointmark(sorg(spinsh)), pointmark(sdest(spinsh)), 
+                 pointmark(sapex(spinsh)));
+          printf("    Second: x%lx (DEAD)\n", (uintptr_t) nextsh.sh);
+          horrors++;
+          break;
+        }
+        // check if they have the same edge.
+        if (!(((sorg(nextsh) == pa) && (sdest(nextsh) == pb)) ||
+              ((sorg(nextsh) == pb) && (sdest(nextsh) == pa)))) {
+           printf("  !! !! Wrong subface-subface connection.\n");
+           printf("    First: x%lx (%d, %d, %d).\n", (uintptr_t) spinsh.sh,
+                  pointmark(sorg(spinsh)), pointmark(sdest(spinsh)), 
+                  pointmark(sapex(spinsh)));
+           printf("    Scond: x%lx (%d, %d, %d).\n", (uintptr_t) nextsh.sh,
+                  pointmark(sorg(nextsh)), pointmark(sdest(nextsh)), 
+                  pointmark(sapex(nextsh)));
+           horrors++;
+           break;
+        }
+        // Check they should not have the same apex.
+        if (sapex(nextsh) == sapex(spinsh)) {
+           printf("  !! !! Existing two duplicated subfaces.\n");
+           printf("    First: x%lx (%d, %d, %d).\n", (uintptr_t) spinsh.sh,
+                  pointmark(sorg(spinsh)), pointmark(sdest(spinsh)), 
+                  pointmark(sapex(spinsh)));
+           printf("    Scond: x%lx (%d, %d, %d).\n", (uintptr_t) nextsh.sh,
+                  pointmark(sorg(nextsh)), pointmark(sdest(nextsh)), 
+                  pointmark(sapex(nextsh)));
+           horrors++;
+           break;
+        }
+        spinsh = nextsh;
+        spivot(spinsh, nextsh);
+      }
+      // Check subface-subseg bond.
+      sspivot(shloop, checkseg);
+      if (checkseg.sh != NULL) {
+        if (checkseg.sh[3] == NULL) {
+          printf("  !! !! Wrong subface-subseg connection (Dead subseg).\n");
+          printf("    Sub: x%lx (%d, %d, %d).\n", (uintptr_t) shloop.sh,
+                 pointmark(sorg(shloop)), pointmark(sdest(shloop)), 
+                 pointmark(sapex(shloop)));
+          printf("    Sub: x%lx (Dead)\n", (uintptr_t) checkseg.sh);
+          horrors++;
+        } else {
+          if (!(((sorg(checkseg) == pa) && (sdest(checkseg) == pb)) ||
+                ((sorg(checkseg) == pb) && (sdest(checkseg) == pa)))) {
+            printf("  !! !! Wrong subface-subseg connection.\n");
+            printf("    Sub: x%lx (%d, %d, %d).\n", (uintptr_t) shloop.sh,
+                   pointmark(sorg(shloop)), pointmark(sdest(shloop)), 
+                   pointmark(sapex(shloop)));
+            printf("    Seg: x%lx (%d, %d).\n", (uintptr_t) checkseg.sh,
+                   pointmark(sorg(checkseg)), pointmark(sdest(checkseg)));
+            horrors++;
+          }
+        }
+      }
+      if (horrors > bakcount) break; // An error detected. 
+      senextself(shloop);
     }
-
-    for (k = 0; k < flipqueue->objects; k++) {      
-      bface  = (badface *) fastlookup(flipqueue, k);
-      if (gettetrahedron(bface->forg, bface->fdest, bface->fapex,
-                         bface->foppo, &bface->tt)) {
-        // Operate on it if it is not in 'unflipqueue'.
-        if (!marktested(bface->tt)) {
-          // Here we simply re-compute the quality. Since other smoothing
-          //   operation may have moved the vertices of this tet.
-          ppt = (point *) & (bface->tt.tet[4]);
-          tetalldihedral(ppt[0], ppt[1], ppt[2], ppt[3], bface->cent, 
-                         &bface->key, NULL);
-          if (bface->key < cossmtdihed) { // if (maxdd < cosslidihed) {
-            // It is a sliver. Try to smooth its vertices.
-            smtflag = 0;
-            opm->initval = bface->key + 1.0; 
-            for (i = 0; (i < 4) && !smtflag; i++) {
-              if (pointtype(ppt[i]) == FREEVOLVERTEX) {
-                getvertexstar(1, ppt[i], cavetetlist, NULL, NULL);
-                opm->searchstep = 0.001; // Search step size
-                smtflag = smoothpoint(ppt[i], cavetetlist, 1, opm);
-                if (smtflag) {
-                  while (opm->smthiter == opm->maxiter) {
-                    opm->searchstep *= 10.0; // Increase the step size.
-                    opm->initval = opm->imprval;
-                    opm->smthiter = 0; // reset
-                    smoothpoint(ppt[i], cavetetlist, 1, opm);
-                  }
-                  // This tet is modifed.
-                  smtcount++;
-                  if ((opm->imprval - 1.0) < cossmtdihed) {
-                    // There are slivers in new tets. Queue them.
-                    for (j = 0; j < cavetetlist->objects; j++) {
-                      parytet = (triface *) fastlookup(cavetetlist, j);
-                      // Operate it if it is not in 'unflipqueue'.
-                      if (!marktested(*parytet)) {
-                        // Evaluate its quality.
-                        // Re-use ppt, bface->key, bface->cent.
-                        ppt = (point *) & (parytet->tet[4]);
-                        tetalldihedral(ppt[0], ppt[1], ppt[2], ppt[3], 
-                                       bface->cent, &bface->key, NULL);
-                        if (bface->key < cossmtdihed) {
-                          // A new sliver. Queue it.
-                          marktest(*parytet); // It is in unflipqueue.
-                          unflipqueue->newindex((void **) &parybface);
-                          parybface->tt = *parytet;
-                          parybface->forg = ppt[0];
-                          parybface->fdest = ppt[1];
-                          parybface->fapex = ppt[2];
-                          parybface->foppo = ppt[3];
-                          parybface->tt.ver = 11; 
-                          parybface->key = 0.0;
-                        }
-                      }
-                    } // j
-                  } // if ((opm->imprval - 1.0) < cossmtdihed)
-                } // if (smtflag)
-                cavetetlist->restart();
-              } // if (pointtype(ppt[i]) == FREEVOLVERTEX)
-            } // i
-            if (!smtflag) {
-              // Didn't smooth. Queue it again.
-              marktest(bface->tt); // It is in unflipqueue.
-              unflipqueue->newindex((void **) &parybface);
-              parybface->tt = bface->tt;
-              parybface->forg = ppt[0];
-              parybface->fdest = ppt[1];
-              parybface->fapex = ppt[2];
-              parybface->foppo = ppt[3];
-              parybface->tt.ver = 11;
-              parybface->key = 0.0;
-            }
-	      } // if (maxdd < cosslidihed)
-        } // if (!marktested(...))
-      } // if (gettetrahedron(...))
-    } // k
-
-    flipqueue->restart();
-
-    // Unmark the tets in unflipqueue.
-    for (i = 0; i < unflipqueue->objects; i++) {
-      bface  = (badface *) fastlookup(unflipqueue, i);
-      unmarktest(bface->tt);
+    // Check tet-subface connection.
+    stpivot(shloop, neightet);
+    if (neightet.tet != NULL) {
+      if (neightet.tet[4] == NULL) {
+        printf("  !! !! Wrong sub-to-tet connection (Dead tet)\n");
+        printf("    Sub: x%lx (%d, %d, %d).\n", (uintptr_t) shloop.sh,
+               pointmark(sorg(shloop)), pointmark(sdest(shloop)), 
+               pointmark(sapex(shloop)));
+        printf("    Tet: x%lx (DEAD)\n", (uintptr_t) neightet.tet);
+        horrors++;
+      } else {
+        if (!((sorg(shloop) == org(neightet)) && 
+              (sdest(shloop) == dest(neightet)))) {
+          printf("  !! !! Wrong sub-to-tet connection\n");
+          printf("    Sub: x%lx (%d, %d, %d).\n", (uintptr_t) shloop.sh,
+                 pointmark(sorg(shloop)), pointmark(sdest(shloop)), 
+                 pointmark(sapex(shloop)));
+          printf("    Tet: x%lx (%d, %d, %d, %d).\n",
+                 (uintptr_t) neightet.tet, pointmark(org(neightet)), 
+                 pointmark(dest(neightet)), pointmark(apex(neightet)),
+                 pointmark(oppo(neightet)));
+          horrors++;
+        }
+        tspivot(neightet, spinsh);
+        if (!((sorg(spinsh) == org(neightet)) && 
+              (sdest(spinsh) == dest(neightet)))) {
+          printf("  !! !! Wrong tet-sub connection.\n");
+          printf("    Sub: x%lx (%d, %d, %d).\n", (uintptr_t) spinsh.sh,
+                 pointmark(sorg(spinsh)), pointmark(sdest(spinsh)), 
+                 pointmark(sapex(spinsh)));
+          printf("    Tet: x%lx (%d, %d, %d, %d).\n", 
+                 (uintptr_t) neightet.tet, pointmark(org(neightet)), 
+                 pointmark(dest(neightet)), pointmark(apex(neightet)), 
+                 pointmark(oppo(neightet)));
+          horrors++;
+        }
+        fsym(neightet, symtet);
+        tspivot(symtet, spinsh);
+        if (spinsh.sh != NULL) {
+          if (!((sorg(spinsh) == org(symtet)) && 
+                (sdest(spinsh) == dest(symtet)))) {
+            printf("  !! !! Wrong tet-sub connection.\n");
+            printf("    Sub: x%lx (%d, %d, %d).\n", (uintptr_t) spinsh.sh,
+                   pointmark(sorg(spinsh)), pointmark(sdest(spinsh)), 
+                   pointmark(sapex(spinsh)));
+            printf("    Tet: x%lx (%d, %d, %d, %d).\n", 
+                   (uintptr_t) symtet.tet, pointmark(org(symtet)), 
+                   pointmark(dest(symtet)), pointmark(apex(symtet)), 
+                   pointmark(oppo(symtet)));
+            horrors++;
+          }
+        } else {
+          printf("  Warning: Broken tet-sub-tet connection.\n");
+        }
+      }
     }
-
-    if (b->verbose > 1) {
-      printf("    Smooth %ld points.\n", smtcount);
+    if (sinfected(shloop)) {
+      // This may be a bug. report it.
+      printf("  !! A infected subface: (%d, %d, %d).\n", 
+             pointmark(sorg(shloop)), pointmark(sdest(shloop)), 
+             pointmark(sapex(shloop)));
     }
-    totalsmtcount += smtcount;
-
-    if (smtcount == 0l) {
-      // No point has been smoothed. 
-      break;
-    } else {
-      iter++;
-      if (iter == 2) { //if (iter >= b->optpasses) {
-        break;
-      }
+    if (smarktested(shloop)) {
+      // This may be a bug. report it.
+      printf("  !! A marked subface: (%d, %d, %d).\n", pointmark(sorg(shloop)), 
+             pointmark(sdest(shloop)), pointmark(sapex(shloop)));
     }
+    shloop.sh = shellfacetraverse(subfaces);
+  }
 
-    // Swap the two flip queues.
-    swapqueue = flipqueue;
-    flipqueue = unflipqueue;
-    unflipqueue = swapqueue;
-  } // while
+  if (horrors == 0) {
+    if (!b->quiet) {
+      printf("  Mesh boundaries connected correctly.\n");
+    }
+  } else {
+    printf("  !! !! !! !! %d boundary connection viewed with horror.\n",
+           horrors);
+  }
 
-  delete flipqueue;
+  subfaces->pathblock = bakpathblock;
+  subfaces->pathitem = bakpathitem;
+  subfaces->pathitemsleft = bakpathitemsleft;
+  subfaces->alignbytes = bakalignbytes;
 
-  return totalsmtcount;
+  return horrors;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// splitsliver()    Split a sliver.                                          //
+// checksegments()    Check the connections between tetrahedra and segments. //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-int tetgenmesh::splitsliver(triface *slitet, REAL cosd, int chkencflag)
+int tetgenmesh::checksegments()
 {
-  triface *abtets;
-  triface searchtet, spintet, *parytet;
-  point pa, pb, steinerpt;
-  optparameters opm;
-  insertvertexflags ivf;
-  REAL smtpt[3], midpt[3];
-  int success;
+  triface tetloop, neightet, spintet;
+  shellface *segs;
+  face neighsh, spinsh, checksh;
+  face sseg, checkseg;
+  point pa, pb;
+  int miscount;
   int t1ver;
-  int n, i;
+  int horrors, i;
 
-  // 'slitet' is [c,d,a,b], where [c,d] has a big dihedral angle. 
-  // Go to the opposite edge [a,b].
-  edestoppo(*slitet, searchtet); // [a,b,c,d].
 
-  // Do not split a segment.
-  if (issubseg(searchtet)) {
-    return 0; 
+  if (!b->quiet) {
+    printf("  Checking tet->seg connections...\n");
   }
 
-  // Count the number of tets shared at [a,b].
-  // Do not split it if it is a hull edge.
-  spintet = searchtet;
-  n = 0; 
-  while (1) {
-    if (ishulltet(spintet)) break;
-    n++;
-    fnextself(spintet);
-    if (spintet.tet == searchtet.tet) break;
-  }
-  if (ishulltet(spintet)) {
-    return 0; // It is a hull edge.
+  horrors = 0;
+  tetrahedrons->traversalinit();
+  tetloop.tet = tetrahedrontraverse();
+  while (tetloop.tet != NULL) {
+    // Loop the six edges of the tet.
+    if (tetloop.tet[8] != NULL) {
+      segs = (shellface *) tetloop.tet[8];
+      for (i = 0; i < 6; i++) {
+        sdecode(segs[i], sseg);
+        if (sseg.sh != NULL) {
+          // Get the edge of the tet.
+          tetloop.ver = edge2ver[i];
+          // Check if they are the same edge.
+          pa = (point) sseg.sh[3];
+          pb = (point) sseg.sh[4];
+          if (!(((org(tetloop) == pa) && (dest(tetloop) == pb)) ||
+                ((org(tetloop) == pb) && (dest(tetloop) == pa)))) {
+            printf("  !! Wrong tet-seg connection.\n");
+            printf("    Tet: x%lx (%d, %d, %d, %d) - Seg: x%lx (%d, %d).\n", 
+                   (uintptr_t) tetloop.tet, pointmark(org(tetloop)),
+                   pointmark(dest(tetloop)), pointmark(apex(tetloop)),
+                   pointmark(oppo(tetloop)), (uintptr_t) sseg.sh,
+                   pointmark(pa), pointmark(pb));
+            horrors++;
+          } else {
+            // Loop all tets sharing at this edge.
+            neightet = tetloop;
+            do {
+              tsspivot1(neightet, checkseg);
+              if (checkseg.sh != sseg.sh) {
+                printf("  !! Wrong tet->seg connection.\n");
+                printf("    Tet: x%lx (%d, %d, %d, %d) - ", 
+                       (uintptr_t) neightet.tet, pointmark(org(neightet)),
+                       pointmark(dest(neightet)), pointmark(apex(neightet)),
+                       pointmark(oppo(neightet)));
+                if (checkseg.sh != NULL) {
+                  printf("Seg x%lx (%d, %d).\n", (uintptr_t) checkseg.sh,
+                         pointmark(sorg(checkseg)),pointmark(sdest(checkseg))); 
+                } else {
+                  printf("Seg: NULL.\n");
+                }
+                horrors++;
+              }
+              fnextself(neightet);
+            } while (neightet.tet != tetloop.tet);
+          }
+          // Check the seg->tet pointer.
+          sstpivot1(sseg, neightet);
+          if (neightet.tet == NULL) {
+            printf("  !! Wrong seg->tet connection (A NULL tet).\n");
+            horrors++;
+          } else {
+            if (!(((org(neightet) == pa) && (dest(neightet) == pb)) ||
+                ((org(neightet) == pb) && (dest(neightet) == pa)))) {
+              printf("  !! Wrong seg->tet connection (Wrong edge).\n");
+              printf("    Tet: x%lx (%d, %d, %d, %d) - Seg: x%lx (%d, %d).\n", 
+                     (uintptr_t) neightet.tet, pointmark(org(neightet)),
+                     pointmark(dest(neightet)), pointmark(apex(neightet)),
+                     pointmark(oppo(neightet)), (uintptr_t) sseg.sh,
+                     pointmark(pa), pointmark(pb));
+              horrors++;
+            }
+          }
+        }
+      }
+    }
+    // Loop the six edge of this tet.
+    neightet.tet = tetloop.tet;
+    for (i = 0; i < 6; i++) {
+      neightet.ver = edge2ver[i];
+      if (edgemarked(neightet)) {
+        // A possible bug. Report it.
+        printf("  !! A marked edge: (%d, %d, %d, %d) -- x%lx %d.\n",
+               pointmark(org(neightet)), pointmark(dest(neightet)),
+               pointmark(apex(neightet)), pointmark(oppo(neightet)),
+               (uintptr_t) neightet.tet, neightet.ver);
+        // Check if all tets at the edge are marked.
+        spintet = neightet;
+        while (1) {
+          fnextself(spintet);
+          if (!edgemarked(spintet)) {
+            printf("  !! !! An unmarked edge (%d, %d, %d, %d) -- x%lx %d.\n",
+                   pointmark(org(spintet)), pointmark(dest(spintet)),
+                   pointmark(apex(spintet)), pointmark(oppo(spintet)),
+                   (uintptr_t) spintet.tet, spintet.ver);
+            horrors++;
+          }
+          if (spintet.tet == neightet.tet) break;
+        }
+      }
+    }
+    tetloop.tet = tetrahedrontraverse();
   }
 
-  // Get all tets at edge [a,b].
-  abtets = new triface[n];
-  spintet = searchtet;
-  for (i = 0; i < n; i++) {
-    abtets[i] = spintet;
-    fnextself(spintet);
+  if (!b->quiet) {
+    printf("  Checking seg->tet connections...\n");
   }
 
-  // Initialize the list of 2n boundary faces.
-  for (i = 0; i < n; i++) {    
-    eprev(abtets[i], searchtet);
-    esymself(searchtet); // [a,p_i,p_i+1].
-    cavetetlist->newindex((void **) &parytet);
-    *parytet = searchtet;
-    enext(abtets[i], searchtet);
-    esymself(searchtet); // [p_i,b,p_i+1].
-    cavetetlist->newindex((void **) &parytet);
-    *parytet = searchtet;
+  miscount = 0; // Count the number of unrecovered segments.
+  subsegs->traversalinit();
+  sseg.shver = 0;
+  sseg.sh = shellfacetraverse(subsegs);
+  while (sseg.sh != NULL) {
+    pa = sorg(sseg);
+    pb = sdest(sseg);
+    spivot(sseg, neighsh);
+    if (neighsh.sh != NULL) {      
+      spinsh = neighsh;
+      while (1) {
+        // Check seg-subface bond.
+        if (((sorg(spinsh) == pa) && (sdest(spinsh) == pb)) ||
+	    ((sorg(spinsh) == pb) && (sdest(spinsh) == pa))) {
+          // Keep the same rotate direction.
+          //if (sorg(spinsh) != pa) {          
+          //  sesymself(spinsh);
+          //  printf("  !! Wrong ori at subface (%d, %d, %d) -- x%lx %d\n",
+          //         pointmark(sorg(spinsh)), pointmark(sdest(spinsh)),
+          //         pointmark(sapex(spinsh)), (uintptr_t) spinsh.sh,
+          //         spinsh.shver);
+          //  horrors++;
+          //}
+          stpivot(spinsh, spintet);
+          if (spintet.tet != NULL) {
+            // Check if all tets at this segment.
+            while (1) {
+              tsspivot1(spintet, checkseg);
+              if (checkseg.sh == NULL) {
+                printf("  !! !! No seg at tet (%d, %d, %d, %d) -- x%lx %d\n",
+                       pointmark(org(spintet)), pointmark(dest(spintet)),
+                       pointmark(apex(spintet)), pointmark(oppo(spintet)),
+                       (uintptr_t) spintet.tet, spintet.ver);
+                horrors++;
+              }
+              if (checkseg.sh != sseg.sh) {
+                printf("  !! !! Wrong seg (%d, %d) at tet (%d, %d, %d, %d)\n",
+                       pointmark(sorg(checkseg)), pointmark(sdest(checkseg)),
+                       pointmark(org(spintet)), pointmark(dest(spintet)),
+                       pointmark(apex(spintet)), pointmark(oppo(spintet)));
+                horrors++;
+              }
+              fnextself(spintet);
+              // Stop at the next subface.
+              tspivot(spintet, checksh);
+              if (checksh.sh != NULL) break;
+            } // while (1)
+          }
+        } else { 
+          printf("  !! Wrong seg-subface (%d, %d, %d) -- x%lx %d connect\n",
+                 pointmark(sorg(spinsh)), pointmark(sdest(spinsh)),
+                 pointmark(sapex(spinsh)), (uintptr_t) spinsh.sh,
+                 spinsh.shver);
+          horrors++;
+          break;
+        } // if pa, pb
+        spivotself(spinsh);
+        if (spinsh.sh == NULL) break; // A dangling segment.
+        if (spinsh.sh == neighsh.sh) break;
+      } // while (1)
+    } // if (neighsh.sh != NULL)
+    // Count the number of "un-recovered" segments.
+    sstpivot1(sseg, neightet);
+    if (neightet.tet == NULL) {
+      miscount++;
+    }
+    sseg.sh = shellfacetraverse(subsegs);
   }
 
-  // Init the Steiner point at the midpoint of edge [a,b].
-  pa = org(abtets[0]);
-  pb = dest(abtets[0]);
-  for (i = 0; i < 3; i++) {
-    smtpt[i] = midpt[i] = 0.5 * (pa[i] + pb[i]);
+  if (!b->quiet) {
+    printf("  Checking seg->seg connections...\n");
   }
 
-  // Point smooth options.
-  opm.min_max_dihedangle = 1;
-  opm.initval = cosd + 1.0; // Initial volume is zero.
-  opm.numofsearchdirs = 20;
-  opm.searchstep = 0.001;  
-  opm.maxiter = 100; // Limit the maximum iterations.
-
-  success = smoothpoint(smtpt, cavetetlist, 1, &opm);
-
-  if (success) {
-    while (opm.smthiter == opm.maxiter) {
-      // It was relocated and the prescribed maximum iteration reached. 
-      // Try to increase the search stepsize.
-      opm.searchstep *= 10.0;
-      //opm.maxiter = 100; // Limit the maximum iterations.
-      opm.initval = opm.imprval;
-      opm.smthiter = 0; // Init.
-      smoothpoint(smtpt, cavetetlist, 1, &opm);  
+  points->traversalinit();
+  pa = pointtraverse();
+  while (pa != NULL) {
+    if (pointtype(pa) == FREESEGVERTEX) {
+      // There should be two subsegments connected at 'pa'.
+      // Get a subsegment containing 'pa'.
+      sdecode(point2sh(pa), sseg);
+      if ((sseg.sh == NULL) || sseg.sh[3] == NULL) {
+        printf("  !! Dead point-to-seg pointer at point %d.\n",
+               pointmark(pa));
+        horrors++;
+      } else {
+        sseg.shver = 0;
+        if (sorg(sseg) != pa) {
+          if (sdest(sseg) != pa) {
+            printf("  !! Wrong point-to-seg pointer at point %d.\n",
+                   pointmark(pa));
+            horrors++;
+          } else {
+            // Find the next subsegment at 'pa'.
+            senext(sseg, checkseg);
+            if ((checkseg.sh == NULL) || (checkseg.sh[3] == NULL)) {
+              printf("  !! Dead seg-seg connection at point %d.\n",
+                     pointmark(pa));
+              horrors++;
+            } else {
+              spivotself(checkseg);
+              checkseg.shver = 0;
+              if (sorg(checkseg) != pa) {
+                printf("  !! Wrong seg-seg connection at point %d.\n",
+                     pointmark(pa));
+                horrors++;
+              }
+            }
+          }
+        } else {
+          // Find the previous subsegment at 'pa'.
+          senext2(sseg, checkseg);
+          if ((checkseg.sh == NULL) || (checkseg.sh[3] == NULL)) {
+            printf("  !! Dead seg-seg connection at point %d.\n",
+                   pointmark(pa));
+            horrors++;
+          } else {
+            spivotself(checkseg);
+            checkseg.shver = 0;
+            if (sdest(checkseg) != pa) {
+              printf("  !! Wrong seg-seg connection at point %d.\n",
+                     pointmark(pa));
+              horrors++;
+            }
+          }
+        }
+      }
     }
-  } // if (success)
-
-  cavetetlist->restart();
-
-  if (!success) {
-    delete [] abtets;
-    return 0;
+    pa = pointtraverse();
   }
 
-
-  // Insert the Steiner point.
-  makepoint(&steinerpt, FREEVOLVERTEX);
-  for (i = 0; i < 3; i++) steinerpt[i] = smtpt[i];
-
-  // Insert the created Steiner point.
-  for (i = 0; i < n; i++) {
-    infect(abtets[i]);
-    caveoldtetlist->newindex((void **) &parytet);
-    *parytet = abtets[i];
+  if (horrors == 0) {
+    printf("  Segments are connected properly.\n");
+  } else {
+    printf("  !! !! !! !! Found %d missing connections.\n", horrors);
   }
-
-  searchtet = abtets[0]; // No need point location.
-  if (b->metric) {
-    locate(steinerpt, &searchtet); // For size interpolation.
+  if (miscount > 0) {
+    printf("  !! !! Found %d missing segments.\n", miscount);
   }
 
-  delete [] abtets;
-
-  ivf.iloc = (int) INSTAR;
-  ivf.chkencflag = chkencflag;
-  ivf.assignmeshsize = b->metric; 
-
-
-  if (insertpoint(steinerpt, &searchtet, NULL, NULL, &ivf)) {
-    // The vertex has been inserted.
-    st_volref_count++; 
-    if (steinerleft > 0) steinerleft--;
-    return 1;
-  } else {
-    // The Steiner point is too close to an existing vertex. Reject it.
-    pointdealloc(steinerpt);
-    return 0;
-  }
+  return horrors;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// removeslivers()    Remove slivers by adding Steiner points.               //
+// checkregularfaces()    Test the interior faces of the mesh for the local  //
+//                        Delaunay (or regular) property.                    //
+//                                                                           //
+// 'type' is the same as in checkregular().  The tetrahedra are collected in //
+// an array and tested in parallel if TetGen is compiled with OpenMP.  Each  //
+// interior face is tested once (by the tet with the smaller address).       //
+//                                                                           //
+// The number of failing faces is returned in 'ndcount'.  The failing faces  //
+// which are not subfaces (i.e., not constrained) are saved in 'facelist'    //
+// (if it is not NULL) in the traversal order of the tetrahedra, as five     //
+// points each: the three vertices of the face and the two opposite vertices //
+// of its tetrahedra.  Return the number of the saved faces.                 //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-long tetgenmesh::removeslivers(int chkencflag)
+int tetgenmesh::checkregularfaces(int type, int *ndcount, arraypool *facelist)
 {
-  arraypool *flipqueue, *swapqueue;
-  badface *bface, *parybface;
-  triface slitet, *parytet;
-  point *ppt;
-  REAL cosdd[6], maxcosd;
-  long totalsptcount, sptcount;
-  int iter, i, j, k;
-
-  //assert(unflipqueue->objects > 0l);
-  flipqueue = new arraypool(sizeof(badface), 10);
-
-  // Swap the two flip queues.
-  swapqueue = flipqueue;
-  flipqueue = unflipqueue;
-  unflipqueue = swapqueue;
-
-  totalsptcount = 0l;
-  iter = 0;
-
-  while ((flipqueue->objects > 0l) && (steinerleft != 0)) {
-
-    sptcount = 0l;
+  tetrahedron **tetarray;
+  unsigned char *facemasks;
+  triface tetloop, symtet;
+  face checksh;
+  point p[5], *parypt;
+  REAL sign;
+  int ntets, tindex, count, horrors, mask;
 
-    if (b->verbose > 1) {
-      printf("    Splitting bad quality tets [%d]#:  %ld.\n",
-             iter, flipqueue->objects);
-    }
+  // Collect the tetrahedra.
+  tetarray = new tetrahedron*[tetrahedrons->items];
+  ntets = 0;
+  tetrahedrons->traversalinit();
+  tetloop.tet = tetrahedrontraverse();
+  while (tetloop.tet != (tetrahedron *) NULL) {
+    tetarray[ntets++] = tetloop.tet;
+    tetloop.tet = tetrahedrontraverse();
+  }
 
-    for (k = 0; (k < flipqueue->objects) && (steinerleft != 0); k++) {      
-      bface  = (badface *) fastlookup(flipqueue, k);
-      if (gettetrahedron(bface->forg, bface->fdest, bface->fapex,
-                         bface->foppo, &bface->tt)) {
-        if ((bface->key == 0) || (bface->tt.ver != 11)) {
-          // Here we need to re-compute the quality. Since other smoothing
-          //   operation may have moved the vertices of this tet.
-          ppt = (point *) & (bface->tt.tet[4]);
-          tetalldihedral(ppt[0], ppt[1], ppt[2], ppt[3], bface->cent, 
-                         &bface->key, NULL);
-        }
-        if (bface->key < cosslidihed) { 
-          // It is a sliver. Try to split it.
-          slitet.tet = bface->tt.tet;
-          //cosdd = bface->cent;
-          for (j = 0; j < 6; j++) {
-            if (bface->cent[j] < cosslidihed) { 
-              // Found a large dihedral angle.
-              slitet.ver = edge2ver[j]; // Go to the edge.
-              if (splitsliver(&slitet, bface->cent[j], chkencflag)) {
-                sptcount++;
-                break;
-              }
-            }
-          } // j
-          if (j < 6) {
-            // A sliver is split. Queue new slivers.
-            badtetrahedrons->traversalinit();
-            parytet = (triface *) badtetrahedrons->traverse();
-            while (parytet != NULL) {
-              unmarktest2(*parytet);
-              ppt = (point *) & (parytet->tet[4]);
-              tetalldihedral(ppt[0], ppt[1], ppt[2], ppt[3], cosdd, 
-                             &maxcosd, NULL);
-              if (maxcosd < cosslidihed) {
-                // A new sliver. Queue it.
-                unflipqueue->newindex((void **) &parybface);
-                parybface->forg = ppt[0];
-                parybface->fdest = ppt[1];
-                parybface->fapex = ppt[2];
-                parybface->foppo = ppt[3];
-                parybface->tt.tet = parytet->tet;
-                parybface->tt.ver = 11;
-                parybface->key = maxcosd;
-                for (i = 0; i < 6; i++) {
-                  parybface->cent[i] = cosdd[i];
-                }
-              }
-              parytet = (triface *) badtetrahedrons->traverse();
-            }
-            badtetrahedrons->restart();
-          } else {
-            // Didn't split. Queue it again.
-            unflipqueue->newindex((void **) &parybface);
-            *parybface = *bface;
-          } // if (j == 6)
-        } // if (bface->key < cosslidihed)
-      } // if (gettetrahedron(...))
-    } // k
+  // Test the faces (in parallel).  The failing unconstrained faces of the 
+  //   i-th tet are marked by the bits of 'facemasks[i]'.
+  facemasks = new unsigned char[ntets];
+  count = 0;
+#ifdef _OPENMP
+  #pragma omp parallel for private(tetloop, symtet, checksh, p, sign, mask) \
+                           reduction(+:count)
+#endif
+  for (tindex = 0; tindex < ntets; tindex++) {
+    tetloop.tet = tetarray[tindex];
+    mask = 0;
+    for (tetloop.ver = 0; tetloop.ver < 4; tetloop.ver++) {
+      fsym(tetloop, symtet);
+      // Only do test if its adjoining tet is not a hull tet or its pointer
+      //   is larger (to ensure that each pair isn't tested twice).
+      if (((point) symtet.tet[7] != dummypoint)&&(tetloop.tet < symtet.tet)) {
+        p[0] = org(tetloop);   // pa
+        p[1] = dest(tetloop);  // pb
+        p[2] = apex(tetloop);  // pc
+        p[3] = oppo(tetloop);  // pd
+        p[4] = oppo(symtet);   // pe
 
-    flipqueue->restart();
+        if (type == 0) {
+          sign = insphere(p[1], p[0], p[2], p[3], p[4]);
+        } else if (type == 1) {
+          sign = insphere_s(p[1], p[0], p[2], p[3], p[4]);
+        } else if (type == 2) {
+          sign = orient4d(p[1],    p[0],    p[2],    p[3],    p[4], 
+                          p[1][3], p[0][3], p[2][3], p[3][3], p[4][3]);
+        } else { // type == 3
+          sign = orient4d_s(p[1],    p[0],    p[2],    p[3],    p[4], 
+                            p[1][3], p[0][3], p[2][3], p[3][3], p[4][3]);
+        }
 
-    if (b->verbose > 1) {
-      printf("    Split %ld tets.\n", sptcount);
+        if (sign > 0.0) {
+          count++;
+          checksh.sh = NULL;
+          if (checksubfaceflag) {
+            tspivot(tetloop, checksh);
+          }
+          if (checksh.sh == NULL) {
+            mask |= (1 << tetloop.ver);
+          }
+        }
+      }
     }
-    totalsptcount += sptcount;
+    facemasks[tindex] = (unsigned char) mask;
+  }
 
-    if (sptcount == 0l) {
-      // No point has been smoothed. 
-      break;
-    } else {
-      iter++;
-      if (iter == 2) { //if (iter >= b->optpasses) {
-        break;
+  // Save the unconstrained failing faces.
+  horrors = 0;
+  for (tindex = 0; tindex < ntets; tindex++) {
+    if (facemasks[tindex] == 0) continue;
+    tetloop.tet = tetarray[tindex];
+    for (tetloop.ver = 0; tetloop.ver < 4; tetloop.ver++) {
+      if ((facemasks[tindex] & (1 << tetloop.ver)) == 0) continue;
+      horrors++;
+      if (facelist != (arraypool *) NULL) {
+        fsym(tetloop, symtet);
+        facelist->newindex((void **) &parypt);
+        parypt[0] = org(tetloop);
+        parypt[1] = dest(tetloop);
+        parypt[2] = apex(tetloop);
+        parypt[3] = oppo(tetloop);
+        parypt[4] = oppo(symtet);
       }
     }
+  }
 
-    // Swap the two flip queues.
-    swapqueue = flipqueue;
-    flipqueue = unflipqueue;
-    unflipqueue = swapqueue;
-  } // while
-
-  delete flipqueue;
+  delete [] facemasks;
+  delete [] tetarray;
 
-  return totalsptcount;
+  if (ndcount != (int *) NULL) {
+    *ndcount = count;
+  }
+  return horrors;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// optimizemesh()    Optimize mesh for specified objective functions.        //
+// outnonregularfaces()    Output the faces found by checkregularfaces().    //
+//                                                                           //
+// The faces are printed if -V is used.  If 'out' is not NULL, they are      //
+// saved in its 'nonregularfacelist' by the indices of their vertices.       //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-void tetgenmesh::optimizemesh()
+void tetgenmesh::outnonregularfaces(arraypool *facelist, const char *name,
+                                    tetgenio *out)
 {
-  badface *parybface;
-  triface checktet;
-  point *ppt;
-  int optpasses;
-  optparameters opm;
-  REAL ncosdd[6], maxdd;
-  long totalremcount, remcount;
-  long totalsmtcount, smtcount;
-  long totalsptcount, sptcount;
-  int chkencflag;
-  int iter;
-  int n;
-
-  if (!b->quiet) {
-    printf("Optimizing mesh...\n");
-  }
-
-  optpasses = ((1 << b->optlevel) - 1);
+  point *parypt;
+  int i, j;
 
   if (b->verbose) {
-    printf("  Optimization level  = %d.\n", b->optlevel);
-    printf("  Optimization scheme = %d.\n", b->optscheme);
-    printf("  Number of iteration = %d.\n", optpasses);
-    printf("  Min_Max dihed angle = %g.\n", b->optmaxdihedral);
+    for (i = 0; i < facelist->objects; i++) {
+      parypt = (point *) fastlookup(facelist, i);
+      printf("  !! Non-locally %s (%d, %d, %d) - %d, %d\n", name,
+             pointmark(parypt[0]), pointmark(parypt[1]), pointmark(parypt[2]),
+             pointmark(parypt[3]), pointmark(parypt[4]));
+    }
   }
 
-  totalsmtcount = totalsptcount = totalremcount = 0l;
-
-  cosmaxdihed = cos(b->optmaxdihedral / 180.0 * PI);
-  cossmtdihed = cos(b->optminsmtdihed / 180.0 * PI);
-  cosslidihed = cos(b->optminslidihed / 180.0 * PI);
-
-  int attrnum = numelemattrib - 1; 
-
-  // Put all bad tetrahedra into array.
-  tetrahedrons->traversalinit();
-  checktet.tet = tetrahedrontraverse();
-  while (checktet.tet != NULL) {
-    if (b->convex) { // -c
-      // Skip this tet if it lies in the exterior.
-      if (elemattribute(checktet.tet, attrnum) == -1.0) {
-        checktet.tet = tetrahedrontraverse();
-        continue;
-      }
+  if (out != (tetgenio *) NULL) {
+    if (out->nonregularfacelist != (int *) NULL) {
+      delete [] out->nonregularfacelist;
     }
-    ppt = (point *) & (checktet.tet[4]);
-    tetalldihedral(ppt[0], ppt[1], ppt[2], ppt[3], ncosdd, &maxdd, NULL);
-    if (maxdd < cosmaxdihed) {
-      // There are bad dihedral angles in this tet.
-      unflipqueue->newindex((void **) &parybface); 
-      parybface->tt.tet = checktet.tet;
-      parybface->tt.ver = 11;
-      parybface->forg = ppt[0];
-      parybface->fdest = ppt[1];
-      parybface->fapex = ppt[2];
-      parybface->foppo = ppt[3];
-      parybface->key = maxdd;
-      for (n = 0; n < 6; n++) {
-        parybface->cent[n] = ncosdd[n];
+    out->nonregularfacelist = (int *) NULL;
+    out->numberofnonregularfaces = (int) facelist->objects;
+    if (facelist->objects > 0) {
+      out->nonregularfacelist = new int[facelist->objects * 5];
+      for (i = 0; i < facelist->objects; i++) {
+        parypt = (point *) fastlookup(facelist, i);
+        for (j = 0; j < 5; j++) {
+          out->nonregularfacelist[i * 5 + j] = pointmark(parypt[j]);
+        }
       }
     }
-    checktet.tet = tetrahedrontraverse();
   }
+}
 
-  totalremcount = improvequalitybyflips();
-
-  if ((unflipqueue->objects > 0l) && 
-      ((b->optscheme & 2) || (b->optscheme & 4))) {
-    // The pool is only used by removeslivers().
-    badtetrahedrons = new memorypool(sizeof(triface), b->tetrahedraperblock,
-                                     sizeof(void *), 0);
-
-    // Smoothing options.
-    opm.min_max_dihedangle = 1;
-    opm.numofsearchdirs = 10;
-    // opm.searchstep = 0.001;  
-    opm.maxiter = 30; // Limit the maximum iterations.
-    //opm.checkencflag = 4; // Queue affected tets after smoothing.
-    chkencflag = 4; // Queue affected tets after splitting a sliver.
-    iter = 0;
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// checkdelaunay()    Ensure that the mesh is (constrained) Delaunay.        //
+//                                                                           //
+// The non-Delaunay faces are saved in 'out' if it is not NULL.              //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
 
-    while (iter < optpasses) {
-      smtcount = sptcount = remcount = 0l;
-      if (b->optscheme & 2) {
-        smtcount += improvequalitybysmoothing(&opm);
-        totalsmtcount += smtcount;
-        if (smtcount > 0l) {
-          remcount = improvequalitybyflips();
-          totalremcount += remcount;
-        }
-      }
-      if (unflipqueue->objects > 0l) {
-        if (b->optscheme & 4) {
-          sptcount += removeslivers(chkencflag);
-          totalsptcount += sptcount;
-          if (sptcount > 0l) {
-            remcount = improvequalitybyflips();
-            totalremcount += remcount;
-          }
-        }
-      }
-      if (unflipqueue->objects > 0l) {
-        if (remcount > 0l) {
-          iter++;
-        } else {
-          break;
-        }
-      } else {
-        break;
-      }
-    } // while (iter)
+int tetgenmesh::checkdelaunay(int perturb, tetgenio *out)
+{
+  arraypool *facelist;
+  int ndcount; // Count the non-locally Delaunay faces.
+  int horrors;
 
-    delete badtetrahedrons;
-    badtetrahedrons = NULL;
+  if (!b->quiet) {
+    printf("  Checking Delaunay property of the mesh...\n");
   }
 
-  if (unflipqueue->objects > 0l) {
-    if (b->verbose > 1) {
-      printf("    %ld bad tets remained.\n", unflipqueue->objects);
-    }
-    unflipqueue->restart();
-  }
+  facelist = new arraypool(5 * sizeof(point), 8);
+  horrors = checkregularfaces(perturb ? 1 : 0, &ndcount, facelist);
+  outnonregularfaces(facelist, "Delaunay", out);
+  delete facelist;
 
-  if (b->verbose) {
-    if (totalremcount > 0l) {
-      printf("  Removed %ld edges.\n", totalremcount);
-    }
-    if (totalsmtcount > 0l) {
-      printf("  Smoothed %ld points.\n", totalsmtcount);
-    }
-    if (totalsptcount > 0l) {
-      printf("  Split %ld slivers.\n", totalsptcount);
+  if (horrors == 0) {
+    if (!b->quiet) {
+      if (ndcount > 0) {
+        printf("  The mesh is constrained Delaunay.\n");
+      } else {
+        printf("  The mesh is Delaunay.\n");
+      } 
     }
+  } else {
+    printf("  !! !! !! !! Found %d non-Delaunay faces.\n", horrors);
   }
-}
-
-////                                                                       ////
-////                                                                       ////
-//// optimize_cxx /////////////////////////////////////////////////////////////
 
-//// meshstat_cxx /////////////////////////////////////////////////////////////
-////                                                                       ////
-////                                                                       ////
+  return horrors;
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// printfcomma()    Print a (large) number with the 'thousands separator'.   // 
+// Check if the current tetrahedralization is (constrained) regular.         //
 //                                                                           //
-// The following code was simply copied from "stackoverflow".                //
+// The parameter 'type' determines which regularity should be checked:       //
+//   - 0:  check the Delaunay property.                                      //
+//   - 1:  check the Delaunay property with symbolic perturbation.           //
+//   - 2:  check the regular property, the weights are stored in p[3].       //
+//   - 3:  check the regular property with symbolic perturbation.            //
+//                                                                           //
+// The non-regular faces are saved in 'out' if it is not NULL.               //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-void tetgenmesh::printfcomma(unsigned long n)
+int tetgenmesh::checkregular(int type, tetgenio *out)
 {
-  unsigned long n2 = 0;
-  int scale = 1;
-  while (n >= 1000) {
-    n2 = n2 + scale * (n % 1000);
-    n /= 1000;
-    scale *= 1000;
+  arraypool *facelist;
+  int ndcount; // Count the non-locally Delaunay faces.
+  int horrors;
+
+  if (!b->quiet) {
+    printf("  Checking %s %s property of the mesh...\n",
+           (type & 2) == 0 ? "Delaunay" : "regular",
+           (type & 1) == 0 ? " " : "(s)");
   }
-  printf ("%ld", n);
-  while (scale != 1) {
-    scale /= 1000;
-    n = n2 / scale;
-    n2 = n2  % scale;
-    printf (",%03ld", n);
+
+  // Make sure orient3d(p[1], p[0], p[2], p[3]) > 0;
+  //   Hence if (insphere(p[1], p[0], p[2], p[3], p[4]) > 0) means that
+  //     p[4] lies inside the circumsphere of p[1], p[0], p[2], p[3].
+  //   The same if orient4d(p[1], p[0], p[2], p[3], p[4]) > 0 means that
+  //     p[4] lies below the oriented hyperplane passing through 
+  //     p[1], p[0], p[2], p[3].
+
+  facelist = new arraypool(5 * sizeof(point), 8);
+  horrors = checkregularfaces(type, &ndcount, facelist);
+  outnonregularfaces(facelist, (type & 2) == 0 ? "Delaunay" : "regular", out);
+  delete facelist;
+
+  if (horrors == 0) {
+    if (!b->quiet) {
+      if (ndcount > 0) {
+        printf("  The mesh is constrained %s.\n",
+               (type & 2) == 0 ? "Delaunay" : "regular");
+      } else {
+        printf("  The mesh is %s.\n", (type & 2) == 0 ? "Delaunay" : "regular");
+      } 
+    }
+  } else {
+    printf("  !! !! !! !! Found %d non-%s faces.\n", horrors,
+           (type & 2) == 0 ? "Delaunay" : "regular");
   }
+
+  return horrors;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// checkmesh()    Test the mesh for topological consistency.                 //
+// checkconforming()    Ensure that the mesh is conforming Delaunay.         //
 //                                                                           //
-// If 'topoflag' is set, only check the topological connection of the mesh,  //
-// i.e., do not report degenerated or inverted elements.                     //
+// If 'flag' is 1, only check subsegments. If 'flag' is 2, check subfaces.   //
+// If 'flag' is 3, check both subsegments and subfaces.                      //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-int tetgenmesh::checkmesh(int topoflag)
+int tetgenmesh::checkconforming(int flag)
 {
-  triface tetloop, neightet, symtet;
-  point pa, pb, pc, pd;
-  REAL ori;
-  int horrors, i;
+  triface searchtet, neightet, spintet;
+  face shloop;
+  face segloop;
+  point eorg, edest, eapex, pa, pb, pc;
+  REAL cent[3], radius, dist, diff, rd, len;
+  bool enq;
+  int encsubsegs, encsubfaces;
+  int t1ver; 
+  int i;
 
-  if (!b->quiet) {
-    printf("  Checking consistency of mesh...\n");
-  }
+  REAL A[4][4], rhs[4], D;
+  int indx[4];
+  REAL elen[3];
 
-  horrors = 0;
-  tetloop.ver = 0;
-  // Run through the list of tetrahedra, checking each one.
-  tetrahedrons->traversalinit();
-  tetloop.tet = alltetrahedrontraverse();
-  while (tetloop.tet != (tetrahedron *) NULL) {
-    // Check all four faces of the tetrahedron.
-    for (tetloop.ver = 0; tetloop.ver < 4; tetloop.ver++) {
-      pa = org(tetloop);
-      pb = dest(tetloop);
-      pc = apex(tetloop);
-      pd = oppo(tetloop);
-      if (tetloop.ver == 0) {  // Only test for inversion once.
-        if (!ishulltet(tetloop)) {  // Only do test if it is not a hull tet.
-          if (!topoflag) {
-            ori = orient3d(pa, pb, pc, pd);
-            if (ori >= 0.0) {
-              printf("  !! !! %s ", ori > 0.0 ? "Inverted" : "Degenerated");
-              printf("  (%d, %d, %d, %d) (ori = %.17g)\n", pointmark(pa),
-                     pointmark(pb), pointmark(pc), pointmark(pd), ori);
-              horrors++;
+  encsubsegs = 0;
+
+  if (flag & 1) {
+    if (!b->quiet) {
+      printf("  Checking conforming property of segments...\n");
+    }
+    encsubsegs = 0;
+
+    // Run through the list of subsegments, check each one.
+    subsegs->traversalinit();
+    segloop.sh = shellfacetraverse(subsegs);
+    while (segloop.sh != (shellface *) NULL) {
+      eorg = (point) segloop.sh[3];
+      edest = (point) segloop.sh[4];
+      radius = 0.5 * distance(eorg, edest);
+      for (i = 0; i < 3; i++) cent[i] = 0.5 * (eorg[i] + edest[i]);
+
+      enq = false;
+      sstpivot1(segloop, neightet);
+      if (neightet.tet != NULL) {
+        spintet = neightet;
+        while (1) {
+          eapex= apex(spintet);
+          if (eapex != dummypoint) {
+            dist = distance(eapex, cent);
+            diff = dist - radius;
+            if (fabs(diff) / radius <= b->epsilon) diff = 0.0; // Rounding.
+            if (diff < 0) {
+              enq = true; break;
             }
           }
-        }
-        if (infected(tetloop)) { 
-          // This may be a bug. Report it.
-          printf("  !! (%d, %d, %d, %d) is infected.\n", pointmark(pa),
-                 pointmark(pb), pointmark(pc), pointmark(pd));
-          horrors++;
-        }
-        if (marktested(tetloop)) {
-          // This may be a bug. Report it.
-          printf("  !! (%d, %d, %d, %d) is marked.\n", pointmark(pa),
-                 pointmark(pb), pointmark(pc), pointmark(pd));
-          horrors++;
+          fnextself(spintet);
+          if (spintet.tet == neightet.tet) break;
         }
       }
-      if (tetloop.tet[tetloop.ver] == NULL) {
-        printf("  !! !! No neighbor at face (%d, %d, %d).\n", pointmark(pa),
-               pointmark(pb), pointmark(pc));
-        horrors++;
-      } else {
-        // Find the neighboring tetrahedron on this face.
-        fsym(tetloop, neightet);
-        if (neightet.tet != NULL) {
-          // Check that the tetrahedron's neighbor knows it's a neighbor.
-          fsym(neightet, symtet);
-          if ((tetloop.tet != symtet.tet) || (tetloop.ver != symtet.ver)) {
-            printf("  !! !! Asymmetric tetra-tetra bond:\n");
-            if (tetloop.tet == symtet.tet) {
-              printf("   (Right tetrahedron, wrong orientation)\n");
+      if (enq) {
+        printf("  !! !! Non-conforming segment: (%d, %d)\n",
+               pointmark(eorg), pointmark(edest));
+        encsubsegs++;
+      }
+      segloop.sh = shellfacetraverse(subsegs);
+    }
+
+    if (encsubsegs == 0) {
+      if (!b->quiet) {
+        printf("  The segments are conforming Delaunay.\n");
+      }
+    } else {
+      printf("  !! !! %d subsegments are non-conforming.\n", encsubsegs);
+    }
+  } // if (flag & 1)
+
+  encsubfaces = 0;
+
+  if (flag & 2) {
+    if (!b->quiet) {
+      printf("  Checking conforming property of subfaces...\n");
+    }
+
+    // Run through the list of subfaces, check each one.
+    subfaces->traversalinit();
+    shloop.sh = shellfacetraverse(subfaces);
+    while (shloop.sh != (shellface *) NULL) {
+      pa = (point) shloop.sh[3];
+      pb = (point) shloop.sh[4];
+      pc = (point) shloop.sh[5];
+
+      // Compute the coefficient matrix A (3x3).
+      A[0][0] = pb[0] - pa[0];
+      A[0][1] = pb[1] - pa[1];
+      A[0][2] = pb[2] - pa[2]; // vector V1 (pa->pb)
+      A[1][0] = pc[0] - pa[0];
+      A[1][1] = pc[1] - pa[1];
+      A[1][2] = pc[2] - pa[2]; // vector V2 (pa->pc)
+      cross(A[0], A[1], A[2]); // vector V3 (V1 X V2)
+
+      // Compute the right hand side vector b (3x1).
+      elen[0] = dot(A[0], A[0]);
+      elen[1] = dot(A[1], A[1]);
+      rhs[0] = 0.5 * elen[0];
+      rhs[1] = 0.5 * elen[1];
+      rhs[2] = 0.0;
+
+      if (lu_decmp(A, 3, indx, &D, 0)) {
+        lu_solve(A, 3, indx, rhs, 0);
+        cent[0] = pa[0] + rhs[0];
+        cent[1] = pa[1] + rhs[1];
+        cent[2] = pa[2] + rhs[2];
+        rd = sqrt(rhs[0] * rhs[0] + rhs[1] * rhs[1] + rhs[2] * rhs[2]);
+
+        // Check if this subface is encroached.
+        for (i = 0; i < 2; i++) {
+          stpivot(shloop, searchtet);
+          if (!ishulltet(searchtet)) {
+            len = distance(oppo(searchtet), cent);
+            if ((fabs(len - rd) / rd) < b->epsilon) len = rd; // Rounding.
+            if (len < rd) {
+              printf("  !! !! Non-conforming subface: (%d, %d, %d)\n",
+                     pointmark(pa), pointmark(pb), pointmark(pc));
+              encsubfaces++;
+              enq = true; break;
             }
-            printf("    First:  (%d, %d, %d, %d)\n", pointmark(pa),
-                   pointmark(pb), pointmark(pc), pointmark(pd));
-            printf("    Second: (%d, %d, %d, %d)\n", pointmark(org(neightet)),
-                   pointmark(dest(neightet)), pointmark(apex(neightet)),
-                   pointmark(oppo(neightet)));
-            horrors++;
-          }
-          // Check if they have the same edge (the bond() operation).
-          if ((org(neightet) != pb) || (dest(neightet) != pa)) {
-            printf("  !! !! Wrong edge-edge bond:\n");
-            printf("    First:  (%d, %d, %d, %d)\n", pointmark(pa),
-                   pointmark(pb), pointmark(pc), pointmark(pd));
-            printf("    Second: (%d, %d, %d, %d)\n", pointmark(org(neightet)),
-                   pointmark(dest(neightet)), pointmark(apex(neightet)),
-                   pointmark(oppo(neightet)));
-            horrors++;
-          }
-          // Check if they have the same apex.
-          if (apex(neightet) != pc) {
-            printf("  !! !! Wrong face-face bond:\n");
-            printf("    First:  (%d, %d, %d, %d)\n", pointmark(pa),
-                   pointmark(pb), pointmark(pc), pointmark(pd));
-            printf("    Second: (%d, %d, %d, %d)\n", pointmark(org(neightet)),
-                   pointmark(dest(neightet)), pointmark(apex(neightet)),
-                   pointmark(oppo(neightet)));
-            horrors++;
-          }
-          // Check if they have the same opposite.
-          if (oppo(neightet) == pd) {
-            printf("  !! !! Two identical tetra:\n");
-            printf("    First:  (%d, %d, %d, %d)\n", pointmark(pa),
-                   pointmark(pb), pointmark(pc), pointmark(pd));
-            printf("    Second: (%d, %d, %d, %d)\n", pointmark(org(neightet)),
-                   pointmark(dest(neightet)), pointmark(apex(neightet)),
-                   pointmark(oppo(neightet)));
-            horrors++;
           }
-        } else {
-          printf("  !! !! Tet-face has no neighbor (%d, %d, %d) - %d:\n",
-                 pointmark(pa), pointmark(pb), pointmark(pc), pointmark(pd));
-          horrors++;
+          sesymself(shloop);
         }
       }
-      if (facemarked(tetloop)) {
-        // This may be a bug. Report it.
-        printf("  !! tetface (%d, %d, %d) %d is marked.\n", pointmark(pa),
-               pointmark(pb), pointmark(pc), pointmark(pd));
+      shloop.sh = shellfacetraverse(subfaces);
+    }
+
+    if (encsubfaces == 0) {
+      if (!b->quiet) {
+        printf("  The subfaces are conforming Delaunay.\n");
       }
+    } else {
+      printf("  !! !! %d subfaces are non-conforming.\n", encsubfaces);
     }
-    // Check the six edges of this tet.
-    for (i = 0; i < 6; i++) {
-      tetloop.ver = edge2ver[i];
-      if (edgemarked(tetloop)) {
-        // This may be a bug. Report it.
-        printf("  !! tetedge (%d, %d) %d, %d is marked.\n", 
-               pointmark(org(tetloop)), pointmark(dest(tetloop)), 
-               pointmark(apex(tetloop)), pointmark(oppo(tetloop)));
+  } // if (flag & 2)
+
+  return encsubsegs + encsubfaces;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// qualitystatistics()    Print statistics about the quality of the mesh.    //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+void tetgenmesh::qualitystatistics()
+{
+  triface tetloop, neightet;
+  point p[4];
+  char sbuf[128];
+  REAL radiusratiotable[12];
+  REAL aspectratiotable[12];
+  REAL A[4][4], rhs[4], D;
+  REAL V[6][3], N[4][3], H[4]; // edge-vectors, face-normals, face-heights.
+  REAL edgelength[6], alldihed[6], faceangle[3];
+  REAL shortest, longest;
+  REAL smallestvolume, biggestvolume;
+  REAL smallestratio, biggestratio;
+  REAL smallestdiangle, biggestdiangle;
+  REAL smallestfaangle, biggestfaangle;
+  REAL total_tet_vol, total_tetprism_vol;
+  REAL tetvol, minaltitude;
+  REAL cirradius, minheightinv; // insradius;
+  REAL shortlen, longlen;
+  REAL tetaspect, tetradius;
+  REAL smalldiangle, bigdiangle;
+  REAL smallfaangle, bigfaangle;
+  unsigned long radiustable[12];
+  unsigned long aspecttable[16];
+  unsigned long dihedangletable[18];
+  unsigned long faceangletable[18];
+  int indx[4];
+  int radiusindex;
+  int aspectindex;
+  int tendegree;
+  int i, j;
+
+  printf("Mesh quality statistics:\n\n");
+
+  shortlen = longlen = 0.0;
+  smalldiangle = bigdiangle = 0.0;
+  total_tet_vol = 0.0;
+  total_tetprism_vol = 0.0;
+
+  radiusratiotable[0]  =    0.707;    radiusratiotable[1]  =     1.0;
+  radiusratiotable[2]  =      1.1;    radiusratiotable[3]  =     1.2;
+  radiusratiotable[4]  =      1.4;    radiusratiotable[5]  =     1.6;
+  radiusratiotable[6]  =      1.8;    radiusratiotable[7]  =     2.0;
+  radiusratiotable[8]  =      2.5;    radiusratiotable[9]  =     3.0;
+  radiusratiotable[10] =     10.0;    radiusratiotable[11] =     0.0;
+
+  aspectratiotable[0]  =      1.5;    aspectratiotable[1]  =     2.0;
+  aspectratiotable[2]  =      2.5;    aspectratiotable[3]  =     3.0;
+  aspectratiotable[4]  =      4.0;    aspectratiotable[5]  =     6.0;
+  aspectratiotable[6]  =     10.0;    aspectratiotable[7]  =    15.0;
+  aspectratiotable[8]  =     25.0;    aspectratiotable[9]  =    50.0;
+  aspectratiotable[10] =    100.0;    aspectratiotable[11] =     0.0;
+  
+  for (i = 0; i < 12; i++) radiustable[i] = 0l;
+  for (i = 0; i < 12; i++) aspecttable[i] = 0l;
+  for (i = 0; i < 18; i++) dihedangletable[i] = 0l;
+  for (i = 0; i < 18; i++) faceangletable[i] = 0l;
+
+  minaltitude = xmax - xmin + ymax - ymin + zmax - zmin;
+  minaltitude = minaltitude * minaltitude;
+  shortest = minaltitude;
+  longest = 0.0;
+  smallestvolume = minaltitude;
+  biggestvolume = 0.0;
+  smallestratio = 1e+16; // minaltitude;
+  biggestratio = 0.0;
+  smallestdiangle = smallestfaangle = 180.0;
+  biggestdiangle = biggestfaangle = 0.0;
+
+
+  int attrnum = numelemattrib - 1;
+
+  // Loop all elements, calculate quality parameters for each element.
+  tetrahedrons->traversalinit();
+  tetloop.tet = tetrahedrontraverse();
+  while (tetloop.tet != (tetrahedron *) NULL) {
+
+    if (b->convex) {
+      // Skip tets in the exterior.
+      if (elemattribute(tetloop.tet, attrnum) == -1.0) {
+        tetloop.tet = tetrahedrontraverse();
+        continue;
       }
     }
-    tetloop.tet = alltetrahedrontraverse();
-  }
-  if (horrors == 0) {
-    if (!b->quiet) {
-      printf("  In my studied opinion, the mesh appears to be consistent.\n");
+
+    // Get four vertices: p0, p1, p2, p3.
+    for (i = 0; i < 4; i++) p[i] = (point) tetloop.tet[4 + i];
+
+    // Get the tet volume.
+    tetvol = orient3dfast(p[1], p[0], p[2], p[3]) / 6.0;
+    total_tet_vol += tetvol;
+    total_tetprism_vol += tetprismvol(p[0], p[1], p[2], p[3]);
+
+    // Calculate the largest and smallest volume.
+    if (tetvol < smallestvolume) {
+      smallestvolume = tetvol;
+    } 
+    if (tetvol > biggestvolume) {
+      biggestvolume = tetvol;
     }
-  } else {
-    printf("  !! !! !! !! %d %s witnessed.\n", horrors, 
-           horrors > 1 ? "abnormity" : "abnormities");
-  }
 
-  return horrors;
-}
+    // Set the edge vectors: V[0], ..., V[5]
+    for (i = 0; i < 3; i++) V[0][i] = p[0][i] - p[3][i]; // V[0]: p3->p0.
+    for (i = 0; i < 3; i++) V[1][i] = p[1][i] - p[3][i]; // V[1]: p3->p1.
+    for (i = 0; i < 3; i++) V[2][i] = p[2][i] - p[3][i]; // V[2]: p3->p2.
+    for (i = 0; i < 3; i++) V[3][i] = p[1][i] - p[0][i]; // V[3]: p0->p1.
+    for (i = 0; i < 3; i++) V[4][i] = p[2][i] - p[1][i]; // V[4]: p1->p2.
+    for (i = 0; i < 3; i++) V[5][i] = p[0][i] - p[2][i]; // V[5]: p2->p0.
 
-///////////////////////////////////////////////////////////////////////////////
-//                                                                           //
-// checkshells()       Test the boundary mesh for topological consistency.   //
-//                                                                           //
-///////////////////////////////////////////////////////////////////////////////
+    // Get the squares of the edge lengths.
+    for (i = 0; i < 6; i++) edgelength[i] = dot(V[i], V[i]);
 
-int tetgenmesh::checkshells()
-{
-  triface neightet, symtet;
-  face shloop, spinsh, nextsh;
-  face checkseg;
-  point pa, pb;
-  int bakcount;
-  int horrors, i;
+    // Calculate the longest and shortest edge length.
+    for (i = 0; i < 6; i++) {
+      if (i == 0) {
+        shortlen = longlen = edgelength[i];
+      } else {
+        shortlen = edgelength[i] < shortlen ? edgelength[i] : shortlen;
+        longlen  = edgelength[i] > longlen  ? edgelength[i] : longlen;
+      }
+      if (edgelength[i] > longest) {
+        longest = edgelength[i];
+      } 
+      if (edgelength[i] < shortest) {
+        shortest = edgelength[i];
+      }
+    }
 
-  if (!b->quiet) {
-    printf("  Checking consistency of the mesh boundary...\n");
-  }
-  horrors = 0;
+    // Set the matrix A = [V[0], V[1], V[2]]^T.
+    for (j = 0; j < 3; j++) {
+      for (i = 0; i < 3; i++) A[j][i] = V[j][i];
+    }
 
-  void **bakpathblock = subfaces->pathblock;
-  void *bakpathitem = subfaces->pathitem;
-  int bakpathitemsleft = subfaces->pathitemsleft;
-  int bakalignbytes = subfaces->alignbytes;
+    // Decompose A just once.
+    if (lu_decmp(A, 3, indx, &D, 0)) {   
+      // Get the three faces normals.
+      for (j = 0; j < 3; j++) {
+        for (i = 0; i < 3; i++) rhs[i] = 0.0;
+        rhs[j] = 1.0;  // Positive means the inside direction
+        lu_solve(A, 3, indx, rhs, 0);
+        for (i = 0; i < 3; i++) N[j][i] = rhs[i];
+      }
+      // Get the fourth face normal by summing up the first three.
+      for (i = 0; i < 3; i++) N[3][i] = - N[0][i] - N[1][i] - N[2][i];
+      // Get the radius of the circumsphere.
+      for (i = 0; i < 3; i++) rhs[i] = 0.5 * dot(V[i], V[i]);
+      lu_solve(A, 3, indx, rhs, 0);
+      cirradius = sqrt(dot(rhs, rhs));
+      // Normalize the face normals.
+      for (i = 0; i < 4; i++) {
+        // H[i] is the inverse of height of its corresponding face.
+        H[i] = sqrt(dot(N[i], N[i]));
+        for (j = 0; j < 3; j++) N[i][j] /= H[i];
+      }
+      // Get the radius of the inscribed sphere.
+      // insradius = 1.0 / (H[0] + H[1] + H[2] + H[3]);
+      // Get the biggest H[i] (corresponding to the smallest height).
+      minheightinv = H[0];
+      for (i = 1; i < 4; i++) {
+        if (H[i] > minheightinv) minheightinv = H[i];
+      }
+    } else {
+      // A nearly degenerated tet.
+      if (tetvol <= 0.0) {
+        printf("  !! Warning:  A %s tet (%d,%d,%d,%d).\n", 
+               tetvol < 0 ? "inverted" : "degenerated", pointmark(p[0]),
+               pointmark(p[1]), pointmark(p[2]), pointmark(p[3]));
+        // Skip it.        
+        tetloop.tet = tetrahedrontraverse();
+        continue;
+      }
+      // Calculate the four face normals.
+      facenormal(p[2], p[1], p[3], N[0], 1, NULL);
+      facenormal(p[0], p[2], p[3], N[1], 1, NULL);
+      facenormal(p[1], p[0], p[3], N[2], 1, NULL);
+      facenormal(p[0], p[1], p[2], N[3], 1, NULL);
+      // Normalize the face normals.
+      for (i = 0; i < 4; i++) {
+        // H[i] is the twice of the area of the face.
+        H[i] = sqrt(dot(N[i], N[i]));
+        for (j = 0; j < 3; j++) N[i][j] /= H[i];
+      }
+      // Get the biggest H[i] / tetvol (corresponding to the smallest height).
+      minheightinv = (H[0] / tetvol);
+      for (i = 1; i < 4; i++) {
+        if ((H[i] / tetvol) > minheightinv) minheightinv = (H[i] / tetvol);
+      }
+      // Let the circumradius to be the half of its longest edge length.
+      cirradius = 0.5 * sqrt(longlen);
+    }
 
-  subfaces->traversalinit();
-  shloop.sh = shellfacetraverse(subfaces);
-  while (shloop.sh != NULL) {
-    shloop.shver = 0;
-    for (i = 0; i < 3; i++) {
-      // Check the face ring at this edge.
-      pa = sorg(shloop);
-      pb = sdest(shloop);
-      spinsh = shloop;
-      spivot(spinsh, nextsh);
-      bakcount = horrors;
-      while ((nextsh.sh != NULL) && (nextsh.sh != shloop.sh)) {
-        if (nextsh.sh[3] == NULL) {
-          printf("  !! !! Wrong subface-subface connection (Dead subface).\n");
-          printf("    First: x%lx (%d, %d, %d).\n", (uintptr_t) spinsh.sh,
-                 pointmark(sorg(spinsh)), pointmark(sdest(spinsh)), 
-                 pointmark(sapex(spinsh)));
-          printf("    Second: x%lx (DEAD)\n", (uintptr_t) nextsh.sh);
-          horrors++;
-          break;
-        }
-        // check if they have the same edge.
-        if (!(((sorg(nextsh) == pa) && (sdest(nextsh) == pb)) ||
-              ((sorg(nextsh) == pb) && (sdest(nextsh) == pa)))) {
-           printf("  !! !! Wrong subface-subface connection.\n");
-           printf("    First: x%lx (%d, %d, %d).\n", (uintptr_t) spinsh.sh,
-                  pointmark(sorg(spinsh)), pointmark(sdest(spinsh)), 
-                  pointmark(sapex(spinsh)));
-           printf("    Scond: x%lx (%d, %d, %d).\n", (uintptr_t) nextsh.sh,
-                  pointmark(sorg(nextsh)), pointmark(sdest(nextsh)), 
-                  pointmark(sapex(nextsh)));
-           horrors++;
-           break;
-        }
-        // Check they should not have the same apex.
-        if (sapex(nextsh) == sapex(spinsh)) {
-           printf("  !! !! Existing two duplicated subfaces.\n");
-           printf("    First: x%lx (%d, %d, %d).\n", (uintptr_t) spinsh.sh,
-                  pointmark(sorg(spinsh)), pointmark(sdest(spinsh)), 
-                  pointmark(sapex(spinsh)));
-           printf("    Scond: x%lx (%d, %d, %d).\n", (uintptr_t) nextsh.sh,
-                  pointmark(sorg(nextsh)), pointmark(sdest(nextsh)), 
-                  pointmark(sapex(nextsh)));
-           horrors++;
-           break;
-        }
-        spinsh = nextsh;
-        spivot(spinsh, nextsh);
+    // Get the dihedrals (in degree) at each edges.
+    j = 0;
+    for (i = 1; i < 4; i++) {
+      alldihed[j] = -dot(N[0], N[i]); // Edge cd, bd, bc.
+      if (alldihed[j] < -1.0) alldihed[j] = -1; // Rounding.
+      else if (alldihed[j] > 1.0) alldihed[j] = 1;
+      alldihed[j] = acos(alldihed[j]) / PI * 180.0;
+      j++;
+    }
+    for (i = 2; i < 4; i++) {
+      alldihed[j] = -dot(N[1], N[i]); // Edge ad, ac.
+      if (alldihed[j] < -1.0) alldihed[j] = -1; // Rounding.
+      else if (alldihed[j] > 1.0) alldihed[j] = 1;
+      alldihed[j] = acos(alldihed[j]) / PI * 180.0;
+      j++;
+    }
+    alldihed[j] = -dot(N[2], N[3]); // Edge ab.
+    if (alldihed[j] < -1.0) alldihed[j] = -1; // Rounding.
+    else if (alldihed[j] > 1.0) alldihed[j] = 1;
+    alldihed[j] = acos(alldihed[j]) / PI * 180.0;
+
+    // Calculate the largest and smallest dihedral angles.
+    for (i = 0; i < 6; i++) {
+      if (i == 0) {
+        smalldiangle = bigdiangle = alldihed[i];
+      } else {
+        smalldiangle = alldihed[i] < smalldiangle ? alldihed[i] : smalldiangle;
+        bigdiangle = alldihed[i] > bigdiangle ? alldihed[i] : bigdiangle;
       }
-      // Check subface-subseg bond.
-      sspivot(shloop, checkseg);
-      if (checkseg.sh != NULL) {
-        if (checkseg.sh[3] == NULL) {
-          printf("  !! !! Wrong subface-subseg connection (Dead subseg).\n");
-          printf("    Sub: x%lx (%d, %d, %d).\n", (uintptr_t) shloop.sh,
-                 pointmark(sorg(shloop)), pointmark(sdest(shloop)), 
-                 pointmark(sapex(shloop)));
-          printf("    Sub: x%lx (Dead)\n", (uintptr_t) checkseg.sh);
-          horrors++;
+      if (alldihed[i] < smallestdiangle) {
+        smallestdiangle = alldihed[i];
+      } 
+      if (alldihed[i] > biggestdiangle) {
+        biggestdiangle = alldihed[i];
+      }
+      // Accumulate the corresponding number in the dihedral angle histogram.
+      if (alldihed[i] < 5.0) {
+        tendegree = 0;
+      } else if (alldihed[i] >= 5.0 && alldihed[i] < 10.0) {
+        tendegree = 1;
+      } else if (alldihed[i] >= 80.0 && alldihed[i] < 110.0) {
+        tendegree = 9; // Angles between 80 to 110 degree are in one entry.
+      } else if (alldihed[i] >= 170.0 && alldihed[i] < 175.0) {
+        tendegree = 16;
+      } else if (alldihed[i] >= 175.0) {
+        tendegree = 17;
+      } else {
+        tendegree = (int) (alldihed[i] / 10.);
+        if (alldihed[i] < 80.0) {
+          tendegree++;  // In the left column.
         } else {
-          if (!(((sorg(checkseg) == pa) && (sdest(checkseg) == pb)) ||
-                ((sorg(checkseg) == pb) && (sdest(checkseg) == pa)))) {
-            printf("  !! !! Wrong subface-subseg connection.\n");
-            printf("    Sub: x%lx (%d, %d, %d).\n", (uintptr_t) shloop.sh,
-                   pointmark(sorg(shloop)), pointmark(sdest(shloop)), 
-                   pointmark(sapex(shloop)));
-            printf("    Seg: x%lx (%d, %d).\n", (uintptr_t) checkseg.sh,
-                   pointmark(sorg(checkseg)), pointmark(sdest(checkseg)));
-            horrors++;
-          }
+          tendegree--;  // In the right column.
         }
       }
-      if (horrors > bakcount) break; // An error detected. 
-      senextself(shloop);
+      dihedangletable[tendegree]++;
     }
-    // Check tet-subface connection.
-    stpivot(shloop, neightet);
-    if (neightet.tet != NULL) {
-      if (neightet.tet[4] == NULL) {
-        printf("  !! !! Wrong sub-to-tet connection (Dead tet)\n");
-        printf("    Sub: x%lx (%d, %d, %d).\n", (uintptr_t) shloop.sh,
-               pointmark(sorg(shloop)), pointmark(sdest(shloop)), 
-               pointmark(sapex(shloop)));
-        printf("    Tet: x%lx (DEAD)\n", (uintptr_t) neightet.tet);
-        horrors++;
-      } else {
-        if (!((sorg(shloop) == org(neightet)) && 
-              (sdest(shloop) == dest(neightet)))) {
-          printf("  !! !! Wrong sub-to-tet connection\n");
-          printf("    Sub: x%lx (%d, %d, %d).\n", (uintptr_t) shloop.sh,
-                 pointmark(sorg(shloop)), pointmark(sdest(shloop)), 
-                 pointmark(sapex(shloop)));
-          printf("    Tet: x%lx (%d, %d, %d, %d).\n",
-                 (uintptr_t) neightet.tet, pointmark(org(neightet)), 
-                 pointmark(dest(neightet)), pointmark(apex(neightet)),
-                 pointmark(oppo(neightet)));
-          horrors++;
-        }
-        tspivot(neightet, spinsh);
-        if (!((sorg(spinsh) == org(neightet)) && 
-              (sdest(spinsh) == dest(neightet)))) {
-          printf("  !! !! Wrong tet-sub connection.\n");
-          printf("    Sub: x%lx (%d, %d, %d).\n", (uintptr_t) spinsh.sh,
-                 pointmark(sorg(spinsh)), pointmark(sdest(spinsh)), 
-                 pointmark(sapex(spinsh)));
-          printf("    Tet: x%lx (%d, %d, %d, %d).\n", 
-                 (uintptr_t) neightet.tet, pointmark(org(neightet)), 
-                 pointmark(dest(neightet)), pointmark(apex(neightet)), 
-                 pointmark(oppo(neightet)));
-          horrors++;
+
+
+
+    // Calculate the largest and smallest face angles.
+    for (tetloop.ver = 0; tetloop.ver < 4; tetloop.ver++) {
+      fsym(tetloop, neightet);
+      // Only do the calulation once for a face.
+      if (((point) neightet.tet[7] == dummypoint) || 
+          (tetloop.tet < neightet.tet)) {
+        p[0] = org(tetloop);
+        p[1] = dest(tetloop);
+        p[2] = apex(tetloop);
+        faceangle[0] = interiorangle(p[0], p[1], p[2], NULL);
+        faceangle[1] = interiorangle(p[1], p[2], p[0], NULL);
+        faceangle[2] = PI - (faceangle[0] + faceangle[1]);
+        // Translate angles into degrees.
+        for (i = 0; i < 3; i++) {
+          faceangle[i] = (faceangle[i] * 180.0) / PI;
         }
-        fsym(neightet, symtet);
-        tspivot(symtet, spinsh);
-        if (spinsh.sh != NULL) {
-          if (!((sorg(spinsh) == org(symtet)) && 
-                (sdest(spinsh) == dest(symtet)))) {
-            printf("  !! !! Wrong tet-sub connection.\n");
-            printf("    Sub: x%lx (%d, %d, %d).\n", (uintptr_t) spinsh.sh,
-                   pointmark(sorg(spinsh)), pointmark(sdest(spinsh)), 
-                   pointmark(sapex(spinsh)));
-            printf("    Tet: x%lx (%d, %d, %d, %d).\n", 
-                   (uintptr_t) symtet.tet, pointmark(org(symtet)), 
-                   pointmark(dest(symtet)), pointmark(apex(symtet)), 
-                   pointmark(oppo(symtet)));
-            horrors++;
+        // Calculate the largest and smallest face angles.
+        for (i = 0; i < 3; i++) {
+          if (i == 0) {
+            smallfaangle = bigfaangle = faceangle[i];
+          } else {
+            smallfaangle = faceangle[i] < smallfaangle ? 
+              faceangle[i] : smallfaangle;
+            bigfaangle = faceangle[i] > bigfaangle ? faceangle[i] : bigfaangle;
           }
-        } else {
-          printf("  Warning: Broken tet-sub-tet connection.\n");
+          if (faceangle[i] < smallestfaangle) {
+            smallestfaangle = faceangle[i];
+          } 
+          if (faceangle[i] > biggestfaangle) {
+            biggestfaangle = faceangle[i];
+          }
+          tendegree = (int) (faceangle[i] / 10.);
+          faceangletable[tendegree]++;
         }
       }
     }
-    if (sinfected(shloop)) {
-      // This may be a bug. report it.
-      printf("  !! A infected subface: (%d, %d, %d).\n", 
-             pointmark(sorg(shloop)), pointmark(sdest(shloop)), 
-             pointmark(sapex(shloop)));
+
+    // Calculate aspect ratio and radius-edge ratio for this element.
+    tetradius = cirradius / sqrt(shortlen);
+    // tetaspect = sqrt(longlen) / (2.0 * insradius);
+    tetaspect = sqrt(longlen) * minheightinv;
+    // Remember the largest and smallest aspect ratio.
+    if (tetaspect < smallestratio) {
+      smallestratio = tetaspect;
+    } 
+    if (tetaspect > biggestratio) {
+      biggestratio = tetaspect;
     }
-    if (smarktested(shloop)) {
-      // This may be a bug. report it.
-      printf("  !! A marked subface: (%d, %d, %d).\n", pointmark(sorg(shloop)), 
-             pointmark(sdest(shloop)), pointmark(sapex(shloop)));
+    // Accumulate the corresponding number in the aspect ratio histogram.
+    aspectindex = 0;
+    while ((tetaspect > aspectratiotable[aspectindex]) && (aspectindex < 11)) {
+      aspectindex++;
     }
-    shloop.sh = shellfacetraverse(subfaces);
+    aspecttable[aspectindex]++;
+    radiusindex = 0;
+    while ((tetradius > radiusratiotable[radiusindex]) && (radiusindex < 11)) {
+      radiusindex++;
+    }
+    radiustable[radiusindex]++;
+
+    tetloop.tet = tetrahedrontraverse();
+  }
+
+  shortest = sqrt(shortest);
+  longest = sqrt(longest);
+  minaltitude = sqrt(minaltitude);
+
+  printf("  Smallest volume: %16.5g   |  Largest volume: %16.5g\n",
+         smallestvolume, biggestvolume);
+  printf("  Shortest edge:   %16.5g   |  Longest edge:   %16.5g\n",
+         shortest, longest);
+  printf("  Smallest asp.ratio: %13.5g   |  Largest asp.ratio: %13.5g\n",
+         smallestratio, biggestratio);
+  sprintf(sbuf, "%.17g", biggestfaangle);
+  if (strlen(sbuf) > 8) {
+    sbuf[8] = '\0';
+  }
+  printf("  Smallest facangle: %14.5g   |  Largest facangle:       %s\n",
+         smallestfaangle, sbuf);
+  sprintf(sbuf, "%.17g", biggestdiangle);
+  if (strlen(sbuf) > 8) {
+    sbuf[8] = '\0';
+  }
+  printf("  Smallest dihedral: %14.5g   |  Largest dihedral:       %s\n\n",
+         smallestdiangle, sbuf);
+
+  printf("  Aspect ratio histogram:\n");
+  printf("         < %-6.6g    :  %8ld      | %6.6g - %-6.6g     :  %8ld\n",
+         aspectratiotable[0], aspecttable[0], aspectratiotable[5],
+         aspectratiotable[6], aspecttable[6]);
+  for (i = 1; i < 5; i++) {
+    printf("  %6.6g - %-6.6g    :  %8ld      | %6.6g - %-6.6g     :  %8ld\n",
+           aspectratiotable[i - 1], aspectratiotable[i], aspecttable[i],
+           aspectratiotable[i + 5], aspectratiotable[i + 6],
+           aspecttable[i + 6]);
+  }
+  printf("  %6.6g - %-6.6g    :  %8ld      | %6.6g -            :  %8ld\n",
+         aspectratiotable[4], aspectratiotable[5], aspecttable[5],
+         aspectratiotable[10], aspecttable[11]);
+  printf("  (A tetrahedron's aspect ratio is its longest edge length");
+  printf(" divided by its\n");
+  printf("    smallest side height)\n\n");
+
+  printf("  Face angle histogram:\n");
+  for (i = 0; i < 9; i++) {
+    printf("    %3d - %3d degrees:  %8ld      |    %3d - %3d degrees:  %8ld\n",
+           i * 10, i * 10 + 10, faceangletable[i],
+           i * 10 + 90, i * 10 + 100, faceangletable[i + 9]);
+  }
+  if (minfaceang != PI) {
+    printf("  Minimum input face angle is %g (degree).\n",
+           minfaceang / PI * 180.0);
+  }
+  printf("\n");
+
+  printf("  Dihedral angle histogram:\n");
+  // Print the three two rows:
+  printf("     %3d - %2d degrees:  %8ld      |    %3d - %3d degrees:  %8ld\n",
+         0, 5, dihedangletable[0], 80, 110, dihedangletable[9]);
+  printf("     %3d - %2d degrees:  %8ld      |    %3d - %3d degrees:  %8ld\n",
+         5, 10, dihedangletable[1], 110, 120, dihedangletable[10]);
+  // Print the third to seventh rows.
+  for (i = 2; i < 7; i++) {
+    printf("     %3d - %2d degrees:  %8ld      |    %3d - %3d degrees:  %8ld\n",
+           (i - 1) * 10, (i - 1) * 10 + 10, dihedangletable[i],
+           (i - 1) * 10 + 110, (i - 1) * 10 + 120, dihedangletable[i + 9]);
+  }
+  // Print the last two rows.
+  printf("     %3d - %2d degrees:  %8ld      |    %3d - %3d degrees:  %8ld\n",
+         60, 70, dihedangletable[7], 170, 175, dihedangletable[16]);
+  printf("     %3d - %2d degrees:  %8ld      |    %3d - %3d degrees:  %8ld\n",
+         70, 80, dihedangletable[8], 175, 180, dihedangletable[17]);
+  if (minfacetdihed != PI) {
+    printf("  Minimum input dihedral angle is %g (degree).\n",
+           minfacetdihed / PI * 180.0);
   }
+  printf("\n");
 
-  if (horrors == 0) {
-    if (!b->quiet) {
-      printf("  Mesh boundaries connected correctly.\n");
-    }
-  } else {
-    printf("  !! !! !! !! %d boundary connection viewed with horror.\n",
-           horrors);
+  printf("\n");
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// memorystatistics()    Report the memory usage.                            //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+void tetgenmesh::memorystatistics()
+{
+  printf("Memory usage statistics:\n\n");
+ 
+  // Count the number of blocks of tetrahedra. 
+  int tetblocks = 0;
+  tetrahedrons->pathblock = tetrahedrons->firstblock;
+  while (tetrahedrons->pathblock != NULL) {
+    tetblocks++;
+    tetrahedrons->pathblock = (void **) *(tetrahedrons->pathblock);  
   }
 
-  subfaces->pathblock = bakpathblock;
-  subfaces->pathitem = bakpathitem;
-  subfaces->pathitemsleft = bakpathitemsleft;
-  subfaces->alignbytes = bakalignbytes;
+  // Calculate the total memory (in bytes) used by storing meshes.
+  unsigned long totalmeshmemory = 0l, totalt2shmemory = 0l;
+  totalmeshmemory = points->maxitems * points->itembytes +
+                    tetrahedrons->maxitems * tetrahedrons->itembytes;
+  if (b->plc || b->refine) {
+    totalmeshmemory += (subfaces->maxitems * subfaces->itembytes +
+                        subsegs->maxitems * subsegs->itembytes);
+    totalt2shmemory = (tet2subpool->maxitems * tet2subpool->itembytes +
+                       tet2segpool->maxitems * tet2segpool->itembytes);
+  }
 
-  return horrors;
+  unsigned long totalalgomemory = 0l;
+  totalalgomemory = cavetetlist->totalmemory + cavebdrylist->totalmemory +
+                    caveoldtetlist->totalmemory + 
+                    flippool->maxitems * flippool->itembytes;
+  if (b->plc || b->refine) {
+    totalalgomemory += (subsegstack->totalmemory + subfacstack->totalmemory +
+                        subvertstack->totalmemory + 
+                        caveshlist->totalmemory + caveshbdlist->totalmemory +
+                        cavesegshlist->totalmemory +
+                        cavetetshlist->totalmemory + 
+                        cavetetseglist->totalmemory +
+                        caveencshlist->totalmemory +
+                        caveencseglist->totalmemory +
+                        cavetetvertlist->totalmemory +
+                        unflipqueue->totalmemory);
+  }
+
+  printf("  Maximum number of tetrahedra:  %ld\n", tetrahedrons->maxitems);
+  printf("  Maximum number of tet blocks (blocksize = %d):  %d\n",
+         b->tetrahedraperblock, tetblocks);
+  /*
+  if (b->plc || b->refine) {
+    printf("  Approximate memory for tetrahedral mesh (bytes):  %ld\n",
+           totalmeshmemory);
+    
+    printf("  Approximate memory for extra pointers (bytes):  %ld\n",
+           totalt2shmemory);
+  } else {
+    printf("  Approximate memory for tetrahedralization (bytes):  %ld\n",
+           totalmeshmemory);
+  }
+  printf("  Approximate memory for algorithms (bytes):  %ld\n",
+         totalalgomemory);
+  printf("  Approximate memory for working arrays (bytes):  %ld\n",
+         totalworkmemory);
+  printf("  Approximate total used memory (bytes):  %ld\n",
+         totalmeshmemory + totalt2shmemory + totalalgomemory + 
+         totalworkmemory);
+  */
+  if (b->plc || b->refine) {
+    printf("  Approximate memory for tetrahedral mesh (bytes):  ");
+    printfcomma(totalmeshmemory); printf("\n");
+    
+    printf("  Approximate memory for extra pointers (bytes):  ");
+    printfcomma(totalt2shmemory); printf("\n");
+  } else {
+    printf("  Approximate memory for tetrahedralization (bytes):  ");
+    printfcomma(totalmeshmemory); printf("\n");
+  }
+  printf("  Approximate memory for algorithms (bytes):  ");
+  printfcomma(totalalgomemory); printf("\n");
+  printf("  Approximate memory for working arrays (bytes):  ");
+  printfcomma(totalworkmemory); printf("\n");
+  printf("  Approximate total used memory (bytes):  ");
+  printfcomma(totalmeshmemory + totalt2shmemory + totalalgomemory + 
+              totalworkmemory);
+  printf("\n");
+
+  printf("\n");
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// checksegments()    Check the connections between tetrahedra and segments. //
+// statistics()    Print all sorts of cool facts.                            //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-int tetgenmesh::checksegments()
+void tetgenmesh::statistics()
 {
-  triface tetloop, neightet, spintet;
-  shellface *segs;
-  face neighsh, spinsh, checksh;
-  face sseg, checkseg;
-  point pa, pb;
-  int miscount;
-  int t1ver;
-  int horrors, i;
+  long tetnumber, facenumber;
+
+  printf("\nStatistics:\n\n");
+  printf("  Input points: %d\n", in->numberofpoints);
+  if (b->refine) {
+    printf("  Input tetrahedra: %d\n", in->numberoftetrahedra);
+    if (in->numberoftrifaces > 0) {
+	  printf("  Input triangles: %d\n", in->numberoftrifaces);
+    }
+    if (in->numberofedges > 0) {
+	  printf("  Input edges: %d\n", in->numberofedges);
+	}
+  } else if (b->plc) {
+    printf("  Input facets: %d\n", in->numberoffacets);
+    printf("  Input segments: %ld\n", insegments);
+	if (in->numberofedges > 0) {
+	  printf("  Input edges: %d\n", in->numberofedges);
+	}
+    printf("  Input holes: %d\n", in->numberofholes);
+    printf("  Input regions: %d\n", in->numberofregions);
+  }
 
+  tetnumber = tetrahedrons->items - hullsize;
+  facenumber = (tetnumber * 4l + hullsize) / 2l;
 
-  if (!b->quiet) {
-    printf("  Checking tet->seg connections...\n");
+  if (b->weighted) { // -w option
+    printf("\n  Mesh points: %ld\n", points->items - nonregularcount);
+  } else {
+    printf("\n  Mesh points: %ld\n", points->items);
+  }
+  printf("  Mesh tetrahedra: %ld\n", tetnumber);
+  printf("  Mesh faces: %ld\n", facenumber);
+  if (meshedges > 0l) {
+    printf("  Mesh edges: %ld\n", meshedges);
+  } else {
+    if (!nonconvex) {
+      long vsize = points->items - dupverts - unuverts;
+      if (b->weighted) vsize -= nonregularcount;
+      meshedges = vsize + facenumber - tetnumber - 1;
+      printf("  Mesh edges: %ld\n", meshedges);
+    }
   }
 
-  horrors = 0;
-  tetrahedrons->traversalinit();
-  tetloop.tet = tetrahedrontraverse();
-  while (tetloop.tet != NULL) {
-    // Loop the six edges of the tet.
-    if (tetloop.tet[8] != NULL) {
-      segs = (shellface *) tetloop.tet[8];
-      for (i = 0; i < 6; i++) {
-        sdecode(segs[i], sseg);
-        if (sseg.sh != NULL) {
-          // Get the edge of the tet.
-          tetloop.ver = edge2ver[i];
-          // Check if they are the same edge.
-          pa = (point) sseg.sh[3];
-          pb = (point) sseg.sh[4];
-          if (!(((org(tetloop) == pa) && (dest(tetloop) == pb)) ||
-                ((org(tetloop) == pb) && (dest(tetloop) == pa)))) {
-            printf("  !! Wrong tet-seg connection.\n");
-            printf("    Tet: x%lx (%d, %d, %d, %d) - Seg: x%lx (%d, %d).\n", 
-                   (uintptr_t) tetloop.tet, pointmark(org(tetloop)),
-                   pointmark(dest(tetloop)), pointmark(apex(tetloop)),
-                   pointmark(oppo(tetloop)), (uintptr_t) sseg.sh,
-                   pointmark(pa), pointmark(pb));
-            horrors++;
-          } else {
-            // Loop all tets sharing at this edge.
-            neightet = tetloop;
-            do {
-              tsspivot1(neightet, checkseg);
-              if (checkseg.sh != sseg.sh) {
-                printf("  !! Wrong tet->seg connection.\n");
-                printf("    Tet: x%lx (%d, %d, %d, %d) - ", 
-                       (uintptr_t) neightet.tet, pointmark(org(neightet)),
-                       pointmark(dest(neightet)), pointmark(apex(neightet)),
-                       pointmark(oppo(neightet)));
-                if (checkseg.sh != NULL) {
-                  printf("Seg x%lx (%d, %d).\n", (uintptr_t) checkseg.sh,
-                         pointmark(sorg(checkseg)),pointmark(sdest(checkseg))); 
-                } else {
-                  printf("Seg: NULL.\n");
-                }
-                horrors++;
-              }
-              fnextself(neightet);
-            } while (neightet.tet != tetloop.tet);
-          }
-          // Check the seg->tet pointer.
-          sstpivot1(sseg, neightet);
-          if (neightet.tet == NULL) {
-            printf("  !! Wrong seg->tet connection (A NULL tet).\n");
-            horrors++;
-          } else {
-            if (!(((org(neightet) == pa) && (dest(neightet) == pb)) ||
-                ((org(neightet) == pb) && (dest(neightet) == pa)))) {
-              printf("  !! Wrong seg->tet connection (Wrong edge).\n");
-              printf("    Tet: x%lx (%d, %d, %d, %d) - Seg: x%lx (%d, %d).\n", 
-                     (uintptr_t) neightet.tet, pointmark(org(neightet)),
-                     pointmark(dest(neightet)), pointmark(apex(neightet)),
-                     pointmark(oppo(neightet)), (uintptr_t) sseg.sh,
-                     pointmark(pa), pointmark(pb));
-              horrors++;
-            }
-          }
-        }
-      }
+  if (b->plc || b->refine) {
+    printf("  Mesh faces on exterior boundary: %ld\n", hullsize);
+    if (meshhulledges > 0l) {
+      printf("  Mesh edges on exterior boundary: %ld\n", meshhulledges);
     }
-    // Loop the six edge of this tet.
-    neightet.tet = tetloop.tet;
-    for (i = 0; i < 6; i++) {
-      neightet.ver = edge2ver[i];
-      if (edgemarked(neightet)) {
-        // A possible bug. Report it.
-        printf("  !! A marked edge: (%d, %d, %d, %d) -- x%lx %d.\n",
-               pointmark(org(neightet)), pointmark(dest(neightet)),
-               pointmark(apex(neightet)), pointmark(oppo(neightet)),
-               (uintptr_t) neightet.tet, neightet.ver);
-        // Check if all tets at the edge are marked.
-        spintet = neightet;
-        while (1) {
-          fnextself(spintet);
-          if (!edgemarked(spintet)) {
-            printf("  !! !! An unmarked edge (%d, %d, %d, %d) -- x%lx %d.\n",
-                   pointmark(org(spintet)), pointmark(dest(spintet)),
-                   pointmark(apex(spintet)), pointmark(oppo(spintet)),
-                   (uintptr_t) spintet.tet, spintet.ver);
-            horrors++;
-          }
-          if (spintet.tet == neightet.tet) break;
-        }
-      }
+    printf("  Mesh faces on input facets: %ld\n", subfaces->items);
+    printf("  Mesh edges on input segments: %ld\n", subsegs->items);
+    if (st_facref_count > 0l) {
+      printf("  Steiner points on input facets:  %ld\n", st_facref_count);
+    }
+    if (st_segref_count > 0l) {
+      printf("  Steiner points on input segments:  %ld\n", st_segref_count);
+    }
+    if (st_volref_count > 0l) {
+      printf("  Steiner points inside domain: %ld\n", st_volref_count);
+    }
+  } else {
+    printf("  Convex hull faces: %ld\n", hullsize);
+    if (meshhulledges > 0l) {
+      printf("  Convex hull edges: %ld\n", meshhulledges);
     }
-    tetloop.tet = tetrahedrontraverse();
   }
-
-  if (!b->quiet) {
-    printf("  Checking seg->tet connections...\n");
+  if (b->weighted) { // -w option
+    printf("  Skipped non-regular points: %ld\n", nonregularcount);
   }
+  printf("\n");
 
-  miscount = 0; // Count the number of unrecovered segments.
-  subsegs->traversalinit();
-  sseg.shver = 0;
-  sseg.sh = shellfacetraverse(subsegs);
-  while (sseg.sh != NULL) {
-    pa = sorg(sseg);
-    pb = sdest(sseg);
-    spivot(sseg, neighsh);
-    if (neighsh.sh != NULL) {      
-      spinsh = neighsh;
-      while (1) {
-        // Check seg-subface bond.
-        if (((sorg(spinsh) == pa) && (sdest(spinsh) == pb)) ||
-	    ((sorg(spinsh) == pb) && (sdest(spinsh) == pa))) {
-          // Keep the same rotate direction.
-          //if (sorg(spinsh) != pa) {          
-          //  sesymself(spinsh);
-          //  printf("  !! Wrong ori at subface (%d, %d, %d) -- x%lx %d\n",
-          //         pointmark(sorg(spinsh)), pointmark(sdest(spinsh)),
-          //         pointmark(sapex(spinsh)), (uintptr_t) spinsh.sh,
-          //         spinsh.shver);
-          //  horrors++;
-          //}
-          stpivot(spinsh, spintet);
-          if (spintet.tet != NULL) {
-            // Check if all tets at this segment.
-            while (1) {
-              tsspivot1(spintet, checkseg);
-              if (checkseg.sh == NULL) {
-                printf("  !! !! No seg at tet (%d, %d, %d, %d) -- x%lx %d\n",
-                       pointmark(org(spintet)), pointmark(dest(spintet)),
-                       pointmark(apex(spintet)), pointmark(oppo(spintet)),
-                       (uintptr_t) spintet.tet, spintet.ver);
-                horrors++;
-              }
-              if (checkseg.sh != sseg.sh) {
-                printf("  !! !! Wrong seg (%d, %d) at tet (%d, %d, %d, %d)\n",
-                       pointmark(sorg(checkseg)), pointmark(sdest(checkseg)),
-                       pointmark(org(spintet)), pointmark(dest(spintet)),
-                       pointmark(apex(spintet)), pointmark(oppo(spintet)));
-                horrors++;
-              }
-              fnextself(spintet);
-              // Stop at the next subface.
-              tspivot(spintet, checksh);
-              if (checksh.sh != NULL) break;
-            } // while (1)
-          }
-        } else { 
-          printf("  !! Wrong seg-subface (%d, %d, %d) -- x%lx %d connect\n",
-                 pointmark(sorg(spinsh)), pointmark(sdest(spinsh)),
-                 pointmark(sapex(spinsh)), (uintptr_t) spinsh.sh,
-                 spinsh.shver);
-          horrors++;
-          break;
-        } // if pa, pb
-        spivotself(spinsh);
-        if (spinsh.sh == NULL) break; // A dangling segment.
-        if (spinsh.sh == neighsh.sh) break;
-      } // while (1)
-    } // if (neighsh.sh != NULL)
-    // Count the number of "un-recovered" segments.
-    sstpivot1(sseg, neightet);
-    if (neightet.tet == NULL) {
-      miscount++;
+
+  if (b->verbose > 0) {
+    if (b->plc || b->refine) { // -p or -r
+      if (tetrahedrons->items > 0l) {
+        qualitystatistics();
+      }
+    }
+    if (tetrahedrons->items > 0l) {
+      memorystatistics();
     }
-    sseg.sh = shellfacetraverse(subsegs);
   }
+}
 
-  if (!b->quiet) {
-    printf("  Checking seg->seg connections...\n");
-  }
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// memoryusage()    Return the peak memory (in bytes) used so far by the     //
+//                  mesh and the algorithms (see memorystatistics()).        //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
 
-  points->traversalinit();
-  pa = pointtraverse();
-  while (pa != NULL) {
-    if (pointtype(pa) == FREESEGVERTEX) {
-      // There should be two subsegments connected at 'pa'.
-      // Get a subsegment containing 'pa'.
-      sdecode(point2sh(pa), sseg);
-      if ((sseg.sh == NULL) || sseg.sh[3] == NULL) {
-        printf("  !! Dead point-to-seg pointer at point %d.\n",
-               pointmark(pa));
-        horrors++;
-      } else {
-        sseg.shver = 0;
-        if (sorg(sseg) != pa) {
-          if (sdest(sseg) != pa) {
-            printf("  !! Wrong point-to-seg pointer at point %d.\n",
-                   pointmark(pa));
-            horrors++;
-          } else {
-            // Find the next subsegment at 'pa'.
-            senext(sseg, checkseg);
-            if ((checkseg.sh == NULL) || (checkseg.sh[3] == NULL)) {
-              printf("  !! Dead seg-seg connection at point %d.\n",
-                     pointmark(pa));
-              horrors++;
-            } else {
-              spivotself(checkseg);
-              checkseg.shver = 0;
-              if (sorg(checkseg) != pa) {
-                printf("  !! Wrong seg-seg connection at point %d.\n",
-                     pointmark(pa));
-                horrors++;
-              }
-            }
-          }
-        } else {
-          // Find the previous subsegment at 'pa'.
-          senext2(sseg, checkseg);
-          if ((checkseg.sh == NULL) || (checkseg.sh[3] == NULL)) {
-            printf("  !! Dead seg-seg connection at point %d.\n",
-                   pointmark(pa));
-            horrors++;
-          } else {
-            spivotself(checkseg);
-            checkseg.shver = 0;
-            if (sdest(checkseg) != pa) {
-              printf("  !! Wrong seg-seg connection at point %d.\n",
-                     pointmark(pa));
-              horrors++;
-            }
-          }
-        }
-      }
-    }
-    pa = pointtraverse();
+unsigned long tetgenmesh::memoryusage()
+{
+  unsigned long totalmemory;
+
+  if (points == (memorypool *) NULL) {
+    return 0l; // The pools are not initialized yet.
   }
 
-  if (horrors == 0) {
-    printf("  Segments are connected properly.\n");
-  } else {
-    printf("  !! !! !! !! Found %d missing connections.\n", horrors);
+  totalmemory = points->maxitems * points->itembytes +
+                tetrahedrons->maxitems * tetrahedrons->itembytes +
+                cavetetlist->totalmemory + cavebdrylist->totalmemory +
+                caveoldtetlist->totalmemory + 
+                flippool->maxitems * flippool->itembytes + totalworkmemory;
+  if (b->plc || b->refine) {
+    totalmemory += (subfaces->maxitems * subfaces->itembytes +
+                    subsegs->maxitems * subsegs->itembytes +
+                    tet2subpool->maxitems * tet2subpool->itembytes +
+                    tet2segpool->maxitems * tet2segpool->itembytes);
+    totalmemory += (subsegstack->totalmemory + subfacstack->totalmemory +
+                    subvertstack->totalmemory + 
+                    caveshlist->totalmemory + caveshbdlist->totalmemory +
+                    cavesegshlist->totalmemory +
+                    cavetetshlist->totalmemory + 
+                    cavetetseglist->totalmemory +
+                    caveencshlist->totalmemory +
+                    caveencseglist->totalmemory +
+                    cavetetvertlist->totalmemory +
+                    unflipqueue->totalmemory);
+  }
+
+  return totalmemory;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// markphase()    Record the wall clock and the memory at the start of a     //
+//                phase (see tetgenio::statphase).                           //
+//                                                                           //
+// The phase 'tetgenio::NUMPHASES' marks the end of the last phase.  Phases  //
+// which are not run get zero time.  The wall clock is read by the C11/C++17 //
+// timespec_get(), unlike clock() it does not add up the time of threads.    //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+void tetgenmesh::markphase(int phase)
+{
+  struct timespec ts;
+
+  timespec_get(&ts, TIME_UTC);
+  phasewalltime[phase] = (REAL) ts.tv_sec + (REAL) ts.tv_nsec * 1.0e-9;
+  phasememory[phase] = (REAL) memoryusage();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// outstatistics()    Output the phase timings and the counters of this run  //
+//                    to a .json file or a tetgenio structure.               //
+//                                                                           //
+// The predicate counters are those of the calling thread since this object  //
+// was created (see filterstatistics()).  They only count the filtered       //
+// predicates of point location and Delaunay insertion, the predicates used  //
+// by boundary recovery and mesh refinement are not counted.                 //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+void tetgenmesh::outstatistics(tetgenio* out)
+{
+  tetgenio statout;
+  tetgenio *io;
+  long calls[3], exacts[3];
+  int i;
+
+  io = (out == (tetgenio *) NULL) ? &statout : out;
+
+  // The arrays have a fixed size, they are reused if 'out' already has them
+  //   (e.g., from a previous run in the batch mode).
+  if (io->phasetimelist == (REAL *) NULL) {
+    io->phasetimelist = new REAL[tetgenio::NUMPHASES];
   }
-  if (miscount > 0) {
-    printf("  !! !! Found %d missing segments.\n", miscount);
+  if (io->phasememorylist == (REAL *) NULL) {
+    io->phasememorylist = new REAL[tetgenio::NUMPHASES];
+  }
+  for (i = 0; i < tetgenio::NUMPHASES; i++) {
+    io->phasetimelist[i] = phasewalltime[i + 1] - phasewalltime[i];
+    // The memory pools only grow, the peak is reached at the end.
+    io->phasememorylist[i] = phasememory[i + 1];
   }
 
-  return horrors;
+  filterstatistics(calls, exacts);
+  if (io->statcountlist == (long *) NULL) {
+    io->statcountlist = new long[tetgenio::NUMSTATCOUNTERS];
+  }
+  io->statcountlist[tetgenio::STAT_LOCATE] = ptloccount;
+  io->statcountlist[tetgenio::STAT_WALKSTEPS] = ptlocsteps;
+  io->statcountlist[tetgenio::STAT_MAXWALK] = ptlocmaxsteps;
+  for (i = 0; i < 3; i++) {
+    io->statcountlist[tetgenio::STAT_ORIENT3D + 2 * i] = 
+      calls[i] - predcalls[i];
+    io->statcountlist[tetgenio::STAT_ORIENT3DEXACT + 2 * i] = 
+      exacts[i] - predexacts[i];
+  }
+  io->statcountlist[tetgenio::STAT_FLIP14] = flip14count;
+  io->statcountlist[tetgenio::STAT_FLIP26] = flip26count;
+  io->statcountlist[tetgenio::STAT_FLIPN2N] = flipn2ncount;
+  io->statcountlist[tetgenio::STAT_FLIP23] = flip23count;
+  io->statcountlist[tetgenio::STAT_FLIP32] = flip32count;
+  io->statcountlist[tetgenio::STAT_FLIP44] = flip44count;
+  io->statcountlist[tetgenio::STAT_FLIP41] = flip41count;
+  io->statcountlist[tetgenio::STAT_FLIP31] = flip31count;
+  io->statcountlist[tetgenio::STAT_FLIP22] = flip22count;
+  io->statcountlist[tetgenio::STAT_NONREGULAR] = nonregularcount;
+
+  if (out == (tetgenio *) NULL) {
+    statout.save_statistics(b->outfilename);
+  }
 }
 
+////                                                                       ////
+////                                                                       ////
+//// meshstat_cxx /////////////////////////////////////////////////////////////
+
+//// output_cxx ///////////////////////////////////////////////////////////////
+////                                                                       ////
+////                                                                       ////
+
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// checkdelaunay()    Ensure that the mesh is (constrained) Delaunay.        //
+// jettisonnodes()    Jettison unused or duplicated vertices.                //
+//                                                                           //
+// Unused points are those input points which are outside the mesh domain or //
+// have no connection (isolated) to the mesh.  Duplicated points exist for   //
+// example if the input PLC is read from a .stl mesh file (marked during the //
+// Delaunay tetrahedralization step. This routine remove these points from   //
+// points list. All existing points are reindexed.                           //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-int tetgenmesh::checkdelaunay(int perturb)
+void tetgenmesh::jettisonnodes()
 {
-  triface tetloop;
-  triface symtet;
-  face checksh;
-  point pa, pb, pc, pd, pe;
-  REAL sign;
-  int ndcount; // Count the non-locally Delaunay faces.
-  int horrors;
+  point pointloop;
+  bool jetflag;
+  int oldidx, newidx;
+  int remcount;
 
   if (!b->quiet) {
-    printf("  Checking Delaunay property of the mesh...\n");
+    printf("Jettisoning redundant points.\n");
   }
 
-  ndcount = 0;
-  horrors = 0;
-  tetloop.ver = 0;
-  // Run through the list of triangles, checking each one.
-  tetrahedrons->traversalinit();
-  tetloop.tet = tetrahedrontraverse();
-  while (tetloop.tet != (tetrahedron *) NULL) {
-    // Check all four faces of the tetrahedron.
-    for (tetloop.ver = 0; tetloop.ver < 4; tetloop.ver++) {
-      fsym(tetloop, symtet);
-      // Only do test if its adjoining tet is not a hull tet or its pointer
-      //   is larger (to ensure that each pair isn't tested twice).
-      if (((point) symtet.tet[7] != dummypoint)&&(tetloop.tet < symtet.tet)) {
-        pa = org(tetloop);
-        pb = dest(tetloop);
-        pc = apex(tetloop);
-        pd = oppo(tetloop);
-        pe = oppo(symtet);
-        if (perturb) {
-          sign = insphere_s(pa, pb, pc, pd, pe);
-        } else {
-          sign = insphere(pa, pb, pc, pd, pe);
-        }
-        if (sign < 0.0) {
-          ndcount++;
-          if (checksubfaceflag) {
-            tspivot(tetloop, checksh);
-          }
-          if (checksh.sh == NULL) {
-            printf("  !! Non-locally Delaunay (%d, %d, %d) - %d, %d\n",
-                   pointmark(pa), pointmark(pb), pointmark(pc), pointmark(pd),
-                   pointmark(pe));
-            horrors++;
-          }
+  points->traversalinit();
+  pointloop = pointtraverse();
+  oldidx = newidx = 0; // in->firstnumber;
+  remcount = 0;
+  while (pointloop != (point) NULL) {
+    jetflag = (pointtype(pointloop) == DUPLICATEDVERTEX) || 
+      (pointtype(pointloop) == UNUSEDVERTEX);
+    if (jetflag) {
+      // It is a duplicated or unused point, delete it.
+      pointdealloc(pointloop);
+      remcount++;
+    } else {
+      // Re-index it.
+      setpointmark(pointloop, newidx + in->firstnumber);
+      if (in->pointmarkerlist != (int *) NULL) {
+        if (oldidx < in->numberofpoints) {
+          // Re-index the point marker as well.
+          in->pointmarkerlist[newidx] = in->pointmarkerlist[oldidx];
         }
       }
+      newidx++;
     }
-    tetloop.tet = tetrahedrontraverse();
+    oldidx++;
+    pointloop = pointtraverse();
   }
-
-  if (horrors == 0) {
-    if (!b->quiet) {
-      if (ndcount > 0) {
-        printf("  The mesh is constrained Delaunay.\n");
-      } else {
-        printf("  The mesh is Delaunay.\n");
-      } 
-    }
-  } else {
-    printf("  !! !! !! !! Found %d non-Delaunay faces.\n", horrors);
+  if (b->verbose) {
+    printf("  %ld duplicated vertices are removed.\n", dupverts);
+    printf("  %ld unused vertices are removed.\n", unuverts);
   }
+  dupverts = 0l;
+  unuverts = 0l;
 
-  return horrors;
+  // The following line ensures that dead items in the pool of nodes cannot
+  //   be allocated for the new created nodes. This ensures that the input
+  //   nodes will occur earlier in the output files, and have lower indices.
+  points->deaditemstack = (void *) NULL;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// Check if the current tetrahedralization is (constrained) regular.         //
+// highorder()   Create extra nodes for quadratic subparametric elements.    //
 //                                                                           //
-// The parameter 'type' determines which regularity should be checked:       //
-//   - 0:  check the Delaunay property.                                      //
-//   - 1:  check the Delaunay property with symbolic perturbation.           //
-//   - 2:  check the regular property, the weights are stored in p[3].       //
-//   - 3:  check the regular property with symbolic perturbation.            //
+// 'highordertable' is an array (size = numberoftetrahedra * 6) for storing  //
+// high-order nodes of each tetrahedron.  This routine is used only when -o2 //
+// switch is used.                                                           //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-int tetgenmesh::checkregular(int type)
+void tetgenmesh::highorder()
 {
-  triface tetloop;
-  triface symtet;
-  face checksh;
-  point p[5];
-  REAL sign;
-  int ndcount; // Count the non-locally Delaunay faces.
-  int horrors;
+  triface tetloop, worktet, spintet;
+  point *extralist, *adjextralist;
+  point torg, tdest, newpoint;
+  int highorderindex;
+  int t1ver;
+  int i, j;
 
   if (!b->quiet) {
-    printf("  Checking %s %s property of the mesh...\n",
-           (type & 2) == 0 ? "Delaunay" : "regular",
-           (type & 1) == 0 ? " " : "(s)");
+    printf("Adding vertices for second-order tetrahedra.\n");
   }
 
-  // Make sure orient3d(p[1], p[0], p[2], p[3]) > 0;
-  //   Hence if (insphere(p[1], p[0], p[2], p[3], p[4]) > 0) means that
-  //     p[4] lies inside the circumsphere of p[1], p[0], p[2], p[3].
-  //   The same if orient4d(p[1], p[0], p[2], p[3], p[4]) > 0 means that
-  //     p[4] lies below the oriented hyperplane passing through 
-  //     p[1], p[0], p[2], p[3].
+  // Initialize the 'highordertable'.
+  highordertable = new point[tetrahedrons->items * 6];
+  if (highordertable == (point *) NULL) {
+    terminatetetgen(this, 1);
+  }
 
-  ndcount = 0;
-  horrors = 0;
-  tetloop.ver = 0;
-  // Run through the list of triangles, checking each one.
+  // This will overwrite the slot for element markers.
+  highorderindex = elemindexindex + 1;
+
+  // The following line ensures that dead items in the pool of nodes cannot
+  //   be allocated for the extra nodes associated with high order elements.
+  //   This ensures that the primary nodes (at the corners of elements) will
+  //   occur earlier in the output files, and have lower indices, than the
+  //   extra nodes.
+  points->deaditemstack = (void *) NULL;
+
+  // Assign an entry for each tetrahedron to find its extra nodes. At the
+  //   mean while, initialize all extra nodes be NULL.
+  i = 0;
   tetrahedrons->traversalinit();
   tetloop.tet = tetrahedrontraverse();
   while (tetloop.tet != (tetrahedron *) NULL) {
-    // Check all four faces of the tetrahedron.
-    for (tetloop.ver = 0; tetloop.ver < 4; tetloop.ver++) {
-      fsym(tetloop, symtet);
-      // Only do test if its adjoining tet is not a hull tet or its pointer
-      //   is larger (to ensure that each pair isn't tested twice).
-      if (((point) symtet.tet[7] != dummypoint)&&(tetloop.tet < symtet.tet)) {
-        p[0] = org(tetloop);   // pa
-        p[1] = dest(tetloop);  // pb
-        p[2] = apex(tetloop);  // pc
-        p[3] = oppo(tetloop);  // pd
-        p[4] = oppo(symtet);   // pe
+    tetloop.tet[highorderindex] = (tetrahedron) &highordertable[i];
+    for (j = 0; j < 6; j++) {
+      highordertable[i + j] = (point) NULL;
+    }
+    i += 6;
+    tetloop.tet = tetrahedrontraverse();
+  }
 
-        if (type == 0) {
-          sign = insphere(p[1], p[0], p[2], p[3], p[4]);
-        } else if (type == 1) {
-          sign = insphere_s(p[1], p[0], p[2], p[3], p[4]);
-        } else if (type == 2) {
-          sign = orient4d(p[1],    p[0],    p[2],    p[3],    p[4], 
-                          p[1][3], p[0][3], p[2][3], p[3][3], p[4][3]);
-        } else { // type == 3
-          sign = orient4d_s(p[1],    p[0],    p[2],    p[3],    p[4], 
-                            p[1][3], p[0][3], p[2][3], p[3][3], p[4][3]);
+  // To create a unique node on each edge. Loop over all tetrahedra, and
+  //   look at the six edges of each tetrahedron.  If the extra node in
+  //   the tetrahedron corresponding to this edge is NULL, create a node
+  //   for this edge, at the same time, set the new node into the extra
+  //   node lists of all other tetrahedra sharing this edge.  
+  tetrahedrons->traversalinit();
+  tetloop.tet = tetrahedrontraverse();
+  while (tetloop.tet != (tetrahedron *) NULL) {
+    // Get the list of extra nodes.
+    extralist = (point *) tetloop.tet[highorderindex];
+    worktet.tet = tetloop.tet;
+    for (i = 0; i < 6; i++) {
+      if (extralist[i] == (point) NULL) {
+        // Go to the ith-edge.
+        worktet.ver = edge2ver[i];
+        // Create a new point in the middle of this edge.
+        torg = org(worktet);
+        tdest = dest(worktet);
+        makepoint(&newpoint, FREEVOLVERTEX);
+        for (j = 0; j < 3 + numpointattrib; j++) {
+          newpoint[j] = 0.5 * (torg[j] + tdest[j]);
         }
-
-        if (sign > 0.0) {
-          ndcount++;
-          if (checksubfaceflag) {
-            tspivot(tetloop, checksh);
-          }
-          if (checksh.sh == NULL) {
-            printf("  !! Non-locally %s (%d, %d, %d) - %d, %d\n",
-                   (type & 2) == 0 ? "Delaunay" : "regular",
-		   pointmark(p[0]), pointmark(p[1]), pointmark(p[2]), 
-                   pointmark(p[3]), pointmark(p[4]));
-            horrors++;
+        // Interpolate its metrics.
+        for (j = 0; j < in->numberofpointmtrs; j++) {
+          newpoint[pointmtrindex + j] = 
+            0.5 * (torg[pointmtrindex + j] + tdest[pointmtrindex + j]);
+        }
+        // Set this point into all extra node lists at this edge.
+        spintet = worktet;
+        while (1) {
+          if (!ishulltet(spintet)) {
+            adjextralist = (point *) spintet.tet[highorderindex];
+            adjextralist[ver2edge[spintet.ver]] = newpoint;
           }
+          fnextself(spintet);
+          if (spintet.tet == worktet.tet) break;
         }
-      }
-    }
+      } // if (!extralist[i])
+    } // i
     tetloop.tet = tetrahedrontraverse();
   }
+}
 
-  if (horrors == 0) {
-    if (!b->quiet) {
-      if (ndcount > 0) {
-        printf("  The mesh is constrained %s.\n",
-               (type & 2) == 0 ? "Delaunay" : "regular");
-      } else {
-        printf("  The mesh is %s.\n", (type & 2) == 0 ? "Delaunay" : "regular");
-      } 
-    }
-  } else {
-    printf("  !! !! !! !! Found %d non-%s faces.\n", horrors,
-           (type & 2) == 0 ? "Delaunay" : "regular");
-  }
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// indexelements()    Index all tetrahedra.                                  //
+//                                                                           //
+// Many output functions require that the tetrahedra are indexed.  This      //
+// routine is called when -E option is used.                                 //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
 
-  return horrors;
+void tetgenmesh::indexelements()
+{
+  triface worktet;
+  int eindex = b->zeroindex ? 0 : in->firstnumber; // firstindex;
+  tetrahedrons->traversalinit();
+  worktet.tet = tetrahedrontraverse();
+  while (worktet.tet != NULL) {
+    setelemindex(worktet.tet, eindex);
+    eindex++;
+	if (b->metric) { // -m option
+	  // Update the point-to-tet map, so that every point is pointing
+	  //   to a real tet, not a fictious one. Used by .p2t file.
+	  tetrahedron tptr = encode(worktet);
+	  for (int i = 0; i < 4; i++) {
+	    setpoint2tet((point) (worktet.tet[4 + i]), tptr);
+	  }
+	}
+    worktet.tet = tetrahedrontraverse();
+  }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// checkconforming()    Ensure that the mesh is conforming Delaunay.         //
+// numberedges()    Count the number of edges, save in "meshedges".          //
 //                                                                           //
-// If 'flag' is 1, only check subsegments. If 'flag' is 2, check subfaces.   //
-// If 'flag' is 3, check both subsegments and subfaces.                      //
+// This routine is called when '-p' or '-r', and '-E' options are used.  The //
+// total number of edges depends on the genus of the input surface mesh.     //
+//                                                                           //
+// NOTE:  This routine must be called after outelements().  So all elements  //
+// have been indexed.                                                        //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-int tetgenmesh::checkconforming(int flag)
+void tetgenmesh::numberedges()
 {
-  triface searchtet, neightet, spintet;
-  face shloop;
-  face segloop;
-  point eorg, edest, eapex, pa, pb, pc;
-  REAL cent[3], radius, dist, diff, rd, len;
-  bool enq;
-  int encsubsegs, encsubfaces;
-  int t1ver; 
+  triface worktet, spintet;
+  int ishulledge;
+  int t1ver;
   int i;
 
-  REAL A[4][4], rhs[4], D;
-  int indx[4];
-  REAL elen[3];
-
-  encsubsegs = 0;
-
-  if (flag & 1) {
-    if (!b->quiet) {
-      printf("  Checking conforming property of segments...\n");
-    }
-    encsubsegs = 0;
-
-    // Run through the list of subsegments, check each one.
-    subsegs->traversalinit();
-    segloop.sh = shellfacetraverse(subsegs);
-    while (segloop.sh != (shellface *) NULL) {
-      eorg = (point) segloop.sh[3];
-      edest = (point) segloop.sh[4];
-      radius = 0.5 * distance(eorg, edest);
-      for (i = 0; i < 3; i++) cent[i] = 0.5 * (eorg[i] + edest[i]);
+  meshedges = meshhulledges = 0l;
 
-      enq = false;
-      sstpivot1(segloop, neightet);
-      if (neightet.tet != NULL) {
-        spintet = neightet;
-        while (1) {
-          eapex= apex(spintet);
-          if (eapex != dummypoint) {
-            dist = distance(eapex, cent);
-            diff = dist - radius;
-            if (fabs(diff) / radius <= b->epsilon) diff = 0.0; // Rounding.
-            if (diff < 0) {
-              enq = true; break;
-            }
-          }
-          fnextself(spintet);
-          if (spintet.tet == neightet.tet) break;
+  tetrahedrons->traversalinit();
+  worktet.tet = tetrahedrontraverse();
+  while (worktet.tet != NULL) {
+    for (i = 0; i < 6; i++) {
+      worktet.ver = edge2ver[i];
+      ishulledge = 0;
+      fnext(worktet, spintet);
+      do {
+        if (!ishulltet(spintet)) {
+          if (elemindex(spintet.tet) < elemindex(worktet.tet)) break;
+        } else {
+          ishulledge = 1;
         }
+        fnextself(spintet);
+      } while (spintet.tet != worktet.tet);
+      if (spintet.tet == worktet.tet) {
+        meshedges++;
+        if (ishulledge) meshhulledges++;
       }
-      if (enq) {
-        printf("  !! !! Non-conforming segment: (%d, %d)\n",
-               pointmark(eorg), pointmark(edest));
-        encsubsegs++;
-      }
-      segloop.sh = shellfacetraverse(subsegs);
     }
+    infect(worktet);
+    worktet.tet = tetrahedrontraverse();
+  }
+}
 
-    if (encsubsegs == 0) {
-      if (!b->quiet) {
-        printf("  The segments are conforming Delaunay.\n");
-      }
-    } else {
-      printf("  !! !! %d subsegments are non-conforming.\n", encsubsegs);
-    }
-  } // if (flag & 1)
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// outnodes()    Output the points to a .node file or a tetgenio structure.  //
+//                                                                           //
+// Note: each point has already been numbered on input (the first index is   //
+// 'in->firstnumber').                                                       //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
 
-  encsubfaces = 0;
+void tetgenmesh::outnodes(tetgenio* out)
+{
+  FILE *outfile = NULL;
+  char outnodefilename[FILENAMESIZE];
+  face parentsh;
+  point pointloop;
+  int nextras, bmark, marker = 0, weightDT = 0; 
+  int coordindex, attribindex;
+  int pointnumber, firstindex;
+  int index, i;
 
-  if (flag & 2) {
-    if (!b->quiet) {
-      printf("  Checking conforming property of subfaces...\n");
-    }
+  if (out == (tetgenio *) NULL) {
+    strcpy(outnodefilename, b->outfilename);
+    strcat(outnodefilename, ".node");
+  }
 
-    // Run through the list of subfaces, check each one.
-    subfaces->traversalinit();
-    shloop.sh = shellfacetraverse(subfaces);
-    while (shloop.sh != (shellface *) NULL) {
-      pa = (point) shloop.sh[3];
-      pb = (point) shloop.sh[4];
-      pc = (point) shloop.sh[5];
+  if (!b->quiet) {
+    if (out == (tetgenio *) NULL) {
+      printf("Writing %s.\n", outnodefilename);
+    } else {
+      printf("Writing nodes.\n");
+    }
+  }
 
-      // Compute the coefficient matrix A (3x3).
-      A[0][0] = pb[0] - pa[0];
-      A[0][1] = pb[1] - pa[1];
-      A[0][2] = pb[2] - pa[2]; // vector V1 (pa->pb)
-      A[1][0] = pc[0] - pa[0];
-      A[1][1] = pc[1] - pa[1];
-      A[1][2] = pc[2] - pa[2]; // vector V2 (pa->pc)
-      cross(A[0], A[1], A[2]); // vector V3 (V1 X V2)
+  nextras = numpointattrib;
+  if (b->weighted) { // -w
+    if (b->weighted_param == 0) weightDT = 1; // Weighted DT.
+  }
 
-      // Compute the right hand side vector b (3x1).
-      elen[0] = dot(A[0], A[0]);
-      elen[1] = dot(A[1], A[1]);
-      rhs[0] = 0.5 * elen[0];
-      rhs[1] = 0.5 * elen[1];
-      rhs[2] = 0.0;
+  bmark = !b->nobound && in->pointmarkerlist;
 
-      if (lu_decmp(A, 3, indx, &D, 0)) {
-        lu_solve(A, 3, indx, rhs, 0);
-        cent[0] = pa[0] + rhs[0];
-        cent[1] = pa[1] + rhs[1];
-        cent[2] = pa[2] + rhs[2];
-        rd = sqrt(rhs[0] * rhs[0] + rhs[1] * rhs[1] + rhs[2] * rhs[2]);
+  if (out == (tetgenio *) NULL) {
+    outfile = fopen(outnodefilename, "w");
+    if (outfile == (FILE *) NULL) {
+      printf("File I/O Error:  Cannot create file %s.\n", outnodefilename);
+      terminatetetgen(this, 1);
+    }
+    // Number of points, number of dimensions, number of point attributes,
+    //   and number of boundary markers (zero or one).
+    fprintf(outfile, "%ld  %d  %d  %d\n", points->items, 3, nextras, bmark);
+  } else {
+    // Allocate space for 'pointlist';
+    out->pointlist = new REAL[points->items * 3];
+    if (out->pointlist == (REAL *) NULL) {
+      printf("Error:  Out of memory.\n");
+      terminatetetgen(this, 1);
+    }
+    // Allocate space for 'pointattributelist' if necessary;
+    if (nextras > 0) {
+      out->pointattributelist = new REAL[points->items * nextras];
+      if (out->pointattributelist == (REAL *) NULL) {
+        printf("Error:  Out of memory.\n");
+        terminatetetgen(this, 1);
+      }
+    }
+    // Allocate space for 'pointmarkerlist' if necessary;
+    if (bmark) {
+      out->pointmarkerlist = new int[points->items];
+      if (out->pointmarkerlist == (int *) NULL) {
+        printf("Error:  Out of memory.\n");
+        terminatetetgen(this, 1);
+      }
+    }
+    if (b->psc) {
+      out->pointparamlist = new tetgenio::pointparam[points->items];
+      if (out->pointparamlist == NULL) {
+        printf("Error:  Out of memory.\n");
+        terminatetetgen(this, 1);
+      }
+    }
+    out->numberofpoints = points->items;
+    out->numberofpointattributes = nextras;
+    coordindex = 0;
+    attribindex = 0;
+  }
+  
+  // Determine the first index (0 or 1).
+  firstindex = b->zeroindex ? 0 : in->firstnumber;
 
-        // Check if this subface is encroached.
-        for (i = 0; i < 2; i++) {
-          stpivot(shloop, searchtet);
-          if (!ishulltet(searchtet)) {
-            len = distance(oppo(searchtet), cent);
-            if ((fabs(len - rd) / rd) < b->epsilon) len = rd; // Rounding.
-            if (len < rd) {
-              printf("  !! !! Non-conforming subface: (%d, %d, %d)\n",
-                     pointmark(pa), pointmark(pb), pointmark(pc));
-              encsubfaces++;
-              enq = true; break;
-            }
+  points->traversalinit();
+  pointloop = pointtraverse();
+  pointnumber = firstindex; // in->firstnumber;
+  index = 0;
+  while (pointloop != (point) NULL) {
+    if (bmark) {
+      // Default the vertex has a zero marker.
+      marker = 0;
+      // Is it an input vertex?
+      if (index < in->numberofpoints) {
+        // Input point's marker is directly copied to output.
+        marker = in->pointmarkerlist[index];       
+      } else {
+        if ((pointtype(pointloop) == FREESEGVERTEX) ||
+            (pointtype(pointloop) == FREEFACETVERTEX)) {
+          sdecode(point2sh(pointloop), parentsh);
+          if (parentsh.sh != NULL) {
+            marker = shellmark(parentsh);
           }
-          sesymself(shloop);
-        }
+        } // if (pointtype(...))
       }
-      shloop.sh = shellfacetraverse(subfaces);
     }
-
-    if (encsubfaces == 0) {
-      if (!b->quiet) {
-        printf("  The subfaces are conforming Delaunay.\n");
+    if (out == (tetgenio *) NULL) {
+      // Point number, x, y and z coordinates.
+      fprintf(outfile, "%4d    %.17g  %.17g  %.17g", pointnumber,
+              pointloop[0], pointloop[1], pointloop[2]);
+      for (i = 0; i < nextras; i++) {
+        // Write an attribute.
+        if ((i == 0) && weightDT) {          
+          fprintf(outfile, "  %.17g", pointloop[0] * pointloop[0] +
+             pointloop[1] * pointloop[1] + pointloop[2] * pointloop[2] 
+             - pointloop[3 + i]);
+        } else { 
+          fprintf(outfile, "  %.17g", pointloop[3 + i]);
+        }
+      }
+      if (bmark) {
+        // Write the boundary marker.
+        fprintf(outfile, "    %d", marker);
+      }
+      if (b->psc) {
+        fprintf(outfile, "  %.8g  %.8g  %d", pointgeomuv(pointloop, 0),
+                pointgeomuv(pointloop, 1), pointgeomtag(pointloop));
+        if (pointtype(pointloop) == RIDGEVERTEX) {
+          fprintf(outfile, "  0");
+        } else if (pointtype(pointloop) == ACUTEVERTEX) {
+          fprintf(outfile, "  0");
+        } else if (pointtype(pointloop) == FREESEGVERTEX) {
+          fprintf(outfile, "  1");
+        } else if (pointtype(pointloop) == FREEFACETVERTEX) {
+          fprintf(outfile, "  2");
+        } else if (pointtype(pointloop) == FREEVOLVERTEX) {
+          fprintf(outfile, "  3");
+        } else {
+          fprintf(outfile, "  -1"); // Unknown type.
+        }
       }
+      fprintf(outfile, "\n");
     } else {
-      printf("  !! !! %d subfaces are non-conforming.\n", encsubfaces);
+      // X, y, and z coordinates.
+      out->pointlist[coordindex++] = pointloop[0];
+      out->pointlist[coordindex++] = pointloop[1];
+      out->pointlist[coordindex++] = pointloop[2];
+      // Point attributes.
+      for (i = 0; i < nextras; i++) {
+        // Output an attribute.
+        if ((i == 0) && weightDT) {
+          out->pointattributelist[attribindex++] = 
+            pointloop[0] * pointloop[0] + pointloop[1] * pointloop[1] + 
+            pointloop[2] * pointloop[2] - pointloop[3 + i];
+        } else {
+          out->pointattributelist[attribindex++] = pointloop[3 + i];
+        }
+      }
+      if (bmark) {
+        // Output the boundary marker.  
+        out->pointmarkerlist[index] = marker;
+      }
+      if (b->psc) {
+        out->pointparamlist[index].uv[0] = pointgeomuv(pointloop, 0);
+        out->pointparamlist[index].uv[1] = pointgeomuv(pointloop, 1);
+        out->pointparamlist[index].tag = pointgeomtag(pointloop);
+        if (pointtype(pointloop) == RIDGEVERTEX) {
+          out->pointparamlist[index].type = 0;
+        } else if (pointtype(pointloop) == ACUTEVERTEX) {
+          out->pointparamlist[index].type = 0;
+        } else if (pointtype(pointloop) == FREESEGVERTEX) {
+          out->pointparamlist[index].type = 1;
+        } else if (pointtype(pointloop) == FREEFACETVERTEX) {
+          out->pointparamlist[index].type = 2;
+        } else if (pointtype(pointloop) == FREEVOLVERTEX) {
+          out->pointparamlist[index].type = 3;
+        } else {
+          out->pointparamlist[index].type = -1; // Unknown type.
+        }
+      }
     }
-  } // if (flag & 2)
+    pointloop = pointtraverse();
+    pointnumber++; 
+    index++;
+  }
 
-  return encsubsegs + encsubfaces;
+  if (out == (tetgenio *) NULL) {
+    fprintf(outfile, "# Generated by %s\n", b->commandline);
+    fclose(outfile);
+  }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// qualitystatistics()    Print statistics about the quality of the mesh.    //
+// outmetrics()    Output the metric to a file (*.mtr) or a tetgenio obj.    //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-void tetgenmesh::qualitystatistics()
+void tetgenmesh::outmetrics(tetgenio* out)
 {
-  triface tetloop, neightet;
-  point p[4];
-  char sbuf[128];
-  REAL radiusratiotable[12];
-  REAL aspectratiotable[12];
-  REAL A[4][4], rhs[4], D;
-  REAL V[6][3], N[4][3], H[4]; // edge-vectors, face-normals, face-heights.
-  REAL edgelength[6], alldihed[6], faceangle[3];
-  REAL shortest, longest;
-  REAL smallestvolume, biggestvolume;
-  REAL smallestratio, biggestratio;
-  REAL smallestdiangle, biggestdiangle;
-  REAL smallestfaangle, biggestfaangle;
-  REAL total_tet_vol, total_tetprism_vol;
-  REAL tetvol, minaltitude;
-  REAL cirradius, minheightinv; // insradius;
-  REAL shortlen, longlen;
-  REAL tetaspect, tetradius;
-  REAL smalldiangle, bigdiangle;
-  REAL smallfaangle, bigfaangle;
-  unsigned long radiustable[12];
-  unsigned long aspecttable[16];
-  unsigned long dihedangletable[18];
-  unsigned long faceangletable[18];
-  int indx[4];
-  int radiusindex;
-  int aspectindex;
-  int tendegree;
-  int i, j;
-
-  printf("Mesh quality statistics:\n\n");
-
-  shortlen = longlen = 0.0;
-  smalldiangle = bigdiangle = 0.0;
-  total_tet_vol = 0.0;
-  total_tetprism_vol = 0.0;
-
-  radiusratiotable[0]  =    0.707;    radiusratiotable[1]  =     1.0;
-  radiusratiotable[2]  =      1.1;    radiusratiotable[3]  =     1.2;
-  radiusratiotable[4]  =      1.4;    radiusratiotable[5]  =     1.6;
-  radiusratiotable[6]  =      1.8;    radiusratiotable[7]  =     2.0;
-  radiusratiotable[8]  =      2.5;    radiusratiotable[9]  =     3.0;
-  radiusratiotable[10] =     10.0;    radiusratiotable[11] =     0.0;
+  FILE *outfile = NULL;
+  char outmtrfilename[FILENAMESIZE];
+  point ptloop;
+  int mtrindex = 0;
+  int i;
+  int msize = (sizeoftensor - useinsertradius);
+  if (msize == 0) {
+    return;
+  }
 
-  aspectratiotable[0]  =      1.5;    aspectratiotable[1]  =     2.0;
-  aspectratiotable[2]  =      2.5;    aspectratiotable[3]  =     3.0;
-  aspectratiotable[4]  =      4.0;    aspectratiotable[5]  =     6.0;
-  aspectratiotable[6]  =     10.0;    aspectratiotable[7]  =    15.0;
-  aspectratiotable[8]  =     25.0;    aspectratiotable[9]  =    50.0;
-  aspectratiotable[10] =    100.0;    aspectratiotable[11] =     0.0;
-  
-  for (i = 0; i < 12; i++) radiustable[i] = 0l;
-  for (i = 0; i < 12; i++) aspecttable[i] = 0l;
-  for (i = 0; i < 18; i++) dihedangletable[i] = 0l;
-  for (i = 0; i < 18; i++) faceangletable[i] = 0l;
+  if (out == (tetgenio *) NULL) {
+    strcpy(outmtrfilename, b->outfilename);
+    strcat(outmtrfilename, ".mtr");
+  }
 
-  minaltitude = xmax - xmin + ymax - ymin + zmax - zmin;
-  minaltitude = minaltitude * minaltitude;
-  shortest = minaltitude;
-  longest = 0.0;
-  smallestvolume = minaltitude;
-  biggestvolume = 0.0;
-  smallestratio = 1e+16; // minaltitude;
-  biggestratio = 0.0;
-  smallestdiangle = smallestfaangle = 180.0;
-  biggestdiangle = biggestfaangle = 0.0;
+  if (!b->quiet) {
+    if (out == (tetgenio *) NULL) {
+      printf("Writing %s.\n", outmtrfilename);
+    } else {
+      printf("Writing metrics.\n");
+    }
+  }
 
+  if (out == (tetgenio *) NULL) {
+    outfile = fopen(outmtrfilename, "w");
+    if (outfile == (FILE *) NULL) {
+      printf("File I/O Error:  Cannot create file %s.\n", outmtrfilename);
+      terminatetetgen(this, 3);
+    }
+    // Number of points, number of point metrices,
+    fprintf(outfile, "%ld  %d\n", points->items, msize);
+  } else {
+    // Allocate space for 'pointmtrlist'.
+    out->numberofpointmtrs = msize; 
+    out->pointmtrlist = new REAL[points->items * msize];
+    if (out->pointmtrlist == (REAL *) NULL) {
+      terminatetetgen(this, 1);
+    }
+  }
 
-  int attrnum = numelemattrib - 1;
+  points->traversalinit();
+  ptloop = pointtraverse();
+  while (ptloop != (point) NULL) {
+    if (out == (tetgenio *) NULL) {
+      for (i = 0; i < msize; i++) {
+        fprintf(outfile, " %-16.8e", ptloop[pointmtrindex + i]);
+      }
+      fprintf(outfile, "\n");
+    } else {
+      for (i = 0; i < msize; i++) {
+        out->pointmtrlist[mtrindex++] = ptloop[pointmtrindex + i];
+      }
+    }
+    ptloop = pointtraverse();
+  }
 
-  // Loop all elements, calculate quality parameters for each element.
-  tetrahedrons->traversalinit();
-  tetloop.tet = tetrahedrontraverse();
-  while (tetloop.tet != (tetrahedron *) NULL) {
+  // Output the point-to-tet map.
+  if (out == (tetgenio *) NULL) {
+    strcpy(outmtrfilename, b->outfilename);
+    strcat(outmtrfilename, ".p2t");
+  }
 
-    if (b->convex) {
-      // Skip tets in the exterior.
-      if (elemattribute(tetloop.tet, attrnum) == -1.0) {
-        tetloop.tet = tetrahedrontraverse();
-        continue;
-      }
+  if (!b->quiet) {
+    if (out == (tetgenio *) NULL) {
+      printf("Writing %s.\n", outmtrfilename);
+    } else {
+      printf("Writing point-to-tet map.\n");
     }
+  }
 
-    // Get four vertices: p0, p1, p2, p3.
-    for (i = 0; i < 4; i++) p[i] = (point) tetloop.tet[4 + i];
+  if (out == (tetgenio *) NULL) {
+    outfile = fopen(outmtrfilename, "w");
+    if (outfile == (FILE *) NULL) {
+      printf("File I/O Error:  Cannot create file %s.\n", outmtrfilename);
+      terminatetetgen(this, 3);
+    }
+    // Number of points,
+    //fprintf(outfile, "%ld\n", points->items);
+  } else {
+    // Allocate space for 'point2tetlist'.
+    out->point2tetlist = new int[points->items];
+    if (out->point2tetlist == (int *) NULL) {
+      terminatetetgen(this, 1);
+    }
+  }
 
-    // Get the tet volume.
-    tetvol = orient3dfast(p[1], p[0], p[2], p[3]) / 6.0;
-    total_tet_vol += tetvol;
-    total_tetprism_vol += tetprismvol(p[0], p[1], p[2], p[3]);
+  // The list of tetrahedra must be indexed.
+  if (bgm != NULL) {
+    bgm->indexelements();
+  }
+  // Determine the first index (0 or 1).
+  int firstindex = b->zeroindex ? 0 : in->firstnumber;
+  int pointindex = firstindex;
+  i = 0;
 
-    // Calculate the largest and smallest volume.
-    if (tetvol < smallestvolume) {
-      smallestvolume = tetvol;
-    } 
-    if (tetvol > biggestvolume) {
-      biggestvolume = tetvol;
+  triface parenttet;
+  points->traversalinit();
+  ptloop = pointtraverse();
+  while (ptloop != (point) NULL) {
+    if (bgm != NULL) {
+	  bgm->decode(point2bgmtet(ptloop), parenttet);
+	} else {
+	  decode(point2tet(ptloop), parenttet);
+	}
+    if (out == (tetgenio *) NULL) {
+      fprintf(outfile, "%d  %d\n", pointindex, elemindex(parenttet.tet));
+    } else {
+      out->point2tetlist[i] = elemindex(parenttet.tet);
     }
+	pointindex++;
+	i++;
+    ptloop = pointtraverse();
+  }
 
-    // Set the edge vectors: V[0], ..., V[5]
-    for (i = 0; i < 3; i++) V[0][i] = p[0][i] - p[3][i]; // V[0]: p3->p0.
-    for (i = 0; i < 3; i++) V[1][i] = p[1][i] - p[3][i]; // V[1]: p3->p1.
-    for (i = 0; i < 3; i++) V[2][i] = p[2][i] - p[3][i]; // V[2]: p3->p2.
-    for (i = 0; i < 3; i++) V[3][i] = p[1][i] - p[0][i]; // V[3]: p0->p1.
-    for (i = 0; i < 3; i++) V[4][i] = p[2][i] - p[1][i]; // V[4]: p1->p2.
-    for (i = 0; i < 3; i++) V[5][i] = p[0][i] - p[2][i]; // V[5]: p2->p0.
+  if (out == (tetgenio *) NULL) {
+    fprintf(outfile, "# Generated by %s\n", b->commandline);
+    fclose(outfile);
+  }
+}
 
-    // Get the squares of the edge lengths.
-    for (i = 0; i < 6; i++) edgelength[i] = dot(V[i], V[i]);
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// outelements()    Output the tetrahedra to an .ele file or a tetgenio      //
+//                  structure.                                               //
+//                                                                           //
+// This routine also indexes all tetrahedra (exclusing hull tets) (from in-> //
+// firstnumber). The total number of mesh edges is counted in 'meshedges'.   //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
 
-    // Calculate the longest and shortest edge length.
-    for (i = 0; i < 6; i++) {
-      if (i == 0) {
-        shortlen = longlen = edgelength[i];
-      } else {
-        shortlen = edgelength[i] < shortlen ? edgelength[i] : shortlen;
-        longlen  = edgelength[i] > longlen  ? edgelength[i] : longlen;
-      }
-      if (edgelength[i] > longest) {
-        longest = edgelength[i];
-      } 
-      if (edgelength[i] < shortest) {
-        shortest = edgelength[i];
-      }
-    }
+void tetgenmesh::outelements(tetgenio* out)
+{
+  FILE *outfile = NULL;
+  char outelefilename[FILENAMESIZE];
+  tetrahedron* tptr;
+  point p1, p2, p3, p4;
+  point *extralist;
+  REAL *talist = NULL;
+  int *tlist = NULL;
+  long ntets;
+  int firstindex, shift;
+  int pointindex, attribindex;
+  int highorderindex = elemindexindex + 1; 
+  int elementnumber;
+  int eextras;
+  int i;
 
-    // Set the matrix A = [V[0], V[1], V[2]]^T.
-    for (j = 0; j < 3; j++) {
-      for (i = 0; i < 3; i++) A[j][i] = V[j][i];
-    }
+  if (out == (tetgenio *) NULL) {
+    strcpy(outelefilename, b->outfilename);
+    strcat(outelefilename, ".ele");
+  }
 
-    // Decompose A just once.
-    if (lu_decmp(A, 3, indx, &D, 0)) {   
-      // Get the three faces normals.
-      for (j = 0; j < 3; j++) {
-        for (i = 0; i < 3; i++) rhs[i] = 0.0;
-        rhs[j] = 1.0;  // Positive means the inside direction
-        lu_solve(A, 3, indx, rhs, 0);
-        for (i = 0; i < 3; i++) N[j][i] = rhs[i];
-      }
-      // Get the fourth face normal by summing up the first three.
-      for (i = 0; i < 3; i++) N[3][i] = - N[0][i] - N[1][i] - N[2][i];
-      // Get the radius of the circumsphere.
-      for (i = 0; i < 3; i++) rhs[i] = 0.5 * dot(V[i], V[i]);
-      lu_solve(A, 3, indx, rhs, 0);
-      cirradius = sqrt(dot(rhs, rhs));
-      // Normalize the face normals.
-      for (i = 0; i < 4; i++) {
-        // H[i] is the inverse of height of its corresponding face.
-        H[i] = sqrt(dot(N[i], N[i]));
-        for (j = 0; j < 3; j++) N[i][j] /= H[i];
-      }
-      // Get the radius of the inscribed sphere.
-      // insradius = 1.0 / (H[0] + H[1] + H[2] + H[3]);
-      // Get the biggest H[i] (corresponding to the smallest height).
-      minheightinv = H[0];
-      for (i = 1; i < 4; i++) {
-        if (H[i] > minheightinv) minheightinv = H[i];
-      }
+  if (!b->quiet) {
+    if (out == (tetgenio *) NULL) {
+      printf("Writing %s.\n", outelefilename);
     } else {
-      // A nearly degenerated tet.
-      if (tetvol <= 0.0) {
-        printf("  !! Warning:  A %s tet (%d,%d,%d,%d).\n", 
-               tetvol < 0 ? "inverted" : "degenerated", pointmark(p[0]),
-               pointmark(p[1]), pointmark(p[2]), pointmark(p[3]));
-        // Skip it.        
-        tetloop.tet = tetrahedrontraverse();
-        continue;
-      }
-      // Calculate the four face normals.
-      facenormal(p[2], p[1], p[3], N[0], 1, NULL);
-      facenormal(p[0], p[2], p[3], N[1], 1, NULL);
-      facenormal(p[1], p[0], p[3], N[2], 1, NULL);
-      facenormal(p[0], p[1], p[2], N[3], 1, NULL);
-      // Normalize the face normals.
-      for (i = 0; i < 4; i++) {
-        // H[i] is the twice of the area of the face.
-        H[i] = sqrt(dot(N[i], N[i]));
-        for (j = 0; j < 3; j++) N[i][j] /= H[i];
-      }
-      // Get the biggest H[i] / tetvol (corresponding to the smallest height).
-      minheightinv = (H[0] / tetvol);
-      for (i = 1; i < 4; i++) {
-        if ((H[i] / tetvol) > minheightinv) minheightinv = (H[i] / tetvol);
-      }
-      // Let the circumradius to be the half of its longest edge length.
-      cirradius = 0.5 * sqrt(longlen);
+      printf("Writing elements.\n");
     }
+  }
 
-    // Get the dihedrals (in degree) at each edges.
-    j = 0;
-    for (i = 1; i < 4; i++) {
-      alldihed[j] = -dot(N[0], N[i]); // Edge cd, bd, bc.
-      if (alldihed[j] < -1.0) alldihed[j] = -1; // Rounding.
-      else if (alldihed[j] > 1.0) alldihed[j] = 1;
-      alldihed[j] = acos(alldihed[j]) / PI * 180.0;
-      j++;
+  // The number of tets excluding hull tets.
+  ntets = tetrahedrons->items - hullsize;
+
+  eextras = numelemattrib;
+  if (out == (tetgenio *) NULL) {
+    outfile = fopen(outelefilename, "w");
+    if (outfile == (FILE *) NULL) {
+      printf("File I/O Error:  Cannot create file %s.\n", outelefilename);
+      terminatetetgen(this, 1);
     }
-    for (i = 2; i < 4; i++) {
-      alldihed[j] = -dot(N[1], N[i]); // Edge ad, ac.
-      if (alldihed[j] < -1.0) alldihed[j] = -1; // Rounding.
-      else if (alldihed[j] > 1.0) alldihed[j] = 1;
-      alldihed[j] = acos(alldihed[j]) / PI * 180.0;
-      j++;
+    // Number of tetras, points per tetra, attributes per tetra.
+    fprintf(outfile, "%ld  %d  %d\n", ntets, b->order == 1 ? 4 : 10, eextras);
+  } else {
+    // Allocate memory for output tetrahedra.
+    out->tetrahedronlist = new int[ntets * (b->order == 1 ? 4 : 10)];
+    if (out->tetrahedronlist == (int *) NULL) {
+      printf("Error:  Out of memory.\n");
+      terminatetetgen(this, 1);
     }
-    alldihed[j] = -dot(N[2], N[3]); // Edge ab.
-    if (alldihed[j] < -1.0) alldihed[j] = -1; // Rounding.
-    else if (alldihed[j] > 1.0) alldihed[j] = 1;
-    alldihed[j] = acos(alldihed[j]) / PI * 180.0;
-
-    // Calculate the largest and smallest dihedral angles.
-    for (i = 0; i < 6; i++) {
-      if (i == 0) {
-        smalldiangle = bigdiangle = alldihed[i];
-      } else {
-        smalldiangle = alldihed[i] < smalldiangle ? alldihed[i] : smalldiangle;
-        bigdiangle = alldihed[i] > bigdiangle ? alldihed[i] : bigdiangle;
-      }
-      if (alldihed[i] < smallestdiangle) {
-        smallestdiangle = alldihed[i];
-      } 
-      if (alldihed[i] > biggestdiangle) {
-        biggestdiangle = alldihed[i];
-      }
-      // Accumulate the corresponding number in the dihedral angle histogram.
-      if (alldihed[i] < 5.0) {
-        tendegree = 0;
-      } else if (alldihed[i] >= 5.0 && alldihed[i] < 10.0) {
-        tendegree = 1;
-      } else if (alldihed[i] >= 80.0 && alldihed[i] < 110.0) {
-        tendegree = 9; // Angles between 80 to 110 degree are in one entry.
-      } else if (alldihed[i] >= 170.0 && alldihed[i] < 175.0) {
-        tendegree = 16;
-      } else if (alldihed[i] >= 175.0) {
-        tendegree = 17;
-      } else {
-        tendegree = (int) (alldihed[i] / 10.);
-        if (alldihed[i] < 80.0) {
-          tendegree++;  // In the left column.
-        } else {
-          tendegree--;  // In the right column.
-        }
+    // Allocate memory for output tetrahedron attributes if necessary.
+    if (eextras > 0) {
+      out->tetrahedronattributelist = new REAL[ntets * eextras];
+      if (out->tetrahedronattributelist == (REAL *) NULL) {
+        printf("Error:  Out of memory.\n");
+        terminatetetgen(this, 1);
       }
-      dihedangletable[tendegree]++;
     }
+    out->numberoftetrahedra = ntets;
+    out->numberofcorners = b->order == 1 ? 4 : 10;
+    out->numberoftetrahedronattributes = eextras;
+    tlist = out->tetrahedronlist;
+    talist = out->tetrahedronattributelist;
+    pointindex = 0;
+    attribindex = 0;
+  }
 
+  // Determine the first index (0 or 1).
+  firstindex = b->zeroindex ? 0 : in->firstnumber;
+  shift = 0; // Default no shift.
+  if ((in->firstnumber == 1) && (firstindex == 0)) {
+    shift = 1; // Shift the output indices by 1.
+  }
 
-
-    // Calculate the largest and smallest face angles.
-    for (tetloop.ver = 0; tetloop.ver < 4; tetloop.ver++) {
-      fsym(tetloop, neightet);
-      // Only do the calulation once for a face.
-      if (((point) neightet.tet[7] == dummypoint) || 
-          (tetloop.tet < neightet.tet)) {
-        p[0] = org(tetloop);
-        p[1] = dest(tetloop);
-        p[2] = apex(tetloop);
-        faceangle[0] = interiorangle(p[0], p[1], p[2], NULL);
-        faceangle[1] = interiorangle(p[1], p[2], p[0], NULL);
-        faceangle[2] = PI - (faceangle[0] + faceangle[1]);
-        // Translate angles into degrees.
-        for (i = 0; i < 3; i++) {
-          faceangle[i] = (faceangle[i] * 180.0) / PI;
-        }
-        // Calculate the largest and smallest face angles.
-        for (i = 0; i < 3; i++) {
-          if (i == 0) {
-            smallfaangle = bigfaangle = faceangle[i];
-          } else {
-            smallfaangle = faceangle[i] < smallfaangle ? 
-              faceangle[i] : smallfaangle;
-            bigfaangle = faceangle[i] > bigfaangle ? faceangle[i] : bigfaangle;
-          }
-          if (faceangle[i] < smallestfaangle) {
-            smallestfaangle = faceangle[i];
-          } 
-          if (faceangle[i] > biggestfaangle) {
-            biggestfaangle = faceangle[i];
-          }
-          tendegree = (int) (faceangle[i] / 10.);
-          faceangletable[tendegree]++;
-        }
-      }
-    }
-
-    // Calculate aspect ratio and radius-edge ratio for this element.
-    tetradius = cirradius / sqrt(shortlen);
-    // tetaspect = sqrt(longlen) / (2.0 * insradius);
-    tetaspect = sqrt(longlen) * minheightinv;
-    // Remember the largest and smallest aspect ratio.
-    if (tetaspect < smallestratio) {
-      smallestratio = tetaspect;
-    } 
-    if (tetaspect > biggestratio) {
-      biggestratio = tetaspect;
-    }
-    // Accumulate the corresponding number in the aspect ratio histogram.
-    aspectindex = 0;
-    while ((tetaspect > aspectratiotable[aspectindex]) && (aspectindex < 11)) {
-      aspectindex++;
+  tetrahedrons->traversalinit();
+  tptr = tetrahedrontraverse();
+  elementnumber = firstindex; // in->firstnumber;
+  while (tptr != (tetrahedron *) NULL) {
+    if (!b->reversetetori) {
+      p1 = (point) tptr[4];
+      p2 = (point) tptr[5];
+    } else {
+      p1 = (point) tptr[5];
+      p2 = (point) tptr[4];
     }
-    aspecttable[aspectindex]++;
-    radiusindex = 0;
-    while ((tetradius > radiusratiotable[radiusindex]) && (radiusindex < 11)) {
-      radiusindex++;
+    p3 = (point) tptr[6];
+    p4 = (point) tptr[7];
+    if (out == (tetgenio *) NULL) {
+      // Tetrahedron number, indices for four points.
+      fprintf(outfile, "%5d   %5d %5d %5d %5d", elementnumber,
+              pointmark(p1) - shift, pointmark(p2) - shift,
+              pointmark(p3) - shift, pointmark(p4) - shift);
+      if (b->order == 2) {
+        extralist = (point *) tptr[highorderindex];
+        // indices for six extra points.
+        fprintf(outfile, "  %5d %5d %5d %5d %5d %5d",
+          pointmark(extralist[0]) - shift, pointmark(extralist[1]) - shift,
+          pointmark(extralist[2]) - shift, pointmark(extralist[3]) - shift,
+          pointmark(extralist[4]) - shift, pointmark(extralist[5]) - shift);
+      }
+      for (i = 0; i < eextras; i++) {
+        fprintf(outfile, "    %.17g", elemattribute(tptr, i));
+      }
+      fprintf(outfile, "\n");
+    } else {
+      tlist[pointindex++] = pointmark(p1) - shift;
+      tlist[pointindex++] = pointmark(p2) - shift;
+      tlist[pointindex++] = pointmark(p3) - shift;
+      tlist[pointindex++] = pointmark(p4) - shift;
+      if (b->order == 2) {
+        extralist = (point *) tptr[highorderindex];
+        tlist[pointindex++] = pointmark(extralist[0]) - shift;
+        tlist[pointindex++] = pointmark(extralist[1]) - shift;
+        tlist[pointindex++] = pointmark(extralist[2]) - shift;
+        tlist[pointindex++] = pointmark(extralist[3]) - shift;
+        tlist[pointindex++] = pointmark(extralist[4]) - shift;
+        tlist[pointindex++] = pointmark(extralist[5]) - shift;
+      }
+      for (i = 0; i < eextras; i++) {
+        talist[attribindex++] = elemattribute(tptr, i);
+      }
     }
-    radiustable[radiusindex]++;
+    // Remember the index of this element (for counting edges).
+    setelemindex(tptr, elementnumber);
+	if (b->metric) { // -m option
+	  // Update the point-to-tet map, so that every point is pointing
+	  //   to a real tet, not a fictious one. Used by .p2t file.
+	  for (int i = 0; i < 4; i++) {
+	    setpoint2tet((point) (tptr[4 + i]), (tetrahedron) tptr);
+	  }
+	}
+    tptr = tetrahedrontraverse();
+    elementnumber++;
+  }
 
-    tetloop.tet = tetrahedrontraverse();
+
+  if (out == (tetgenio *) NULL) {
+    fprintf(outfile, "# Generated by %s\n", b->commandline);
+    fclose(outfile);
   }
+}
 
-  shortest = sqrt(shortest);
-  longest = sqrt(longest);
-  minaltitude = sqrt(minaltitude);
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// outfaces()    Output all faces to a .face file or a tetgenio object.      //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
 
-  printf("  Smallest volume: %16.5g   |  Largest volume: %16.5g\n",
-         smallestvolume, biggestvolume);
-  printf("  Shortest edge:   %16.5g   |  Longest edge:   %16.5g\n",
-         shortest, longest);
-  printf("  Smallest asp.ratio: %13.5g   |  Largest asp.ratio: %13.5g\n",
-         smallestratio, biggestratio);
-  sprintf(sbuf, "%.17g", biggestfaangle);
-  if (strlen(sbuf) > 8) {
-    sbuf[8] = '\0';
+void tetgenmesh::outfaces(tetgenio* out)
+{
+  FILE *outfile = NULL;
+  char facefilename[FILENAMESIZE];
+  triface tface, tsymface;
+  face checkmark;
+  point torg, tdest, tapex;
+  long ntets, faces;
+  int *elist = NULL, *emlist = NULL;
+  int neigh1 = 0, neigh2 = 0;
+  int marker = 0;
+  int firstindex, shift;
+  int facenumber;
+  int index = 0;
+
+  // For -o2 option.
+  triface workface;
+  point *extralist, pp[3] = {0,0,0}; 
+  int highorderindex = elemindexindex + 1; 
+  int o2index = 0, i;
+
+  // For -nn option.
+  int *tet2facelist = NULL;
+  int tidx; 
+
+  if (out == (tetgenio *) NULL) {
+    strcpy(facefilename, b->outfilename);
+    strcat(facefilename, ".face");
   }
-  printf("  Smallest facangle: %14.5g   |  Largest facangle:       %s\n",
-         smallestfaangle, sbuf);
-  sprintf(sbuf, "%.17g", biggestdiangle);
-  if (strlen(sbuf) > 8) {
-    sbuf[8] = '\0';
+
+  if (!b->quiet) {
+    if (out == (tetgenio *) NULL) {
+      printf("Writing %s.\n", facefilename);
+    } else {
+      printf("Writing faces.\n");
+    }
   }
-  printf("  Smallest dihedral: %14.5g   |  Largest dihedral:       %s\n\n",
-         smallestdiangle, sbuf);
 
-  printf("  Aspect ratio histogram:\n");
-  printf("         < %-6.6g    :  %8ld      | %6.6g - %-6.6g     :  %8ld\n",
-         aspectratiotable[0], aspecttable[0], aspectratiotable[5],
-         aspectratiotable[6], aspecttable[6]);
-  for (i = 1; i < 5; i++) {
-    printf("  %6.6g - %-6.6g    :  %8ld      | %6.6g - %-6.6g     :  %8ld\n",
-           aspectratiotable[i - 1], aspectratiotable[i], aspecttable[i],
-           aspectratiotable[i + 5], aspectratiotable[i + 6],
-           aspecttable[i + 6]);
+  ntets = tetrahedrons->items - hullsize;
+  faces = (ntets * 4l + hullsize) / 2l;
+
+  if (out == (tetgenio *) NULL) {
+    outfile = fopen(facefilename, "w");
+    if (outfile == (FILE *) NULL) {
+      printf("File I/O Error:  Cannot create file %s.\n", facefilename);
+      terminatetetgen(this, 1);
+    }
+    fprintf(outfile, "%ld  %d\n", faces, !b->nobound);
+  } else {
+    // Allocate memory for 'trifacelist'.
+    out->trifacelist = new int[faces * 3];
+    if (out->trifacelist == (int *) NULL) {
+      printf("Error:  Out of memory.\n");
+      terminatetetgen(this, 1);
+    }
+    if (b->order == 2) {
+      out->o2facelist = new int[faces * 3];
+    }
+    // Allocate memory for 'trifacemarkerlist' if necessary.
+    if (!b->nobound) {
+      out->trifacemarkerlist = new int[faces];
+      if (out->trifacemarkerlist == (int *) NULL) {
+        printf("Error:  Out of memory.\n");
+        terminatetetgen(this, 1);
+      }
+    }
+    if (b->neighout > 1) {
+      // '-nn' switch.
+      out->face2tetlist = new int[faces * 2];
+      if (out->face2tetlist == (int *) NULL) {
+        printf("Error:  Out of memory.\n");
+        terminatetetgen(this, 1);
+      }
+    }
+    out->numberoftrifaces = faces;
+    elist = out->trifacelist;
+    emlist = out->trifacemarkerlist;
   }
-  printf("  %6.6g - %-6.6g    :  %8ld      | %6.6g -            :  %8ld\n",
-         aspectratiotable[4], aspectratiotable[5], aspecttable[5],
-         aspectratiotable[10], aspecttable[11]);
-  printf("  (A tetrahedron's aspect ratio is its longest edge length");
-  printf(" divided by its\n");
-  printf("    smallest side height)\n\n");
 
-  printf("  Face angle histogram:\n");
-  for (i = 0; i < 9; i++) {
-    printf("    %3d - %3d degrees:  %8ld      |    %3d - %3d degrees:  %8ld\n",
-           i * 10, i * 10 + 10, faceangletable[i],
-           i * 10 + 90, i * 10 + 100, faceangletable[i + 9]);
+  if (b->neighout > 1) { // -nn option
+    // Output the tetrahedron-to-face map.
+    tet2facelist = new int[ntets * 4];
   }
-  if (minfaceang != PI) {
-    printf("  Minimum input face angle is %g (degree).\n",
-           minfaceang / PI * 180.0);
+
+  // Determine the first index (0 or 1).
+  firstindex = b->zeroindex ? 0 : in->firstnumber;
+  shift = 0; // Default no shiftment.
+  if ((in->firstnumber == 1) && (firstindex == 0)) {
+    shift = 1; // Shift the output indices by 1.
   }
-  printf("\n");
 
-  printf("  Dihedral angle histogram:\n");
-  // Print the three two rows:
-  printf("     %3d - %2d degrees:  %8ld      |    %3d - %3d degrees:  %8ld\n",
-         0, 5, dihedangletable[0], 80, 110, dihedangletable[9]);
-  printf("     %3d - %2d degrees:  %8ld      |    %3d - %3d degrees:  %8ld\n",
-         5, 10, dihedangletable[1], 110, 120, dihedangletable[10]);
-  // Print the third to seventh rows.
-  for (i = 2; i < 7; i++) {
-    printf("     %3d - %2d degrees:  %8ld      |    %3d - %3d degrees:  %8ld\n",
-           (i - 1) * 10, (i - 1) * 10 + 10, dihedangletable[i],
-           (i - 1) * 10 + 110, (i - 1) * 10 + 120, dihedangletable[i + 9]);
+  tetrahedrons->traversalinit();
+  tface.tet = tetrahedrontraverse();
+  facenumber = firstindex; // in->firstnumber;
+  // To loop over the set of faces, loop over all tetrahedra, and look at
+  //   the four faces of each one. If its adjacent tet is a hull tet,
+  //   operate on the face, otherwise, operate on the face only if the
+  //   current tet has a smaller index than its neighbor.
+  while (tface.tet != (tetrahedron *) NULL) {
+    for (tface.ver = 0; tface.ver < 4; tface.ver ++) {
+      fsym(tface, tsymface);
+      if (ishulltet(tsymface) || 
+          (elemindex(tface.tet) < elemindex(tsymface.tet))) {
+        torg = org(tface);
+        tdest = dest(tface);
+        tapex = apex(tface);
+        if (b->order == 2) { // -o2
+          // Get the three extra vertices on edges.
+          extralist = (point *) (tface.tet[highorderindex]);
+          // The extra vertices are on edges opposite the corners.
+          enext(tface, workface);
+          for (i = 0; i < 3; i++) {
+            pp[i] = extralist[ver2edge[workface.ver]];
+            enextself(workface);
+          }
+        }
+        if (!b->nobound) {
+          // Get the boundary marker of this face.
+          if (b->plc || b->refine) { 
+            // Shell face is used.
+            tspivot(tface, checkmark);
+            if (checkmark.sh == NULL) {
+              marker = 0;  // It is an inner face. It's marker is 0.
+            } else {
+              marker = shellmark(checkmark);
+            }
+          } else {
+            // Shell face is not used, only distinguish outer and inner face.
+            marker = (int) ishulltet(tsymface);
+          }
+        }
+        if (b->neighout > 1) {
+          // '-nn' switch. Output adjacent tets indices.
+          if (!ishulltet(tface)) {
+            neigh1 = elemindex(tface.tet);
+          } else {
+            neigh1 = -1;
+          }
+          if (!ishulltet(tsymface)) {
+            neigh2 = elemindex(tsymface.tet);
+          } else {
+            neigh2 = -1;  
+          }
+		  // Fill the tetrahedron-to-face map.
+		  tidx = elemindex(tface.tet) - firstindex;
+		  tet2facelist[tidx * 4 + tface.ver] = facenumber;
+		  if (!ishulltet(tsymface)) {
+		    tidx = elemindex(tsymface.tet) - firstindex;
+			tet2facelist[tidx * 4 + (tsymface.ver & 3)] = facenumber;
+		  }
+        }
+        if (out == (tetgenio *) NULL) {
+          // Face number, indices of three vertices.
+          fprintf(outfile, "%5d   %4d  %4d  %4d", facenumber,
+                  pointmark(torg) - shift, pointmark(tdest) - shift,
+                  pointmark(tapex) - shift);
+          if (b->order == 2) { // -o2
+            fprintf(outfile, "  %4d  %4d  %4d", pointmark(pp[0]) - shift, 
+                    pointmark(pp[1]) - shift, pointmark(pp[2]) - shift);
+          }
+          if (!b->nobound) {
+            // Output a boundary marker.
+            fprintf(outfile, "  %d", marker);
+          }
+          if (b->neighout > 1) {
+            fprintf(outfile, "    %5d  %5d", neigh1, neigh2);
+          }
+          fprintf(outfile, "\n");
+        } else {
+          // Output indices of three vertices.
+          elist[index++] = pointmark(torg) - shift;
+          elist[index++] = pointmark(tdest) - shift;
+          elist[index++] = pointmark(tapex) - shift;
+          if (b->order == 2) { // -o2
+            out->o2facelist[o2index++] = pointmark(pp[0]) - shift;
+            out->o2facelist[o2index++] = pointmark(pp[1]) - shift;
+            out->o2facelist[o2index++] = pointmark(pp[2]) - shift;
+          }
+          if (!b->nobound) {
+            emlist[facenumber - in->firstnumber] = marker;
+          }
+          if (b->neighout > 1) {
+            out->face2tetlist[(facenumber - in->firstnumber) * 2]     = neigh1;
+            out->face2tetlist[(facenumber - in->firstnumber) * 2 + 1] = neigh2;
+          }
+        }
+        facenumber++;
+      }
+    }
+    tface.tet = tetrahedrontraverse();
   }
-  // Print the last two rows.
-  printf("     %3d - %2d degrees:  %8ld      |    %3d - %3d degrees:  %8ld\n",
-         60, 70, dihedangletable[7], 170, 175, dihedangletable[16]);
-  printf("     %3d - %2d degrees:  %8ld      |    %3d - %3d degrees:  %8ld\n",
-         70, 80, dihedangletable[8], 175, 180, dihedangletable[17]);
-  if (minfacetdihed != PI) {
-    printf("  Minimum input dihedral angle is %g (degree).\n",
-           minfacetdihed / PI * 180.0);
+
+  if (out == (tetgenio *) NULL) {
+    fprintf(outfile, "# Generated by %s\n", b->commandline);
+    fclose(outfile);
   }
-  printf("\n");
 
-  printf("\n");
+  if (b->neighout > 1) { // -nn option
+    // Output the tetrahedron-to-face map.
+	if (out == (tetgenio *) NULL) {
+	  strcpy(facefilename, b->outfilename);
+      strcat(facefilename, ".t2f");
+    }
+	if (!b->quiet) {
+      if (out == (tetgenio *) NULL) {
+        printf("Writing %s.\n", facefilename);
+      } else {
+        printf("Writing tetrahedron-to-face map.\n");
+      }
+    }
+	if (out == (tetgenio *) NULL) {
+      outfile = fopen(facefilename, "w");
+      for (tidx = 0; tidx < ntets; tidx++) {
+        index = tidx * 4;
+        fprintf(outfile, "%4d  %d %d %d %d\n", tidx + in->firstnumber,
+                tet2facelist[index], tet2facelist[index+1], 
+                tet2facelist[index+2], tet2facelist[index+3]);
+      }
+      fclose(outfile);
+      delete [] tet2facelist;
+    } else {
+	  // Simply copy the address of the list to the output.
+      out->tet2facelist = tet2facelist;
+    }
+  }
 }
 
-
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// memorystatistics()    Report the memory usage.                            //
+// outhullfaces()    Output hull faces to a .face file or a tetgenio object. //
+//                                                                           //
+// The normal of each face is pointing to the outside of the domain.         //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-void tetgenmesh::memorystatistics()
+void tetgenmesh::outhullfaces(tetgenio* out)
 {
-  printf("Memory usage statistics:\n\n");
- 
-  // Count the number of blocks of tetrahedra. 
-  int tetblocks = 0;
-  tetrahedrons->pathblock = tetrahedrons->firstblock;
-  while (tetrahedrons->pathblock != NULL) {
-    tetblocks++;
-    tetrahedrons->pathblock = (void **) *(tetrahedrons->pathblock);  
-  }
+  FILE *outfile = NULL;
+  char facefilename[FILENAMESIZE];
+  triface hulltet;
+  point torg, tdest, tapex;
+  int *elist = NULL;
+  int firstindex, shift;
+  int facenumber;
+  int index;
 
-  // Calculate the total memory (in bytes) used by storing meshes.
-  unsigned long totalmeshmemory = 0l, totalt2shmemory = 0l;
-  totalmeshmemory = points->maxitems * points->itembytes +
-                    tetrahedrons->maxitems * tetrahedrons->itembytes;
-  if (b->plc || b->refine) {
-    totalmeshmemory += (subfaces->maxitems * subfaces->itembytes +
-                        subsegs->maxitems * subsegs->itembytes);
-    totalt2shmemory = (tet2subpool->maxitems * tet2subpool->itembytes +
-                       tet2segpool->maxitems * tet2segpool->itembytes);
+  if (out == (tetgenio *) NULL) {
+    strcpy(facefilename, b->outfilename);
+    strcat(facefilename, ".face");
   }
 
-  unsigned long totalalgomemory = 0l;
-  totalalgomemory = cavetetlist->totalmemory + cavebdrylist->totalmemory +
-                    caveoldtetlist->totalmemory + 
-                    flippool->maxitems * flippool->itembytes;
-  if (b->plc || b->refine) {
-    totalalgomemory += (subsegstack->totalmemory + subfacstack->totalmemory +
-                        subvertstack->totalmemory + 
-                        caveshlist->totalmemory + caveshbdlist->totalmemory +
-                        cavesegshlist->totalmemory +
-                        cavetetshlist->totalmemory + 
-                        cavetetseglist->totalmemory +
-                        caveencshlist->totalmemory +
-                        caveencseglist->totalmemory +
-                        cavetetvertlist->totalmemory +
-                        unflipqueue->totalmemory);
+  if (!b->quiet) {
+    if (out == (tetgenio *) NULL) {
+      printf("Writing %s.\n", facefilename);
+    } else {
+      printf("Writing faces.\n");
+    }
   }
 
-  printf("  Maximum number of tetrahedra:  %ld\n", tetrahedrons->maxitems);
-  printf("  Maximum number of tet blocks (blocksize = %d):  %d\n",
-         b->tetrahedraperblock, tetblocks);
-  /*
-  if (b->plc || b->refine) {
-    printf("  Approximate memory for tetrahedral mesh (bytes):  %ld\n",
-           totalmeshmemory);
-    
-    printf("  Approximate memory for extra pointers (bytes):  %ld\n",
-           totalt2shmemory);
-  } else {
-    printf("  Approximate memory for tetrahedralization (bytes):  %ld\n",
-           totalmeshmemory);
-  }
-  printf("  Approximate memory for algorithms (bytes):  %ld\n",
-         totalalgomemory);
-  printf("  Approximate memory for working arrays (bytes):  %ld\n",
-         totalworkmemory);
-  printf("  Approximate total used memory (bytes):  %ld\n",
-         totalmeshmemory + totalt2shmemory + totalalgomemory + 
-         totalworkmemory);
-  */
-  if (b->plc || b->refine) {
-    printf("  Approximate memory for tetrahedral mesh (bytes):  ");
-    printfcomma(totalmeshmemory); printf("\n");
-    
-    printf("  Approximate memory for extra pointers (bytes):  ");
-    printfcomma(totalt2shmemory); printf("\n");
+  if (out == (tetgenio *) NULL) {
+    outfile = fopen(facefilename, "w");
+    if (outfile == (FILE *) NULL) {
+      printf("File I/O Error:  Cannot create file %s.\n", facefilename);
+      terminatetetgen(this, 1);
+    }
+    fprintf(outfile, "%ld  0\n", hullsize);
   } else {
-    printf("  Approximate memory for tetrahedralization (bytes):  ");
-    printfcomma(totalmeshmemory); printf("\n");
-  }
-  printf("  Approximate memory for algorithms (bytes):  ");
-  printfcomma(totalalgomemory); printf("\n");
-  printf("  Approximate memory for working arrays (bytes):  ");
-  printfcomma(totalworkmemory); printf("\n");
-  printf("  Approximate total used memory (bytes):  ");
-  printfcomma(totalmeshmemory + totalt2shmemory + totalalgomemory + 
-              totalworkmemory);
-  printf("\n");
-
-  printf("\n");
-}
-
-///////////////////////////////////////////////////////////////////////////////
-//                                                                           //
-// statistics()    Print all sorts of cool facts.                            //
-//                                                                           //
-///////////////////////////////////////////////////////////////////////////////
-
-void tetgenmesh::statistics()
-{
-  long tetnumber, facenumber;
-
-  printf("\nStatistics:\n\n");
-  printf("  Input points: %d\n", in->numberofpoints);
-  if (b->refine) {
-    printf("  Input tetrahedra: %d\n", in->numberoftetrahedra);
-    if (in->numberoftrifaces > 0) {
-	  printf("  Input triangles: %d\n", in->numberoftrifaces);
+    // Allocate memory for 'trifacelist'.
+    out->trifacelist = new int[hullsize * 3];
+    if (out->trifacelist == (int *) NULL) {
+      printf("Error:  Out of memory.\n");
+      terminatetetgen(this, 1);
     }
-    if (in->numberofedges > 0) {
-	  printf("  Input edges: %d\n", in->numberofedges);
-	}
-  } else if (b->plc) {
-    printf("  Input facets: %d\n", in->numberoffacets);
-    printf("  Input segments: %ld\n", insegments);
-	if (in->numberofedges > 0) {
-	  printf("  Input edges: %d\n", in->numberofedges);
-	}
-    printf("  Input holes: %d\n", in->numberofholes);
-    printf("  Input regions: %d\n", in->numberofregions);
+    out->numberoftrifaces = hullsize;
+    elist = out->trifacelist;
+    index = 0;
   }
 
-  tetnumber = tetrahedrons->items - hullsize;
-  facenumber = (tetnumber * 4l + hullsize) / 2l;
-
-  if (b->weighted) { // -w option
-    printf("\n  Mesh points: %ld\n", points->items - nonregularcount);
-  } else {
-    printf("\n  Mesh points: %ld\n", points->items);
-  }
-  printf("  Mesh tetrahedra: %ld\n", tetnumber);
-  printf("  Mesh faces: %ld\n", facenumber);
-  if (meshedges > 0l) {
-    printf("  Mesh edges: %ld\n", meshedges);
-  } else {
-    if (!nonconvex) {
-      long vsize = points->items - dupverts - unuverts;
-      if (b->weighted) vsize -= nonregularcount;
-      meshedges = vsize + facenumber - tetnumber - 1;
-      printf("  Mesh edges: %ld\n", meshedges);
-    }
+  // Determine the first index (0 or 1).
+  firstindex = b->zeroindex ? 0 : in->firstnumber;
+  shift = 0; // Default no shiftment.
+  if ((in->firstnumber == 1) && (firstindex == 0)) {
+    shift = 1; // Shift the output indices by 1.
   }
 
-  if (b->plc || b->refine) {
-    printf("  Mesh faces on exterior boundary: %ld\n", hullsize);
-    if (meshhulledges > 0l) {
-      printf("  Mesh edges on exterior boundary: %ld\n", meshhulledges);
-    }
-    printf("  Mesh faces on input facets: %ld\n", subfaces->items);
-    printf("  Mesh edges on input segments: %ld\n", subsegs->items);
-    if (st_facref_count > 0l) {
-      printf("  Steiner points on input facets:  %ld\n", st_facref_count);
-    }
-    if (st_segref_count > 0l) {
-      printf("  Steiner points on input segments:  %ld\n", st_segref_count);
-    }
-    if (st_volref_count > 0l) {
-      printf("  Steiner points inside domain: %ld\n", st_volref_count);
-    }
-  } else {
-    printf("  Convex hull faces: %ld\n", hullsize);
-    if (meshhulledges > 0l) {
-      printf("  Convex hull edges: %ld\n", meshhulledges);
+  tetrahedrons->traversalinit();
+  hulltet.tet = alltetrahedrontraverse();
+  facenumber = firstindex;
+  while (hulltet.tet != (tetrahedron *) NULL) {
+    if (ishulltet(hulltet)) {
+      torg = (point) hulltet.tet[4];
+      tdest = (point) hulltet.tet[5];
+      tapex = (point) hulltet.tet[6];
+      if (out == (tetgenio *) NULL) {
+        // Face number, indices of three vertices.
+        fprintf(outfile, "%5d   %4d  %4d  %4d", facenumber,
+                pointmark(torg) - shift, pointmark(tdest) - shift,
+                pointmark(tapex) - shift);
+        fprintf(outfile, "\n");
+      } else {
+        // Output indices of three vertices.
+        elist[index++] = pointmark(torg) - shift;
+        elist[index++] = pointmark(tdest) - shift;
+        elist[index++] = pointmark(tapex) - shift;
+      }
+      facenumber++;
     }
+    hulltet.tet = alltetrahedrontraverse();
   }
-  if (b->weighted) { // -w option
-    printf("  Skipped non-regular points: %ld\n", nonregularcount);
-  }
-  printf("\n");
-
 
-  if (b->verbose > 0) {
-    if (b->plc || b->refine) { // -p or -r
-      if (tetrahedrons->items > 0l) {
-        qualitystatistics();
-      }
-    }
-    if (tetrahedrons->items > 0l) {
-      memorystatistics();
-    }
+  if (out == (tetgenio *) NULL) {
+    fprintf(outfile, "# Generated by %s\n", b->commandline);
+    fclose(outfile);
   }
 }
 
-////                                                                       ////
-////                                                                       ////
-//// meshstat_cxx /////////////////////////////////////////////////////////////
-
-//// output_cxx ///////////////////////////////////////////////////////////////
-////                                                                       ////
-////                                                                       ////
-
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// jettisonnodes()    Jettison unused or duplicated vertices.                //
+// outsubfaces()    Output subfaces (i.e. boundary faces) to a .face file or //
+//                  a tetgenio structure.                                    //
 //                                                                           //
-// Unused points are those input points which are outside the mesh domain or //
-// have no connection (isolated) to the mesh.  Duplicated points exist for   //
-// example if the input PLC is read from a .stl mesh file (marked during the //
-// Delaunay tetrahedralization step. This routine remove these points from   //
-// points list. All existing points are reindexed.                           //
+// The boundary faces are found in 'subfaces'. For listing triangle vertices //
+// in the same sense for all triangles in the mesh, the direction determined //
+// by right-hand rule is pointer to the inside of the volume.                //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-void tetgenmesh::jettisonnodes()
+void tetgenmesh::outsubfaces(tetgenio* out)
 {
-  point pointloop;
-  bool jetflag;
-  int oldidx, newidx;
-  int remcount;
+  FILE *outfile = NULL;
+  char facefilename[FILENAMESIZE];
+  int *elist = NULL;
+  int *emlist = NULL;
+  int index = 0, index1 = 0, index2 = 0;
+  triface abuttingtet;
+  face faceloop;
+  point torg, tdest, tapex;
+  int marker = 0;
+  int firstindex, shift;
+  int neigh1 = 0, neigh2 = 0;
+  int facenumber;
+
+  // For -o2 option.
+  triface workface;
+  point *extralist, pp[3] = {0,0,0}; 
+  int highorderindex = elemindexindex + 1;
+  int o2index = 0, i;
+
+  int t1ver; // used by fsymself()
+
+  if (out == (tetgenio *) NULL) {
+    strcpy(facefilename, b->outfilename);
+    strcat(facefilename, ".face");
+  }
 
   if (!b->quiet) {
-    printf("Jettisoning redundant points.\n");
+    if (out == (tetgenio *) NULL) {
+      printf("Writing %s.\n", facefilename);
+    } else {
+      printf("Writing faces.\n");
+    }
   }
 
-  points->traversalinit();
-  pointloop = pointtraverse();
-  oldidx = newidx = 0; // in->firstnumber;
-  remcount = 0;
-  while (pointloop != (point) NULL) {
-    jetflag = (pointtype(pointloop) == DUPLICATEDVERTEX) || 
-      (pointtype(pointloop) == UNUSEDVERTEX);
-    if (jetflag) {
-      // It is a duplicated or unused point, delete it.
-      pointdealloc(pointloop);
-      remcount++;
+  if (out == (tetgenio *) NULL) {
+    outfile = fopen(facefilename, "w");
+    if (outfile == (FILE *) NULL) {
+      printf("File I/O Error:  Cannot create file %s.\n", facefilename);
+      terminatetetgen(this, 3);
+    }
+    // Number of subfaces.
+    fprintf(outfile, "%ld  %d\n", subfaces->items, !b->nobound);
+  } else {
+    // Allocate memory for 'trifacelist'.
+    out->trifacelist = new int[subfaces->items * 3];
+    if (out->trifacelist == (int *) NULL) {
+      terminatetetgen(this, 1);
+    }
+    if (b->order == 2) {
+      out->o2facelist = new int[subfaces->items * 3];
+    }
+    if (!b->nobound) {
+      // Allocate memory for 'trifacemarkerlist'.
+      out->trifacemarkerlist = new int[subfaces->items];
+      if (out->trifacemarkerlist == (int *) NULL) {
+        terminatetetgen(this, 1);
+      }
+    }
+    if (b->neighout > 1) {
+      // '-nn' switch.
+      out->face2tetlist = new int[subfaces->items * 2];
+      if (out->face2tetlist == (int *) NULL) {
+        terminatetetgen(this, 1);
+      }
+    }
+    out->numberoftrifaces = subfaces->items;
+    elist = out->trifacelist;
+    emlist = out->trifacemarkerlist;
+  }
+
+  // Determine the first index (0 or 1).
+  firstindex = b->zeroindex ? 0 : in->firstnumber;
+  shift = 0; // Default no shiftment.
+  if ((in->firstnumber == 1) && (firstindex == 0)) {
+    shift = 1; // Shift the output indices by 1.
+  }
+
+  subfaces->traversalinit();
+  faceloop.sh = shellfacetraverse(subfaces);
+  facenumber = firstindex; // in->firstnumber;
+  while (faceloop.sh != (shellface *) NULL) {
+    stpivot(faceloop, abuttingtet);
+    // If there is a tetrahedron containing this subface, orient it so
+    //   that the normal of this face points to inside of the volume by
+    //   right-hand rule.
+    if (abuttingtet.tet != NULL) {
+      if (ishulltet(abuttingtet)) {
+        fsymself(abuttingtet);
+      }
+    }
+    if (abuttingtet.tet != NULL) {
+      torg = org(abuttingtet);
+      tdest = dest(abuttingtet);
+      tapex = apex(abuttingtet);
+      if (b->order == 2) { // -o2
+        // Get the three extra vertices on edges.
+        extralist = (point *) (abuttingtet.tet[highorderindex]);
+        workface = abuttingtet;
+        for (i = 0; i < 3; i++) {
+          pp[i] = extralist[ver2edge[workface.ver]];
+          enextself(workface);
+        }
+      }
     } else {
-      // Re-index it.
-      setpointmark(pointloop, newidx + in->firstnumber);
-      if (in->pointmarkerlist != (int *) NULL) {
-        if (oldidx < in->numberofpoints) {
-          // Re-index the point marker as well.
-          in->pointmarkerlist[newidx] = in->pointmarkerlist[oldidx];
+      // This may happen when only a surface mesh be generated.
+      torg = sorg(faceloop);
+      tdest = sdest(faceloop);
+      tapex = sapex(faceloop);
+      if (b->order == 2) { // -o2
+        // There is no extra node list available.
+        pp[0] = torg;
+        pp[1] = tdest;
+        pp[2] = tapex;
+      }
+    }
+    if (!b->nobound) {
+      marker = shellmark(faceloop);
+    }
+    if (b->neighout > 1) {
+      // '-nn' switch. Output adjacent tets indices.
+      neigh1 = -1;
+      neigh2 = -1;
+      stpivot(faceloop, abuttingtet);
+      if (abuttingtet.tet != NULL) {
+        if (!ishulltet(abuttingtet)) {
+          neigh1 = elemindex(abuttingtet.tet);
+        }
+        fsymself(abuttingtet);
+        if (!ishulltet(abuttingtet)) {
+          neigh2 = elemindex(abuttingtet.tet);
         }
       }
-      newidx++;
     }
-    oldidx++;
-    pointloop = pointtraverse();
-  }
-  if (b->verbose) {
-    printf("  %ld duplicated vertices are removed.\n", dupverts);
-    printf("  %ld unused vertices are removed.\n", unuverts);
+    if (out == (tetgenio *) NULL) {
+      fprintf(outfile, "%5d   %4d  %4d  %4d", facenumber,
+              pointmark(torg) - shift, pointmark(tdest) - shift,
+              pointmark(tapex) - shift);
+      if (b->order == 2) { // -o2
+        fprintf(outfile, "  %4d  %4d  %4d", pointmark(pp[0]) - shift, 
+                pointmark(pp[1]) - shift, pointmark(pp[2]) - shift);
+      }
+      if (!b->nobound) {
+        fprintf(outfile, "    %d", marker);
+      }
+      if (b->neighout > 1) {
+        fprintf(outfile, "    %5d  %5d", neigh1, neigh2);
+      }
+      fprintf(outfile, "\n");
+    } else {
+      // Output three vertices of this face;
+      elist[index++] = pointmark(torg) - shift;
+      elist[index++] = pointmark(tdest) - shift;
+      elist[index++] = pointmark(tapex) - shift;
+      if (b->order == 2) { // -o2
+        out->o2facelist[o2index++] = pointmark(pp[0]) - shift;
+        out->o2facelist[o2index++] = pointmark(pp[1]) - shift;
+        out->o2facelist[o2index++] = pointmark(pp[2]) - shift;
+      }
+      if (!b->nobound) {
+        emlist[index1++] = marker;
+      }
+      if (b->neighout > 1) {
+        out->face2tetlist[index2++] = neigh1;
+        out->face2tetlist[index2++] = neigh2;
+      }
+    }
+    facenumber++;
+    faceloop.sh = shellfacetraverse(subfaces);
   }
-  dupverts = 0l;
-  unuverts = 0l;
 
-  // The following line ensures that dead items in the pool of nodes cannot
-  //   be allocated for the new created nodes. This ensures that the input
-  //   nodes will occur earlier in the output files, and have lower indices.
-  points->deaditemstack = (void *) NULL;
+  if (out == (tetgenio *) NULL) {
+    fprintf(outfile, "# Generated by %s\n", b->commandline);
+    fclose(outfile);
+  }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// highorder()   Create extra nodes for quadratic subparametric elements.    //
+// outedges()    Output all edges to a .edge file or a tetgenio object.      //
 //                                                                           //
-// 'highordertable' is an array (size = numberoftetrahedra * 6) for storing  //
-// high-order nodes of each tetrahedron.  This routine is used only when -o2 //
-// switch is used.                                                           //
+// Note: This routine must be called after outelements(),  so that the total //
+// number of edges 'meshedges' has been counted.                             //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-void tetgenmesh::highorder()
+void tetgenmesh::outedges(tetgenio* out)
 {
+  FILE *outfile = NULL;
+  char edgefilename[FILENAMESIZE];
   triface tetloop, worktet, spintet;
-  point *extralist, *adjextralist;
-  point torg, tdest, newpoint;
-  int highorderindex;
+  face checkseg;
+  point torg, tdest;
+  int ishulledge;
+  int firstindex, shift;
+  int edgenumber, marker;
+  int index = 0, index1 = 0, index2 = 0;
   int t1ver;
-  int i, j;
+  int i;
+
+  // For -o2 option.
+  point *extralist, pp = NULL; 
+  int highorderindex = elemindexindex + 1;
+  int o2index = 0;
+
+  // For -nn option.
+  int *tet2edgelist = NULL;
+  int tidx;
+
+  if (out == (tetgenio *) NULL) {
+    strcpy(edgefilename, b->outfilename);
+    strcat(edgefilename, ".edge");
+  }
 
   if (!b->quiet) {
-    printf("Adding vertices for second-order tetrahedra.\n");
+    if (out == (tetgenio *) NULL) {
+      printf("Writing %s.\n", edgefilename);
+    } else {
+      printf("Writing edges.\n");
+    }
   }
 
-  // Initialize the 'highordertable'.
-  highordertable = new point[tetrahedrons->items * 6];
-  if (highordertable == (point *) NULL) {
-    terminatetetgen(this, 1);
+  if (meshedges == 0l) {
+    if (nonconvex) {
+      numberedges();  // Count the edges.
+    } else {
+      // Use Euler's characteristic to get the numbe of edges.
+      // It states V - E + F - C = 1, hence E = V + F - C - 1.
+      long tsize = tetrahedrons->items - hullsize;
+      long fsize = (tsize * 4l + hullsize) / 2l;
+      long vsize = points->items - dupverts - unuverts;
+      if (b->weighted) vsize -= nonregularcount;
+      meshedges = vsize + fsize - tsize - 1;
+    }
   }
+  meshhulledges = 0l; // It will be counted.
 
-  // This will overwrite the slot for element markers.
-  highorderindex = 11;
+  if (out == (tetgenio *) NULL) {
+    outfile = fopen(edgefilename, "w");
+    if (outfile == (FILE *) NULL) {
+      printf("File I/O Error:  Cannot create file %s.\n", edgefilename);
+      terminatetetgen(this, 1);
+    }
+    // Write the number of edges, boundary markers (0 or 1).
+    fprintf(outfile, "%ld  %d\n", meshedges, !b->nobound);
+  } else {
+    // Allocate memory for 'edgelist'.
+    out->numberofedges = meshedges;
+    out->edgelist = new int[meshedges * 2];
+    if (out->edgelist == (int *) NULL) {
+      printf("Error:  Out of memory.\n");
+      terminatetetgen(this, 1);
+    }
+    if (b->order == 2) { // -o2 switch
+      out->o2edgelist = new int[meshedges];
+    }
+    if (!b->nobound) {
+      out->edgemarkerlist = new int[meshedges];
+    }
+    if (b->neighout > 1) { // '-nn' switch.
+      out->edge2tetlist = new int[meshedges];
+    }
+  }
 
-  // The following line ensures that dead items in the pool of nodes cannot
-  //   be allocated for the extra nodes associated with high order elements.
-  //   This ensures that the primary nodes (at the corners of elements) will
-  //   occur earlier in the output files, and have lower indices, than the
-  //   extra nodes.
-  points->deaditemstack = (void *) NULL;
+  if (b->neighout > 1) { // -nn option
+    // Output the tetrahedron-to-edge map.
+	long tsize = tetrahedrons->items - hullsize;
+    tet2edgelist = new int[tsize * 6];
+  }
 
-  // Assign an entry for each tetrahedron to find its extra nodes. At the
-  //   mean while, initialize all extra nodes be NULL.
-  i = 0;
-  tetrahedrons->traversalinit();
-  tetloop.tet = tetrahedrontraverse();
-  while (tetloop.tet != (tetrahedron *) NULL) {
-    tetloop.tet[highorderindex] = (tetrahedron) &highordertable[i];
-    for (j = 0; j < 6; j++) {
-      highordertable[i + j] = (point) NULL;
-    }
-    i += 6;
-    tetloop.tet = tetrahedrontraverse();
+  // Determine the first index (0 or 1).
+  firstindex = b->zeroindex ? 0 : in->firstnumber;
+  shift = 0; // Default no shiftment.
+  if ((in->firstnumber == 1) && (firstindex == 0)) {
+    shift = 1; // Shift (reduce) the output indices by 1.
   }
 
-  // To create a unique node on each edge. Loop over all tetrahedra, and
-  //   look at the six edges of each tetrahedron.  If the extra node in
-  //   the tetrahedron corresponding to this edge is NULL, create a node
-  //   for this edge, at the same time, set the new node into the extra
-  //   node lists of all other tetrahedra sharing this edge.  
   tetrahedrons->traversalinit();
   tetloop.tet = tetrahedrontraverse();
+  edgenumber = firstindex; // in->firstnumber;
   while (tetloop.tet != (tetrahedron *) NULL) {
-    // Get the list of extra nodes.
-    extralist = (point *) tetloop.tet[highorderindex];
+    // Count the number of Voronoi faces. 
     worktet.tet = tetloop.tet;
     for (i = 0; i < 6; i++) {
-      if (extralist[i] == (point) NULL) {
-        // Go to the ith-edge.
-        worktet.ver = edge2ver[i];
-        // Create a new point in the middle of this edge.
+      worktet.ver = edge2ver[i];
+      ishulledge = 0;
+      fnext(worktet, spintet);
+      do {
+        if (!ishulltet(spintet)) {
+          if (elemindex(spintet.tet) < elemindex(worktet.tet)) break;
+        } else {
+          ishulledge = 1;
+        }
+        fnextself(spintet);
+      } while (spintet.tet != worktet.tet);
+      if (spintet.tet == worktet.tet) {
+        // Found a new edge.
+        if (ishulledge) meshhulledges++;
         torg = org(worktet);
         tdest = dest(worktet);
-        makepoint(&newpoint, FREEVOLVERTEX);
-        for (j = 0; j < 3 + numpointattrib; j++) {
-          newpoint[j] = 0.5 * (torg[j] + tdest[j]);
+        if (b->order == 2) { // -o2
+          // Get the extra vertex on this edge.
+          extralist = (point *) worktet.tet[highorderindex];
+          pp = extralist[ver2edge[worktet.ver]];
         }
-        // Interpolate its metrics.
-        for (j = 0; j < in->numberofpointmtrs; j++) {
-          newpoint[pointmtrindex + j] = 
-            0.5 * (torg[pointmtrindex + j] + tdest[pointmtrindex + j]);
+        if (out == (tetgenio *) NULL) {
+          fprintf(outfile, "%5d   %4d  %4d", edgenumber,
+                  pointmark(torg) - shift, pointmark(tdest) - shift);
+          if (b->order == 2) { // -o2
+            fprintf(outfile, "  %4d", pointmark(pp) - shift);
+          }
+        } else {
+          // Output three vertices of this face;
+          out->edgelist[index++] = pointmark(torg) - shift;
+          out->edgelist[index++] = pointmark(tdest) - shift;
+          if (b->order == 2) { // -o2
+            out->o2edgelist[o2index++] = pointmark(pp) - shift;
+          }
         }
-        // Set this point into all extra node lists at this edge.
-        spintet = worktet;
-        while (1) {
-          if (!ishulltet(spintet)) {
-            adjextralist = (point *) spintet.tet[highorderindex];
-            adjextralist[ver2edge[spintet.ver]] = newpoint;
+        if (!b->nobound) {
+          if (b->plc || b->refine) {
+            // Check if the edge is a segment.
+            tsspivot1(worktet, checkseg);
+            if (checkseg.sh != NULL) {
+              marker = shellmark(checkseg);
+            } else {
+              marker = 0;  // It's not a segment.
+            }
+          } else {
+            // Mark it if it is a hull edge.
+            marker = ishulledge ? 1 : 0;
+          }
+          if (out == (tetgenio *) NULL) {
+            fprintf(outfile, "  %d", marker);
+          } else {
+            out->edgemarkerlist[index1++] = marker;
           }
-          fnextself(spintet);
-          if (spintet.tet == worktet.tet) break;
         }
-      } // if (!extralist[i])
-    } // i
+        if (b->neighout > 1) { // '-nn' switch.
+          if (out == (tetgenio *) NULL) {
+            fprintf(outfile, "  %d", elemindex(tetloop.tet));
+          } else {
+            out->edge2tetlist[index2++] = elemindex(tetloop.tet);
+          }
+		  // Fill the tetrahedron-to-edge map.
+		  spintet = worktet;
+		  while (1) {
+		    if (!ishulltet(spintet)) {
+			  tidx = elemindex(spintet.tet) - firstindex;
+			  tet2edgelist[tidx * 6 + ver2edge[spintet.ver]] = edgenumber;
+			}
+		    fnextself(spintet);
+			if (spintet.tet == worktet.tet) break;
+		  }
+        }
+        if (out == (tetgenio *) NULL) {
+          fprintf(outfile, "\n");
+        }
+        edgenumber++;
+      }
+    }
     tetloop.tet = tetrahedrontraverse();
   }
-}
-
-///////////////////////////////////////////////////////////////////////////////
-//                                                                           //
-// indexelements()    Index all tetrahedra.                                  //
-//                                                                           //
-// Many output functions require that the tetrahedra are indexed.  This      //
-// routine is called when -E option is used.                                 //
-//                                                                           //
-///////////////////////////////////////////////////////////////////////////////
 
-void tetgenmesh::indexelements()
-{
-  triface worktet;
-  int eindex = b->zeroindex ? 0 : in->firstnumber; // firstindex;
-  tetrahedrons->traversalinit();
-  worktet.tet = tetrahedrontraverse();
-  while (worktet.tet != NULL) {
-    setelemindex(worktet.tet, eindex);
-    eindex++;
-	if (b->metric) { // -m option
-	  // Update the point-to-tet map, so that every point is pointing
-	  //   to a real tet, not a fictious one. Used by .p2t file.
-	  tetrahedron tptr = encode(worktet);
-	  for (int i = 0; i < 4; i++) {
-	    setpoint2tet((point) (worktet.tet[4 + i]), tptr);
-	  }
-	}
-    worktet.tet = tetrahedrontraverse();
+  if (out == (tetgenio *) NULL) {
+    fprintf(outfile, "# Generated by %s\n", b->commandline);
+    fclose(outfile);
   }
-}
 
-///////////////////////////////////////////////////////////////////////////////
-//                                                                           //
-// numberedges()    Count the number of edges, save in "meshedges".          //
-//                                                                           //
-// This routine is called when '-p' or '-r', and '-E' options are used.  The //
-// total number of edges depends on the genus of the input surface mesh.     //
-//                                                                           //
-// NOTE:  This routine must be called after outelements().  So all elements  //
-// have been indexed.                                                        //
-//                                                                           //
-///////////////////////////////////////////////////////////////////////////////
+  if (b->neighout > 1) { // -nn option
+    long tsize = tetrahedrons->items - hullsize;
 
-void tetgenmesh::numberedges()
-{
-  triface worktet, spintet;
-  int ishulledge;
-  int t1ver;
-  int i;
+    if (b->facesout) { // -f option
+      // Build the face-to-edge map (use the tet-to-edge map).
+	  long fsize = (tsize * 4l + hullsize) / 2l;
+	  int *face2edgelist = new int[fsize * 3];
 
-  meshedges = meshhulledges = 0l;
+	  tetrahedrons->traversalinit();
+      tetloop.tet = tetrahedrontraverse();
+      int facenumber = 0; // firstindex; // in->firstnumber;
+	  while (tetloop.tet != (tetrahedron *) NULL) {
+	    for (tetloop.ver = 0; tetloop.ver < 4; tetloop.ver++) {
+		  fsym(tetloop, spintet);
+		  if (ishulltet(spintet) || 
+              (elemindex(tetloop.tet) < elemindex(spintet.tet))) {
+            // The three edges of this face are ordered such that the
+			//    first edge is opposite to the first vertex of this face
+			//    that appears in the .face file, and so on.
+			tidx = elemindex(tetloop.tet) - firstindex; 
+			worktet = tetloop;
+            for (i = 0; i < 3; i++) {
+			  enextself(worktet); // The edge opposite to vertex i.
+			  int eidx = tet2edgelist[tidx * 6 + ver2edge[worktet.ver]];
+			  face2edgelist[facenumber * 3 + i] = eidx;
+			}
+		    facenumber++;
+		  }
+		}
+	    tetloop.tet = tetrahedrontraverse();
+	  }
 
-  tetrahedrons->traversalinit();
-  worktet.tet = tetrahedrontraverse();
-  while (worktet.tet != NULL) {
-    for (i = 0; i < 6; i++) {
-      worktet.ver = edge2ver[i];
-      ishulledge = 0;
-      fnext(worktet, spintet);
-      do {
-        if (!ishulltet(spintet)) {
-          if (elemindex(spintet.tet) < elemindex(worktet.tet)) break;
+	  // Output the face-to-edge map.
+	  if (out == (tetgenio *) NULL) {
+	    strcpy(edgefilename, b->outfilename);
+        strcat(edgefilename, ".f2e");
+      }
+	  if (!b->quiet) {
+        if (out == (tetgenio *) NULL) {
+          printf("Writing %s.\n", edgefilename);
         } else {
-          ishulledge = 1;
+          printf("Writing face-to-edge map.\n");
         }
-        fnextself(spintet);
-      } while (spintet.tet != worktet.tet);
-      if (spintet.tet == worktet.tet) {
-        meshedges++;
-        if (ishulledge) meshhulledges++;
       }
+	  if (out == (tetgenio *) NULL) {
+	    outfile = fopen(edgefilename, "w");
+	    for (tidx = 0; tidx < fsize; tidx++) { // Re-use `tidx'
+	      i = tidx * 3;
+		  fprintf(outfile, "%4d  %d %d %d\n", tidx + in->firstnumber,
+		          face2edgelist[i], face2edgelist[i+1], face2edgelist[i+2]);
+	    }
+	    fclose(outfile);
+	    delete [] face2edgelist;
+	  } else {
+	    // Simply copy the address of the list to the output.
+	    out->face2edgelist = face2edgelist;
+      }
+    } // if (b->facesout)
+
+    // Output the tetrahedron-to-edge map.
+	if (out == (tetgenio *) NULL) {
+	  strcpy(edgefilename, b->outfilename);
+      strcat(edgefilename, ".t2e");
+    }
+	if (!b->quiet) {
+      if (out == (tetgenio *) NULL) {
+        printf("Writing %s.\n", edgefilename);
+      } else {
+        printf("Writing tetrahedron-to-edge map.\n");
+      }
+    }
+	if (out == (tetgenio *) NULL) {
+	  outfile = fopen(edgefilename, "w");
+	  for (tidx = 0; tidx < tsize; tidx++) {
+	    i = tidx * 6;
+		fprintf(outfile, "%4d  %d %d %d %d %d %d\n", tidx + in->firstnumber,
+		        tet2edgelist[i], tet2edgelist[i+1], tet2edgelist[i+2],  
+				tet2edgelist[i+3], tet2edgelist[i+4], tet2edgelist[i+5]);
+	  }
+	  fclose(outfile);
+	  delete [] tet2edgelist;
+	} else {
+	  // Simply copy the address of the list to the output.
+	  out->tet2edgelist = tet2edgelist;
     }
-    infect(worktet);
-    worktet.tet = tetrahedrontraverse();
   }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// outnodes()    Output the points to a .node file or a tetgenio structure.  //
-//                                                                           //
-// Note: each point has already been numbered on input (the first index is   //
-// 'in->firstnumber').                                                       //
+// outsubsegments()    Output segments to a .edge file or a structure.       //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-void tetgenmesh::outnodes(tetgenio* out)
+void tetgenmesh::outsubsegments(tetgenio* out)
 {
   FILE *outfile = NULL;
-  char outnodefilename[FILENAMESIZE];
-  face parentsh;
-  point pointloop;
-  int nextras, bmark, marker = 0, weightDT = 0; 
-  int coordindex, attribindex;
-  int pointnumber, firstindex;
+  char edgefilename[FILENAMESIZE];
+  int *elist = NULL;
   int index, i;
+  face edgeloop;
+  point torg, tdest;
+  int firstindex, shift;
+  int marker;
+  int edgenumber;
+
+  // For -o2 option.
+  triface workface, spintet;
+  point *extralist, pp = NULL; 
+  int highorderindex = elemindexindex + 1;
+  int o2index = 0;
+
+  // For -nn option.
+  int neigh = -1;
+  int index2 = 0;
+
+  int t1ver; // used by fsymself()
 
   if (out == (tetgenio *) NULL) {
-    strcpy(outnodefilename, b->outfilename);
-    strcat(outnodefilename, ".node");
+    strcpy(edgefilename, b->outfilename);
+    strcat(edgefilename, ".edge");
   }
 
   if (!b->quiet) {
     if (out == (tetgenio *) NULL) {
-      printf("Writing %s.\n", outnodefilename);
+      printf("Writing %s.\n", edgefilename);
     } else {
-      printf("Writing nodes.\n");
+      printf("Writing edges.\n");
     }
   }
 
-  nextras = numpointattrib;
-  if (b->weighted) { // -w
-    if (b->weighted_param == 0) weightDT = 1; // Weighted DT.
-  }
-
-  bmark = !b->nobound && in->pointmarkerlist;
-
   if (out == (tetgenio *) NULL) {
-    outfile = fopen(outnodefilename, "w");
+    outfile = fopen(edgefilename, "w");
     if (outfile == (FILE *) NULL) {
-      printf("File I/O Error:  Cannot create file %s.\n", outnodefilename);
-      terminatetetgen(this, 1);
+      printf("File I/O Error:  Cannot create file %s.\n", edgefilename);
+      terminatetetgen(this, 3);
     }
-    // Number of points, number of dimensions, number of point attributes,
-    //   and number of boundary markers (zero or one).
-    fprintf(outfile, "%ld  %d  %d  %d\n", points->items, 3, nextras, bmark);
+    // Number of subsegments.
+    fprintf(outfile, "%ld  1\n", subsegs->items);
   } else {
-    // Allocate space for 'pointlist';
-    out->pointlist = new REAL[points->items * 3];
-    if (out->pointlist == (REAL *) NULL) {
-      printf("Error:  Out of memory.\n");
+    // Allocate memory for 'edgelist'.
+    out->edgelist = new int[subsegs->items * (b->order == 1 ? 2 : 3)];
+    if (out->edgelist == (int *) NULL) {
       terminatetetgen(this, 1);
     }
-    // Allocate space for 'pointattributelist' if necessary;
-    if (nextras > 0) {
-      out->pointattributelist = new REAL[points->items * nextras];
-      if (out->pointattributelist == (REAL *) NULL) {
-        printf("Error:  Out of memory.\n");
-        terminatetetgen(this, 1);
-      }
+    if (b->order == 2) {
+      out->o2edgelist = new int[subsegs->items];
     }
-    // Allocate space for 'pointmarkerlist' if necessary;
-    if (bmark) {
-      out->pointmarkerlist = new int[points->items];
-      if (out->pointmarkerlist == (int *) NULL) {
-        printf("Error:  Out of memory.\n");
-        terminatetetgen(this, 1);
-      }
+    out->edgemarkerlist = new int[subsegs->items];
+    if (out->edgemarkerlist == (int *) NULL) {
+      terminatetetgen(this, 1);
     }
-    if (b->psc) {
-      out->pointparamlist = new tetgenio::pointparam[points->items];
-      if (out->pointparamlist == NULL) {
-        printf("Error:  Out of memory.\n");
-        terminatetetgen(this, 1);
-      }
+    if (b->neighout > 1) {
+      out->edge2tetlist = new int[subsegs->items];
     }
-    out->numberofpoints = points->items;
-    out->numberofpointattributes = nextras;
-    coordindex = 0;
-    attribindex = 0;
+    out->numberofedges = subsegs->items;
+    elist = out->edgelist;
   }
-  
+
   // Determine the first index (0 or 1).
   firstindex = b->zeroindex ? 0 : in->firstnumber;
-
-  points->traversalinit();
-  pointloop = pointtraverse();
-  pointnumber = firstindex; // in->firstnumber;
+  shift = 0; // Default no shiftment.
+  if ((in->firstnumber == 1) && (firstindex == 0)) {
+    shift = 1; // Shift the output indices by 1.
+  }
   index = 0;
-  while (pointloop != (point) NULL) {
-    if (bmark) {
-      // Default the vertex has a zero marker.
-      marker = 0;
-      // Is it an input vertex?
-      if (index < in->numberofpoints) {
-        // Input point's marker is directly copied to output.
-        marker = in->pointmarkerlist[index];       
-      } else {
-        if ((pointtype(pointloop) == FREESEGVERTEX) ||
-            (pointtype(pointloop) == FREEFACETVERTEX)) {
-          sdecode(point2sh(pointloop), parentsh);
-          if (parentsh.sh != NULL) {
-            marker = shellmark(parentsh);
+  i = 0;
+
+  subsegs->traversalinit();
+  edgeloop.sh = shellfacetraverse(subsegs);
+  edgenumber = firstindex; // in->firstnumber;
+  while (edgeloop.sh != (shellface *) NULL) {
+    torg = sorg(edgeloop);
+    tdest = sdest(edgeloop);
+    if ((b->order == 2) || (b->neighout > 1)) {
+      sstpivot1(edgeloop, workface);
+      if (workface.tet != NULL) {
+        // We must find a non-hull tet.
+        if (ishulltet(workface)) {
+          spintet = workface;
+          while (1) {
+            fnextself(spintet);
+            if (!ishulltet(spintet)) break;
+            if (spintet.tet == workface.tet) break;
           }
-        } // if (pointtype(...))
+          workface = spintet;
+        }
       }
     }
-    if (out == (tetgenio *) NULL) {
-      // Point number, x, y and z coordinates.
-      fprintf(outfile, "%4d    %.17g  %.17g  %.17g", pointnumber,
-              pointloop[0], pointloop[1], pointloop[2]);
-      for (i = 0; i < nextras; i++) {
-        // Write an attribute.
-        if ((i == 0) && weightDT) {          
-          fprintf(outfile, "  %.17g", pointloop[0] * pointloop[0] +
-             pointloop[1] * pointloop[1] + pointloop[2] * pointloop[2] 
-             - pointloop[3 + i]);
-        } else { 
-          fprintf(outfile, "  %.17g", pointloop[3 + i]);
-        }
+    if (b->order == 2) { // -o2
+      // Get the extra vertex on this edge.
+      if (workface.tet != NULL) {
+        extralist = (point *) workface.tet[highorderindex];
+        pp = extralist[ver2edge[workface.ver]];
+      } else {
+        pp = torg; // There is no extra node available.
       }
-      if (bmark) {
-        // Write the boundary marker.
-        fprintf(outfile, "    %d", marker);
+    }
+    if (b->neighout > 1) { // -nn
+      if (workface.tet != NULL) {
+        neigh = elemindex(workface.tet);
+      } else {
+        neigh = -1;
       }
-      if (b->psc) {
-        fprintf(outfile, "  %.8g  %.8g  %d", pointgeomuv(pointloop, 0),
-                pointgeomuv(pointloop, 1), pointgeomtag(pointloop));
-        if (pointtype(pointloop) == RIDGEVERTEX) {
-          fprintf(outfile, "  0");
-        } else if (pointtype(pointloop) == ACUTEVERTEX) {
-          fprintf(outfile, "  0");
-        } else if (pointtype(pointloop) == FREESEGVERTEX) {
-          fprintf(outfile, "  1");
-        } else if (pointtype(pointloop) == FREEFACETVERTEX) {
-          fprintf(outfile, "  2");
-        } else if (pointtype(pointloop) == FREEVOLVERTEX) {
-          fprintf(outfile, "  3");
-        } else {
-          fprintf(outfile, "  -1"); // Unknown type.
-        }
+    }
+    marker = shellmark(edgeloop);
+    if (marker == 0) {
+      marker = 1; // Default marker of a boundary edge is 1. 
+    }
+    if (out == (tetgenio *) NULL) {
+      fprintf(outfile, "%5d   %4d  %4d", edgenumber,
+              pointmark(torg) - shift, pointmark(tdest) - shift);
+      if (b->order == 2) { // -o2
+        fprintf(outfile, "  %4d", pointmark(pp) - shift);
+      }
+      fprintf(outfile, "  %d", marker);
+      if (b->neighout > 1) { // -nn
+        fprintf(outfile, "  %4d", neigh);
       }
       fprintf(outfile, "\n");
     } else {
-      // X, y, and z coordinates.
-      out->pointlist[coordindex++] = pointloop[0];
-      out->pointlist[coordindex++] = pointloop[1];
-      out->pointlist[coordindex++] = pointloop[2];
-      // Point attributes.
-      for (i = 0; i < nextras; i++) {
-        // Output an attribute.
-        if ((i == 0) && weightDT) {
-          out->pointattributelist[attribindex++] = 
-            pointloop[0] * pointloop[0] + pointloop[1] * pointloop[1] + 
-            pointloop[2] * pointloop[2] - pointloop[3 + i];
-        } else {
-          out->pointattributelist[attribindex++] = pointloop[3 + i];
-        }
-      }
-      if (bmark) {
-        // Output the boundary marker.  
-        out->pointmarkerlist[index] = marker;
+      // Output three vertices of this face;
+      elist[index++] = pointmark(torg) - shift;
+      elist[index++] = pointmark(tdest) - shift;
+      if (b->order == 2) { // -o2
+        out->o2edgelist[o2index++] = pointmark(pp) - shift;
       }
-      if (b->psc) {
-        out->pointparamlist[index].uv[0] = pointgeomuv(pointloop, 0);
-        out->pointparamlist[index].uv[1] = pointgeomuv(pointloop, 1);
-        out->pointparamlist[index].tag = pointgeomtag(pointloop);
-        if (pointtype(pointloop) == RIDGEVERTEX) {
-          out->pointparamlist[index].type = 0;
-        } else if (pointtype(pointloop) == ACUTEVERTEX) {
-          out->pointparamlist[index].type = 0;
-        } else if (pointtype(pointloop) == FREESEGVERTEX) {
-          out->pointparamlist[index].type = 1;
-        } else if (pointtype(pointloop) == FREEFACETVERTEX) {
-          out->pointparamlist[index].type = 2;
-        } else if (pointtype(pointloop) == FREEVOLVERTEX) {
-          out->pointparamlist[index].type = 3;
-        } else {
-          out->pointparamlist[index].type = -1; // Unknown type.
-        }
+      out->edgemarkerlist[i++] = marker;
+      if (b->neighout > 1) { // -nn
+        out->edge2tetlist[index2++] = neigh;
       }
     }
-    pointloop = pointtraverse();
-    pointnumber++; 
-    index++;
+    edgenumber++;
+    edgeloop.sh = shellfacetraverse(subsegs);
   }
 
   if (out == (tetgenio *) NULL) {
@@ -29043,479 +31392,461 @@ void tetgenmesh::outnodes(tetgenio* out)
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// outmetrics()    Output the metric to a file (*.mtr) or a tetgenio obj.    //
+// outneighbors()    Output tet neighbors to a .neigh file or a structure.   //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-void tetgenmesh::outmetrics(tetgenio* out)
+void tetgenmesh::outneighbors(tetgenio* out)
 {
   FILE *outfile = NULL;
-  char outmtrfilename[FILENAMESIZE];
-  point ptloop;
-  int mtrindex = 0;
+  char neighborfilename[FILENAMESIZE];
+  int *nlist = NULL, *olist = NULL, *alist = NULL;
+  int index = 0, adjindex = 0;
+  triface tetloop, tetsym;
+  int neighbori[4];
+  int firstindex;
+  int elementnumber;
+  long ntets;
   int i;
-  int msize = (sizeoftensor - useinsertradius);
-  if (msize == 0) {
-    return;
-  }
 
   if (out == (tetgenio *) NULL) {
-    strcpy(outmtrfilename, b->outfilename);
-    strcat(outmtrfilename, ".mtr");
+    strcpy(neighborfilename, b->outfilename);
+    strcat(neighborfilename, ".neigh");
   }
 
   if (!b->quiet) {
     if (out == (tetgenio *) NULL) {
-      printf("Writing %s.\n", outmtrfilename);
+      printf("Writing %s.\n", neighborfilename);
     } else {
-      printf("Writing metrics.\n");
+      printf("Writing neighbors.\n");
     }
   }
 
+  ntets = tetrahedrons->items - hullsize;
+
   if (out == (tetgenio *) NULL) {
-    outfile = fopen(outmtrfilename, "w");
+    outfile = fopen(neighborfilename, "w");
     if (outfile == (FILE *) NULL) {
-      printf("File I/O Error:  Cannot create file %s.\n", outmtrfilename);
-      terminatetetgen(this, 3);
+      printf("File I/O Error:  Cannot create file %s.\n", neighborfilename);
+      terminatetetgen(this, 1);
     }
-    // Number of points, number of point metrices,
-    fprintf(outfile, "%ld  %d\n", points->items, msize);
+    // Number of tetrahedra, four faces per tetrahedron.
+    fprintf(outfile, "%ld  %d\n", ntets, 4);
   } else {
-    // Allocate space for 'pointmtrlist'.
-    out->numberofpointmtrs = msize; 
-    out->pointmtrlist = new REAL[points->items * msize];
-    if (out->pointmtrlist == (REAL *) NULL) {
+    // Allocate memory for 'neighborlist'.
+    out->neighborlist = new int[ntets * 4];
+    if (out->neighborlist == (int *) NULL) {
+      printf("Error:  Out of memory.\n");
+      terminatetetgen(this, 1);
+    }
+    nlist = out->neighborlist;
+    // Allocate memory for the CSR adjacency. Each interior face is listed
+    //   twice, each hull face is not listed.
+    out->neighboroffsetlist = new int[ntets + 1];
+    out->neighboradjlist = new int[ntets * 4 - hullsize];
+    if ((out->neighboroffsetlist == (int *) NULL) ||
+        (out->neighboradjlist == (int *) NULL)) {
+      printf("Error:  Out of memory.\n");
       terminatetetgen(this, 1);
     }
+    olist = out->neighboroffsetlist;
+    alist = out->neighboradjlist;
   }
 
-  points->traversalinit();
-  ptloop = pointtraverse();
-  while (ptloop != (point) NULL) {
-    if (out == (tetgenio *) NULL) {
-      for (i = 0; i < msize; i++) {
-        fprintf(outfile, " %-16.8e", ptloop[pointmtrindex + i]);
+  // Determine the first index (0 or 1).
+  firstindex = b->zeroindex ? 0 : in->firstnumber;
+
+  tetrahedrons->traversalinit();
+  tetloop.tet = tetrahedrontraverse();
+  elementnumber = firstindex; // in->firstnumber;
+  while (tetloop.tet != (tetrahedron *) NULL) {
+    for (tetloop.ver = 0; tetloop.ver < 4; tetloop.ver++) {
+      fsym(tetloop, tetsym);
+      if (!ishulltet(tetsym)) {
+        neighbori[tetloop.ver] = elemindex(tetsym.tet);
+      } else {
+        neighbori[tetloop.ver] = -1;
       }
-      fprintf(outfile, "\n");
+    }
+    if (out == (tetgenio *) NULL) {
+      // Tetrahedra number, neighboring tetrahedron numbers.
+      fprintf(outfile, "%4d    %4d  %4d  %4d  %4d\n", elementnumber,
+              neighbori[0], neighbori[1], neighbori[2], neighbori[3]);
     } else {
-      for (i = 0; i < msize; i++) {
-        out->pointmtrlist[mtrindex++] = ptloop[pointmtrindex + i];
+      olist[index >> 2] = adjindex;
+      for (i = 0; i < 4; i++) {
+        nlist[index++] = neighbori[i];
+        if (neighbori[i] != -1) {
+          alist[adjindex++] = neighbori[i];
+        }
       }
     }
-    ptloop = pointtraverse();
+    tetloop.tet = tetrahedrontraverse();
+    elementnumber++;
+  }
+
+  if (out != (tetgenio *) NULL) {
+    olist[ntets] = adjindex;
   }
 
-  // Output the point-to-tet map.
   if (out == (tetgenio *) NULL) {
-    strcpy(outmtrfilename, b->outfilename);
-    strcat(outmtrfilename, ".p2t");
+    fprintf(outfile, "# Generated by %s\n", b->commandline);
+    fclose(outfile);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// outvoronoi()    Output the Voronoi diagram to .v.node, .v.edge, v.face,   //
+//                 and .v.cell.                                              //
+//                                                                           //
+// The Voronoi diagram is the geometric dual of the Delaunay triangulation.  //
+// The Voronoi vertices are the circumcenters of Delaunay tetrahedra.  Each  //
+// Voronoi edge connects two Voronoi vertices at two sides of a common Dela- //
+// unay face. At a face of convex hull, it becomes a ray (goto the infinity).//
+// A Voronoi face is the convex hull of all Voronoi vertices around a common //
+// Delaunay edge. It is a closed polygon for any internal Delaunay edge. At a//
+// ridge, it is unbounded.  Each Voronoi cell is the convex hull of all Vor- //
+// onoi vertices around a common Delaunay vertex. It is a polytope for any   //
+// internal Delaunay vertex. It is an unbounded polyhedron for a Delaunay    //
+// vertex belonging to the convex hull.                                      //
+//                                                                           //
+// NOTE: This routine is only used when the input is only a set of point.    //
+// Comment: Special thanks to Victor Liu for finding and fixing few bugs.    //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+void tetgenmesh::outvoronoi(tetgenio* out)
+{
+  FILE *outfile = NULL;
+  char outfilename[FILENAMESIZE];
+  tetgenio::voroedge *vedge = NULL;
+  tetgenio::vorofacet *vfacet = NULL;
+  arraypool *tetlist, *ptlist;
+  triface tetloop, worktet, spintet, firsttet;
+  point pt[4], ploop, neipt;
+  REAL ccent[3], infvec[3], vec1[3], vec2[3], L;
+  long ntets, faces, edges, ncells;
+  int *indexarray, *fidxs, *eidxs;
+  int arraysize, *vertarray = NULL;
+  int vpointcount, vedgecount, vfacecount, tcount;
+  int ishullvert, ishullface;
+  int index, shift, end1, end2;
+  int i, j;
+
+  int t1ver; // used by fsymself()
+
+  // Output Voronoi vertices to .v.node file.
+  if (out == (tetgenio *) NULL) {
+    strcpy(outfilename, b->outfilename);
+    strcat(outfilename, ".v.node");
   }
 
   if (!b->quiet) {
     if (out == (tetgenio *) NULL) {
-      printf("Writing %s.\n", outmtrfilename);
+      printf("Writing %s.\n", outfilename);
     } else {
-      printf("Writing point-to-tet map.\n");
+      printf("Writing Voronoi vertices.\n");
+    }
+  }
+
+  // Determine the first index (0 or 1).
+  shift = (b->zeroindex ? 0 : in->firstnumber);
+
+  // Each face and edge of the tetrahedral mesh will be indexed for indexing
+  //   the Voronoi edges and facets. Indices of faces and edges are saved in
+  //   each tetrahedron (including hull tets).
+
+  // Allocate the total space once.
+  indexarray = new int[tetrahedrons->items * 10];
+
+  // Allocate space (10 integers) into each tetrahedron. It re-uses the slot
+  //   for element markers, flags.
+  i = 0;
+  tetrahedrons->traversalinit();
+  tetloop.tet = alltetrahedrontraverse();
+  while (tetloop.tet != NULL) {
+    tetloop.tet[elemindexindex + 1] = (tetrahedron) &(indexarray[i * 10]);
+    i++;
+    tetloop.tet = alltetrahedrontraverse();
+  }
+
+  // The number of tetrahedra (excluding hull tets) (Voronoi vertices).
+  ntets = tetrahedrons->items - hullsize;
+  // The number of Delaunay faces (Voronoi edges).
+  faces = (4l * ntets + hullsize) / 2l;
+  // The number of Delaunay edges (Voronoi faces).
+  long vsize = points->items - dupverts - unuverts;
+  if (b->weighted) vsize -= nonregularcount;
+  if (!nonconvex) {
+    edges = vsize + faces - ntets - 1;
+  } else {
+    if (meshedges == 0l) {
+      numberedges(); // Count edges.
     }
+    edges = meshedges; 
   }
 
   if (out == (tetgenio *) NULL) {
-    outfile = fopen(outmtrfilename, "w");
+    outfile = fopen(outfilename, "w");
     if (outfile == (FILE *) NULL) {
-      printf("File I/O Error:  Cannot create file %s.\n", outmtrfilename);
+      printf("File I/O Error:  Cannot create file %s.\n", outfilename);
       terminatetetgen(this, 3);
     }
-    // Number of points,
-    //fprintf(outfile, "%ld\n", points->items);
+    // Number of voronoi points, 3 dim, no attributes, no marker.
+    fprintf(outfile, "%ld  3  0  0\n", ntets);
   } else {
-    // Allocate space for 'point2tetlist'.
-    out->point2tetlist = new int[points->items];
-    if (out->point2tetlist == (int *) NULL) {
+    // Allocate space for 'vpointlist'.
+    out->numberofvpoints = (int) ntets;
+    out->vpointlist = new REAL[out->numberofvpoints * 3];
+    if (out->vpointlist == (REAL *) NULL) {
       terminatetetgen(this, 1);
     }
   }
 
-  // The list of tetrahedra must be indexed.
-  if (bgm != NULL) {
-    bgm->indexelements();
-  }
-  // Determine the first index (0 or 1).
-  int firstindex = b->zeroindex ? 0 : in->firstnumber;
-  int pointindex = firstindex;
-  i = 0;
-
-  triface parenttet;
-  points->traversalinit();
-  ptloop = pointtraverse();
-  while (ptloop != (point) NULL) {
-    if (bgm != NULL) {
-	  bgm->decode(point2bgmtet(ptloop), parenttet);
-	} else {
-	  decode(point2tet(ptloop), parenttet);
-	}
+  // Output Voronoi vertices (the circumcenters of tetrahedra). 
+  tetrahedrons->traversalinit();
+  tetloop.tet = tetrahedrontraverse();
+  vpointcount = 0; // The (internal) v-index always starts from 0. 
+  index = 0;
+  while (tetloop.tet != (tetrahedron *) NULL) {
+    for (i = 0; i < 4; i++) {
+      pt[i] = (point) tetloop.tet[4 + i];
+      setpoint2tet(pt[i], encode(tetloop));
+    }
+    if (b->weighted) {
+      orthosphere(pt[0], pt[1], pt[2], pt[3], pt[0][3], pt[1][3], pt[2][3], 
+                  pt[3][3], ccent, NULL);
+    } else {
+      circumsphere(pt[0], pt[1], pt[2], pt[3], ccent, NULL);
+    }
     if (out == (tetgenio *) NULL) {
-      fprintf(outfile, "%d  %d\n", pointindex, elemindex(parenttet.tet));
+      fprintf(outfile, "%4d  %16.8e %16.8e %16.8e\n", vpointcount + shift,
+              ccent[0], ccent[1], ccent[2]);
     } else {
-      out->point2tetlist[i] = elemindex(parenttet.tet);
+      out->vpointlist[index++] = ccent[0];
+      out->vpointlist[index++] = ccent[1];
+      out->vpointlist[index++] = ccent[2];
     }
-	pointindex++;
-	i++;
-    ptloop = pointtraverse();
+    setelemindex(tetloop.tet, vpointcount);
+    vpointcount++;
+    tetloop.tet = tetrahedrontraverse();
   }
 
   if (out == (tetgenio *) NULL) {
     fprintf(outfile, "# Generated by %s\n", b->commandline);
     fclose(outfile);
   }
-}
-
-///////////////////////////////////////////////////////////////////////////////
-//                                                                           //
-// outelements()    Output the tetrahedra to an .ele file or a tetgenio      //
-//                  structure.                                               //
-//                                                                           //
-// This routine also indexes all tetrahedra (exclusing hull tets) (from in-> //
-// firstnumber). The total number of mesh edges is counted in 'meshedges'.   //
-//                                                                           //
-///////////////////////////////////////////////////////////////////////////////
-
-void tetgenmesh::outelements(tetgenio* out)
-{
-  FILE *outfile = NULL;
-  char outelefilename[FILENAMESIZE];
-  tetrahedron* tptr;
-  point p1, p2, p3, p4;
-  point *extralist;
-  REAL *talist = NULL;
-  int *tlist = NULL;
-  long ntets;
-  int firstindex, shift;
-  int pointindex, attribindex;
-  int highorderindex = 11; 
-  int elementnumber;
-  int eextras;
-  int i;
 
+  // Output Voronoi edges to .v.edge file.
   if (out == (tetgenio *) NULL) {
-    strcpy(outelefilename, b->outfilename);
-    strcat(outelefilename, ".ele");
+    strcpy(outfilename, b->outfilename);
+    strcat(outfilename, ".v.edge");
   }
-
+  
   if (!b->quiet) {
     if (out == (tetgenio *) NULL) {
-      printf("Writing %s.\n", outelefilename);
+      printf("Writing %s.\n", outfilename);
     } else {
-      printf("Writing elements.\n");
+      printf("Writing Voronoi edges.\n");
     }
   }
 
-  // The number of tets excluding hull tets.
-  ntets = tetrahedrons->items - hullsize;
-
-  eextras = numelemattrib;
   if (out == (tetgenio *) NULL) {
-    outfile = fopen(outelefilename, "w");
+    outfile = fopen(outfilename, "w");
     if (outfile == (FILE *) NULL) {
-      printf("File I/O Error:  Cannot create file %s.\n", outelefilename);
-      terminatetetgen(this, 1);
+      printf("File I/O Error:  Cannot create file %s.\n", outfilename);
+      terminatetetgen(this, 3);
     }
-    // Number of tetras, points per tetra, attributes per tetra.
-    fprintf(outfile, "%ld  %d  %d\n", ntets, b->order == 1 ? 4 : 10, eextras);
+    // Number of Voronoi edges, no marker.
+    fprintf(outfile, "%ld  0\n", faces);
   } else {
-    // Allocate memory for output tetrahedra.
-    out->tetrahedronlist = new int[ntets * (b->order == 1 ? 4 : 10)];
-    if (out->tetrahedronlist == (int *) NULL) {
-      printf("Error:  Out of memory.\n");
-      terminatetetgen(this, 1);
-    }
-    // Allocate memory for output tetrahedron attributes if necessary.
-    if (eextras > 0) {
-      out->tetrahedronattributelist = new REAL[ntets * eextras];
-      if (out->tetrahedronattributelist == (REAL *) NULL) {
-        printf("Error:  Out of memory.\n");
-        terminatetetgen(this, 1);
-      }
-    }
-    out->numberoftetrahedra = ntets;
-    out->numberofcorners = b->order == 1 ? 4 : 10;
-    out->numberoftetrahedronattributes = eextras;
-    tlist = out->tetrahedronlist;
-    talist = out->tetrahedronattributelist;
-    pointindex = 0;
-    attribindex = 0;
-  }
-
-  // Determine the first index (0 or 1).
-  firstindex = b->zeroindex ? 0 : in->firstnumber;
-  shift = 0; // Default no shift.
-  if ((in->firstnumber == 1) && (firstindex == 0)) {
-    shift = 1; // Shift the output indices by 1.
+    // Allocate space for 'vpointlist'.
+    out->numberofvedges = (int) faces;
+    out->vedgelist = new tetgenio::voroedge[out->numberofvedges];
   }
 
+  // Output the Voronoi edges. 
   tetrahedrons->traversalinit();
-  tptr = tetrahedrontraverse();
-  elementnumber = firstindex; // in->firstnumber;
-  while (tptr != (tetrahedron *) NULL) {
-    if (!b->reversetetori) {
-      p1 = (point) tptr[4];
-      p2 = (point) tptr[5];
-    } else {
-      p1 = (point) tptr[5];
-      p2 = (point) tptr[4];
-    }
-    p3 = (point) tptr[6];
-    p4 = (point) tptr[7];
-    if (out == (tetgenio *) NULL) {
-      // Tetrahedron number, indices for four points.
-      fprintf(outfile, "%5d   %5d %5d %5d %5d", elementnumber,
-              pointmark(p1) - shift, pointmark(p2) - shift,
-              pointmark(p3) - shift, pointmark(p4) - shift);
-      if (b->order == 2) {
-        extralist = (point *) tptr[highorderindex];
-        // indices for six extra points.
-        fprintf(outfile, "  %5d %5d %5d %5d %5d %5d",
-          pointmark(extralist[0]) - shift, pointmark(extralist[1]) - shift,
-          pointmark(extralist[2]) - shift, pointmark(extralist[3]) - shift,
-          pointmark(extralist[4]) - shift, pointmark(extralist[5]) - shift);
-      }
-      for (i = 0; i < eextras; i++) {
-        fprintf(outfile, "    %.17g", elemattribute(tptr, i));
-      }
-      fprintf(outfile, "\n");
-    } else {
-      tlist[pointindex++] = pointmark(p1) - shift;
-      tlist[pointindex++] = pointmark(p2) - shift;
-      tlist[pointindex++] = pointmark(p3) - shift;
-      tlist[pointindex++] = pointmark(p4) - shift;
-      if (b->order == 2) {
-        extralist = (point *) tptr[highorderindex];
-        tlist[pointindex++] = pointmark(extralist[0]) - shift;
-        tlist[pointindex++] = pointmark(extralist[1]) - shift;
-        tlist[pointindex++] = pointmark(extralist[2]) - shift;
-        tlist[pointindex++] = pointmark(extralist[3]) - shift;
-        tlist[pointindex++] = pointmark(extralist[4]) - shift;
-        tlist[pointindex++] = pointmark(extralist[5]) - shift;
-      }
-      for (i = 0; i < eextras; i++) {
-        talist[attribindex++] = elemattribute(tptr, i);
-      }
-    }
-    // Remember the index of this element (for counting edges).
-    setelemindex(tptr, elementnumber);
-	if (b->metric) { // -m option
-	  // Update the point-to-tet map, so that every point is pointing
-	  //   to a real tet, not a fictious one. Used by .p2t file.
-	  for (int i = 0; i < 4; i++) {
-	    setpoint2tet((point) (tptr[4 + i]), (tetrahedron) tptr);
-	  }
-	}
-    tptr = tetrahedrontraverse();
-    elementnumber++;
+  tetloop.tet = tetrahedrontraverse();
+  vedgecount = 0; // D-Face (V-edge) index (from zero).
+  index = 0; // The Delaunay-face index.
+  while (tetloop.tet != (tetrahedron *) NULL) {
+    // Count the number of Voronoi edges. Look at the four faces of each
+    //   tetrahedron. Count the face if the tetrahedron's index is
+    //   smaller than its neighbor's or the neighbor is outside.
+    end1 = elemindex(tetloop.tet);
+    for (tetloop.ver = 0; tetloop.ver < 4; tetloop.ver++) {
+      fsym(tetloop, worktet);
+      if (ishulltet(worktet) || 
+          (elemindex(tetloop.tet) < elemindex(worktet.tet))) {
+        // Found a Voronoi edge. Operate on it.
+        if (out == (tetgenio *) NULL) {
+          fprintf(outfile, "%4d  %4d", vedgecount + shift, end1 + shift);
+        } else {
+          vedge = &(out->vedgelist[index++]);
+          vedge->v1 = end1 + shift;
+        }
+        if (!ishulltet(worktet)) {
+          end2 = elemindex(worktet.tet);
+        } else {
+          end2 = -1;
+        }
+        // Note that end2 may be -1 (worktet.tet is outside).
+        if (end2 == -1) {
+          // Calculate the out normal of this hull face.
+          pt[0] = dest(worktet);
+          pt[1] = org(worktet);
+          pt[2] = apex(worktet);
+          for (j = 0; j < 3; j++) vec1[j] = pt[1][j] - pt[0][j];
+          for (j = 0; j < 3; j++) vec2[j] = pt[2][j] - pt[0][j];
+          cross(vec1, vec2, infvec);
+          // Normalize it.
+          L = sqrt(infvec[0] * infvec[0] + infvec[1] * infvec[1]
+                   + infvec[2] * infvec[2]);
+          if (L > 0) for (j = 0; j < 3; j++) infvec[j] /= L;
+          if (out == (tetgenio *) NULL) {
+            fprintf(outfile, " -1");
+            fprintf(outfile, " %g %g %g\n", infvec[0], infvec[1], infvec[2]);
+          } else {
+            vedge->v2 = -1;
+            vedge->vnormal[0] = infvec[0];
+            vedge->vnormal[1] = infvec[1];
+            vedge->vnormal[2] = infvec[2];
+          }
+        } else {
+          if (out == (tetgenio *) NULL) {
+            fprintf(outfile, " %4d\n", end2 + shift);
+          } else {
+            vedge->v2 = end2 + shift;
+            vedge->vnormal[0] = 0.0;
+            vedge->vnormal[1] = 0.0;
+            vedge->vnormal[2] = 0.0;
+          }
+        }
+        // Save the V-edge index in this tet and its neighbor.
+        fidxs = (int *) (tetloop.tet[elemindexindex + 1]);
+        fidxs[tetloop.ver] = vedgecount;
+        fidxs = (int *) (worktet.tet[elemindexindex + 1]);
+        fidxs[worktet.ver & 3] = vedgecount;
+        vedgecount++;
+      }
+    } // tetloop.ver
+    tetloop.tet = tetrahedrontraverse();
   }
 
-
   if (out == (tetgenio *) NULL) {
     fprintf(outfile, "# Generated by %s\n", b->commandline);
     fclose(outfile);
   }
-}
-
-///////////////////////////////////////////////////////////////////////////////
-//                                                                           //
-// outfaces()    Output all faces to a .face file or a tetgenio object.      //
-//                                                                           //
-///////////////////////////////////////////////////////////////////////////////
-
-void tetgenmesh::outfaces(tetgenio* out)
-{
-  FILE *outfile = NULL;
-  char facefilename[FILENAMESIZE];
-  triface tface, tsymface;
-  face checkmark;
-  point torg, tdest, tapex;
-  long ntets, faces;
-  int *elist = NULL, *emlist = NULL;
-  int neigh1 = 0, neigh2 = 0;
-  int marker = 0;
-  int firstindex, shift;
-  int facenumber;
-  int index = 0;
-
-  // For -o2 option.
-  triface workface;
-  point *extralist, pp[3] = {0,0,0}; 
-  int highorderindex = 11; 
-  int o2index = 0, i;
-
-  // For -nn option.
-  int *tet2facelist = NULL;
-  int tidx; 
 
+  // Output Voronoi faces to .v.face file.
   if (out == (tetgenio *) NULL) {
-    strcpy(facefilename, b->outfilename);
-    strcat(facefilename, ".face");
+    strcpy(outfilename, b->outfilename);
+    strcat(outfilename, ".v.face");
   }
-
+  
   if (!b->quiet) {
     if (out == (tetgenio *) NULL) {
-      printf("Writing %s.\n", facefilename);
+      printf("Writing %s.\n", outfilename);
     } else {
-      printf("Writing faces.\n");
+      printf("Writing Voronoi faces.\n");
     }
   }
 
-  ntets = tetrahedrons->items - hullsize;
-  faces = (ntets * 4l + hullsize) / 2l;
-
   if (out == (tetgenio *) NULL) {
-    outfile = fopen(facefilename, "w");
+    outfile = fopen(outfilename, "w");
     if (outfile == (FILE *) NULL) {
-      printf("File I/O Error:  Cannot create file %s.\n", facefilename);
-      terminatetetgen(this, 1);
+      printf("File I/O Error:  Cannot create file %s.\n", outfilename);
+      terminatetetgen(this, 3);
     }
-    fprintf(outfile, "%ld  %d\n", faces, !b->nobound);
+    // Number of Voronoi faces.
+    fprintf(outfile, "%ld  0\n", edges);
   } else {
-    // Allocate memory for 'trifacelist'.
-    out->trifacelist = new int[faces * 3];
-    if (out->trifacelist == (int *) NULL) {
-      printf("Error:  Out of memory.\n");
+    out->numberofvfacets = edges;
+    out->vfacetlist = new tetgenio::vorofacet[out->numberofvfacets];
+    if (out->vfacetlist == (tetgenio::vorofacet *) NULL) {
       terminatetetgen(this, 1);
     }
-    if (b->order == 2) {
-      out->o2facelist = new int[faces * 3];
-    }
-    // Allocate memory for 'trifacemarkerlist' if necessary.
-    if (!b->nobound) {
-      out->trifacemarkerlist = new int[faces];
-      if (out->trifacemarkerlist == (int *) NULL) {
-        printf("Error:  Out of memory.\n");
-        terminatetetgen(this, 1);
-      }
-    }
-    if (b->neighout > 1) {
-      // '-nn' switch.
-      out->face2tetlist = new int[faces * 2];
-      if (out->face2tetlist == (int *) NULL) {
-        printf("Error:  Out of memory.\n");
-        terminatetetgen(this, 1);
-      }
-    }
-    out->numberoftrifaces = faces;
-    elist = out->trifacelist;
-    emlist = out->trifacemarkerlist;
-  }
-
-  if (b->neighout > 1) { // -nn option
-    // Output the tetrahedron-to-face map.
-    tet2facelist = new int[ntets * 4];
-  }
-
-  // Determine the first index (0 or 1).
-  firstindex = b->zeroindex ? 0 : in->firstnumber;
-  shift = 0; // Default no shiftment.
-  if ((in->firstnumber == 1) && (firstindex == 0)) {
-    shift = 1; // Shift the output indices by 1.
   }
 
+  // Output the Voronoi facets.
   tetrahedrons->traversalinit();
-  tface.tet = tetrahedrontraverse();
-  facenumber = firstindex; // in->firstnumber;
-  // To loop over the set of faces, loop over all tetrahedra, and look at
-  //   the four faces of each one. If its adjacent tet is a hull tet,
-  //   operate on the face, otherwise, operate on the face only if the
-  //   current tet has a smaller index than its neighbor.
-  while (tface.tet != (tetrahedron *) NULL) {
-    for (tface.ver = 0; tface.ver < 4; tface.ver ++) {
-      fsym(tface, tsymface);
-      if (ishulltet(tsymface) || 
-          (elemindex(tface.tet) < elemindex(tsymface.tet))) {
-        torg = org(tface);
-        tdest = dest(tface);
-        tapex = apex(tface);
-        if (b->order == 2) { // -o2
-          // Get the three extra vertices on edges.
-          extralist = (point *) (tface.tet[highorderindex]);
-          // The extra vertices are on edges opposite the corners.
-          enext(tface, workface);
-          for (i = 0; i < 3; i++) {
-            pp[i] = extralist[ver2edge[workface.ver]];
-            enextself(workface);
+  tetloop.tet = tetrahedrontraverse();
+  vfacecount = 0; // D-edge (V-facet) index (from zero).
+  while (tetloop.tet != (tetrahedron *) NULL) {
+    // Count the number of Voronoi faces. Look at the six edges of each
+    //   tetrahedron. Count the edge only if the tetrahedron's index is
+    //   smaller than those of all other tetrahedra that share the edge.
+    worktet.tet = tetloop.tet;
+    for (i = 0; i < 6; i++) {
+      worktet.ver = edge2ver[i];
+      // Count the number of faces at this edge. If the edge is a hull edge,
+      //   the face containing dummypoint is also counted.
+      //ishulledge = 0; // Is it a hull edge.
+      tcount = 0;
+      firsttet = worktet;
+      spintet = worktet;
+      while (1) {
+        tcount++;
+        fnextself(spintet);
+        if (spintet.tet == worktet.tet) break;
+        if (!ishulltet(spintet)) {
+          if (elemindex(spintet.tet) < elemindex(worktet.tet)) break;
+        } else {
+          //ishulledge = 1;
+          if (apex(spintet) == dummypoint) {
+            // We make this V-edge appear in the end of the edge list.
+            fnext(spintet, firsttet); 
           }
         }
-        if (!b->nobound) {
-          // Get the boundary marker of this face.
-          if (b->plc || b->refine) { 
-            // Shell face is used.
-            tspivot(tface, checkmark);
-            if (checkmark.sh == NULL) {
-              marker = 0;  // It is an inner face. It's marker is 0.
-            } else {
-              marker = shellmark(checkmark);
-            }
-          } else {
-            // Shell face is not used, only distinguish outer and inner face.
-            marker = (int) ishulltet(tsymface);
-          }
+      } // while (1)
+      if (spintet.tet == worktet.tet) {
+        // Found a Voronoi facet. Operate on it.
+        pt[0] = org(worktet);
+        pt[1] = dest(worktet);
+        end1 = pointmark(pt[0]) - in->firstnumber; // V-cell index
+        end2 = pointmark(pt[1]) - in->firstnumber;
+        if (out == (tetgenio *) NULL) {
+          fprintf(outfile, "%4d  %4d %4d  %-2d ", vfacecount + shift, 
+                  end1 + shift, end2 + shift, tcount);
+        } else {
+          vfacet = &(out->vfacetlist[vfacecount]);
+          vfacet->c1 = end1 + shift;
+          vfacet->c2 = end2 + shift;
+          vfacet->elist = new int[tcount + 1];
+          vfacet->elist[0] = tcount;
+          index = 1;
         }
-        if (b->neighout > 1) {
-          // '-nn' switch. Output adjacent tets indices.
-          if (!ishulltet(tface)) {
-            neigh1 = elemindex(tface.tet);
+        // Output V-edges of this V-facet.
+        spintet = firsttet; //worktet;
+        while (1) {
+          fidxs = (int *) (spintet.tet[elemindexindex + 1]);
+          if (apex(spintet) != dummypoint) {
+            vedgecount = fidxs[spintet.ver & 3];
+            ishullface = 0;
           } else {
-            neigh1 = -1;
+            ishullface = 1; // It's not a real face.
           }
-          if (!ishulltet(tsymface)) {
-            neigh2 = elemindex(tsymface.tet);
+          if (out == (tetgenio *) NULL) {
+            fprintf(outfile, " %d", !ishullface ? (vedgecount + shift) : -1); 
           } else {
-            neigh2 = -1;  
+            vfacet->elist[index++] = !ishullface ? (vedgecount + shift) : -1;
           }
-		  // Fill the tetrahedron-to-face map.
-		  tidx = elemindex(tface.tet) - firstindex;
-		  tet2facelist[tidx * 4 + tface.ver] = facenumber;
-		  if (!ishulltet(tsymface)) {
-		    tidx = elemindex(tsymface.tet) - firstindex;
-			tet2facelist[tidx * 4 + (tsymface.ver & 3)] = facenumber;
-		  }
-        }
+          // Save the V-facet index in this tet at this edge.
+          eidxs = &(fidxs[4]);
+          eidxs[ver2edge[spintet.ver]] = vfacecount;
+          // Go to the next face.
+          fnextself(spintet);
+          if (spintet.tet == firsttet.tet) break;
+        } // while (1)
         if (out == (tetgenio *) NULL) {
-          // Face number, indices of three vertices.
-          fprintf(outfile, "%5d   %4d  %4d  %4d", facenumber,
-                  pointmark(torg) - shift, pointmark(tdest) - shift,
-                  pointmark(tapex) - shift);
-          if (b->order == 2) { // -o2
-            fprintf(outfile, "  %4d  %4d  %4d", pointmark(pp[0]) - shift, 
-                    pointmark(pp[1]) - shift, pointmark(pp[2]) - shift);
-          }
-          if (!b->nobound) {
-            // Output a boundary marker.
-            fprintf(outfile, "  %d", marker);
-          }
-          if (b->neighout > 1) {
-            fprintf(outfile, "    %5d  %5d", neigh1, neigh2);
-          }
-          fprintf(outfile, "\n");
-        } else {
-          // Output indices of three vertices.
-          elist[index++] = pointmark(torg) - shift;
-          elist[index++] = pointmark(tdest) - shift;
-          elist[index++] = pointmark(tapex) - shift;
-          if (b->order == 2) { // -o2
-            out->o2facelist[o2index++] = pointmark(pp[0]) - shift;
-            out->o2facelist[o2index++] = pointmark(pp[1]) - shift;
-            out->o2facelist[o2index++] = pointmark(pp[2]) - shift;
-          }
-          if (!b->nobound) {
-            emlist[facenumber - in->firstnumber] = marker;
-          }
-          if (b->neighout > 1) {
-            out->face2tetlist[(facenumber - in->firstnumber) * 2]     = neigh1;
-            out->face2tetlist[(facenumber - in->firstnumber) * 2 + 1] = neigh2;
-          }
-        }
-        facenumber++;
-      }
-    }
-    tface.tet = tetrahedrontraverse();
+          fprintf(outfile, "\n");
+        }
+        vfacecount++;
+      } // if (spintet.tet == worktet.tet)
+    } // if (i = 0; i < 6; i++)
+    tetloop.tet = tetrahedrontraverse();
   }
 
   if (out == (tetgenio *) NULL) {
@@ -29523,663 +31854,1441 @@ void tetgenmesh::outfaces(tetgenio* out)
     fclose(outfile);
   }
 
-  if (b->neighout > 1) { // -nn option
-    // Output the tetrahedron-to-face map.
-	if (out == (tetgenio *) NULL) {
-	  strcpy(facefilename, b->outfilename);
-      strcat(facefilename, ".t2f");
+  // Output Voronoi cells to .v.cell file.
+  if (out == (tetgenio *) NULL) {
+    strcpy(outfilename, b->outfilename);
+    strcat(outfilename, ".v.cell");
+  }
+  
+  if (!b->quiet) {
+    if (out == (tetgenio *) NULL) {
+      printf("Writing %s.\n", outfilename);
+    } else {
+      printf("Writing Voronoi cells.\n");
     }
-	if (!b->quiet) {
+  }
+
+  // Count the Voronoi cells. Non-regular vertices (-w) have no cell.
+  ncells = 0l;
+  points->traversalinit();
+  ploop = pointtraverse();
+  while (ploop != (point) NULL) {
+    if ((pointtype(ploop) != UNUSEDVERTEX) &&
+        (pointtype(ploop) != DUPLICATEDVERTEX) &&
+        (pointtype(ploop) != NREGULARVERTEX)) {
+      ncells++;
+    }
+    ploop = pointtraverse();
+  }
+
+  if (out == (tetgenio *) NULL) {
+    outfile = fopen(outfilename, "w");
+    if (outfile == (FILE *) NULL) {
+      printf("File I/O Error:  Cannot create file %s.\n", outfilename);
+      terminatetetgen(this, 3);
+    }
+    // Number of Voronoi cells.
+    fprintf(outfile, "%ld\n", ncells);
+  } else {
+    out->numberofvcells = (int) ncells;
+    out->vcelllist = new int*[out->numberofvcells];
+    if (out->vcelllist == (int **) NULL) {
+      terminatetetgen(this, 1);
+    }
+  }
+
+  // Output Voronoi cells.
+  tetlist = cavetetlist;
+  ptlist = cavetetvertlist;
+  points->traversalinit();
+  ploop = pointtraverse();
+  vpointcount = 0;
+  while (ploop != (point) NULL) {
+    if ((pointtype(ploop) != UNUSEDVERTEX) &&
+        (pointtype(ploop) != DUPLICATEDVERTEX) &&
+        (pointtype(ploop) != NREGULARVERTEX)) { 
+      getvertexstar(1, ploop, tetlist, ptlist, NULL);
+      // Mark all vertices. Check if it is a hull vertex.
+      ishullvert = 0;
+      for (i = 0; i < ptlist->objects; i++) {
+        neipt = * (point *) fastlookup(ptlist, i);
+        if (neipt != dummypoint) {
+          pinfect(neipt);
+        } else {
+          ishullvert = 1;
+        }
+      }
+      tcount = (int) ptlist->objects;
       if (out == (tetgenio *) NULL) {
-        printf("Writing %s.\n", facefilename);
+        fprintf(outfile, "%4d  %-2d ", vpointcount + shift, tcount);
       } else {
-        printf("Writing tetrahedron-to-face map.\n");
+        arraysize = tcount;
+        vertarray = new int[arraysize + 1];
+        out->vcelllist[vpointcount] = vertarray;
+        vertarray[0] = tcount;
+        index = 1;
       }
-    }
-	if (out == (tetgenio *) NULL) {
-      outfile = fopen(facefilename, "w");
-      for (tidx = 0; tidx < ntets; tidx++) {
-        index = tidx * 4;
-        fprintf(outfile, "%4d  %d %d %d %d\n", tidx + in->firstnumber,
-                tet2facelist[index], tet2facelist[index+1], 
-                tet2facelist[index+2], tet2facelist[index+3]);
+      // List Voronoi facets bounding this cell.
+      for (i = 0; i < tetlist->objects; i++) {
+        worktet = * (triface *) fastlookup(tetlist, i);
+        // Let 'worktet' be [a,b,c,d] where d = ploop.
+        for (j = 0; j < 3; j++) {
+          neipt = org(worktet); // neipt is a, or b, or c
+          // Skip the dummypoint.
+          if (neipt != dummypoint) {
+            if (pinfected(neipt)) {
+              // It's not processed yet.
+              puninfect(neipt);
+              // Go to the DT edge [a,d], or [b,d], or [c,d]. 
+              esym(worktet, spintet);
+              enextself(spintet);
+              // Get the V-face dual to this edge.
+              eidxs = (int *) spintet.tet[elemindexindex + 1];
+              vfacecount = eidxs[4 + ver2edge[spintet.ver]];
+              if (out == (tetgenio *) NULL) {
+                fprintf(outfile, " %d", vfacecount + shift);
+              } else {
+                vertarray[index++] = vfacecount + shift;
+              }
+            }
+          }
+          enextself(worktet);
+        } // j
+      } // i
+      if (ishullvert) {
+        // Add a hull facet (-1) to the facet list.
+        if (out == (tetgenio *) NULL) {
+          fprintf(outfile, " -1");
+        } else {
+          vertarray[index++] = -1;
+        }
       }
-      fclose(outfile);
-      delete [] tet2facelist;
-    } else {
-	  // Simply copy the address of the list to the output.
-      out->tet2facelist = tet2facelist;
+      if (out == (tetgenio *) NULL) {
+        fprintf(outfile, "\n");
+      }
+      tetlist->restart();
+      ptlist->restart();
+      vpointcount++;
     }
+    ploop = pointtraverse();
+  }
+
+  // Delete the space for face/edge indices.
+  delete [] indexarray;
+
+  if (out == (tetgenio *) NULL) {
+    fprintf(outfile, "# Generated by %s\n", b->commandline);
+    fclose(outfile);
   }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// outhullfaces()    Output hull faces to a .face file or a tetgenio object. //
+// pointradius()    Return the radius of the sphere of a weighted point.     //
 //                                                                           //
-// The normal of each face is pointing to the outside of the domain.         //
+// A weighted point (p, P^2) is a sphere centered at 'p' with radius 'P'     //
+// (see orthosphere()).  Its lifted height p[0]^2 + p[1]^2 + p[2]^2 - P^2 is //
+// saved in the first point attribute (-w).  If no weight is used, return 0. //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-void tetgenmesh::outhullfaces(tetgenio* out)
+REAL tetgenmesh::pointradius(point pt)
 {
-  FILE *outfile = NULL;
-  char facefilename[FILENAMESIZE];
-  triface hulltet;
-  point torg, tdest, tapex;
-  int *elist = NULL;
-  int firstindex, shift;
-  int facenumber;
-  int index;
+  REAL w;
 
-  if (out == (tetgenio *) NULL) {
-    strcpy(facefilename, b->outfilename);
-    strcat(facefilename, ".face");
+  if (!b->weighted) return 0.0;
+
+  w = pt[0] * pt[0] + pt[1] * pt[1] + pt[2] * pt[2] - pt[3];
+  return (w > 0.0) ? sqrt(w) : 0.0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// tetfreeradius()    Return the radius of the largest empty sphere at the   //
+//                    Voronoi vertex dual to a tetrahedron.                  //
+//                                                                           //
+// 'pt' are the four vertices of the tetrahedron. The Voronoi (or power) ve- //
+// rtex is the circumcenter (or orthocenter, -w) of the tetrahedron, it is   //
+// returned in 'cent' if it is not a NULL.  The returned radius is the dist- //
+// ance from this vertex to the nearest sphere of the four weighted points.  //
+// It is negative if the vertex is covered by a sphere.                      //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+REAL tetgenmesh::tetfreeradius(point* pt, REAL* cent)
+{
+  REAL ccent[3], r, d;
+  bool valid;
+  int i;
+
+  if (b->weighted) {
+    valid = orthosphere(pt[0], pt[1], pt[2], pt[3], pt[0][3], pt[1][3], 
+                        pt[2][3], pt[3][3], ccent, NULL);
+  } else {
+    valid = circumsphere(pt[0], pt[1], pt[2], pt[3], ccent, NULL);
+  }
+  if (!valid) {
+    // A degenerate (flat) tetrahedron holds no sphere.
+    return 0.0;
   }
 
-  if (!b->quiet) {
-    if (out == (tetgenio *) NULL) {
-      printf("Writing %s.\n", facefilename);
-    } else {
-      printf("Writing faces.\n");
-    }
+  r = distance(ccent, pt[0]) - pointradius(pt[0]);
+  for (i = 1; i < 4; i++) {
+    d = distance(ccent, pt[i]) - pointradius(pt[i]);
+    if (d < r) r = d;
   }
 
-  if (out == (tetgenio *) NULL) {
-    outfile = fopen(facefilename, "w");
-    if (outfile == (FILE *) NULL) {
-      printf("File I/O Error:  Cannot create file %s.\n", facefilename);
-      terminatetetgen(this, 1);
-    }
-    fprintf(outfile, "%ld  0\n", hullsize);
-  } else {
-    // Allocate memory for 'trifacelist'.
-    out->trifacelist = new int[hullsize * 3];
-    if (out->trifacelist == (int *) NULL) {
-      printf("Error:  Out of memory.\n");
-      terminatetetgen(this, 1);
-    }
-    out->numberoftrifaces = hullsize;
-    elist = out->trifacelist;
-    index = 0;
+  if (cent != NULL) {
+    cent[0] = ccent[0];
+    cent[1] = ccent[1];
+    cent[2] = ccent[2];
   }
+  return r;
+}
 
-  // Determine the first index (0 or 1).
-  firstindex = b->zeroindex ? 0 : in->firstnumber;
-  shift = 0; // Default no shiftment.
-  if ((in->firstnumber == 1) && (firstindex == 0)) {
-    shift = 1; // Shift the output indices by 1.
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// facefreeradius()    Return the radius of the largest sphere which passes  //
+//                     through a face.                                       //
+//                                                                           //
+// The Voronoi edge dual to the face [a,b,c] crosses the plane of [a,b,c] at //
+// its (power) circumcenter x.  If x lies inside [a,b,c], the face is the    //
+// bottleneck of the Voronoi edge, and the distance from x to the nearest    //
+// sphere of a, b, and c is returned in 'radius'.  Otherwise, the narrowest  //
+// place of the Voronoi edge is at one of its endpoints, the face does not   //
+// restrict the passage, and FALSE is returned.                              //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+bool tetgenmesh::facefreeradius(point pa, point pb, point pc, REAL* radius)
+{
+  REAL A[4][4], rhs[4], D;
+  REAL x[3], v1[3], v2[3], n[3], wa, wb, wc, r, d;
+  int indx[4];
+  int i;
+
+  wa = pointradius(pa);
+  wb = pointradius(pb);
+  wc = pointradius(pc);
+
+  // Let y = x - a. The power center satisfies |y|^2 - wa^2 = |y - (b - a)|^2
+  //   - wb^2 = |y - (c - a)|^2 - wc^2, and y lies in the plane of [a,b,c].
+  for (i = 0; i < 3; i++) {
+    A[0][i] = pb[i] - pa[i];
+    A[1][i] = pc[i] - pa[i];
   }
+  cross(A[0], A[1], A[2]);
+  rhs[0] = 0.5 * (dot(A[0], A[0]) - wb * wb + wa * wa);
+  rhs[1] = 0.5 * (dot(A[1], A[1]) - wc * wc + wa * wa);
+  rhs[2] = 0.0;
+  for (i = 0; i < 3; i++) n[i] = A[2][i];
 
-  tetrahedrons->traversalinit();
-  hulltet.tet = alltetrahedrontraverse();
-  facenumber = firstindex;
-  while (hulltet.tet != (tetrahedron *) NULL) {
-    if (ishulltet(hulltet)) {
-      torg = (point) hulltet.tet[4];
-      tdest = (point) hulltet.tet[5];
-      tapex = (point) hulltet.tet[6];
-      if (out == (tetgenio *) NULL) {
-        // Face number, indices of three vertices.
-        fprintf(outfile, "%5d   %4d  %4d  %4d", facenumber,
-                pointmark(torg) - shift, pointmark(tdest) - shift,
-                pointmark(tapex) - shift);
-        fprintf(outfile, "\n");
-      } else {
-        // Output indices of three vertices.
-        elist[index++] = pointmark(torg) - shift;
-        elist[index++] = pointmark(tdest) - shift;
-        elist[index++] = pointmark(tapex) - shift;
-      }
-      facenumber++;
-    }
-    hulltet.tet = alltetrahedrontraverse();
+  if (!lu_decmp(A, 3, indx, &D, 0)) {
+    return false; // A degenerate face.
+  }
+  lu_solve(A, 3, indx, rhs, 0);
+  for (i = 0; i < 3; i++) x[i] = pa[i] + rhs[i];
+
+  // Is x inside [a,b,c]?  Check the orientations of [x,b,c], [a,x,c], and
+  //   [a,b,x] with respect to the normal of [a,b,c].
+  for (i = 0; i < 3; i++) {
+    v1[i] = pb[i] - x[i];
+    v2[i] = pc[i] - x[i];
   }
+  cross(v1, v2, A[3]);
+  if (dot(A[3], n) < 0) return false;
+  for (i = 0; i < 3; i++) {
+    v1[i] = pc[i] - x[i];
+    v2[i] = pa[i] - x[i];
+  }
+  cross(v1, v2, A[3]);
+  if (dot(A[3], n) < 0) return false;
+  for (i = 0; i < 3; i++) {
+    v1[i] = pa[i] - x[i];
+    v2[i] = pb[i] - x[i];
+  }
+  cross(v1, v2, A[3]);
+  if (dot(A[3], n) < 0) return false;
+
+  r = distance(x, pa) - wa;
+  d = distance(x, pb) - wb;
+  if (d < r) r = d;
+  d = distance(x, pc) - wc;
+  if (d < r) r = d;
+
+  *radius = r;
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// tetfreevolume()    Return the free volume of a tetrahedron.               //
+//                                                                           //
+// It is the volume of the tetrahedron minus the four spherical sectors cut  //
+// by its corners from the spheres of the weighted points.  The solid angle  //
+// at each corner is computed by the formula of Van Oosterom and Strackee,   //
+// "The Solid Angle of a Plane Triangle," IEEE Trans. Biomed. Eng. BME-30(2),//
+// 125-126, 1983.                                                            //
+//                                                                           //
+// The result is an approximation: the sectors are subtracted independently, //
+// so where the spheres of two corners overlap, the overlap is subtracted    //
+// twice, and a sector is not clipped where its sphere reaches beyond the    //
+// opposite face.  A negative result is returned as zero.                    //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+REAL tetgenmesh::tetfreevolume(point* pt)
+{
+  REAL va[3], vb[3], vc[3], n[3];
+  REAL la, lb, lc, numer, denom, omega;
+  REAL vol, r;
+  int i, j;
 
-  if (out == (tetgenio *) NULL) {
-    fprintf(outfile, "# Generated by %s\n", b->commandline);
-    fclose(outfile);
-  }
+  vol = fabs(orient3dfast(pt[0], pt[1], pt[2], pt[3])) / 6.0;
+  if (!b->weighted) return vol;
+
+  for (i = 0; i < 4; i++) {
+    r = pointradius(pt[i]);
+    if (r <= 0.0) continue;
+    for (j = 0; j < 3; j++) {
+      va[j] = pt[(i + 1) % 4][j] - pt[i][j];
+      vb[j] = pt[(i + 2) % 4][j] - pt[i][j];
+      vc[j] = pt[(i + 3) % 4][j] - pt[i][j];
+    }
+    la = sqrt(dot(va, va));
+    lb = sqrt(dot(vb, vb));
+    lc = sqrt(dot(vc, vc));
+    cross(vb, vc, n);
+    numer = fabs(dot(va, n));
+    denom = la * lb * lc + dot(va, vb) * lc + dot(va, vc) * lb 
+          + dot(vb, vc) * la;
+    omega = 2.0 * atan2(numer, denom);
+    vol -= omega * r * r * r / 3.0;
+  }
+
+  return (vol > 0.0) ? vol : 0.0;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// outsubfaces()    Output subfaces (i.e. boundary faces) to a .face file or //
-//                  a tetgenio structure.                                    //
+// outvoids()    Cluster free tetrahedra into voids, output them to .void    //
+//               and .t2v files or a tetgenio structure.                     //
 //                                                                           //
-// The boundary faces are found in 'subfaces'. For listing triangle vertices //
-// in the same sense for all triangles in the mesh, the direction determined //
-// by right-hand rule is pointer to the inside of the volume.                //
+// A tetrahedron is free if its Voronoi vertex holds a probe sphere of radius//
+// 'b->proberadius' (see tetfreeradius()).  Two free tetrahedra belong to the//
+// same void if the probe sphere can pass through their common face (see     //
+// facefreeradius()).  Voids are the connected components of this graph.     //
+// They are found by a union-find over the faces, which takes nearly linear  //
+// time.  The geometric tests of all tetrahedra are independent, they are    //
+// done in parallel if TetGen is compiled with OpenMP.                       //
+//                                                                           //
+// For each void, its free volume (see tetfreevolume()), its number of tets, //
+// and its percolation flags are reported.  A void touches a side of the     //
+// hull if the probe sphere can leave it through a hull face whose outward   //
+// normal points to this side.  It percolates along an axis if it touches    //
+// both the lower and upper sides of this axis.                              //
+//                                                                           //
+// NOTE: This routine must be called after outelements() (or indexelements())//
+// so all elements have been indexed.                                        //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-void tetgenmesh::outsubfaces(tetgenio* out)
+void tetgenmesh::outvoids(tetgenio* out)
 {
   FILE *outfile = NULL;
-  char facefilename[FILENAMESIZE];
-  int *elist = NULL;
-  int *emlist = NULL;
-  int index = 0, index1 = 0, index2 = 0;
-  triface abuttingtet;
-  face faceloop;
-  point torg, tdest, tapex;
-  int marker = 0;
-  int firstindex, shift;
-  int neigh1 = 0, neigh2 = 0;
-  int facenumber;
-
-  // For -o2 option.
-  triface workface;
-  point *extralist, pp[3] = {0,0,0}; 
-  int highorderindex = 11;
-  int o2index = 0, i;
-
-  int t1ver; // used by fsymself()
+  char voidfilename[FILENAMESIZE];
+  tetrahedron **tetarray;
+  triface tetloop, neightet;
+  point pt[4];
+  REAL *freeradius, *freevolume, *voidvols;
+  REAL vec1[3], vec2[3], n[3], r;
+  unsigned short *faceflags;
+  int *parent, *tet2void, *voidsizes, *voidsides, *voidflags;
+  int firstindex, shift, voidcount, root, nroot, side;
+  long ntets, tindex, nindex;
+  int i, j;
 
   if (out == (tetgenio *) NULL) {
-    strcpy(facefilename, b->outfilename);
-    strcat(facefilename, ".face");
+    strcpy(voidfilename, b->outfilename);
+    strcat(voidfilename, ".void");
   }
 
   if (!b->quiet) {
     if (out == (tetgenio *) NULL) {
-      printf("Writing %s.\n", facefilename);
+      printf("Writing %s.\n", voidfilename);
     } else {
-      printf("Writing faces.\n");
-    }
-  }
-
-  if (out == (tetgenio *) NULL) {
-    outfile = fopen(facefilename, "w");
-    if (outfile == (FILE *) NULL) {
-      printf("File I/O Error:  Cannot create file %s.\n", facefilename);
-      terminatetetgen(this, 3);
-    }
-    // Number of subfaces.
-    fprintf(outfile, "%ld  %d\n", subfaces->items, !b->nobound);
-  } else {
-    // Allocate memory for 'trifacelist'.
-    out->trifacelist = new int[subfaces->items * 3];
-    if (out->trifacelist == (int *) NULL) {
-      terminatetetgen(this, 1);
-    }
-    if (b->order == 2) {
-      out->o2facelist = new int[subfaces->items * 3];
-    }
-    if (!b->nobound) {
-      // Allocate memory for 'trifacemarkerlist'.
-      out->trifacemarkerlist = new int[subfaces->items];
-      if (out->trifacemarkerlist == (int *) NULL) {
-        terminatetetgen(this, 1);
-      }
-    }
-    if (b->neighout > 1) {
-      // '-nn' switch.
-      out->face2tetlist = new int[subfaces->items * 2];
-      if (out->face2tetlist == (int *) NULL) {
-        terminatetetgen(this, 1);
-      }
+      printf("Writing voids.\n");
     }
-    out->numberoftrifaces = subfaces->items;
-    elist = out->trifacelist;
-    emlist = out->trifacemarkerlist;
   }
 
-  // Determine the first index (0 or 1).
+  ntets = tetrahedrons->items - hullsize;
   firstindex = b->zeroindex ? 0 : in->firstnumber;
-  shift = 0; // Default no shiftment.
-  if ((in->firstnumber == 1) && (firstindex == 0)) {
-    shift = 1; // Shift the output indices by 1.
+  shift = firstindex;
+
+  // Map element indices to tetrahedra.
+  tetarray = new tetrahedron*[ntets];
+  tetrahedrons->traversalinit();
+  tetloop.tet = tetrahedrontraverse();
+  while (tetloop.tet != (tetrahedron *) NULL) {
+    tetarray[elemindex(tetloop.tet) - firstindex] = tetloop.tet;
+    tetloop.tet = tetrahedrontraverse();
   }
 
-  subfaces->traversalinit();
-  faceloop.sh = shellfacetraverse(subfaces);
-  facenumber = firstindex; // in->firstnumber;
-  while (faceloop.sh != (shellface *) NULL) {
-    stpivot(faceloop, abuttingtet);
-    // If there is a tetrahedron containing this subface, orient it so
-    //   that the normal of this face points to inside of the volume by
-    //   right-hand rule.
-    if (abuttingtet.tet != NULL) {
-      if (ishulltet(abuttingtet)) {
-        fsymself(abuttingtet);
-      }
-    }
-    if (abuttingtet.tet != NULL) {
-      torg = org(abuttingtet);
-      tdest = dest(abuttingtet);
-      tapex = apex(abuttingtet);
-      if (b->order == 2) { // -o2
-        // Get the three extra vertices on edges.
-        extralist = (point *) (abuttingtet.tet[highorderindex]);
-        workface = abuttingtet;
-        for (i = 0; i < 3; i++) {
-          pp[i] = extralist[ver2edge[workface.ver]];
-          enextself(workface);
+  freeradius = new REAL[ntets];
+  freevolume = new REAL[ntets];
+  // Bits 0-3: the probe passes through face 0-3 to a neighbor. Bits 4-9: the
+  //   probe reaches hull side 0-5 (a tet may reach several of them).
+  faceflags = new unsigned short[ntets];
+
+  // Pass 1: the Voronoi vertices and the free volumes (in parallel).
+#ifdef _OPENMP
+  #pragma omp parallel for private(pt, i)
+#endif
+  for (tindex = 0; tindex < ntets; tindex++) {
+    for (i = 0; i < 4; i++) {
+      pt[i] = (point) tetarray[tindex][4 + i];
+    }
+    freeradius[tindex] = tetfreeradius(pt, NULL);
+    freevolume[tindex] = tetfreevolume(pt);
+  }
+
+  // Pass 2: the passable faces (in parallel).  A face shared by two tets is
+  //   only tested by the tet with the smaller index.
+#ifdef _OPENMP
+  #pragma omp parallel for private(tetloop, neightet, pt, vec1, vec2, n, r, \
+                                   nindex, side, i, j)
+#endif
+  for (tindex = 0; tindex < ntets; tindex++) {
+    faceflags[tindex] = 0;
+    if (freeradius[tindex] < b->proberadius) continue;
+    tetloop.tet = tetarray[tindex];
+    for (tetloop.ver = 0; tetloop.ver < 4; tetloop.ver++) {
+      fsym(tetloop, neightet);
+      if (!ishulltet(neightet)) {
+        nindex = elemindex(neightet.tet) - firstindex;
+        if ((nindex < tindex) || (freeradius[nindex] < b->proberadius)) {
+          continue;
         }
       }
-    } else {
-      // This may happen when only a surface mesh be generated.
-      torg = sorg(faceloop);
-      tdest = sdest(faceloop);
-      tapex = sapex(faceloop);
-      if (b->order == 2) { // -o2
-        // There is no extra node list available.
-        pp[0] = torg;
-        pp[1] = tdest;
-        pp[2] = tapex;
+      pt[0] = org(neightet);
+      pt[1] = dest(neightet);
+      pt[2] = apex(neightet);
+      if (facefreeradius(pt[0], pt[1], pt[2], &r)) {
+        if (r < b->proberadius) continue;
       }
-    }
-    if (!b->nobound) {
-      marker = shellmark(faceloop);
-    }
-    if (b->neighout > 1) {
-      // '-nn' switch. Output adjacent tets indices.
-      neigh1 = -1;
-      neigh2 = -1;
-      stpivot(faceloop, abuttingtet);
-      if (abuttingtet.tet != NULL) {
-        if (!ishulltet(abuttingtet)) {
-          neigh1 = elemindex(abuttingtet.tet);
-        }
-        fsymself(abuttingtet);
-        if (!ishulltet(abuttingtet)) {
-          neigh2 = elemindex(abuttingtet.tet);
+      if (!ishulltet(neightet)) {
+        faceflags[tindex] |= (1 << tetloop.ver);
+      } else {
+        // The outward normal of this hull face.
+        for (j = 0; j < 3; j++) vec1[j] = pt[1][j] - pt[0][j];
+        for (j = 0; j < 3; j++) vec2[j] = pt[2][j] - pt[0][j];
+        cross(vec1, vec2, n);
+        side = 0;
+        for (j = 1; j < 3; j++) {
+          if (fabs(n[j]) > fabs(n[side])) side = j;
         }
+        side = 2 * side + (n[side] > 0.0 ? 1 : 0);
+        faceflags[tindex] |= (1 << (4 + side));
       }
     }
-    if (out == (tetgenio *) NULL) {
-      fprintf(outfile, "%5d   %4d  %4d  %4d", facenumber,
-              pointmark(torg) - shift, pointmark(tdest) - shift,
-              pointmark(tapex) - shift);
-      if (b->order == 2) { // -o2
-        fprintf(outfile, "  %4d  %4d  %4d", pointmark(pp[0]) - shift, 
-                pointmark(pp[1]) - shift, pointmark(pp[2]) - shift);
+  }
+
+  // Pass 3: union-find over the passable faces.
+  parent = new int[ntets];
+  for (tindex = 0; tindex < ntets; tindex++) {
+    parent[tindex] = (int) tindex;
+  }
+  for (tindex = 0; tindex < ntets; tindex++) {
+    if ((faceflags[tindex] & 15) == 0) continue;
+    tetloop.tet = tetarray[tindex];
+    for (tetloop.ver = 0; tetloop.ver < 4; tetloop.ver++) {
+      if (!(faceflags[tindex] & (1 << tetloop.ver))) continue;
+      fsym(tetloop, neightet);
+      nindex = elemindex(neightet.tet) - firstindex;
+      // Find the roots (with path halving).
+      root = (int) tindex;
+      while (parent[root] != root) {
+        parent[root] = parent[parent[root]];
+        root = parent[root];
       }
-      if (!b->nobound) {
-        fprintf(outfile, "    %d", marker);
+      nroot = (int) nindex;
+      while (parent[nroot] != nroot) {
+        parent[nroot] = parent[parent[nroot]];
+        nroot = parent[nroot];
       }
-      if (b->neighout > 1) {
-        fprintf(outfile, "    %5d  %5d", neigh1, neigh2);
+      // Link the larger root to the smaller one.
+      if (root < nroot) {
+        parent[nroot] = root;
+      } else if (nroot < root) {
+        parent[root] = nroot;
       }
-      fprintf(outfile, "\n");
+    }
+  }
+
+  // Number the voids in the order of their first tetrahedra.
+  tet2void = new int[ntets];
+  voidcount = 0;
+  for (tindex = 0; tindex < ntets; tindex++) {
+    if (freeradius[tindex] < b->proberadius) {
+      tet2void[tindex] = -1;
+      continue;
+    }
+    root = (int) tindex;
+    while (parent[root] != root) root = parent[root];
+    if (root == tindex) {
+      tet2void[tindex] = voidcount++;
     } else {
-      // Output three vertices of this face;
-      elist[index++] = pointmark(torg) - shift;
-      elist[index++] = pointmark(tdest) - shift;
-      elist[index++] = pointmark(tapex) - shift;
-      if (b->order == 2) { // -o2
-        out->o2facelist[o2index++] = pointmark(pp[0]) - shift;
-        out->o2facelist[o2index++] = pointmark(pp[1]) - shift;
-        out->o2facelist[o2index++] = pointmark(pp[2]) - shift;
-      }
-      if (!b->nobound) {
-        emlist[index1++] = marker;
-      }
-      if (b->neighout > 1) {
-        out->face2tetlist[index2++] = neigh1;
-        out->face2tetlist[index2++] = neigh2;
+      // The root has a smaller index, it is already numbered.
+      tet2void[tindex] = tet2void[root];
+    }
+  }
+
+  voidvols = new REAL[voidcount];
+  voidsizes = new int[voidcount];
+  voidsides = new int[voidcount];
+  voidflags = new int[voidcount];
+  for (i = 0; i < voidcount; i++) {
+    voidvols[i] = 0.0;
+    voidsizes[i] = 0;
+    voidsides[i] = 0;
+  }
+  for (tindex = 0; tindex < ntets; tindex++) {
+    if (tet2void[tindex] < 0) continue;
+    i = tet2void[tindex];
+    voidvols[i] += freevolume[tindex];
+    voidsizes[i]++;
+    voidsides[i] |= (faceflags[tindex] >> 4);
+  }
+  for (i = 0; i < voidcount; i++) {
+    voidflags[i] = 0;
+    for (j = 0; j < 3; j++) {
+      if ((voidsides[i] & (3 << (2 * j))) == (3 << (2 * j))) {
+        voidflags[i] |= (1 << j);
       }
     }
-    facenumber++;
-    faceloop.sh = shellfacetraverse(subfaces);
   }
 
   if (out == (tetgenio *) NULL) {
+    outfile = fopen(voidfilename, "w");
+    if (outfile == (FILE *) NULL) {
+      printf("File I/O Error:  Cannot create file %s.\n", voidfilename);
+      terminatetetgen(this, 1);
+    }
+    // Number of voids, the probe radius.
+    fprintf(outfile, "%d  %.17g\n", voidcount, b->proberadius);
+    for (i = 0; i < voidcount; i++) {
+      // Void number, free volume, number of tets, percolation flags.
+      fprintf(outfile, "%4d    %.17g  %d  %d\n", i + shift, voidvols[i],
+              voidsizes[i], voidflags[i]);
+    }
     fprintf(outfile, "# Generated by %s\n", b->commandline);
     fclose(outfile);
+
+    strcpy(voidfilename, b->outfilename);
+    strcat(voidfilename, ".t2v");
+    if (!b->quiet) {
+      printf("Writing %s.\n", voidfilename);
+    }
+    outfile = fopen(voidfilename, "w");
+    if (outfile == (FILE *) NULL) {
+      printf("File I/O Error:  Cannot create file %s.\n", voidfilename);
+      terminatetetgen(this, 1);
+    }
+    // Number of tetrahedra, one void index per tetrahedron.
+    fprintf(outfile, "%ld  %d\n", ntets, 1);
+    for (tindex = 0; tindex < ntets; tindex++) {
+      fprintf(outfile, "%4ld    %4d\n", tindex + firstindex, 
+              tet2void[tindex] >= 0 ? tet2void[tindex] + shift : -1);
+    }
+    fprintf(outfile, "# Generated by %s\n", b->commandline);
+    fclose(outfile);
+
+    delete [] tet2void;
+    delete [] voidvols;
+    delete [] voidsizes;
+    delete [] voidflags;
+  } else {
+    for (tindex = 0; tindex < ntets; tindex++) {
+      if (tet2void[tindex] >= 0) tet2void[tindex] += shift;
+    }
+    out->tet2voidlist = tet2void;
+    out->voidvolumelist = voidvols;
+    out->voidsizelist = voidsizes;
+    out->voidflaglist = voidflags;
+    out->numberofvoids = voidcount;
   }
+
+  if (b->verbose) {
+    printf("  Found %d voids for probe radius %g.\n", voidcount,
+           b->proberadius);
+  }
+
+  delete [] voidsides;
+  delete [] parent;
+  delete [] faceflags;
+  delete [] freevolume;
+  delete [] freeradius;
+  delete [] tetarray;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// outedges()    Output all edges to a .edge file or a tetgenio object.      //
+// edgefreeradius()    Return the radius of the largest sphere which passes  //
+//                     between the two endpoints of an edge.                 //
 //                                                                           //
-// Note: This routine must be called after outelements(),  so that the total //
-// number of edges 'meshedges' has been counted.                             //
+// The power plane of the edge [a,b] cuts [a,b] at x.  If x lies inside the  //
+// Voronoi (power) face dual to [a,b], i.e., no vertex in the link of [a,b]  //
+// has a smaller power distance to x than a and b, the edge is the bottle-   //
+// neck of its dual face, and the distance from x to the nearest sphere of a //
+// and b is returned in 'radius'.  Otherwise, the narrowest place of the     //
+// dual face is on its boundary, and FALSE is returned.                      //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-void tetgenmesh::outedges(tetgenio* out)
+bool tetgenmesh::edgefreeradius(triface* checkedge, REAL* radius)
 {
-  FILE *outfile = NULL;
-  char edgefilename[FILENAMESIZE];
-  triface tetloop, worktet, spintet;
-  face checkseg;
-  point torg, tdest;
-  int ishulledge;
-  int firstindex, shift;
-  int edgenumber, marker;
-  int index = 0, index1 = 0, index2 = 0;
+  triface spintet;
+  point pa, pb, pc;
+  REAL x[3], u[3], len, h, pw, wa, wb, wc, d;
   int t1ver;
   int i;
 
-  // For -o2 option.
-  point *extralist, pp = NULL; 
-  int highorderindex = 11;
-  int o2index = 0;
+  pa = org(*checkedge);
+  pb = dest(*checkedge);
+  wa = pointradius(pa);
+  wb = pointradius(pb);
 
-  // For -nn option.
-  int *tet2edgelist = NULL;
-  int tidx;
+  for (i = 0; i < 3; i++) u[i] = pb[i] - pa[i];
+  len = sqrt(dot(u, u));
+  if (len == 0.0) return false;
 
-  if (out == (tetgenio *) NULL) {
-    strcpy(edgefilename, b->outfilename);
-    strcat(edgefilename, ".edge");
-  }
+  // The power plane of a and b is at distance h from a along [a,b].
+  h = (len * len + wa * wa - wb * wb) / (2.0 * len);
+  if ((h <= 0.0) || (h >= len)) return false;
+  for (i = 0; i < 3; i++) x[i] = pa[i] + u[i] * (h / len);
+  pw = h * h - wa * wa;
 
-  if (!b->quiet) {
-    if (out == (tetgenio *) NULL) {
-      printf("Writing %s.\n", edgefilename);
-    } else {
-      printf("Writing edges.\n");
+  // Is x inside the dual face?  Check the vertices in the link of [a,b].
+  spintet = *checkedge;
+  while (1) {
+    pc = apex(spintet);
+    if (pc != dummypoint) {
+      wc = pointradius(pc);
+      d = distance(x, pc);
+      if (d * d - wc * wc < pw) return false;
     }
+    fnextself(spintet);
+    if (spintet.tet == checkedge->tet) break;
   }
 
-  if (meshedges == 0l) {
-    if (nonconvex) {
-      numberedges();  // Count the edges.
-    } else {
-      // Use Euler's characteristic to get the numbe of edges.
-      // It states V - E + F - C = 1, hence E = V + F - C - 1.
-      long tsize = tetrahedrons->items - hullsize;
-      long fsize = (tsize * 4l + hullsize) / 2l;
-      long vsize = points->items - dupverts - unuverts;
-      if (b->weighted) vsize -= nonregularcount;
-      meshedges = vsize + fsize - tsize - 1;
-    }
-  }
-  meshhulledges = 0l; // It will be counted.
+  *radius = h - wa;
+  d = len - h - wb;
+  if (d < *radius) *radius = d;
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// outalphashape()    Output the alpha filtration of the mesh to an .alf file//
+//                    and the pore surfaces to a .psf file (or a tetgenio).  //
+//                                                                           //
+// Every tetrahedron, face, and edge gets a value rho, the radius of the     //
+// largest probe sphere which can reach its dual Voronoi (power) cell.  For  //
+// a tet, it is its free radius (see tetfreeradius()).  For a face (or an    //
+// edge), it is the minimum of the values of the tets (or faces) containing  //
+// it, and of its bottleneck radius if it has one (see facefreeradius() and  //
+// edgefreeradius()).  The values are monotone (a simplex is never larger    //
+// than its cofaces), so they form a filtration:  for a probe radius alpha,  //
+// the simplices with rho < alpha form the (weighted) alpha complex of the   //
+// solid, and the others are in the pore space.  The filtration is computed  //
+// once (in parallel if TetGen is compiled with OpenMP), after that each     //
+// alpha only costs a linear scan and a union-find over the faces.           //
+//                                                                           //
+// For each alpha of the sweep given by -K (or the -u radius), the pores are //
+// the connected components of tets with rho >= alpha glued at faces with    //
+// rho >= alpha (the voids of outvoids()).  The pore-solid interface of a    //
+// pore is the set of faces of its tets whose other side is not in the same  //
+// pore (including hull faces), oriented with outward normals.  It bounds    //
+// the pore, its surface area and the enclosed volume (the volume of its     //
+// tets) are reported.                                                       //
+//                                                                           //
+// The elements are indexed again (in the order of outelements()), since     //
+// outvoronoi() and outpowercells() may have changed their indices.          //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+void tetgenmesh::outalphashape(tetgenio* out)
+{
+  FILE *outfile = NULL;
+  char alffilename[FILENAMESIZE];
+  tetrahedron **tetarray;
+  arraypool *edgelist, *porelist, *poresizes, *trilist;
+  triface tetloop, neightet, spintet, *paryedge;
+  point pt[4];
+  REAL *tetrho, *facerho, *edgerho, *tetvols, *alphas, *parypore;
+  REAL vec1[3], vec2[3], n[3], r, alpha;
+  int *parent, *tet2pore, *triidx, *parytri, *alphaoffsets;
+  int firstindex, shift, alphacount, porecount, firstpore, root, nroot;
+  long ntets, nedges, tindex, nindex, eindex, tricount, k;
+  int t1ver;
+  int i, j;
 
   if (out == (tetgenio *) NULL) {
-    outfile = fopen(edgefilename, "w");
-    if (outfile == (FILE *) NULL) {
-      printf("File I/O Error:  Cannot create file %s.\n", edgefilename);
-      terminatetetgen(this, 1);
-    }
-    // Write the number of edges, boundary markers (0 or 1).
-    fprintf(outfile, "%ld  %d\n", meshedges, !b->nobound);
-  } else {
-    // Allocate memory for 'edgelist'.
-    out->numberofedges = meshedges;
-    out->edgelist = new int[meshedges * 2];
-    if (out->edgelist == (int *) NULL) {
-      printf("Error:  Out of memory.\n");
-      terminatetetgen(this, 1);
-    }
-    if (b->order == 2) { // -o2 switch
-      out->o2edgelist = new int[meshedges];
-    }
-    if (!b->nobound) {
-      out->edgemarkerlist = new int[meshedges];
-    }
-    if (b->neighout > 1) { // '-nn' switch.
-      out->edge2tetlist = new int[meshedges];
-    }
+    strcpy(alffilename, b->outfilename);
+    strcat(alffilename, ".alf");
   }
 
-  if (b->neighout > 1) { // -nn option
-    // Output the tetrahedron-to-edge map.
-	long tsize = tetrahedrons->items - hullsize;
-    tet2edgelist = new int[tsize * 6];
+  if (!b->quiet) {
+    if (out == (tetgenio *) NULL) {
+      printf("Writing %s.\n", alffilename);
+    } else {
+      printf("Writing alpha filtration.\n");
+    }
   }
 
-  // Determine the first index (0 or 1).
+  ntets = tetrahedrons->items - hullsize;
   firstindex = b->zeroindex ? 0 : in->firstnumber;
   shift = 0; // Default no shiftment.
   if ((in->firstnumber == 1) && (firstindex == 0)) {
     shift = 1; // Shift (reduce) the output indices by 1.
   }
 
+  // Index the elements and map the indices to tetrahedra.
+  tetarray = new tetrahedron*[ntets];
+  tindex = 0;
   tetrahedrons->traversalinit();
   tetloop.tet = tetrahedrontraverse();
-  edgenumber = firstindex; // in->firstnumber;
   while (tetloop.tet != (tetrahedron *) NULL) {
-    // Count the number of Voronoi faces. 
-    worktet.tet = tetloop.tet;
+    setelemindex(tetloop.tet, (int) (firstindex + tindex));
+    tetarray[tindex++] = tetloop.tet;
+    tetloop.tet = tetrahedrontraverse();
+  }
+
+  // Collect the edges.  An edge is collected by the tetrahedron with the
+  //   smallest index containing it.
+  edgelist = new arraypool(sizeof(triface), 10);
+  for (tindex = 0; tindex < ntets; tindex++) {
+    tetloop.tet = tetarray[tindex];
     for (i = 0; i < 6; i++) {
-      worktet.ver = edge2ver[i];
-      ishulledge = 0;
-      fnext(worktet, spintet);
+      tetloop.ver = edge2ver[i];
+      fnext(tetloop, spintet);
       do {
         if (!ishulltet(spintet)) {
-          if (elemindex(spintet.tet) < elemindex(worktet.tet)) break;
-        } else {
-          ishulledge = 1;
+          if (elemindex(spintet.tet) < elemindex(tetloop.tet)) break;
         }
         fnextself(spintet);
-      } while (spintet.tet != worktet.tet);
-      if (spintet.tet == worktet.tet) {
-        // Found a new edge.
-        if (ishulledge) meshhulledges++;
-        torg = org(worktet);
-        tdest = dest(worktet);
-        if (b->order == 2) { // -o2
-          // Get the extra vertex on this edge.
-          extralist = (point *) worktet.tet[highorderindex];
-          pp = extralist[ver2edge[worktet.ver]];
-        }
-        if (out == (tetgenio *) NULL) {
-          fprintf(outfile, "%5d   %4d  %4d", edgenumber,
-                  pointmark(torg) - shift, pointmark(tdest) - shift);
-          if (b->order == 2) { // -o2
-            fprintf(outfile, "  %4d", pointmark(pp) - shift);
-          }
-        } else {
-          // Output three vertices of this face;
-          out->edgelist[index++] = pointmark(torg) - shift;
-          out->edgelist[index++] = pointmark(tdest) - shift;
-          if (b->order == 2) { // -o2
-            out->o2edgelist[o2index++] = pointmark(pp) - shift;
-          }
-        }
-        if (!b->nobound) {
-          if (b->plc || b->refine) {
-            // Check if the edge is a segment.
-            tsspivot1(worktet, checkseg);
-            if (checkseg.sh != NULL) {
-              marker = shellmark(checkseg);
-            } else {
-              marker = 0;  // It's not a segment.
-            }
-          } else {
-            // Mark it if it is a hull edge.
-            marker = ishulledge ? 1 : 0;
-          }
-          if (out == (tetgenio *) NULL) {
-            fprintf(outfile, "  %d", marker);
-          } else {
-            out->edgemarkerlist[index1++] = marker;
-          }
-        }
-        if (b->neighout > 1) { // '-nn' switch.
-          if (out == (tetgenio *) NULL) {
-            fprintf(outfile, "  %d", elemindex(tetloop.tet));
-          } else {
-            out->edge2tetlist[index2++] = elemindex(tetloop.tet);
-          }
-		  // Fill the tetrahedron-to-edge map.
-		  spintet = worktet;
-		  while (1) {
-		    if (!ishulltet(spintet)) {
-			  tidx = elemindex(spintet.tet) - firstindex;
-			  tet2edgelist[tidx * 6 + ver2edge[spintet.ver]] = edgenumber;
-			}
-		    fnextself(spintet);
-			if (spintet.tet == worktet.tet) break;
-		  }
+      } while (spintet.tet != tetloop.tet);
+      if (spintet.tet == tetloop.tet) {
+        edgelist->newindex((void **) &paryedge);
+        *paryedge = tetloop;
+      }
+    }
+  }
+  nedges = edgelist->objects;
+
+  tetrho = new REAL[ntets];
+  tetvols = new REAL[ntets];
+  facerho = new REAL[ntets * 4];
+  edgerho = new REAL[nedges];
+
+  // Pass 1: the tetrahedra (in parallel).
+#ifdef _OPENMP
+  #pragma omp parallel for private(pt, i)
+#endif
+  for (tindex = 0; tindex < ntets; tindex++) {
+    for (i = 0; i < 4; i++) {
+      pt[i] = (point) tetarray[tindex][4 + i];
+    }
+    tetrho[tindex] = tetfreeradius(pt, NULL);
+    tetvols[tindex] = fabs(orient3dfast(pt[0], pt[1], pt[2], pt[3])) / 6.0;
+  }
+
+  // Pass 2: the faces (in parallel).  A face shared by two tets is only 
+  //   evaluated by the tet with the smaller index.
+#ifdef _OPENMP
+  #pragma omp parallel for private(tetloop, neightet, r, nindex)
+#endif
+  for (tindex = 0; tindex < ntets; tindex++) {
+    tetloop.tet = tetarray[tindex];
+    for (tetloop.ver = 0; tetloop.ver < 4; tetloop.ver++) {
+      fsym(tetloop, neightet);
+      nindex = -1;
+      if (!ishulltet(neightet)) {
+        nindex = elemindex(neightet.tet) - firstindex;
+        if (nindex < tindex) continue;
+      }
+      facerho[tindex * 4 + tetloop.ver] = tetrho[tindex];
+      if (nindex >= 0) {
+        if (tetrho[nindex] < facerho[tindex * 4 + tetloop.ver]) {
+          facerho[tindex * 4 + tetloop.ver] = tetrho[nindex];
         }
-        if (out == (tetgenio *) NULL) {
-          fprintf(outfile, "\n");
+      }
+      if (facefreeradius(org(neightet), dest(neightet), apex(neightet), &r)) {
+        if (r < facerho[tindex * 4 + tetloop.ver]) {
+          facerho[tindex * 4 + tetloop.ver] = r;
         }
-        edgenumber++;
+      }
+      if (nindex >= 0) {
+        facerho[nindex * 4 + (neightet.ver & 3)] = 
+          facerho[tindex * 4 + tetloop.ver];
       }
     }
-    tetloop.tet = tetrahedrontraverse();
   }
 
-  if (out == (tetgenio *) NULL) {
-    fprintf(outfile, "# Generated by %s\n", b->commandline);
-    fclose(outfile);
+  // Pass 3: the edges (in parallel).  Each face at an edge is visited once
+  //   in the spin, a hull face may be visited from its hull tet.
+#ifdef _OPENMP
+  #pragma omp parallel for private(paryedge, spintet, neightet, r, t1ver)
+#endif
+  for (eindex = 0; eindex < nedges; eindex++) {
+    paryedge = (triface *) fastlookup(edgelist, eindex);
+    edgerho[eindex] = tetrho[elemindex(paryedge->tet) - firstindex];
+    spintet = *paryedge;
+    while (1) {
+      if (ishulltet(spintet)) {
+        fsym(spintet, neightet);
+      } else {
+        neightet = spintet;
+      }
+      if (!ishulltet(neightet)) {
+        r = facerho[(elemindex(neightet.tet) - firstindex) * 4 + 
+                    (neightet.ver & 3)];
+        if (r < edgerho[eindex]) edgerho[eindex] = r;
+      }
+      fnextself(spintet);
+      if (spintet.tet == paryedge->tet) break;
+    }
+    if (edgefreeradius(paryedge, &r)) {
+      if (r < edgerho[eindex]) edgerho[eindex] = r;
+    }
   }
 
-  if (b->neighout > 1) { // -nn option
-    long tsize = tetrahedrons->items - hullsize;
+  // The probe radii of the sweep.
+  if (b->alphasteps > 0) {
+    alphacount = b->alphasteps;
+  } else {
+    alphacount = 1;
+  }
+  alphas = new REAL[alphacount];
+  for (i = 0; i < alphacount; i++) {
+    if (b->alphasteps < 1) {
+      alphas[i] = b->proberadius;
+    } else if (alphacount == 1) {
+      alphas[i] = b->alphamin;
+    } else {
+      alphas[i] = b->alphamin + (b->alphamax - b->alphamin) * (REAL) i 
+                / (REAL) (alphacount - 1);
+    }
+  }
 
-    if (b->facesout) { // -f option
-      // Build the face-to-edge map (use the tet-to-edge map).
-	  long fsize = (tsize * 4l + hullsize) / 2l;
-	  int *face2edgelist = new int[fsize * 3];
+  // Extract the pores and their surfaces for each alpha.
+  parent = new int[ntets];
+  tet2pore = new int[ntets];
+  alphaoffsets = new int[alphacount + 1];
+  porelist = new arraypool(2 * sizeof(REAL), 10); // Area, volume.
+  poresizes = new arraypool(sizeof(int), 10);     // Number of triangles.
+  trilist = new arraypool(3 * sizeof(int), 12);
 
-	  tetrahedrons->traversalinit();
-      tetloop.tet = tetrahedrontraverse();
-      int facenumber = 0; // firstindex; // in->firstnumber;
-	  while (tetloop.tet != (tetrahedron *) NULL) {
-	    for (tetloop.ver = 0; tetloop.ver < 4; tetloop.ver++) {
-		  fsym(tetloop, spintet);
-		  if (ishulltet(spintet) || 
-              (elemindex(tetloop.tet) < elemindex(spintet.tet))) {
-            // The three edges of this face are ordered such that the
-			//    first edge is opposite to the first vertex of this face
-			//    that appears in the .face file, and so on.
-			tidx = elemindex(tetloop.tet) - firstindex; 
-			worktet = tetloop;
-            for (i = 0; i < 3; i++) {
-			  enextself(worktet); // The edge opposite to vertex i.
-			  int eidx = tet2edgelist[tidx * 6 + ver2edge[worktet.ver]];
-			  face2edgelist[facenumber * 3 + i] = eidx;
-			}
-		    facenumber++;
-		  }
-		}
-	    tetloop.tet = tetrahedrontraverse();
-	  }
+  for (j = 0; j < alphacount; j++) {
+    alpha = alphas[j];
+    alphaoffsets[j] = (int) porelist->objects;
 
-	  // Output the face-to-edge map.
-	  if (out == (tetgenio *) NULL) {
-	    strcpy(edgefilename, b->outfilename);
-        strcat(edgefilename, ".f2e");
+    // Union-find over the open faces.
+    for (tindex = 0; tindex < ntets; tindex++) {
+      parent[tindex] = (int) tindex;
+    }
+    for (tindex = 0; tindex < ntets; tindex++) {
+      if (tetrho[tindex] < alpha) continue;
+      tetloop.tet = tetarray[tindex];
+      for (tetloop.ver = 0; tetloop.ver < 4; tetloop.ver++) {
+        if (facerho[tindex * 4 + tetloop.ver] < alpha) continue;
+        fsym(tetloop, neightet);
+        if (ishulltet(neightet)) continue;
+        nindex = elemindex(neightet.tet) - firstindex;
+        if (nindex < tindex) continue;
+        // Find the roots (with path halving).
+        root = (int) tindex;
+        while (parent[root] != root) {
+          parent[root] = parent[parent[root]];
+          root = parent[root];
+        }
+        nroot = (int) nindex;
+        while (parent[nroot] != nroot) {
+          parent[nroot] = parent[parent[nroot]];
+          nroot = parent[nroot];
+        }
+        // Link the larger root to the smaller one.
+        if (root < nroot) {
+          parent[nroot] = root;
+        } else if (nroot < root) {
+          parent[root] = nroot;
+        }
+      }
+    }
+
+    // Number the pores in the order of their first tetrahedra.
+    porecount = 0;
+    for (tindex = 0; tindex < ntets; tindex++) {
+      if (tetrho[tindex] < alpha) {
+        tet2pore[tindex] = -1;
+        continue;
       }
-	  if (!b->quiet) {
-        if (out == (tetgenio *) NULL) {
-          printf("Writing %s.\n", edgefilename);
-        } else {
-          printf("Writing face-to-edge map.\n");
+      root = (int) tindex;
+      while (parent[root] != root) root = parent[root];
+      if (root == tindex) {
+        tet2pore[tindex] = porecount++;
+      } else {
+        tet2pore[tindex] = tet2pore[root];
+      }
+    }
+
+    // Count the interface triangles of each pore, sum up areas and volumes.
+    firstpore = (int) porelist->objects;
+    for (i = 0; i < porecount; i++) {
+      porelist->newindex((void **) &parypore);
+      parypore[0] = parypore[1] = 0.0;
+      poresizes->newindex((void **) &parytri);
+      *parytri = 0;
+    }
+    for (tindex = 0; tindex < ntets; tindex++) {
+      if (tet2pore[tindex] < 0) continue;
+      parypore = (REAL *) fastlookup(porelist, firstpore + tet2pore[tindex]);
+      parytri = (int *) fastlookup(poresizes, firstpore + tet2pore[tindex]);
+      parypore[1] += tetvols[tindex];
+      tetloop.tet = tetarray[tindex];
+      for (tetloop.ver = 0; tetloop.ver < 4; tetloop.ver++) {
+        fsym(tetloop, neightet);
+        if (!ishulltet(neightet)) {
+          nindex = elemindex(neightet.tet) - firstindex;
+          if (tet2pore[nindex] == tet2pore[tindex]) continue;
+        }
+        pt[0] = org(tetloop);
+        pt[1] = dest(tetloop);
+        pt[2] = apex(tetloop);
+        for (i = 0; i < 3; i++) vec1[i] = pt[1][i] - pt[0][i];
+        for (i = 0; i < 3; i++) vec2[i] = pt[2][i] - pt[0][i];
+        cross(vec1, vec2, n);
+        parypore[0] += 0.5 * sqrt(dot(n, n));
+        (*parytri)++;
+      }
+    }
+
+    // Place the triangles grouped by pores (a counting sort).
+    triidx = new int[porecount + 1];
+    triidx[0] = 0;
+    for (i = 0; i < porecount; i++) {
+      triidx[i + 1] = triidx[i] + 
+        * (int *) fastlookup(poresizes, firstpore + i);
+    }
+    tricount = trilist->objects;
+    for (k = 0; k < triidx[porecount]; k++) {
+      trilist->newindex((void **) &parytri);
+    }
+    for (tindex = 0; tindex < ntets; tindex++) {
+      if (tet2pore[tindex] < 0) continue;
+      tetloop.tet = tetarray[tindex];
+      for (tetloop.ver = 0; tetloop.ver < 4; tetloop.ver++) {
+        fsym(tetloop, neightet);
+        if (!ishulltet(neightet)) {
+          nindex = elemindex(neightet.tet) - firstindex;
+          if (tet2pore[nindex] == tet2pore[tindex]) continue;
         }
+        // The face [org, dest, apex] has its normal pointing into the tet,
+        //   reverse it to point out of the pore.
+        parytri = (int *) fastlookup(trilist, 
+                                     tricount + triidx[tet2pore[tindex]]);
+        triidx[tet2pore[tindex]]++;
+        parytri[0] = pointmark(dest(tetloop)) - shift;
+        parytri[1] = pointmark(org(tetloop)) - shift;
+        parytri[2] = pointmark(apex(tetloop)) - shift;
       }
-	  if (out == (tetgenio *) NULL) {
-	    outfile = fopen(edgefilename, "w");
-	    for (tidx = 0; tidx < fsize; tidx++) { // Re-use `tidx'
-	      i = tidx * 3;
-		  fprintf(outfile, "%4d  %d %d %d\n", tidx + in->firstnumber,
-		          face2edgelist[i], face2edgelist[i+1], face2edgelist[i+2]);
-	    }
-	    fclose(outfile);
-	    delete [] face2edgelist;
-	  } else {
-	    // Simply copy the address of the list to the output.
-	    out->face2edgelist = face2edgelist;
+    }
+    delete [] triidx;
+
+    if (b->verbose) {
+      printf("  Found %d pores for probe radius %g.\n", porecount, alpha);
+    }
+  }
+  alphaoffsets[alphacount] = (int) porelist->objects;
+
+  if (out == (tetgenio *) NULL) {
+    outfile = fopen(alffilename, "w");
+    if (outfile == (FILE *) NULL) {
+      printf("File I/O Error:  Cannot create file %s.\n", alffilename);
+      terminatetetgen(this, 1);
+    }
+    // Number of tetrahedra, number of edges.
+    fprintf(outfile, "%ld  %ld\n", ntets, nedges);
+    for (tindex = 0; tindex < ntets; tindex++) {
+      // Tet number, value of the tet, values of its four faces.
+      fprintf(outfile, "%4ld    %.17g  %.17g  %.17g  %.17g  %.17g\n", 
+              tindex + firstindex, tetrho[tindex], facerho[tindex * 4],
+              facerho[tindex * 4 + 1], facerho[tindex * 4 + 2], 
+              facerho[tindex * 4 + 3]);
+    }
+    for (eindex = 0; eindex < nedges; eindex++) {
+      // Edge number, two endpoints, value of the edge.
+      paryedge = (triface *) fastlookup(edgelist, eindex);
+      fprintf(outfile, "%4ld    %4d  %4d  %.17g\n", eindex + firstindex,
+              pointmark(org(*paryedge)) - shift, 
+              pointmark(dest(*paryedge)) - shift, edgerho[eindex]);
+    }
+    fprintf(outfile, "# Generated by %s\n", b->commandline);
+    fclose(outfile);
+
+    strcpy(alffilename, b->outfilename);
+    strcat(alffilename, ".psf");
+    if (!b->quiet) {
+      printf("Writing %s.\n", alffilename);
+    }
+    outfile = fopen(alffilename, "w");
+    if (outfile == (FILE *) NULL) {
+      printf("File I/O Error:  Cannot create file %s.\n", alffilename);
+      terminatetetgen(this, 1);
+    }
+    // Number of probe radii.
+    fprintf(outfile, "%d\n", alphacount);
+    tricount = 0;
+    for (j = 0; j < alphacount; j++) {
+      // Probe radius, number of pores, number of interface triangles.
+      k = 0;
+      for (i = alphaoffsets[j]; i < alphaoffsets[j + 1]; i++) {
+        k += * (int *) fastlookup(poresizes, i);
+      }
+      fprintf(outfile, "%.17g  %d  %ld\n", alphas[j], 
+              alphaoffsets[j + 1] - alphaoffsets[j], k);
+      for (i = alphaoffsets[j]; i < alphaoffsets[j + 1]; i++) {
+        // Pore number, surface area, enclosed volume, number of triangles.
+        parypore = (REAL *) fastlookup(porelist, i);
+        fprintf(outfile, "%4d    %.17g  %.17g  %d\n", 
+                i - alphaoffsets[j] + firstindex, parypore[0], parypore[1],
+                * (int *) fastlookup(poresizes, i));
+      }
+      for (i = alphaoffsets[j]; i < alphaoffsets[j + 1]; i++) {
+        for (k = 0; k < * (int *) fastlookup(poresizes, i); k++) {
+          // Triangle number, three vertices, pore number.
+          parytri = (int *) fastlookup(trilist, tricount);
+          fprintf(outfile, "%4ld    %4d  %4d  %4d    %4d\n", tricount + 
+                  firstindex, parytri[0], parytri[1], parytri[2],
+                  i - alphaoffsets[j] + firstindex);
+          tricount++;
+        }
+      }
+    }
+    fprintf(outfile, "# Generated by %s\n", b->commandline);
+    fclose(outfile);
+
+    delete [] facerho;
+    delete [] tetrho;
+    delete [] edgerho;
+    delete [] alphas;
+    delete [] alphaoffsets;
+  } else {
+    out->alphatetlist = tetrho;
+    out->alphafacelist = facerho;
+    out->alphaedgevaluelist = edgerho;
+    out->alphaedgelist = new int[nedges * 2];
+    for (eindex = 0; eindex < nedges; eindex++) {
+      paryedge = (triface *) fastlookup(edgelist, eindex);
+      out->alphaedgelist[eindex * 2] = pointmark(org(*paryedge)) - shift;
+      out->alphaedgelist[eindex * 2 + 1] = pointmark(dest(*paryedge)) - shift;
+    }
+    out->numberofalphaedges = (int) nedges;
+
+    out->alphalist = alphas;
+    out->numberofalphas = alphacount;
+    out->poreoffsetlist = alphaoffsets;
+    out->numberofpores = (int) porelist->objects;
+    out->porearealist = new REAL[out->numberofpores];
+    out->porevolumelist = new REAL[out->numberofpores];
+    out->poretrioffsetlist = new int[out->numberofpores + 1];
+    out->poretrioffsetlist[0] = 0;
+    for (i = 0; i < out->numberofpores; i++) {
+      parypore = (REAL *) fastlookup(porelist, i);
+      out->porearealist[i] = parypore[0];
+      out->porevolumelist[i] = parypore[1];
+      out->poretrioffsetlist[i + 1] = out->poretrioffsetlist[i] + 
+        * (int *) fastlookup(poresizes, i);
+    }
+    out->numberofporetriangles = (int) trilist->objects;
+    out->poretrianglelist = new int[trilist->objects * 3];
+    for (k = 0; k < trilist->objects; k++) {
+      parytri = (int *) fastlookup(trilist, k);
+      for (i = 0; i < 3; i++) {
+        out->poretrianglelist[k * 3 + i] = parytri[i];
+      }
+    }
+  }
+
+  delete trilist;
+  delete poresizes;
+  delete porelist;
+  delete edgelist;
+  delete [] tet2pore;
+  delete [] parent;
+  delete [] tetvols;
+  delete [] tetarray;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// powercell()    Compute the power cell of a vertex.                        //
+//                                                                           //
+// The power cell of a vertex p is dual to its star in the regular (weighted //
+// Delaunay) triangulation.  It has a face for each mesh edge [p,q], which   //
+// is the polygon of the orthocenters of the tetrahedra around [p,q].  This  //
+// face lies in the power plane of p and q, its distance to p (along [p,q])  //
+// is h = (|pq|^2 + w_p - w_q) / (2 |pq|), where w_p = P^2 is the weight of  //
+// p (see orthosphere()).  The cell volume is the sum of the (signed) cones  //
+// of its faces with apex p, i.e., sum area(f) * h(f) / 3.  Without -w, all  //
+// weights are zero and the power cell is the Voronoi cell.                  //
+//                                                                           //
+// 'orthocent' holds the orthocenters of all tetrahedra, indexed by their    //
+// element indices.  'tetlist' returns the tetrahedra (including hull tets)  //
+// sharing p.  'edgelist' returns the edges [p,q] (as trifaces whose origin  //
+// is p) of the cell faces.  The number of faces is returned.  If 'areas' is //
+// not NULL, the face areas (-1 for an unbounded face) are returned in it,   //
+// and the cell volume (-1 if it is unbounded) in 'volume'.                  //
+//                                                                           //
+// It only reads the mesh, so it can be called in parallel for different     //
+// vertices.                                                                 //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+int tetgenmesh::powercell(point pt, REAL* orthocent, arraypool* tetlist,
+                          arraypool* edgelist, REAL* areas, REAL* volume)
+{
+  triface neightet, spintet, *paryedge;
+  tetrahedron *tptr, **parytet;
+  point neipt;
+  REAL u[3], v1[3], v2[3], n[3], *c0, *c1, *c2;
+  REAL len, h, s, wp, wq;
+  bool bounded, faceflag;
+  long i, k;
+  int t1ver;
+  int j;
+
+  tetlist->restart();
+  edgelist->restart();
+
+  // Collect the tetrahedra sharing 'pt'.  Cross the three faces of each tet
+  //   which contain 'pt', i.e., skip the face opposite to it.
+  decode(point2tet(pt), neightet);
+  tetlist->newindex((void **) &parytet);
+  *parytet = neightet.tet;
+  for (i = 0; i < tetlist->objects; i++) {
+    tptr = * (tetrahedron **) fastlookup(tetlist, i);
+    for (j = 0; j < 4; j++) {
+      if ((point) tptr[4 + j] == pt) continue;
+      decode(tptr[j], neightet);
+      for (k = 0; k < tetlist->objects; k++) {
+        if (* (tetrahedron **) fastlookup(tetlist, k) == neightet.tet) break;
       }
-    } // if (b->facesout)
+      if (k == tetlist->objects) {
+        tetlist->newindex((void **) &parytet);
+        *parytet = neightet.tet;
+      }
+    }
+  }
 
-    // Output the tetrahedron-to-edge map.
-	if (out == (tetgenio *) NULL) {
-	  strcpy(edgefilename, b->outfilename);
-      strcat(edgefilename, ".t2e");
+  // Collect the edges [pt, q].  The cell is unbounded if 'pt' is a vertex
+  //   of a hull tet (it is on the convex hull).
+  bounded = true;
+  for (i = 0; i < tetlist->objects; i++) {
+    neightet.tet = * (tetrahedron **) fastlookup(tetlist, i);
+    for (j = 0; j < 4; j++) {
+      neipt = (point) neightet.tet[4 + j];
+      if (neipt == pt) continue;
+      if (neipt == dummypoint) {
+        bounded = false;
+        continue;
+      }
+      for (k = 0; k < edgelist->objects; k++) {
+        paryedge = (triface *) fastlookup(edgelist, k);
+        if (dest(*paryedge) == neipt) break;
+      }
+      if (k == edgelist->objects) {
+        for (neightet.ver = 0; neightet.ver < 12; neightet.ver++) {
+          if ((org(neightet) == pt) && (dest(neightet) == neipt)) break;
+        }
+        edgelist->newindex((void **) &paryedge);
+        *paryedge = neightet;
+      }
     }
-	if (!b->quiet) {
-      if (out == (tetgenio *) NULL) {
-        printf("Writing %s.\n", edgefilename);
+  }
+
+  if (areas == NULL) {
+    return (int) edgelist->objects;
+  }
+
+  wp = b->weighted ? (dot(pt, pt) - pt[3]) : 0.0;
+  *volume = 0.0;
+
+  for (i = 0; i < edgelist->objects; i++) {
+    paryedge = (triface *) fastlookup(edgelist, i);
+    neipt = dest(*paryedge);
+    for (j = 0; j < 3; j++) u[j] = neipt[j] - pt[j];
+    len = sqrt(dot(u, u));
+    for (j = 0; j < 3; j++) u[j] /= len;
+    // Spin around [pt, q], sum up the (doubled) signed area of the polygon
+    //   of orthocenters, projected on the direction of [pt, q].
+    faceflag = true;
+    s = 0.0;
+    c0 = c1 = NULL;
+    spintet = *paryedge;
+    while (1) {
+      if (ishulltet(spintet)) {
+        faceflag = false; // An unbounded face.
+        break;
+      }
+      c2 = &(orthocent[3 * elemindex(spintet.tet)]);
+      if (c0 == NULL) {
+        c0 = c2;
       } else {
-        printf("Writing tetrahedron-to-edge map.\n");
+        if (c1 != NULL) {
+          for (j = 0; j < 3; j++) {
+            v1[j] = c1[j] - c0[j];
+            v2[j] = c2[j] - c0[j];
+          }
+          cross(v1, v2, n);
+          s += dot(n, u);
+        }
+        c1 = c2;
       }
+      fnextself(spintet);
+      if (spintet.tet == paryedge->tet) break;
     }
-	if (out == (tetgenio *) NULL) {
-	  outfile = fopen(edgefilename, "w");
-	  for (tidx = 0; tidx < tsize; tidx++) {
-	    i = tidx * 6;
-		fprintf(outfile, "%4d  %d %d %d %d %d %d\n", tidx + in->firstnumber,
-		        tet2edgelist[i], tet2edgelist[i+1], tet2edgelist[i+2],  
-				tet2edgelist[i+3], tet2edgelist[i+4], tet2edgelist[i+5]);
-	  }
-	  fclose(outfile);
-	  delete [] tet2edgelist;
-	} else {
-	  // Simply copy the address of the list to the output.
-	  out->tet2edgelist = tet2edgelist;
+    if (!faceflag) {
+      areas[i] = -1.0;
+      bounded = false;
+      continue;
     }
+    areas[i] = 0.5 * fabs(s);
+    wq = b->weighted ? (dot(neipt, neipt) - neipt[3]) : 0.0;
+    h = (len * len + wp - wq) / (2.0 * len);
+    *volume += areas[i] * h / 3.0;
   }
+
+  if (!bounded) {
+    *volume = -1.0;
+  }
+
+  return (int) edgelist->objects;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// outsubsegments()    Output segments to a .edge file or a structure.       //
+// outpowercells()    Output the power diagram to a binary .pcell file or a  //
+//                    tetgenio structure.                                    //
+//                                                                           //
+// For each point, the volume of its power cell, its neighbors (the points   //
+// sharing a cell face), and the areas of these faces are computed from its  //
+// vertex star (see powercell()).  Without -w, this is the Voronoi diagram.  //
+// Unlike outvoronoi(), no Voronoi vertices, edges, or faces are listed.     //
+//                                                                           //
+// The cells are computed in two passes, the first one counts the faces of   //
+// each cell, the second one fills the CSR arrays.  Both are done in para-   //
+// llel if TetGen is compiled with OpenMP.                                   //
+//                                                                           //
+// NOTE: This routine is only used when the input is only a set of point.    //
+// It re-indexes the elements (like outvoronoi()).                           //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-void tetgenmesh::outsubsegments(tetgenio* out)
+void tetgenmesh::outpowercells(tetgenio* out)
 {
-  FILE *outfile = NULL;
-  char edgefilename[FILENAMESIZE];
-  int *elist = NULL;
-  int index, i;
-  face edgeloop;
-  point torg, tdest;
+  tetgenio pcellout;
+  arraypool *tetlist, *edgelist;
+  tetrahedron **tetarray;
+  triface tetloop, *paryedge;
+  point *ptarray, pt[4], ploop;
+  REAL *orthocent, *vollist, *arealist;
+  int *offsets, *neighbors;
   int firstindex, shift;
-  int marker;
-  int edgenumber;
-
-  // For -o2 option.
-  triface workface, spintet;
-  point *extralist, pp = NULL; 
-  int highorderindex = 11;
-  int o2index = 0;
-
-  // For -nn option.
-  int neigh = -1;
-  int index2 = 0;
+  long ntets, npts, tindex, pindex, i;
+  int j;
 
-  int t1ver; // used by fsymself()
+  if (!b->quiet) {
+    printf("Writing power cells.\n");
+  }
 
   if (out == (tetgenio *) NULL) {
-    strcpy(edgefilename, b->outfilename);
-    strcat(edgefilename, ".edge");
+    // Write a binary .pcell file.
+    out = &pcellout;
   }
 
-  if (!b->quiet) {
-    if (out == (tetgenio *) NULL) {
-      printf("Writing %s.\n", edgefilename);
-    } else {
-      printf("Writing edges.\n");
-    }
+  firstindex = b->zeroindex ? 0 : in->firstnumber;
+  shift = 0; // Default no shift.
+  if ((in->firstnumber == 1) && (firstindex == 0)) {
+    shift = 1; // Shift the output indices by 1.
   }
 
-  if (out == (tetgenio *) NULL) {
-    outfile = fopen(edgefilename, "w");
-    if (outfile == (FILE *) NULL) {
-      printf("File I/O Error:  Cannot create file %s.\n", edgefilename);
-      terminatetetgen(this, 3);
-    }
-    // Number of subsegments.
-    fprintf(outfile, "%ld  1\n", subsegs->items);
-  } else {
-    // Allocate memory for 'edgelist'.
-    out->edgelist = new int[subsegs->items * (b->order == 1 ? 2 : 3)];
-    if (out->edgelist == (int *) NULL) {
-      terminatetetgen(this, 1);
+  // Index the tetrahedra (from 0), and let each vertex point to a tet.
+  ntets = tetrahedrons->items - hullsize;
+  tetarray = new tetrahedron*[ntets];
+  tetrahedrons->traversalinit();
+  tetloop.tet = tetrahedrontraverse();
+  tindex = 0;
+  while (tetloop.tet != (tetrahedron *) NULL) {
+    for (j = 0; j < 4; j++) {
+      setpoint2tet((point) tetloop.tet[4 + j], encode(tetloop));
     }
-    if (b->order == 2) {
-      out->o2edgelist = new int[subsegs->items];
+    setelemindex(tetloop.tet, tindex);
+    tetarray[tindex++] = tetloop.tet;
+    tetloop.tet = tetrahedrontraverse();
+  }
+
+  // The orthocenters (circumcenters) of all tetrahedra (in parallel).
+  orthocent = new REAL[ntets * 3];
+#ifdef _OPENMP
+  #pragma omp parallel for private(pt, j)
+#endif
+  for (tindex = 0; tindex < ntets; tindex++) {
+    for (j = 0; j < 4; j++) {
+      pt[j] = (point) tetarray[tindex][4 + j];
     }
-    out->edgemarkerlist = new int[subsegs->items];
-    if (out->edgemarkerlist == (int *) NULL) {
-      terminatetetgen(this, 1);
+    if (b->weighted) {
+      if (orthosphere(pt[0], pt[1], pt[2], pt[3], pt[0][3], pt[1][3],
+                      pt[2][3], pt[3][3], &(orthocent[tindex * 3]), NULL)) {
+        continue;
+      }
+    } else {
+      if (circumsphere(pt[0], pt[1], pt[2], pt[3], &(orthocent[tindex * 3]),
+                       NULL)) {
+        continue;
+      }
     }
-    if (b->neighout > 1) {
-      out->edge2tetlist = new int[subsegs->items];
+    // A degenerate (flat) tetrahedron. Use its barycenter.
+    for (j = 0; j < 3; j++) {
+      orthocent[tindex * 3 + j] = 0.25 * (pt[0][j] + pt[1][j] + pt[2][j]
+                                          + pt[3][j]);
     }
-    out->numberofedges = subsegs->items;
-    elist = out->edgelist;
+  }
+
+  // The cells are listed in the order of the output points.
+  npts = points->items;
+  ptarray = new point[npts];
+  points->traversalinit();
+  ploop = pointtraverse();
+  pindex = 0;
+  while (ploop != (point) NULL) {
+    ptarray[pindex++] = ploop;
+    ploop = pointtraverse();
+  }
+
+  // Pass 1: count the faces of each cell (in parallel).
+  offsets = new int[npts + 1];
+#ifdef _OPENMP
+  #pragma omp parallel private(tetlist, edgelist)
+#endif
+  {
+    tetlist = new arraypool(sizeof(tetrahedron *), 8);
+    edgelist = new arraypool(sizeof(triface), 8);
+#ifdef _OPENMP
+    #pragma omp for
+#endif
+    for (pindex = 0; pindex < npts; pindex++) {
+      if ((pointtype(ptarray[pindex]) == UNUSEDVERTEX) ||
+          (pointtype(ptarray[pindex]) == DUPLICATEDVERTEX) ||
+          (pointtype(ptarray[pindex]) == NREGULARVERTEX)) {
+        offsets[pindex + 1] = 0; // An empty cell.
+      } else {
+        offsets[pindex + 1] = powercell(ptarray[pindex], orthocent, tetlist,
+                                        edgelist, NULL, NULL);
+      }
+    }
+    delete tetlist;
+    delete edgelist;
+  }
+  offsets[0] = 0;
+  for (pindex = 0; pindex < npts; pindex++) {
+    offsets[pindex + 1] += offsets[pindex];
+  }
+
+  // Pass 2: the volumes, neighbors, and face areas (in parallel).
+  vollist = new REAL[npts];
+  neighbors = new int[offsets[npts] > 0 ? offsets[npts] : 1];
+  arealist = new REAL[offsets[npts] > 0 ? offsets[npts] : 1];
+#ifdef _OPENMP
+  #pragma omp parallel private(tetlist, edgelist, paryedge, i)
+#endif
+  {
+    tetlist = new arraypool(sizeof(tetrahedron *), 8);
+    edgelist = new arraypool(sizeof(triface), 8);
+#ifdef _OPENMP
+    #pragma omp for
+#endif
+    for (pindex = 0; pindex < npts; pindex++) {
+      vollist[pindex] = 0.0;
+      if (offsets[pindex + 1] == offsets[pindex]) continue;
+      powercell(ptarray[pindex], orthocent, tetlist, edgelist,
+                &(arealist[offsets[pindex]]), &(vollist[pindex]));
+      for (i = 0; i < edgelist->objects; i++) {
+        paryedge = (triface *) fastlookup(edgelist, i);
+        neighbors[offsets[pindex] + i] = pointmark(dest(*paryedge)) - shift;
+      }
+    }
+    delete tetlist;
+    delete edgelist;
+  }
+
+  out->pcellvolumelist = vollist;
+  out->pcelloffsetlist = offsets;
+  out->pcellneighborlist = neighbors;
+  out->pcellarealist = arealist;
+  out->numberofpcells = (int) npts;
+
+  if (out == &pcellout) {
+    out->firstnumber = firstindex;
+    out->save_powercells_binary(b->outfilename);
+  }
+
+  delete [] ptarray;
+  delete [] orthocent;
+  delete [] tetarray;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// outsmesh()    Write surface mesh to a .smesh file, which can be read and  //
+//               tetrahedralized by TetGen.                                  //
+//                                                                           //
+// You can specify a filename (without suffix) in 'smfilename'. If you don't //
+// supply a filename (let smfilename be NULL), the default name stored in    //
+// 'tetgenbehavior' will be used.                                            //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+void tetgenmesh::outsmesh(char* smfilename)
+{
+  FILE *outfile;
+  char nodfilename[FILENAMESIZE];
+  char smefilename[FILENAMESIZE];
+  face faceloop;
+  point p1, p2, p3;
+  int firstindex, shift;
+  int bmark;
+  int marker;
+  int i;
+
+  if (smfilename != (char *) NULL && smfilename[0] != '\0') {
+    strcpy(smefilename, smfilename);
+  } else if (b->outfilename[0] != '\0') {
+    strcpy(smefilename, b->outfilename);
+  } else {
+    strcpy(smefilename, "unnamed");
+  }
+  strcpy(nodfilename, smefilename);
+  strcat(smefilename, ".smesh");
+  strcat(nodfilename, ".node");
+
+  if (!b->quiet) {
+    printf("Writing %s.\n", smefilename);
+  }
+  outfile = fopen(smefilename, "w");
+  if (outfile == (FILE *) NULL) {
+    printf("File I/O Error:  Cannot create file %s.\n", smefilename);
+    return;
   }
 
   // Determine the first index (0 or 1).
@@ -30188,1021 +33297,970 @@ void tetgenmesh::outsubsegments(tetgenio* out)
   if ((in->firstnumber == 1) && (firstindex == 0)) {
     shift = 1; // Shift the output indices by 1.
   }
-  index = 0;
-  i = 0;
 
-  subsegs->traversalinit();
-  edgeloop.sh = shellfacetraverse(subsegs);
-  edgenumber = firstindex; // in->firstnumber;
-  while (edgeloop.sh != (shellface *) NULL) {
-    torg = sorg(edgeloop);
-    tdest = sdest(edgeloop);
-    if ((b->order == 2) || (b->neighout > 1)) {
-      sstpivot1(edgeloop, workface);
-      if (workface.tet != NULL) {
-        // We must find a non-hull tet.
-        if (ishulltet(workface)) {
-          spintet = workface;
-          while (1) {
-            fnextself(spintet);
-            if (!ishulltet(spintet)) break;
-            if (spintet.tet == workface.tet) break;
-          }
-          workface = spintet;
-        }
-      }
-    }
-    if (b->order == 2) { // -o2
-      // Get the extra vertex on this edge.
-      if (workface.tet != NULL) {
-        extralist = (point *) workface.tet[highorderindex];
-        pp = extralist[ver2edge[workface.ver]];
-      } else {
-        pp = torg; // There is no extra node available.
-      }
-    }
-    if (b->neighout > 1) { // -nn
-      if (workface.tet != NULL) {
-        neigh = elemindex(workface.tet);
-      } else {
-        neigh = -1;
-      }
-    }
-    marker = shellmark(edgeloop);
-    if (marker == 0) {
-      marker = 1; // Default marker of a boundary edge is 1. 
-    }
-    if (out == (tetgenio *) NULL) {
-      fprintf(outfile, "%5d   %4d  %4d", edgenumber,
-              pointmark(torg) - shift, pointmark(tdest) - shift);
-      if (b->order == 2) { // -o2
-        fprintf(outfile, "  %4d", pointmark(pp) - shift);
-      }
-      fprintf(outfile, "  %d", marker);
-      if (b->neighout > 1) { // -nn
-        fprintf(outfile, "  %4d", neigh);
-      }
-      fprintf(outfile, "\n");
-    } else {
-      // Output three vertices of this face;
-      elist[index++] = pointmark(torg) - shift;
-      elist[index++] = pointmark(tdest) - shift;
-      if (b->order == 2) { // -o2
-        out->o2edgelist[o2index++] = pointmark(pp) - shift;
-      }
-      out->edgemarkerlist[i++] = marker;
-      if (b->neighout > 1) { // -nn
-        out->edge2tetlist[index2++] = neigh;
-      }
+  fprintf(outfile, "# %s.  TetGen's input file.\n", smefilename);
+  fprintf(outfile, "\n# part 1: node list.\n");
+  fprintf(outfile, "0  3  0  0  # nodes are found in %s.\n", nodfilename);
+
+  marker = 0; // avoid compile warning.
+  bmark = !b->nobound && (in->facetmarkerlist || in->trifacemarkerlist);  
+
+  fprintf(outfile, "\n# part 2: facet list.\n");
+  // Number of facets, boundary marker.
+  fprintf(outfile, "%ld  %d\n", subfaces->items, bmark);
+  
+  subfaces->traversalinit();
+  faceloop.sh = shellfacetraverse(subfaces);
+  while (faceloop.sh != (shellface *) NULL) {
+    p1 = sorg(faceloop);
+    p2 = sdest(faceloop);
+    p3 = sapex(faceloop);
+    if (bmark) {
+      marker = shellmark(faceloop);
     }
-    edgenumber++;
-    edgeloop.sh = shellfacetraverse(subsegs);
+    fprintf(outfile, "3    %4d  %4d  %4d", pointmark(p1) - shift,
+            pointmark(p2) - shift, pointmark(p3) - shift);
+    if (bmark) {
+      fprintf(outfile, "    %d", marker);
+    }
+    fprintf(outfile, "\n");
+    faceloop.sh = shellfacetraverse(subfaces);
   }
 
-  if (out == (tetgenio *) NULL) {
-    fprintf(outfile, "# Generated by %s\n", b->commandline);
-    fclose(outfile);
+  // Copy input holelist.
+  fprintf(outfile, "\n# part 3: hole list.\n");
+  fprintf(outfile, "%d\n", in->numberofholes);
+  for (i = 0; i < in->numberofholes; i++) {
+    fprintf(outfile, "%d  %g  %g  %g\n", i + in->firstnumber,
+            in->holelist[i * 3], in->holelist[i * 3 + 1],
+            in->holelist[i * 3 + 2]);
+  }
+
+  // Copy input regionlist.
+  fprintf(outfile, "\n# part 4: region list.\n");
+  fprintf(outfile, "%d\n", in->numberofregions);
+  for (i = 0; i < in->numberofregions; i++) {
+    fprintf(outfile, "%d  %g  %g  %g  %d  %g\n", i + in->firstnumber,
+            in->regionlist[i * 5], in->regionlist[i * 5 + 1],
+            in->regionlist[i * 5 + 2], (int) in->regionlist[i * 5 + 3],
+            in->regionlist[i * 5 + 4]);
   }
+
+  fprintf(outfile, "# Generated by %s\n", b->commandline);
+  fclose(outfile);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// outneighbors()    Output tet neighbors to a .neigh file or a structure.   //
+// outmesh2medit()    Write mesh to a .mesh file, which can be read and      //
+//                    rendered by Medit (a free mesh viewer from INRIA).     //
+//                                                                           //
+// You can specify a filename (without suffix) in 'mfilename'.  If you don't //
+// supply a filename (let mfilename be NULL), the default name stored in     //
+// 'tetgenbehavior' will be used. The output file will have the suffix .mesh.//
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-void tetgenmesh::outneighbors(tetgenio* out)
+void tetgenmesh::outmesh2medit(char* mfilename)
 {
-  FILE *outfile = NULL;
-  char neighborfilename[FILENAMESIZE];
-  int *nlist = NULL;
-  int index = 0;
-  triface tetloop, tetsym;
-  int neighbori[4];
-  int firstindex;
-  int elementnumber;
-  long ntets;
+  FILE *outfile;
+  char mefilename[FILENAMESIZE];
+  tetrahedron* tetptr;
+  triface tface, tsymface;
+  face segloop, checkmark;
+  point ptloop, p1, p2, p3, p4;
+  long ntets, faces;
+  int pointnumber;
+  int marker;
+  int i;
 
-  if (out == (tetgenio *) NULL) {
-    strcpy(neighborfilename, b->outfilename);
-    strcat(neighborfilename, ".neigh");
+  if (mfilename != (char *) NULL && mfilename[0] != '\0') {
+    strcpy(mefilename, mfilename);
+  } else if (b->outfilename[0] != '\0') {
+    strcpy(mefilename, b->outfilename);
+  } else {
+    strcpy(mefilename, "unnamed");
   }
+  strcat(mefilename, ".mesh");
 
   if (!b->quiet) {
-    if (out == (tetgenio *) NULL) {
-      printf("Writing %s.\n", neighborfilename);
+    printf("Writing %s.\n", mefilename);
+  }
+  outfile = fopen(mefilename, "w");
+  if (outfile == (FILE *) NULL) {
+    printf("File I/O Error:  Cannot create file %s.\n", mefilename);
+    return;
+  }
+
+  fprintf(outfile, "MeshVersionFormatted 1\n");
+  fprintf(outfile, "\n");
+  fprintf(outfile, "Dimension\n");
+  fprintf(outfile, "3\n");
+  fprintf(outfile, "\n");
+
+  fprintf(outfile, "\n# Set of mesh vertices\n");
+  fprintf(outfile, "Vertices\n");
+  fprintf(outfile, "%ld\n", points->items);
+
+  points->traversalinit();
+  ptloop = pointtraverse();
+  pointnumber = 1;                        // Medit need start number form 1.
+  while (ptloop != (point) NULL) {
+    // Point coordinates.
+    fprintf(outfile, "%.17g  %.17g  %.17g", ptloop[0], ptloop[1], ptloop[2]);
+    if (in->numberofpointattributes > 0) {
+      // Write an attribute, ignore others if more than one.
+      fprintf(outfile, "  %.17g\n", ptloop[3]);
     } else {
-      printf("Writing neighbors.\n");
+      fprintf(outfile, "    0\n");
     }
+    setpointmark(ptloop, pointnumber);
+    ptloop = pointtraverse();
+    pointnumber++;
   }
 
+  // Compute the number of faces.
   ntets = tetrahedrons->items - hullsize;
+  faces = (ntets * 4l + hullsize) / 2l;
 
-  if (out == (tetgenio *) NULL) {
-    outfile = fopen(neighborfilename, "w");
-    if (outfile == (FILE *) NULL) {
-      printf("File I/O Error:  Cannot create file %s.\n", neighborfilename);
-      terminatetetgen(this, 1);
-    }
-    // Number of tetrahedra, four faces per tetrahedron.
-    fprintf(outfile, "%ld  %d\n", ntets, 4);
-  } else {
-    // Allocate memory for 'neighborlist'.
-    out->neighborlist = new int[ntets * 4];
-    if (out->neighborlist == (int *) NULL) {
-      printf("Error:  Out of memory.\n");
-      terminatetetgen(this, 1);
+  fprintf(outfile, "\n# Set of Triangles\n");
+  fprintf(outfile, "Triangles\n");
+  fprintf(outfile, "%ld\n", faces);
+
+  tetrahedrons->traversalinit();
+  tface.tet = tetrahedrontraverse();
+  while (tface.tet != (tetrahedron *) NULL) {
+    for (tface.ver = 0; tface.ver < 4; tface.ver ++) {
+      fsym(tface, tsymface);
+      if (ishulltet(tsymface) || 
+          (elemindex(tface.tet) < elemindex(tsymface.tet))) {
+        p1 = org (tface);
+        p2 = dest(tface);
+        p3 = apex(tface);
+        fprintf(outfile, "%5d  %5d  %5d",
+                pointmark(p1), pointmark(p2), pointmark(p3));
+        // Check if it is a subface.
+        if (!compacttets) {
+          tspivot(tface, checkmark);
+        } else {
+          checkmark.sh = NULL;
+        }
+        if (checkmark.sh == NULL) {
+          marker = 0;  // It is an inner face. It's marker is 0.
+        } else {
+          marker = shellmark(checkmark);
+        }
+        fprintf(outfile, "    %d\n", marker);
+      }
     }
-    nlist = out->neighborlist;
+    tface.tet = tetrahedrontraverse();
   }
 
-  // Determine the first index (0 or 1).
-  firstindex = b->zeroindex ? 0 : in->firstnumber;
+  fprintf(outfile, "\n# Set of Tetrahedra\n");
+  fprintf(outfile, "Tetrahedra\n");
+  fprintf(outfile, "%ld\n", ntets);
 
   tetrahedrons->traversalinit();
-  tetloop.tet = tetrahedrontraverse();
-  elementnumber = firstindex; // in->firstnumber;
-  while (tetloop.tet != (tetrahedron *) NULL) {
-    for (tetloop.ver = 0; tetloop.ver < 4; tetloop.ver++) {
-      fsym(tetloop, tetsym);
-      if (!ishulltet(tetsym)) {
-        neighbori[tetloop.ver] = elemindex(tetsym.tet);
-      } else {
-        neighbori[tetloop.ver] = -1;
-      }
+  tetptr = tetrahedrontraverse();
+  while (tetptr != (tetrahedron *) NULL) {
+    if (!b->reversetetori) {
+      p1 = (point) tetptr[4];
+      p2 = (point) tetptr[5];
+    } else {
+      p1 = (point) tetptr[5];
+      p2 = (point) tetptr[4];
     }
-    if (out == (tetgenio *) NULL) {
-      // Tetrahedra number, neighboring tetrahedron numbers.
-      fprintf(outfile, "%4d    %4d  %4d  %4d  %4d\n", elementnumber,
-              neighbori[0], neighbori[1], neighbori[2], neighbori[3]);
+    p3 = (point) tetptr[6];
+    p4 = (point) tetptr[7];
+    fprintf(outfile, "%5d  %5d  %5d  %5d",
+            pointmark(p1), pointmark(p2), pointmark(p3), pointmark(p4));
+    if (numelemattrib > 0) {
+      fprintf(outfile, "  %.17g", elemattribute(tetptr, 0));
     } else {
-      nlist[index++] = neighbori[0];
-      nlist[index++] = neighbori[1];
-      nlist[index++] = neighbori[2];
-      nlist[index++] = neighbori[3];
+      fprintf(outfile, "  0");
     }
-    tetloop.tet = tetrahedrontraverse();
-    elementnumber++;
+    fprintf(outfile, "\n");
+    tetptr = tetrahedrontraverse();
   }
 
-  if (out == (tetgenio *) NULL) {
-    fprintf(outfile, "# Generated by %s\n", b->commandline);
-    fclose(outfile);
+  fprintf(outfile, "\nCorners\n");
+  fprintf(outfile, "%d\n", in->numberofpoints);
+
+  for (i = 0; i < in->numberofpoints; i++) {
+    fprintf(outfile, "%4d\n", i + 1);
   }
-}
 
-///////////////////////////////////////////////////////////////////////////////
-//                                                                           //
-// outvoronoi()    Output the Voronoi diagram to .v.node, .v.edge, v.face,   //
-//                 and .v.cell.                                              //
-//                                                                           //
-// The Voronoi diagram is the geometric dual of the Delaunay triangulation.  //
-// The Voronoi vertices are the circumcenters of Delaunay tetrahedra.  Each  //
-// Voronoi edge connects two Voronoi vertices at two sides of a common Dela- //
-// unay face. At a face of convex hull, it becomes a ray (goto the infinity).//
-// A Voronoi face is the convex hull of all Voronoi vertices around a common //
-// Delaunay edge. It is a closed polygon for any internal Delaunay edge. At a//
-// ridge, it is unbounded.  Each Voronoi cell is the convex hull of all Vor- //
-// onoi vertices around a common Delaunay vertex. It is a polytope for any   //
-// internal Delaunay vertex. It is an unbounded polyhedron for a Delaunay    //
-// vertex belonging to the convex hull.                                      //
-//                                                                           //
-// NOTE: This routine is only used when the input is only a set of point.    //
-// Comment: Special thanks to Victor Liu for finding and fixing few bugs.    //
-//                                                                           //
-///////////////////////////////////////////////////////////////////////////////
+  if (b->plc || b->refine) {
+    fprintf(outfile, "\nEdges\n");
+    fprintf(outfile, "%ld\n", subsegs->items);
 
-void tetgenmesh::outvoronoi(tetgenio* out)
-{
-  FILE *outfile = NULL;
-  char outfilename[FILENAMESIZE];
-  tetgenio::voroedge *vedge = NULL;
-  tetgenio::vorofacet *vfacet = NULL;
-  arraypool *tetlist, *ptlist;
-  triface tetloop, worktet, spintet, firsttet;
-  point pt[4], ploop, neipt;
-  REAL ccent[3], infvec[3], vec1[3], vec2[3], L;
-  long ntets, faces, edges;
-  int *indexarray, *fidxs, *eidxs;
-  int arraysize, *vertarray = NULL;
-  int vpointcount, vedgecount, vfacecount, tcount;
-  int ishullvert, ishullface;
-  int index, shift, end1, end2;
-  int i, j;
+    subsegs->traversalinit();
+    segloop.sh = shellfacetraverse(subsegs);
+    while (segloop.sh != (shellface *) NULL) {
+      p1 = sorg(segloop);
+      p2 = sdest(segloop);
+      fprintf(outfile, "%5d  %5d", pointmark(p1), pointmark(p2));
+      marker = shellmark(segloop);
+      fprintf(outfile, "    %d\n", marker);
+      segloop.sh = shellfacetraverse(subsegs);
+    }
+  }
+
+  fprintf(outfile, "\nEnd\n");
+  fclose(outfile);
+}
 
-  int t1ver; // used by fsymself()
 
-  // Output Voronoi vertices to .v.node file.
-  if (out == (tetgenio *) NULL) {
-    strcpy(outfilename, b->outfilename);
-    strcat(outfilename, ".v.node");
-  }
 
-  if (!b->quiet) {
-    if (out == (tetgenio *) NULL) {
-      printf("Writing %s.\n", outfilename);
-    } else {
-      printf("Writing Voronoi vertices.\n");
-    }
-  }
 
-  // Determine the first index (0 or 1).
-  shift = (b->zeroindex ? 0 : in->firstnumber);
 
-  // Each face and edge of the tetrahedral mesh will be indexed for indexing
-  //   the Voronoi edges and facets. Indices of faces and edges are saved in
-  //   each tetrahedron (including hull tets).
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// outmesh2vtk()    Save mesh to file in VTK Legacy format.                  //
+//                                                                           //
+// This function was contributed by Bryn Llyod from ETH, 2007.               //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
 
-  // Allocate the total space once.
-  indexarray = new int[tetrahedrons->items * 10];
+void tetgenmesh::outmesh2vtk(char* ofilename)
+{
+  FILE *outfile;
+  char vtkfilename[FILENAMESIZE];
+  point pointloop, p1, p2, p3, p4;
+  tetrahedron* tptr;
+  double x, y, z;
+  int n1, n2, n3, n4;
+  int nnodes = 4;
+  int celltype = 10;
 
-  // Allocate space (10 integers) into each tetrahedron. It re-uses the slot
-  //   for element markers, flags.
-  i = 0;
-  tetrahedrons->traversalinit();
-  tetloop.tet = alltetrahedrontraverse();
-  while (tetloop.tet != NULL) {
-    tetloop.tet[11] = (tetrahedron) &(indexarray[i * 10]);
-    i++;
-    tetloop.tet = alltetrahedrontraverse();
+  if (b->order == 2) {
+    printf("  Write VTK not implemented for order 2 elements \n");
+    return;
   }
 
-  // The number of tetrahedra (excluding hull tets) (Voronoi vertices).
-  ntets = tetrahedrons->items - hullsize;
-  // The number of Delaunay faces (Voronoi edges).
-  faces = (4l * ntets + hullsize) / 2l;
-  // The number of Delaunay edges (Voronoi faces).
-  long vsize = points->items - dupverts - unuverts;
-  if (b->weighted) vsize -= nonregularcount;
-  if (!nonconvex) {
-    edges = vsize + faces - ntets - 1;
-  } else {
-    if (meshedges == 0l) {
-      numberedges(); // Count edges.
-    }
-    edges = meshedges; 
-  }
+  int NEL = tetrahedrons->items - hullsize;
+  int NN = points->items;
 
-  if (out == (tetgenio *) NULL) {
-    outfile = fopen(outfilename, "w");
-    if (outfile == (FILE *) NULL) {
-      printf("File I/O Error:  Cannot create file %s.\n", outfilename);
-      terminatetetgen(this, 3);
-    }
-    // Number of voronoi points, 3 dim, no attributes, no marker.
-    fprintf(outfile, "%ld  3  0  0\n", ntets);
+  if (ofilename != (char *) NULL && ofilename[0] != '\0') {
+    strcpy(vtkfilename, ofilename);
+  } else if (b->outfilename[0] != '\0') {
+    strcpy(vtkfilename, b->outfilename);
   } else {
-    // Allocate space for 'vpointlist'.
-    out->numberofvpoints = (int) ntets;
-    out->vpointlist = new REAL[out->numberofvpoints * 3];
-    if (out->vpointlist == (REAL *) NULL) {
-      terminatetetgen(this, 1);
-    }
+    strcpy(vtkfilename, "unnamed");
   }
+  strcat(vtkfilename, ".vtk");
 
-  // Output Voronoi vertices (the circumcenters of tetrahedra). 
-  tetrahedrons->traversalinit();
-  tetloop.tet = tetrahedrontraverse();
-  vpointcount = 0; // The (internal) v-index always starts from 0. 
-  index = 0;
-  while (tetloop.tet != (tetrahedron *) NULL) {
-    for (i = 0; i < 4; i++) {
-      pt[i] = (point) tetloop.tet[4 + i];
-      setpoint2tet(pt[i], encode(tetloop));
-    }
-    if (b->weighted) {
-      orthosphere(pt[0], pt[1], pt[2], pt[3], pt[0][3], pt[1][3], pt[2][3], 
-                  pt[3][3], ccent, NULL);
-    } else {
-      circumsphere(pt[0], pt[1], pt[2], pt[3], ccent, NULL);
-    }
-    if (out == (tetgenio *) NULL) {
-      fprintf(outfile, "%4d  %16.8e %16.8e %16.8e\n", vpointcount + shift,
-              ccent[0], ccent[1], ccent[2]);
-    } else {
-      out->vpointlist[index++] = ccent[0];
-      out->vpointlist[index++] = ccent[1];
-      out->vpointlist[index++] = ccent[2];
-    }
-    setelemindex(tetloop.tet, vpointcount);
-    vpointcount++;
-    tetloop.tet = tetrahedrontraverse();
+  if (!b->quiet) {
+    printf("Writing %s.\n", vtkfilename);
   }
-
-  if (out == (tetgenio *) NULL) {
-    fprintf(outfile, "# Generated by %s\n", b->commandline);
-    fclose(outfile);
+  outfile = fopen(vtkfilename, "w");
+  if (outfile == (FILE *) NULL) {
+    printf("File I/O Error:  Cannot create file %s.\n", vtkfilename);
+    return;
   }
 
-  // Output Voronoi edges to .v.edge file.
-  if (out == (tetgenio *) NULL) {
-    strcpy(outfilename, b->outfilename);
-    strcat(outfilename, ".v.edge");
+  //always write big endian
+  //bool ImALittleEndian = !testIsBigEndian();
+
+  fprintf(outfile, "# vtk DataFile Version 2.0\n");
+  fprintf(outfile, "Unstructured Grid\n");
+  fprintf(outfile, "ASCII\n"); // BINARY
+  fprintf(outfile, "DATASET UNSTRUCTURED_GRID\n");
+  fprintf(outfile, "POINTS %d double\n", NN);
+
+  points->traversalinit();
+  pointloop = pointtraverse();
+  for(int id=0; id<NN && pointloop != (point) NULL; id++){
+    x = pointloop[0];
+    y = pointloop[1];
+    z = pointloop[2];
+    fprintf(outfile, "%.17g %.17g %.17g\n", x, y, z);
+    pointloop = pointtraverse();
   }
-  
-  if (!b->quiet) {
-    if (out == (tetgenio *) NULL) {
-      printf("Writing %s.\n", outfilename);
+  fprintf(outfile, "\n");
+
+  fprintf(outfile, "CELLS %d %d\n", NEL, NEL*(4+1));
+  //NEL rows, each has 1 type id + 4 node id's
+ 
+  tetrahedrons->traversalinit();
+  tptr = tetrahedrontraverse();
+  //elementnumber = firstindex; // in->firstnumber;
+  while (tptr != (tetrahedron *) NULL) {
+    if (!b->reversetetori) {
+      p1 = (point) tptr[4];
+      p2 = (point) tptr[5];
     } else {
-      printf("Writing Voronoi edges.\n");
+      p1 = (point) tptr[5];
+      p2 = (point) tptr[4];
     }
+    p3 = (point) tptr[6];
+    p4 = (point) tptr[7];
+    n1 = pointmark(p1) - in->firstnumber;
+    n2 = pointmark(p2) - in->firstnumber;
+    n3 = pointmark(p3) - in->firstnumber;
+    n4 = pointmark(p4) - in->firstnumber;
+    fprintf(outfile, "%d  %4d %4d %4d %4d\n", nnodes, n1, n2, n3, n4);
+    tptr = tetrahedrontraverse();
   }
+  fprintf(outfile, "\n");
 
-  if (out == (tetgenio *) NULL) {
-    outfile = fopen(outfilename, "w");
-    if (outfile == (FILE *) NULL) {
-      printf("File I/O Error:  Cannot create file %s.\n", outfilename);
-      terminatetetgen(this, 3);
-    }
-    // Number of Voronoi edges, no marker.
-    fprintf(outfile, "%ld  0\n", faces);
-  } else {
-    // Allocate space for 'vpointlist'.
-    out->numberofvedges = (int) faces;
-    out->vedgelist = new tetgenio::voroedge[out->numberofvedges];
+  fprintf(outfile, "CELL_TYPES %d\n", NEL);
+  for(int tid=0; tid<NEL; tid++){
+    fprintf(outfile, "%d\n", celltype);
   }
-
-  // Output the Voronoi edges. 
-  tetrahedrons->traversalinit();
-  tetloop.tet = tetrahedrontraverse();
-  vedgecount = 0; // D-Face (V-edge) index (from zero).
-  index = 0; // The Delaunay-face index.
-  while (tetloop.tet != (tetrahedron *) NULL) {
-    // Count the number of Voronoi edges. Look at the four faces of each
-    //   tetrahedron. Count the face if the tetrahedron's index is
-    //   smaller than its neighbor's or the neighbor is outside.
-    end1 = elemindex(tetloop.tet);
-    for (tetloop.ver = 0; tetloop.ver < 4; tetloop.ver++) {
-      fsym(tetloop, worktet);
-      if (ishulltet(worktet) || 
-          (elemindex(tetloop.tet) < elemindex(worktet.tet))) {
-        // Found a Voronoi edge. Operate on it.
-        if (out == (tetgenio *) NULL) {
-          fprintf(outfile, "%4d  %4d", vedgecount + shift, end1 + shift);
-        } else {
-          vedge = &(out->vedgelist[index++]);
-          vedge->v1 = end1 + shift;
-        }
-        if (!ishulltet(worktet)) {
-          end2 = elemindex(worktet.tet);
-        } else {
-          end2 = -1;
-        }
-        // Note that end2 may be -1 (worktet.tet is outside).
-        if (end2 == -1) {
-          // Calculate the out normal of this hull face.
-          pt[0] = dest(worktet);
-          pt[1] = org(worktet);
-          pt[2] = apex(worktet);
-          for (j = 0; j < 3; j++) vec1[j] = pt[1][j] - pt[0][j];
-          for (j = 0; j < 3; j++) vec2[j] = pt[2][j] - pt[0][j];
-          cross(vec1, vec2, infvec);
-          // Normalize it.
-          L = sqrt(infvec[0] * infvec[0] + infvec[1] * infvec[1]
-                   + infvec[2] * infvec[2]);
-          if (L > 0) for (j = 0; j < 3; j++) infvec[j] /= L;
-          if (out == (tetgenio *) NULL) {
-            fprintf(outfile, " -1");
-            fprintf(outfile, " %g %g %g\n", infvec[0], infvec[1], infvec[2]);
-          } else {
-            vedge->v2 = -1;
-            vedge->vnormal[0] = infvec[0];
-            vedge->vnormal[1] = infvec[1];
-            vedge->vnormal[2] = infvec[2];
-          }
-        } else {
-          if (out == (tetgenio *) NULL) {
-            fprintf(outfile, " %4d\n", end2 + shift);
-          } else {
-            vedge->v2 = end2 + shift;
-            vedge->vnormal[0] = 0.0;
-            vedge->vnormal[1] = 0.0;
-            vedge->vnormal[2] = 0.0;
-          }
-        }
-        // Save the V-edge index in this tet and its neighbor.
-        fidxs = (int *) (tetloop.tet[11]);
-        fidxs[tetloop.ver] = vedgecount;
-        fidxs = (int *) (worktet.tet[11]);
-        fidxs[worktet.ver & 3] = vedgecount;
-        vedgecount++;
-      }
-    } // tetloop.ver
-    tetloop.tet = tetrahedrontraverse();
+  fprintf(outfile, "\n");
+
+  if (numelemattrib > 0) {
+    // Output tetrahedra region attributes.
+    fprintf(outfile, "CELL_DATA %d\n", NEL);
+    fprintf(outfile, "SCALARS cell_scalars int 1\n");
+    fprintf(outfile, "LOOKUP_TABLE default\n");
+    tetrahedrons->traversalinit();
+    tptr = tetrahedrontraverse();
+    while (tptr != (tetrahedron *) NULL) {
+      fprintf(outfile, "%d\n", (int) elemattribute(tptr, numelemattrib - 1));
+      tptr = tetrahedrontraverse();
+    }
+    fprintf(outfile, "\n");
   }
 
-  if (out == (tetgenio *) NULL) {
-    fprintf(outfile, "# Generated by %s\n", b->commandline);
-    fclose(outfile);
+  fclose(outfile);
+}
+
+////                                                                       ////
+////                                                                       ////
+//// output_cxx ///////////////////////////////////////////////////////////////
+
+//// locator_cxx //////////////////////////////////////////////////////////////
+////                                                                       ////
+////                                                                       ////
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// build()    Build the point location structure over a tetrahedral mesh.    //
+//                                                                           //
+// The grid has about one cell per tetrahedron.  Each tetrahedron is stored  //
+// in the cell containing its centroid, then the empty cells take the tet of //
+// the nearest non-empty cell along the grid lines (x, then y, then z).  A   //
+// flat axis of the bounding box gets a single layer of cells.  If the mesh  //
+// is not convex, the lists of tetrahedra overlapping the cells are built as //
+// well (see setcelltets()).                                                 //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+void tetgenlocator::build(tetgenio *tetmesh)
+{
+  REAL bmin[3], bmax[3], ext[3], cent[3];
+  REAL *pt, vol, h, ori;
+  int active[3], stride[3];
+  int numberofcells, changed, dim;
+  int t, c, i, j, k;
+
+  deinitialize();
+
+  mesh = tetmesh;
+  numberoftetrahedra = tetmesh->numberoftetrahedra;
+  if ((numberoftetrahedra <= 0) || (tetmesh->numberofpoints <= 0)) {
+    return;
   }
 
-  // Output Voronoi faces to .v.face file.
-  if (out == (tetgenio *) NULL) {
-    strcpy(outfilename, b->outfilename);
-    strcat(outfilename, ".v.face");
+  // Find the bounding box of the mesh.
+  for (i = 0; i < 3; i++) {
+    bmin[i] = bmax[i] = mesh->pointlist[i];
   }
-  
-  if (!b->quiet) {
-    if (out == (tetgenio *) NULL) {
-      printf("Writing %s.\n", outfilename);
-    } else {
-      printf("Writing Voronoi faces.\n");
+  for (j = 1; j < mesh->numberofpoints; j++) {
+    pt = &(mesh->pointlist[3 * j]);
+    for (i = 0; i < 3; i++) {
+      if (pt[i] < bmin[i]) bmin[i] = pt[i];
+      if (pt[i] > bmax[i]) bmax[i] = pt[i];
     }
   }
+  for (i = 0; i < 3; i++) {
+    ext[i] = bmax[i] - bmin[i];
+  }
 
-  if (out == (tetgenio *) NULL) {
-    outfile = fopen(outfilename, "w");
-    if (outfile == (FILE *) NULL) {
-      printf("File I/O Error:  Cannot create file %s.\n", outfilename);
-      terminatetetgen(this, 3);
-    }
-    // Number of Voronoi faces.
-    fprintf(outfile, "%ld  0\n", edges);
-  } else {
-    out->numberofvfacets = edges;
-    out->vfacetlist = new tetgenio::vorofacet[out->numberofvfacets];
-    if (out->vfacetlist == (tetgenio::vorofacet *) NULL) {
-      terminatetetgen(this, 1);
+  // Get the orientation of the tetrahedra (from the first non-flat one).
+  orientation = 1.0;
+  for (t = 0; t < numberoftetrahedra; t++) {
+    ori = orient3drobust(corner(t, 0), corner(t, 1), corner(t, 2),
+                         corner(t, 3));
+    if (ori != 0.0) {
+      orientation = (ori > 0.0) ? 1.0 : -1.0;
+      break;
     }
   }
 
-  // Output the Voronoi facets.
-  tetrahedrons->traversalinit();
-  tetloop.tet = tetrahedrontraverse();
-  vfacecount = 0; // D-edge (V-facet) index (from zero).
-  while (tetloop.tet != (tetrahedron *) NULL) {
-    // Count the number of Voronoi faces. Look at the six edges of each
-    //   tetrahedron. Count the edge only if the tetrahedron's index is
-    //   smaller than those of all other tetrahedra that share the edge.
-    worktet.tet = tetloop.tet;
-    for (i = 0; i < 6; i++) {
-      worktet.ver = edge2ver[i];
-      // Count the number of faces at this edge. If the edge is a hull edge,
-      //   the face containing dummypoint is also counted.
-      //ishulledge = 0; // Is it a hull edge.
-      tcount = 0;
-      firsttet = worktet;
-      spintet = worktet;
-      while (1) {
-        tcount++;
-        fnextself(spintet);
-        if (spintet.tet == worktet.tet) break;
-        if (!ishulltet(spintet)) {
-          if (elemindex(spintet.tet) < elemindex(worktet.tet)) break;
-        } else {
-          //ishulledge = 1;
-          if (apex(spintet) == dummypoint) {
-            // We make this V-edge appear in the end of the edge list.
-            fnext(spintet, firsttet); 
-          }
-        }
-      } // while (1)
-      if (spintet.tet == worktet.tet) {
-        // Found a Voronoi facet. Operate on it.
-        pt[0] = org(worktet);
-        pt[1] = dest(worktet);
-        end1 = pointmark(pt[0]) - in->firstnumber; // V-cell index
-        end2 = pointmark(pt[1]) - in->firstnumber;
-        if (out == (tetgenio *) NULL) {
-          fprintf(outfile, "%4d  %4d %4d  %-2d ", vfacecount + shift, 
-                  end1 + shift, end2 + shift, tcount);
-        } else {
-          vfacet = &(out->vfacetlist[vfacecount]);
-          vfacet->c1 = end1 + shift;
-          vfacet->c2 = end2 + shift;
-          vfacet->elist = new int[tcount + 1];
-          vfacet->elist[0] = tcount;
-          index = 1;
-        }
-        // Output V-edges of this V-facet.
-        spintet = firsttet; //worktet;
-        while (1) {
-          fidxs = (int *) (spintet.tet[11]);
-          if (apex(spintet) != dummypoint) {
-            vedgecount = fidxs[spintet.ver & 3];
-            ishullface = 0;
-          } else {
-            ishullface = 1; // It's not a real face.
-          }
-          if (out == (tetgenio *) NULL) {
-            fprintf(outfile, " %d", !ishullface ? (vedgecount + shift) : -1); 
-          } else {
-            vfacet->elist[index++] = !ishullface ? (vedgecount + shift) : -1;
-          }
-          // Save the V-facet index in this tet at this edge.
-          eidxs = &(fidxs[4]);
-          eidxs[ver2edge[spintet.ver]] = vfacecount;
-          // Go to the next face.
-          fnextself(spintet);
-          if (spintet.tet == firsttet.tet) break;
-        } // while (1)
-        if (out == (tetgenio *) NULL) {
-          fprintf(outfile, "\n");
-        }
-        vfacecount++;
-      } // if (spintet.tet == worktet.tet)
-    } // if (i = 0; i < 6; i++)
-    tetloop.tet = tetrahedrontraverse();
-  }
+  setneighbors();
+  checkconvexity();
 
-  if (out == (tetgenio *) NULL) {
-    fprintf(outfile, "# Generated by %s\n", b->commandline);
-    fclose(outfile);
+  // Decide the cell size h. The axes shorter than h are flat.
+  for (i = 0; i < 3; i++) {
+    active[i] = (ext[i] > 0.0);
   }
-
-  // Output Voronoi cells to .v.cell file.
-  if (out == (tetgenio *) NULL) {
-    strcpy(outfilename, b->outfilename);
-    strcat(outfilename, ".v.cell");
+  h = 1.0;
+  while (1) {
+    vol = 1.0;
+    dim = 0;
+    for (i = 0; i < 3; i++) {
+      if (active[i]) {
+        vol *= ext[i];
+        dim++;
+      }
+    }
+    if (dim == 0) break;
+    h = pow(vol / (REAL) numberoftetrahedra, 1.0 / (REAL) dim);
+    changed = 0;
+    for (i = 0; i < 3; i++) {
+      if (active[i] && (ext[i] < h)) {
+        active[i] = 0;
+        changed = 1;
+      }
+    }
+    if (!changed) break;
   }
-  
-  if (!b->quiet) {
-    if (out == (tetgenio *) NULL) {
-      printf("Writing %s.\n", outfilename);
+  for (i = 0; i < 3; i++) {
+    gridmin[i] = bmin[i];
+    if (active[i]) {
+      gridsize[i] = (int) (ext[i] / h);
+      if (gridsize[i] < 1) gridsize[i] = 1;
+      gridscale[i] = (REAL) gridsize[i] / ext[i];
     } else {
-      printf("Writing Voronoi cells.\n");
+      gridsize[i] = 1;
+      gridscale[i] = 0.0;
     }
   }
+  stride[0] = 1;
+  stride[1] = gridsize[0];
+  stride[2] = gridsize[0] * gridsize[1];
+  numberofcells = stride[2] * gridsize[2];
 
-  if (out == (tetgenio *) NULL) {
-    outfile = fopen(outfilename, "w");
-    if (outfile == (FILE *) NULL) {
-      printf("File I/O Error:  Cannot create file %s.\n", outfilename);
-      terminatetetgen(this, 3);
+  gridtets = new int[numberofcells];
+  for (c = 0; c < numberofcells; c++) {
+    gridtets[c] = -1;
+  }
+
+  // Store every tetrahedron in the cell of its centroid.
+  for (t = 0; t < numberoftetrahedra; t++) {
+    for (i = 0; i < 3; i++) {
+      cent[i] = 0.25 * (corner(t, 0)[i] + corner(t, 1)[i] +
+                        corner(t, 2)[i] + corner(t, 3)[i]);
     }
-    // Number of Voronoi cells.
-    fprintf(outfile, "%ld\n", points->items - unuverts - dupverts);
-  } else {
-    out->numberofvcells = points->items - unuverts - dupverts;
-    out->vcelllist = new int*[out->numberofvcells];
-    if (out->vcelllist == (int **) NULL) {
-      terminatetetgen(this, 1);
+    c = 0;
+    for (i = 0; i < 3; i++) {
+      j = (int) ((cent[i] - gridmin[i]) * gridscale[i]);
+      if (j < 0) j = 0;
+      if (j >= gridsize[i]) j = gridsize[i] - 1;
+      c += j * stride[i];
     }
+    gridtets[c] = t;
   }
 
-  // Output Voronoi cells.
-  tetlist = cavetetlist;
-  ptlist = cavetetvertlist;
-  points->traversalinit();
-  ploop = pointtraverse();
-  vpointcount = 0;
-  while (ploop != (point) NULL) {
-    if ((pointtype(ploop) != UNUSEDVERTEX) &&
-        (pointtype(ploop) != DUPLICATEDVERTEX) &&
-        (pointtype(ploop) != NREGULARVERTEX)) { 
-      getvertexstar(1, ploop, tetlist, ptlist, NULL);
-      // Mark all vertices. Check if it is a hull vertex.
-      ishullvert = 0;
-      for (i = 0; i < ptlist->objects; i++) {
-        neipt = * (point *) fastlookup(ptlist, i);
-        if (neipt != dummypoint) {
-          pinfect(neipt);
-        } else {
-          ishullvert = 1;
-        }
+  // Fill the empty cells, sweep along the lines of each axis forward and
+  //   backward.  After the sweeps of an axis, every line (then plane) which
+  //   contains a tetrahedron is full.
+  for (i = 0; i < 3; i++) {
+    for (c = 0; c < numberofcells; c++) {
+      if (((c / stride[i]) % gridsize[i]) != 0) continue;
+      t = -1;
+      for (j = 0; j < gridsize[i]; j++) {
+        k = c + j * stride[i];
+        if (gridtets[k] >= 0) t = gridtets[k]; else gridtets[k] = t;
       }
-      tcount = (int) ptlist->objects;
-      if (out == (tetgenio *) NULL) {
-        fprintf(outfile, "%4d  %-2d ", vpointcount + shift, tcount);
-      } else {
-        arraysize = tcount;
-        vertarray = new int[arraysize + 1];
-        out->vcelllist[vpointcount] = vertarray;
-        vertarray[0] = tcount;
-        index = 1;
+      t = -1;
+      for (j = gridsize[i] - 1; j >= 0; j--) {
+        k = c + j * stride[i];
+        if (gridtets[k] >= 0) t = gridtets[k]; else gridtets[k] = t;
       }
-      // List Voronoi facets bounding this cell.
-      for (i = 0; i < tetlist->objects; i++) {
-        worktet = * (triface *) fastlookup(tetlist, i);
-        // Let 'worktet' be [a,b,c,d] where d = ploop.
-        for (j = 0; j < 3; j++) {
-          neipt = org(worktet); // neipt is a, or b, or c
-          // Skip the dummypoint.
-          if (neipt != dummypoint) {
-            if (pinfected(neipt)) {
-              // It's not processed yet.
-              puninfect(neipt);
-              // Go to the DT edge [a,d], or [b,d], or [c,d]. 
-              esym(worktet, spintet);
-              enextself(spintet);
-              // Get the V-face dual to this edge.
-              eidxs = (int *) spintet.tet[11];
-              vfacecount = eidxs[4 + ver2edge[spintet.ver]];
-              if (out == (tetgenio *) NULL) {
-                fprintf(outfile, " %d", vfacecount + shift);
-              } else {
-                vertarray[index++] = vfacecount + shift;
-              }
+    }
+  }
+
+  if (nonconvex) {
+    setcelltets();
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// setcelltets()    List the tetrahedra whose bounding box overlaps a cell.  //
+//                                                                           //
+// A tetrahedron is about as large as a cell, so it overlaps a few cells. A  //
+// point inside the mesh is in one of the tetrahedra listed at its cell.     //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+void tetgenlocator::setcelltets()
+{
+  REAL *pt;
+  int lo[3], hi[3], stride[3];
+  int numberofcells;
+  int t, c, i, j, k, n;
+
+  stride[0] = 1;
+  stride[1] = gridsize[0];
+  stride[2] = gridsize[0] * gridsize[1];
+  numberofcells = stride[2] * gridsize[2];
+
+  cellstart = new int[numberofcells + 1];
+  for (c = 0; c <= numberofcells; c++) {
+    cellstart[c] = 0;
+  }
+
+  // Two passes: count the tetrahedra of the cells, then save them.
+  celltets = NULL;
+  for (n = 0; n < 2; n++) {
+    for (t = 0; t < numberoftetrahedra; t++) {
+      // The range of cells overlapping the bounding box of 't'.
+      for (j = 0; j < 4; j++) {
+        pt = corner(t, j);
+        c = cellindex(pt);
+        for (i = 0; i < 3; i++) {
+          k = c / stride[i] % gridsize[i];
+          if ((j == 0) || (k < lo[i])) lo[i] = k;
+          if ((j == 0) || (k > hi[i])) hi[i] = k;
+        }
+      }
+      for (k = lo[2]; k <= hi[2]; k++) {
+        for (j = lo[1]; j <= hi[1]; j++) {
+          for (i = lo[0]; i <= hi[0]; i++) {
+            c = k * stride[2] + j * stride[1] + i;
+            if (n == 0) {
+              cellstart[c + 1]++;
+            } else {
+              celltets[cellstart[c]++] = t;
             }
-          }
-          enextself(worktet);
-        } // j
-      } // i
-      if (ishullvert) {
-        // Add a hull facet (-1) to the facet list.
-        if (out == (tetgenio *) NULL) {
-          fprintf(outfile, " -1");
-        } else {
-          vertarray[index++] = -1;
+          }
         }
       }
-      if (out == (tetgenio *) NULL) {
-        fprintf(outfile, "\n");
+    }
+    if (n == 0) {
+      for (c = 0; c < numberofcells; c++) {
+        cellstart[c + 1] += cellstart[c];
       }
-      tetlist->restart();
-      ptlist->restart();
-      vpointcount++;
+      celltets = new int[cellstart[numberofcells]];
+    } else {
+      // Shift the starts back (they were moved to the ends).
+      for (c = numberofcells; c > 0; c--) {
+        cellstart[c] = cellstart[c - 1];
+      }
+      cellstart[0] = 0;
     }
-    ploop = pointtraverse();
-  }
-
-  // Delete the space for face/edge indices.
-  delete [] indexarray;
-
-  if (out == (tetgenio *) NULL) {
-    fprintf(outfile, "# Generated by %s\n", b->commandline);
-    fclose(outfile);
   }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// outsmesh()    Write surface mesh to a .smesh file, which can be read and  //
-//               tetrahedralized by TetGen.                                  //
+// setneighbors()    Set the face adjacencies of the tetrahedra.             //
 //                                                                           //
-// You can specify a filename (without suffix) in 'smfilename'. If you don't //
-// supply a filename (let smfilename be NULL), the default name stored in    //
-// 'tetgenbehavior' will be used.                                            //
+// The 'neighborlist' of the mesh is used if its i-th neighbor is opposite   //
+// to the i-th corner for all tetrahedra (it is not if the corners have been //
+// reordered, e.g., by -z1).  Otherwise, the neighbors are found by the map  //
+// from vertices to their tetrahedra:  the neighbor at a face is the other   //
+// tetrahedron at one vertex of the face which contains its other vertices.  //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-void tetgenmesh::outsmesh(char* smfilename)
+void tetgenlocator::setneighbors()
 {
-  FILE *outfile;
-  char nodfilename[FILENAMESIZE];
-  char smefilename[FILENAMESIZE];
-  face faceloop;
-  point p1, p2, p3;
-  int firstindex, shift;
-  int bmark;
-  int marker;
-  int i;
-
-  if (smfilename != (char *) NULL && smfilename[0] != '\0') {
-    strcpy(smefilename, smfilename);
-  } else if (b->outfilename[0] != '\0') {
-    strcpy(smefilename, b->outfilename);
-  } else {
-    strcpy(smefilename, "unnamed");
+  int *offsets, *vertextets;
+  int numberofpoints = mesh->numberofpoints;
+  int valid, n, s, v[3];
+  int t, c, i, j, k;
+
+  neighbors = new int[4 * numberoftetrahedra];
+
+  if (mesh->neighborlist != (int *) NULL) {
+    valid = 1;
+    for (t = 0; (t < numberoftetrahedra) && valid; t++) {
+      for (i = 0; (i < 4) && valid; i++) {
+        n = mesh->neighborlist[4 * t + i];
+        n = (n < 0) ? -1 : n - mesh->firstnumber;
+        neighbors[4 * t + i] = n;
+        if (n < 0) continue;
+        if (n >= numberoftetrahedra) {
+          valid = 0;
+          break;
+        }
+        // The neighbor must share all corners of 't' but the i-th one.
+        k = 0;
+        for (j = 0; j < 4; j++) {
+          s = cornerindex(n, j);
+          if (s == cornerindex(t, i)) {
+            valid = 0;
+            break;
+          }
+          if ((s == cornerindex(t, (i + 1) & 3)) ||
+              (s == cornerindex(t, (i + 2) & 3)) ||
+              (s == cornerindex(t, (i + 3) & 3))) {
+            k++;
+          }
+        }
+        if (k != 3) valid = 0;
+      }
+    }
+    if (valid) return;
   }
-  strcpy(nodfilename, smefilename);
-  strcat(smefilename, ".smesh");
-  strcat(nodfilename, ".node");
 
-  if (!b->quiet) {
-    printf("Writing %s.\n", smefilename);
+  // Build the map from vertices to tetrahedra.
+  offsets = new int[numberofpoints + 1];
+  vertextets = new int[4 * numberoftetrahedra];
+  for (i = 0; i <= numberofpoints; i++) {
+    offsets[i] = 0;
   }
-  outfile = fopen(smefilename, "w");
-  if (outfile == (FILE *) NULL) {
-    printf("File I/O Error:  Cannot create file %s.\n", smefilename);
-    return;
+  for (t = 0; t < numberoftetrahedra; t++) {
+    for (i = 0; i < 4; i++) {
+      offsets[cornerindex(t, i) + 1]++;
+    }
   }
-
-  // Determine the first index (0 or 1).
-  firstindex = b->zeroindex ? 0 : in->firstnumber;
-  shift = 0; // Default no shiftment.
-  if ((in->firstnumber == 1) && (firstindex == 0)) {
-    shift = 1; // Shift the output indices by 1.
+  for (i = 0; i < numberofpoints; i++) {
+    offsets[i + 1] += offsets[i];
   }
-
-  fprintf(outfile, "# %s.  TetGen's input file.\n", smefilename);
-  fprintf(outfile, "\n# part 1: node list.\n");
-  fprintf(outfile, "0  3  0  0  # nodes are found in %s.\n", nodfilename);
-
-  marker = 0; // avoid compile warning.
-  bmark = !b->nobound && (in->facetmarkerlist || in->trifacemarkerlist);  
-
-  fprintf(outfile, "\n# part 2: facet list.\n");
-  // Number of facets, boundary marker.
-  fprintf(outfile, "%ld  %d\n", subfaces->items, bmark);
-  
-  subfaces->traversalinit();
-  faceloop.sh = shellfacetraverse(subfaces);
-  while (faceloop.sh != (shellface *) NULL) {
-    p1 = sorg(faceloop);
-    p2 = sdest(faceloop);
-    p3 = sapex(faceloop);
-    if (bmark) {
-      marker = shellmark(faceloop);
-    }
-    fprintf(outfile, "3    %4d  %4d  %4d", pointmark(p1) - shift,
-            pointmark(p2) - shift, pointmark(p3) - shift);
-    if (bmark) {
-      fprintf(outfile, "    %d", marker);
+  for (t = 0; t < numberoftetrahedra; t++) {
+    for (i = 0; i < 4; i++) {
+      vertextets[offsets[cornerindex(t, i)]++] = t;
     }
-    fprintf(outfile, "\n");
-    faceloop.sh = shellfacetraverse(subfaces);
   }
-
-  // Copy input holelist.
-  fprintf(outfile, "\n# part 3: hole list.\n");
-  fprintf(outfile, "%d\n", in->numberofholes);
-  for (i = 0; i < in->numberofholes; i++) {
-    fprintf(outfile, "%d  %g  %g  %g\n", i + in->firstnumber,
-            in->holelist[i * 3], in->holelist[i * 3 + 1],
-            in->holelist[i * 3 + 2]);
+  for (i = numberofpoints; i > 0; i--) {
+    offsets[i] = offsets[i - 1];
   }
+  offsets[0] = 0;
 
-  // Copy input regionlist.
-  fprintf(outfile, "\n# part 4: region list.\n");
-  fprintf(outfile, "%d\n", in->numberofregions);
-  for (i = 0; i < in->numberofregions; i++) {
-    fprintf(outfile, "%d  %g  %g  %g  %d  %g\n", i + in->firstnumber,
-            in->regionlist[i * 5], in->regionlist[i * 5 + 1],
-            in->regionlist[i * 5 + 2], (int) in->regionlist[i * 5 + 3],
-            in->regionlist[i * 5 + 4]);
+#ifdef _OPENMP
+  #pragma omp parallel for private(c, i, j, k, n, s, v)
+#endif
+  for (t = 0; t < numberoftetrahedra; t++) {
+    for (i = 0; i < 4; i++) {
+      v[0] = cornerindex(t, (i + 1) & 3);
+      v[1] = cornerindex(t, (i + 2) & 3);
+      v[2] = cornerindex(t, (i + 3) & 3);
+      n = -1;
+      for (j = offsets[v[0]]; (j < offsets[v[0] + 1]) && (n < 0); j++) {
+        s = vertextets[j];
+        if (s == t) continue;
+        // Does 's' contain v[1] and v[2]?
+        k = 0;
+        for (c = 0; c < 4; c++) {
+          if ((cornerindex(s, c) == v[1]) || (cornerindex(s, c) == v[2])) k++;
+        }
+        if (k == 2) n = s;
+      }
+      neighbors[4 * t + i] = n;
+    }
   }
 
-  fprintf(outfile, "# Generated by %s\n", b->commandline);
-  fclose(outfile);
+  delete [] vertextets;
+  delete [] offsets;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// outmesh2medit()    Write mesh to a .mesh file, which can be read and      //
-//                    rendered by Medit (a free mesh viewer from INRIA).     //
+// checkconvexity()    Check if the boundary of the mesh is convex.          //
 //                                                                           //
-// You can specify a filename (without suffix) in 'mfilename'.  If you don't //
-// supply a filename (let mfilename be NULL), the default name stored in     //
-// 'tetgenbehavior' will be used. The output file will have the suffix .mesh.//
+// The boundary edges are sorted, so the two boundary faces at each edge are //
+// adjacent in the list.  The boundary is convex if at every edge, the apex  //
+// of one face does not lie on the outer side of the other face. An edge in  //
+// more than two boundary faces (a non-manifold boundary) is not convex.     //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-void tetgenmesh::outmesh2medit(char* mfilename)
-{
-  FILE *outfile;
-  char mefilename[FILENAMESIZE];
-  tetrahedron* tetptr;
-  triface tface, tsymface;
-  face segloop, checkmark;
-  point ptloop, p1, p2, p3, p4;
-  long ntets, faces;
-  int pointnumber;
-  int marker;
-  int i;
+// A boundary edge [v0, v1] (v0 < v1) of a face with apex 'apex', the face is
+//   opposite to the corner 'ver' of the tetrahedron 'tet'.
+typedef struct {
+  int v0, v1, apex, tet, ver;
+} locatoredge;
 
-  if (mfilename != (char *) NULL && mfilename[0] != '\0') {
-    strcpy(mefilename, mfilename);
-  } else if (b->outfilename[0] != '\0') {
-    strcpy(mefilename, b->outfilename);
-  } else {
-    strcpy(mefilename, "unnamed");
-  }
-  strcat(mefilename, ".mesh");
+static int locatoredgecompare(const void *x, const void *y)
+{
+  const locatoredge *e1 = (const locatoredge *) x;
+  const locatoredge *e2 = (const locatoredge *) y;
 
-  if (!b->quiet) {
-    printf("Writing %s.\n", mefilename);
-  }
-  outfile = fopen(mefilename, "w");
-  if (outfile == (FILE *) NULL) {
-    printf("File I/O Error:  Cannot create file %s.\n", mefilename);
-    return;
-  }
+  if (e1->v0 != e2->v0) return (e1->v0 < e2->v0) ? -1 : 1;
+  if (e1->v1 != e2->v1) return (e1->v1 < e2->v1) ? -1 : 1;
+  return 0;
+}
 
-  fprintf(outfile, "MeshVersionFormatted 1\n");
-  fprintf(outfile, "\n");
-  fprintf(outfile, "Dimension\n");
-  fprintf(outfile, "3\n");
-  fprintf(outfile, "\n");
+void tetgenlocator::checkconvexity()
+{
+  locatoredge *edgelist, *e1, *e2;
+  REAL *pa, *pb, *pc, s1, s2;
+  long numberofedges, count;
+  int v[3];
+  int t, i, j;
 
-  fprintf(outfile, "\n# Set of mesh vertices\n");
-  fprintf(outfile, "Vertices\n");
-  fprintf(outfile, "%ld\n", points->items);
+  nonconvex = 0;
 
-  points->traversalinit();
-  ptloop = pointtraverse();
-  pointnumber = 1;                        // Medit need start number form 1.
-  while (ptloop != (point) NULL) {
-    // Point coordinates.
-    fprintf(outfile, "%.17g  %.17g  %.17g", ptloop[0], ptloop[1], ptloop[2]);
-    if (in->numberofpointattributes > 0) {
-      // Write an attribute, ignore others if more than one.
-      fprintf(outfile, "  %.17g\n", ptloop[3]);
-    } else {
-      fprintf(outfile, "    0\n");
-    }
-    setpointmark(ptloop, pointnumber);
-    ptloop = pointtraverse();
-    pointnumber++;
+  numberofedges = 0l;
+  for (t = 0; t < 4 * numberoftetrahedra; t++) {
+    if (neighbors[t] < 0) numberofedges += 3l;
   }
+  if (numberofedges == 0l) return;
 
-  // Compute the number of faces.
-  ntets = tetrahedrons->items - hullsize;
-  faces = (ntets * 4l + hullsize) / 2l;
-
-  fprintf(outfile, "\n# Set of Triangles\n");
-  fprintf(outfile, "Triangles\n");
-  fprintf(outfile, "%ld\n", faces);
-
-  tetrahedrons->traversalinit();
-  tface.tet = tetrahedrontraverse();
-  while (tface.tet != (tetrahedron *) NULL) {
-    for (tface.ver = 0; tface.ver < 4; tface.ver ++) {
-      fsym(tface, tsymface);
-      if (ishulltet(tsymface) || 
-          (elemindex(tface.tet) < elemindex(tsymface.tet))) {
-        p1 = org (tface);
-        p2 = dest(tface);
-        p3 = apex(tface);
-        fprintf(outfile, "%5d  %5d  %5d",
-                pointmark(p1), pointmark(p2), pointmark(p3));
-        // Check if it is a subface.
-        tspivot(tface, checkmark);
-        if (checkmark.sh == NULL) {
-          marker = 0;  // It is an inner face. It's marker is 0.
-        } else {
-          marker = shellmark(checkmark);
+  edgelist = new locatoredge[numberofedges];
+  count = 0l;
+  for (t = 0; t < numberoftetrahedra; t++) {
+    for (i = 0; i < 4; i++) {
+      if (neighbors[4 * t + i] >= 0) continue;
+      v[0] = cornerindex(t, (i + 1) & 3);
+      v[1] = cornerindex(t, (i + 2) & 3);
+      v[2] = cornerindex(t, (i + 3) & 3);
+      for (j = 0; j < 3; j++) {
+        e1 = &(edgelist[count++]);
+        e1->v0 = v[j];
+        e1->v1 = v[(j + 1) % 3];
+        if (e1->v0 > e1->v1) {
+          e1->v0 = v[(j + 1) % 3];
+          e1->v1 = v[j];
         }
-        fprintf(outfile, "    %d\n", marker);
+        e1->apex = v[(j + 2) % 3];
+        e1->tet = t;
+        e1->ver = i;
       }
     }
-    tface.tet = tetrahedrontraverse();
   }
 
-  fprintf(outfile, "\n# Set of Tetrahedra\n");
-  fprintf(outfile, "Tetrahedra\n");
-  fprintf(outfile, "%ld\n", ntets);
+  qsort(edgelist, numberofedges, sizeof(locatoredge), locatoredgecompare);
 
-  tetrahedrons->traversalinit();
-  tetptr = tetrahedrontraverse();
-  while (tetptr != (tetrahedron *) NULL) {
-    if (!b->reversetetori) {
-      p1 = (point) tetptr[4];
-      p2 = (point) tetptr[5];
-    } else {
-      p1 = (point) tetptr[5];
-      p2 = (point) tetptr[4];
-    }
-    p3 = (point) tetptr[6];
-    p4 = (point) tetptr[7];
-    fprintf(outfile, "%5d  %5d  %5d  %5d",
-            pointmark(p1), pointmark(p2), pointmark(p3), pointmark(p4));
-    if (numelemattrib > 0) {
-      fprintf(outfile, "  %.17g", elemattribute(tetptr, 0));
-    } else {
-      fprintf(outfile, "  0");
+  for (count = 0l; count < numberofedges; count += 2l) {
+    e1 = &(edgelist[count]);
+    e2 = &(edgelist[count + 1]);
+    if ((count + 1l >= numberofedges) ||
+        (locatoredgecompare(e1, e2) != 0) ||
+        ((count + 2l < numberofedges) && 
+         (locatoredgecompare(e2, &(edgelist[count + 2])) == 0))) {
+      nonconvex = 1; // A non-manifold (or open) boundary.
+      break;
     }
-    fprintf(outfile, "\n");
-    tetptr = tetrahedrontraverse();
-  }
-
-  fprintf(outfile, "\nCorners\n");
-  fprintf(outfile, "%d\n", in->numberofpoints);
-
-  for (i = 0; i < in->numberofpoints; i++) {
-    fprintf(outfile, "%4d\n", i + 1);
-  }
-
-  if (b->plc || b->refine) {
-    fprintf(outfile, "\nEdges\n");
-    fprintf(outfile, "%ld\n", subsegs->items);
-
-    subsegs->traversalinit();
-    segloop.sh = shellfacetraverse(subsegs);
-    while (segloop.sh != (shellface *) NULL) {
-      p1 = sorg(segloop);
-      p2 = sdest(segloop);
-      fprintf(outfile, "%5d  %5d", pointmark(p1), pointmark(p2));
-      marker = shellmark(segloop);
-      fprintf(outfile, "    %d\n", marker);
-      segloop.sh = shellfacetraverse(subsegs);
+    pa = &(mesh->pointlist[3 * e1->v0]);
+    pb = &(mesh->pointlist[3 * e1->v1]);
+    pc = &(mesh->pointlist[3 * e1->apex]);
+    s1 = orient3drobust(pa, pb, pc, corner(e1->tet, e1->ver));
+    s2 = orient3drobust(pa, pb, pc, &(mesh->pointlist[3 * e2->apex]));
+    if (s1 * s2 < 0.0) {
+      nonconvex = 1; // A reflex edge.
+      break;
     }
   }
 
-  fprintf(outfile, "\nEnd\n");
-  fclose(outfile);
+  delete [] edgelist;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// walk()    Walk from a tetrahedron to the one containing a point.          //
+//                                                                           //
+// In every step, the four faces of the current tetrahedron are tested, and  //
+// the walk crosses one of the faces having the point on its other side (it  //
+// is chosen randomly if there are several).  It stops at a tetrahedron      //
+// which contains the point (in its interior or on its boundary).            //
+//                                                                           //
+// Return the index (from 0) of the tetrahedron, or -1 if the walk leaves    //
+// the mesh, or -2 if it does not stop (it may only happen in an invalid     //
+// mesh).  'seed' is the state of the random choices.                        //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
 
+int tetgenlocator::walk(REAL *searchpt, int starttet, unsigned long *seed)
+{
+  REAL *pts[12], *p[4], oris[4];
+  int moves[4], count, steps;
+  int t, i;
 
+  t = starttet;
+  for (steps = 0; steps <= numberoftetrahedra; steps++) {
+    for (i = 0; i < 4; i++) {
+      p[i] = corner(t, i);
+    }
+    // The faces opposite to p[0], ..., p[3].  Each is ordered such that its
+    //   opposite corner has the sign of 'orientation'.
+    pts[0] = p[1]; pts[1]  = p[3]; pts[2]  = p[2];
+    pts[3] = p[0]; pts[4]  = p[2]; pts[5]  = p[3];
+    pts[6] = p[0]; pts[7]  = p[3]; pts[8]  = p[1];
+    pts[9] = p[0]; pts[10] = p[1]; pts[11] = p[2];
+    orient3drobustbatch(4, pts, searchpt, oris);
+    count = 0;
+    for (i = 0; i < 4; i++) {
+      if (oris[i] * orientation < 0.0) {
+        moves[count++] = i;
+      }
+    }
+    if (count == 0) {
+      return t;
+    }
+    i = 0;
+    if (count > 1) {
+      *seed = (*seed * 1366l + 150889l) % 714025l;
+      i = (int) (*seed / (714025l / count + 1l));
+    }
+    t = neighbors[4 * t + moves[i]];
+    if (t < 0) {
+      return -1;
+    }
+  }
 
+  return -2;
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
-// outmesh2vtk()    Save mesh to file in VTK Legacy format.                  //
+// search()    Find the tetrahedron containing a point by a linear search.   //
 //                                                                           //
-// This function was contributed by Bryn Llyod from ETH, 2007.               //
+// Only the tetrahedra listed at the cell 'cell' of the point are tested if  //
+// the lists exist (see setcelltets()), otherwise all tetrahedra are tested. //
+// Return the index (from 0) of the tetrahedron, or -1 if it is not found.   //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-void tetgenmesh::outmesh2vtk(char* ofilename)
+int tetgenlocator::search(REAL *searchpt, int cell)
 {
-  FILE *outfile;
-  char vtkfilename[FILENAMESIZE];
-  point pointloop, p1, p2, p3, p4;
-  tetrahedron* tptr;
-  double x, y, z;
-  int n1, n2, n3, n4;
-  int nnodes = 4;
-  int celltype = 10;
+  REAL *pts[12], *p[4], oris[4];
+  int first, last, j, t, i;
 
-  if (b->order == 2) {
-    printf("  Write VTK not implemented for order 2 elements \n");
-    return;
+  if (cellstart != (int *) NULL) {
+    first = cellstart[cell];
+    last = cellstart[cell + 1];
+  } else {
+    first = 0;
+    last = numberoftetrahedra;
   }
 
-  int NEL = tetrahedrons->items - hullsize;
-  int NN = points->items;
+  for (j = first; j < last; j++) {
+    t = (celltets != (int *) NULL) ? celltets[j] : j;
+    for (i = 0; i < 4; i++) {
+      p[i] = corner(t, i);
+    }
+    pts[0] = p[1]; pts[1]  = p[3]; pts[2]  = p[2];
+    pts[3] = p[0]; pts[4]  = p[2]; pts[5]  = p[3];
+    pts[6] = p[0]; pts[7]  = p[3]; pts[8]  = p[1];
+    pts[9] = p[0]; pts[10] = p[1]; pts[11] = p[2];
+    orient3drobustbatch(4, pts, searchpt, oris);
+    for (i = 0; i < 4; i++) {
+      if (oris[i] * orientation < 0.0) break;
+    }
+    if (i == 4) {
+      return t;
+    }
+  }
 
-  if (ofilename != (char *) NULL && ofilename[0] != '\0') {
-    strcpy(vtkfilename, ofilename);
-  } else if (b->outfilename[0] != '\0') {
-    strcpy(vtkfilename, b->outfilename);
-  } else {
-    strcpy(vtkfilename, "unnamed");
+  return -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// locate()    Find the tetrahedron containing a point.                      //
+//                                                                           //
+// Return its index (counted from the 'firstnumber' of the mesh), or -1 if   //
+// the point is outside the mesh.  A point on a shared face, edge, or vertex //
+// gets one of the tetrahedra containing it.                                 //
+//                                                                           //
+// locate_many()    Locate a list of points (3 coordinates each).            //
+//                                                                           //
+// The index of the tetrahedron containing the i-th point is saved in        //
+// 'tetlist[i]'.  If there are many points, they are located in the order of //
+// their cells, so that the walks of consecutive points share tetrahedra.    //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+int tetgenlocator::cellindex(REAL *pt)
+{
+  REAL x;
+  int c, stride, i, j;
+
+  // The point is clamped to the grid.
+  c = 0;
+  stride = 1;
+  for (i = 0; i < 3; i++) {
+    x = (pt[i] - gridmin[i]) * gridscale[i];
+    if (!(x >= 0.0)) { // Also if x is NaN.
+      j = 0;
+    } else if (x >= (REAL) gridsize[i]) {
+      j = gridsize[i] - 1;
+    } else {
+      j = (int) x;
+    }
+    c += j * stride;
+    stride *= gridsize[i];
   }
-  strcat(vtkfilename, ".vtk");
 
-  if (!b->quiet) {
-    printf("Writing %s.\n", vtkfilename);
+  return c;
+}
+
+int tetgenlocator::locate(REAL *searchpt)
+{
+  unsigned long seed = 1l;
+  int c, t;
+
+  if (gridtets == (int *) NULL) {
+    return -1;
   }
-  outfile = fopen(vtkfilename, "w");
-  if (outfile == (FILE *) NULL) {
-    printf("File I/O Error:  Cannot create file %s.\n", vtkfilename);
-    return;
+
+  c = cellindex(searchpt);
+  t = walk(searchpt, gridtets[c], &seed);
+  if ((t == -2) || ((t == -1) && nonconvex)) {
+    t = search(searchpt, c);
   }
 
-  //always write big endian
-  //bool ImALittleEndian = !testIsBigEndian();
+  return (t < 0) ? -1 : t + mesh->firstnumber;
+}
 
-  fprintf(outfile, "# vtk DataFile Version 2.0\n");
-  fprintf(outfile, "Unstructured Grid\n");
-  fprintf(outfile, "ASCII\n"); // BINARY
-  fprintf(outfile, "DATASET UNSTRUCTURED_GRID\n");
-  fprintf(outfile, "POINTS %d double\n", NN);
+void tetgenlocator::locate_many(int numberofpoints, REAL *searchptlist,
+                                int *tetlist)
+{
+  int *pointcells, *cellcount, *order;
+  int numberofcells;
+  int c, i;
 
-  points->traversalinit();
-  pointloop = pointtraverse();
-  for(int id=0; id<NN && pointloop != (point) NULL; id++){
-    x = pointloop[0];
-    y = pointloop[1];
-    z = pointloop[2];
-    fprintf(outfile, "%.17g %.17g %.17g\n", x, y, z);
-    pointloop = pointtraverse();
+  if (gridtets == (int *) NULL) {
+    for (i = 0; i < numberofpoints; i++) {
+      tetlist[i] = -1;
+    }
+    return;
   }
-  fprintf(outfile, "\n");
 
-  fprintf(outfile, "CELLS %d %d\n", NEL, NEL*(4+1));
-  //NEL rows, each has 1 type id + 4 node id's
- 
-  tetrahedrons->traversalinit();
-  tptr = tetrahedrontraverse();
-  //elementnumber = firstindex; // in->firstnumber;
-  while (tptr != (tetrahedron *) NULL) {
-    if (!b->reversetetori) {
-      p1 = (point) tptr[4];
-      p2 = (point) tptr[5];
-    } else {
-      p1 = (point) tptr[5];
-      p2 = (point) tptr[4];
+  numberofcells = gridsize[0] * gridsize[1] * gridsize[2];
+  if (numberofpoints < numberofcells / 4) {
+    // A few points.  Locate them in the given order.
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for (i = 0; i < numberofpoints; i++) {
+      tetlist[i] = locate(&(searchptlist[3 * i]));
     }
-    p3 = (point) tptr[6];
-    p4 = (point) tptr[7];
-    n1 = pointmark(p1) - in->firstnumber;
-    n2 = pointmark(p2) - in->firstnumber;
-    n3 = pointmark(p3) - in->firstnumber;
-    n4 = pointmark(p4) - in->firstnumber;
-    fprintf(outfile, "%d  %4d %4d %4d %4d\n", nnodes, n1, n2, n3, n4);
-    tptr = tetrahedrontraverse();
+    return;
   }
-  fprintf(outfile, "\n");
 
-  fprintf(outfile, "CELL_TYPES %d\n", NEL);
-  for(int tid=0; tid<NEL; tid++){
-    fprintf(outfile, "%d\n", celltype);
+  // Sort the points by their cells (a counting sort), so that consecutive
+  //   walks visit nearby tetrahedra, which are likely in the cache.
+  pointcells = new int[numberofpoints];
+  order = new int[numberofpoints];
+  cellcount = new int[numberofcells + 1];
+  for (c = 0; c <= numberofcells; c++) {
+    cellcount[c] = 0;
+  }
+  for (i = 0; i < numberofpoints; i++) {
+    pointcells[i] = cellindex(&(searchptlist[3 * i]));
+    cellcount[pointcells[i] + 1]++;
+  }
+  for (c = 0; c < numberofcells; c++) {
+    cellcount[c + 1] += cellcount[c];
+  }
+  for (i = 0; i < numberofpoints; i++) {
+    order[cellcount[pointcells[i]]++] = i;
   }
-  fprintf(outfile, "\n");
 
-  if (numelemattrib > 0) {
-    // Output tetrahedra region attributes.
-    fprintf(outfile, "CELL_DATA %d\n", NEL);
-    fprintf(outfile, "SCALARS cell_scalars int 1\n");
-    fprintf(outfile, "LOOKUP_TABLE default\n");
-    tetrahedrons->traversalinit();
-    tptr = tetrahedrontraverse();
-    while (tptr != (tetrahedron *) NULL) {
-      fprintf(outfile, "%d\n", (int) elemattribute(tptr, numelemattrib - 1));
-      tptr = tetrahedrontraverse();
-    }
-    fprintf(outfile, "\n");
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(static)
+#endif
+  for (i = 0; i < numberofpoints; i++) {
+    tetlist[order[i]] = locate(&(searchptlist[3 * order[i]]));
   }
 
-  fclose(outfile);
+  delete [] cellcount;
+  delete [] order;
+  delete [] pointcells;
 }
 
 ////                                                                       ////
 ////                                                                       ////
-//// output_cxx ///////////////////////////////////////////////////////////////
+//// locator_cxx //////////////////////////////////////////////////////////////
 
 //// main_cxx /////////////////////////////////////////////////////////////////
 ////                                                                       ////
@@ -31230,12 +34288,15 @@ void tetgenmesh::outmesh2vtk(char* ofilename)
 // - Write the output files and print the statistics.                        //
 // - Check the consistency of the mesh (-C).                                 //
 //                                                                           //
+// The work is done in the given (empty) mesh 'm'. If 'initpredicates' is 0, //
+// exactinit() has already been called by the caller (the batch mode).       //
+//                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-void tetrahedralize(tetgenbehavior *b, tetgenio *in, tetgenio *out,
-                    tetgenio *addin, tetgenio *bgmin)
+static void tetrahedralize(tetgenmesh &m, tetgenbehavior *b, tetgenio *in,
+                           tetgenio *out, tetgenio *addin, tetgenio *bgmin,
+                           int initpredicates)
 {
-  tetgenmesh m;
   clock_t tv[12], ts[5]; // Timing informations (defined in time.h)
   REAL cps = (REAL) CLOCKS_PER_SEC;
 
@@ -31244,6 +34305,7 @@ void tetrahedralize(tetgenbehavior *b, tetgenio *in, tetgenio *out,
   m.b = b;
   m.in = in;
   m.addin = addin;
+  m.markphase(tetgenio::PHASE_INIT);
 
   if (b->metric && bgmin && (bgmin->numberofpoints > 0)) {
     m.bgm = new tetgenmesh(); // Create an empty background mesh.
@@ -31254,10 +34316,13 @@ void tetrahedralize(tetgenbehavior *b, tetgenio *in, tetgenio *out,
   m.initializepools();
   m.transfernodes();
 
-  exactinit(b->verbose, b->noexact, b->nostaticfilter,
-            m.xmax - m.xmin, m.ymax - m.ymin, m.zmax - m.zmin);
+  if (initpredicates) {
+    exactinit(b->verbose, b->noexact, b->nostaticfilter,
+              m.xmax - m.xmin, m.ymax - m.ymin, m.zmax - m.zmin);
+  }
 
   tv[1] = clock();
+  m.markphase(tetgenio::PHASE_DELAUNAY);
 
   if (b->refine) { // -r
     m.reconstructmesh();
@@ -31266,6 +34331,7 @@ void tetrahedralize(tetgenbehavior *b, tetgenio *in, tetgenio *out,
   }
 
   tv[2] = clock();
+  m.markphase(tetgenio::PHASE_SURFACE);
 
   if (!b->quiet) {
     if (b->refine) {
@@ -31307,6 +34373,7 @@ void tetrahedralize(tetgenbehavior *b, tetgenio *in, tetgenio *out,
   }
 
   tv[3] = clock();
+  m.markphase(tetgenio::PHASE_BGMESH);
 
   if ((b->metric) && (m.bgm != NULL)) { // -m
     m.bgm->initializepools();
@@ -31332,6 +34399,7 @@ void tetrahedralize(tetgenbehavior *b, tetgenio *in, tetgenio *out,
   }
 
   tv[4] = clock();
+  m.markphase(tetgenio::PHASE_BOUNDARY);
 
   if (b->plc && !b->refine) { // -p
     if (b->nobisect) { // -Y
@@ -31378,12 +34446,14 @@ void tetrahedralize(tetgenbehavior *b, tetgenio *in, tetgenio *out,
   }
 
   tv[5] = clock();
+  m.markphase(tetgenio::PHASE_COARSEN);
 
   if (b->coarsen) { // -R
     m.meshcoarsening();
   }
 
   tv[6] = clock();
+  m.markphase(tetgenio::PHASE_DELRECOVER);
 
   if (!b->quiet) {
     if (b->coarsen) {
@@ -31396,6 +34466,7 @@ void tetrahedralize(tetgenbehavior *b, tetgenio *in, tetgenio *out,
   }
 
   tv[7] = clock();
+  m.markphase(tetgenio::PHASE_ADDPOINTS);
 
   if (!b->quiet) {
     if ((b->plc && b->nobisect) || b->coarsen) {
@@ -31410,6 +34481,7 @@ void tetrahedralize(tetgenbehavior *b, tetgenio *in, tetgenio *out,
   }
 
   tv[8] = clock();
+  m.markphase(tetgenio::PHASE_REFINE);
 
   if (!b->quiet) {
     if ((b->plc || b->refine) && b->insertaddpoints) { // -i
@@ -31424,6 +34496,7 @@ void tetrahedralize(tetgenbehavior *b, tetgenio *in, tetgenio *out,
   }
 
   tv[9] = clock();
+  m.markphase(tetgenio::PHASE_OPTIMIZE);
 
   if (!b->quiet) {
     if (b->quality) {
@@ -31436,6 +34509,7 @@ void tetrahedralize(tetgenbehavior *b, tetgenio *in, tetgenio *out,
   }
 
   tv[10] = clock();
+  m.markphase(tetgenio::PHASE_OUTPUT);
 
   if (!b->quiet) {
     if ((b->plc || b->refine) && (b->optlevel > 0)) {
@@ -31457,7 +34531,8 @@ void tetrahedralize(tetgenbehavior *b, tetgenio *in, tetgenio *out,
   }
 
   if (out != (tetgenio *) NULL) {
-    out->firstnumber = in->firstnumber;
+    // The indices in 'out' start from 0 if -z is used.
+    out->firstnumber = b->zeroindex ? 0 : in->firstnumber;
     out->mesh_dim = in->mesh_dim;
   }
 
@@ -31465,6 +34540,11 @@ void tetrahedralize(tetgenbehavior *b, tetgenio *in, tetgenio *out,
     if (!b->quiet) {
       printf("NOT writing a .node file.\n");
     }
+  } else if (b->binaryout && (out == (tetgenio *) NULL)) { // -U
+    tetgenio binout;
+    binout.firstnumber = b->zeroindex ? 0 : in->firstnumber;
+    m.outnodes(&binout);
+    binout.save_nodes_binary(b->outfilename);
   } else {
     m.outnodes(out);
   }
@@ -31476,7 +34556,14 @@ void tetrahedralize(tetgenbehavior *b, tetgenio *in, tetgenio *out,
     m.indexelements();
   } else {
     if (m.tetrahedrons->items > 0l) {
-      m.outelements(out);
+      if (b->binaryout && (out == (tetgenio *) NULL)) { // -U
+        tetgenio binout;
+        binout.firstnumber = b->zeroindex ? 0 : in->firstnumber;
+        m.outelements(&binout);
+        binout.save_elements_binary(b->outfilename);
+      } else {
+        m.outelements(out);
+      }
     }
   }
 
@@ -31538,15 +34625,43 @@ void tetrahedralize(tetgenbehavior *b, tetgenio *in, tetgenio *out,
   }
 
   if (b->neighout) {
-    m.outneighbors(out);
+    if (b->binaryout && (out == (tetgenio *) NULL)) { // -U
+      tetgenio binout;
+      binout.firstnumber = b->zeroindex ? 0 : in->firstnumber;
+      m.outneighbors(&binout);
+      binout.numberoftetrahedra = (int) (m.tetrahedrons->items - m.hullsize);
+      binout.save_neighbors_binary(b->outfilename);
+    } else {
+      m.outneighbors(out);
+    }
+  }
+
+  if (b->voidout) {
+    m.outvoids(out);
   }
 
   if (b->voroout) {
-    m.outvoronoi(out);
+    if (b->binaryout && (out == (tetgenio *) NULL)) { // -U
+      tetgenio binout;
+      binout.firstnumber = b->zeroindex ? 0 : in->firstnumber;
+      m.outvoronoi(&binout);
+      binout.save_voronoi_binary(b->outfilename);
+    } else {
+      m.outvoronoi(out);
+    }
+  }
+
+  if (b->powercellout) {
+    m.outpowercells(out);
+  }
+
+  if (b->alphaout) {
+    m.outalphashape(out);
   }
 
 
   tv[11] = clock();
+  m.markphase(tetgenio::NUMPHASES);
 
   if (!b->quiet) {
     printf("\nOutput seconds:  %g\n", ((REAL)(tv[11] - tv[10])) / cps);
@@ -31560,17 +34675,248 @@ void tetrahedralize(tetgenbehavior *b, tetgenio *in, tetgenio *out,
       m.checksegments();
     }
     if (b->docheck > 1) {
-      m.checkdelaunay();
+      if (b->weighted) {
+        m.checkregular(3, out);
+      } else {
+        m.checkdelaunay(1, out);
+      }
     }
   }
 
   if (!b->quiet) {
     m.statistics();
   }
+
+  if (b->statsout) { // -j
+    m.outstatistics(out);
+  }
+}
+
+void tetrahedralize(tetgenbehavior *b, tetgenio *in, tetgenio *out,
+                    tetgenio *addin, tetgenio *bgmin)
+{
+  tetgenmesh m;
+
+  tetrahedralize(m, b, in, out, addin, bgmin, 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// tetrahedralizebatch()    Tetrahedralize a list of independent inputs.     //
+//                                                                           //
+// 'blist', 'inlist', and 'outlist' are arrays of 'numberofjobs' behaviors,  //
+// inputs, and outputs. Every job needs its own behavior, since the output   //
+// file name and some flip parameters are changed during meshing. 'outlist', //
+// or any of its entries, can be NULL. The output of a job is then saved to  //
+// files. Additional points (-i) and background meshes (-m) are not used.    //
+//                                                                           //
+// The jobs are distributed dynamically over 'numberofthreads' threads (all  //
+// available threads if it is 0). Each thread owns one mesh, whose pools are //
+// recycled from job to job instead of being freed.  exactinit() is called   //
+// once with the largest bounding box of all inputs. Its static filters are  //
+// hence valid (only less tight) for every job. All jobs must use the same   //
+// -X switch as the first one.                                               //
+//                                                                           //
+// Return the number of failed jobs. If 'codelist' is not NULL, it receives  //
+// the exit code of each job (0 if it succeeded).  If TetGen is not compiled //
+// as a library, a failed job terminates the program.                        //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+static int tetrahedralizejob(tetgenmesh &m, tetgenbehavior *b, tetgenio *in,
+                             tetgenio *out)
+{
+  int code = 0;
+
+#ifdef TETLIBRARY
+  try {
+    tetrahedralize(m, b, in, out, NULL, NULL, 0);
+  } catch (int x) {
+    code = x;
+  }
+#else
+  tetrahedralize(m, b, in, out, NULL, NULL, 0);
+#endif
+  m.recyclememory();
+
+  return code;
+}
+
+int tetrahedralizebatch(int numberofjobs, tetgenbehavior *blist,
+                        tetgenio **inlist, tetgenio **outlist,
+                        int numberofthreads, int *codelist)
+{
+  tetgenmesh m;
+  REAL bmin[3], bmax[3], range[3];
+  REAL *pt;
+  int failed, code;
+  int i, j, k;
+
+  if (numberofjobs <= 0) {
+    return 0;
+  }
+
+  // Find the largest bounding box of all inputs.
+  range[0] = range[1] = range[2] = 0.0;
+  for (i = 0; i < numberofjobs; i++) {
+    if (inlist[i]->numberofpoints <= 0) continue;
+    pt = inlist[i]->pointlist;
+    for (k = 0; k < 3; k++) {
+      bmin[k] = bmax[k] = pt[k];
+    }
+    for (j = 1; j < inlist[i]->numberofpoints; j++) {
+      pt = &(inlist[i]->pointlist[3 * j]);
+      for (k = 0; k < 3; k++) {
+        if (pt[k] < bmin[k]) bmin[k] = pt[k];
+        if (pt[k] > bmax[k]) bmax[k] = pt[k];
+      }
+    }
+    for (k = 0; k < 3; k++) {
+      if (bmax[k] - bmin[k] > range[k]) range[k] = bmax[k] - bmin[k];
+    }
+  }
+
+  exactinit(blist[0].verbose, blist[0].noexact, blist[0].nostaticfilter,
+            range[0], range[1], range[2]);
+  // Fill in the shared tables before the threads start.
+  m.inittables();
+
+  failed = 0;
+
+#ifdef _OPENMP
+  if (numberofthreads <= 0) {
+    numberofthreads = omp_get_max_threads();
+  }
+  #pragma omp parallel num_threads(numberofthreads) private(i, code) \
+                       reduction(+:failed)
+  {
+    tetgenmesh jm;
+    #pragma omp for schedule(dynamic, 1)
+    for (i = 0; i < numberofjobs; i++) {
+      code = tetrahedralizejob(jm, &(blist[i]), inlist[i],
+                               outlist != NULL ? outlist[i] : NULL);
+      if (codelist != NULL) codelist[i] = code;
+      if (code != 0) failed++;
+    }
+  }
+#else
+  for (i = 0; i < numberofjobs; i++) {
+    code = tetrahedralizejob(m, &(blist[i]), inlist[i],
+                             outlist != NULL ? outlist[i] : NULL);
+    if (codelist != NULL) codelist[i] = code;
+    if (code != 0) failed++;
+  }
+#endif
+
+  return failed;
+}
+
+#ifdef TETLIBRARY
+
+int tetrahedralizebatch(char *switches, int numberofjobs, tetgenio **inlist,
+                        tetgenio **outlist, int numberofthreads, int *codelist)
+{
+  tetgenbehavior *blist;
+  int failed;
+  int i;
+
+  if (numberofjobs <= 0) {
+    return 0;
+  }
+
+  blist = new tetgenbehavior[numberofjobs];
+  if (!blist[0].parse_commandline(switches)) {
+    delete [] blist;
+    terminatetetgen(NULL, 10);
+  }
+  for (i = 1; i < numberofjobs; i++) {
+    blist[i] = blist[0];
+  }
+
+  failed = tetrahedralizebatch(numberofjobs, blist, inlist, outlist,
+                               numberofthreads, codelist);
+
+  delete [] blist;
+  return failed;
 }
 
+#endif // #ifdef TETLIBRARY
+
 #ifndef TETLIBRARY
 
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// batchmain()    The command line interface of the batch mode (-t).         //
+//                                                                           //
+// Every argument which is not a switch is an input file.  For each of them, //
+// the switches are parsed again (together with this file only), such that   //
+// the object type and the output file names are set up as in a single run.  //
+// All inputs are read first, then tetrahedralizebatch() meshes them.        //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+static int batchmain(int argc, char *argv[], tetgenbehavior *b)
+{
+  tetgenbehavior *blist;
+  tetgenio *inlist, **inptrlist;
+  char **jobargv;
+  int numberofjobs, jobargc;
+  int i, j, k;
+
+  if (b->insertaddpoints) { // -i
+    printf("Error:  The -i switch can not be used in batch mode (-t).\n");
+    terminatetetgen(NULL, 10);
+  }
+
+  numberofjobs = 0;
+  for (i = 1; i < argc; i++) {
+    if (argv[i][0] != '-') numberofjobs++;
+  }
+
+  blist = new tetgenbehavior[numberofjobs];
+  inlist = new tetgenio[numberofjobs];
+  inptrlist = new tetgenio*[numberofjobs];
+  jobargv = new char*[argc];
+
+  k = 0;
+  for (i = 1; i < argc; i++) {
+    if (argv[i][0] == '-') continue;
+    // The command line of this job: all switches and the i-th file.
+    jobargc = 0;
+    jobargv[jobargc++] = argv[0];
+    for (j = 1; j < argc; j++) {
+      if ((argv[j][0] == '-') || (j == i)) {
+        jobargv[jobargc++] = argv[j];
+      }
+    }
+    if (!blist[k].parse_commandline(jobargc, jobargv)) {
+      terminatetetgen(NULL, 10);
+    }
+    // Read input files.
+    if (blist[k].refine) { // -r
+      if (!inlist[k].load_tetmesh(blist[k].infilename,
+                                  (int) blist[k].object)) {
+        terminatetetgen(NULL, 10);
+      }
+    } else { // -p
+      if (!inlist[k].load_plc(blist[k].infilename, (int) blist[k].object)) {
+        terminatetetgen(NULL, 10);
+      }
+    }
+    inptrlist[k] = &(inlist[k]);
+    k++;
+  }
+
+  tetrahedralizebatch(numberofjobs, blist, inptrlist, NULL, b->batchthreads);
+
+  delete [] jobargv;
+  delete [] inptrlist;
+  delete [] inlist;
+  delete [] blist;
+
+  return 0;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
 // main()    The command line interface of TetGen.                           //
@@ -31603,6 +34949,10 @@ void tetrahedralize(char *switches, tetgenio *in, tetgenio *out,
     terminatetetgen(NULL, 10);
   }
 
+  if (b.batch) { // -t
+    return batchmain(argc, argv, &b);
+  }
+
   // Read input files.
   if (b.refine) { // -r
     if (!in.load_tetmesh(b.infilename, (int) b.object)) {
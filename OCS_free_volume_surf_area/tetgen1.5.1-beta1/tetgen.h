@@ -39,6 +39,12 @@
 
 #define INPUTLINESIZE 2048
 
+// Number of 64-bit integers in the header of a binary mesh file (-U), and
+//   the number of items written or read at once (a chunk).
+
+#define BINHEADERSIZE 16
+#define BINCHUNKSIZE 65536
+
 // TetGen only uses the C standard library.
 
 #include <stdio.h>
@@ -47,6 +53,10 @@
 #include <math.h>
 #include <time.h>
 
+#ifdef _OPENMP
+#include <omp.h>     // Only used for the threads of tetrahedralizebatch().
+#endif
+
 // The types 'intptr_t' and 'uintptr_t' are signed and unsigned integer types,
 //   respectively. They are guaranteed to be the same width as a pointer.
 //   They are defined in <stdint.h> by the C99 Standard. However, Microsoft 
@@ -215,10 +225,17 @@ public:
   // 'neighborlist':  An array of tetrahedron neighbors; 4 ints per element. 
   // 'tet2facelist':  An array of tetrahedron face indices; 4 ints per element.
   // 'tet2edgelist':  An array of tetrahedron edge indices; 6 ints per element.
+  // 'neighboroffsetlist', 'neighboradjlist':  The adjacency graph of the 
+  //   tetrahedra in compressed sparse row (CSR) form.  The neighbors of the
+  //   i-th tetrahedron are 'neighboradjlist[neighboroffsetlist[i]]', ...,
+  //   'neighboradjlist[neighboroffsetlist[i + 1] - 1]'. Hull faces are not
+  //   listed. 'neighboroffsetlist' has 'numberoftetrahedra + 1' ints. 
   int  *tetrahedronlist;
   REAL *tetrahedronattributelist;
   REAL *tetrahedronvolumelist;
   int  *neighborlist;
+  int  *neighboroffsetlist;
+  int  *neighboradjlist;
   int  *tet2facelist;
   int  *tet2edgelist;
   int numberoftetrahedra;
@@ -313,6 +330,85 @@ public:
   int numberofvfacets;
   int numberofvcells;
 
+  // 'tet2voidlist':  An array of void indices; one int per tetrahedron.  It
+  //   is -1 if the tetrahedron is not free, i.e., it can not hold a probe 
+  //   sphere (see the -u switch).
+  // 'voidvolumelist':  An array of free volumes of voids; one REAL per void.
+  // 'voidsizelist':  An array of the numbers of tetrahedra in voids.
+  // 'voidflaglist':  An array of percolation flags; one int per void. Bit d
+  //   (d = 0, 1, 2) is set if the void reaches the hull at both the lower
+  //   and upper sides of the d-th coordinate axis.
+  int  *tet2voidlist;
+  REAL *voidvolumelist;
+  int  *voidsizelist;
+  int  *voidflaglist;
+  int numberofvoids;
+
+  // 'pcellvolumelist':  An array of power (Voronoi, if no -w) cell volumes;
+  //   one REAL per point.  It is -1 if the cell is unbounded (the point is
+  //   on the convex hull), and 0 if the point is not a mesh vertex.
+  // 'pcelloffsetlist', 'pcellneighborlist', 'pcellarealist':  The faces of
+  //   the power cells in CSR form (see the -W switch).  The neighbors of the
+  //   i-th point are 'pcellneighborlist[pcelloffsetlist[i]]', ..., 
+  //   'pcellneighborlist[pcelloffsetlist[i + 1] - 1]'.  The areas of their
+  //   common faces are in 'pcellarealist', -1 if a face is unbounded.
+  REAL *pcellvolumelist;
+  int  *pcelloffsetlist;
+  int  *pcellneighborlist;
+  REAL *pcellarealist;
+  int numberofpcells;
+
+  // 'alphatetlist':  The filtration values of tetrahedra; one REAL per tet.
+  //   A simplex is in the pore space for a probe radius alpha if its value
+  //   is not smaller than alpha, otherwise it is in the (weighted) alpha
+  //   complex of the solid (see the -K switch).
+  // 'alphafacelist':  The values of faces; four REALs per tet.  The i-th 
+  //   one is for the face opposite to the i-th corner of the tet.
+  // 'alphaedgelist', 'alphaedgevaluelist':  The endpoints (two ints) and
+  //   the values (one REAL) of all edges.
+  REAL *alphatetlist;
+  REAL *alphafacelist;
+  int  *alphaedgelist;
+  REAL *alphaedgevaluelist;
+  int numberofalphaedges;
+
+  // 'alphalist':  The probe radii of an alpha sweep; one REAL per alpha.
+  // 'poreoffsetlist':  The pores found for the k-th alpha are numbered from
+  //   'poreoffsetlist[k]' to 'poreoffsetlist[k + 1] - 1'.
+  // 'porearealist', 'porevolumelist':  The surface areas and the enclosed
+  //   volumes of pores; one REAL per pore.
+  // 'poretrioffsetlist', 'poretrianglelist':  The pore-solid interface of 
+  //   the i-th pore are the triangles 'poretrioffsetlist[i]', ..., 
+  //   'poretrioffsetlist[i + 1] - 1'; three ints per triangle.  They are
+  //   oriented with normals pointing out of the pore.
+  REAL *alphalist;
+  int  *poreoffsetlist;
+  REAL *porearealist;
+  REAL *porevolumelist;
+  int  *poretrioffsetlist;
+  int  *poretrianglelist;
+  int numberofalphas;
+  int numberofpores;
+  int numberofporetriangles;
+
+  // 'phasetimelist':  The wall-clock seconds of the phases of a run of
+  //   tetrahedralize(); one REAL per phase (indexed by 'statphase').
+  // 'phasememorylist':  The peak memory (in bytes) of the mesh data 
+  //   structures at the end of each phase.
+  // 'statcountlist':  The counters of the run (indexed by 'statcounter'),
+  //   i.e., point location walks, calls and exact fallbacks of the filtered
+  //   predicates, and flips.  All three lists are filled by the -j switch.
+  REAL *phasetimelist;
+  REAL *phasememorylist;
+  long *statcountlist;
+
+  // 'nonregularfacelist':  The interior faces which are not locally Delaunay
+  //   (or regular if -w is used), found by the mesh check of -CC.  Five ints
+  //   per face: its three vertices and the opposite vertices of the two
+  //   tetrahedra sharing it.  Faces on subfaces (constrained) are not listed.
+  int  *nonregularfacelist;
+  int numberofnonregularfaces;
+
 
   // Variable (and callback functions) for meshing PSCs.
   void *geomhandle;
@@ -325,6 +421,32 @@ public:
   // A callback function.
   TetSizeFunc tetunsuitable;
 
+  // The binary mesh files (-U) start with a header of BINHEADERSIZE 64-bit
+  //   little-endian integers. The first one holds the magic string "TetGenB".
+  //   The others are indexed by 'binaryfield'. The header is followed by up
+  //   to four arrays (see save_nodes_binary() for what they hold), each one
+  //   starts at the 8-byte aligned byte offset given in the header.
+  enum binaryfield {BIN_VERSION = 1, BIN_FILETYPE, BIN_ITEMS, BIN_ITEMSIZE,
+                    BIN_ATTRIBS, BIN_MARKERS, BIN_FIRSTNUMBER, BIN_REALSIZE,
+                    BIN_LISTSIZE, BIN_CHUNKSIZE, BIN_OFFSET};
+  enum binaryfiletype {BIN_NODE = 1, BIN_ELE, BIN_NEIGH, BIN_VNODE, BIN_VEDGE,
+                       BIN_VFACE, BIN_VCELL, BIN_PCELL};
+
+  // The phases and the counters of a run (-j).  Their names (used in the
+  //   .json file) are in 'statphasenames' and 'statcounternames'.
+  enum statphase {PHASE_INIT, PHASE_DELAUNAY, PHASE_SURFACE, PHASE_BGMESH,
+                  PHASE_BOUNDARY, PHASE_COARSEN, PHASE_DELRECOVER,
+                  PHASE_ADDPOINTS, PHASE_REFINE, PHASE_OPTIMIZE, PHASE_OUTPUT,
+                  NUMPHASES};
+  enum statcounter {STAT_LOCATE, STAT_WALKSTEPS, STAT_MAXWALK, STAT_ORIENT3D,
+                    STAT_ORIENT3DEXACT, STAT_INSPHERE, STAT_INSPHEREEXACT,
+                    STAT_ORIENT4D, STAT_ORIENT4DEXACT, STAT_FLIP14,
+                    STAT_FLIP26, STAT_FLIPN2N, STAT_FLIP23, STAT_FLIP32,
+                    STAT_FLIP44, STAT_FLIP41, STAT_FLIP31, STAT_FLIP22,
+                    STAT_NONREGULAR, NUMSTATCOUNTERS};
+  static const char *statphasenames[NUMPHASES];
+  static const char *statcounternames[NUMSTATCOUNTERS];
+
   // Input & output routines.
   bool load_node_call(FILE* infile, int markers, int uvflag, char*);
   bool load_node(char*);
@@ -350,6 +472,20 @@ public:
   void save_neighbors(char*);
   void save_poly(char*);
   void save_faces2smesh(char*);
+  void save_statistics(char*);
+
+  // Binary input & output routines (-U).
+  void write_binary_header(FILE*, long long* header);
+  bool read_binary_header(FILE*, long long* header, int filetype, char*);
+  void write_binary_array(FILE*, void* data, int size, long long count);
+  bool read_binary_array(FILE*, void* data, int size, long long count);
+  bool load_node_binary(FILE*, long long* header, char*);
+  bool load_tet_binary(FILE*, long long* header, char*);
+  void save_nodes_binary(char*);
+  void save_elements_binary(char*);
+  void save_neighbors_binary(char*);
+  void save_voronoi_binary(char*);
+  void save_powercells_binary(char*);
 
   // Read line and parse string functions.
   char *readline(char* string, FILE* infile, int *linenumber);
@@ -357,6 +493,12 @@ public:
   char *readnumberline(char* string, FILE* infile, char* infilename);
   char *findnextnumber(char* string);
 
+  // The number of bytes of an array in a binary file (-U), it is padded to
+  //   a multiple of 8 bytes.
+  static long long binarybytes(int size, long long count) {
+    return ((size * count + 7) / 8) * 8;
+  }
+
   static void init(polygon* p) {
     p->vertexlist = (int *) NULL;
     p->numberofvertices = 0;
@@ -390,6 +532,8 @@ public:
     tetrahedronattributelist = (REAL *) NULL;
     tetrahedronvolumelist = (REAL *) NULL;
     neighborlist = (int *) NULL;
+    neighboroffsetlist = (int *) NULL;
+    neighboradjlist = (int *) NULL;
 	tet2facelist = (int *) NULL;
 	tet2edgelist = (int *) NULL;
     numberoftetrahedra = 0;
@@ -434,6 +578,41 @@ public:
     numberofvfacets = 0;
     numberofvcells = 0;
 
+    tet2voidlist = (int *) NULL;
+    voidvolumelist = (REAL *) NULL;
+    voidsizelist = (int *) NULL;
+    voidflaglist = (int *) NULL;
+    numberofvoids = 0;
+
+    pcellvolumelist = (REAL *) NULL;
+    pcelloffsetlist = (int *) NULL;
+    pcellneighborlist = (int *) NULL;
+    pcellarealist = (REAL *) NULL;
+    numberofpcells = 0;
+
+    alphatetlist = (REAL *) NULL;
+    alphafacelist = (REAL *) NULL;
+    alphaedgelist = (int *) NULL;
+    alphaedgevaluelist = (REAL *) NULL;
+    numberofalphaedges = 0;
+
+    alphalist = (REAL *) NULL;
+    poreoffsetlist = (int *) NULL;
+    porearealist = (REAL *) NULL;
+    porevolumelist = (REAL *) NULL;
+    poretrioffsetlist = (int *) NULL;
+    poretrianglelist = (int *) NULL;
+    numberofalphas = 0;
+    numberofpores = 0;
+    numberofporetriangles = 0;
+
+    phasetimelist = (REAL *) NULL;
+    phasememorylist = (REAL *) NULL;
+    statcountlist = (long *) NULL;
+
+    nonregularfacelist = (int *) NULL;
+    numberofnonregularfaces = 0;
+
 
     tetunsuitable = NULL;
 
@@ -482,6 +661,12 @@ public:
     if (neighborlist != (int *) NULL) {
       delete [] neighborlist;
     }
+    if (neighboroffsetlist != (int *) NULL) {
+      delete [] neighboroffsetlist;
+    }
+    if (neighboradjlist != (int *) NULL) {
+      delete [] neighboradjlist;
+    }
     if (tet2facelist != (int *) NULL) {
 	  delete [] tet2facelist;
 	}
@@ -568,6 +753,72 @@ public:
       }
       delete [] vcelllist;
     }
+    if (tet2voidlist != (int *) NULL) {
+      delete [] tet2voidlist;
+    }
+    if (voidvolumelist != (REAL *) NULL) {
+      delete [] voidvolumelist;
+    }
+    if (voidsizelist != (int *) NULL) {
+      delete [] voidsizelist;
+    }
+    if (voidflaglist != (int *) NULL) {
+      delete [] voidflaglist;
+    }
+    if (pcellvolumelist != (REAL *) NULL) {
+      delete [] pcellvolumelist;
+    }
+    if (pcelloffsetlist != (int *) NULL) {
+      delete [] pcelloffsetlist;
+    }
+    if (pcellneighborlist != (int *) NULL) {
+      delete [] pcellneighborlist;
+    }
+    if (pcellarealist != (REAL *) NULL) {
+      delete [] pcellarealist;
+    }
+    if (alphatetlist != (REAL *) NULL) {
+      delete [] alphatetlist;
+    }
+    if (alphafacelist != (REAL *) NULL) {
+      delete [] alphafacelist;
+    }
+    if (alphaedgelist != (int *) NULL) {
+      delete [] alphaedgelist;
+    }
+    if (alphaedgevaluelist != (REAL *) NULL) {
+      delete [] alphaedgevaluelist;
+    }
+    if (alphalist != (REAL *) NULL) {
+      delete [] alphalist;
+    }
+    if (poreoffsetlist != (int *) NULL) {
+      delete [] poreoffsetlist;
+    }
+    if (porearealist != (REAL *) NULL) {
+      delete [] porearealist;
+    }
+    if (porevolumelist != (REAL *) NULL) {
+      delete [] porevolumelist;
+    }
+    if (poretrioffsetlist != (int *) NULL) {
+      delete [] poretrioffsetlist;
+    }
+    if (poretrianglelist != (int *) NULL) {
+      delete [] poretrianglelist;
+    }
+    if (phasetimelist != (REAL *) NULL) {
+      delete [] phasetimelist;
+    }
+    if (phasememorylist != (REAL *) NULL) {
+      delete [] phasememorylist;
+    }
+    if (statcountlist != (long *) NULL) {
+      delete [] statcountlist;
+    }
+    if (nonregularfacelist != (int *) NULL) {
+      delete [] nonregularfacelist;
+    }
   }
 
   // Constructor & destructor.
@@ -625,8 +876,14 @@ public:
   int edgesout;                                                    // '-e', 0.
   int neighout;                                                    // '-n', 0.
   int voroout;                                                     // '-v', 0.
+  int voidout;                                                     // '-u', 0.
+  int binaryout;                                                   // '-U', 0.
+  int powercellout;                                                // '-W', 0.
+  int alphaout;                                                    // '-K', 0.
   int meditview;                                                   // '-g', 0.
   int vtkview;                                                     // '-k', 0.
+  int statsout;                                                    // '-j', 0.
+  int batch;                                                       // '-t', 0.
   int nobound;                                                     // '-B', 0.
   int nonodewritten;                                               // '-N', 0.
   int noelewritten;                                                // '-E', 0.
@@ -672,6 +929,11 @@ public:
   REAL optminslidihed;                                               // 179.0.  
   REAL epsilon;                                               // '-T', 1.0e-8.
   REAL coarsen_percent;                                         // -R1/#, 1.0.
+  REAL proberadius;                                              // '-u', 0.0.
+  REAL alphamin;                                                 // '-K', 0.0.
+  REAL alphamax;                                                // '-K/', 0.0.
+  int alphasteps;                                                // '-K//', 0.
+  int batchthreads;                                                // '-t', 0.
 
   // Strings of command line arguments and input/output file names.
   char commandline[1024];
@@ -732,8 +994,14 @@ public:
     edgesout = 0;
     neighout = 0;
     voroout = 0;
+    voidout = 0;
+    binaryout = 0;
+    powercellout = 0;
+    alphaout = 0;
     meditview = 0;
     vtkview = 0;
+    statsout = 0;
+    batch = 0;
     nobound = 0;
     nonodewritten = 0;
     noelewritten = 0;
@@ -780,6 +1048,11 @@ public:
     optminslidihed = 179.00;
     epsilon = 1.0e-8;
     coarsen_percent = 1.0;
+    proberadius = 0.0;
+    alphamin = 0.0;
+    alphamax = 0.0;
+    alphasteps = 0;
+    batchthreads = 0;
     object = NODES;
 
     commandline[0] = '\0';
@@ -825,6 +1098,28 @@ REAL insphere(REAL *pa, REAL *pb, REAL *pc, REAL *pd, REAL *pe);
 REAL orient4d(REAL *pa, REAL *pb, REAL *pc, REAL *pd, REAL *pe,
               REAL ah, REAL bh, REAL ch, REAL dh, REAL eh);
 
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// Filtered predicates (predfilter.cxx)                                      //
+//                                                                           //
+// The same predicates, but their floating-point filters are compiled with   //
+// optimization. The adaptive routines are called only if the filters fail.  //
+// The batched versions evaluate a group of predicates sharing one point.    //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+void filterinit(int, int, REAL, REAL, REAL);
+void filterstatistics(long *calls, long *exacts);
+REAL orient3dfilter(REAL *pa, REAL *pb, REAL *pc, REAL *pd);
+REAL inspherefilter(REAL *pa, REAL *pb, REAL *pc, REAL *pd, REAL *pe);
+REAL orient4dfilter(REAL *pa, REAL *pb, REAL *pc, REAL *pd, REAL *pe,
+                    REAL ah, REAL bh, REAL ch, REAL dh, REAL eh);
+void orient3dbatch(int n, REAL **pts, REAL *pd, REAL *ori);
+REAL orient3drobust(REAL *pa, REAL *pb, REAL *pc, REAL *pd);
+void orient3drobustbatch(int n, REAL **pts, REAL *pd, REAL *ori);
+void inspherebatch(int n, REAL **pts, REAL *pe, REAL *det);
+void orient4dbatch(int n, REAL **pts, REAL *pe, REAL *det);
+
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
 // tetgenmesh                                                                //
@@ -1326,6 +1621,10 @@ public:
   //   tetrahedra (only used when -o2 switch is selected).
   point *highordertable;
 
+  // Memorypools saved by recyclememory(), their blocks are reused by the
+  //   next call of initializepools() (see tetrahedralizebatch()).
+  memorypool *sparepoints, *sparetetrahedrons, *spareflippool;
+
   // Various variables.
   int numpointattrib;                          // Number of point attributes.
   int numelemattrib;                     // Number of tetrahedron attributes.
@@ -1338,10 +1637,12 @@ public:
   int elemattribindex;          // Index to find attributes of a tetrahedron.
   int volumeboundindex;       // Index to find volume bound of a tetrahedron.
   int elemmarkerindex;              // Index to find marker of a tetrahedron.
+  int elemindexindex;        // Index to find output index of a tetrahedron.
   int shmarkindex;             // Index to find boundary marker of a subface.
   int areaboundindex;               // Index to find area bound of a subface.
   int checksubsegflag;   // Are there segments in the tetrahedralization yet?
   int checksubfaceflag;  // Are there subfaces in the tetrahedralization yet?
+  int compacttets;    // Are tets stored without segment and subface slots?
   int checkconstraints;  // Are there variant (node, seg, facet) constraints?
   int nonconvex;                               // Is current mesh non-convex?
   int autofliplinklevel;        // The increase of link levels, default is 1.
@@ -1371,8 +1672,14 @@ public:
   long flip14count, flip26count, flipn2ncount;
   long flip23count, flip32count, flip44count, flip41count;
   long flip31count, flip22count;
+  long ptloccount, ptlocsteps, ptlocmaxsteps;        // Point location walks.
   unsigned long totalworkmemory;      // Total memory used by working arrays.
 
+  // Instrumentation (-j).
+  REAL phasewalltime[tetgenio::NUMPHASES + 1];       // Wall clock at phases.
+  REAL phasememory[tetgenio::NUMPHASES + 1];        // Peak memory at phases.
+  long predcalls[3], predexacts[3];       // Predicate counters at the start.
+
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
@@ -1392,6 +1699,7 @@ public:
   static int ver2edge[12], edge2ver[6], epivot[12];
   static int sorgpivot [6], sdestpivot[6], sapexpivot[6];
   static int snextpivot[6];
+  static int tablesready;             // Set once the tables are filled in.
 
   void inittables();
 
@@ -2059,8 +2367,10 @@ public:
   int checkmesh(int topoflag);
   int checkshells();
   int checksegments();
-  int checkdelaunay(int perturb = 1);
-  int checkregular(int);
+  int checkregularfaces(int type, int *ndcount, arraypool *facelist);
+  void outnonregularfaces(arraypool *facelist, const char *name, tetgenio*);
+  int checkdelaunay(int perturb = 1, tetgenio *out = NULL);
+  int checkregular(int type, tetgenio *out = NULL);
   int checkconforming(int);
 
   //  Mesh statistics.
@@ -2069,6 +2379,11 @@ public:
   void memorystatistics();
   void statistics();
 
+  // Instrumentation (-j).
+  unsigned long memoryusage();
+  void markphase(int);
+  void outstatistics(tetgenio*);
+
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
 // Mesh output                                                               //
@@ -2089,6 +2404,23 @@ public:
   void outsubsegments(tetgenio*);
   void outneighbors(tetgenio*);
   void outvoronoi(tetgenio*);
+
+  // Void clustering (-u).
+  REAL pointradius(point);
+  REAL tetfreeradius(point*, REAL* cent);
+  bool facefreeradius(point, point, point, REAL* radius);
+  REAL tetfreevolume(point*);
+  void outvoids(tetgenio*);
+
+  // Alpha filtration and pore surfaces (-K).
+  bool edgefreeradius(triface*, REAL* radius);
+  void outalphashape(tetgenio*);
+
+  // Power diagram (-W).
+  int powercell(point, REAL* orthocent, arraypool* tetlist,
+                arraypool* edgelist, REAL* areas, REAL* volume);
+  void outpowercells(tetgenio*);
+
   void outsmesh(char*);
   void outmesh2medit(char*);
   void outmesh2vtk(char*);
@@ -2129,6 +2461,8 @@ public:
 
     highordertable = NULL;
 
+    sparepoints = sparetetrahedrons = spareflippool = NULL;
+
     numpointattrib = numelemattrib = 0;
     sizeoftensor = 0;
     pointmtrindex = 0;
@@ -2138,10 +2472,12 @@ public:
     pointinsradiusindex = 0;
     elemattribindex = 0;
     volumeboundindex = 0;
+    elemindexindex = 0;
     shmarkindex = 0;
     areaboundindex = 0;
     checksubsegflag = 0;
     checksubfaceflag = 0;
+    compacttets = 0;
     checkconstraints = 0;
     nonconvex = 0;
     autofliplinklevel = 1;
@@ -2165,8 +2501,14 @@ public:
     flip14count = flip26count = flipn2ncount = 0l;
     flip23count = flip32count = flip44count = flip41count = 0l;
     flip22count = flip31count = 0l;
+    ptloccount = ptlocsteps = ptlocmaxsteps = 0l;
     totalworkmemory = 0l;
 
+    for (int i = 0; i <= tetgenio::NUMPHASES; i++) {
+      phasewalltime[i] = phasememory[i] = 0.0;
+    }
+    filterstatistics(predcalls, predexacts);
+
 
   } // tetgenmesh()
 
@@ -2249,9 +2591,40 @@ public:
       delete [] highordertable;
     }
 
+    if (sparepoints != NULL) {
+      delete sparepoints;
+    }
+    if (sparetetrahedrons != NULL) {
+      delete sparetetrahedrons;
+    }
+    if (spareflippool != NULL) {
+      delete spareflippool;
+    }
+
     initializetetgenmesh();
   }
 
+  // Free the mesh but keep the blocks of the main memorypools, such that a
+  //   following mesh can be created without going back to the allocator.
+  void recyclememory()
+  {
+    memorypool *savepoints = points, *savetets = tetrahedrons;
+    memorypool *saveflips = flippool;
+
+    if (points == (memorypool *) NULL) {
+      freememory();
+      return;
+    }
+    delete [] dummypoint;
+    points = tetrahedrons = flippool = NULL;
+    delete unflipqueue; // It was paired with flippool.
+    unflipqueue = NULL;
+    freememory();
+    sparepoints = savepoints;
+    sparetetrahedrons = savetets;
+    spareflippool = saveflips;
+  }
+
   tetgenmesh()
   {
     initializetetgenmesh();
@@ -2264,6 +2637,122 @@ public:
 
 };                                               // End of class tetgenmesh.
 
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// tetgenlocator                                                             //
+//                                                                           //
+// A point location structure over a finished tetrahedral mesh, i.e., the    //
+// output of tetrahedralize() or a mesh read by tetgenio::load_tetmesh().    //
+// It is built once, and then answers which tetrahedron contains a given     //
+// query point by a jump-and-walk:                                           //
+//   - jump: a uniform grid over the bounding box of the mesh (about one     //
+//     cell per tetrahedron) stores in each cell a tetrahedron near it;      //
+//   - walk: starting from the tetrahedron of the cell of the query point,   //
+//     cross the faces which separate the current tetrahedron from the       //
+//     point until it is found (the stochastic visibility walk, as in        //
+//     tetgenmesh::locate()).                                                //
+//                                                                           //
+// The face adjacencies are taken from the 'neighborlist' of the mesh (the   //
+// -n switch) if it is available, otherwise they are computed. The indices   //
+// of the mesh are counted from its 'firstnumber'.  The mesh must be kept    //
+// unchanged as long as the locator is used.                                 //
+//                                                                           //
+// After build(), the locator is only read. Hence locate() can be called by  //
+// many threads at the same time, and locate_many() runs in parallel if      //
+// TetGen is compiled with OpenMP.                                           //
+//                                                                           //
+// The orientation tests use orient3drobust(), whose signs are exact for any //
+// query point, inside the bounding box of the mesh or not.  The predicates  //
+// must have been initialized by exactinit() (tetrahedralize() does so), the //
+// locator does not change their options.                                    //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+class tetgenlocator {
+
+public:
+
+  // The mesh (it is not owned by the locator).
+  tetgenio *mesh;
+  int numberoftetrahedra;
+
+  // Four neighbors per tetrahedron, the i-th one is opposite to its i-th
+  //   corner (counted from 0, -1 if the face is on the boundary).
+  int *neighbors;
+
+  // The uniform grid. A cell (i, j, k) stores the index (from 0) of a
+  //   tetrahedron at 'gridtets[(k * gridsize[1] + j) * gridsize[0] + i]'.
+  int *gridtets;
+  int gridsize[3];
+  REAL gridmin[3], gridscale[3];
+
+  // The sign (1 or -1) of orient3d() of the tetrahedra.
+  REAL orientation;
+
+  // Is the boundary of the mesh not convex? If so, a walk which leaves the
+  //   mesh may have missed the point. It is then searched in the list of
+  //   tetrahedra whose bounding boxes overlap its cell, the lists of all
+  //   cells are stored in 'celltets' from index 'cellstart[c]' on.
+  int nonconvex;
+  int *cellstart, *celltets;
+
+  void build(tetgenio *tetmesh);
+  int locate(REAL *searchpt);
+  void locate_many(int numberofpoints, REAL *searchptlist, int *tetlist);
+
+  int cellindex(REAL *pt);
+  int walk(REAL *searchpt, int starttet, unsigned long *seed);
+  int search(REAL *searchpt, int cell);
+  void setneighbors();
+  void checkconvexity();
+  void setcelltets();
+
+  // The index (from 0) of the i-th corner of tetrahedron t, and its coords.
+  int cornerindex(int t, int i) {
+    return mesh->tetrahedronlist[t * mesh->numberofcorners + i] -
+           mesh->firstnumber;
+  }
+  REAL* corner(int t, int i) {
+    return &(mesh->pointlist[3 * cornerindex(t, i)]);
+  }
+
+  // Initialize routine.
+  void initialize()
+  {
+    mesh = (tetgenio *) NULL;
+    numberoftetrahedra = 0;
+    neighbors = (int *) NULL;
+    gridtets = (int *) NULL;
+    gridsize[0] = gridsize[1] = gridsize[2] = 0;
+    gridmin[0] = gridmin[1] = gridmin[2] = 0.0;
+    gridscale[0] = gridscale[1] = gridscale[2] = 0.0;
+    orientation = 1.0;
+    nonconvex = 0;
+    cellstart = celltets = (int *) NULL;
+  }
+
+  // Free the memory allocated by build().
+  void deinitialize()
+  {
+    if (neighbors != (int *) NULL) {
+      delete [] neighbors;
+    }
+    if (gridtets != (int *) NULL) {
+      delete [] gridtets;
+    }
+    if (cellstart != (int *) NULL) {
+      delete [] cellstart;
+      delete [] celltets;
+    }
+    initialize();
+  }
+
+  // Constructor & destructor.
+  tetgenlocator() {initialize();}
+  ~tetgenlocator() {deinitialize();}
+
+}; // class tetgenlocator
+
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
 // tetrahedralize()    Interface for using TetGen's library to generate      //
@@ -2287,6 +2776,30 @@ void tetrahedralize(char *switches, tetgenio *in, tetgenio *out,
                     tetgenio *addin = NULL, tetgenio *bgmin = NULL);
 #endif // #ifdef TETLIBRARY
 
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// tetrahedralizebatch()    Tetrahedralize many independent inputs (e.g., a  //
+//                          set of frames) concurrently in one process.      //
+//                                                                           //
+// 'inlist' and 'outlist' are arrays of 'numberofjobs' inputs and outputs.   //
+// 'blist' holds a behavior for each job, or the switches are given once by  //
+// the string 'switches'. The jobs run on 'numberofthreads' threads (0 means //
+// all available threads). Each thread reuses one mesh and its memorypools.  //
+// Return the number of failed jobs. The exit code of each job is stored in  //
+// 'codelist' if it is not a NULL.                                           //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+int tetrahedralizebatch(int numberofjobs, tetgenbehavior *blist,
+                        tetgenio **inlist, tetgenio **outlist,
+                        int numberofthreads = 0, int *codelist = NULL);
+
+#ifdef TETLIBRARY
+int tetrahedralizebatch(char *switches, int numberofjobs, tetgenio **inlist,
+                        tetgenio **outlist, int numberofthreads = 0,
+                        int *codelist = NULL);
+#endif // #ifdef TETLIBRARY
+
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
 // terminatetetgen()    Terminate TetGen with a given exit code.             //
@@ -2544,15 +3057,16 @@ inline void tetgenmesh::setvolumebound(tetrahedron* ptr, REAL value) {
 }
 
 // Get or set a tetrahedron's index (only used for output).
-//    These two routines use the reserved slot ptr[10].
+//    These two routines use the reserved slot ptr[elemindexindex], it is
+//    ptr[10], or ptr[8] if tets are compact (see initializepools()).
 
 inline int tetgenmesh::elemindex(tetrahedron* ptr) {
-  int *iptr = (int *) &(ptr[10]);
+  int *iptr = (int *) &(ptr[elemindexindex]);
   return iptr[0];
 }
 
 inline void tetgenmesh::setelemindex(tetrahedron* ptr, int value) {
-  int *iptr = (int *) &(ptr[10]);
+  int *iptr = (int *) &(ptr[elemindexindex]);
   iptr[0] = value;
 }
 
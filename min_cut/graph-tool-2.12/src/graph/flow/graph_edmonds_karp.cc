@@ -20,7 +20,7 @@
 #include "graph_properties.hh"
 #include "graph.hh"
 
-#include "graph_augment.hh"
+#include "graph_residual_network.hh"
 
 #include <boost/graph/edmonds_karp_max_flow.hpp>
 
@@ -37,38 +37,39 @@ struct get_edmonds_karp_max_flow
                     size_t max_e, size_t src, size_t sink, CapacityMap cm,
                     ResidualMap res) const
     {
-        typedef typename graph_traits<Graph>::edge_descriptor edge_t;
-        unchecked_vector_property_map<bool,EdgeIndex>
-            augmented(edge_index, max_e);
-        unchecked_vector_property_map<edge_t,EdgeIndex>
-            reverse_map(edge_index, max_e);
-        unchecked_vector_property_map<default_color_type,VertexIndex>
-            color(vertex_index, num_vertices(g));
-        unchecked_vector_property_map<edge_t,VertexIndex>
-            pred(vertex_index, num_vertices(g));
+        typedef typename property_traits<CapacityMap>::value_type cval_t;
+        typedef typename std::conditional<std::is_floating_point<cval_t>::value,
+                                          double, int64_t>::type val_t;
 
-        typedef typename std::remove_const<Graph>::type GT;
-        GT& u = const_cast<GT&>(g);
-        augment_graph(u,
-                      augmented.get_checked(),
-                      get_checked(cm),
-                      reverse_map.get_checked(),
-                      get_checked(res));
-
-        boost::edmonds_karp_max_flow(g, vertex(src, g), vertex(sink, g),
-                                     get_unchecked(cm),
-                                     get_unchecked(res),
-                                     reverse_map, color, pred);
+        ResidualNetwork<val_t> rn(g, vertex_index, edge_index, max_e);
+        rn.set_capacity(g, edge_index, cm);
+        solve(rn, vertex_index[vertex(src, g)], vertex_index[vertex(sink, g)]);
+        rn.get_residual(g, edge_index, res);
+    }
 
-        deaugment_graph(u, augmented.get_checked());
+    template <class Value>
+    static Value solve(ResidualNetwork<Value>& rn, size_t src, size_t sink)
+    {
+        vector<default_color_type> color(num_vertices(rn));
+        vector<size_t> pred(num_vertices(rn));
+        return boost::edmonds_karp_max_flow
+            (rn, src, sink, rn.get_capacity_map(), rn.get_residual_map(),
+             rn.get_reverse_map(),
+             make_iterator_property_map(color.begin(), identity_property_map()),
+             make_iterator_property_map(pred.begin(), identity_property_map()));
     }
 };
 
+double edmonds_karp_max_flow(ResidualNetwork<double>& rn, size_t src,
+                             size_t sink)
+{
+    return get_edmonds_karp_max_flow::solve(rn, src, sink);
+}
 
 void edmonds_karp_max_flow(GraphInterface& gi, size_t src, size_t sink,
                            boost::any capacity, boost::any res)
 {
-    run_action<graph_tool::detail::always_directed>()
+    run_action<graph_tool::detail::always_directed_frozen>()
         (gi, std::bind(get_edmonds_karp_max_flow(),
                        placeholders::_1, gi.get_vertex_index(), gi.get_edge_index(),
                        gi.get_edge_index_range(),
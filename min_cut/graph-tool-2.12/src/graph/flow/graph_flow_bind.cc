@@ -16,6 +16,7 @@
 // along with this program. If not, see <http://www.gnu.org/licenses/>.
 
 #include "graph.hh"
+#include "graph_flow_network.hh"
 
 using namespace graph_tool;
 using namespace boost;
@@ -26,10 +27,17 @@ void push_relabel_max_flow(GraphInterface& gi, size_t src, size_t sink,
                            boost::any capacity, boost::any res);
 void kolmogorov_max_flow(GraphInterface& gi, size_t src, size_t sink,
                          boost::any capacity, boost::any res);
+void parallel_push_relabel_max_flow(GraphInterface& gi, size_t src,
+                                    size_t sink, boost::any capacity,
+                                    boost::any res);
 bool max_cardinality_matching(GraphInterface& gi, boost::any match);
 double min_cut(GraphInterface& gi, boost::any weight, boost::any part_map);
 void get_residual_graph(GraphInterface& gi, boost::any capacity, boost::any res,
                         boost::any oaugment);
+boost::python::object min_st_cut(GraphInterface& gi,
+                                 boost::python::object osources,
+                                 boost::any capacity, boost::any res,
+                                 boost::any opart, boost::any oetype);
 
 #include <boost/python.hpp>
 using namespace boost::python;
@@ -39,7 +47,18 @@ BOOST_PYTHON_MODULE(libgraph_tool_flow)
     def("edmonds_karp_max_flow", &edmonds_karp_max_flow);
     def("push_relabel_max_flow", &push_relabel_max_flow);
     def("kolmogorov_max_flow", &kolmogorov_max_flow);
+    def("parallel_push_relabel_max_flow", &parallel_push_relabel_max_flow);
     def("max_cardinality_matching", &max_cardinality_matching);
     def("min_cut", &min_cut);
     def("residual_graph", &get_residual_graph);
+    def("min_st_cut", &min_st_cut);
+
+    class_<FlowNetwork, boost::noncopyable>("FlowNetwork",
+                                            init<GraphInterface&>())
+        .def("set_capacity", &FlowNetwork::set_capacity)
+        .def("scale_capacity", &FlowNetwork::scale_capacity)
+        .def("max_flow", &FlowNetwork::max_flow)
+        .def("get_residual", &FlowNetwork::get_residual)
+        .def("num_vertices", &FlowNetwork::num_vertices)
+        .def("num_arcs", &FlowNetwork::num_arcs);
 }
@@ -0,0 +1,188 @@
+// graph-tool -- a general graph modification and manipulation thingy
+//
+// Copyright (C) 2006-2015 Tiago de Paula Peixoto <tiago@skewed.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "graph_filtering.hh"
+#include "graph_selectors.hh"
+#include "graph_properties.hh"
+#include "graph.hh"
+
+#include "graph_flow_network.hh"
+#include "numpy_bind.hh"
+
+#include <boost/lexical_cast.hpp>
+
+using namespace graph_tool;
+using namespace boost;
+
+double push_relabel_max_flow(ResidualNetwork<double>& rn, size_t src,
+                             size_t sink);
+double kolmogorov_max_flow(ResidualNetwork<double>& rn, size_t src,
+                           size_t sink);
+double edmonds_karp_max_flow(ResidualNetwork<double>& rn, size_t src,
+                             size_t sink);
+
+struct build_residual_network
+{
+    template <class Graph, class VertexIndex, class EdgeIndex>
+    void operator()(Graph& g, VertexIndex vertex_index, EdgeIndex edge_index,
+                    size_t max_e, ResidualNetwork<double>& rn) const
+    {
+        rn.build(g, vertex_index, edge_index, max_e);
+    }
+};
+
+struct set_network_capacity
+{
+    template <class Graph, class EdgeIndex, class CapacityMap>
+    void operator()(Graph& g, EdgeIndex edge_index, CapacityMap cm,
+                    bool keep_flow, ResidualNetwork<double>& rn) const
+    {
+        rn.set_capacity(g, edge_index, cm, keep_flow);
+    }
+};
+
+struct get_network_residual
+{
+    template <class Graph, class EdgeIndex, class ResidualMap>
+    void operator()(Graph& g, EdgeIndex edge_index, ResidualMap res,
+                    ResidualNetwork<double>& rn) const
+    {
+        rn.get_residual(g, edge_index, res);
+    }
+};
+
+struct check_residual_network
+{
+    template <class Graph, class EdgeIndex>
+    void operator()(Graph& g, EdgeIndex edge_index,
+                    const ResidualNetwork<double>& rn, bool& valid) const
+    {
+        valid = rn.is_built_from(g, edge_index);
+    }
+};
+
+FlowNetwork::FlowNetwork(GraphInterface& gi)
+    : _N(gi.get_num_vertices(false)), _E(gi.get_num_edges(false)),
+      _max_e(gi.get_edge_index_range()),
+      _version(gi.get_graph().get_version())
+{
+    run_action<graph_tool::detail::always_directed_frozen>()
+        (gi, std::bind(build_residual_network(), placeholders::_1,
+                       gi.get_vertex_index(), gi.get_edge_index(), _max_e,
+                       std::ref(_rn)))();
+    _solver.reset(new ParallelPushRelabel<double>(_rn));
+}
+
+// the network can only be used with the graph, and the filters, it was built
+// from; otherwise, some edges would have no arcs
+void FlowNetwork::check_graph(GraphInterface& gi) const
+{
+    if (gi.get_num_vertices(false) != _N || gi.get_num_edges(false) != _E ||
+        gi.get_edge_index_range() != _max_e ||
+        gi.get_graph().get_version() != _version)
+        throw ValueException("The graph has been modified since the flow "
+                             "network was built.");
+
+    bool valid = false;
+    run_action<graph_tool::detail::always_directed_frozen>()
+        (gi, std::bind(check_residual_network(), placeholders::_1,
+                       gi.get_edge_index(), std::cref(_rn),
+                       std::ref(valid)))();
+    if (!valid)
+        throw ValueException("The graph filters have been modified since the "
+                             "flow network was built.");
+}
+
+void FlowNetwork::set_capacity(GraphInterface& gi, boost::any capacity,
+                               bool keep_flow)
+{
+    check_graph(gi);
+    run_action<graph_tool::detail::always_directed_frozen>()
+        (gi, std::bind(set_network_capacity(), placeholders::_1,
+                       gi.get_edge_index(), placeholders::_2, keep_flow,
+                       std::ref(_rn)),
+         edge_scalar_properties())(capacity);
+}
+
+void FlowNetwork::scale_capacity(double c)
+{
+    _rn.scale_capacity(c);
+}
+
+double FlowNetwork::max_flow(python::object osources, python::object otargets,
+                             string algorithm, bool incremental)
+{
+    multi_array_ref<int64_t,1> asources = get_array<int64_t,1>(osources);
+    multi_array_ref<int64_t,1> atargets = get_array<int64_t,1>(otargets);
+
+    vector<size_t> sources, targets;
+    vector<uint8_t> mark(_N, 0);
+    for (auto v : asources)
+    {
+        if (v < 0 || size_t(v) >= _N)
+            throw ValueException("Invalid source vertex: " +
+                                 lexical_cast<string>(v));
+        if (mark[v] == 0)
+            sources.push_back(v);
+        mark[v] = 1;
+    }
+    for (auto v : atargets)
+    {
+        if (v < 0 || size_t(v) >= _N)
+            throw ValueException("Invalid target vertex: " +
+                                 lexical_cast<string>(v));
+        if (mark[v] == 1)
+            throw ValueException("Vertex " + lexical_cast<string>(v) +
+                                 " is both a source and a target.");
+        if (mark[v] == 0)
+            targets.push_back(v);
+        mark[v] = 2;
+    }
+    if (sources.empty() || targets.empty())
+        throw ValueException("At least one source and one target vertex "
+                             "must be given.");
+
+    if (algorithm == "parallel_push_relabel")
+    {
+        if (!incremental || !_solver->is_preflow(sources))
+            _rn.reset();
+        return _solver->max_flow(sources, targets);
+    }
+
+    if (sources.size() > 1 || targets.size() > 1)
+        throw ValueException("Only the parallel_push_relabel algorithm "
+                             "accepts more than one source or target.");
+
+    _rn.reset();
+    if (algorithm == "push_relabel")
+        return push_relabel_max_flow(_rn, sources[0], targets[0]);
+    else if (algorithm == "boykov_kolmogorov")
+        return kolmogorov_max_flow(_rn, sources[0], targets[0]);
+    else if (algorithm == "edmonds_karp")
+        return edmonds_karp_max_flow(_rn, sources[0], targets[0]);
+    else
+        throw ValueException("Invalid max-flow algorithm: " + algorithm);
+}
+
+void FlowNetwork::get_residual(GraphInterface& gi, boost::any res)
+{
+    check_graph(gi);
+    run_action<graph_tool::detail::always_directed_frozen>()
+        (gi, std::bind(get_network_residual(), placeholders::_1,
+                       gi.get_edge_index(), placeholders::_2, std::ref(_rn)),
+         writable_edge_scalar_properties())(res);
+}
@@ -0,0 +1,81 @@
+// graph-tool -- a general graph modification and manipulation thingy
+//
+// Copyright (C) 2006-2015 Tiago de Paula Peixoto <tiago@skewed.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef GRAPH_FLOW_NETWORK_HH
+#define GRAPH_FLOW_NETWORK_HH
+
+#include <string>
+#include <memory>
+
+#include <boost/python.hpp>
+
+#include "graph.hh"
+#include "graph_residual_network.hh"
+#include "graph_parallel_push_relabel.hh"
+
+namespace graph_tool
+{
+using namespace std;
+using namespace boost;
+
+// Persistent residual network of a graph, which can be used for many maximum
+// flow computations, with different sources, targets and capacities, without
+// modifying (or copying) the graph each time. It must be rebuilt if the edges
+// of the graph, or its filters, are modified.
+
+class FlowNetwork
+{
+public:
+    FlowNetwork(GraphInterface& gi);
+
+    // sets the arc capacities from an edge property map, and either resets the
+    // flow to zero, or keeps it where it does not exceed the new capacities
+    void set_capacity(GraphInterface& gi, boost::any capacity, bool keep_flow);
+
+    // multiplies all capacities, and the current flow, by c
+    void scale_capacity(double c);
+
+    // computes the maximum flow from a set of sources to a set of targets
+    // (arrays of vertex indexes) with the given algorithm ("push_relabel",
+    // "parallel_push_relabel", "boykov_kolmogorov" or "edmonds_karp"), and
+    // returns its value. If incremental == true, the computation starts from
+    // the current flow, instead of zero, whenever it is possible (only with
+    // "parallel_push_relabel", which is also the only algorithm which accepts
+    // more than one source or target).
+    double max_flow(python::object osources, python::object otargets,
+                    string algorithm, bool incremental);
+
+    // copies the current residual capacities to an edge property map
+    void get_residual(GraphInterface& gi, boost::any res);
+
+    size_t num_vertices() const { return _rn.num_nodes(); }
+    size_t num_arcs() const { return _rn.num_arcs(); }
+
+private:
+    void check_graph(GraphInterface& gi) const;
+
+    ResidualNetwork<double> _rn;
+    std::unique_ptr<ParallelPushRelabel<double>> _solver;
+    size_t _N;
+    size_t _E;
+    size_t _max_e;
+    size_t _version;
+};
+
+} // graph_tool namespace
+
+#endif // GRAPH_FLOW_NETWORK_HH
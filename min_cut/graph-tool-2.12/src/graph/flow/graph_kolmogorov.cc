@@ -20,29 +20,7 @@
 #include "graph_properties.hh"
 #include "graph.hh"
 
-#include "graph_augment.hh"
-
-#include <boost/mpl/if.hpp>
-#include <boost/mpl/or.hpp>
-namespace std
-{
-using namespace boost;
-
-// we need a min() function with arguments of different types
-
-template <class T1, class T2>
-typename boost::mpl::if_<
-    typename boost::mpl::or_<typename std::is_floating_point<T1>::type,
-                             typename std::is_floating_point<T2>::type>::type,
-    double, int>::type
-min(const T1& v1, const T2& v2)
-{
-    if (v1 <= T1(v2))
-        return v1;
-    else
-        return v2;
-}
-}
+#include "graph_residual_network.hh"
 
 #include <boost/bind.hpp>
 
@@ -61,41 +39,45 @@ struct get_kolmogorov_max_flow
 {
     template <class Graph, class EdgeIndex, class VertexIndex,
               class CapacityMap, class ResidualMap>
-    void operator()(Graph& g, EdgeIndex edge_index, size_t,
+    void operator()(Graph& g, EdgeIndex edge_index, size_t max_e,
                     VertexIndex vertex_index, size_t src, size_t sink,
                     CapacityMap cm, ResidualMap res) const
     {
-        typedef typename graph_traits<Graph>::edge_descriptor edge_t;
-        checked_vector_property_map<uint8_t,EdgeIndex>
-            augmented(edge_index);
-        checked_vector_property_map<edge_t,EdgeIndex>
-            reverse_map(edge_index);
-        unchecked_vector_property_map<edge_t,VertexIndex>
-            pred_map(vertex_index, num_vertices(g));
-        unchecked_vector_property_map<size_t,VertexIndex>
-            color_map(vertex_index, num_vertices(g));
-        unchecked_vector_property_map<size_t,VertexIndex>
-            dist_map(vertex_index, num_vertices(g));
-
-        typedef typename std::remove_const<Graph>::type GT;
-        GT& u = const_cast<GT&>(g);
-
-        augment_graph(u, augmented, cm, reverse_map, res, true);
-
-        KOLMOGOROV_MAX_FLOW(g, cm, res, reverse_map, pred_map, color_map,
-                            dist_map, vertex_index, vertex(src, g),
-                            vertex(sink, g));
-
-        deaugment_graph(u, augmented);
+        typedef typename property_traits<CapacityMap>::value_type cval_t;
+        typedef typename std::conditional<std::is_floating_point<cval_t>::value,
+                                          double, int64_t>::type val_t;
+
+        ResidualNetwork<val_t> rn(g, vertex_index, edge_index, max_e);
+        rn.set_capacity(g, edge_index, cm);
+        solve(rn, vertex_index[vertex(src, g)], vertex_index[vertex(sink, g)]);
+        rn.get_residual(g, edge_index, res);
+    }
 
+    template <class Value>
+    static Value solve(ResidualNetwork<Value>& rn, size_t src, size_t sink)
+    {
+        size_t N = num_vertices(rn);
+        vector<size_t> pred(N), color(N), dist(N);
+        return KOLMOGOROV_MAX_FLOW
+            (rn, rn.get_capacity_map(), rn.get_residual_map(),
+             rn.get_reverse_map(),
+             make_iterator_property_map(pred.begin(), identity_property_map()),
+             make_iterator_property_map(color.begin(), identity_property_map()),
+             make_iterator_property_map(dist.begin(), identity_property_map()),
+             identity_property_map(), src, sink);
     }
 };
 
+double kolmogorov_max_flow(ResidualNetwork<double>& rn, size_t src,
+                           size_t sink)
+{
+    return get_kolmogorov_max_flow::solve(rn, src, sink);
+}
 
 void kolmogorov_max_flow(GraphInterface& gi, size_t src, size_t sink,
                          boost::any capacity, boost::any res)
 {
-    run_action<graph_tool::detail::always_directed, boost::mpl::true_>()
+    run_action<graph_tool::detail::always_directed_frozen, boost::mpl::true_>()
         (gi, std::bind(get_kolmogorov_max_flow(),
                        placeholders::_1, gi.get_edge_index(), gi.get_edge_index_range(),
                        gi.get_vertex_index(), src, sink,  placeholders::_2,
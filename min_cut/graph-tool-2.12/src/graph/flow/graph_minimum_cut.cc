@@ -20,7 +20,10 @@
 #include "graph_properties.hh"
 
 #include "graph_augment.hh"
+#include "numpy_bind.hh"
+
 #include <boost/graph/stoer_wagner_min_cut.hpp>
+#include <boost/python.hpp>
 
 using namespace std;
 using namespace boost;
@@ -85,3 +88,162 @@ void get_residual_graph(GraphInterface& gi, boost::any capacity,
                        placeholders::_2, placeholders::_3, augment),
          edge_scalar_properties(), edge_scalar_properties())(capacity, res);
 }
+
+struct get_min_st_cut
+{
+    template <class Graph, class EdgeIndex, class CapacityMap,
+              class ResidualMap, class PartMap, class TypeMap>
+    void operator()(Graph& g, EdgeIndex edge_index, CapacityMap capacity,
+                    ResidualMap res, multi_array_ref<int64_t,1>& sources,
+                    PartMap part, TypeMap etype, bool use_type, double& mc,
+                    vector<int64_t>& cut, vector<int64_t>& type_count) const
+    {
+        size_t N = num_vertices(g);
+        vector<uint8_t> mark(N, 0);
+
+        // level-synchronous BFS from the sources, in the residual graph: an
+        // edge can be followed forwards if it is not saturated, and backwards
+        // if it has nonzero flow
+        vector<size_t> frontier, next;
+        for (auto s : sources)
+        {
+            if (mark[s] == 0)
+                frontier.push_back(s);
+            mark[s] = 1;
+        }
+
+        while (!frontier.empty())
+        {
+            int i, NF = frontier.size();
+            #pragma omp parallel if (NF > 100)
+            {
+                vector<size_t> lnext;
+                auto visit = [&](size_t w)
+                    {
+                        uint8_t was_marked;
+                        #pragma omp atomic capture
+                        {
+                            was_marked = mark[w];
+                            mark[w] = 1;
+                        }
+                        if (!was_marked)
+                            lnext.push_back(w);
+                    };
+
+                #pragma omp for schedule(runtime)
+                for (i = 0; i < NF; ++i)
+                {
+                    auto v = vertex(frontier[i], g);
+                    for (auto e : out_edges_range(v, g))
+                    {
+                        if (res[e] > 0)
+                            visit(target(e, g));
+                    }
+                    for (auto e : in_edges_range(v, g))
+                    {
+                        if (capacity[e] - res[e] > 0)
+                            visit(source(e, g));
+                    }
+                }
+
+                #pragma omp critical (min_st_cut_frontier)
+                next.insert(next.end(), lnext.begin(), lnext.end());
+            }
+            frontier.swap(next);
+            next.clear();
+        }
+
+        // collect the edges leaving the source side
+        vector<std::tuple<size_t, size_t, size_t, double, int32_t>> edges;
+        int i;
+        #pragma omp parallel if (N > 100)
+        {
+            vector<std::tuple<size_t, size_t, size_t, double, int32_t>> ledges;
+
+            #pragma omp for schedule(runtime)
+            for (i = 0; i < int(N); ++i)
+            {
+                auto v = vertex(i, g);
+                if (v == graph_traits<Graph>::null_vertex())
+                    continue;
+                part[v] = mark[i];
+                if (!mark[i])
+                    continue;
+                for (auto e : out_edges_range(v, g))
+                {
+                    auto u = target(e, g);
+                    if (mark[u])
+                        continue;
+                    ledges.emplace_back(edge_index[e], i, u, capacity[e],
+                                        use_type ? etype[e] : 0);
+                }
+            }
+
+            #pragma omp critical (min_st_cut_edges)
+            edges.insert(edges.end(), ledges.begin(), ledges.end());
+        }
+
+        // sorting by edge index makes the order of the sum (and of the
+        // returned edges) independent of the number of threads
+        std::sort(edges.begin(), edges.end());
+
+        mc = 0;
+        cut.clear();
+        type_count.clear();
+        for (auto& e : edges)
+        {
+            mc += get<3>(e);
+            cut.push_back(get<1>(e));
+            cut.push_back(get<2>(e));
+            cut.push_back(get<0>(e));
+            int32_t t = get<4>(e);
+            if (!use_type || t < 0)
+                continue;
+            if (size_t(t) >= type_count.size())
+                type_count.resize(t + 1, 0);
+            type_count[t]++;
+        }
+    }
+};
+
+python::object min_st_cut(GraphInterface& gi, python::object osources,
+                          boost::any capacity, boost::any res,
+                          boost::any opart, boost::any oetype)
+{
+    typedef property_map_type::apply<uint8_t,
+                                     GraphInterface::vertex_index_map_t>::type
+        vmap_t;
+    typedef property_map_type::apply<int32_t,
+                                     GraphInterface::edge_index_map_t>::type
+        emap_t;
+    vmap_t part = any_cast<vmap_t>(opart);
+    bool use_type = !oetype.empty();
+    emap_t etype = use_type ? any_cast<emap_t>(oetype) : emap_t();
+
+    multi_array_ref<int64_t,1> sources = get_array<int64_t,1>(osources);
+    size_t N = gi.get_num_vertices(false);
+    for (auto s : sources)
+    {
+        if (s < 0 || size_t(s) >= N)
+            throw ValueException("Invalid source vertex: " +
+                                 lexical_cast<string>(s));
+    }
+
+    double mc = 0;
+    vector<int64_t> cut, type_count;
+    run_action<graph_tool::detail::always_directed_frozen>()
+        (gi, std::bind(get_min_st_cut(), placeholders::_1, gi.get_edge_index(),
+                       placeholders::_2, placeholders::_3, std::ref(sources),
+                       part.get_unchecked(N), etype.get_unchecked(),
+                       use_type, std::ref(mc), std::ref(cut),
+                       std::ref(type_count)),
+         edge_scalar_properties(), edge_scalar_properties())(capacity, res);
+
+    boost::multi_array<int64_t,2> acut(boost::extents[cut.size() / 3][3]);
+    for (size_t i = 0; i < cut.size() / 3; ++i)
+        for (size_t j = 0; j < 3; ++j)
+            acut[i][j] = cut[3 * i + j];
+
+    return python::make_tuple(mc, wrap_multi_array_owned<int64_t,2>(acut),
+                              wrap_vector_owned(type_count));
+}
@@ -0,0 +1,66 @@
+// graph-tool -- a general graph modification and manipulation thingy
+//
+// Copyright (C) 2006-2015 Tiago de Paula Peixoto <tiago@skewed.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "graph_filtering.hh"
+#include "graph_selectors.hh"
+#include "graph_properties.hh"
+#include "graph.hh"
+
+#include "graph_parallel_push_relabel.hh"
+
+using namespace graph_tool;
+using namespace boost;
+
+struct get_parallel_push_relabel_max_flow
+{
+    template <class Graph, class VertexIndex, class EdgeIndex, class CapacityMap,
+              class ResidualMap>
+    void operator()(Graph& g, VertexIndex vertex_index, EdgeIndex edge_index,
+                    size_t max_e, size_t src, size_t sink, CapacityMap cm,
+                    ResidualMap res) const
+    {
+        typedef typename property_traits<CapacityMap>::value_type cval_t;
+        typedef typename std::conditional<std::is_floating_point<cval_t>::value,
+                                          double, int64_t>::type val_t;
+
+        ResidualNetwork<val_t> rn(g, vertex_index, edge_index, max_e);
+        rn.set_capacity(g, edge_index, cm);
+        solve(rn, vertex_index[vertex(src, g)], vertex_index[vertex(sink, g)]);
+        rn.get_residual(g, edge_index, res);
+    }
+
+    template <class Value>
+    static Value solve(ResidualNetwork<Value>& rn, size_t src, size_t sink)
+    {
+        ParallelPushRelabel<Value> solver(rn);
+        return solver.max_flow(src, sink);
+    }
+};
+
+
+void parallel_push_relabel_max_flow(GraphInterface& gi, size_t src,
+                                    size_t sink, boost::any capacity,
+                                    boost::any res)
+{
+    run_action<graph_tool::detail::always_directed_frozen, boost::mpl::true_>()
+        (gi, std::bind(get_parallel_push_relabel_max_flow(),
+                       placeholders::_1, gi.get_vertex_index(), gi.get_edge_index(),
+                       gi.get_edge_index_range(),
+                       src, sink,  placeholders::_2,  placeholders::_3),
+         writable_edge_scalar_properties(), writable_edge_scalar_properties())
+        (capacity,res);
+}
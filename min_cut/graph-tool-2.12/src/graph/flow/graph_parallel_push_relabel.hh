@@ -0,0 +1,376 @@
+// graph-tool -- a general graph modification and manipulation thingy
+//
+// Copyright (C) 2006-2015 Tiago de Paula Peixoto <tiago@skewed.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef GRAPH_PARALLEL_PUSH_RELABEL_HH
+#define GRAPH_PARALLEL_PUSH_RELABEL_HH
+
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <limits>
+
+#include "graph_residual_network.hh"
+
+namespace graph_tool
+{
+using namespace std;
+using namespace boost;
+
+// Synchronous parallel push-relabel maximum flow.
+//
+// The active vertices (the ones with positive excess) are processed in rounds.
+// In each round, all active vertices are discharged at the same time against
+// the distance labels of the previous round:
+//
+//   1. push: each active vertex v pushes along its admissible arcs (v,w), with
+//      label[v] == label[w] + 1. Since (w,v) can not be admissible at the same
+//      time, each pair of arcs is modified by a single vertex. The pushed
+//      amount is recorded at the arc, instead of added to the excess of w.
+//
+//   2. relabel: each active vertex which still has excess has no admissible
+//      arc left, and its new label is one plus the minimum label of its
+//      residual neighbours.
+//
+//   3. collect: each vertex which was pushed to adds the amounts recorded at
+//      its incoming arcs, in the (fixed) order of its arcs.
+//
+// Since each step only depends on the state at the end of the previous one,
+// the flow and its value are the same for any number of threads. The labels
+// are periodically set to the exact residual distances to the target (or to
+// the source, plus N, for the vertices which can not reach it) with a
+// breadth-first search ("global relabeling"). The excess which can not reach
+// the target is returned to the source, so the result is a maximum flow, not
+// only a preflow.
+//
+// There may be several sources and targets, which behave as if they were
+// connected to a super-source and a super-target with edges of infinite
+// capacity. The flow starts from the current residual capacities of the
+// network, so that a maximum flow can be updated after more vertices are made
+// sources or targets, or after capacities are increased, instead of being
+// computed from zero. This requires that the current flow is conserved in all
+// vertices which are not sources, except for a positive excess (see
+// is_preflow()).
+
+template <class Value>
+class ParallelPushRelabel
+{
+public:
+    ParallelPushRelabel(ResidualNetwork<Value>& rn)
+        : _rn(rn), _N(rn.num_nodes()), _excess(_N, 0), _label(_N, 0),
+          _new_label(_N, 0), _pushed(rn.num_arcs(), 0), _marked(_N, 0),
+          _role(_N, NONE) {}
+
+    // returns the value of the maximum flow from s to t, the flow itself is
+    // left in the residual capacities of the network
+    Value max_flow(size_t s, size_t t)
+    {
+        return max_flow(vector<size_t>({s}), vector<size_t>({t}));
+    }
+
+    // the same, with sets of sources and targets (which must be disjoint);
+    // the returned value is the total flow into the targets
+    Value max_flow(const vector<size_t>& sources, const vector<size_t>& targets)
+    {
+        size_t N = _N, M = _rn.num_arcs();
+
+        set_roles(sources, targets);
+        init_excess();
+        std::fill(_pushed.begin(), _pushed.end(), Value(0));
+
+        // saturate the arcs leaving the sources
+        for (auto s : _sources)
+        {
+            for (size_t a = _rn.arcs_begin(s); a < _rn.arcs_end(s); ++a)
+            {
+                Value& r = _rn.residual(a);
+                if (r > 0 && _role[_rn.head(a)] != SOURCE)
+                {
+                    _excess[_rn.head(a)] += r;
+                    _rn.residual(_rn.reverse(a)) += r;
+                    r = 0;
+                }
+            }
+        }
+
+        global_relabel();
+
+        vector<size_t> active, next, receivers;
+        for (size_t v = 0; v < N; ++v)
+        {
+            if (is_active(v))
+                active.push_back(v);
+        }
+
+        size_t work = 0;
+        while (!active.empty())
+        {
+            push(active, receivers);
+            work += relabel(active);
+            collect(receivers);
+
+            // the next active vertices are the ones left with excess, and the
+            // ones which were pushed to
+            next.clear();
+            for (auto v : active)
+            {
+                if (is_active(v))
+                {
+                    _marked[v] = 1;
+                    next.push_back(v);
+                }
+            }
+            for (auto w : receivers)
+            {
+                if (!_marked[w] && is_active(w))
+                {
+                    _marked[w] = 1;
+                    next.push_back(w);
+                }
+            }
+            for (auto v : next)
+                _marked[v] = 0;
+            receivers.clear();
+            active.swap(next);
+
+            if (2 * work > 6 * N + M)
+            {
+                global_relabel();
+                work = 0;
+            }
+        }
+
+        Value flow = 0;
+        for (auto t : _targets)
+            flow += _excess[t];
+        return flow;
+    }
+
+    // returns true if the current flow of the network can be used as a
+    // starting point for the given sources, i.e. if no other vertex has more
+    // outgoing than incoming flow (up to rounding errors)
+    bool is_preflow(const vector<size_t>& sources)
+    {
+        set_roles(sources, vector<size_t>());
+        init_excess();
+        bool preflow = true;
+        for (size_t v = 0; v < _N; ++v)
+        {
+            if (_role[v] == SOURCE || !(_excess[v] < 0))
+                continue;
+            Value tol = 0;
+            for (size_t a = _rn.arcs_begin(v); a < _rn.arcs_end(v); ++a)
+                tol += _rn.capacity(a) + _rn.capacity(_rn.reverse(a));
+            tol *= numeric_limits<Value>::epsilon() *
+                (_rn.arcs_end(v) - _rn.arcs_begin(v));
+            if (-_excess[v] > tol)
+                preflow = false;
+        }
+        set_roles(vector<size_t>(), vector<size_t>());
+        return preflow;
+    }
+
+private:
+    enum role_t : uint8_t
+    {
+        NONE,
+        SOURCE,
+        TARGET
+    };
+
+    void set_roles(const vector<size_t>& sources, const vector<size_t>& targets)
+    {
+        for (auto v : _sources)
+            _role[v] = NONE;
+        for (auto v : _targets)
+            _role[v] = NONE;
+        _sources = sources;
+        _targets = targets;
+        for (auto v : _sources)
+            _role[v] = SOURCE;
+        for (auto v : _targets)
+            _role[v] = TARGET;
+    }
+
+    // sets the excess of every vertex to its net incoming flow
+    void init_excess()
+    {
+        int i, N = _N;
+        #pragma omp parallel for default(shared) private(i) \
+            schedule(runtime) if (N > 100)
+        for (i = 0; i < N; ++i)
+        {
+            Value ex = 0;
+            for (size_t a = _rn.arcs_begin(i); a < _rn.arcs_end(i); ++a)
+                ex += _rn.residual(a) - _rn.capacity(a);
+            _excess[i] = ex;
+        }
+    }
+
+    bool is_active(size_t v) const
+    {
+        return (_role[v] == NONE && _excess[v] > 0 && _label[v] < 2 * _N);
+    }
+
+    // step 1: push the excess of the active vertices along admissible arcs
+    void push(vector<size_t>& active, vector<size_t>& receivers)
+    {
+        int i, N = active.size();
+        #pragma omp parallel if (N > 100)
+        {
+            vector<size_t> lreceivers;
+
+            #pragma omp for schedule(runtime)
+            for (i = 0; i < N; ++i)
+            {
+                size_t v = active[i];
+                Value ex = _excess[v];
+                for (size_t a = _rn.arcs_begin(v);
+                     a < _rn.arcs_end(v) && ex > 0; ++a)
+                {
+                    size_t w = _rn.head(a);
+                    if (_label[v] != _label[w] + 1)
+                        continue;
+                    Value& r = _rn.residual(a);
+                    if (!(r > 0))
+                        continue;
+                    Value delta = std::min(ex, r);
+                    r -= delta;
+                    _rn.residual(_rn.reverse(a)) += delta;
+                    _pushed[a] = delta;
+                    ex -= delta;
+
+                    uint8_t was_marked;
+                    #pragma omp atomic capture
+                    {
+                        was_marked = _marked[w];
+                        _marked[w] = 1;
+                    }
+                    if (!was_marked)
+                        lreceivers.push_back(w);
+                }
+                _excess[v] = ex;
+            }
+
+            #pragma omp critical (push_relabel_receivers)
+            receivers.insert(receivers.end(), lreceivers.begin(),
+                             lreceivers.end());
+        }
+
+        for (auto w : receivers)
+            _marked[w] = 0;
+    }
+
+    // step 2: relabel the active vertices which still have excess; returns
+    // the work done (as in boost::push_relabel_max_flow)
+    size_t relabel(vector<size_t>& active)
+    {
+        size_t work = 0;
+        int i, N = active.size();
+        #pragma omp parallel for default(shared) private(i) \
+            schedule(runtime) if (N > 100) reduction(+:work)
+        for (i = 0; i < N; ++i)
+        {
+            size_t v = active[i];
+            _new_label[v] = _label[v];
+            if (!(_excess[v] > 0))
+                continue;
+            size_t l = 2 * _N;
+            for (size_t a = _rn.arcs_begin(v); a < _rn.arcs_end(v); ++a)
+            {
+                if (_rn.residual(a) > 0)
+                    l = std::min(l, _label[_rn.head(a)] + 1);
+            }
+            _new_label[v] = l;
+            work += _rn.arcs_end(v) - _rn.arcs_begin(v) + 12;
+        }
+
+        #pragma omp parallel for default(shared) private(i) \
+            schedule(runtime) if (N > 100)
+        for (i = 0; i < N; ++i)
+            _label[active[i]] = _new_label[active[i]];
+        return work;
+    }
+
+    // step 3: add the pushed amounts to the excess of the receivers
+    void collect(vector<size_t>& receivers)
+    {
+        int i, N = receivers.size();
+        #pragma omp parallel for default(shared) private(i) \
+            schedule(runtime) if (N > 100)
+        for (i = 0; i < N; ++i)
+        {
+            size_t w = receivers[i];
+            Value ex = _excess[w];
+            for (size_t b = _rn.arcs_begin(w); b < _rn.arcs_end(w); ++b)
+            {
+                Value& p = _pushed[_rn.reverse(b)];
+                if (p > 0)
+                {
+                    ex += p;
+                    p = 0;
+                }
+            }
+            _excess[w] = ex;
+        }
+    }
+
+    // sets the labels to the residual distances to the targets, or to the
+    // sources plus N
+    void global_relabel()
+    {
+        std::fill(_label.begin(), _label.end(), 2 * _N);
+        for (auto v : _sources)
+            _label[v] = _N;
+        for (auto v : _targets)
+            _label[v] = 0;
+        bfs(_targets);
+        bfs(_sources);
+    }
+
+    void bfs(const vector<size_t>& roots)
+    {
+        deque<size_t> queue(roots.begin(), roots.end());
+        while (!queue.empty())
+        {
+            size_t v = queue.front();
+            queue.pop_front();
+            for (size_t b = _rn.arcs_begin(v); b < _rn.arcs_end(v); ++b)
+            {
+                size_t w = _rn.head(b);
+                if (_label[w] != 2 * _N || !(_rn.residual(_rn.reverse(b)) > 0))
+                    continue;
+                _label[w] = _label[v] + 1;
+                queue.push_back(w);
+            }
+        }
+    }
+
+    ResidualNetwork<Value>& _rn;
+    size_t _N;
+    vector<size_t> _sources;
+    vector<size_t> _targets;
+    vector<Value> _excess;
+    vector<size_t> _label;
+    vector<size_t> _new_label;
+    vector<Value> _pushed;
+    vector<uint8_t> _marked;
+    vector<role_t> _role;
+};
+
+} // graph_tool namespace
+
+#endif // GRAPH_PARALLEL_PUSH_RELABEL_HH
@@ -20,29 +20,7 @@
 #include "graph_properties.hh"
 #include "graph.hh"
 
-#include "graph_augment.hh"
-
-#include <boost/mpl/if.hpp>
-#include <boost/mpl/or.hpp>
-namespace std
-{
-using namespace boost;
-
-// we need a min() function with arguments of different types
-
-template <class T1, class T2>
-typename boost::mpl::if_<
-    typename boost::mpl::or_<typename std::is_floating_point<T1>::type,
-                             typename std::is_floating_point<T2>::type>::type,
-    double, int>::type
-min(const T1& v1, const T2& v2)
-{
-    if (v1 <= T1(v2))
-        return v1;
-    else
-        return v2;
-}
-}
+#include "graph_residual_network.hh"
 
 #include <boost/graph/push_relabel_max_flow.hpp>
 
@@ -51,8 +29,6 @@ min(const T1& v1, const T2& v2)
 using namespace graph_tool;
 using namespace boost;
 
-
-
 struct get_push_relabel_max_flow
 {
     template <class Graph, class VertexIndex, class EdgeIndex, class CapacityMap,
@@ -61,31 +37,37 @@ struct get_push_relabel_max_flow
                     size_t max_e, size_t src, size_t sink, CapacityMap cm,
                     ResidualMap res) const
     {
-        typedef typename graph_traits<Graph>::edge_descriptor edge_t;
-        checked_vector_property_map<bool,EdgeIndex>
-            augmented(edge_index);
-        unchecked_vector_property_map<edge_t,EdgeIndex>
-            reverse_map(edge_index, max_e);
-
-        typedef typename std::remove_const<Graph>::type GT;
-        GT& u = const_cast<GT&>(g);
-
-        augment_graph(u, augmented, cm,
-                      reverse_map.get_checked(), res);
+        typedef typename property_traits<CapacityMap>::value_type cval_t;
+        typedef typename std::conditional<std::is_floating_point<cval_t>::value,
+                                          double, int64_t>::type val_t;
+
+        ResidualNetwork<val_t> rn(g, vertex_index, edge_index, max_e);
+        rn.set_capacity(g, edge_index, cm);
+        solve(rn, vertex_index[vertex(src, g)], vertex_index[vertex(sink, g)]);
+        rn.get_residual(g, edge_index, res);
+    }
 
-        boost::push_relabel_max_flow(g, vertex(src, g), vertex(sink, g),
-                                     get_unchecked(cm),
-                                     res.get_unchecked(),
-                                     reverse_map, vertex_index);
-        deaugment_graph(u, augmented);
+    template <class Value>
+    static Value solve(ResidualNetwork<Value>& rn, size_t src, size_t sink)
+    {
+        return boost::push_relabel_max_flow(rn, src, sink,
+                                            rn.get_capacity_map(),
+                                            rn.get_residual_map(),
+                                            rn.get_reverse_map(),
+                                            identity_property_map());
     }
 };
 
+double push_relabel_max_flow(ResidualNetwork<double>& rn, size_t src,
+                             size_t sink)
+{
+    return get_push_relabel_max_flow::solve(rn, src, sink);
+}
 
 void push_relabel_max_flow(GraphInterface& gi, size_t src, size_t sink,
                            boost::any capacity, boost::any res)
 {
-    run_action<graph_tool::detail::always_directed, boost::mpl::true_>()
+    run_action<graph_tool::detail::always_directed_frozen, boost::mpl::true_>()
         (gi, std::bind(get_push_relabel_max_flow(),
                        placeholders::_1, gi.get_vertex_index(), gi.get_edge_index(),
                        gi.get_edge_index_range(),
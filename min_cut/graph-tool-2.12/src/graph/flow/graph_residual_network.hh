@@ -0,0 +1,325 @@
+// graph-tool -- a general graph modification and manipulation thingy
+//
+// Copyright (C) 2006-2015 Tiago de Paula Peixoto <tiago@skewed.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef GRAPH_RESIDUAL_NETWORK_HH
+#define GRAPH_RESIDUAL_NETWORK_HH
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+#include <boost/graph/graph_traits.hpp>
+#include <boost/iterator/counting_iterator.hpp>
+#include <boost/property_map/property_map.hpp>
+
+namespace graph_tool
+{
+using namespace std;
+using namespace boost;
+
+// This is the residual network of a directed graph, in compressed sparse row
+// form. Each edge of the graph yields a forward arc, which starts with the
+// capacity of the edge, and a paired reverse arc, which starts with zero
+// capacity (as the edges added by augment_graph()). The arcs leaving a vertex
+// are contiguous, and are indexed from 0 to 2E-1. The graph itself is never
+// modified.
+//
+// The network is also a (directed) boost graph, where the vertices are the
+// vertex indexes and the edges are the arcs, so the boost max-flow algorithms
+// can be run directly on it, with the maps returned by get_capacity_map(),
+// get_residual_map() and get_reverse_map(). Once built, it can be reused for
+// any number of flow computations, with the same or with new capacities.
+
+template <class Value>
+class ResidualNetwork
+{
+public:
+    typedef Value value_type;
+
+    // boost graph interface
+    typedef size_t vertex_descriptor;
+    typedef size_t edge_descriptor;
+    typedef counting_iterator<size_t> vertex_iterator;
+    typedef counting_iterator<size_t> out_edge_iterator;
+    typedef counting_iterator<size_t> edge_iterator;
+    typedef directed_tag directed_category;
+    typedef allow_parallel_edge_tag edge_parallel_category;
+    struct traversal_category : public incidence_graph_tag,
+                                public vertex_list_graph_tag,
+                                public edge_list_graph_tag {};
+    typedef size_t vertices_size_type;
+    typedef size_t edges_size_type;
+    typedef size_t degree_size_type;
+
+    static vertex_descriptor null_vertex()
+    {
+        return numeric_limits<size_t>::max();
+    }
+
+    typedef iterator_property_map<typename vector<Value>::iterator,
+                                  identity_property_map> cap_map_t;
+    typedef iterator_property_map<vector<size_t>::iterator,
+                                  identity_property_map> rev_map_t;
+
+    ResidualNetwork() {}
+
+    template <class Graph, class VertexIndex, class EdgeIndex>
+    ResidualNetwork(Graph& g, VertexIndex vertex_index, EdgeIndex edge_index,
+                    size_t max_e)
+    {
+        build(g, vertex_index, edge_index, max_e);
+    }
+
+    // builds the arcs from the edges of the graph
+    template <class Graph, class VertexIndex, class EdgeIndex>
+    void build(Graph& g, VertexIndex vertex_index, EdgeIndex edge_index,
+               size_t max_e)
+    {
+        size_t N = num_vertices(g);
+        _offset.clear();
+        _offset.resize(N + 1, 0);
+        for (auto e : edges_range(g))
+        {
+            _offset[vertex_index[source(e, g)] + 1]++;
+            _offset[vertex_index[target(e, g)] + 1]++;
+        }
+        for (size_t v = 0; v < N; ++v)
+            _offset[v + 1] += _offset[v];
+
+        size_t M = _offset[N];
+        _head.resize(M);
+        _tail.resize(M);
+        _pair.resize(M);
+        _cap.clear();
+        _cap.resize(M, 0);
+        _res.clear();
+        _res.resize(M, 0);
+        _edge_arc.clear();
+        _edge_arc.resize(max_e, numeric_limits<size_t>::max());
+
+        vector<size_t> pos(_offset.begin(), _offset.end() - 1);
+        for (auto e : edges_range(g))
+        {
+            size_t u = vertex_index[source(e, g)];
+            size_t v = vertex_index[target(e, g)];
+            size_t a = pos[u]++;
+            size_t b = pos[v]++;
+            _head[a] = v;
+            _head[b] = u;
+            _tail[a] = u;
+            _tail[b] = v;
+            _pair[a] = b;
+            _pair[b] = a;
+            _edge_arc[edge_index[e]] = a;
+        }
+    }
+
+    // returns true if the edges of g are exactly the ones the network was
+    // built from, i.e. if no edge was added, removed or filtered out since
+    template <class Graph, class EdgeIndex>
+    bool is_built_from(Graph& g, EdgeIndex edge_index) const
+    {
+        bool found = true;
+        size_t E = 0;
+        int i, N = num_vertices(g);
+        #pragma omp parallel for default(shared) private(i) \
+            reduction(+:E) schedule(runtime) if (N > 100)
+        for (i = 0; i < N; ++i)
+        {
+            auto v = vertex(i, g);
+            if (v == graph_traits<Graph>::null_vertex())
+                continue;
+            for (auto e : out_edges_range(v, g))
+            {
+                size_t j = edge_index[e];
+                if (j >= _edge_arc.size() ||
+                    _edge_arc[j] == numeric_limits<size_t>::max())
+                    found = false;
+                E++;
+            }
+        }
+        return found && 2 * E == num_arcs();
+    }
+
+    // sets the capacities of the forward arcs to the edge capacities, and
+    // resets the flow to zero; if keep_flow == true, the current flow of each
+    // edge is kept instead, as long as it does not exceed the new capacity
+    template <class Graph, class EdgeIndex, class CapacityMap>
+    void set_capacity(Graph& g, EdgeIndex edge_index, CapacityMap capacity,
+                      bool keep_flow = false)
+    {
+        int i, N = num_vertices(g);
+        #pragma omp parallel for default(shared) private(i) \
+            schedule(runtime) if (N > 100)
+        for (i = 0; i < N; ++i)
+        {
+            auto v = vertex(i, g);
+            if (v == graph_traits<Graph>::null_vertex())
+                continue;
+            for (auto e : out_edges_range(v, g))
+            {
+                size_t a = _edge_arc[edge_index[e]];
+                size_t b = _pair[a];
+                Value c = capacity[e];
+                Value f = keep_flow ? std::min(_res[b], c) : Value(0);
+                _cap[a] = c;
+                _res[a] = c - f;
+                _cap[b] = 0;
+                _res[b] = f;
+            }
+        }
+    }
+
+    // multiplies all capacities, and the current flow, by c
+    void scale_capacity(Value c)
+    {
+        int i, N = _res.size();
+        #pragma omp parallel for default(shared) private(i) \
+            schedule(runtime) if (N > 100)
+        for (i = 0; i < N; ++i)
+        {
+            _cap[i] *= c;
+            _res[i] *= c;
+        }
+    }
+
+    // resets the flow to zero, keeping the capacities
+    void reset()
+    {
+        int i, N = _res.size();
+        #pragma omp parallel for default(shared) private(i) \
+            schedule(runtime) if (N > 100)
+        for (i = 0; i < N; ++i)
+            _res[i] = _cap[i];
+    }
+
+    // copies the residual capacities of the forward arcs to the edges
+    template <class Graph, class EdgeIndex, class ResidualMap>
+    void get_residual(Graph& g, EdgeIndex edge_index, ResidualMap res) const
+    {
+        typedef typename property_traits<ResidualMap>::value_type rval_t;
+        int i, N = num_vertices(g);
+        #pragma omp parallel for default(shared) private(i) \
+            schedule(runtime) if (N > 100)
+        for (i = 0; i < N; ++i)
+        {
+            auto v = vertex(i, g);
+            if (v == graph_traits<Graph>::null_vertex())
+                continue;
+            for (auto e : out_edges_range(v, g))
+                res[e] = rval_t(_res[_edge_arc[edge_index[e]]]);
+        }
+    }
+
+    size_t num_nodes() const { return _offset.size() - 1; }
+    size_t num_arcs() const { return _head.size(); }
+
+    // the arcs leaving v are [arcs_begin(v), arcs_end(v))
+    size_t arcs_begin(size_t v) const { return _offset[v]; }
+    size_t arcs_end(size_t v) const { return _offset[v + 1]; }
+
+    size_t head(size_t a) const { return _head[a]; }
+    size_t tail(size_t a) const { return _tail[a]; }
+    size_t reverse(size_t a) const { return _pair[a]; }
+    const Value& capacity(size_t a) const { return _cap[a]; }
+    Value& residual(size_t a) { return _res[a]; }
+    const Value& residual(size_t a) const { return _res[a]; }
+
+    cap_map_t get_capacity_map()
+    {
+        return cap_map_t(_cap.begin(), identity_property_map());
+    }
+
+    cap_map_t get_residual_map()
+    {
+        return cap_map_t(_res.begin(), identity_property_map());
+    }
+
+    rev_map_t get_reverse_map()
+    {
+        return rev_map_t(_pair.begin(), identity_property_map());
+    }
+
+private:
+    vector<size_t> _offset;
+    vector<size_t> _head;
+    vector<size_t> _tail;
+    vector<size_t> _pair;
+    vector<Value> _cap;
+    vector<Value> _res;
+    vector<size_t> _edge_arc;
+};
+
+// boost graph interface
+
+template <class Value>
+size_t num_vertices(const ResidualNetwork<Value>& rn)
+{
+    return rn.num_nodes();
+}
+
+template <class Value>
+size_t num_edges(const ResidualNetwork<Value>& rn)
+{
+    return rn.num_arcs();
+}
+
+template <class Value>
+std::pair<counting_iterator<size_t>, counting_iterator<size_t>>
+vertices(const ResidualNetwork<Value>& rn)
+{
+    return std::make_pair(counting_iterator<size_t>(0),
+                          counting_iterator<size_t>(rn.num_nodes()));
+}
+
+template <class Value>
+std::pair<counting_iterator<size_t>, counting_iterator<size_t>>
+edges(const ResidualNetwork<Value>& rn)
+{
+    return std::make_pair(counting_iterator<size_t>(0),
+                          counting_iterator<size_t>(rn.num_arcs()));
+}
+
+template <class Value>
+std::pair<counting_iterator<size_t>, counting_iterator<size_t>>
+out_edges(size_t v, const ResidualNetwork<Value>& rn)
+{
+    return std::make_pair(counting_iterator<size_t>(rn.arcs_begin(v)),
+                          counting_iterator<size_t>(rn.arcs_end(v)));
+}
+
+template <class Value>
+size_t out_degree(size_t v, const ResidualNetwork<Value>& rn)
+{
+    return rn.arcs_end(v) - rn.arcs_begin(v);
+}
+
+template <class Value>
+size_t source(size_t a, const ResidualNetwork<Value>& rn)
+{
+    return rn.tail(a);
+}
+
+template <class Value>
+size_t target(size_t a, const ResidualNetwork<Value>& rn)
+{
+    return rn.head(a);
+}
+
+} // graph_tool namespace
+
+#endif // GRAPH_RESIDUAL_NETWORK_HH
@@ -0,0 +1,96 @@
+// graph-tool -- a general graph modification and manipulation thingy
+//
+// Copyright (C) 2006-2015 Tiago de Paula Peixoto <tiago@skewed.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "graph.hh"
+#include "graph_filtering.hh"
+
+#include "graph_bond.hh"
+#include "numpy_bind.hh"
+
+#include <boost/python.hpp>
+
+using namespace std;
+using namespace boost;
+using namespace graph_tool;
+
+void bond_graph(GraphInterface& gi, python::object opoints,
+                python::object otypes, python::object ocutoff,
+                python::object ocap, python::object obox,
+                python::object operiodic, bool directed, boost::any obtype,
+                boost::any ocapacity, boost::any oimage)
+{
+    multi_array_ref<double,2> points = get_array<double,2>(opoints);
+    multi_array_ref<int32_t,1> types = get_array<int32_t,1>(otypes);
+    multi_array_ref<double,2> cutoff = get_array<double,2>(ocutoff);
+    multi_array_ref<double,2> cap = get_array<double,2>(ocap);
+
+    size_t N = points.shape()[0];
+    size_t D = points.shape()[1];
+    size_t T = cutoff.shape()[0];
+    if (types.shape()[0] != N)
+        throw ValueException("the number of point types must be the same as "
+                             "the number of points");
+    if (cutoff.shape()[1] != T)
+        throw ValueException("the cutoff table must be a square matrix");
+
+    bool has_cap = !ocapacity.empty();
+    if (has_cap && (cap.shape()[0] != T || cap.shape()[1] != T))
+        throw ValueException("the capacity table must have the same shape "
+                             "as the cutoff table");
+
+    vector<double> box;
+    if (obox != python::object())
+    {
+        multi_array_ref<double,2> abox = get_array<double,2>(obox);
+        if (abox.shape()[0] != D || abox.shape()[1] != D)
+            throw ValueException("the box must be a square matrix with the "
+                                 "same dimension as the points");
+        for (size_t i = 0; i < D; ++i)
+            for (size_t j = 0; j < D; ++j)
+                box.push_back(abox[i][j]);
+    }
+
+    vector<uint8_t> periodic(D, false);
+    if (size_t(python::len(operiodic)) != D)
+        throw ValueException("the periodic flags must have the same dimension "
+                             "as the points");
+    for (size_t j = 0; j < D; ++j)
+        periodic[j] = python::extract<bool>(operiodic[j]);
+
+    typedef property_map_type::apply<int32_t,
+                                     GraphInterface::edge_index_map_t>::type
+        btype_map_t;
+    typedef property_map_type::apply<double,
+                                     GraphInterface::edge_index_map_t>::type
+        cap_map_t;
+
+    typedef property_map_type::apply<vector<int32_t>,
+                                     GraphInterface::edge_index_map_t>::type
+        image_map_t;
+
+    btype_map_t btype = any_cast<btype_map_t>(obtype);
+    cap_map_t capacity;
+    if (has_cap)
+        capacity = any_cast<cap_map_t>(ocapacity);
+    bool has_image = !oimage.empty();
+    image_map_t image;
+    if (has_image)
+        image = any_cast<image_map_t>(oimage);
+
+    get_bond_graph()(gi.get_graph(), points, types, cutoff, cap, has_cap, box,
+                     periodic, directed, btype, capacity, image, has_image);
+}
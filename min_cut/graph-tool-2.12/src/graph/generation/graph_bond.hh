@@ -0,0 +1,123 @@
+// graph-tool -- a general graph modification and manipulation thingy
+//
+// Copyright (C) 2006-2015 Tiago de Paula Peixoto <tiago@skewed.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef GRAPH_BOND_HH
+#define GRAPH_BOND_HH
+
+#include "graph_util.hh"
+#include "graph_cell_list.hh"
+
+namespace graph_tool
+{
+using namespace std;
+using namespace boost;
+
+// Bond graph of a set of typed points ("atoms"): two points of types a and b
+// are connected if they are at a distance smaller or equal to cutoff[a][b]. The
+// bond type of an edge is a * T + b, with a <= b, and T the number of types;
+// only the upper triangle (a <= b) of the tables is used. With periodic
+// boundaries, the image of an edge (u, v) is the periodic image of v to which
+// u is bonded, as multiples of the cell vectors (the reverse edges of a
+// directed graph have the opposite image).
+
+struct get_bond_graph
+{
+    template <class Graph, class Points, class Types, class Table,
+              class BondTypeMap, class CapacityMap, class ImageMap>
+    void operator()(Graph& g, Points& points, Types& types, Table& cutoff,
+                    Table& cap, bool has_cap, vector<double>& box,
+                    vector<uint8_t>& periodic, bool directed,
+                    BondTypeMap btype, CapacityMap capacity, ImageMap image,
+                    bool has_image) const
+    {
+        size_t N = points.shape()[0];
+        size_t D = points.shape()[1];
+        size_t T = cutoff.shape()[0];
+
+        for (size_t i = 0; i < N; ++i)
+        {
+            if (types[i] < 0 || size_t(types[i]) >= T)
+                throw ValueException("invalid point type: " +
+                                     lexical_cast<string>(types[i]));
+        }
+
+        double r = 0;
+        for (size_t a = 0; a < T; ++a)
+            for (size_t b = a; b < T; ++b)
+                r = std::max(r, double(cutoff[a][b]));
+
+        CellList cl(points, N, D, box, vector<double>(), periodic, r);
+
+        vector<pair<size_t, size_t>> bonds;
+        cl.find_pairs([&](size_t u, size_t v, double d)
+                      {
+                          size_t a = types[u], b = types[v];
+                          if (a > b)
+                              std::swap(a, b);
+                          return d <= cutoff[a][b];
+                      }, bonds);
+
+        vector<int32_t> images;
+        if (has_image)
+        {
+            images.resize(bonds.size() * D);
+            int i, M = bonds.size();
+            #pragma omp parallel for default(shared) private(i) \
+                schedule(runtime) if (M > 100)
+            for (i = 0; i < M; ++i)
+                cl.get_image(bonds[i].first, bonds[i].second, &images[i * D]);
+        }
+
+        for (size_t i = 0; i < N; ++i)
+            add_vertex(g);
+
+        size_t E = directed ? 2 * bonds.size() : bonds.size();
+        btype.reserve(E);
+        if (has_cap)
+            capacity.reserve(E);
+        if (has_image)
+            image.reserve(E);
+        for (size_t i = 0; i < bonds.size(); ++i)
+        {
+            auto& uv = bonds[i];
+            size_t a = types[uv.first], b = types[uv.second];
+            if (a > b)
+                std::swap(a, b);
+            auto u = vertex(uv.first, g);
+            auto v = vertex(uv.second, g);
+            for (size_t k = 0; k < (directed ? 2 : 1); ++k)
+            {
+                auto e = add_edge(u, v, g).first;
+                btype[e] = a * T + b;
+                if (has_cap)
+                    capacity[e] = cap[a][b];
+                if (has_image)
+                {
+                    int32_t sign = (k == 0) ? 1 : -1;
+                    image[e].resize(D);
+                    for (size_t j = 0; j < D; ++j)
+                        image[e][j] = sign * images[i * D + j];
+                }
+                std::swap(u, v);
+            }
+        }
+    }
+};
+
+} // namespace graph_tool
+
+#endif // GRAPH_BOND_HH
@@ -0,0 +1,452 @@
+// graph-tool -- a general graph modification and manipulation thingy
+//
+// Copyright (C) 2006-2015 Tiago de Paula Peixoto <tiago@skewed.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef GRAPH_CELL_LIST_HH
+#define GRAPH_CELL_LIST_HH
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "graph_exceptions.hh"
+
+namespace graph_tool
+{
+using namespace std;
+
+// Flat cell list of points in a D-dimensional box, for finding all the pairs of
+// points which are closer than a cutoff distance r.
+//
+// The box is given by its D cell vectors (the rows of the D x D matrix H) and
+// an origin, and may be periodic along any of its axes. It does not need to be
+// rectangular: a point x has fractional coordinates s = (x - origin) H^-1, and
+// the cells form a regular grid in fractional space, such that the distance
+// between opposite faces of a cell is at least r. Points outside the box along
+// a non-periodic axis are put in the first or last cell along it. Periodic
+// distances follow the minimum image convention, which for triclinic boxes
+// requires r to be at most half the width of the box along each periodic axis,
+// and that the box is not more skewed than half a cell vector, as usual.
+//
+// The points are stored contiguously, sorted by cell, and the cells are
+// indexed by an offset array, so the neighbours of a point are found by
+// comparing it only with the points in the same and in the adjacent cells.
+// Each pair of adjacent cells is visited only once (a "half shell"), so each
+// pair of points is also found only once. The coordinates are stored one axis
+// at a time, so that the distances from a point to all the points of a cell
+// are computed in vectorizable loops. The periodic image through which each
+// pair is found is available with get_image().
+
+class CellList
+{
+public:
+    // points[i][j] is the j-th coordinate of the i-th point; if box is empty,
+    // the bounding box of the points is used (which can not be periodic)
+    template <class Points>
+    CellList(const Points& points, size_t N, size_t D, vector<double> box,
+             vector<double> origin, vector<uint8_t> periodic, double r)
+        : _N(N), _D(D), _r(r), _H(box), _periodic(periodic)
+    {
+        if (_periodic.empty())
+            _periodic.resize(D, false);
+        if (_periodic.size() != D)
+            throw ValueException("invalid number of periodic axes");
+
+        if (_H.empty())
+        {
+            for (size_t j = 0; j < D; ++j)
+            {
+                if (_periodic[j])
+                    throw ValueException("a periodic box must be given "
+                                         "explicitly");
+            }
+            get_bounding_box(points, origin);
+        }
+        if (_H.size() != D * D)
+            throw ValueException("invalid box dimensions");
+        if (origin.empty())
+            origin.resize(D, 0);
+        if (origin.size() != D)
+            throw ValueException("invalid origin dimension");
+
+        _orthogonal = true;
+        for (size_t j = 0; j < D; ++j)
+        {
+            for (size_t k = 0; k < D; ++k)
+            {
+                if (j != k && _H[j * D + k] != 0)
+                    _orthogonal = false;
+            }
+        }
+
+        invert_box();
+        make_grid();
+
+        // fractional coordinates and cell of each point
+        vector<double> s(N * D);
+        vector<size_t> cell(N);
+        _wrap.clear();
+        _wrap.resize(N * D, 0);
+        int i, NN = N;
+        #pragma omp parallel for default(shared) private(i) \
+            schedule(runtime) if (NN > 100)
+        for (i = 0; i < NN; ++i)
+        {
+            size_t c = 0;
+            for (size_t j = 0; j < D; ++j)
+            {
+                double sj = 0;
+                for (size_t k = 0; k < D; ++k)
+                    sj += (points[i][k] - origin[k]) * _Hinv[k * D + j];
+                if (_periodic[j])
+                {
+                    double f = floor(sj);
+                    sj -= f;
+                    _wrap[i * D + j] = f;
+                }
+                double x = floor(sj * _n[j]);
+                x = std::max(0., std::min(x, double(_n[j] - 1)));
+                s[i * D + j] = sj;
+                c = c * _n[j] + size_t(x);
+            }
+            cell[i] = c;
+        }
+
+        // counting sort of the points by cell
+        _cell_begin.clear();
+        _cell_begin.resize(_ncells + 1, 0);
+        for (size_t v = 0; v < N; ++v)
+            _cell_begin[cell[v] + 1]++;
+        for (size_t c = 0; c < _ncells; ++c)
+            _cell_begin[c + 1] += _cell_begin[c];
+
+        vector<size_t> pos(_cell_begin.begin(), _cell_begin.end() - 1);
+        _idx.resize(N);
+        _pidx.resize(N);
+        _s.resize(N * D);
+        for (size_t v = 0; v < N; ++v)
+        {
+            size_t p = pos[cell[v]]++;
+            _idx[p] = v;
+            _pidx[v] = p;
+            for (size_t j = 0; j < D; ++j)
+                _s[j * N + p] = s[v * D + j];
+        }
+    }
+
+    // finds all pairs (u, v), u < v, of points at a distance d <= r such that
+    // accept(u, v, d) is true, and appends them to pairs, in sorted order
+    template <class Accept>
+    void find_pairs(Accept&& accept, vector<pair<size_t, size_t>>& pairs) const
+    {
+        double r2 = _r * _r;
+        size_t first = pairs.size();
+
+        int i, N = _ncells;
+        #pragma omp parallel if (_N > 100)
+        {
+            vector<pair<size_t, size_t>> lpairs;
+            vector<size_t> ns;
+            vector<double> ds, x, d2;
+
+            #pragma omp for schedule(runtime)
+            for (i = 0; i < N; ++i)
+            {
+                get_neighbours(i, ns);
+                for (auto c : ns)
+                {
+                    for (size_t p = _cell_begin[i]; p < _cell_begin[i + 1]; ++p)
+                    {
+                        size_t q0 = (size_t(i) == c) ? p + 1 : _cell_begin[c];
+                        size_t q1 = _cell_begin[c + 1];
+                        if (q0 >= q1)
+                            continue;
+                        get_dist2(p, q0, q1, ds, x, d2);
+                        for (size_t q = q0; q < q1; ++q)
+                        {
+                            if (d2[q - q0] > r2)
+                                continue;
+                            size_t u = _idx[p], v = _idx[q];
+                            if (u > v)
+                                std::swap(u, v);
+                            if (accept(u, v, sqrt(d2[q - q0])))
+                                lpairs.emplace_back(u, v);
+                        }
+                    }
+                }
+            }
+
+            #pragma omp critical (cell_list_pairs)
+            pairs.insert(pairs.end(), lpairs.begin(), lpairs.end());
+        }
+
+        std::sort(pairs.begin() + first, pairs.end());
+    }
+
+    // the periodic image of point v which is closest to point u, as the
+    // integer multiples n[j] of the cell vectors which are added to the
+    // coordinates of v (zero along non-periodic axes)
+    void get_image(size_t u, size_t v, int32_t* n) const
+    {
+        size_t p = _pidx[u], q = _pidx[v];
+        for (size_t j = 0; j < _D; ++j)
+        {
+            n[j] = 0;
+            if (!_periodic[j])
+                continue;
+            n[j] = -int32_t(round(_s[j * _N + q] - _s[j * _N + p])) -
+                (_wrap[v * _D + j] - _wrap[u * _D + j]);
+        }
+    }
+
+    size_t num_cells() const { return _ncells; }
+
+private:
+    template <class Points>
+    void get_bounding_box(const Points& points, vector<double>& origin)
+    {
+        size_t D = _D;
+        vector<double> xmin(D, numeric_limits<double>::max());
+        vector<double> xmax(D, -numeric_limits<double>::max());
+        for (size_t i = 0; i < _N; ++i)
+        {
+            for (size_t j = 0; j < D; ++j)
+            {
+                xmin[j] = std::min(xmin[j], double(points[i][j]));
+                xmax[j] = std::max(xmax[j], double(points[i][j]));
+            }
+        }
+        origin = xmin;
+        _H.clear();
+        _H.resize(D * D, 0);
+        for (size_t j = 0; j < D; ++j)
+        {
+            if (_N == 0)
+                origin[j] = 0;
+            double w = (_N > 0) ? xmax[j] - xmin[j] : 0;
+            _H[j * D + j] = std::max(w, _r > 0 ? _r : 1.);
+        }
+    }
+
+    // computes H^-1 by Gauss-Jordan elimination with partial pivoting
+    void invert_box()
+    {
+        size_t D = _D;
+        vector<double> a(_H);
+        _Hinv.clear();
+        _Hinv.resize(D * D, 0);
+        for (size_t j = 0; j < D; ++j)
+            _Hinv[j * D + j] = 1;
+        for (size_t j = 0; j < D; ++j)
+        {
+            size_t p = j;
+            for (size_t k = j + 1; k < D; ++k)
+            {
+                if (abs(a[k * D + j]) > abs(a[p * D + j]))
+                    p = k;
+            }
+            if (!(abs(a[p * D + j]) > 0))
+                throw ValueException("the box cell vectors must be linearly "
+                                     "independent");
+            for (size_t k = 0; k < D; ++k)
+            {
+                std::swap(a[j * D + k], a[p * D + k]);
+                std::swap(_Hinv[j * D + k], _Hinv[p * D + k]);
+            }
+            double x = a[j * D + j];
+            for (size_t k = 0; k < D; ++k)
+            {
+                a[j * D + k] /= x;
+                _Hinv[j * D + k] /= x;
+            }
+            for (size_t l = 0; l < D; ++l)
+            {
+                if (l == j)
+                    continue;
+                double y = a[l * D + j];
+                for (size_t k = 0; k < D; ++k)
+                {
+                    a[l * D + k] -= y * a[j * D + k];
+                    _Hinv[l * D + k] -= y * _Hinv[j * D + k];
+                }
+            }
+        }
+    }
+
+    // chooses the number of cells along each axis; the width of the box along
+    // axis j (the distance between the faces spanned by the other cell
+    // vectors) is 1 / |column j of H^-1|
+    void make_grid()
+    {
+        size_t D = _D;
+        vector<double> width(D);
+        _n.resize(D);
+        double ncells = 1;
+        for (size_t j = 0; j < D; ++j)
+        {
+            double x = 0;
+            for (size_t k = 0; k < D; ++k)
+                x += _Hinv[k * D + j] * _Hinv[k * D + j];
+            width[j] = 1. / sqrt(x);
+            if (_periodic[j] && !_orthogonal && 2 * _r > width[j])
+                throw ValueException("the cutoff distance must not be larger "
+                                     "than half the width of the periodic box");
+            double n = (_r > 0) ? floor(width[j] / _r) : 1.;
+            _n[j] = std::max(1., std::min(n, double(_N + 1)));
+            ncells *= _n[j];
+        }
+
+        // avoid many more cells than points (for sparse or elongated point
+        // sets), by making the cells uniformly larger
+        double max_cells = 2. * _N + 1;
+        if (ncells > max_cells)
+        {
+            double f = pow(ncells / max_cells, 1. / D);
+            ncells = 1;
+            for (size_t j = 0; j < D; ++j)
+            {
+                _n[j] = std::max(size_t(1), size_t(_n[j] / f));
+                ncells *= _n[j];
+            }
+        }
+        _ncells = ncells;
+    }
+
+    // the (distinct) cells adjacent to c, including itself, with index >= c;
+    // each pair of adjacent cells is visited only from the lowest one
+    void get_neighbours(size_t c, vector<size_t>& ns) const
+    {
+        size_t D = _D;
+        ns.clear();
+        size_t n_offsets = 1;
+        for (size_t j = 0; j < D; ++j)
+            n_offsets *= 3;
+        for (size_t k = 0; k < n_offsets; ++k)
+        {
+            size_t m = k, x = c, nc = 0, stride = 1;
+            bool valid = true;
+            for (size_t jj = 0; jj < D; ++jj)
+            {
+                size_t j = D - 1 - jj;
+                long cj = x % _n[j];
+                x /= _n[j];
+                long o = long(m % 3) - 1;
+                m /= 3;
+                long y = cj + o;
+                if (y < 0 || y >= long(_n[j]))
+                {
+                    if (!_periodic[j])
+                    {
+                        valid = false;
+                        break;
+                    }
+                    y = (y + _n[j]) % _n[j];
+                }
+                nc += y * stride;
+                stride *= _n[j];
+            }
+            if (valid && nc >= c)
+                ns.push_back(nc);
+        }
+        std::sort(ns.begin(), ns.end());
+        ns.erase(std::unique(ns.begin(), ns.end()), ns.end());
+    }
+
+    // squared distances between the p-th stored point and the ones in the
+    // range [q0, q1), which are put in d2
+    void get_dist2(size_t p, size_t q0, size_t q1, vector<double>& ds,
+                   vector<double>& x, vector<double>& d2) const
+    {
+        size_t D = _D, N = _N, n = q1 - q0;
+        ds.resize(D * n);
+        d2.clear();
+        d2.resize(n, 0);
+        for (size_t j = 0; j < D; ++j)
+        {
+            const double* sj = &_s[j * N + q0];
+            double sp = _s[j * N + p];
+            double* dj = &ds[j * n];
+            if (_periodic[j])
+            {
+                #pragma omp simd
+                for (size_t k = 0; k < n; ++k)
+                    dj[k] = (sj[k] - sp) - round(sj[k] - sp);
+            }
+            else
+            {
+                #pragma omp simd
+                for (size_t k = 0; k < n; ++k)
+                    dj[k] = sj[k] - sp;
+            }
+        }
+
+        double* dd = &d2[0];
+        if (_orthogonal)
+        {
+            for (size_t j = 0; j < D; ++j)
+            {
+                const double* dj = &ds[j * n];
+                double h = _H[j * D + j];
+                #pragma omp simd
+                for (size_t k = 0; k < n; ++k)
+                    dd[k] += (dj[k] * h) * (dj[k] * h);
+            }
+        }
+        else
+        {
+            x.resize(n);
+            double* xx = &x[0];
+            for (size_t l = 0; l < D; ++l)
+            {
+                std::fill(x.begin(), x.end(), 0.);
+                for (size_t j = 0; j < D; ++j)
+                {
+                    const double* dj = &ds[j * n];
+                    double h = _H[j * D + l];
+                    if (h == 0)
+                        continue;
+                    #pragma omp simd
+                    for (size_t k = 0; k < n; ++k)
+                        xx[k] += dj[k] * h;
+                }
+                #pragma omp simd
+                for (size_t k = 0; k < n; ++k)
+                    dd[k] += xx[k] * xx[k];
+            }
+        }
+    }
+
+    size_t _N;
+    size_t _D;
+    double _r;
+    vector<double> _H;
+    vector<double> _Hinv;
+    vector<uint8_t> _periodic;
+    bool _orthogonal;
+    vector<size_t> _n;
+    size_t _ncells;
+    vector<size_t> _cell_begin;
+    vector<size_t> _idx;
+    vector<size_t> _pidx;     // inverse of _idx
+    vector<double> _s;
+    vector<int32_t> _wrap;    // number of box lengths removed from each point
+};
+
+} // namespace graph_tool
+
+#endif // GRAPH_CELL_LIST_HH
@@ -89,6 +89,12 @@ void triangulation(GraphInterface& gi, boost::python::object points, boost::any
 void lattice(GraphInterface& gi, boost::python::object oshape, bool periodic);
 void geometric(GraphInterface& gi, boost::python::object opoints, double r,
                boost::python::object orange, bool periodic, boost::any pos);
+void bond_graph(GraphInterface& gi, boost::python::object opoints,
+                boost::python::object otypes, boost::python::object ocutoff,
+                boost::python::object ocap, boost::python::object obox,
+                boost::python::object operiodic, bool directed,
+                boost::any obtype, boost::any ocapacity,
+                boost::any oimage);
 void price(GraphInterface& gi, size_t N, double gamma, double c, size_t m,
            rng_t& rng);
 void complete(GraphInterface& gi, size_t N, bool directed, bool self_loops);
@@ -108,6 +114,7 @@ BOOST_PYTHON_MODULE(libgraph_tool_generation)
     def("triangulation", &triangulation);
     def("lattice", &lattice);
     def("geometric", &geometric);
+    def("bond_graph", &bond_graph);
     def("price", &price);
     def("complete", &complete);
     def("circular", &circular);
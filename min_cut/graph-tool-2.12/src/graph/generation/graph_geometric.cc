@@ -19,6 +19,7 @@
 #include "graph_filtering.hh"
 
 #include "graph_geometric.hh"
+#include "numpy_bind.hh"
 
 #include <boost/python.hpp>
 
@@ -40,19 +41,9 @@ typedef property_map_types::apply<mpl::vector<vector<double> >,
 void geometric(GraphInterface& gi, python::object opoints, double r,
                python::object orange, bool periodic, boost::any pos)
 {
-    python::object shape = opoints.attr("shape");
-    size_t size = python::extract<size_t>(shape[0]);
-    vector<vector<double> > points(size);
+    multi_array_ref<double,2> points = get_array<double,2>(opoints);
     vector<pair<double, double> > range(python::len(orange));
 
-    size = python::extract<size_t>(shape[1]);
-    for(size_t i = 0; i < points.size(); ++i)
-    {
-        points[i].resize(size);
-        for (size_t j = 0; j < points[i].size(); ++j)
-            points[i][j] = python::extract<double>(opoints[i][j]);
-    }
-
     for(size_t i = 0; i < range.size(); ++i)
     {
         range[i].first = python::extract<double>(orange[i][0]);
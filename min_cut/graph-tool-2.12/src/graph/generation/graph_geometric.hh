@@ -18,155 +18,66 @@
 #ifndef GRAPH_GEOMETRIC_HH
 #define GRAPH_GEOMETRIC_HH
 
-#include <iostream>
-#include <unordered_map>
-
-#include <boost/functional/hash.hpp>
 #include "graph_util.hh"
-
-#ifndef __clang__
-#include <ext/numeric>
-using __gnu_cxx::power;
-#else
-template <class Value>
-Value power(Value value, int n)
-{
-    return pow(value, n);
-}
-#endif
+#include "graph_cell_list.hh"
 
 namespace graph_tool
 {
 using namespace std;
 using namespace boost;
 
-
-template <class Point, class Range>
-void get_box(const Point& p, double w, vector<int>& box,
-             const Range& ranges, bool periodic)
-{
-    if (box.size() != p.size())
-        box.resize(p.size());
-    for (size_t i = 0; i < p.size(); ++i)
-    {
-        box[i] = int(floor(p[i] / w));
-        if (periodic && p[i] == ranges[i].second)
-            box[i] -= 1;
-    }
-}
-
-template <class Point, class Range>
-double get_dist(const Point& p1, const Point& p2,
-                const Range& ranges, bool periodic)
-{
-    double r = 0, diff, size;
-    for (size_t i = 0; i < p1.size(); ++i)
-    {
-        diff = abs(p1[i] - p2[i]);
-        if (periodic)
-        {
-            size = abs(ranges[i].second - ranges[i].first);
-            diff = min(diff, abs(diff - size));
-        }
-        r += pow(diff, 2);
-    }
-    return sqrt(r);
-}
-
-void periodic(vector<int>& box, const vector<pair<int,int> >& ranges)
-{
-    for (size_t i = 0; i < box.size(); ++i)
-    {
-        if (box[i] >= ranges[i].second)
-            box[i] = ranges[i].first;
-        if (box[i] < ranges[i].first)
-            box[i] = ranges[i].second - 1;
-    }
-}
-
-
-template <class Graph>
-bool is_adjacent(typename graph_traits<Graph>::vertex_descriptor v1,
-                 typename graph_traits<Graph>::vertex_descriptor v2,
-                 Graph& g)
-{
-    typename graph_traits<Graph>::out_edge_iterator e, e_end;
-    for (tie(e, e_end) = out_edges(v1, g); e != e_end; ++e)
-        if (target(*e, g) == v2)
-            return true;
-    return false;
-}
+// connects all pairs of points at a distance r or smaller; the pairs are found
+// with a cell list, and are inserted in sorted order, so that the graph does
+// not depend on the number of threads
 
 struct get_geometric
 {
-    template <class Graph, class Pos>
-    void operator()(Graph& g, Pos upos, vector<vector<double> >& points,
+    template <class Graph, class Pos, class Points>
+    void operator()(Graph& g, Pos upos, Points& points,
                     vector<pair<double, double> >& ranges,
                     double r, bool periodic_boundary) const
     {
-        int N = points.size();
-        typename Pos::checked_t pos = upos.get_checked();
-        vector<int> box;
-        vector<pair<int, int> > box_ranges;
+        size_t N = points.shape()[0];
+        size_t D = points.shape()[1];
 
-        double w = 2 * r;
+        vector<double> box, origin;
+        vector<uint8_t> periodic(D, periodic_boundary);
         if (periodic_boundary)
         {
-            box_ranges.resize(ranges.size());
-            for (size_t i = 0; i < ranges.size(); ++i)
+            if (ranges.size() != D)
+                throw ValueException("the number of ranges must be the same "
+                                     "as the dimension of the points");
+            box.resize(D * D, 0);
+            origin.resize(D);
+            for (size_t j = 0; j < D; ++j)
             {
-                box_ranges[i].first = floor(ranges[i].first / w);
-                box_ranges[i].second = ceil(ranges[i].second / w);
+                box[j * D + j] = abs(ranges[j].second - ranges[j].first);
+                origin[j] = min(ranges[j].first, ranges[j].second);
             }
         }
 
-        std::unordered_multimap<vector<int>,
-                                typename graph_traits<Graph>::vertex_descriptor> boxes;
+        CellList cl(points, N, D, box, origin, periodic, r);
+        vector<pair<size_t, size_t> > pairs;
+        cl.find_pairs([](size_t, size_t, double) { return true; }, pairs);
 
-        for (int i = 0; i < N; ++i)
-        {
-            typename graph_traits<Graph>::vertex_descriptor v = add_vertex(g);
-            pos[v].resize(points[i].size());
-            copy(points[i].begin(), points[i].end(), pos[v].begin());
-            get_box(points[i], w, box, ranges, periodic_boundary);
-            boxes.insert(make_pair(box, v));
-        }
+        for (size_t i = 0; i < N; ++i)
+            add_vertex(g);
 
-        int i;
-        #pragma omp parallel for default(shared) private(i, box) \
-            schedule(runtime) if (N > 100)
-        for (i = 0; i < N; ++i)
+        typename Pos::checked_t pos = upos.get_checked();
+        pos.reserve(num_vertices(g));
+        int i, NN = N;
+        #pragma omp parallel for default(shared) private(i) \
+            schedule(runtime) if (NN > 100)
+        for (i = 0; i < NN; ++i)
         {
-            typename graph_traits<Graph>::vertex_descriptor v = vertex(i, g);
-
-            get_box(points[i], w, box, ranges, periodic_boundary);
-            for (int k = 0; k < power(3, int(box.size())); ++k)
-            {
-                for (int j = 0; j < int(box.size()); ++j)
-                  box[j] += ((k / power(3, j)) % 3) - 1;
-
-                if (periodic_boundary)
-                    periodic(box, box_ranges);
-
-                decltype(boxes.begin()) iter, end;
-                for (tie(iter, end) = boxes.equal_range(box);
-                     iter != end; ++iter)
-                {
-                    typename graph_traits<Graph>::vertex_descriptor w =
-                        iter->second;
-                    double d = get_dist(pos[v], pos[w], ranges,
-                                        periodic_boundary);
-
-                    if (w > v && d <= r &&
-                        (!periodic_boundary || !is_adjacent(v, w, g)))
-                    {
-                        #pragma omp critical
-                        add_edge(v, w, g);
-                    }
-                }
-                get_box(points[i], w, box, ranges, periodic_boundary);
-            }
+            auto v = vertex(i, g);
+            pos[v].resize(D);
+            for (size_t j = 0; j < D; ++j)
+                pos[v][j] = points[i][j];
         }
+
+        for (auto& uv : pairs)
+            add_edge(vertex(uv.first, g), vertex(uv.second, g), g);
     }
 };
 
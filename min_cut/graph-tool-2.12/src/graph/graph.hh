@@ -26,6 +26,7 @@
 #include <deque>
 
 #include "graph_adjacency.hh"
+#include "graph_csr.hh"
 
 #include <boost/graph/graph_traits.hpp>
 
@@ -109,6 +110,11 @@ public:
                             boost::any prop_tgt);
     void shrink_to_fit() { _mg->shrink_to_fit(); }
 
+    // frozen (read-only) copy of the graph, see graph_csr.hh
+    void freeze(bool compress);
+    void thaw();
+    bool is_frozen() const;
+
     //
     // python interface
     //
@@ -139,6 +145,9 @@ public:
     typedef boost::property_map<multigraph_t, boost::edge_index_t>::type edge_index_map_t;
     typedef ConstantPropertyMap<size_t, boost::graph_property_tag> graph_index_map_t;
 
+    typedef boost::csr_adj_list<size_t, false> frozen_graph_t;
+    typedef boost::csr_adj_list<size_t, true> compressed_frozen_graph_t;
+
     // internal access
 
     multigraph_t&      get_graph() {return *_mg;}
@@ -150,7 +159,7 @@ public:
     graph_index_map_t  get_graph_index()  {return graph_index_map_t(0);}
 
     // Gets the encapsulated graph view. See graph_filtering.cc for details
-    boost::any get_graph_view() const;
+    boost::any get_graph_view(bool frozen = false) const;
     vector<boost::any>& get_graph_views() {return _graph_views;}
 
 private:
@@ -171,6 +180,10 @@ private:
     // this will hold an instance of the graph views at run time
     vector<boost::any> _graph_views;
 
+    // frozen copy of the main graph (at most one of them is set)
+    shared_ptr<frozen_graph_t> _fg;
+    shared_ptr<compressed_frozen_graph_t> _cfg;
+
     // reverse and directed states
     bool _reversed;
     bool _directed;
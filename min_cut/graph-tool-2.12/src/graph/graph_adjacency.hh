@@ -164,7 +164,8 @@ public:
     typedef std::vector<std::pair<vertex_t, vertex_t> > edge_list_t;
     typedef typename integer_range<Vertex>::iterator vertex_iterator;
 
-    adj_list(): _n_edges(0), _edge_index_range(0), _keep_epos(false) {}
+    adj_list(): _n_edges(0), _edge_index_range(0), _keep_epos(false),
+                _version(0) {}
 
     struct get_vertex
     {
@@ -261,6 +262,7 @@ public:
 
     void reindex_edges()
     {
+        _version++;
         _free_indexes.clear();
         _edge_index_range = 0;
         _in_edges.clear();
@@ -303,6 +305,9 @@ public:
 
     size_t get_edge_index_range() const { return _edge_index_range; }
 
+    // this is incremented whenever the graph is modified
+    size_t get_version() const { return _version; }
+
     static Vertex null_vertex() { return std::numeric_limits<Vertex>::max(); }
 
     void shrink_to_fit()
@@ -344,6 +349,7 @@ private:
                                       // memory use
     bool _keep_epos;
     std::vector<std::pair<int32_t, int32_t>> _epos;
+    size_t _version;
 
     void rebuild_epos()
     {
@@ -619,6 +625,7 @@ template <class Vertex>
 inline
 Vertex add_vertex(adj_list<Vertex>& g)
 {
+    g._version++;
     size_t n = g._out_edges.size();
     g._out_edges.resize(n + 1);
     g._in_edges.resize(n + 1);
@@ -628,6 +635,7 @@ Vertex add_vertex(adj_list<Vertex>& g)
 template <class Vertex>
 inline void clear_vertex(Vertex v, adj_list<Vertex>& g)
 {
+    g._version++;
     if (!g._keep_epos)
     {
         auto remove_es = [&] (auto& out_edges, auto& in_edges)
@@ -689,6 +697,7 @@ inline void clear_vertex(Vertex v, adj_list<Vertex>& g)
 template <class Vertex>
 inline void remove_vertex(Vertex v, adj_list<Vertex>& g)
 {
+    g._version++;
     clear_vertex(v, g);
     g._out_edges.erase(g._out_edges.begin() + v);
     g._in_edges.erase(g._in_edges.begin() + v);
@@ -716,6 +725,7 @@ inline void remove_vertex(Vertex v, adj_list<Vertex>& g)
 template <class Vertex>
 inline void remove_vertex_fast(Vertex v, adj_list<Vertex>& g)
 {
+    g._version++;
     Vertex back = g._out_edges.size() - 1;
 
     if (v < back)
@@ -768,6 +778,7 @@ inline
 typename std::pair<typename adj_list<Vertex>::edge_descriptor, bool>
 add_edge(Vertex s, Vertex t, adj_list<Vertex>& g)
 {
+    g._version++;
     Vertex idx;
     if (g._free_indexes.empty())
     {
@@ -802,6 +813,7 @@ template <class Vertex>
 inline void remove_edge(Vertex s, Vertex t,
                         adj_list<Vertex>& g)
 {
+    g._version++;
     if (!g._keep_epos)
     {
         auto& oes = g._out_edges[s];
@@ -834,6 +846,7 @@ template <class Vertex>
 inline void remove_edge(const typename adj_list<Vertex>::edge_descriptor& e,
                         adj_list<Vertex>& g)
 {
+    g._version++;
     auto& s = e.s;
     auto& t = e.t;
     auto& idx = e.idx;
@@ -0,0 +1,299 @@
+// graph-tool -- a general graph modification and manipulation thingy
+//
+// Copyright (C) 2006-2015 Tiago de Paula Peixoto <tiago@skewed.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef GRAPH_BFS_KERNEL_HH
+#define GRAPH_BFS_KERNEL_HH
+
+#include "config.h"
+
+#include <vector>
+#include <cstdint>
+
+#include "graph_selectors.hh"
+
+namespace graph_tool
+{
+using namespace std;
+using namespace boost;
+
+// Breadth-first search from up to 64 sources at once, without visitors or
+// color maps. Each vertex keeps a 64-bit mask of the sources which have
+// reached it, and another with the sources for which it is in the current
+// frontier, so that a single pass over the edges advances all the searches.
+//
+// Each level is expanded either top-down, by pushing the frontier of each
+// active vertex to its neighbours, or bottom-up, by pulling into each vertex
+// which was not yet reached by all the sources the frontier of its
+// predecessors, which stops as soon as all the missing sources are found. The
+// search switches to bottom-up when the frontier has more edges than a
+// fraction 1/alpha of the edges of the vertices not yet reached, and back to
+// top-down when it has fewer than a fraction 1/beta of the vertices (Beamer et
+// al., SC 2012).
+//
+// If parallel == true, the levels are expanded by all the threads; the
+// callback is then copied for each thread, as with firstprivate(). The scratch
+// space is allocated once, and only the vertices which were reached are reset
+// between searches, so the same object should be reused for many searches on
+// the same graph.
+
+class BitParallelBFS
+{
+public:
+    BitParallelBFS(size_t N)
+        : _seen(N, 0), _frontier(N, 0), _next(N, 0), _total_degree(0),
+          _has_degree(false) {}
+
+    // calls f(v, mask, d) for each vertex v reached at distance d > 0, where
+    // bit j of mask is set if v is at distance d from sources[j]
+    template <class Graph, class F>
+    void search(Graph& g, const size_t* sources, size_t n, F f,
+                bool parallel = false)
+    {
+        reset();
+        for (size_t j = 0; j < n; ++j)
+            add_source(sources[j], uint64_t(1) << j);
+        uint64_t full = (n < 64) ? (uint64_t(1) << n) - 1 : ~uint64_t(0);
+        run(g, full, f, parallel);
+    }
+
+    // calls f(v, 1, d) for each vertex v at distance d > 0 from the nearest
+    // of any number of sources
+    template <class Graph, class F>
+    void search_nearest(Graph& g, const size_t* sources, size_t n, F f,
+                        bool parallel = false)
+    {
+        reset();
+        for (size_t j = 0; j < n; ++j)
+            add_source(sources[j], 1);
+        run(g, 1, f, parallel);
+    }
+
+private:
+    void add_source(size_t s, uint64_t mask)
+    {
+        if (_seen[s] == 0)
+        {
+            _active.push_back(s);
+            _touched.push_back(s);
+        }
+        _seen[s] |= mask;
+    }
+
+    template <class Graph, class F>
+    void run(Graph& g, uint64_t full, F& f, bool parallel)
+    {
+        const size_t alpha = 15, beta = 18;
+
+        if (!_has_degree)
+        {
+            for (auto v : vertices_range(g))
+                _total_degree += out_degree(v, g);
+            _has_degree = true;
+        }
+
+        // edges of the frontier, and of the vertices not yet reached by all
+        // the sources
+        _m_f = 0;
+        _m_u = _total_degree;
+        for (auto v : _active)
+        {
+            _frontier[v] = _seen[v];
+            _m_f += out_degree(v, g);
+            if (_seen[v] == full)
+                _m_u -= out_degree(v, g);
+        }
+        _top_down = true;
+
+        int N = num_vertices(g);
+
+        // the lock is only needed if the levels are expanded in parallel,
+        // otherwise it would serialize independent searches
+        auto merge = [&](auto&& op)
+        {
+            if (parallel)
+            {
+                #pragma omp critical (bfs_kernel)
+                op();
+            }
+            else
+            {
+                op();
+            }
+        };
+
+        #pragma omp parallel if (parallel) firstprivate(f)
+        {
+            vector<size_t> lnext, ltouched;
+            size_t d = 0;
+            while (!_active.empty())
+            {
+                ++d;
+                lnext.clear();
+                ltouched.clear();
+
+                int i, M = _active.size();
+                if (_top_down)
+                {
+                    #pragma omp for schedule(runtime)
+                    for (i = 0; i < M; ++i)
+                    {
+                        size_t v = _active[i];
+                        uint64_t x = _frontier[v];
+                        for (auto w : adjacent_vertices_range(v, g))
+                        {
+                            uint64_t y = x & ~_seen[w];
+                            if (y == 0)
+                                continue;
+                            uint64_t old;
+                            if (parallel)
+                            {
+                                #pragma omp atomic capture
+                                {
+                                    old = _next[w];
+                                    _next[w] |= y;
+                                }
+                            }
+                            else
+                            {
+                                old = _next[w];
+                                _next[w] |= y;
+                            }
+                            if (old == 0)
+                                lnext.push_back(w);
+                        }
+                    }
+                }
+                else
+                {
+                    #pragma omp for schedule(runtime)
+                    for (i = 0; i < N; ++i)
+                    {
+                        auto w = vertex(i, g);
+                        if (w == graph_traits<Graph>::null_vertex())
+                            continue;
+                        uint64_t u = full & ~_seen[w];
+                        if (u == 0)
+                            continue;
+                        uint64_t y = 0;
+                        for (auto e : in_or_out_edges_range(w, g))
+                        {
+                            // the other endpoint, for both in-edges of
+                            // directed graphs and out-edges of undirected ones
+                            size_t v = source(e, g);
+                            if (v == size_t(w))
+                                v = target(e, g);
+                            y |= _frontier[v] & u;
+                            if (y == u)
+                                break;
+                        }
+                        if (y == 0)
+                            continue;
+                        _next[w] = y;
+                        lnext.push_back(w);
+                    }
+                }
+
+                #pragma omp for schedule(runtime)
+                for (i = 0; i < M; ++i)
+                    _frontier[_active[i]] = 0;
+
+                merge([&]()
+                      {
+                          _nactive.insert(_nactive.end(), lnext.begin(),
+                                          lnext.end());
+                      });
+                #pragma omp barrier
+
+                size_t m_f = 0, m_done = 0;
+                M = _nactive.size();
+                #pragma omp for schedule(runtime)
+                for (i = 0; i < M; ++i)
+                {
+                    size_t w = _nactive[i];
+                    uint64_t y = _next[w];
+                    _next[w] = 0;
+                    if (_seen[w] == 0)
+                        ltouched.push_back(w);
+                    _seen[w] |= y;
+                    _frontier[w] = y;
+                    size_t k = out_degree(w, g);
+                    m_f += k;
+                    if (_seen[w] == full)
+                        m_done += k;
+                    f(w, y, d);
+                }
+
+                merge([&]()
+                      {
+                          _touched.insert(_touched.end(), ltouched.begin(),
+                                          ltouched.end());
+                          _m_next += m_f;
+                          _m_u -= m_done;
+                      });
+                #pragma omp barrier
+
+                #pragma omp single
+                {
+                    size_t n_f = _nactive.size();
+                    bool growing = n_f > _active.size();
+                    _active.swap(_nactive);
+                    _nactive.clear();
+                    _m_f = _m_next;
+                    _m_next = 0;
+                    if (_top_down)
+                    {
+                        if (growing && _m_f > _m_u / alpha)
+                            _top_down = false;
+                    }
+                    else
+                    {
+                        if (!growing && n_f < size_t(N) / beta)
+                            _top_down = true;
+                    }
+                }
+            }
+        }
+    }
+
+    void reset()
+    {
+        for (auto v : _touched)
+        {
+            _seen[v] = 0;
+            _frontier[v] = 0;
+        }
+        _touched.clear();
+        _active.clear();
+        _nactive.clear();
+        _m_next = 0;
+    }
+
+    vector<uint64_t> _seen;
+    vector<uint64_t> _frontier;
+    vector<uint64_t> _next;
+    vector<size_t> _active;
+    vector<size_t> _nactive;
+    vector<size_t> _touched;
+    size_t _total_degree;
+    bool _has_degree;
+    size_t _m_f, _m_u, _m_next;
+    bool _top_down;
+};
+
+} // graph_tool namespace
+
+#endif // GRAPH_BFS_KERNEL_HH
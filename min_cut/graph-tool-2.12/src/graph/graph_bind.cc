@@ -405,6 +405,8 @@ void export_python_interface();
 
 void export_openmp();
 
+void export_mapped_graph();
+
 BOOST_PYTHON_MODULE(libgraph_tool_core)
 {
     using namespace boost::python;
@@ -437,6 +439,7 @@ BOOST_PYTHON_MODULE(libgraph_tool_core)
 
     def("graph_filtering_enabled", &graph_filtering_enabled);
     export_openmp();
+    export_mapped_graph();
 
     boost::mpl::for_each<boost::mpl::push_back<scalar_types,string>::type>(export_vector_types());
     export_vector_types()(size_t(), "size_t");
@@ -473,6 +476,9 @@ BOOST_PYTHON_MODULE(libgraph_tool_core)
         .def("get_edge_index_range", &GraphInterface::get_edge_index_range)
         .def("re_index_edges", &GraphInterface::re_index_edges)
         .def("shrink_to_fit", &GraphInterface::shrink_to_fit)
+        .def("freeze", &GraphInterface::freeze)
+        .def("thaw", &GraphInterface::thaw)
+        .def("is_frozen", &GraphInterface::is_frozen)
         .def("get_graph_index", &GraphInterface::get_graph_index)
         .def("copy_vertex_property", &GraphInterface::copy_vertex_property)
         .def("copy_edge_property", &GraphInterface::copy_edge_property);
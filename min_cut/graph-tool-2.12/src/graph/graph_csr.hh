@@ -0,0 +1,597 @@
+// graph-tool -- a general graph modification and manipulation thingy
+//
+// Copyright (C) 2006-2015 Tiago de Paula Peixoto <tiago@skewed.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef GRAPH_CSR_HH
+#define GRAPH_CSR_HH
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+
+#include "graph_adjacency.hh"
+
+namespace boost
+{
+
+// ========================================================================
+// csr_adj_list<Vertex, Compressed>
+// ========================================================================
+//
+// csr_adj_list is an immutable ("frozen") copy of an adj_list<Vertex>, in
+// compressed sparse row form: the in- and out-edges of all vertices are stored
+// contiguously in two arrays, indexed by an offset array, with 32-bit vertex
+// and edge indexes. This takes 16 bytes per edge, instead of the 32 bytes of
+// adj_list<size_t>, and improves locality when the graph is traversed.
+//
+// If Compressed == true, the edge lists of each vertex are sorted by
+// neighbour, and the differences between consecutive neighbours and edge
+// indexes are stored as variable-length integers (7 bits per byte). This
+// usually takes 3 to 6 bytes per edge and direction, at the cost of only
+// allowing forward traversal of the edge lists.
+//
+// The vertex indexes, the edge indexes and the edge descriptors are the same
+// as in the original graph, so that the same property maps can be used with
+// both. The graph can not be modified.
+
+namespace detail
+{
+
+template <class Vertex, bool Compressed>
+class csr_edge_store;
+
+// plain storage: (neighbour, edge index) pairs
+template <class Vertex>
+class csr_edge_store<Vertex, false>
+{
+public:
+    typedef std::pair<uint32_t, uint32_t> entry_t;
+    typedef const entry_t* iterator;
+
+    // get(v, es) must fill es with the (neighbour, edge index) pairs of v
+    template <class GetEdges>
+    void build(size_t N, GetEdges&& get)
+    {
+        std::vector<std::pair<Vertex, Vertex>> es;
+        _offset.clear();
+        _offset.reserve(N + 1);
+        _offset.push_back(0);
+        _edges.clear();
+        for (size_t v = 0; v < N; ++v)
+        {
+            es.clear();
+            get(v, es);
+            for (auto& e : es)
+                _edges.emplace_back(e.first, e.second);
+            _offset.push_back(_edges.size());
+        }
+        _edges.shrink_to_fit();
+    }
+
+    size_t degree(size_t v) const { return _offset[v + 1] - _offset[v]; }
+    iterator begin(size_t v) const { return _edges.data() + _offset[v]; }
+    iterator end(size_t v) const { return _edges.data() + _offset[v + 1]; }
+
+private:
+    std::vector<size_t> _offset;
+    std::vector<entry_t> _edges;
+};
+
+// compressed storage: delta-encoded variable-length integers
+template <class Vertex>
+class csr_edge_store<Vertex, true>
+{
+public:
+    typedef std::pair<Vertex, Vertex> entry_t;
+
+    class iterator:
+        public boost::iterator_facade<iterator, entry_t,
+                                      boost::forward_traversal_tag, entry_t>
+    {
+    public:
+        iterator(): _pos(0), _next(0), _end(0) {}
+        iterator(const uint8_t* pos, const uint8_t* end)
+            : _pos(pos), _next(pos), _end(end), _val(0, 0)
+        {
+            decode();
+        }
+
+    private:
+        friend class boost::iterator_core_access;
+
+        void decode()
+        {
+            if (_pos == _end)
+                return;
+            const uint8_t* p = _pos;
+            _val.first += read(p);
+            uint64_t d = read(p);
+            _val.second += Vertex((d >> 1) ^ -(d & 1));
+            _next = p;
+        }
+
+        static uint64_t read(const uint8_t*& p)
+        {
+            uint64_t x = 0;
+            for (int s = 0; ; s += 7)
+            {
+                uint8_t b = *(p++);
+                x |= uint64_t(b & 0x7f) << s;
+                if (!(b & 0x80))
+                    break;
+            }
+            return x;
+        }
+
+        void increment()
+        {
+            _pos = _next;
+            decode();
+        }
+
+        bool equal(const iterator& other) const { return _pos == other._pos; }
+        entry_t dereference() const { return _val; }
+
+        const uint8_t* _pos;
+        const uint8_t* _next;
+        const uint8_t* _end;
+        entry_t _val;
+    };
+
+    template <class GetEdges>
+    void build(size_t N, GetEdges&& get)
+    {
+        std::vector<std::pair<Vertex, Vertex>> es;
+        _offset.clear();
+        _offset.reserve(N + 1);
+        _offset.push_back(0);
+        _degree.clear();
+        _degree.reserve(N);
+        _data.clear();
+        for (size_t v = 0; v < N; ++v)
+        {
+            es.clear();
+            get(v, es);
+            std::sort(es.begin(), es.end());
+            Vertex u = 0, idx = 0;
+            for (auto& e : es)
+            {
+                write(e.first - u);
+                int64_t d = int64_t(e.second) - int64_t(idx);
+                write((uint64_t(d) << 1) ^ uint64_t(d >> 63));
+                u = e.first;
+                idx = e.second;
+            }
+            _degree.push_back(es.size());
+            _offset.push_back(_data.size());
+        }
+        _data.shrink_to_fit();
+    }
+
+    size_t degree(size_t v) const { return _degree[v]; }
+
+    iterator begin(size_t v) const
+    {
+        return iterator(_data.data() + _offset[v], _data.data() + _offset[v + 1]);
+    }
+
+    iterator end(size_t v) const
+    {
+        return iterator(_data.data() + _offset[v + 1],
+                        _data.data() + _offset[v + 1]);
+    }
+
+private:
+    void write(uint64_t x)
+    {
+        while (x >= 0x80)
+        {
+            _data.push_back(uint8_t(x) | 0x80);
+            x >>= 7;
+        }
+        _data.push_back(uint8_t(x));
+    }
+
+    std::vector<size_t> _offset;
+    std::vector<uint32_t> _degree;
+    std::vector<uint8_t> _data;
+};
+
+} // namespace detail
+
+template <class Vertex = size_t, bool Compressed = false>
+class csr_adj_list
+{
+public:
+    struct graph_tag {};
+    typedef Vertex vertex_t;
+    typedef typename adj_list<Vertex>::edge_descriptor edge_descriptor;
+    typedef typename integer_range<Vertex>::iterator vertex_iterator;
+    typedef detail::csr_edge_store<Vertex, Compressed> edge_store_t;
+    typedef typename edge_store_t::entry_t entry_t;
+
+    csr_adj_list(): _N(0), _n_edges(0), _edge_index_range(0), _version(0) {}
+
+    explicit csr_adj_list(const adj_list<Vertex>& g)
+    {
+        freeze(g);
+    }
+
+    // copies the structure of g, which must have fewer than 2^32 vertices
+    // and edge indexes
+    void freeze(const adj_list<Vertex>& g)
+    {
+        size_t N = num_vertices(g);
+        _out.build(N, [&](Vertex v, std::vector<std::pair<Vertex, Vertex>>& es)
+                   {
+                       typename adj_list<Vertex>::out_edge_iterator e, e_end;
+                       for (tie(e, e_end) = out_edges(v, g); e != e_end; ++e)
+                           es.emplace_back(e->t, e->idx);
+                   });
+        _in.build(N, [&](Vertex v, std::vector<std::pair<Vertex, Vertex>>& es)
+                  {
+                      typename adj_list<Vertex>::in_edge_iterator e, e_end;
+                      for (tie(e, e_end) = in_edges(v, g); e != e_end; ++e)
+                          es.emplace_back(e->s, e->idx);
+                  });
+        _N = N;
+        _n_edges = num_edges(g);
+        _edge_index_range = g.get_edge_index_range();
+        _version = g.get_version();
+    }
+
+    struct get_vertex
+    {
+        get_vertex() {}
+        typedef Vertex result_type;
+        Vertex operator()(const entry_t& v) const { return v.first; }
+    };
+
+    typedef transform_random_access_iterator<get_vertex,
+                                             typename edge_store_t::iterator>
+        adjacency_iterator;
+
+    struct make_out_edge
+    {
+        make_out_edge(vertex_t src): _src(src) {}
+        make_out_edge() {}
+        vertex_t _src;
+        typedef edge_descriptor result_type;
+        edge_descriptor operator()(const entry_t& v) const
+        { return edge_descriptor(_src, v.first, v.second, false); }
+    };
+
+    struct make_in_edge
+    {
+        make_in_edge(vertex_t tgt): _tgt(tgt) {}
+        make_in_edge() {}
+        vertex_t _tgt;
+        typedef edge_descriptor result_type;
+        edge_descriptor operator()(const entry_t& v) const
+        { return edge_descriptor(v.first, _tgt, v.second, false); }
+    };
+
+    typedef transform_random_access_iterator<make_out_edge,
+                                             typename edge_store_t::iterator>
+        out_edge_iterator;
+    typedef transform_random_access_iterator<make_in_edge,
+                                             typename edge_store_t::iterator>
+        in_edge_iterator;
+
+    class edge_iterator:
+        public boost::iterator_facade<edge_iterator,
+                                      edge_descriptor,
+                                      boost::forward_traversal_tag,
+                                      edge_descriptor>
+    {
+    public:
+        edge_iterator(): _g(0), _v(0) {}
+        edge_iterator(const csr_adj_list* g, size_t v)
+            : _g(g), _v(v)
+        {
+            if (_v < _g->_N)
+                _ei = _g->_out.begin(_v);
+            skip();
+        }
+
+    private:
+        friend class boost::iterator_core_access;
+
+        void skip()
+        {
+            //skip empty vertices
+            while (_v < _g->_N && _ei == _g->_out.end(_v))
+            {
+                ++_v;
+                if (_v < _g->_N)
+                    _ei = _g->_out.begin(_v);
+            }
+        }
+
+        void increment()
+        {
+            ++_ei;
+            skip();
+        }
+
+        bool equal(edge_iterator const& other) const
+        {
+            if (_v == _g->_N)
+                return _v == other._v;
+            return _v == other._v && _ei == other._ei;
+        }
+
+        edge_descriptor dereference() const
+        {
+            entry_t e = *_ei;
+            return edge_descriptor(_v, e.first, e.second, false);
+        }
+
+        const csr_adj_list* _g;
+        size_t _v;
+        typename edge_store_t::iterator _ei;
+    };
+
+    size_t get_edge_index_range() const { return _edge_index_range; }
+
+    // the version of the original graph when it was frozen
+    size_t get_version() const { return _version; }
+
+    static Vertex null_vertex() { return std::numeric_limits<Vertex>::max(); }
+
+    size_t num_nodes() const { return _N; }
+    size_t num_arcs() const { return _n_edges; }
+    const edge_store_t& get_out() const { return _out; }
+    const edge_store_t& get_in() const { return _in; }
+
+private:
+    size_t _N;
+    size_t _n_edges;
+    size_t _edge_index_range;
+    size_t _version;
+    edge_store_t _out;
+    edge_store_t _in;
+};
+
+//========================================================================
+// Graph traits and BGL scaffolding
+//========================================================================
+
+template <class Vertex, bool Compressed>
+struct graph_traits<csr_adj_list<Vertex, Compressed> >
+{
+    typedef csr_adj_list<Vertex, Compressed> g_t;
+    typedef Vertex vertex_descriptor;
+    typedef typename g_t::edge_descriptor edge_descriptor;
+    typedef typename g_t::edge_iterator edge_iterator;
+    typedef typename g_t::adjacency_iterator adjacency_iterator;
+    typedef typename g_t::out_edge_iterator out_edge_iterator;
+    typedef typename g_t::in_edge_iterator in_edge_iterator;
+    typedef typename g_t::vertex_iterator vertex_iterator;
+
+    typedef bidirectional_tag directed_category;
+    typedef allow_parallel_edge_tag edge_parallel_category;
+    typedef adj_list_traversal_tag traversal_category;
+
+    typedef Vertex vertices_size_type;
+    typedef Vertex edges_size_type;
+    typedef size_t degree_size_type;
+
+    static Vertex null_vertex() { return g_t::null_vertex(); }
+};
+
+template <class Vertex, bool Compressed>
+struct graph_traits<const csr_adj_list<Vertex, Compressed> >
+    : public graph_traits<csr_adj_list<Vertex, Compressed> >
+{
+};
+
+template <class Vertex, bool Compressed>
+struct edge_property_type<csr_adj_list<Vertex, Compressed> >
+{
+    typedef void type;
+};
+
+template <class Vertex, bool Compressed>
+struct vertex_property_type<csr_adj_list<Vertex, Compressed> >
+{
+    typedef void type;
+};
+
+template <class Vertex, bool Compressed>
+struct graph_property_type<csr_adj_list<Vertex, Compressed> >
+{
+    typedef void type;
+};
+
+//========================================================================
+// Graph access functions
+//========================================================================
+
+template <class Vertex, bool Compressed>
+inline
+std::pair<typename csr_adj_list<Vertex, Compressed>::vertex_iterator,
+          typename csr_adj_list<Vertex, Compressed>::vertex_iterator>
+vertices(const csr_adj_list<Vertex, Compressed>& g)
+{
+    typedef typename csr_adj_list<Vertex, Compressed>::vertex_iterator vi_t;
+    return std::make_pair(vi_t(0), vi_t(g.num_nodes()));
+}
+
+template <class Vertex, bool Compressed>
+inline
+std::pair<typename csr_adj_list<Vertex, Compressed>::edge_iterator,
+          typename csr_adj_list<Vertex, Compressed>::edge_iterator>
+edges(const csr_adj_list<Vertex, Compressed>& g)
+{
+    typedef typename csr_adj_list<Vertex, Compressed>::edge_iterator ei_t;
+    return std::make_pair(ei_t(&g, 0), ei_t(&g, g.num_nodes()));
+}
+
+template <class Vertex, bool Compressed>
+inline
+Vertex vertex(size_t i, const csr_adj_list<Vertex, Compressed>&)
+{
+    return i;
+}
+
+template <class Vertex, bool Compressed>
+inline
+std::pair<typename csr_adj_list<Vertex, Compressed>::edge_descriptor, bool>
+edge(Vertex s, Vertex t, const csr_adj_list<Vertex, Compressed>& g)
+{
+    typedef typename csr_adj_list<Vertex, Compressed>::edge_descriptor
+        edge_descriptor;
+    auto& out = g.get_out();
+    for (auto iter = out.begin(s); iter != out.end(s); ++iter)
+    {
+        auto e = *iter;
+        if (Vertex(e.first) == t)
+            return std::make_pair(edge_descriptor(s, t, e.second, false), true);
+    }
+    Vertex v = graph_traits<csr_adj_list<Vertex, Compressed> >::null_vertex();
+    return std::make_pair(edge_descriptor(v, v, v, false), false);
+}
+
+template <class Vertex, bool Compressed>
+inline
+size_t out_degree(Vertex v, const csr_adj_list<Vertex, Compressed>& g)
+{
+    return g.get_out().degree(v);
+}
+
+template <class Vertex, bool Compressed>
+inline
+size_t in_degree(Vertex v, const csr_adj_list<Vertex, Compressed>& g)
+{
+    return g.get_in().degree(v);
+}
+
+template <class Vertex, bool Compressed>
+inline
+size_t degree(Vertex v, const csr_adj_list<Vertex, Compressed>& g)
+{
+    return in_degree(v, g) + out_degree(v, g);
+}
+
+template <class Vertex, bool Compressed>
+inline
+std::pair<typename csr_adj_list<Vertex, Compressed>::out_edge_iterator,
+          typename csr_adj_list<Vertex, Compressed>::out_edge_iterator>
+out_edges(Vertex v, const csr_adj_list<Vertex, Compressed>& g)
+{
+    typedef typename csr_adj_list<Vertex, Compressed>::out_edge_iterator ei_t;
+    typedef typename csr_adj_list<Vertex, Compressed>::make_out_edge mk_edge;
+    return std::make_pair(ei_t(g.get_out().begin(v), mk_edge(v)),
+                          ei_t(g.get_out().end(v), mk_edge(v)));
+}
+
+template <class Vertex, bool Compressed>
+inline
+std::pair<typename csr_adj_list<Vertex, Compressed>::in_edge_iterator,
+          typename csr_adj_list<Vertex, Compressed>::in_edge_iterator>
+in_edges(Vertex v, const csr_adj_list<Vertex, Compressed>& g)
+{
+    typedef typename csr_adj_list<Vertex, Compressed>::in_edge_iterator ei_t;
+    typedef typename csr_adj_list<Vertex, Compressed>::make_in_edge mk_edge;
+    return std::make_pair(ei_t(g.get_in().begin(v), mk_edge(v)),
+                          ei_t(g.get_in().end(v), mk_edge(v)));
+}
+
+template <class Vertex, bool Compressed>
+inline
+std::pair<typename csr_adj_list<Vertex, Compressed>::adjacency_iterator,
+          typename csr_adj_list<Vertex, Compressed>::adjacency_iterator>
+adjacent_vertices(Vertex v, const csr_adj_list<Vertex, Compressed>& g)
+{
+    typedef typename csr_adj_list<Vertex, Compressed>::adjacency_iterator ai_t;
+    return std::make_pair(ai_t(g.get_out().begin(v)),
+                          ai_t(g.get_out().end(v)));
+}
+
+template <class Vertex, bool Compressed>
+inline
+size_t num_vertices(const csr_adj_list<Vertex, Compressed>& g)
+{
+    return g.num_nodes();
+}
+
+template <class Vertex, bool Compressed>
+inline
+size_t num_edges(const csr_adj_list<Vertex, Compressed>& g)
+{
+    return g.num_arcs();
+}
+
+template <class Vertex, bool Compressed>
+inline
+Vertex source(const typename csr_adj_list<Vertex, Compressed>::edge_descriptor& e,
+              const csr_adj_list<Vertex, Compressed>&)
+{
+    return e.s;
+}
+
+template <class Vertex, bool Compressed>
+inline
+Vertex target(const typename csr_adj_list<Vertex, Compressed>::edge_descriptor& e,
+              const csr_adj_list<Vertex, Compressed>&)
+{
+    return e.t;
+}
+
+//========================================================================
+// Vertex and edge index property maps
+//========================================================================
+
+template <class Vertex, bool Compressed>
+struct property_map<csr_adj_list<Vertex, Compressed>, vertex_index_t>
+{
+    typedef identity_property_map type;
+    typedef type const_type;
+};
+
+template <class Vertex, bool Compressed>
+struct property_map<const csr_adj_list<Vertex, Compressed>, vertex_index_t>
+{
+    typedef identity_property_map type;
+    typedef type const_type;
+};
+
+template <class Vertex, bool Compressed>
+inline identity_property_map
+get(vertex_index_t, const csr_adj_list<Vertex, Compressed>&)
+{
+    return identity_property_map();
+}
+
+template <class Vertex, bool Compressed>
+struct property_map<csr_adj_list<Vertex, Compressed>, edge_index_t>
+{
+    typedef adj_edge_index_property_map<Vertex> type;
+    typedef type const_type;
+};
+
+template <class Vertex, bool Compressed>
+inline adj_edge_index_property_map<Vertex>
+get(edge_index_t, const csr_adj_list<Vertex, Compressed>&)
+{
+    return adj_edge_index_property_map<Vertex>();
+}
+
+} // namespace boost
+
+#endif //GRAPH_CSR_HH
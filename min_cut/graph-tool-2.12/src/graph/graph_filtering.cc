@@ -146,9 +146,19 @@ check_filtered(const Graph &g, const EdgeFilter& edge_filter,
 #endif
 }
 
-// gets the correct graph view at run time
-boost::any GraphInterface::get_graph_view() const
+// gets the correct graph view at run time; if frozen == true, and the graph
+// is frozen and not filtered, the view of the frozen graph is returned
+boost::any GraphInterface::get_graph_view(bool frozen) const
 {
+    if (frozen && is_frozen() && !_vertex_filter_active &&
+        !_edge_filter_active)
+    {
+        GraphInterface& gi = const_cast<GraphInterface&>(*this);
+        if (_fg)
+            return check_directed(*_fg, _reversed, _directed, gi);
+        return check_directed(*_cfg, _reversed, _directed, gi);
+    }
+
     boost::any graph =
         check_filtered(*_mg, _edge_filter_map, _edge_filter_invert,
                        _edge_filter_active, _mg->get_edge_index_range(),
@@ -159,6 +169,48 @@ boost::any GraphInterface::get_graph_view() const
     return graph;
 }
 
+// this will replace the frozen copy of the graph by a new one
+void GraphInterface::freeze(bool compress)
+{
+    if (num_vertices(*_mg) > numeric_limits<uint32_t>::max() ||
+        _mg->get_edge_index_range() > numeric_limits<uint32_t>::max())
+        throw ValueException("Graph is too large to be frozen.");
+    thaw();
+    if (compress)
+        _cfg = std::make_shared<compressed_frozen_graph_t>(*_mg);
+    else
+        _fg = std::make_shared<frozen_graph_t>(*_mg);
+}
+
+// this will remove the frozen copy of the graph
+void GraphInterface::thaw()
+{
+    _fg.reset();
+    _cfg.reset();
+
+    // the stored views of the old frozen graph are no longer valid
+    if (_graph_views.size() > size_t(n_views::value))
+        _graph_views.resize(n_views::value);
+}
+
+// the frozen copy is only used if the graph was not modified since
+template <class FrozenGraph>
+bool is_current(const FrozenGraph& fg, const GraphInterface::multigraph_t& g)
+{
+    return (fg.get_version() == g.get_version() &&
+            num_vertices(fg) == num_vertices(g) &&
+            num_edges(fg) == num_edges(g));
+}
+
+bool GraphInterface::is_frozen() const
+{
+    if (_fg)
+        return is_current(*_fg, *_mg);
+    if (_cfg)
+        return is_current(*_cfg, *_mg);
+    return false;
+}
+
 // these test whether or not the vertex and edge filters are active
 bool GraphInterface::is_vertex_filter_active() const
 { return _vertex_filter_active; }
@@ -38,6 +38,8 @@
 #include <boost/mpl/logical.hpp>
 #include <boost/mpl/inserter.hpp>
 #include <boost/mpl/insert_range.hpp>
+#include <boost/mpl/copy.hpp>
+#include <boost/mpl/find_if.hpp>
 #include <boost/mpl/assert.hpp>
 #include <boost/mpl/plus.hpp>
 #include <boost/mpl/divides.hpp>
@@ -365,6 +367,75 @@ BOOST_MPL_ASSERT_RELATION(n_views::value, == , boost::mpl::int_<6>::value);
 BOOST_MPL_ASSERT_RELATION(n_views::value, == , boost::mpl::int_<3>::value);
 #endif
 
+// frozen graph views
+// ==================
+//
+// If the graph is frozen (see GraphInterface::freeze()) and is not filtered,
+// the actions which include the frozen graph views below in their list of
+// views are run on the frozen (CSR) copy of the graph, in the same reversed
+// or undirected view. The other actions are run on the main graph, as usual,
+// so each algorithm can opt in separately.
+
+typedef GraphInterface::frozen_graph_t frozen_graph_t;
+typedef GraphInterface::compressed_frozen_graph_t compressed_frozen_graph_t;
+
+struct frozen_graph_views:
+    boost::mpl::vector6<frozen_graph_t,
+                        boost::reverse_graph<frozen_graph_t>,
+                        boost::UndirectedAdaptor<frozen_graph_t>,
+                        compressed_frozen_graph_t,
+                        boost::reverse_graph<compressed_frozen_graph_t>,
+                        boost::UndirectedAdaptor<compressed_frozen_graph_t> > {};
+
+struct frozen_directed_views:
+    boost::mpl::vector4<frozen_graph_t,
+                        boost::reverse_graph<frozen_graph_t>,
+                        compressed_frozen_graph_t,
+                        boost::reverse_graph<compressed_frozen_graph_t> > {};
+
+struct frozen_undirected_views:
+    boost::mpl::vector2<boost::UndirectedAdaptor<frozen_graph_t>,
+                        boost::UndirectedAdaptor<compressed_frozen_graph_t> > {};
+
+// the views above, plus the frozen ones
+struct all_graph_views_frozen:
+    boost::mpl::copy<frozen_graph_views,
+                     boost::mpl::back_inserter<all_graph_views> >::type {};
+
+struct always_directed_frozen:
+    boost::mpl::copy<frozen_directed_views,
+                     boost::mpl::back_inserter<always_directed> >::type {};
+
+struct never_directed_frozen:
+    boost::mpl::copy<frozen_undirected_views,
+                     boost::mpl::back_inserter<never_directed> >::type {};
+
+template <class Graph>
+struct is_frozen_view: std::false_type {};
+
+template <class Vertex, bool Compressed>
+struct is_frozen_view<boost::csr_adj_list<Vertex, Compressed> >:
+    std::true_type {};
+
+template <class Graph, class GRef>
+struct is_frozen_view<boost::reverse_graph<Graph, GRef> >:
+    is_frozen_view<Graph> {};
+
+template <class Graph>
+struct is_frozen_view<boost::UndirectedAdaptor<Graph> >:
+    is_frozen_view<Graph> {};
+
+template <class Graph>
+struct is_frozen_view<const Graph>: is_frozen_view<Graph> {};
+
+// true if the list of graph views contains a frozen one
+template <class GraphViews>
+struct has_frozen_views:
+    std::integral_constant<bool,
+        !std::is_same<typename boost::mpl::find_if<
+                          GraphViews, is_frozen_view<boost::mpl::_1> >::type,
+                      typename boost::mpl::end<GraphViews>::type>::value> {};
+
 // run_action() implementation
 // ===========================
 
@@ -450,7 +521,8 @@ struct graph_action
     template <class... Args>
     void operator()(Args&&... args) const
     {
-        boost::any gview = _g.get_graph_view();
+        boost::any gview =
+            _g.get_graph_view(has_frozen_views<GraphViews>::value);
         bool found = boost::mpl::nested_for_each<graph_view_pointers,TRS...>
             (_a, gview, std::forward<Args>(args)...);
         if (!found)
@@ -501,7 +573,8 @@ typename std::shared_ptr<Graph>
 retrieve_graph_view(GraphInterface& gi, Graph& init)
 {
     typedef typename std::remove_const<Graph>::type g_t;
-    size_t index = boost::mpl::find<detail::all_graph_views,g_t>::type::pos::value;
+    size_t index =
+        boost::mpl::find<detail::all_graph_views_frozen,g_t>::type::pos::value;
     auto& graph_views = gi.get_graph_views();
     if (index >= graph_views.size())
         graph_views.resize(index + 1);
@@ -91,7 +91,8 @@ std::ostringstream& operator<<(std::ostringstream& stream, const boost::python::
 
 #include <boost/graph/graphviz.hpp>
 
-#include "graph_io_binary.hh"
+#include "graph_io_mmap.hh"
+#include "numpy_bind.hh"
 
 // the following source & sink provide iostream access to python file-like
 // objects
@@ -333,7 +334,8 @@ std::pair<FakeEdgeIterator<Graph>,
 
 void build_stream(boost::iostreams::filtering_stream<boost::iostreams::input>& stream,
                   const string& file, boost::python::object& pfile,
-                  std::ifstream& file_stream)
+                  std::ifstream& file_stream, chunked_gzip_ibuf& chunked_buf,
+                  std::istream& chunked_stream)
 {
     stream.reset();
     if (file == "-")
@@ -349,7 +351,15 @@ void build_stream(boost::iostreams::filtering_stream<boost::iostreams::input>& s
                 stream.push(boost::iostreams::gzip_decompressor());
             if (boost::ends_with(file,".bz2"))
                 stream.push(boost::iostreams::bzip2_decompressor());
-            stream.push(file_stream);
+            if (boost::ends_with(file,".pgz"))
+            {
+                chunked_buf.open(file_stream);
+                stream.push(chunked_stream);
+            }
+            else
+            {
+                stream.push(file_stream);
+            }
         }
         else
         {
@@ -368,15 +378,24 @@ boost::python::tuple GraphInterface::read_from_file(string file,
                                                     boost::python::list ignore_ep,
                                                     boost::python::list ignore_gp)
 {
-    if (format != "gt" && format != "dot" && format != "xml" && format != "gml")
+    if (format != "gt" && format != "gtm" && format != "dot" &&
+        format != "xml" && format != "gml")
         throw ValueException("error reading from file '" + file +
                              "': requested invalid format '" + format + "'");
+    if (format == "gtm" && (pfile != boost::python::object() || file == "-"))
+        throw ValueException("error reading from file '" + file +
+                             "': the gtm format can only be read from a "
+                             "file name");
     try
     {
         boost::iostreams::filtering_stream<boost::iostreams::input>
             stream;
         std::ifstream file_stream;
-        build_stream(stream, file, pfile, file_stream);
+        chunked_gzip_ibuf chunked_buf;
+        std::istream chunked_stream(&chunked_buf);
+        if (format != "gtm")
+            build_stream(stream, file, pfile, file_stream, chunked_buf,
+                         chunked_stream);
 
         std::unordered_set<std::string> ivp, iep, igp;
         for (int i = 0; i < len(ignore_vp); ++i)
@@ -389,6 +408,9 @@ boost::python::tuple GraphInterface::read_from_file(string file,
         create_dynamic_map<vertex_index_map_t,edge_index_map_t>
             map_creator(_vertex_index, _edge_index);
         dynamic_properties dp(map_creator);
+        // the new graph may have the same version as the old one, so the
+        // frozen copy must be discarded explicitly
+        thaw();
         *_mg = multigraph_t();
 
         if (format == "dot")
@@ -402,12 +424,25 @@ boost::python::tuple GraphInterface::read_from_file(string file,
 
 
         boost::python::dict vprops, eprops, gprops;
-        if (format == "gt")
+        if (format == "gt" || format == "gtm")
         {
             vector<pair<string, boost::any>> agprops, avprops, aeprops;
-            stream.exceptions(ios_base::badbit | ios_base::failbit | ios_base::eofbit);
-            _directed = read_graph(stream, *_mg, agprops, avprops, aeprops, igp,
-                                   ivp, iep);
+            if (format == "gt")
+            {
+                // chunked files are read directly, so that the ignored
+                // properties can be skipped by seeking
+                std::istream& s = (chunked_buf.is_open()) ?
+                    chunked_stream : stream;
+                s.exceptions(ios_base::badbit | ios_base::failbit |
+                             ios_base::eofbit);
+                _directed = read_graph(s, *_mg, agprops, avprops, aeprops,
+                                       igp, ivp, iep);
+            }
+            else
+            {
+                _directed = read_graph_mapped(file, *_mg, agprops, avprops,
+                                              aeprops, igp, ivp, iep);
+            }
             for (auto& p : agprops)
                 gprops[p.first] = find_property_map(p.second, _graph_index);
             for (auto& p : avprops)
@@ -506,9 +541,15 @@ struct do_write_to_binary_file
     void operator()(ostream& stream, Graph& g, IndexMap index_map, size_t N,
                     bool directed, vector<pair<string, boost::any >> & gprops,
                     vector<pair<string, boost::any >> & vprops,
-                    vector<pair<string, boost::any >> & eprops) const
+                    vector<pair<string, boost::any >> & eprops,
+                    const string& format) const
     {
-        write_graph(g, index_map, N, directed, gprops, vprops, eprops, stream);
+        if (format == "gtm")
+            write_graph_mapped(g, index_map, N, directed, gprops, vprops,
+                               eprops, stream);
+        else
+            write_graph(g, index_map, N, directed, gprops, vprops, eprops,
+                        stream);
     }
 };
 
@@ -527,9 +568,16 @@ struct generate_index
 void GraphInterface::write_to_file(string file, boost::python::object pfile,
                                    string format, boost::python::list props)
 {
-    if (format != "gt" && format != "xml" && format != "dot" && format != "gml")
+    if (format != "gt" && format != "gtm" && format != "xml" &&
+        format != "dot" && format != "gml")
         throw ValueException("error writing to file '" + file +
                              "': requested invalid format '" + format + "'");
+    if (format == "gtm" && (boost::ends_with(file, ".gz") ||
+                            boost::ends_with(file, ".bz2") ||
+                            boost::ends_with(file, ".pgz") ||
+                            boost::ends_with(file, ".xz")))
+        throw ValueException("error writing to file '" + file +
+                             "': the gtm format cannot be compressed");
     try
     {
         boost::iostreams::filtering_stream<boost::iostreams::output> stream;
@@ -547,6 +595,8 @@ void GraphInterface::write_to_file(string file, boost::python::object pfile,
                     stream.push(boost::iostreams::gzip_compressor());
                 if (boost::ends_with(file,".bz2"))
                     stream.push(boost::iostreams::bzip2_compressor());
+                if (boost::ends_with(file,".pgz"))
+                    stream.push(chunked_gzip_compressor());
                 stream.push(file_stream);
             }
             else
@@ -557,7 +607,7 @@ void GraphInterface::write_to_file(string file, boost::python::object pfile,
         }
         stream.exceptions(ios_base::badbit | ios_base::failbit);
 
-        if (format == "gt")
+        if (format == "gt" || format == "gtm")
         {
             typedef property_map_types::apply<value_types,
                                               GraphInterface::graph_index_map_t>::type
@@ -594,7 +644,8 @@ void GraphInterface::write_to_file(string file, boost::python::object pfile,
                                                 directed,
                                                 std::ref(agprops),
                                                 std::ref(avprops),
-                                                std::ref(aeprops)))();
+                                                std::ref(aeprops),
+                                                std::cref(format)))();
             }
             else
             {
@@ -606,7 +657,8 @@ void GraphInterface::write_to_file(string file, boost::python::object pfile,
                                                 directed,
                                                 std::ref(agprops),
                                                 std::ref(avprops),
-                                                std::ref(aeprops)))();
+                                                std::ref(aeprops),
+                                                std::cref(format)))();
             }
 
             _directed = directed;
@@ -671,3 +723,76 @@ void GraphInterface::write_to_file(string file, boost::python::object pfile,
         throw IOException("error writing to file '" + file + "':" + e.what());
     }
 }
+
+// Python interface to MappedGraph. The arrays returned are read-only views of
+// the mapped file, which is kept open as long as they exist.
+
+python::object get_mapped_offsets(python::object omg)
+{
+    MappedGraph& mg = python::extract<MappedGraph&>(omg);
+    return wrap_array_view(mg.offsets(), mg.num_vertices() + 1, omg);
+}
+
+python::object get_mapped_targets(python::object omg)
+{
+    MappedGraph& mg = python::extract<MappedGraph&>(omg);
+    python::object targets;
+    mg.dispatch_targets([&](auto ts)
+                        {
+                            targets = wrap_array_view(ts, mg.num_edges(), omg);
+                        });
+    return targets;
+}
+
+python::list get_mapped_properties(python::object omg)
+{
+    MappedGraph& mg = python::extract<MappedGraph&>(omg);
+    python::list props;
+    for (auto& p : mg.properties())
+    {
+        string kind;
+        size_t count;
+        switch (p.type)
+        {
+        case property_type::Graph:
+            kind = "g";
+            count = 1;
+            break;
+        case property_type::Vertex:
+            kind = "v";
+            count = mg.num_vertices();
+            break;
+        default:
+            kind = "e";
+            count = mg.num_edges();
+        }
+
+        python::object values;
+        dispatch_scalar_type(p.value_type,
+                             [&](auto val)
+                             {
+                                 typedef decltype(val) val_t;
+                                 auto data = reinterpret_cast<const val_t*>(p.data);
+                                 values = wrap_array_view(data, count, omg);
+                             });
+        props.append(python::make_tuple(kind, p.name,
+                                        string(type_names[p.value_type]),
+                                        values));
+    }
+    return props;
+}
+
+void export_mapped_graph()
+{
+    using namespace boost::python;
+
+    class_<MappedGraph, boost::noncopyable>("MappedGraph", init<string>())
+        .def("get_num_vertices", &MappedGraph::num_vertices)
+        .def("get_num_edges", &MappedGraph::num_edges)
+        .def("get_directed", &MappedGraph::is_directed)
+        .def("get_comment", &MappedGraph::comment,
+             return_value_policy<copy_const_reference>())
+        .def("get_offsets", &get_mapped_offsets)
+        .def("get_targets", &get_mapped_targets)
+        .def("get_properties", &get_mapped_properties);
+}
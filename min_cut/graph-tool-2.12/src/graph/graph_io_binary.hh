@@ -24,6 +24,8 @@
 #include "graph_selectors.hh"
 #include <unordered_set>
 
+#include "graph_io_chunked.hh"
+
 namespace graph_tool
 {
 
@@ -97,7 +99,7 @@ void read(std::istream& s, T& v)
 template <bool BE, typename T>
 void skip(std::istream& s, const T&)
 {
-    s.ignore(sizeof(T));
+    skip_bytes(s, sizeof(T));
 };
 
 template <bool BE, typename T>
@@ -118,7 +120,7 @@ void skip(std::istream& s, const std::vector<T>&)
 {
     uint64_t size = 0;
     read<BE>(s, size);
-    s.ignore(sizeof(T) * size);
+    skip_bytes(s, sizeof(T) * size);
 };
 
 template <bool BE>
@@ -147,7 +149,7 @@ void skip(std::istream& s, const std::string&)
 {
     uint64_t size = 0;
     read<BE>(s, size);
-    s.ignore(size);
+    skip_bytes(s, size);
 };
 
 template <bool BE>
@@ -401,6 +403,17 @@ struct read_property_dispatch
                     read<BE>(s, prop[x]);
                 aprop = prop;
             }
+            else if (std::is_scalar<T>::value)
+            {
+                // values of fixed size are skipped all at once
+                size_t n = 0;
+                for (auto x : RangeTraits::get_range(g))
+                {
+                    (void)x;
+                    ++n;
+                }
+                skip_bytes(s, sizeof(T) * n);
+            }
             else
             {
                 T y;
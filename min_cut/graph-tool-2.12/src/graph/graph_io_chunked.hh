@@ -0,0 +1,404 @@
+// graph-tool -- a general graph modification and manipulation thingy
+//
+// Copyright (C) 2006-2015 Tiago de Paula Peixoto <tiago@skewed.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef GRAPH_IO_CHUNKED_HH
+#define GRAPH_IO_CHUNKED_HH
+
+#include "config.h"
+
+#include <iostream>
+#include <streambuf>
+#include <vector>
+#include <algorithm>
+#include <zlib.h>
+
+#include <boost/iostreams/categories.hpp>
+#include <boost/iostreams/operations.hpp>
+
+#ifdef USING_OPENMP
+#include <omp.h>
+#endif
+
+#include "graph_exceptions.hh"
+
+namespace graph_tool
+{
+
+// Chunked gzip compression (".pgz" files). The data is split into chunks of
+// fixed size, which are compressed independently, each as a separate gzip
+// member, so that they can be compressed and decompressed in parallel. The
+// result is a valid gzip file, which can be read by any other gzip
+// decompressor.
+//
+// The header of each member has an extra field (with identifier "GT") which
+// contains the compressed size of the member and the uncompressed size of the
+// chunk, both as 64-bit little-endian integers. The chunk index can therefore
+// be recovered by hopping from header to header, without decompressing
+// anything, and any position of the uncompressed data can be reached by
+// decompressing only the chunk which contains it.
+
+const size_t _chunk_size = 1 << 20;
+const size_t _chunk_header_size = 32;
+const size_t _chunk_trailer_size = 8;
+
+inline void put_le(unsigned char* p, uint64_t x, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        p[i] = (x >> (8 * i)) & 0xff;
+}
+
+inline uint64_t get_le(const unsigned char* p, size_t n)
+{
+    uint64_t x = 0;
+    for (size_t i = 0; i < n; ++i)
+        x |= uint64_t(p[i]) << (8 * i);
+    return x;
+}
+
+inline size_t chunk_threads()
+{
+#ifdef USING_OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+// compresses data[0:n] into a gzip member; returns false on error
+inline bool compress_chunk(const char* data, size_t n, std::vector<char>& out)
+{
+    z_stream zs = {};
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK)
+        return false;
+    size_t bound = deflateBound(&zs, n);
+    out.resize(_chunk_header_size + bound + _chunk_trailer_size);
+    zs.next_in = (Bytef*) data;
+    zs.avail_in = n;
+    zs.next_out = (Bytef*) out.data() + _chunk_header_size;
+    zs.avail_out = bound;
+    int ret = deflate(&zs, Z_FINISH);
+    size_t csize = zs.total_out;
+    deflateEnd(&zs);
+    if (ret != Z_STREAM_END)
+        return false;
+
+    size_t size = _chunk_header_size + csize + _chunk_trailer_size;
+    out.resize(size);
+    unsigned char* h = (unsigned char*) out.data();
+    const unsigned char head[] = {0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 255,
+                                  20, 0, 'G', 'T', 16, 0};
+    std::copy(head, head + sizeof(head), h);
+    put_le(h + 16, size, 8);
+    put_le(h + 24, n, 8);
+    unsigned char* t = h + size - _chunk_trailer_size;
+    put_le(t, crc32(0, (const Bytef*) data, n), 4);
+    put_le(t + 4, n, 4);
+    return true;
+}
+
+// decompresses a gzip member written by compress_chunk() into out[0:n];
+// returns false on error
+inline bool decompress_chunk(const char* member, size_t size, char* out,
+                             size_t n)
+{
+    z_stream zs = {};
+    if (inflateInit2(&zs, -MAX_WBITS) != Z_OK)
+        return false;
+    zs.next_in = (Bytef*) member + _chunk_header_size;
+    zs.avail_in = size - _chunk_header_size - _chunk_trailer_size;
+    zs.next_out = (Bytef*) out;
+    zs.avail_out = n;
+    int ret = inflate(&zs, Z_FINISH);
+    bool ok = (ret == Z_STREAM_END && zs.total_out == n);
+    inflateEnd(&zs);
+    const unsigned char* t = (const unsigned char*) member + size -
+        _chunk_trailer_size;
+    return ok && get_le(t, 4) == crc32(0, (const Bytef*) out, n);
+}
+
+// Output filter which compresses the stream in chunks, one per thread at a
+// time.
+
+class chunked_gzip_compressor
+{
+public:
+    typedef char char_type;
+    struct category
+        : boost::iostreams::output,
+          boost::iostreams::filter_tag,
+          boost::iostreams::multichar_tag,
+          boost::iostreams::closable_tag {};
+
+    chunked_gzip_compressor() : _nchunks(0) {}
+
+    template <class Sink>
+    std::streamsize write(Sink& snk, const char* s, std::streamsize n)
+    {
+        _buf.insert(_buf.end(), s, s + n);
+        if (_buf.size() >= _chunk_size * chunk_threads())
+            flush(snk, false);
+        return n;
+    }
+
+    template <class Sink>
+    void close(Sink& snk)
+    {
+        flush(snk, true);
+        _buf.clear();
+        _nchunks = 0;
+    }
+
+private:
+    // compresses the full chunks in the buffer, or all of it if last == true
+    template <class Sink>
+    void flush(Sink& snk, bool last)
+    {
+        int i, N = _buf.size() / _chunk_size;
+        if (last && (_buf.size() % _chunk_size > 0 || _nchunks + N == 0))
+            N++;
+
+        std::vector<std::vector<char>> out(N);
+        bool ok = true;
+        #pragma omp parallel for default(shared) private(i) \
+            schedule(runtime) if (N > 1)
+        for (i = 0; i < N; ++i)
+        {
+            size_t begin = i * _chunk_size;
+            size_t n = std::min(_chunk_size, _buf.size() - begin);
+            if (!compress_chunk(_buf.data() + begin, n, out[i]))
+                ok = false;
+        }
+        if (!ok)
+            throw IOException("error compressing chunk");
+
+        for (auto& c : out)
+            boost::iostreams::write(snk, c.data(), c.size());
+        _nchunks += N;
+
+        size_t done = std::min(N * _chunk_size, _buf.size());
+        _buf.erase(_buf.begin(), _buf.begin() + done);
+    }
+
+    std::vector<char> _buf;
+    size_t _nchunks;
+};
+
+// Input buffer which reads a chunked gzip file. Each time a chunk which is not
+// in memory is needed, it is decompressed together with the chunks following
+// it, one per thread. Seeking moves to any position of the uncompressed data,
+// and decompresses only the chunk which contains it, once it is read.
+
+class chunked_gzip_ibuf: public std::streambuf
+{
+public:
+    chunked_gzip_ibuf() : _file(nullptr), _k(0), _off(0), _first(0) {}
+
+    // reads the chunk index of the file
+    void open(std::istream& file)
+    {
+        _file = &file;
+        _chunks.clear();
+        file.seekg(0, std::ios_base::end);
+        size_t size = file.tellg();
+        size_t pos = 0, upos = 0;
+        unsigned char h[_chunk_header_size];
+        while (pos < size)
+        {
+            if (size - pos < _chunk_header_size + _chunk_trailer_size)
+                throw IOException("Error reading graph: truncated chunked "
+                                  "gzip file");
+            file.seekg(pos);
+            file.read((char*) h, _chunk_header_size);
+            if (h[0] != 0x1f || h[1] != 0x8b || h[2] != 8 || h[3] != 4 ||
+                get_le(h + 10, 2) != 20 || h[12] != 'G' || h[13] != 'T' ||
+                get_le(h + 14, 2) != 16)
+                throw IOException("Error reading graph: invalid chunk header "
+                                  "(not a chunked gzip file?)");
+            chunk_t c;
+            c.pos = pos;
+            c.size = get_le(h + 16, 8);
+            c.upos = upos;
+            c.usize = get_le(h + 24, 8);
+            if (c.size < _chunk_header_size + _chunk_trailer_size ||
+                c.size > size - pos)
+                throw IOException("Error reading graph: truncated chunked "
+                                  "gzip file");
+            _chunks.push_back(c);
+            pos += c.size;
+            upos += c.usize;
+        }
+        _total = upos;
+        _k = 0;
+        _off = 0;
+        _cache.clear();
+        setg(nullptr, nullptr, nullptr);
+    }
+
+    bool is_open() const { return _file != nullptr; }
+
+protected:
+    virtual int_type underflow()
+    {
+        if (gptr() < egptr())
+            return traits_type::to_int_type(*gptr());
+
+        // the position of the next byte, moved past the chunks which were
+        // read to the end
+        size_t k = _k;
+        size_t off = (eback() != nullptr) ? gptr() - eback() : _off;
+        while (k < _chunks.size() && off >= _chunks[k].usize)
+        {
+            off -= _chunks[k].usize;
+            ++k;
+        }
+        _k = k;
+        _off = off;
+        if (k >= _chunks.size())
+        {
+            setg(nullptr, nullptr, nullptr);
+            return traits_type::eof();
+        }
+        char* data = load(k);
+        setg(data, data + off, data + _chunks[k].usize);
+        return traits_type::to_int_type(*gptr());
+    }
+
+    virtual pos_type seekoff(off_type off, std::ios_base::seekdir way,
+                             std::ios_base::openmode which)
+    {
+        if (which & std::ios_base::out)
+            return pos_type(off_type(-1));
+        off_type pos;
+        if (way == std::ios_base::beg)
+            pos = off;
+        else if (way == std::ios_base::cur)
+            pos = tell() + off;
+        else
+            pos = _total + off;
+        return seekpos(pos, which);
+    }
+
+    virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which)
+    {
+        if ((which & std::ios_base::out) || off_type(pos) < 0 ||
+            size_t(off_type(pos)) > _total)
+            return pos_type(off_type(-1));
+        size_t p = off_type(pos);
+
+        if (p == _total)
+        {
+            _k = _chunks.size();
+            _off = 0;
+            setg(nullptr, nullptr, nullptr);
+            return pos;
+        }
+
+        if (eback() != nullptr && p >= _chunks[_k].upos &&
+            p < _chunks[_k].upos + _chunks[_k].usize)
+        {
+            setg(eback(), eback() + (p - _chunks[_k].upos), egptr());
+            return pos;
+        }
+
+        // the chunk is only decompressed when it is read
+        auto iter = std::upper_bound(_chunks.begin(), _chunks.end(), p,
+                                     [](size_t x, const chunk_t& c)
+                                     { return x < c.upos; });
+        _k = (iter - _chunks.begin()) - 1;
+        _off = p - _chunks[_k].upos;
+        setg(nullptr, nullptr, nullptr);
+        return pos;
+    }
+
+private:
+    struct chunk_t
+    {
+        size_t pos;
+        size_t size;
+        size_t upos;
+        size_t usize;
+    };
+
+    size_t tell() const
+    {
+        if (_k >= _chunks.size())
+            return _total;
+        size_t off = (eback() != nullptr) ? gptr() - eback() : _off;
+        return _chunks[_k].upos + off;
+    }
+
+    // decompresses chunk k, unless it is already in memory, together with
+    // the chunks which follow it
+    char* load(size_t k)
+    {
+        if (k >= _first && k < _first + _cache.size())
+            return _cache[k - _first].data();
+
+        int i, N = std::min(chunk_threads(), _chunks.size() - k);
+        size_t begin = _chunks[k].pos;
+        size_t end = _chunks[k + N - 1].pos + _chunks[k + N - 1].size;
+        _raw.resize(end - begin);
+        _file->seekg(begin);
+        _file->read(_raw.data(), _raw.size());
+
+        _first = k;
+        _cache.resize(N);
+        bool ok = true;
+        #pragma omp parallel for default(shared) private(i) \
+            schedule(runtime) if (N > 1)
+        for (i = 0; i < N; ++i)
+        {
+            auto& c = _chunks[k + i];
+            _cache[i].resize(c.usize);
+            if (!decompress_chunk(_raw.data() + (c.pos - begin), c.size,
+                                  _cache[i].data(), c.usize))
+                ok = false;
+        }
+        if (!ok)
+        {
+            _cache.clear();
+            throw IOException("Error reading graph: corrupted chunk in "
+                              "chunked gzip file");
+        }
+        return _cache[0].data();
+    }
+
+    std::istream* _file;
+    std::vector<chunk_t> _chunks;
+    size_t _total;
+    size_t _k;
+    size_t _off;
+    size_t _first;
+    std::vector<std::vector<char>> _cache;
+    std::vector<char> _raw;
+};
+
+// skips n bytes of s; if s reads from a chunked gzip file, the bytes are
+// skipped by seeking, without decompressing the chunks which lie entirely
+// inside of them
+inline void skip_bytes(std::istream& s, size_t n)
+{
+    if (dynamic_cast<chunked_gzip_ibuf*>(s.rdbuf()) != nullptr)
+        s.seekg(n, std::ios_base::cur);
+    else
+        s.ignore(n);
+}
+
+} // graph_tool namespace
+
+#endif // GRAPH_IO_CHUNKED_HH
@@ -0,0 +1,556 @@
+// graph-tool -- a general graph modification and manipulation thingy
+//
+// Copyright (C) 2006-2015 Tiago de Paula Peixoto <tiago@skewed.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef GRAPH_IO_MMAP_HH
+#define GRAPH_IO_MMAP_HH
+
+#include <cstring>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include "graph_io_binary.hh"
+
+namespace graph_tool
+{
+
+// The "gtm" format is an uncompressed variant of the .gt format, laid out so
+// that it can be memory-mapped and used in place, without copying:
+//
+//   - a 64-byte header (mmap_header below), followed by a comment string;
+//
+//   - the out-edges in compressed sparse row form: N + 1 offsets (uint64_t),
+//     followed by the E targets, with the smallest unsigned integer width
+//     which fits N. The out-neighbours of vertex v are the targets in the
+//     range [offsets[v], offsets[v + 1]), and the edges are numbered in this
+//     order. Undirected graphs store each edge once, as in the .gt format;
+//
+//   - the property maps, each with a 16-byte header (mmap_property_header
+//     below), its name, and its values, in vertex or edge order. Only scalar
+//     value types are allowed, with the same type indexes as the .gt format.
+//
+// Every section starts at an offset which is a multiple of 64 bytes. The
+// values are stored in the byte order of the machine which wrote the file,
+// which must match the one which reads it.
+
+const char* _mmap_magic = u8"⛾ gtm";
+const size_t _mmap_magic_length = 7;
+const uint8_t _mmap_version = 1;
+const size_t _mmap_align = 64;
+
+struct mmap_header
+{
+    char magic[_mmap_magic_length];
+    uint8_t version;
+    uint8_t big_endian;
+    uint8_t directed;
+    uint8_t target_width;
+    uint8_t _pad0[5];
+    uint64_t N;
+    uint64_t E;
+    uint64_t nprops;
+    uint64_t comment_size;
+    uint8_t _pad1[16];
+};
+
+struct mmap_property_header
+{
+    property_type type;
+    uint8_t value_type;
+    uint8_t _pad[6];
+    uint64_t name_size;
+};
+
+static_assert(sizeof(mmap_header) == _mmap_align, "bad mmap_header size");
+static_assert(sizeof(mmap_property_header) == 16,
+              "bad mmap_property_header size");
+
+// index of T in val_types, as stored in the files
+template <class T>
+constexpr uint8_t value_type_index()
+{
+    typedef typename mpl::find<val_types, T>::type pos;
+    return mpl::distance<typename mpl::begin<val_types>::type, pos>::type::value;
+}
+
+// calls f(T()) for the scalar type T with the given index, and returns false
+// if there is none
+template <class F>
+bool dispatch_scalar_type(uint8_t val, F&& f)
+{
+    bool found = false;
+    mpl::for_each<scalar_types>
+        ([&](auto x)
+         {
+             if (value_type_index<decltype(x)>() == val)
+             {
+                 f(x);
+                 found = true;
+             }
+         });
+    return found;
+}
+
+inline size_t mmap_padding(size_t pos)
+{
+    return (_mmap_align - pos % _mmap_align) % _mmap_align;
+}
+
+// Writer
+// ======
+
+class mmap_writer
+{
+public:
+    mmap_writer(std::ostream& s): _s(s), _pos(0) {}
+
+    template <class T>
+    void write(const T* data, size_t n)
+    {
+        _s.write(reinterpret_cast<const char*>(data), sizeof(T) * n);
+        _pos += sizeof(T) * n;
+    }
+
+    void align()
+    {
+        char zeros[_mmap_align] = {};
+        size_t n = mmap_padding(_pos);
+        _s.write(zeros, n);
+        _pos += n;
+    }
+
+private:
+    std::ostream& _s;
+    size_t _pos;
+};
+
+template <class Vint, class Graph, class VProp>
+void write_mapped_targets(Graph& g, const VProp& vindex, mmap_writer& w)
+{
+    for (auto v : vertices_range(g))
+    {
+        for (auto e : out_edges_range(v, g))
+        {
+            Vint u = vindex[target(e, g)];
+            w.write(&u, 1);
+        }
+    }
+}
+
+template <class Graph>
+void write_mapped_property(Graph& g, property_type pt, const std::string& name,
+                           boost::any& aprop, mmap_writer& w)
+{
+    bool found = false;
+
+    // writes the values of prop, converted to val_t, for each key given by
+    // for_each_key(f)
+    auto put = [&](auto val, auto&& for_each_key, auto prop)
+    {
+        typedef decltype(val) val_t;
+        mmap_property_header h = {};
+        h.type = pt;
+        h.value_type = value_type_index<val_t>();
+        h.name_size = name.size();
+        w.write(&h, 1);
+        w.write(name.data(), name.size());
+        w.align();
+        for_each_key([&](auto x)
+                     {
+                         val_t y = prop[x];
+                         w.write(&y, 1);
+                     });
+        w.align();
+        found = true;
+    };
+
+    auto put_scalar = [&](auto index, auto&& for_each_key)
+    {
+        mpl::for_each<scalar_types>
+            ([&](auto val)
+             {
+                 typedef typename property_map_type::apply
+                     <decltype(val), decltype(index)>::type pmap_t;
+                 if (!found && aprop.type() == typeid(pmap_t))
+                     put(val, for_each_key, any_cast<pmap_t>(aprop));
+             });
+        // the index maps are stored as int64_t, as in the .gt format
+        if (!found && aprop.type() == typeid(decltype(index)))
+            put(int64_t(), for_each_key, any_cast<decltype(index)>(aprop));
+    };
+
+    switch (pt)
+    {
+    case property_type::Graph:
+        put_scalar(GraphInterface::graph_index_map_t(0),
+                   [&](auto&& f) { f(graph_property_tag()); });
+        break;
+    case property_type::Vertex:
+        put_scalar(GraphInterface::vertex_index_map_t(),
+                   [&](auto&& f)
+                   {
+                       for (auto v : vertices_range(g))
+                           f(v);
+                   });
+        break;
+    case property_type::Edge:
+        // the edges are stored in the order of the adjacency lists
+        put_scalar(GraphInterface::edge_index_map_t(),
+                   [&](auto&& f)
+                   {
+                       for (auto v : vertices_range(g))
+                           for (auto e : out_edges_range(v, g))
+                               f(e);
+                   });
+        break;
+    }
+
+    if (!found)
+        throw ValueException("Error writing graph: property map '" + name +
+                             "' does not have a scalar value type, and "
+                             "cannot be stored in the gtm format");
+}
+
+template <class Graph, class VProp>
+void write_graph_mapped(Graph& g, const VProp& vindex, size_t N, bool directed,
+                        std::vector<std::pair<std::string, boost::any>>& gprops,
+                        std::vector<std::pair<std::string, boost::any>>& vprops,
+                        std::vector<std::pair<std::string, boost::any>>& eprops,
+                        std::ostream& s)
+{
+    uint64_t E = 0;
+    for (auto v : vertices_range(g))
+        E += out_degree(v, g);
+
+    string comment = "graph-tool memory-mapped binary file "
+        "(http:://graph-tool.skewed.de) generated by version " VERSION
+        " (commit " GIT_COMMIT ", " GIT_COMMIT_DATE ")";
+
+    mmap_header h = {};
+    memcpy(h.magic, _mmap_magic, _mmap_magic_length);
+    h.version = _mmap_version;
+    h.big_endian = is_bigendian();
+    h.directed = directed;
+    if (N <= numeric_limits<uint8_t>::max())
+        h.target_width = 1;
+    else if (N <= numeric_limits<uint16_t>::max())
+        h.target_width = 2;
+    else if (N <= numeric_limits<uint32_t>::max())
+        h.target_width = 4;
+    else
+        h.target_width = 8;
+    h.N = N;
+    h.E = E;
+    h.nprops = gprops.size() + vprops.size() + eprops.size();
+    h.comment_size = comment.size();
+
+    mmap_writer w(s);
+    w.write(&h, 1);
+    w.write(comment.data(), comment.size());
+    w.align();
+
+    uint64_t pos = 0;
+    w.write(&pos, 1);
+    for (auto v : vertices_range(g))
+    {
+        pos += out_degree(v, g);
+        w.write(&pos, 1);
+    }
+    w.align();
+
+    switch (h.target_width)
+    {
+    case 1:
+        write_mapped_targets<uint8_t>(g, vindex, w);
+        break;
+    case 2:
+        write_mapped_targets<uint16_t>(g, vindex, w);
+        break;
+    case 4:
+        write_mapped_targets<uint32_t>(g, vindex, w);
+        break;
+    default:
+        write_mapped_targets<uint64_t>(g, vindex, w);
+    }
+    w.align();
+
+    for (auto& p : gprops)
+        write_mapped_property(g, property_type::Graph, p.first, p.second, w);
+    for (auto& p : vprops)
+        write_mapped_property(g, property_type::Vertex, p.first, p.second, w);
+    for (auto& p : eprops)
+        write_mapped_property(g, property_type::Edge, p.first, p.second, w);
+}
+
+// Reader
+// ======
+
+// A read-only view of a gtm file, which is mapped into memory and used in
+// place. The pointers returned remain valid for the lifetime of the object.
+
+class MappedGraph
+{
+public:
+    struct property_t
+    {
+        property_type type;
+        uint8_t value_type;
+        std::string name;
+        const char* data;
+    };
+
+    MappedGraph(const std::string& file)
+    {
+        try
+        {
+            _file.open(file);
+        }
+        catch (std::ios_base::failure& e)
+        {
+            throw IOException("error reading from file '" + file + "': " +
+                              e.what());
+        }
+
+        auto& h = *reinterpret_cast<const mmap_header*>
+            (get(0, sizeof(mmap_header)));
+        if (strncmp(h.magic, _mmap_magic, _mmap_magic_length) != 0)
+            throw IOException("Error reading graph: Invalid magic number");
+        if (h.version != _mmap_version)
+            throw IOException("Error reading graph: Invalid format version " +
+                              boost::lexical_cast<std::string>(int(h.version)));
+        if (h.big_endian != is_bigendian())
+            throw IOException("Error reading graph: the file was written with "
+                              "a different byte order, and cannot be mapped");
+        if (h.target_width != 1 && h.target_width != 2 &&
+            h.target_width != 4 && h.target_width != 8)
+            throw IOException("Error reading graph: invalid target width " +
+                              boost::lexical_cast<std::string>
+                              (int(h.target_width)));
+        _directed = h.directed;
+        _N = h.N;
+        _E = h.E;
+        _target_width = h.target_width;
+
+        // N and E are bounded by the file size, so that the sizes of the
+        // arrays below cannot overflow
+        if (_N >= _file.size() / sizeof(uint64_t) ||
+            _E > _file.size() / _target_width)
+            throw IOException("Error reading graph: invalid number of "
+                              "vertices or edges");
+
+        size_t pos = sizeof(mmap_header);
+        _comment.assign(get(pos, h.comment_size), h.comment_size);
+        pos = next(pos, h.comment_size);
+
+        _offsets = reinterpret_cast<const uint64_t*>
+            (get(pos, _N + 1, sizeof(uint64_t)));
+        pos = next(pos, (_N + 1) * sizeof(uint64_t));
+        if (_offsets[0] != 0 || _offsets[_N] != _E)
+            throw IOException("Error reading graph: invalid edge offsets");
+
+        _targets = get(pos, _E, _target_width);
+        pos = next(pos, _E * _target_width);
+
+        for (size_t i = 0; i < h.nprops; ++i)
+        {
+            auto& ph = *reinterpret_cast<const mmap_property_header*>
+                (get(pos, sizeof(mmap_property_header)));
+            pos += sizeof(mmap_property_header);
+
+            property_t p;
+            p.type = ph.type;
+            p.value_type = ph.value_type;
+            p.name.assign(get(pos, ph.name_size), ph.name_size);
+            pos = next(pos, ph.name_size);
+
+            size_t count;
+            switch (p.type)
+            {
+            case property_type::Graph:
+                count = 1;
+                break;
+            case property_type::Vertex:
+                count = _N;
+                break;
+            case property_type::Edge:
+                count = _E;
+                break;
+            default:
+                throw IOException("Error reading graph: invalid property type " +
+                                  boost::lexical_cast<std::string>
+                                  (int(p.type)));
+            }
+
+            size_t size = 0;
+            if (!dispatch_scalar_type(p.value_type,
+                                      [&](auto val) { size = sizeof(val); }))
+                throw IOException("Error reading graph: invalid property "
+                                  "value type index " +
+                                  boost::lexical_cast<std::string>
+                                  (int(p.value_type)));
+            p.data = get(pos, count, size);
+            pos = next(pos, count * size);
+            _props.push_back(p);
+        }
+    }
+
+    size_t num_vertices() const { return _N; }
+    size_t num_edges() const { return _E; }
+    bool is_directed() const { return _directed; }
+    const std::string& comment() const { return _comment; }
+
+    // the N + 1 offsets of the out-edges of each vertex
+    const uint64_t* offsets() const { return _offsets; }
+
+    // the E targets, each stored in target_width() bytes
+    const char* targets() const { return _targets; }
+    size_t target_width() const { return _target_width; }
+
+    const std::vector<property_t>& properties() const { return _props; }
+
+    // calls f(targets) with the targets array converted to its actual type
+    template <class F>
+    void dispatch_targets(F&& f) const
+    {
+        switch (_target_width)
+        {
+        case 1:
+            f(reinterpret_cast<const uint8_t*>(_targets));
+            break;
+        case 2:
+            f(reinterpret_cast<const uint16_t*>(_targets));
+            break;
+        case 4:
+            f(reinterpret_cast<const uint32_t*>(_targets));
+            break;
+        default:
+            f(reinterpret_cast<const uint64_t*>(_targets));
+        }
+    }
+
+private:
+    // returns a pointer to the n values of the given size which start at pos,
+    // which must be inside of the file
+    const char* get(size_t pos, size_t n, size_t size = 1) const
+    {
+        if (pos > _file.size() || n > (_file.size() - pos) / size)
+            throw IOException("Error reading graph: file is truncated");
+        return _file.data() + pos;
+    }
+
+    static size_t next(size_t pos, size_t size)
+    {
+        pos += size;
+        return pos + mmap_padding(pos);
+    }
+
+    boost::iostreams::mapped_file_source _file;
+    bool _directed;
+    size_t _N;
+    size_t _E;
+    size_t _target_width;
+    std::string _comment;
+    const uint64_t* _offsets;
+    const char* _targets;
+    std::vector<property_t> _props;
+};
+
+// reads a gtm file into g, copying its contents, as read_graph() does for the
+// .gt format
+template <class Graph>
+bool read_graph_mapped(const std::string& file, Graph& g,
+                       std::vector<std::pair<std::string, boost::any>>& gprops,
+                       std::vector<std::pair<std::string, boost::any>>& vprops,
+                       std::vector<std::pair<std::string, boost::any>>& eprops,
+                       const std::unordered_set<std::string>& ignore_gp,
+                       const std::unordered_set<std::string>& ignore_vp,
+                       const std::unordered_set<std::string>& ignore_ep)
+{
+    MappedGraph mg(file);
+
+    size_t N = mg.num_vertices();
+    size_t E = mg.num_edges();
+    for (size_t i = 0; i < N; ++i)
+        add_vertex(g);
+
+    const uint64_t* offsets = mg.offsets();
+    mg.dispatch_targets
+        ([&](auto targets)
+         {
+             for (size_t v = 0; v < N; ++v)
+             {
+                 if (offsets[v + 1] < offsets[v] || offsets[v + 1] > E)
+                     throw IOException("error reading graph: invalid edge offsets");
+                 for (size_t i = offsets[v]; i < offsets[v + 1]; ++i)
+                 {
+                     size_t u = targets[i];
+                     if (u >= N)
+                         throw IOException("error reading graph: vertex index not in range");
+                     add_edge(v, u, g);
+                 }
+             }
+         });
+
+    auto copy = [&](auto val, auto index, size_t count,
+                    const MappedGraph::property_t& p)
+    {
+        typedef decltype(val) val_t;
+        typedef typename property_map_type::apply
+            <val_t, decltype(index)>::type pmap_t;
+        pmap_t prop(index);
+        auto& storage = prop.get_storage();
+        storage.resize(count);
+        memcpy(storage.data(), p.data, count * sizeof(val_t));
+        return boost::any(prop);
+    };
+
+    for (auto& p : mg.properties())
+    {
+        dispatch_scalar_type
+            (p.value_type,
+             [&](auto val)
+             {
+                 switch (p.type)
+                 {
+                 case property_type::Graph:
+                     if (ignore_gp.find(p.name) == ignore_gp.end())
+                         gprops.emplace_back
+                             (p.name,
+                              copy(val, graph_range_traits::get_index_map(g),
+                                   1, p));
+                     break;
+                 case property_type::Vertex:
+                     if (ignore_vp.find(p.name) == ignore_vp.end())
+                         vprops.emplace_back
+                             (p.name,
+                              copy(val, vertex_range_traits::get_index_map(g),
+                                   N, p));
+                     break;
+                 case property_type::Edge:
+                     if (ignore_ep.find(p.name) == ignore_ep.end())
+                         eprops.emplace_back
+                             (p.name,
+                              copy(val, edge_range_traits::get_index_map(g),
+                                   E, p));
+                     break;
+                 }
+             });
+    }
+    return mg.is_directed();
+}
+
+} // namespace graph_tool
+
+#endif // GRAPH_IO_MMAP_HH
@@ -105,6 +105,25 @@ boost::python::object wrap_vector_not_owned(vector<ValueType>& vec)
     return o;
 }
 
+// wraps a read-only array which belongs to the object base, which is kept
+// alive as long as the array exists
+template <class ValueType>
+boost::python::object wrap_array_view(const ValueType* data, size_t n,
+                                      boost::python::object base)
+{
+    int val_type = boost::mpl::at<numpy_types,ValueType>::type::value;
+    npy_intp size = n;
+    PyArrayObject* ndarray = (PyArrayObject*)
+        PyArray_SimpleNewFromData(1, &size, val_type,
+                                  const_cast<ValueType*>(data));
+    PyArray_CLEARFLAGS(ndarray, NPY_ARRAY_WRITEABLE);
+    Py_INCREF(base.ptr());
+    PyArray_SetBaseObject(ndarray, base.ptr());
+    boost::python::handle<> x((PyObject*) ndarray);
+    boost::python::object o(x);
+    return o;
+}
+
 
 template <class ValueType, int Dim>
 boost::python::object wrap_multi_array_owned(boost::multi_array<ValueType,Dim>& array)
@@ -24,6 +24,8 @@
 #include "graph.hh"
 #include "graph_selectors.hh"
 #include "graph_util.hh"
+#include "graph_bfs_kernel.hh"
+#include "numpy_bind.hh"
 
 #ifdef HAVE_BOOST_COROUTINE
 #include <boost/coroutine/all.hpp>
@@ -123,6 +125,54 @@ void bfs_search(GraphInterface& g, size_t s, python::object vis)
                       BFSVisitorWrapper(g, vis)))();
 }
 
+// distances from the nearest of the sources, without visitors, with each level
+// of the search expanded in parallel
+
+struct do_bfs_distances
+{
+    template <class Graph, class DistMap>
+    void operator()(Graph& g, const vector<size_t>& sources,
+                    DistMap dist_map) const
+    {
+        typedef typename property_traits<DistMap>::value_type val_t;
+
+        int i, N = num_vertices(g);
+        #pragma omp parallel for default(shared) private(i) \
+            schedule(runtime) if (N > 100)
+        for (i = 0; i < N; ++i)
+            dist_map[i] = numeric_limits<val_t>::max();
+        for (auto s : sources)
+            dist_map[s] = 0;
+
+        BitParallelBFS bfs(num_vertices(g));
+        bfs.search_nearest(g, sources.data(), sources.size(),
+                           [&](size_t v, uint64_t, size_t d)
+                           {
+                               dist_map[v] = d;
+                           },
+                           N > 100);
+    }
+};
+
+void bfs_distances(GraphInterface& gi, python::object osources,
+                   boost::any dist_map)
+{
+    auto asources = get_array<int64_t,1>(osources);
+    vector<size_t> sources;
+    for (auto s : asources)
+    {
+        if (s < 0 || size_t(s) >= gi.get_num_vertices(false))
+            throw ValueException("Invalid source vertex: " +
+                                 lexical_cast<string>(s));
+        sources.push_back(s);
+    }
+
+    run_action<>()
+        (gi, std::bind(do_bfs_distances(), placeholders::_1,
+                       std::cref(sources), placeholders::_2),
+         writable_vertex_scalar_properties())(dist_map);
+}
+
 #ifdef HAVE_BOOST_COROUTINE
 
 typedef boost::coroutines::asymmetric_coroutine<boost::python::object> coro_t;
@@ -188,6 +238,7 @@ void export_bfs()
 {
     using namespace boost::python;
     def("bfs_search", &bfs_search);
+    def("bfs_distances", &bfs_distances);
     def("bfs_search_generator", &bfs_search_generator);
 #ifdef HAVE_BOOST_COROUTINE
     class_<BFSGenerator>("BFSGenerator", no_init)
@@ -18,16 +18,14 @@
 #ifndef GRAPH_DISTANCE_SAMPLED_HH
 #define GRAPH_DISTANCE_SAMPLED_HH
 
-#include <boost/graph/breadth_first_search.hpp>
-#include <boost/graph/dijkstra_shortest_paths.hpp>
-
 #include <boost/python/object.hpp>
 #include <boost/python/list.hpp>
 #include <boost/python/extract.hpp>
 
 #include "histogram.hh"
 #include "numpy_bind.hh"
-#include "hash_map_wrap.hh"
+
+#include "../topology/graph_all_distances.hh"
 
 namespace graph_tool
 {
@@ -36,8 +34,6 @@ using namespace boost;
 
 // retrieves the sampled vertex-vertex distance histogram
 
-struct no_weightS {};
-
 template <class Map>
 struct get_val_type
 {
@@ -54,22 +50,17 @@ struct get_sampled_distance_histogram
 {
 
     template <class Graph, class VertexIndex, class WeightMap, class RNG>
-    void operator()(const Graph& g, VertexIndex vertex_index, WeightMap weights,
+    void operator()(const Graph& g, VertexIndex, WeightMap weights,
                     size_t n_samples, const vector<long double>& obins,
                     python::object& phist, RNG& rng) const
     {
-        typedef typename graph_traits<Graph>::vertex_descriptor vertex_t;
-
-        // select get_vertex_dists based on the existence of weights
-        typedef typename mpl::if_<std::is_same<WeightMap, no_weightS>,
-                                  get_dists_bfs,
-                                  get_dists_djk>::type get_vertex_dists_t;
-
-
         // distance type
         typedef typename get_val_type<WeightMap>::type val_type;
         typedef Histogram<val_type, size_t, 1> hist_t;
 
+        if (has_negative_weights(g, weights))
+            throw ValueException("Edge weights must be non-negative.");
+
         std::array<vector<val_type>,1> bins;
         bins[0].resize(obins.size());
         for (size_t i = 0; i < obins.size(); ++i)
@@ -78,51 +69,32 @@ struct get_sampled_distance_histogram
         hist_t hist(bins);
         SharedHistogram<hist_t> s_hist(hist);
 
-        vector<vertex_t> sources;
+        vector<size_t> sources;
         sources.reserve(num_vertices(g));
-        int i;
-        for (i = 0; i < int(num_vertices(g)); ++i)
-            if (vertex(i,g) != graph_traits<Graph>::null_vertex())
-                sources.push_back(vertex(i,g));
+        for (auto v : vertices_range(g))
+            sources.push_back(v);
         n_samples = min(n_samples, sources.size());
 
-        typename hist_t::point_t point;
-        get_vertex_dists_t get_vertex_dists;
-        #pragma omp parallel for default(shared) private(i,point) \
-            firstprivate(s_hist) schedule(runtime) if (num_vertices(g) * n_samples > 100)
-        for (i = 0; i < int(n_samples); ++i)
+        // the first n_samples positions hold the sampled sources
+        for (size_t i = 0; i < n_samples; ++i)
         {
-            vertex_t v;
-            #pragma omp critical
-            {
-                uniform_int_distribution<size_t> randint(0, sources.size()-1);
-                size_t j = randint(rng);
-                v = sources[j];
-                swap(sources[j], sources.back());
-                sources.pop_back();
-            }
-
-            unchecked_vector_property_map<val_type,VertexIndex>
-                dist_map(vertex_index, num_vertices(g));
-
-            for (size_t j = 0; j < num_vertices(g); ++j)
-            {
-                if (vertex(i,g) != graph_traits<Graph>::null_vertex())
-                    dist_map[vertex(j,g)] =  numeric_limits<val_type>::max();
-            }
-
-            dist_map[v] = 0;
-            get_vertex_dists(g, v, vertex_index, dist_map, weights);
-
-            typename graph_traits<Graph>::vertex_iterator v2, v_end;
-            for (tie(v2, v_end) = vertices(g); v2 != v_end; ++v2)
-                if (*v2 != v &&
-                    dist_map[*v2] != numeric_limits<val_type>::max())
-                {
-                    point[0] = dist_map[*v2];
-                    s_hist.put_value(point);
-                }
+            uniform_int_distribution<size_t> randint(i, sources.size() - 1);
+            swap(sources[i], sources[randint(rng)]);
         }
+        sources.resize(n_samples);
+
+        // the distances from the sampled sources are found together, with the
+        // bit-parallel BFS if there are no weights, and are reduced as they
+        // are found
+        multi_source_search(g, sources, weights,
+                            [=](const size_t*, uint64_t mask, size_t,
+                                val_type d) mutable
+                            {
+                                typename hist_t::point_t point;
+                                point[0] = d;
+                                s_hist.put_value(point,
+                                                 __builtin_popcountll(mask));
+                            }, true);
         s_hist.gather();
 
         python::list ret;
@@ -130,42 +102,6 @@ struct get_sampled_distance_histogram
         ret.append(wrap_vector_owned<val_type>(hist.get_bins()[0]));
         phist = ret;
     }
-
-    // weighted version. Use dijkstra_shortest_paths()
-    struct get_dists_djk
-    {
-        template <class Graph, class Vertex, class VertexIndex,
-                  class DistanceMap, class WeightMap>
-        void operator()(const Graph& g, Vertex s, VertexIndex vertex_index,
-                        DistanceMap dist_map, WeightMap weights) const
-        {
-            dijkstra_shortest_paths(g, s, vertex_index_map(vertex_index).
-                                    weight_map(weights).distance_map(dist_map));
-        }
-    };
-
-    // unweighted version. Use BFS.
-    struct get_dists_bfs
-    {
-        template <class Graph, class Vertex, class VertexIndex,
-                  class DistanceMap>
-        void operator()(const Graph& g, Vertex s, VertexIndex vertex_index,
-                        DistanceMap dist_map, no_weightS) const
-        {
-            typedef typename graph_traits<Graph>::vertex_descriptor vertex_t;
-            typedef gt_hash_map<vertex_t,default_color_type,
-                                DescriptorHash<VertexIndex> > cmap_t;
-            cmap_t cmap(0, DescriptorHash<VertexIndex>(vertex_index));
-            InitializedPropertyMap<cmap_t>
-                color_map(cmap, color_traits<default_color_type>::white());
-
-            breadth_first_visit(g, s,
-                                visitor(make_bfs_visitor
-                                        (record_distances(dist_map,
-                                                          on_tree_edge()))).
-                                color_map(color_map));
-        }
-    };
 };
 
 } // boost namespace
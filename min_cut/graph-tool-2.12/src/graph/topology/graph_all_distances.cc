@@ -20,6 +20,10 @@
 #include "graph_properties.hh"
 #include "graph_selectors.hh"
 
+#include "graph_all_distances.hh"
+#include "histogram.hh"
+#include "numpy_bind.hh"
+
 #include <boost/python.hpp>
 
 #include <boost/graph/johnson_all_pairs_shortest.hpp>
@@ -29,6 +33,8 @@ using namespace std;
 using namespace boost;
 using namespace graph_tool;
 
+typedef ConstantPropertyMap<size_t,GraphInterface::edge_t> cweight_map_t;
+
 struct do_all_pairs_search
 {
     template <class Graph, class VertexIndexMap, class DistMap, class WeightMap>
@@ -38,13 +44,7 @@ struct do_all_pairs_search
         typedef typename property_traits<DistMap>::value_type::value_type
             dist_t;
 
-        int i, N = num_vertices(g);
-        #pragma omp parallel for default(shared) private(i) schedule(runtime) if (N > 100)
-        for (i = 0; i < N; ++i)
-        {
-            dist_map[i].clear();
-            dist_map[i].resize(num_vertices(g), 0);
-        }
+        init_dists(g, dist_map);
 
         if (dense)
         {
@@ -52,35 +52,213 @@ struct do_all_pairs_search
                 (g, dist_map,
                  weight_map(ConvertedPropertyMap<WeightMap,dist_t>(weight)).
                  vertex_index_map(vertex_index));
+            return;
         }
-        else
+
+        // Dijkstra's algorithm needs non-negative weights; otherwise, fall
+        // back to Johnson's algorithm, which reweights the edges first
+        if (has_negative_weights(g, weight))
         {
             johnson_all_pairs_shortest_paths
                 (g, dist_map,
                  weight_map(ConvertedPropertyMap<WeightMap,dist_t>(weight)).
                  vertex_index_map(vertex_index));
         }
+        else
+        {
+            all_pairs_search(g, ConvertedPropertyMap<WeightMap,dist_t>(weight),
+                             [&](const size_t* sources, uint64_t, size_t v,
+                                 dist_t d)
+                             {
+                                 dist_map[sources[0]][v] = d;
+                             });
+        }
+    }
+
+    template <class Graph, class VertexIndexMap, class DistMap>
+    void operator()(const Graph& g, VertexIndexMap vertex_index,
+                    DistMap dist_map, no_weightS, bool dense) const
+    {
+        typedef typename property_traits<DistMap>::value_type::value_type
+            dist_t;
+
+        if (dense)
+        {
+            (*this)(g, vertex_index, dist_map, cweight_map_t(1), dense);
+            return;
+        }
+
+        init_dists(g, dist_map);
+        all_pairs_search(g, no_weightS(),
+                         [&](const size_t* sources, uint64_t mask, size_t v,
+                             size_t d)
+                         {
+                             for_each_bit(mask,
+                                          [&](size_t j)
+                                          {
+                                              dist_map[sources[j]][v] = d;
+                                          });
+                         });
+    }
+
+    template <class Graph, class DistMap>
+    void init_dists(const Graph& g, DistMap dist_map) const
+    {
+        typedef typename property_traits<DistMap>::value_type::value_type
+            dist_t;
+
+        int i, N = num_vertices(g);
+        #pragma omp parallel for default(shared) private(i) schedule(runtime) if (N > 100)
+        for (i = 0; i < N; ++i)
+        {
+            dist_map[i].clear();
+            dist_map[i].resize(num_vertices(g),
+                               numeric_limits<dist_t>::max());
+            dist_map[i][i] = 0;
+        }
     }
 };
 
 void get_all_dists(GraphInterface& gi, boost::any dist_map, boost::any weight,
                    bool dense)
 {
-    typedef ConstantPropertyMap<size_t,GraphInterface::edge_t> cweight_map_t;
+    if (weight.empty())
+    {
+        run_action<>()
+            (gi, std::bind(do_all_pairs_search(), placeholders::_1,
+                           gi.get_vertex_index(), placeholders::_2,
+                           no_weightS(), dense),
+             vertex_scalar_vector_properties())
+            (dist_map);
+    }
+    else
+    {
+        run_action<>()
+            (gi, std::bind(do_all_pairs_search(), placeholders::_1,
+                           gi.get_vertex_index(), placeholders::_2,
+                           placeholders::_3, dense),
+             vertex_scalar_vector_properties(),
+             edge_scalar_properties())
+            (dist_map, weight);
+    }
+}
+
+// Histogram of the distances between all pairs of vertices, and the
+// eccentricity, sum of distances and number of reachable vertices of each
+// source, which are reduced while the distances are found, without storing
+// them.
+
+struct get_distance_stats
+{
+    template <class Graph, class WeightMap, class EccMap, class SumMap,
+              class ReachMap>
+    void operator()(const Graph& g, WeightMap weight,
+                    const vector<long double>& obins, EccMap ecc,
+                    SumMap dsum, ReachMap reach, python::object& phist) const
+    {
+        typedef typename property_traits<WeightMap>::value_type val_type;
+        dispatch<val_type>(g, weight, obins, ecc, dsum, reach, phist);
+    }
+
+    template <class Graph, class EccMap, class SumMap, class ReachMap>
+    void operator()(const Graph& g, no_weightS,
+                    const vector<long double>& obins, EccMap ecc,
+                    SumMap dsum, ReachMap reach, python::object& phist) const
+    {
+        dispatch<size_t>(g, no_weightS(), obins, ecc, dsum, reach, phist);
+    }
+
+    template <class ValType, class Graph, class WeightMap, class EccMap,
+              class SumMap, class ReachMap>
+    void dispatch(const Graph& g, WeightMap weight,
+                  const vector<long double>& obins, EccMap ecc, SumMap dsum,
+                  ReachMap reach, python::object& phist) const
+    {
+        typedef Histogram<ValType, size_t, 1> hist_t;
+
+        if (has_negative_weights(g, weight))
+            throw ValueException("Edge weights must be non-negative.");
+
+        std::array<vector<ValType>,1> bins;
+        bins[0].resize(obins.size());
+        for (size_t i = 0; i < obins.size(); ++i)
+            bins[0][i] = obins[i];
+
+        hist_t hist(bins);
+        SharedHistogram<hist_t> s_hist(hist);
+
+        for (auto v : vertices_range(g))
+        {
+            ecc[v] = 0;
+            dsum[v] = 0;
+            reach[v] = 0;
+        }
+
+        all_pairs_search(g, weight,
+                         [=](const size_t* sources, uint64_t mask, size_t,
+                             ValType d) mutable
+                         {
+                             typename hist_t::point_t point;
+                             point[0] = d;
+                             s_hist.put_value(point,
+                                              __builtin_popcountll(mask));
+                             for_each_bit(mask,
+                                          [&](size_t j)
+                                          {
+                                              size_t s = sources[j];
+                                              ecc[s] = std::max(ecc[s],
+                                                                double(d));
+                                              dsum[s] += d;
+                                              reach[s]++;
+                                          });
+                         });
+        s_hist.gather();
+
+        python::list ret;
+        ret.append(wrap_multi_array_owned<size_t,1>(hist.get_array()));
+        ret.append(wrap_vector_owned<ValType>(hist.get_bins()[0]));
+        phist = ret;
+    }
+};
+
+python::object distance_stats(GraphInterface& gi, boost::any weight,
+                              const vector<long double>& bins,
+                              boost::any oecc, boost::any odsum,
+                              boost::any oreach)
+{
+    typedef property_map_type::apply<double,
+                                     GraphInterface::vertex_index_map_t>::type
+        vdmap_t;
+    typedef property_map_type::apply<int64_t,
+                                     GraphInterface::vertex_index_map_t>::type
+        vimap_t;
+
+    size_t N = gi.get_num_vertices(false);
+    auto ecc = any_cast<vdmap_t>(oecc).get_unchecked(N);
+    auto dsum = any_cast<vdmap_t>(odsum).get_unchecked(N);
+    auto reach = any_cast<vimap_t>(oreach).get_unchecked(N);
 
+    python::object ret;
     if (weight.empty())
-        weight = boost::any(cweight_map_t(1));
-
-    run_action<>()
-        (gi, std::bind(do_all_pairs_search(), placeholders::_1,
-                       gi.get_vertex_index(), placeholders::_2, placeholders::_3,
-                       dense),
-         vertex_scalar_vector_properties(),
-         mpl::push_back<edge_scalar_properties,cweight_map_t>::type())
-        (dist_map, weight);
+    {
+        run_action<>()
+            (gi, std::bind(get_distance_stats(), placeholders::_1,
+                           no_weightS(), std::ref(bins), ecc, dsum, reach,
+                           std::ref(ret)))();
+    }
+    else
+    {
+        run_action<>()
+            (gi, std::bind(get_distance_stats(), placeholders::_1,
+                           placeholders::_2, std::ref(bins), ecc, dsum, reach,
+                           std::ref(ret)),
+             edge_scalar_properties())(weight);
+    }
+    return ret;
 }
 
 void export_all_dists()
 {
     python::def("get_all_dists", &get_all_dists);
+    python::def("distance_stats", &distance_stats);
 };
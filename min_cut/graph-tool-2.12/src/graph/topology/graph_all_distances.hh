@@ -0,0 +1,235 @@
+// graph-tool -- a general graph modification and manipulation thingy
+//
+// Copyright (C) 2006-2015 Tiago de Paula Peixoto <tiago@skewed.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef GRAPH_ALL_DISTANCES_HH
+#define GRAPH_ALL_DISTANCES_HH
+
+#include "config.h"
+
+#include <vector>
+#include <queue>
+#include <limits>
+#include <cstdint>
+
+#ifdef USING_OPENMP
+#include <omp.h>
+#endif
+
+#include "graph_bfs_kernel.hh"
+
+namespace graph_tool
+{
+using namespace std;
+using namespace boost;
+
+// Shortest distances from every vertex, computed in parallel without storing
+// them: each search reports the distances as it finds them to a callback,
+// which can reduce them to histograms, or to quantities per source. The memory
+// used is O(V) per thread, instead of O(V^2).
+//
+// Unweighted graphs are searched with BitParallelBFS, from 64 sources at
+// once. Weighted graphs are searched with Dijkstra's algorithm, one source at
+// a time. In both cases, the scratch space of each thread is allocated once
+// and reset only where it was touched.
+
+struct no_weightS {};
+
+// returns true if any edge has a negative weight, which Dijkstra's algorithm
+// does not handle
+template <class Graph, class WeightMap>
+bool has_negative_weights(const Graph& g, WeightMap weight)
+{
+    for (auto e : edges_range(g))
+    {
+        if (double(get(weight, e)) < 0)
+            return true;
+    }
+    return false;
+}
+
+template <class Graph>
+bool has_negative_weights(const Graph&, no_weightS)
+{
+    return false;
+}
+
+// Dijkstra's algorithm from a single source, with non-negative weights
+template <class DistType>
+class DijkstraSearch
+{
+public:
+    DijkstraSearch(size_t N) : _dist(N, numeric_limits<DistType>::max()) {}
+
+    // calls f(v, d) for each vertex v other than s reached at distance d, in
+    // order of increasing distance
+    template <class Graph, class WeightMap, class F>
+    void search(Graph& g, size_t s, WeightMap weight, F&& f)
+    {
+        reset();
+        _dist[s] = 0;
+        _touched.push_back(s);
+        _queue.push(make_pair(DistType(0), s));
+        while (!_queue.empty())
+        {
+            auto top = _queue.top();
+            _queue.pop();
+            size_t v = top.second;
+            if (top.first > _dist[v])
+                continue;
+            if (v != s)
+                f(v, top.first);
+            for (auto e : out_edges_range(v, g))
+            {
+                size_t w = target(e, g);
+                DistType d = _dist[v] + DistType(get(weight, e));
+                if (d >= _dist[w])
+                    continue;
+                if (_dist[w] == numeric_limits<DistType>::max())
+                    _touched.push_back(w);
+                _dist[w] = d;
+                _queue.push(make_pair(d, w));
+            }
+        }
+    }
+
+private:
+    void reset()
+    {
+        for (auto v : _touched)
+            _dist[v] = numeric_limits<DistType>::max();
+        _touched.clear();
+    }
+
+    typedef pair<DistType, size_t> item_t;
+    vector<DistType> _dist;
+    vector<size_t> _touched;
+    priority_queue<item_t, vector<item_t>, greater<item_t>> _queue;
+};
+
+// Runs a search from each of the given sources, in parallel, and calls
+// f(sources, mask, v, d) for each vertex v reached at distance d from the
+// sources[j] for which bit j of mask is set, except for the sources
+// themselves. Each thread works with its own copies of f, which are destroyed
+// at the end of the parallel region, and all the distances from a given
+// source are reported to the same copy.
+//
+// If split_levels == true, and there are fewer groups of 64 sources than
+// threads, the breadth-first searches are instead run one after the other,
+// with each level expanded by all the threads. The distances from a given
+// source are then reported to the copies of f of all the threads, so this
+// is only suitable for reductions over all the sources, such as histograms.
+
+template <class Graph, class F>
+void multi_source_search(Graph& g, const vector<size_t>& vs, no_weightS, F f,
+                         bool split_levels = false)
+{
+    int i, N = (vs.size() + 63) / 64;
+
+    size_t num_threads = 1;
+#ifdef USING_OPENMP
+    num_threads = omp_get_max_threads();
+#endif
+
+    auto search = [&](BitParallelBFS& bfs, size_t i, F& f, bool parallel)
+    {
+        const size_t* sources = &vs[i * 64];
+        size_t n = std::min(vs.size() - i * 64, size_t(64));
+        if (parallel)
+        {
+            // each thread of the search needs its own copy of f
+            bfs.search(g, sources, n,
+                       [f, sources](size_t v, uint64_t mask, size_t d) mutable
+                       {
+                           f(sources, mask, v, d);
+                       },
+                       true);
+        }
+        else
+        {
+            bfs.search(g, sources, n,
+                       [&f, sources](size_t v, uint64_t mask, size_t d)
+                       {
+                           f(sources, mask, v, d);
+                       });
+        }
+    };
+
+    if (split_levels && size_t(N) < num_threads && num_vertices(g) > 100)
+    {
+        BitParallelBFS bfs(num_vertices(g));
+        for (i = 0; i < N; ++i)
+            search(bfs, i, f, true);
+        return;
+    }
+
+    #pragma omp parallel firstprivate(f) if (num_vertices(g) > 100)
+    {
+        BitParallelBFS bfs(num_vertices(g));
+        #pragma omp for schedule(runtime)
+        for (i = 0; i < N; ++i)
+            search(bfs, i, f, false);
+    }
+}
+
+template <class Graph, class WeightMap, class F>
+void multi_source_search(Graph& g, const vector<size_t>& vs, WeightMap weight,
+                         F f, bool = false)
+{
+    typedef typename property_traits<WeightMap>::value_type dist_t;
+
+    int i, N = vs.size();
+    #pragma omp parallel firstprivate(f) if (num_vertices(g) > 100)
+    {
+        DijkstraSearch<dist_t> dijkstra(num_vertices(g));
+        #pragma omp for schedule(runtime)
+        for (i = 0; i < N; ++i)
+        {
+            size_t s = vs[i];
+            dijkstra.search(g, s, weight,
+                            [&](size_t v, dist_t d)
+                            {
+                                f(&s, uint64_t(1), v, d);
+                            });
+        }
+    }
+}
+
+// runs a search from every vertex, as multi_source_search()
+template <class Graph, class WeightMap, class F>
+void all_pairs_search(Graph& g, WeightMap weight, F f,
+                      bool split_levels = false)
+{
+    vector<size_t> vs;
+    for (auto v : vertices_range(g))
+        vs.push_back(v);
+    multi_source_search(g, vs, weight, f, split_levels);
+}
+
+// calls f(j) for each bit j set in mask
+template <class F>
+inline void for_each_bit(uint64_t mask, F&& f)
+{
+    while (mask != 0)
+    {
+        f(size_t(__builtin_ctzll(mask)));
+        mask &= mask - 1;
+    }
+}
+
+} // graph_tool namespace
+
+#endif // GRAPH_ALL_DISTANCES_HH
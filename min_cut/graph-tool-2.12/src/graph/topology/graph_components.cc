@@ -21,6 +21,8 @@
 #include "graph_selectors.hh"
 
 #include "graph_components.hh"
+#include "graph_dynamic_components.hh"
+#include "graph_periodic_components.hh"
 
 #include "numpy_bind.hh"
 
@@ -33,7 +35,7 @@ using namespace graph_tool;
 python::object do_label_components(GraphInterface& gi, boost::any prop)
 {
     vector<size_t> hist;
-    run_action<graph_tool::detail::all_graph_views,mpl::true_>()
+    run_action<graph_tool::detail::all_graph_views_frozen,mpl::true_>()
         (gi, std::bind(label_components(), placeholders::_1,
                        placeholders::_2, std::ref(hist)),
          writable_vertex_scalar_properties())(prop);
@@ -57,7 +59,7 @@ do_label_biconnected_components(GraphInterface& gi, boost::any comp,
 
 void do_label_out_component(GraphInterface& gi, size_t root, boost::any prop)
 {
-    run_action<graph_tool::detail::all_graph_views,mpl::true_>()
+    run_action<graph_tool::detail::all_graph_views_frozen,mpl::true_>()
         (gi, std::bind(label_out_component(), placeholders::_1, placeholders::_2, root),
          writable_vertex_scalar_properties())(prop);
 }
@@ -72,6 +74,67 @@ void do_label_attractors(GraphInterface& gi, boost::any cprop, python::object oa
                    vertex_scalar_properties())(cprop);
 }
 
+python::object do_label_wrapping_components(GraphInterface& gi,
+                                            boost::any prop, boost::any pos,
+                                            python::object obox)
+{
+    multi_array_ref<double,1> abox = get_array<double,1>(obox);
+    vector<double> box(abox.begin(), abox.end());
+    vector<size_t> hist;
+    vector<uint8_t> wrap;
+    run_action<graph_tool::detail::never_directed>()
+        (gi, std::bind(label_wrapping_components(), placeholders::_1,
+                       placeholders::_2, placeholders::_3, std::cref(box),
+                       std::ref(hist), std::ref(wrap)),
+         writable_vertex_scalar_properties(),
+         vertex_floating_vector_properties())(prop, pos);
+    return python::make_tuple(wrap_vector_owned(hist),
+                              wrap_vector_owned(wrap));
+}
+
+python::object do_label_periodic_components(GraphInterface& gi,
+                                            boost::any prop, boost::any image,
+                                            boost::any pos, boost::any upos,
+                                            python::object obox)
+{
+    typedef property_map_type::apply<int32_t,
+                                     GraphInterface::vertex_index_map_t>::type
+        comp_map_t;
+    typedef property_map_type::apply<vector<int32_t>,
+                                     GraphInterface::edge_index_map_t>::type
+        image_map_t;
+    typedef property_map_type::apply<vector<double>,
+                                     GraphInterface::vertex_index_map_t>::type
+        pos_map_t;
+
+    multi_array_ref<double,2> abox = get_array<double,2>(obox);
+    size_t D = abox.shape()[0];
+    if (abox.shape()[1] != D)
+        throw ValueException("The box must be a square matrix.");
+    vector<double> H;
+    for (size_t i = 0; i < D; ++i)
+        for (size_t j = 0; j < D; ++j)
+            H.push_back(abox[i][j]);
+
+    size_t N = gi.get_num_vertices(false);
+    auto comp = any_cast<comp_map_t>(prop).get_unchecked(N);
+    auto eimage = any_cast<image_map_t>(image)
+        .get_unchecked(gi.get_edge_index_range());
+    auto vpos = any_cast<pos_map_t>(pos).get_unchecked(N);
+    auto vupos = any_cast<pos_map_t>(upos).get_unchecked(N);
+
+    vector<size_t> hist;
+    vector<int32_t> dim;
+    vector<double> extent;
+    run_action<graph_tool::detail::always_directed_never_reversed>()
+        (gi, std::bind(label_periodic_components(), placeholders::_1, comp,
+                       eimage, vpos, vupos, std::cref(H), D, std::ref(hist),
+                       std::ref(dim), std::ref(extent)))();
+    return python::make_tuple(wrap_vector_owned(hist),
+                              wrap_vector_owned(dim),
+                              wrap_vector_owned(extent));
+}
+
 void export_components()
 {
     python::def("label_components", &do_label_components);
@@ -79,4 +142,16 @@ void export_components()
                 &do_label_biconnected_components);
     python::def("label_out_component", &do_label_out_component);
     python::def("label_attractors", &do_label_attractors);
+    python::def("label_wrapping_components", &do_label_wrapping_components);
+    python::def("label_periodic_components", &do_label_periodic_components);
+
+    python::class_<DynamicComponents, boost::noncopyable>
+        ("DynamicComponents", python::init<GraphInterface&>())
+        .def("add_edges", &DynamicComponents::add_edges)
+        .def("remove_edges", &DynamicComponents::remove_edges)
+        .def("label", &DynamicComponents::label)
+        .def("component_size", &DynamicComponents::component_size)
+        .def("num_components", &DynamicComponents::num_components)
+        .def("num_vertices", &DynamicComponents::num_vertices)
+        .def("get_labels", &DynamicComponents::get_labels);
 };
@@ -22,6 +22,8 @@
 #include <boost/graph/strong_components.hpp>
 #include <boost/graph/biconnected_components.hpp>
 
+#include "graph_parallel_components.hh"
+
 namespace graph_tool
 {
 template <class PropertyMap>
@@ -98,7 +100,9 @@ void put(HistogramPropertyMap<PropertyMap> pmap,
 
 // this will label the components of a graph to a given vertex property, from
 // [0, number of components - 1], and keep an histogram. If the graph is
-// directed the strong components are used.
+// directed the strong components are used. The components of undirected
+// graphs are found in parallel, but with the same labels as
+// boost::connected_components().
 struct label_components
 {
     template <class Graph, class CompMap>
@@ -107,24 +111,26 @@ struct label_components
     {
         typedef typename graph_traits<Graph>::directed_category
             directed_category;
-        HistogramPropertyMap<CompMap> cm(comp_map, num_vertices(g), hist);
-        get_components(g, cm,
+        get_components(g, comp_map, hist,
                        typename std::is_convertible<directed_category,
                                                     directed_tag>::type());
     }
 
     template <class Graph, class CompMap>
-    void get_components(Graph& g, CompMap comp_map,
+    void get_components(Graph& g, CompMap comp_map, vector<size_t>& hist,
                         std::true_type) const
     {
-        boost::strong_components(g, comp_map);
+        HistogramPropertyMap<CompMap> cm(comp_map, num_vertices(g), hist);
+        boost::strong_components(g, cm);
     }
 
     template <class Graph, class CompMap>
-    void get_components(Graph& g, CompMap comp_map,
+    void get_components(Graph& g, CompMap comp_map, vector<size_t>& hist,
                         std::false_type) const
     {
-        boost::connected_components(g, comp_map);
+        ParallelUnionFind uf(num_vertices(g));
+        parallel_components(g, uf);
+        label_parallel_components(g, uf, comp_map, hist);
     }
 };
 
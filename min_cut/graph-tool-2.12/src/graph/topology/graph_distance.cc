@@ -375,7 +375,7 @@ void get_dists(GraphInterface& gi, size_t source, boost::python::object tgt,
 
     if (weight.empty())
     {
-        run_action<>()
+        run_action<graph_tool::detail::all_graph_views_frozen>()
             (gi, std::bind(do_bfs_search(), placeholders::_1, source, tgt, gi.get_vertex_index(),
                            placeholders::_2, pmap.get_unchecked(num_vertices(gi.get_graph())),
                            max_dist),
@@ -386,7 +386,7 @@ void get_dists(GraphInterface& gi, size_t source, boost::python::object tgt,
     {
         if (bf)
         {
-            run_action<>()
+            run_action<graph_tool::detail::all_graph_views_frozen>()
                 (gi, std::bind(do_bf_search(), placeholders::_1, source,
                                placeholders::_2, pmap.get_unchecked(num_vertices(gi.get_graph())),
                                placeholders::_3),
@@ -396,7 +396,7 @@ void get_dists(GraphInterface& gi, size_t source, boost::python::object tgt,
         }
         else
         {
-            run_action<>()
+            run_action<graph_tool::detail::all_graph_views_frozen>()
                 (gi, std::bind(do_djk_search(), placeholders::_1, source, tgt, gi.get_vertex_index(),
                                placeholders::_2, pmap.get_unchecked(num_vertices(gi.get_graph())),
                                placeholders::_3, max_dist),
@@ -0,0 +1,249 @@
+// graph-tool -- a general graph modification and manipulation thingy
+//
+// Copyright (C) 2006-2015 Tiago de Paula Peixoto <tiago@skewed.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "graph_filtering.hh"
+#include "graph_properties.hh"
+#include "graph_selectors.hh"
+#include "graph.hh"
+
+#include "graph_dynamic_components.hh"
+#include "numpy_bind.hh"
+
+#include <limits>
+#include <algorithm>
+#include <boost/lexical_cast.hpp>
+
+using namespace std;
+using namespace boost;
+using namespace graph_tool;
+
+struct get_undirected_adjacency
+{
+    template <class Graph>
+    void operator()(Graph& g, vector<vector<size_t>>& adj) const
+    {
+        for (auto e : edges_range(g))
+        {
+            size_t u = source(e, g);
+            size_t v = target(e, g);
+            if (u == v)
+                continue;
+            adj[u].push_back(v);
+            adj[v].push_back(u);
+        }
+    }
+};
+
+struct get_contiguous_labels
+{
+    template <class Graph, class CompMap>
+    void operator()(Graph& g, CompMap comp, const vector<size_t>& label,
+                    vector<size_t>& hist) const
+    {
+        typedef typename property_traits<CompMap>::value_type val_t;
+        vector<size_t> new_label(label.size(), numeric_limits<size_t>::max());
+        for (auto v : vertices_range(g))
+        {
+            size_t& l = new_label[label[v]];
+            if (l == numeric_limits<size_t>::max())
+            {
+                l = hist.size();
+                hist.push_back(0);
+            }
+            comp[v] = val_t(l);
+            hist[l]++;
+        }
+    }
+};
+
+DynamicComponents::DynamicComponents(GraphInterface& gi)
+    : _ncomps(0), _stamp(0)
+{
+    size_t N = gi.get_num_vertices(false);
+    _adj.resize(N);
+    run_action<>()
+        (gi, std::bind(get_undirected_adjacency(), placeholders::_1,
+                       std::ref(_adj)))();
+
+    _label.resize(N, numeric_limits<size_t>::max());
+    _size.resize(N, 0);
+    _visited.resize(N, 0);
+    for (size_t v = 0; v < N; ++v)
+    {
+        if (_label[v] != numeric_limits<size_t>::max())
+            continue;
+        relabel(v, _ncomps++);
+    }
+    for (size_t l = N; l > _ncomps; --l)
+        _free.push_back(l - 1);
+}
+
+// gives the label l to the component of v, and sets its size
+void DynamicComponents::relabel(size_t v, size_t l)
+{
+    auto& queue = _queue[0];
+    queue.clear();
+    size_t old = _label[v];
+    _label[v] = l;
+    queue.push_back(v);
+    for (size_t i = 0; i < queue.size(); ++i)
+    {
+        for (auto w : _adj[queue[i]])
+        {
+            if (_label[w] != old)
+                continue;
+            _label[w] = l;
+            queue.push_back(w);
+        }
+    }
+    _size[l] += queue.size();
+}
+
+void DynamicComponents::add_edge(size_t u, size_t v)
+{
+    if (u == v)
+        return;
+    _adj[u].push_back(v);
+    _adj[v].push_back(u);
+
+    size_t lu = _label[u], lv = _label[v];
+    if (lu == lv)
+        return;
+    if (_size[lu] < _size[lv])
+    {
+        std::swap(u, v);
+        std::swap(lu, lv);
+    }
+    relabel(v, lu);
+    _size[lv] = 0;
+    _free.push_back(lv);
+    _ncomps--;
+}
+
+void DynamicComponents::remove_edge(size_t u, size_t v)
+{
+    if (u == v)
+        return;
+    auto iter = std::find(_adj[u].begin(), _adj[u].end(), v);
+    if (iter == _adj[u].end())
+        throw ValueException("Edge (" + lexical_cast<string>(u) + ", " +
+                             lexical_cast<string>(v) + ") does not exist.");
+    *iter = _adj[u].back();
+    _adj[u].pop_back();
+    iter = std::find(_adj[v].begin(), _adj[v].end(), u);
+    *iter = _adj[v].back();
+    _adj[v].pop_back();
+
+    // a parallel edge is left
+    if (std::find(_adj[u].begin(), _adj[u].end(), v) != _adj[u].end())
+        return;
+
+    // search from both endpoints at the same time, until the searches meet,
+    // or one of them is exhausted
+    size_t stamp[2] = {_stamp + 1, _stamp + 2};
+    _stamp += 2;
+    size_t pos[2] = {0, 0};
+    _queue[0].clear();
+    _queue[1].clear();
+    _queue[0].push_back(u);
+    _queue[1].push_back(v);
+    _visited[u] = stamp[0];
+    _visited[v] = stamp[1];
+
+    size_t side = 0;
+    while (true)
+    {
+        auto& queue = _queue[side];
+        if (pos[side] == queue.size())
+            break;
+        for (auto w : _adj[queue[pos[side]++]])
+        {
+            if (_visited[w] == stamp[1 - side])
+                return;
+            if (_visited[w] == stamp[side])
+                continue;
+            _visited[w] = stamp[side];
+            queue.push_back(w);
+        }
+        side = 1 - side;
+    }
+
+    // the exhausted side is a new component
+    auto& comp = _queue[side];
+    size_t l = _free.back();
+    _free.pop_back();
+    for (auto w : comp)
+        _label[w] = l;
+    _size[_label[side == 0 ? v : u]] -= comp.size();
+    _size[l] = comp.size();
+    _ncomps++;
+}
+
+void DynamicComponents::check_vertex(int64_t v) const
+{
+    if (v < 0 || size_t(v) >= _adj.size())
+        throw ValueException("Invalid vertex index: " +
+                             lexical_cast<string>(v));
+}
+
+void DynamicComponents::add_edges(python::object oedges)
+{
+    multi_array_ref<int64_t,2> edges = get_array<int64_t,2>(oedges);
+    for (size_t i = 0; i < edges.shape()[0]; ++i)
+    {
+        check_vertex(edges[i][0]);
+        check_vertex(edges[i][1]);
+        add_edge(edges[i][0], edges[i][1]);
+    }
+}
+
+void DynamicComponents::remove_edges(python::object oedges)
+{
+    multi_array_ref<int64_t,2> edges = get_array<int64_t,2>(oedges);
+    for (size_t i = 0; i < edges.shape()[0]; ++i)
+    {
+        check_vertex(edges[i][0]);
+        check_vertex(edges[i][1]);
+        remove_edge(edges[i][0], edges[i][1]);
+    }
+}
+
+size_t DynamicComponents::label(size_t v) const
+{
+    check_vertex(v);
+    return _label[v];
+}
+
+size_t DynamicComponents::component_size(size_t v) const
+{
+    check_vertex(v);
+    return _size[_label[v]];
+}
+
+python::object DynamicComponents::get_labels(GraphInterface& gi,
+                                             boost::any prop) const
+{
+    if (gi.get_num_vertices(false) != _adj.size())
+        throw ValueException("The number of vertices of the graph has "
+                             "changed since the components were built.");
+    vector<size_t> hist;
+    run_action<>()
+        (gi, std::bind(get_contiguous_labels(), placeholders::_1,
+                       placeholders::_2, std::cref(_label), std::ref(hist)),
+         writable_vertex_scalar_properties())(prop);
+    return wrap_vector_owned(hist);
+}
@@ -0,0 +1,96 @@
+// graph-tool -- a general graph modification and manipulation thingy
+//
+// Copyright (C) 2006-2015 Tiago de Paula Peixoto <tiago@skewed.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef GRAPH_DYNAMIC_COMPONENTS_HH
+#define GRAPH_DYNAMIC_COMPONENTS_HH
+
+#include <vector>
+
+#include <boost/python.hpp>
+
+#include "graph.hh"
+
+namespace graph_tool
+{
+using namespace std;
+using namespace boost;
+
+// Connected components of an undirected graph which are kept up to date as
+// edges are inserted and removed, without labeling the whole graph again.
+//
+// The structure keeps its own adjacency lists, and a component label for
+// every vertex, together with the size of each component. The labels are
+// always explicit, so that the label and the size of the component of a
+// vertex are obtained in constant time:
+//
+//   - insertion: if the endpoints are in different components, the smaller
+//     one is relabeled to the label of the larger one, with a search which is
+//     restricted to it. Each vertex is relabeled at most O(log V) times in a
+//     sequence of insertions, as in union-find with union by size.
+//
+//   - removal: if the endpoints are no longer adjacent, two searches are
+//     started at the same time from both of them, one vertex at a time. If
+//     they meet, the component is still connected; otherwise, the first one
+//     to run out of vertices has found a whole new component, which is given a
+//     new label. The work is proportional to the smaller of the two sides (or
+//     to the region explored until the searches meet, which is small if the
+//     edge closes a short cycle), not to the size of the component.
+//
+// The labels are in the range [0, V), but are not contiguous after updates;
+// get_labels() returns the same (contiguous) labels as label_components().
+
+class DynamicComponents
+{
+public:
+    // builds the components of the graph, ignoring edge directions
+    DynamicComponents(GraphInterface& gi);
+
+    // insert and remove a set of edges, given as an array of shape (E, 2) of
+    // vertex indexes; parallel edges are counted, and self-loops are ignored
+    void add_edges(python::object oedges);
+    void remove_edges(python::object oedges);
+
+    size_t label(size_t v) const;
+    size_t component_size(size_t v) const;
+    size_t num_components() const { return _ncomps; }
+    size_t num_vertices() const { return _adj.size(); }
+
+    // writes contiguous labels to a vertex property map, in order of the
+    // smallest vertex in each component, and returns the component sizes
+    python::object get_labels(GraphInterface& gi, boost::any prop) const;
+
+private:
+    void check_vertex(int64_t v) const;
+    void add_edge(size_t u, size_t v);
+    void remove_edge(size_t u, size_t v);
+    void relabel(size_t v, size_t l);
+
+    vector<vector<size_t>> _adj;
+    vector<size_t> _label;
+    vector<size_t> _size;    // indexed by label
+    vector<size_t> _free;    // unused labels
+    size_t _ncomps;
+
+    // search state of remove_edge()
+    vector<size_t> _visited;
+    size_t _stamp;
+    vector<size_t> _queue[2];
+};
+
+} // graph_tool namespace
+
+#endif // GRAPH_DYNAMIC_COMPONENTS_HH
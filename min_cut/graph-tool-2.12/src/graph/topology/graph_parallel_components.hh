@@ -0,0 +1,289 @@
+// graph-tool -- a general graph modification and manipulation thingy
+//
+// Copyright (C) 2006-2015 Tiago de Paula Peixoto <tiago@skewed.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef GRAPH_PARALLEL_COMPONENTS_HH
+#define GRAPH_PARALLEL_COMPONENTS_HH
+
+#include <vector>
+#include <atomic>
+#include <unordered_map>
+#include <cmath>
+
+#include <boost/lexical_cast.hpp>
+
+namespace graph_tool
+{
+using namespace std;
+using namespace boost;
+
+// Union-find which can be modified by many threads at the same time, without
+// locks. The parent of a root is only ever set (with compare-and-swap) to a
+// smaller root, so that the root of each set is always its smallest element.
+
+class ParallelUnionFind
+{
+public:
+    ParallelUnionFind(size_t N) : _parent(N)
+    {
+        int i, n = N;
+        #pragma omp parallel for default(shared) private(i) \
+            schedule(runtime) if (n > 100)
+        for (i = 0; i < n; ++i)
+            _parent[i].store(i, memory_order_relaxed);
+    }
+
+    // joins the sets of u and v
+    void link(size_t u, size_t v)
+    {
+        size_t p1 = _parent[u].load();
+        size_t p2 = _parent[v].load();
+        while (p1 != p2)
+        {
+            size_t high = std::max(p1, p2);
+            size_t low = std::min(p1, p2);
+            size_t p_high = _parent[high].load();
+            if (p_high == low)
+                break;
+            if (p_high == high &&
+                _parent[high].compare_exchange_strong(p_high, low))
+                break;
+            p1 = _parent[_parent[high].load()].load();
+            p2 = _parent[low].load();
+        }
+    }
+
+    size_t find(size_t v) const
+    {
+        size_t p;
+        while ((p = _parent[v].load()) != v)
+            v = p;
+        return v;
+    }
+
+    // the parent of v, which is its root after compress()
+    size_t parent(size_t v) const { return _parent[v].load(); }
+
+    // makes every element point directly to its root
+    void compress()
+    {
+        int i, N = _parent.size();
+        #pragma omp parallel for default(shared) private(i) \
+            schedule(runtime) if (N > 100)
+        for (i = 0; i < N; ++i)
+        {
+            while (true)
+            {
+                size_t p = _parent[i].load();
+                size_t gp = _parent[p].load();
+                if (p == gp)
+                    break;
+                _parent[i].store(gp);
+            }
+        }
+    }
+
+    size_t size() const { return _parent.size(); }
+
+private:
+    vector<atomic<size_t>> _parent;
+};
+
+// Connected components of an undirected graph, with the "Afforest" algorithm
+// (Sutton et al., IPDPS 2018): the vertices are first linked to a few of their
+// neighbours, which is usually enough to find most of the largest component;
+// the remaining edges are then linked, skipping the vertices which are
+// already in that component. The result is the same for any number of
+// threads: the root of each component is its smallest vertex.
+
+template <class Graph>
+void parallel_components(Graph& g, ParallelUnionFind& uf)
+{
+    const size_t rounds = 2;
+
+    int i, N = num_vertices(g);
+    for (size_t r = 0; r < rounds; ++r)
+    {
+        #pragma omp parallel for default(shared) private(i) \
+            schedule(runtime) if (N > 100)
+        for (i = 0; i < N; ++i)
+        {
+            auto v = vertex(i, g);
+            if (v == graph_traits<Graph>::null_vertex())
+                continue;
+            size_t k = 0;
+            for (auto w : adjacent_vertices_range(v, g))
+            {
+                if (k++ < r)
+                    continue;
+                uf.link(v, w);
+                break;
+            }
+        }
+        uf.compress();
+    }
+
+    // the most frequent root, in a deterministic sample of the vertices
+    size_t c = graph_traits<Graph>::null_vertex();
+    if (N > 0)
+    {
+        std::unordered_map<size_t, size_t> count;
+        size_t max_count = 0, x = 0;
+        for (size_t j = 0; j < 1024; ++j)
+        {
+            x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+            size_t v = (x >> 33) % N;
+            if (vertex(v, g) == graph_traits<Graph>::null_vertex())
+                continue;
+            size_t& n = count[uf.parent(v)];
+            if (++n > max_count)
+            {
+                max_count = n;
+                c = uf.parent(v);
+            }
+        }
+    }
+
+    #pragma omp parallel for default(shared) private(i) \
+        schedule(runtime) if (N > 100)
+    for (i = 0; i < N; ++i)
+    {
+        auto v = vertex(i, g);
+        if (v == graph_traits<Graph>::null_vertex())
+            continue;
+        if (uf.parent(v) == c)
+            continue;
+        size_t k = 0;
+        for (auto w : adjacent_vertices_range(v, g))
+        {
+            if (k++ < rounds)
+                continue;
+            uf.link(v, w);
+        }
+    }
+    uf.compress();
+}
+
+// labels the components from the roots of the union-find, in the order of
+// their smallest vertex (as boost::connected_components()), and returns the
+// number of vertices in each one
+template <class Graph, class CompMap>
+void label_parallel_components(Graph& g, ParallelUnionFind& uf,
+                               CompMap comp_map, vector<size_t>& hist)
+{
+    typedef typename property_traits<CompMap>::value_type c_type;
+
+    size_t C = 0;
+    vector<size_t> label(num_vertices(g));
+    for (auto v : vertices_range(g))
+    {
+        if (uf.parent(v) == v)
+            label[v] = C++;
+    }
+    hist.clear();
+    hist.resize(C, 0);
+
+    int i, N = num_vertices(g);
+    #pragma omp parallel for default(shared) private(i) \
+        schedule(runtime) if (N > 100)
+    for (i = 0; i < N; ++i)
+    {
+        auto v = vertex(i, g);
+        if (v == graph_traits<Graph>::null_vertex())
+            continue;
+        size_t l = label[uf.parent(v)];
+        put(comp_map, v, c_type(l));
+        #pragma omp atomic
+        hist[l]++;
+    }
+}
+
+// Components which wrap around the periodic boundaries of an orthogonal box.
+//
+// An edge crosses the boundary of dimension d if its endpoints are further
+// apart than half the box length. For each dimension, the graph is "lifted" to
+// two copies of each vertex, where the edges which cross the boundary connect
+// different copies, and the others connect the same copy. A component wraps
+// along d if both copies of its vertices are connected, i.e. if it contains a
+// cycle which crosses the boundary an odd number of times.
+
+struct label_wrapping_components
+{
+    template <class Graph, class CompMap, class PosMap>
+    void operator()(Graph& g, CompMap comp_map, PosMap pos,
+                    const vector<double>& box, vector<size_t>& hist,
+                    vector<uint8_t>& wrap) const
+    {
+        ParallelUnionFind uf(num_vertices(g));
+        parallel_components(g, uf);
+        label_parallel_components(g, uf, comp_map, hist);
+
+        size_t D = box.size();
+        wrap.clear();
+        wrap.resize(hist.size() * D, 0);
+
+        for (auto v : vertices_range(g))
+        {
+            if (pos[v].size() < D)
+                throw ValueException("The position of vertex " +
+                                     lexical_cast<string>(v) +
+                                     " has fewer than " +
+                                     lexical_cast<string>(D) + " dimensions.");
+        }
+
+        int i, N = num_vertices(g);
+        for (size_t d = 0; d < D; ++d)
+        {
+            ParallelUnionFind luf(2 * N);
+
+            #pragma omp parallel for default(shared) private(i) \
+                schedule(runtime) if (N > 100)
+            for (i = 0; i < N; ++i)
+            {
+                auto v = vertex(i, g);
+                if (v == graph_traits<Graph>::null_vertex())
+                    continue;
+                for (auto w : adjacent_vertices_range(v, g))
+                {
+                    if (size_t(w) < size_t(v))
+                        continue;
+                    bool cross = (std::abs(double(pos[w][d]) -
+                                           double(pos[v][d])) > box[d] / 2);
+                    luf.link(2 * v, 2 * w + cross);
+                    luf.link(2 * v + 1, 2 * w + 1 - cross);
+                }
+            }
+
+            #pragma omp parallel for default(shared) private(i) \
+                schedule(runtime) if (N > 100)
+            for (i = 0; i < N; ++i)
+            {
+                auto v = vertex(i, g);
+                if (v == graph_traits<Graph>::null_vertex())
+                    continue;
+                if (luf.find(2 * v) != luf.find(2 * v + 1))
+                    continue;
+                size_t c = get(comp_map, v);
+                #pragma omp atomic write
+                wrap[c * D + d] = 1;
+            }
+        }
+    }
+};
+
+} // graph_tool namespace
+
+#endif // GRAPH_PARALLEL_COMPONENTS_HH
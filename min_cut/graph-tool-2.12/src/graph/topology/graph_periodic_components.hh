@@ -0,0 +1,217 @@
+// graph-tool -- a general graph modification and manipulation thingy
+//
+// Copyright (C) 2006-2015 Tiago de Paula Peixoto <tiago@skewed.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef GRAPH_PERIODIC_COMPONENTS_HH
+#define GRAPH_PERIODIC_COMPONENTS_HH
+
+#include <vector>
+#include <cmath>
+#include <limits>
+
+#include <boost/lexical_cast.hpp>
+
+#include "graph_parallel_components.hh"
+
+namespace graph_tool
+{
+using namespace std;
+using namespace boost;
+
+// Components of a graph of points in a periodic box, where the image of each
+// edge (u, v) is the periodic image of v to which u is bonded, as integer
+// multiples of the D cell vectors (the rows of the D x D matrix H).
+//
+// Each vertex is given an image offset, relative to the first vertex of its
+// component, by a traversal of the component which adds the image of each
+// edge it follows. Every other edge then closes a cycle, which winds around
+// the box by the difference between the offset it implies for its endpoint
+// and the one already assigned. The windings of a finite component are all
+// zero; otherwise, they span a lattice whose rank is the number of
+// dimensions along which the component is infinite (1 for chains, 2 for
+// sheets, 3 for networks).
+//
+// The components are found in parallel, and are then traversed in parallel,
+// one component per thread. The positions unwrapped by the image offsets
+// are put in upos, which are contiguous for the finite components.
+
+struct label_periodic_components
+{
+    // adds the winding w to the basis of the windings of a component, in row
+    // echelon form, unless it is linearly dependent on it
+    static void add_winding(vector<double>& w, vector<double>& basis,
+                            vector<size_t>& pivot, size_t D)
+    {
+        for (size_t b = 0; b < pivot.size(); ++b)
+        {
+            double f = w[pivot[b]] / basis[b * D + pivot[b]];
+            for (size_t j = 0; j < D; ++j)
+                w[j] -= f * basis[b * D + j];
+        }
+        size_t p = 0;
+        for (size_t j = 1; j < D; ++j)
+        {
+            if (std::abs(w[j]) > std::abs(w[p]))
+                p = j;
+        }
+        if (!(std::abs(w[p]) > 1e-8))
+            return;
+        basis.insert(basis.end(), w.begin(), w.end());
+        pivot.push_back(p);
+    }
+
+    template <class Graph, class CompMap, class ImageMap, class PosMap>
+    void operator()(Graph& g, CompMap comp_map, ImageMap image, PosMap pos,
+                    PosMap upos, const vector<double>& H, size_t D,
+                    vector<size_t>& hist, vector<int32_t>& dim,
+                    vector<double>& extent) const
+    {
+        for (auto e : edges_range(g))
+        {
+            if (image[e].size() != D)
+                throw ValueException("The edge images must have " +
+                                     lexical_cast<string>(D) + " dimensions.");
+        }
+        for (auto v : vertices_range(g))
+        {
+            if (pos[v].size() < D)
+                throw ValueException("The position of vertex " +
+                                     lexical_cast<string>(v) +
+                                     " has fewer than " +
+                                     lexical_cast<string>(D) + " dimensions.");
+        }
+
+        int i, N = num_vertices(g);
+        ParallelUnionFind uf(N);
+        #pragma omp parallel for default(shared) private(i) \
+            schedule(runtime) if (N > 100)
+        for (i = 0; i < N; ++i)
+        {
+            auto v = vertex(i, g);
+            if (v == graph_traits<Graph>::null_vertex())
+                continue;
+            for (auto e : out_edges_range(v, g))
+                uf.link(v, target(e, g));
+        }
+        uf.compress();
+        label_parallel_components(g, uf, comp_map, hist);
+
+        vector<size_t> roots;
+        for (auto v : vertices_range(g))
+        {
+            if (uf.parent(v) == v)
+                roots.push_back(v);
+        }
+
+        int C = roots.size();
+        dim.clear();
+        dim.resize(C, 0);
+        extent.clear();
+        extent.resize(C * D, 0);
+        double hmax = 0;
+        for (auto h : H)
+            hmax = std::max(hmax, std::abs(h));
+
+        vector<int32_t> offset(N * D, 0);
+        vector<uint8_t> visited(N, false);
+
+        #pragma omp parallel if (N > 100)
+        {
+            vector<size_t> queue;
+            vector<double> w(D), basis, xmin(D), xmax(D);
+            vector<size_t> pivot;
+
+            auto visit = [&](size_t v, size_t u, const vector<int32_t>& n,
+                             int sign)
+            {
+                if (!visited[u])
+                {
+                    visited[u] = true;
+                    for (size_t j = 0; j < D; ++j)
+                        offset[u * D + j] = offset[v * D + j] + sign * n[j];
+                    queue.push_back(u);
+                    return;
+                }
+                if (pivot.size() == D)
+                    return;
+                bool winds = false;
+                for (size_t j = 0; j < D; ++j)
+                {
+                    w[j] = offset[v * D + j] + sign * n[j] - offset[u * D + j];
+                    if (w[j] != 0)
+                        winds = true;
+                }
+                if (winds)
+                    add_winding(w, basis, pivot, D);
+            };
+
+            #pragma omp for schedule(runtime)
+            for (i = 0; i < C; ++i)
+            {
+                queue.clear();
+                basis.clear();
+                pivot.clear();
+                std::fill(xmin.begin(), xmin.end(),
+                          numeric_limits<double>::infinity());
+                std::fill(xmax.begin(), xmax.end(),
+                          -numeric_limits<double>::infinity());
+
+                visited[roots[i]] = true;
+                queue.push_back(roots[i]);
+                for (size_t k = 0; k < queue.size(); ++k)
+                {
+                    size_t v = queue[k];
+
+                    upos[v].resize(D);
+                    for (size_t l = 0; l < D; ++l)
+                    {
+                        double x = pos[v][l];
+                        for (size_t j = 0; j < D; ++j)
+                            x += offset[v * D + j] * H[j * D + l];
+                        upos[v][l] = x;
+                        xmin[l] = std::min(xmin[l], x);
+                        xmax[l] = std::max(xmax[l], x);
+                    }
+
+                    for (auto e : out_edges_range(v, g))
+                        visit(v, target(e, g), image[e], 1);
+                    for (auto e : in_edges_range(v, g))
+                        visit(v, source(e, g), image[e], -1);
+                }
+
+                dim[i] = pivot.size();
+                for (size_t l = 0; l < D; ++l)
+                {
+                    bool infinite = false;
+                    for (size_t b = 0; b < pivot.size(); ++b)
+                    {
+                        double x = 0;
+                        for (size_t j = 0; j < D; ++j)
+                            x += basis[b * D + j] * H[j * D + l];
+                        if (std::abs(x) > 1e-8 * hmax)
+                            infinite = true;
+                    }
+                    extent[i * D + l] = infinite ?
+                        numeric_limits<double>::infinity() : xmax[l] - xmin[l];
+                }
+            }
+        }
+    }
+};
+
+} // graph_tool namespace
+
+#endif // GRAPH_PERIODIC_COMPONENTS_HH
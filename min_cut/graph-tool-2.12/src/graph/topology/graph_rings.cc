@@ -0,0 +1,78 @@
+// graph-tool -- a general graph modification and manipulation thingy
+//
+// Copyright (C) 2006-2015 Tiago de Paula Peixoto <tiago@skewed.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "graph.hh"
+#include "graph_filtering.hh"
+#include "graph_properties.hh"
+#include "graph_selectors.hh"
+
+#include "graph_rings.hh"
+
+#include "numpy_bind.hh"
+
+#include <boost/python.hpp>
+
+using namespace std;
+using namespace boost;
+using namespace graph_tool;
+
+python::object do_get_rings(GraphInterface& gi, size_t max_size,
+                            string criterion, boost::any ovhist,
+                            bool return_rings)
+{
+    typedef property_map_type::apply<vector<int32_t>,
+                                     GraphInterface::vertex_index_map_t>::type
+        vhist_map_t;
+
+    bool king;
+    if (criterion == "king")
+        king = true;
+    else if (criterion == "guttman")
+        king = false;
+    else
+        throw ValueException("Invalid ring criterion: " + criterion);
+
+    auto vhist = any_cast<vhist_map_t>(ovhist)
+        .get_unchecked(gi.get_num_vertices(false));
+
+    vector<vector<size_t>> rings;
+    vector<size_t> hist;
+    run_action<graph_tool::detail::never_directed>()
+        (gi, std::bind(get_rings(), placeholders::_1, max_size, king,
+                       std::ref(rings)))();
+    run_action<graph_tool::detail::never_directed>()
+        (gi, std::bind(get_ring_hist(), placeholders::_1, std::cref(rings),
+                       max_size, std::ref(hist), vhist))();
+
+    vector<size_t> ring_vertices, ring_sizes;
+    if (return_rings)
+    {
+        for (auto& r : rings)
+        {
+            ring_vertices.insert(ring_vertices.end(), r.begin(), r.end());
+            ring_sizes.push_back(r.size());
+        }
+    }
+    return python::make_tuple(wrap_vector_owned(hist),
+                              wrap_vector_owned(ring_vertices),
+                              wrap_vector_owned(ring_sizes));
+}
+
+void export_rings()
+{
+    python::def("get_rings", &do_get_rings);
+};
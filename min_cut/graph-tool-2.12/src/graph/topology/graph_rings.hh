@@ -0,0 +1,267 @@
+// graph-tool -- a general graph modification and manipulation thingy
+//
+// Copyright (C) 2006-2015 Tiago de Paula Peixoto <tiago@skewed.de>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef GRAPH_RINGS_HH
+#define GRAPH_RINGS_HH
+
+#include <vector>
+#include <algorithm>
+
+namespace graph_tool
+{
+using namespace std;
+using namespace boost;
+
+// Ring statistics of an undirected graph, with rings of at most max_size
+// vertices:
+//
+//   - King's criterion: for each vertex v and each pair of its neighbours a
+//     and b, the rings are v plus each shortest path from a to b which does
+//     not pass through v.
+//
+//   - Guttman's criterion: for each edge (u, v), the rings are the edge plus
+//     each shortest path from u to v which does not use the edge.
+//
+// The shortest paths are found with a breadth-first search which is bounded
+// by the maximum ring size, and are enumerated backwards from the target
+// through the vertices one step closer to the source. The vertices (or
+// edges) are processed in parallel, each thread with its own search state.
+// Since the same ring is found from many vertices or edges, each ring is put
+// in canonical form (rotated to start at its smallest vertex, and oriented
+// towards its smallest neighbour), and the duplicates are removed.
+
+class RingSearch
+{
+public:
+    RingSearch(size_t N) : _dist(N, -1) {}
+
+    // distances from s, up to max_dist, not passing through the vertex skip,
+    // and not using the edge (s, skip_target)
+    template <class Graph>
+    void bfs(Graph& g, size_t s, size_t skip, size_t skip_target,
+             int max_dist)
+    {
+        reset();
+        _dist[s] = 0;
+        _touched.push_back(s);
+        for (size_t i = 0; i < _touched.size(); ++i)
+        {
+            size_t v = _touched[i];
+            if (_dist[v] >= max_dist)
+                break;
+            for (auto w : adjacent_vertices_range(v, g))
+            {
+                if (_dist[w] != -1 || size_t(w) == skip ||
+                    (v == s && size_t(w) == skip_target))
+                    continue;
+                _dist[w] = _dist[v] + 1;
+                _touched.push_back(w);
+            }
+        }
+    }
+
+    int dist(size_t v) const { return _dist[v]; }
+
+    // calls f(path) for each shortest path from the source of the last
+    // search to t, where path goes from t to the source; the paths are not
+    // allowed to use the edge (source, skip_target)
+    template <class Graph, class F>
+    void shortest_paths(Graph& g, size_t t, size_t skip_target, F&& f)
+    {
+        if (_dist[t] < 0)
+            return;
+        _path.clear();
+        _path.push_back(t);
+        _iter.clear();
+        _iter.push_back(0);
+        while (!_path.empty())
+        {
+            size_t v = _path.back();
+            if (_dist[v] == 0)
+            {
+                f(_path);
+                _path.pop_back();
+                _iter.pop_back();
+                continue;
+            }
+
+            // the next predecessor of v, one step closer to the source
+            size_t k = 0;
+            bool found = false;
+            for (auto w : adjacent_vertices_range(v, g))
+            {
+                if (k++ < _iter.back())
+                    continue;
+                if (_dist[w] != _dist[v] - 1)
+                    continue;
+                if (_dist[w] == 0 && size_t(v) == skip_target)
+                    continue;
+                _iter.back() = k;
+                _path.push_back(w);
+                _iter.push_back(0);
+                found = true;
+                break;
+            }
+            if (!found)
+            {
+                _path.pop_back();
+                _iter.pop_back();
+            }
+        }
+    }
+
+private:
+    void reset()
+    {
+        for (auto v : _touched)
+            _dist[v] = -1;
+        _touched.clear();
+    }
+
+    vector<int> _dist;
+    vector<size_t> _touched;
+    vector<size_t> _path;
+    vector<size_t> _iter;
+};
+
+// rotates and orients a ring into its canonical form
+inline void canonical_ring(vector<size_t>& ring)
+{
+    auto m = std::min_element(ring.begin(), ring.end());
+    std::rotate(ring.begin(), m, ring.end());
+    if (ring.size() > 2 && ring.back() < ring[1])
+        std::reverse(ring.begin() + 1, ring.end());
+}
+
+struct get_rings
+{
+    template <class Graph>
+    void operator()(Graph& g, size_t max_size, bool king,
+                    vector<vector<size_t>>& rings) const
+    {
+        int i, N = num_vertices(g);
+        rings.clear();
+
+        #pragma omp parallel if (N > 100)
+        {
+            RingSearch search(N);
+            vector<vector<size_t>> lrings;
+            vector<size_t> ring;
+
+            #pragma omp for schedule(runtime)
+            for (i = 0; i < N; ++i)
+            {
+                auto v = vertex(i, g);
+                if (v == graph_traits<Graph>::null_vertex())
+                    continue;
+                if (king)
+                {
+                    if (max_size < 3)
+                        continue;
+                    for (auto a : adjacent_vertices_range(v, g))
+                    {
+                        if (a == v)
+                            continue;
+                        search.bfs(g, a, v, v, max_size - 2);
+                        for (auto b : adjacent_vertices_range(v, g))
+                        {
+                            if (b <= a)
+                                continue;
+                            search.shortest_paths
+                                (g, b, v,
+                                 [&](const vector<size_t>& path)
+                                 {
+                                     ring.assign(path.begin(), path.end());
+                                     ring.push_back(v);
+                                     canonical_ring(ring);
+                                     lrings.push_back(ring);
+                                 });
+                        }
+                    }
+                }
+                else
+                {
+                    for (auto u : adjacent_vertices_range(v, g))
+                    {
+                        if (u <= v)
+                            continue;
+                        search.bfs(g, v, graph_traits<Graph>::null_vertex(),
+                                   u, max_size - 1);
+                        search.shortest_paths
+                            (g, u, u,
+                             [&](const vector<size_t>& path)
+                             {
+                                 ring.assign(path.begin(), path.end());
+                                 canonical_ring(ring);
+                                 lrings.push_back(ring);
+                             });
+                    }
+                }
+            }
+
+            std::sort(lrings.begin(), lrings.end());
+            lrings.erase(std::unique(lrings.begin(), lrings.end()),
+                         lrings.end());
+
+            #pragma omp critical (get_rings)
+            {
+                for (auto& r : lrings)
+                    rings.push_back(std::move(r));
+            }
+        }
+
+        std::sort(rings.begin(), rings.end());
+        rings.erase(std::unique(rings.begin(), rings.end()), rings.end());
+    }
+};
+
+// counts the rings of each size, in total and through each vertex
+struct get_ring_hist
+{
+    template <class Graph, class VertexHist>
+    void operator()(Graph& g, const vector<vector<size_t>>& rings,
+                    size_t max_size, vector<size_t>& hist,
+                    VertexHist vhist) const
+    {
+        hist.clear();
+        hist.resize(max_size + 1, 0);
+        for (auto v : vertices_range(g))
+        {
+            vhist[v].clear();
+            vhist[v].resize(max_size + 1, 0);
+        }
+
+        int i, M = rings.size();
+        #pragma omp parallel for default(shared) private(i) \
+            schedule(runtime) if (M > 100)
+        for (i = 0; i < M; ++i)
+        {
+            size_t k = rings[i].size();
+            #pragma omp atomic
+            hist[k]++;
+            for (auto v : rings[i])
+            {
+                #pragma omp atomic
+                vhist[v][k]++;
+            }
+        }
+    }
+};
+
+} // graph_tool namespace
+
+#endif // GRAPH_RINGS_HH
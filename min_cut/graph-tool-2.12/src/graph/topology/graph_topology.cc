@@ -51,6 +51,7 @@ vector<int32_t> get_tsp(GraphInterface& gi, size_t src, boost::any weight_map);
 
 void export_components();
 void export_kcore();
+void export_rings();
 void export_similarity();
 void export_dists();
 void export_all_dists();
@@ -77,6 +78,7 @@ BOOST_PYTHON_MODULE(libgraph_tool_topology)
     def("get_tsp", &get_tsp);
     export_components();
     export_kcore();
+    export_rings();
     export_similarity();
     export_dists();
     export_all_dists();
@@ -35,6 +35,7 @@ Summary
    PropertyMap
    PropertyArray
    load_graph
+   MappedGraph
    group_vector_property
    ungroup_vector_property
    map_property_values
@@ -126,7 +127,8 @@ from inspect import ismethod
 __all__ = ["Graph", "GraphView", "Vertex", "Edge", "VertexBase", "EdgeBase",
            "Vector_bool", "Vector_int16_t", "Vector_int32_t", "Vector_int64_t",
            "Vector_double", "Vector_long_double", "Vector_string",
-           "Vector_size_t", "value_types", "load_graph", "PropertyMap",
+           "Vector_size_t", "value_types", "load_graph", "MappedGraph",
+           "PropertyMap",
            "group_vector_property", "ungroup_vector_property",
            "map_property_values", "infect_vertex_property",
            "edge_endpoint_property", "incident_edges_op", "perfect_prop_hash",
@@ -2154,6 +2156,29 @@ class Graph(object):
         actual size, potentially freeing memory back to the system."""
         self.__graph.shrink_to_fit()
 
+    def freeze(self, compress=False):
+        """Keep a read-only copy of the graph in compressed sparse row form, with
+        32-bit indexes, which is used by the algorithms that support it
+        (currently the component labeling, shortest distance and maximum flow
+        functions) as long as the graph is not modified or filtered. If
+        ``compress == True``, the neighbour lists are additionally
+        delta-encoded, which uses less memory but is slower to traverse.
+
+        The vertex and edge indexes, and therefore all property maps, remain
+        the same. The copy is discarded by :meth:`~graph_tool.Graph.thaw`, and
+        ignored after the graph is modified."""
+        self.__graph.freeze(compress)
+
+    def thaw(self):
+        """Discard the read-only copy of the graph created by
+        :meth:`~graph_tool.Graph.freeze`."""
+        self.__graph.thaw()
+
+    def is_frozen(self):
+        """Return ``True`` if the graph has an up-to-date read-only copy, created
+        by :meth:`~graph_tool.Graph.freeze`."""
+        return self.__graph.is_frozen()
+
     # Property map creation
 
     def new_property(self, key_type, value_type, vals=None):
@@ -2319,8 +2344,9 @@ class Graph(object):
     # ==============
     def __get_file_format(self, file_name):
         fmt = None
-        for f in ["gt", "graphml", "xml", "dot", "gml"]:
-            names = ["." + f, ".%s.gz" % f, ".%s.bz2" % f, ".%s.xz" % f]
+        for f in ["gt", "gtm", "graphml", "xml", "dot", "gml"]:
+            names = ["." + f, ".%s.gz" % f, ".%s.bz2" % f, ".%s.xz" % f,
+                     ".%s.pgz" % f]
             for name in names:
                 if file_name.endswith(name):
                     fmt = f
@@ -2333,12 +2359,15 @@ class Graph(object):
              ignore_gp=None):
         """Load graph from ``file_name`` (which can be either a string or a file-like
         object). The format is guessed from ``file_name``, or can be specified
-        by ``fmt``, which can be either "gt", "graphml", "xml", "dot" or "gml".
-        (Note that "graphml" and "xml" are synonyms).
+        by ``fmt``, which can be either "gt", "gtm", "graphml", "xml", "dot" or
+        "gml".  (Note that "graphml" and "xml" are synonyms, and that "gtm" files
+        can only be read from a file name, see :class:`~graph_tool.MappedGraph`).
 
         If provided, the parameters ``ignore_vp``, ``ignore_ep`` and
         ``ignore_gp``, should contain a list of property names (vertex, edge or
-        graph, respectively) which should be ignored when reading the file.
+        graph, respectively) which should be ignored when reading the file. For
+        "gt" files compressed in chunks (see :meth:`~graph_tool.Graph.save`),
+        the parts of the file which contain them are not decompressed.
 
         .. warning::
 
@@ -2355,7 +2384,8 @@ class Graph(object):
             fmt = self.__get_file_format(file_name)
         elif fmt == "auto":
             fmt = "gt"
-        if isinstance(file_name, (str, unicode)) and file_name.endswith(".xz"):
+        if (isinstance(file_name, (str, unicode)) and
+            file_name.endswith(".xz") and fmt != "gtm"):
             try:
                 import lzma
                 file_name = lzma.open(file_name, mode="rb")
@@ -2400,8 +2430,19 @@ class Graph(object):
     def save(self, file_name, fmt="auto"):
         """Save graph to ``file_name`` (which can be either a string or a file-like
         object). The format is guessed from the ``file_name``, or can be
-        specified by ``fmt``, which can be either "gt", "graphml", "xml", "dot"
-        or "gml".  (Note that "graphml" and "xml" are synonyms).
+        specified by ``fmt``, which can be either "gt", "gtm", "graphml", "xml",
+        "dot" or "gml".  (Note that "graphml" and "xml" are synonyms).
+
+        The "gtm" format is an uncompressed variant of "gt", which can be
+        memory-mapped with :class:`~graph_tool.MappedGraph`. It can only store
+        property maps with scalar value types.
+
+        If ``file_name`` ends with ".gz", ".bz2" or ".xz", the file is
+        compressed accordingly. If it ends with ".pgz", it is compressed with
+        gzip in independent chunks, which are compressed and decompressed in
+        parallel, using the number of threads given by
+        :func:`~graph_tool.openmp_set_num_threads`. These files can also be
+        read by any gzip decompressor.
 
         .. warning::
 
@@ -2436,7 +2477,8 @@ class Graph(object):
         if fmt == "graphml":
             fmt = "xml"
 
-        if isinstance(file_name, (str, unicode)) and file_name.endswith(".xz"):
+        if (isinstance(file_name, (str, unicode)) and
+            file_name.endswith(".xz") and fmt != "gtm"):
             try:
                 import lzma
                 file_name = lzma.open(file_name, mode="wb")
@@ -2731,8 +2773,8 @@ def load_graph(file_name, fmt="auto", ignore_vp=None, ignore_ep=None,
     """Load a graph from ``file_name`` (which can be either a string or a file-like object).
 
     The format is guessed from ``file_name``, or can be specified by ``fmt``,
-    which can be either "gt", "graphml", "xml", "dot" or "gml".  (Note that
-    "graphml" and "xml" are synonyms).
+    which can be either "gt", "gtm", "graphml", "xml", "dot" or "gml".  (Note
+    that "graphml" and "xml" are synonyms).
 
     If provided, the parameters ``ignore_vp``, ``ignore_ep`` and
     ``ignore_gp``, should contain a list of property names (vertex, edge or
@@ -2750,6 +2792,90 @@ def load_graph(file_name, fmt="auto", ignore_vp=None, ignore_ep=None,
     return g
 
 
+class MappedGraph(object):
+    r"""A read-only view of a graph stored in the "gtm" format, which is
+    memory-mapped from ``file_name`` instead of being read.
+
+    The adjacency and the property maps are exposed as read-only
+    :class:`~numpy.ndarray` objects which point directly into the file, so that
+    opening it takes constant time, and only the parts which are accessed are
+    brought into memory. The file is kept open while any of the arrays exist.
+
+    The out-edges are stored in compressed sparse row form, and are returned
+    by :meth:`get_adjacency`: the out-neighbours of vertex ``v`` are
+    ``targets[offsets[v]:offsets[v+1]]``, and the edges are numbered in this
+    order, which is also the order of the values in :attr:`edge_properties`.
+    Undirected graphs store each edge only once, in the adjacency of one of its
+    endpoints.
+
+    A :class:`~graph_tool.Graph` can be saved in this format with
+    :meth:`~graph_tool.Graph.save`, and a modifiable copy can be obtained with
+    :func:`~graph_tool.load_graph`. The file must be read on a machine with the
+    same byte order as the one which wrote it.
+
+    Examples
+    --------
+
+    >>> g = gt.Graph()
+    >>> g.add_vertex(4)
+    <...>
+    >>> g.add_edge_list([(0, 1), (0, 2), (1, 3)])
+    >>> g.ep.weight = g.new_edge_property("double", vals=[0.5, 1.5, 2.5])
+    >>> g.save("mapped.gtm")
+    >>> mg = gt.MappedGraph("mapped.gtm")
+    >>> offsets, targets = mg.get_adjacency()
+    >>> print(offsets, targets)
+    [0 2 3 3 3] [1 2 3]
+    >>> print(mg.edge_properties["weight"])
+    [ 0.5  1.5  2.5]
+    """
+
+    def __init__(self, file_name):
+        file_name = os.path.expanduser(file_name)
+        self.__mg = libcore.MappedGraph(_c_str(file_name))
+        self.__vertex_properties = {}
+        self.__edge_properties = {}
+        self.__graph_properties = {}
+        for kind, name, value_type, a in self.__mg.get_properties():
+            if value_type == "bool":
+                a = a.view("bool")
+            if kind == "v":
+                self.__vertex_properties[name] = a
+            elif kind == "e":
+                self.__edge_properties[name] = a
+            else:
+                self.__graph_properties[name] = a[0]
+
+    def num_vertices(self):
+        """Get the number of vertices."""
+        return self.__mg.get_num_vertices()
+
+    def num_edges(self):
+        """Get the number of edges."""
+        return self.__mg.get_num_edges()
+
+    def is_directed(self):
+        """Get the directedness of the graph."""
+        return self.__mg.get_directed()
+
+    def get_adjacency(self):
+        """Return the ``(offsets, targets)`` arrays with the out-edges of each
+        vertex, as described above."""
+        return self.__mg.get_offsets(), self.__mg.get_targets()
+
+    vertex_properties = property(lambda self: self.__vertex_properties,
+                                 doc="Dictionary of vertex property arrays.")
+    edge_properties = property(lambda self: self.__edge_properties,
+                               doc="Dictionary of edge property arrays.")
+    graph_properties = property(lambda self: self.__graph_properties,
+                                doc="Dictionary of graph property values.")
+
+    def __repr__(self):
+        return "<MappedGraph object, %s, with %d vertices and %d edges at 0x%x>" % \
+            ("directed" if self.is_directed() else "undirected",
+             self.num_vertices(), self.num_edges(), id(self))
+
+
 class GraphView(Graph):
     """A view of selected vertices or edges of another graph.
 
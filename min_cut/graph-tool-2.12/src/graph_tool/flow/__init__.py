@@ -31,8 +31,10 @@ Summary
    edmonds_karp_max_flow
    push_relabel_max_flow
    boykov_kolmogorov_max_flow
+   parallel_push_relabel_max_flow
    min_st_cut
    min_cut
+   FlowNetwork
 
 Contents
 ++++++++
@@ -82,10 +84,21 @@ from __future__ import division, absolute_import, print_function
 from .. dl_import import dl_import
 dl_import("from . import libgraph_tool_flow")
 
-from .. import _prop, _check_prop_scalar, _check_prop_writable, GraphView
+from .. import _prop, _check_prop_scalar, _check_prop_writable
+import numpy
+
+def _vertex_array(vs):
+    """Return an int64 array with the indexes of a vertex or of a sequence of
+    vertices."""
+    try:
+        vs = [int(v) for v in vs]
+    except TypeError:
+        vs = [int(vs)]
+    return numpy.array(vs, dtype="int64")
 
 __all__ = ["edmonds_karp_max_flow", "push_relabel_max_flow",
-           "boykov_kolmogorov_max_flow", "min_st_cut", "min_cut"]
+           "boykov_kolmogorov_max_flow", "parallel_push_relabel_max_flow",
+           "min_st_cut", "min_cut", "FlowNetwork"]
 
 
 def edmonds_karp_max_flow(g, source, target, capacity, residual=None):
@@ -347,9 +360,9 @@ def boykov_kolmogorov_max_flow(g, source, target, capacity, residual=None):
                                    _prop("e", g, residual))
     return residual
 
-def min_st_cut(g, source, capacity, residual):
-    r"""
-    Get the minimum source-target cut, given the residual capacity of the edges.
+def parallel_push_relabel_max_flow(g, source, target, capacity, residual=None):
+    r"""Calculate maximum flow on the graph with a parallel version of the
+    push-relabel algorithm.
 
     Parameters
     ----------
@@ -357,16 +370,103 @@ def min_st_cut(g, source, capacity, residual):
         Graph to be used.
     source : Vertex
         The source vertex.
+    target : Vertex
+        The target (or "sink") vertex.
+    capacity : :class:`~graph_tool.PropertyMap`
+        Edge property map with the edge capacities.
+    residual : :class:`~graph_tool.PropertyMap` (optional, default: none)
+        Edge property map where the residuals should be stored.
+
+    Returns
+    -------
+    residual : :class:`~graph_tool.PropertyMap`
+        Edge property map with the residual capacities (capacity - flow).
+
+    Notes
+    -----
+    This is a synchronous variant of the algorithm in [goldberg-new-1985]_,
+    where all active vertices are pushed and relabeled at the same time, in
+    rounds, and the distance labels are periodically recomputed with a
+    breadth-first search from the target [cherkassky-implementing-1997]_. The
+    rounds are run in parallel, and the graph is not modified, i.e. no reverse
+    edges are temporarily added to it.
+
+    The computed flow does not depend on the number of threads, and is the same
+    in every run. Its value is the same as the one obtained with
+    :func:`~graph_tool.flow.push_relabel_max_flow`, but the flow itself may be
+    a different one, if the maximum flow is not unique.
+
+    Examples
+    --------
+    >>> g = gt.load_graph("flow-example.xml.gz")
+    >>> cap = g.edge_properties["cap"]
+    >>> src, tgt = g.vertex(0), g.vertex(1)
+    >>> res = gt.parallel_push_relabel_max_flow(g, src, tgt, cap)
+    >>> res.a = cap.a - res.a  # the actual flow
+    >>> max_flow = sum(res[e] for e in tgt.in_edges())
+    >>> print(max_flow)
+    44.8905957841...
+
+    References
+    ----------
+    .. [cherkassky-implementing-1997] B. V. Cherkassky and A. V. Goldberg,
+       "On Implementing the Push-Relabel Method for the Maximum Flow Problem",
+       Algorithmica, vol. 19, no. 4, pp. 390-410, 1997.
+       :doi:`10.1007/PL00009180`
+    """
+    _check_prop_scalar(capacity, "capacity")
+    if residual == None:
+        residual = g.new_edge_property(capacity.value_type())
+    _check_prop_scalar(residual, "residual")
+    _check_prop_writable(residual, "residual")
+
+    if not g.is_directed():
+        raise ValueError("The graph provided must be directed!")
+
+    libgraph_tool_flow.\
+        parallel_push_relabel_max_flow(g._Graph__graph, int(source),
+                                       int(target), _prop("e", g, capacity),
+                                       _prop("e", g, residual))
+    return residual
+
+def min_st_cut(g, source, capacity, residual, cut_edges=False,
+               edge_type=None):
+    r"""
+    Get the minimum source-target cut, given the residual capacity of the edges.
+
+    Parameters
+    ----------
+    g : :class:`~graph_tool.Graph`
+        Graph to be used.
+    source : Vertex or sequence of vertices
+        The source vertex, or a set of source vertices.
     capacity : :class:`~graph_tool.PropertyMap`
         Edge property map with the edge capacities.
     residual : :class:`~graph_tool.PropertyMap`
         Edge property map with the residual capacities (capacity - flow).
+    cut_edges : bool (optional, default: ``False``)
+        If ``True``, the cut value and the edges of the cut are also returned.
+    edge_type : :class:`~graph_tool.PropertyMap` (optional, default: ``None``)
+        Integer-valued edge property map with edge types. If given (together
+        with ``cut_edges == True``), the number of cut edges of each type is
+        also returned.
 
     Returns
     -------
     partition : :class:`~graph_tool.PropertyMap`
         Boolean-valued vertex property map with the cut partition. Vertices with
         value `True` belong to the source side of the cut.
+    cut_value : float
+        Sum of the capacities of the edges from the source to the target side
+        of the cut (only returned if ``cut_edges == True``).
+    edges : :class:`~numpy.ndarray`
+        Array of shape ``(E_c, 3)`` with the source, target and index of each
+        edge from the source to the target side of the cut, ordered by edge
+        index (only returned if ``cut_edges == True``).
+    type_count : :class:`~numpy.ndarray`
+        Number of cut edges of each type, i.e. ``type_count[t]`` is the number of
+        cut edges with ``edge_type[e] == t`` (only returned if ``cut_edges ==
+        True``, and empty if ``edge_type`` is not given).
 
     Notes
     -----
@@ -374,6 +474,9 @@ def min_st_cut(g, source, capacity, residual):
     The source-side of the cut set is obtained by following all vertices which
     are reachable from the source in the residual graph (i.e. via edges
     with nonzero residual capacity, and reversed edges with nonzero flow).
+    The edges of the cut are collected in the same pass over the graph. Both
+    are done in parallel, and the results do not depend on the number of
+    threads.
 
     This algorithm runs in :math:`O(V+E)` time.
 
@@ -387,6 +490,9 @@ def min_st_cut(g, source, capacity, residual):
     >>> mc = sum([cap[e] - res[e] for e in g.edges() if part[e.source()] != part[e.target()]])
     >>> print(mc)
     3
+    >>> part, mc, edges, count = gt.min_st_cut(g, src, cap, res, cut_edges=True)
+    >>> print(mc)
+    3.0
     >>> pos = g.vertex_properties["pos"]
     >>> res.a = cap.a - res.a  # the actual flow
     >>> gt.graph_draw(g, pos=pos, edge_pen_width=gt.prop_to_size(cap, mi=3, ma=10, power=1),
@@ -415,21 +521,21 @@ def min_st_cut(g, source, capacity, residual):
     """
     if not g.is_directed():
         raise ValueError("The graph provided must be directed!")
-    augment = g.new_edge_property("bool")
-    libgraph_tool_flow.residual_graph(g._Graph__graph,
-                                      _prop("e", g, capacity),
-                                      _prop("e", g, residual),
-                                      _prop("e", g, augment))
-    em = g.new_edge_property("bool")
-    em.a = (residual.a[:len(em.a)] > 0) + augment.a
-    u = GraphView(g, efilt=em)
-    part = label_out_component(u, source)
-    part = g.own_property(part)
-
-    # cleanup augmented edges
-    u = GraphView(g, efilt=augment)
-    u.clear_edges()
-
+    _check_prop_scalar(capacity, "capacity")
+    _check_prop_scalar(residual, "residual")
+    if edge_type is not None:
+        _check_prop_scalar(edge_type, "edge_type")
+        if edge_type.value_type() != "int32_t":
+            edge_type = edge_type.copy("int32_t")
+    part = g.new_vertex_property("bool")
+    ret = libgraph_tool_flow.min_st_cut(g._Graph__graph, _vertex_array(source),
+                                        _prop("e", g, capacity),
+                                        _prop("e", g, residual),
+                                        _prop("v", g, part),
+                                        _prop("e", g, edge_type))
+    if cut_edges:
+        mc, edges, type_count = ret
+        return part, mc, edges, type_count
     return part
 
 
@@ -498,4 +604,104 @@ def min_cut(g, weight):
                                     _prop("v", g, part))
     return mc, part
 
-from .. topology import label_out_component
+
+class FlowNetwork(object):
+    r"""Residual network of a directed graph, which can be reused for many
+    maximum flow computations.
+
+    Parameters
+    ----------
+    g : :class:`~graph_tool.Graph`
+        Graph to be used.
+    capacity : :class:`~graph_tool.PropertyMap` (optional, default: ``None``)
+        Edge property map with the edge capacities. If not given, it must be
+        set with :meth:`set_capacity` before the flow is computed.
+
+    Notes
+    -----
+    The network is built only once, in :math:`O(V + E)` time, and stores a
+    forward and a reverse arc for each edge, in compressed sparse row form. It
+    can then be used to compute the maximum flow between any pair of vertices,
+    and with any number of different capacities, without modifying the graph.
+    The functions :func:`push_relabel_max_flow`,
+    :func:`boykov_kolmogorov_max_flow` etc. build such a network each time they
+    are called.
+
+    The network must be created again if edges or vertices are added to or
+    removed from the graph.
+
+    With the ``"parallel_push_relabel"`` algorithm, the source and target may
+    also be sets of vertices, which behave as if they were connected to a
+    single source and target by edges of infinite capacity (no such edges are
+    actually added to the graph). In this case, with ``incremental=True``, the
+    computation starts from the current flow, instead of zero, which is much
+    faster if it is already close to the final one. This is possible whenever
+    every source of the previous computation is still a source, and no edge has
+    a flow larger than its capacity, e.g. when the source and target sets are
+    grown one step at a time, or when the capacities are increased (see
+    :meth:`set_capacity` and :meth:`scale_capacity`). Otherwise, the flow is
+    computed from zero.
+
+    Examples
+    --------
+    >>> g = gt.load_graph("flow-example.xml.gz")
+    >>> cap = g.edge_properties["cap"]
+    >>> net = gt.FlowNetwork(g, cap)
+    >>> print(net.max_flow(g.vertex(0), g.vertex(1)))
+    44.8905957841...
+    >>> cap.a *= 2
+    >>> net.set_capacity(cap)
+    >>> print(net.max_flow(g.vertex(0), g.vertex(1), "boykov_kolmogorov"))
+    89.781191568...
+    >>> res = net.residual()
+
+    The source and target can also be sets of vertices:
+
+    >>> f = [net.max_flow(range(0, k), range(100, 100 + k), incremental=True)
+    ...      for k in range(1, 20)]
+    """
+
+    def __init__(self, g, capacity=None):
+        if not g.is_directed():
+            raise ValueError("The graph provided must be directed!")
+        self.g = g
+        self.__net = libgraph_tool_flow.FlowNetwork(g._Graph__graph)
+        if capacity is not None:
+            self.set_capacity(capacity)
+
+    def set_capacity(self, capacity, keep_flow=False):
+        """Set the capacities of the edges, and reset the flow to zero. If
+        ``keep_flow == True``, the flow of each edge is kept instead, if it does
+        not exceed the new capacity (otherwise it is reduced to it)."""
+        _check_prop_scalar(capacity, "capacity")
+        self.__net.set_capacity(self.g._Graph__graph,
+                                _prop("e", self.g, capacity), keep_flow)
+
+    def scale_capacity(self, c):
+        """Multiply the capacities of all edges, and the current flow, by ``c``.
+        """
+        self.__net.scale_capacity(c)
+
+    def max_flow(self, source, target, algorithm="parallel_push_relabel",
+                 incremental=False):
+        """Compute the maximum flow from ``source`` to ``target``, and return its
+        value. The ``algorithm`` can be one of ``"parallel_push_relabel"``,
+        ``"push_relabel"``, ``"boykov_kolmogorov"`` or ``"edmonds_karp"``. The
+        ``source`` and ``target`` may be single vertices, or (only with
+        ``"parallel_push_relabel"``) sequences of vertices. If ``incremental ==
+        True``, the computation starts from the current flow, if possible. The
+        flow itself can be obtained with :meth:`residual`."""
+        return self.__net.max_flow(_vertex_array(source), _vertex_array(target),
+                                   algorithm, incremental)
+
+    def residual(self, residual=None):
+        """Return an edge property map with the residual capacities (capacity -
+        flow) of the last flow computed. If ``residual`` is given, the values
+        are stored in it."""
+        if residual is None:
+            residual = self.g.new_edge_property("double")
+        _check_prop_scalar(residual, "residual")
+        _check_prop_writable(residual, "residual")
+        self.__net.get_residual(self.g._Graph__graph,
+                                _prop("e", self.g, residual))
+        return residual
@@ -36,6 +36,7 @@ Summary
    triangulation
    lattice
    geometric_graph
+   bond_graph
    price_network
    complete_graph
    circular_graph
@@ -62,7 +63,7 @@ import numpy.random
 
 __all__ = ["random_graph", "random_rewire", "predecessor_tree", "line_graph",
            "graph_union", "triangulation", "lattice", "geometric_graph",
-           "price_network", "complete_graph", "circular_graph"]
+           "bond_graph", "price_network", "complete_graph", "circular_graph"]
 
 
 def random_graph(N, deg_sampler, directed=True,
@@ -1416,6 +1417,10 @@ def geometric_graph(points, radius, ranges=None):
     embedded in a N-dimensional euclidean space which are at a distance equal to
     or smaller than a given radius.
 
+    The points are binned in a cell list, with cells not smaller than the
+    radius, and only the points in neighbouring cells are compared, in
+    parallel. The complexity is :math:`O(N)` for points with bounded density.
+
     See Also
     --------
     triangulation: 2D or 3D triangulation
@@ -1466,16 +1471,12 @@ def geometric_graph(points, radius, ranges=None):
 
     g = Graph(directed=False)
     pos = g.new_vertex_property("vector<double>")
-    if type(points) != numpy.ndarray:
-        points = numpy.array(points)
-    if len(points.shape) < 2:
+    points = numpy.asarray(points, dtype="float")
+    if len(points.shape) != 2:
         raise ValueError("points list must be a two-dimensional array!")
     if ranges is not None:
         periodic = True
-        if type(ranges) != numpy.ndarray:
-            ranges = numpy.array(ranges, dtype="float")
-        else:
-            ranges = array(ranges, dtype="float")
+        ranges = numpy.asarray(ranges, dtype="float")
     else:
         periodic = False
         ranges = ()
@@ -1486,6 +1487,114 @@ def geometric_graph(points, radius, ranges=None):
     return g, pos
 
 
+def bond_graph(points, types, cutoff, capacity=None, box=None, periodic=False,
+               directed=False):
+    r"""Generate the bond graph of a set of typed points (e.g. atoms), using
+    a cutoff distance for each pair of types.
+
+    Parameters
+    ----------
+    points : :class:`~numpy.ndarray`
+        Point coordinates, as a two-dimensional array of shape ``(N, D)``.
+    types : :class:`~numpy.ndarray`
+        Type of each point, as integers in the range ``[0, T)``.
+    cutoff : :class:`~numpy.ndarray`
+        Array of shape ``(T, T)``, where ``cutoff[a][b]`` is the maximum
+        distance between bonded points of types ``a`` and ``b``. Only the
+        entries with ``a <= b`` are used.
+    capacity : :class:`~numpy.ndarray` (optional, default: ``None``)
+        Array of shape ``(T, T)`` with the capacity of each type of bond. If
+        given, it will be stored in the internal edge property ``"capacity"``.
+    box : :class:`~numpy.ndarray` (optional, default: ``None``)
+        Array of shape ``(D, D)``, where each row is one of the cell vectors of
+        the simulation box, which may be triclinic. The box starts at the
+        origin. If not given, the bounding box of the points is used.
+    periodic : ``bool`` or list of ``bool`` (optional, default: ``False``)
+        Whether the box is periodic, either along all its axes, or along each
+        one of them. Periodic boundaries require the box to be given.
+    directed : ``bool`` (optional, default: ``False``)
+        If ``True``, a directed graph is generated, with one edge in each
+        direction per bond (as needed for flow computations).
+
+    Returns
+    -------
+    bond_graph : :class:`~graph_tool.Graph`
+        The generated graph, with the internal vertex property ``"type"`` with
+        the point types, and the internal edge property ``"bond_type"`` with
+        the value ``a * T + b`` for a bond between types ``a <= b``. With
+        periodic boundaries, the internal edge property ``"image"`` contains,
+        for each edge ``(u, v)``, the periodic image of ``v`` to which ``u`` is
+        bonded, as the integer multiples of the cell vectors which are added
+        to the position of ``v`` (see
+        :func:`~graph_tool.topology.label_periodic_components`).
+
+    Notes
+    -----
+    Two points are bonded if their distance is smaller or equal than the
+    cutoff of their types. With periodic boundaries, the minimum image
+    convention is used, which requires the largest cutoff to be at most half
+    the width of the box along each periodic axis.
+
+    The points are binned in a flat cell list, with cells not smaller than the
+    largest cutoff, so that only the points in neighbouring cells are
+    compared, and the cells are processed in parallel. The complexity is
+    :math:`O(N)` for points with bounded density.
+
+    See Also
+    --------
+    geometric_graph : N-dimensional geometric network
+
+    Examples
+    --------
+    >>> x = numpy.arange(4.)
+    >>> points = numpy.array([(i, j, k) for i in x for j in x for k in x])
+    >>> types = numpy.zeros(len(points), dtype="int")
+    >>> g = gt.bond_graph(points, types, [[1.]], box=numpy.eye(3) * 4,
+    ...                   periodic=True)
+    >>> print(g.num_vertices(), g.num_edges())
+    64 192
+
+    """
+
+    points = numpy.array(points, dtype="float")
+    if len(points.shape) != 2:
+        raise ValueError("points list must be a two-dimensional array!")
+    D = points.shape[1]
+    types = numpy.asarray(types, dtype="int32")
+    cutoff = numpy.array(cutoff, dtype="float", ndmin=2)
+    if box is not None:
+        box = numpy.array(box, dtype="float", ndmin=2)
+    if numpy.isscalar(periodic):
+        periodic = [periodic] * D
+    periodic = [bool(p) for p in periodic]
+
+    g = Graph(directed=directed)
+    btype = g.new_edge_property("int32_t")
+    if capacity is not None:
+        capacity = numpy.array(capacity, dtype="float", ndmin=2)
+        cap = g.new_edge_property("double")
+    else:
+        capacity = numpy.zeros((0, 0))
+        cap = None
+
+    image = g.new_edge_property("vector<int32_t>") if any(periodic) else None
+
+    libgraph_tool_generation.bond_graph(g._Graph__graph, points, types, cutoff,
+                                        capacity, box, periodic, directed,
+                                        _prop("e", g, btype), _prop("e", g, cap),
+                                        _prop("e", g, image))
+
+    vtype = g.new_vertex_property("int32_t")
+    vtype.a = types
+    g.vertex_properties["type"] = vtype
+    g.edge_properties["bond_type"] = btype
+    if cap is not None:
+        g.edge_properties["capacity"] = cap
+    if image is not None:
+        g.edge_properties["image"] = image
+    return g
+
+
 def price_network(N, m=1, c=None, gamma=1, directed=True, seed_graph=None):
     r"""A generalized version of Price's -- or Barabási-Albert if undirected -- preferential attachment network model.
 
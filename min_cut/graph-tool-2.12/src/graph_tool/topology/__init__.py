@@ -29,6 +29,7 @@ Summary
    :nosignatures:
 
    shortest_distance
+   distance_statistics
    shortest_path
    pseudo_diameter
    similarity
@@ -47,8 +48,12 @@ Summary
    label_components
    label_biconnected_components
    label_largest_component
+   label_wrapping_components
+   label_periodic_components
    label_out_component
+   DynamicComponents
    kcore_decomposition
+   ring_statistics
    is_bipartite
    is_DAG
    is_planar
@@ -76,8 +81,12 @@ __all__ = ["isomorphism", "subgraph_isomorphism", "mark_subgraph",
            "min_spanning_tree", "random_spanning_tree", "dominator_tree",
            "topological_sort", "transitive_closure", "tsp_tour",
            "sequential_vertex_coloring", "label_components",
-           "label_largest_component", "label_biconnected_components",
-           "label_out_component", "kcore_decomposition", "shortest_distance",
+           "label_largest_component", "label_wrapping_components",
+           "label_periodic_components",
+           "label_biconnected_components",
+           "label_out_component", "DynamicComponents",
+           "kcore_decomposition", "ring_statistics", "shortest_distance",
+           "distance_statistics",
            "shortest_path", "pseudo_diameter", "is_bipartite", "is_DAG",
            "is_planar", "make_maximal_planar", "similarity", "edge_reciprocity"]
 
@@ -781,7 +790,19 @@ def label_components(g, vprop=None, directed=None, attractors=False):
     The components are arbitrarily labeled from 0 to N-1, where N is the total
     number of components.
 
-    The algorithm runs in :math:`O(V + E)` time.
+    The algorithm runs in :math:`O(V + E)` time. For undirected graphs, the
+    components are found with the Afforest algorithm
+    [sutton-optimizing-2018]_, and are labeled in the order of their first
+    vertex.
+
+    If enabled during compilation, this algorithm runs in parallel (undirected
+    graphs only).
+
+    References
+    ----------
+    .. [sutton-optimizing-2018] M. Sutton, T. Ben-Nun, A. Barak, "Optimizing
+       Parallel Graph Connectivity Computation via Subgraph Sampling", IEEE
+       IPDPS, 2018, :doi:`10.1109/IPDPS.2018.00012`
 
     Examples
     --------
@@ -881,6 +902,186 @@ def label_largest_component(g, directed=None):
     return label
 
 
+def label_wrapping_components(g, pos, box, vprop=None):
+    r"""Label the components of a graph embedded in a periodic box, and find
+    which of them wrap around the box (i.e. percolate), along each dimension.
+
+    Parameters
+    ----------
+    g : :class:`~graph_tool.Graph`
+        Graph to be used. Edge directions are ignored.
+    pos : :class:`~graph_tool.PropertyMap`
+        Vertex property map with the positions of the vertices, as returned by
+        :func:`~graph_tool.generation.geometric_graph` or used in
+        :func:`~graph_tool.generation.bond_graph`.
+    box : list of floats
+        The length of the (orthogonal) periodic box along each dimension.
+    vprop : :class:`~graph_tool.PropertyMap` (optional, default: ``None``)
+        Vertex property to store the component labels. If none is supplied, one
+        is created.
+
+    Returns
+    -------
+    comp : :class:`~graph_tool.PropertyMap`
+        Vertex property map with component labels, as in
+        :func:`label_components`.
+    hist : :class:`~numpy.ndarray`
+        Histogram of component labels.
+    wrap : :class:`~numpy.ndarray`
+        Boolean array of shape ``(len(hist), len(box))``, such that
+        ``wrap[c, d]`` is ``True`` if component ``c`` wraps around dimension
+        ``d``.
+
+    Notes
+    -----
+    An edge is assumed to cross the periodic boundary of dimension ``d`` if the
+    positions of its endpoints along ``d`` are further apart than half the box
+    length. For each dimension, the graph is lifted to a graph with two copies
+    of each vertex, where the edges which cross the boundary connect different
+    copies. A component wraps around the box if the two copies of its vertices
+    are connected, i.e. if it contains a cycle which crosses the boundary an
+    odd number of times. A component whose cycles all cross the boundary an
+    even number of times is not detected. For an exact test, which requires the
+    periodic image of each edge, see :func:`label_periodic_components`.
+
+    The components of the original and of the lifted graphs are found in
+    parallel, as in :func:`label_components`, so that the algorithm runs in
+    :math:`O(D(V + E))` time, for :math:`D` dimensions.
+
+    Examples
+    --------
+    >>> g = gt.lattice([10, 10], periodic=True)
+    >>> x = numpy.arange(g.num_vertices())
+    >>> pos = g.new_vertex_property("vector<double>")
+    >>> pos.set_2d_array(numpy.array([x % 10, x // 10], dtype="float"))
+    >>> comp, hist, wrap = gt.label_wrapping_components(g, pos, [10, 10])
+    >>> print(hist, wrap)
+    [100] [[ True  True]]
+    """
+
+    if vprop is None:
+        vprop = g.new_vertex_property("int32_t")
+
+    _check_prop_writable(vprop, name="vprop")
+    _check_prop_scalar(vprop, name="vprop")
+    _check_prop_vector(pos, name="pos", floating=True)
+
+    box = numpy.asarray(box, dtype="float")
+    g = GraphView(g, directed=False)
+    hist, wrap = libgraph_tool_topology.\
+                   label_wrapping_components(g._Graph__graph,
+                                             _prop("v", g, vprop),
+                                             _prop("v", g, pos), box)
+    wrap = numpy.asarray(wrap, dtype="bool").reshape((len(hist), len(box)))
+    return vprop, hist, wrap
+
+
+def label_periodic_components(g, image, pos, box, vprop=None, upos=None):
+    r"""Label the components of a graph of bonded points in a periodic box, and
+    find their wrapping dimensionality and unwrapped extent, using the periodic
+    image of each edge.
+
+    Parameters
+    ----------
+    g : :class:`~graph_tool.Graph`
+        Graph to be used. Edge directions are ignored.
+    image : :class:`~graph_tool.PropertyMap`
+        Edge property map of type ``vector<int32_t>``, with the periodic image
+        of each edge ``(u, v)``, i.e. the integer multiples of the cell vectors
+        which are added to the position of ``v`` to obtain the image bonded to
+        ``u``, as given by :func:`~graph_tool.generation.bond_graph`.
+    pos : :class:`~graph_tool.PropertyMap`
+        Vertex property map with the positions of the vertices.
+    box : :class:`~numpy.ndarray`
+        Array of shape ``(D, D)``, where each row is one of the cell vectors of
+        the box, or list of the box lengths, for an orthogonal box.
+    vprop : :class:`~graph_tool.PropertyMap` (optional, default: ``None``)
+        Vertex property of type ``int32_t`` to store the component labels. If
+        none is supplied, one is created.
+    upos : :class:`~graph_tool.PropertyMap` (optional, default: ``None``)
+        Vertex property of type ``vector<double>`` to store the unwrapped
+        positions. If none is supplied, one is created.
+
+    Returns
+    -------
+    comp : :class:`~graph_tool.PropertyMap`
+        Vertex property map with component labels, as in
+        :func:`label_components`.
+    hist : :class:`~numpy.ndarray`
+        Histogram of component labels.
+    dim : :class:`~numpy.ndarray`
+        Wrapping dimensionality of each component: ``0`` for finite
+        components, ``1`` for infinite chains, ``2`` for infinite sheets, and
+        ``3`` for infinite networks.
+    extent : :class:`~numpy.ndarray`
+        Array of shape ``(len(hist), D)`` with the extent of each component
+        along each axis, after it is unwrapped, which is infinite along the
+        axes spanned by its windings.
+    upos : :class:`~graph_tool.PropertyMap`
+        Vertex property map with the unwrapped positions, where each finite
+        component is contiguous.
+
+    Notes
+    -----
+    Each component is traversed from its first vertex, and each vertex is
+    given the image offset of the path through which it is reached, which
+    unwraps it. Every other edge of the component closes a cycle, which winds
+    around the box by the difference between the offset it implies for its
+    endpoint and the one already assigned. The rank of these winding vectors is
+    the wrapping dimensionality of the component. Unlike
+    :func:`label_wrapping_components`, this is exact, and also distinguishes
+    chains, sheets and networks which wrap along several axes.
+
+    The components are found in parallel, as in :func:`label_components`, and
+    are then traversed in parallel, so that the algorithm runs in
+    :math:`O(D(V + E))` time.
+
+    Examples
+    --------
+    >>> points = numpy.array([(i, 2 * j) for i in range(4) for j in range(2)],
+    ...                      dtype="float")
+    >>> g = gt.bond_graph(points, numpy.zeros(len(points)), [[1.]],
+    ...                   box=numpy.eye(2) * 4, periodic=True)
+    >>> pos = g.new_vertex_property("vector<double>")
+    >>> pos.set_2d_array(points.T)
+    >>> comp, hist, dim, extent, upos = \
+    ...     gt.label_periodic_components(g, g.edge_properties["image"], pos,
+    ...                                  [4, 4])
+    >>> print(hist, dim)
+    [4 4] [1 1]
+    """
+
+    if vprop is None:
+        vprop = g.new_vertex_property("int32_t")
+    if vprop.value_type() != "int32_t":
+        raise ValueError("value type of `vprop` must be `int32_t`, not %s" %
+                         vprop.value_type())
+    _check_prop_writable(vprop, name="vprop")
+    if upos is None:
+        upos = g.new_vertex_property("vector<double>")
+    if upos.value_type() != "vector<double>":
+        raise ValueError("value type of `upos` must be `vector<double>`, not %s" %
+                         upos.value_type())
+    if image.value_type() != "vector<int32_t>":
+        image = image.copy("vector<int32_t>")
+    if pos.value_type() != "vector<double>":
+        pos = pos.copy("vector<double>")
+
+    box = numpy.array(box, dtype="float")
+    if box.ndim == 1:
+        box = numpy.diag(box)
+
+    # the images follow the stored direction of the edges, so the view must
+    # not be reversed
+    u = GraphView(g, directed=True, reversed=g.is_reversed())
+    hist, dim, extent = libgraph_tool_topology.\
+        label_periodic_components(u._Graph__graph, _prop("v", u, vprop),
+                                  _prop("e", u, image), _prop("v", u, pos),
+                                  _prop("v", u, upos), box)
+    extent = extent.reshape((len(hist), box.shape[0]))
+    return vprop, hist, dim, extent, upos
+
+
 def label_out_component(g, root, label=None):
     """
     Label the out-component (or simply the component for undirected graphs) of a
@@ -942,6 +1143,105 @@ def label_out_component(g, root, label=None):
     return label
 
 
+class DynamicComponents(object):
+    r"""Connected components of a graph, which are updated as edges are
+    inserted and removed, instead of being labeled again from scratch.
+
+    Parameters
+    ----------
+    g : :class:`~graph_tool.Graph`
+        Graph to be used. Edge directions are ignored.
+
+    Notes
+    -----
+    The components are labeled only once, in :math:`O(V + E)` time, when the
+    object is created. The object keeps its own copy of the edges, which is
+    modified with :meth:`add_edges` and :meth:`remove_edges`; the graph itself
+    is never modified, and the same changes must be made to it separately, if
+    desired.
+
+    When an edge joins two components, the smaller one is relabeled, so that
+    each vertex is relabeled at most :math:`O(\log V)` times in any sequence
+    of insertions. When an edge is removed, two searches are started at the
+    same time from its endpoints, and stop as soon as they meet (the component
+    is still connected) or one of them runs out of vertices (the component was
+    split in two). The cost is proportional to the smaller of the two pieces,
+    or to the region explored until the searches meet, which is small if the
+    edge belongs to a short cycle. The label and the size of the component of a
+    vertex are available at any time, in :math:`O(1)` time.
+
+    Parallel edges are counted, so that two vertices are disconnected only
+    after all the edges between them are removed. Self-loops are ignored.
+
+    Examples
+    --------
+    >>> g = gt.lattice([10, 10])
+    >>> comp = gt.DynamicComponents(g)
+    >>> print(comp.num_components())
+    1
+    >>> comp.remove_edges(g.vertex(0).out_edges())
+    >>> print(comp.num_components(), comp.component_size(g.vertex(0)))
+    2 1
+    >>> comp.add_edges([(0, 99)])
+    >>> print(comp.num_components(), comp.component_size(g.vertex(0)))
+    1 100
+    """
+
+    def __init__(self, g):
+        self.g = g
+        self.__comp = libgraph_tool_topology.DynamicComponents(g._Graph__graph)
+
+    @staticmethod
+    def __edge_array(edges):
+        if isinstance(edges, numpy.ndarray):
+            edges = numpy.asarray(edges, dtype="int64")
+        else:
+            edges = numpy.array([(int(e.source()), int(e.target()))
+                                 if hasattr(e, "source") else
+                                 (int(e[0]), int(e[1])) for e in edges],
+                                dtype="int64")
+        return edges.reshape((-1, 2))
+
+    def add_edges(self, edges):
+        """Insert the given edges, which can be a list of
+        :class:`~graph_tool.Edge` instances, or of pairs of vertices, or an
+        array of shape ``(E, 2)`` with vertex indexes."""
+        self.__comp.add_edges(self.__edge_array(edges))
+
+    def remove_edges(self, edges):
+        """Remove the given edges, which are given as in :meth:`add_edges`. A
+        :class:`ValueError` is raised if one of them does not exist."""
+        self.__comp.remove_edges(self.__edge_array(edges))
+
+    def label(self, v):
+        """Return the label of the component of vertex ``v``. The labels are
+        not contiguous, and change as the components are modified, but two
+        vertices have the same label if and only if they belong to the same
+        component."""
+        return self.__comp.label(int(v))
+
+    def component_size(self, v):
+        """Return the number of vertices in the component of vertex ``v``."""
+        return self.__comp.component_size(int(v))
+
+    def num_components(self):
+        """Return the current number of components."""
+        return self.__comp.num_components()
+
+    def labels(self, vprop=None):
+        """Return a vertex property map with the component labels, and the
+        histogram of component labels, exactly as :func:`label_components`
+        would for the current edges (of an undirected graph). This takes
+        :math:`O(V)` time."""
+        if vprop is None:
+            vprop = self.g.new_vertex_property("int32_t")
+        _check_prop_writable(vprop, name="vprop")
+        _check_prop_scalar(vprop, name="vprop")
+        hist = self.__comp.get_labels(self.g._Graph__graph,
+                                      _prop("v", self.g, vprop))
+        return vprop, hist
+
+
 def label_biconnected_components(g, eprop=None, vprop=None):
     """
     Label the edges of biconnected components, and the vertices which are
@@ -1114,6 +1414,87 @@ def kcore_decomposition(g, deg="out", vprop=None):
     return vprop
 
 
+def ring_statistics(g, max_size=12, criterion="king", vprop=None, rings=False):
+    r"""Obtain the ring statistics of the graph, i.e. the number of rings of each
+    size, in total and through each vertex.
+
+    Parameters
+    ----------
+    g : :class:`~graph_tool.Graph`
+        Graph to be used. Edge directions are ignored.
+    max_size : int (optional, default: ``12``)
+        Maximum number of vertices of the rings.
+    criterion : string (optional, default: ``"king"``)
+        Ring criterion, which must be either ``"king"`` for King's shortest-path
+        rings [king-ring]_, or ``"guttman"`` for Guttman's primitive rings
+        [guttman-ring]_.
+    vprop : :class:`~graph_tool.PropertyMap` (optional, default: ``None``)
+        Vertex property of type ``vector<int32_t>`` to store the number of rings
+        of each size through each vertex. If none is supplied, one is created.
+    rings : bool (optional, default: ``False``)
+        If ``True``, the list of rings is also returned.
+
+    Returns
+    -------
+    hist : :class:`~numpy.ndarray`
+        Array of length ``max_size + 1``, with the number of rings of each size.
+    vhist : :class:`~graph_tool.PropertyMap`
+        Vertex property map with the number of rings of each size through each
+        vertex.
+    ring_list : list of :class:`~numpy.ndarray`
+        List of rings, each given by the sequence of its vertices (only
+        returned if ``rings == True``).
+
+    Notes
+    -----
+    With King's criterion, for each vertex :math:`v` and each pair of its
+    neighbours :math:`a` and :math:`b`, the rings are :math:`v` plus each
+    shortest path from :math:`a` to :math:`b` which does not pass through
+    :math:`v`. With Guttman's criterion, for each edge :math:`(u, v)`, the rings
+    are the edge plus each shortest path from :math:`u` to :math:`v` which does
+    not use the edge.
+
+    The shortest paths are found with breadth-first searches bounded by
+    ``max_size``, from every vertex (or edge) in parallel. Each ring is counted
+    only once, even if it is found from several vertices (or edges).
+
+    Examples
+    --------
+    >>> g = gt.lattice([8, 8], periodic=True)
+    >>> hist, vhist = gt.ring_statistics(g, max_size=8)
+    >>> print(hist)
+    [  0   0   0   0  64   0 128   0   0]
+    >>> hist, vhist = gt.ring_statistics(g, max_size=8, criterion="guttman")
+    >>> print(hist)
+    [ 0  0  0  0 64  0  0  0  0]
+
+    References
+    ----------
+    .. [king-ring] S. V. King, "Ring configurations in a random network model
+       of vitreous silica", Nature 213, 1112 (1967), :DOI:`10.1038/2131112a0`
+    .. [guttman-ring] L. Guttman, "Ring structure of the crystalline and
+       amorphous forms of silicon dioxide", J. Non-Cryst. Solids 116, 145
+       (1990), :DOI:`10.1016/0022-3093(90)90686-G`
+    """
+
+    if criterion not in ["king", "guttman"]:
+        raise ValueError("invalid ring criterion: " + str(criterion))
+    if vprop is None:
+        vprop = g.new_vertex_property("vector<int32_t>")
+    if vprop.value_type() != "vector<int32_t>":
+        raise ValueError("value type of `vprop` must be `vector<int32_t>`, not %s" %
+                         vprop.value_type())
+
+    u = GraphView(g, directed=False)
+    hist, ring_vertices, ring_sizes = libgraph_tool_topology.\
+        get_rings(u._Graph__graph, max_size, criterion, _prop("v", u, vprop),
+                  rings)
+    if rings:
+        ring_list = numpy.split(ring_vertices, numpy.cumsum(ring_sizes)[:-1])
+        return hist, vprop, ring_list
+    return hist, vprop
+
+
 def shortest_distance(g, source=None, target=None, weights=None,
                       negative_weights=False, max_dist=None, directed=None,
                       dense=False, dist_map=None, pred_map=False):
@@ -1170,14 +1551,19 @@ def shortest_distance(g, source=None, target=None, weights=None,
     search (BFS) or Dijkstra's algorithm [dijkstra]_, if weights are given. If
     ``negative_weights == True``, the Bellman-Ford algorithm is used
     [bellman_ford]_, which accepts negative weights, as long as there are no
-    negative loops. If source is not given, the distances are calculated with
-    Johnson's algorithm [johnson-apsp]_. If dense=True, the Floyd-Warshall
-    algorithm [floyd-warshall-apsp]_ is used instead.
+    negative loops. If source is not given, the searches are run from every
+    vertex in parallel, where the breadth-first searches advance 64 sources at
+    once, with one bit per source for each vertex. If some weights are
+    negative, Johnson's algorithm [johnson-apsp]_ is used instead. If
+    dense=True, the Floyd-Warshall algorithm [floyd-warshall-apsp]_ is
+    used. To obtain only the distribution of the distances, without storing
+    them, :func:`distance_statistics` should be used.
 
     If source is specified, the algorithm runs in :math:`O(V + E)` time, or
     :math:`O(V \log V)` if weights are given. If ``negative_weights == True``,
     the complexity is :math:`O(VE)`. If source is not specified, it runs in
-    :math:`O(VE\log V)` time, or :math:`O(V^3)` if dense == True.
+    :math:`O(V(V + E))` time, or :math:`O(VE\log V)` if weights are given, or
+    :math:`O(V^3)` if dense == True.
 
     Examples
     --------
@@ -1307,6 +1693,71 @@ def shortest_distance(g, source=None, target=None, weights=None,
     else:
         return dist_map
 
+def distance_statistics(g, weights=None, bins=[0, 1], directed=None):
+    r"""Obtain the histogram of the shortest distances between all pairs of
+    vertices, and the eccentricity, sum of distances and number of reachable
+    vertices of each vertex, without storing the distances.
+
+    Parameters
+    ----------
+    g : :class:`~graph_tool.Graph`
+        Graph to be used.
+    weights : :class:`~graph_tool.PropertyMap` (optional, default: ``None``)
+        The edge weights, which must be non-negative.
+    bins : list of bins (optional, default: ``[0, 1]``)
+        List of bins to be used for the histogram, as in
+        :func:`~graph_tool.stats.distance_histogram`.
+    directed : ``bool`` (optional, default:``None``)
+        Treat graph as directed or not, independently of its actual
+        directionality.
+
+    Returns
+    -------
+    counts : :class:`~numpy.ndarray`
+        The bin counts.
+    bins : :class:`~numpy.ndarray`
+        The bin edges.
+    ecc : :class:`~graph_tool.PropertyMap`
+        Vertex property map with the largest distance to the vertices reachable
+        from each vertex.
+    dist_sum : :class:`~graph_tool.PropertyMap`
+        Vertex property map with the sum of the distances to the vertices
+        reachable from each vertex.
+    reach : :class:`~graph_tool.PropertyMap`
+        Vertex property map with the number of vertices reachable from each
+        vertex, not including itself.
+
+    Notes
+    -----
+    The distances are found with a breadth-first search, or Dijkstra's
+    algorithm if weights are given, from every vertex in parallel, and are
+    accumulated as they are found. The breadth-first searches advance 64
+    sources at once, with one bit per source for each vertex. The algorithm
+    uses :math:`O(V)` memory per thread, and runs in :math:`O(V(V + E))` time,
+    or :math:`O(VE\log V)` if weights are given.
+
+    Examples
+    --------
+    >>> g = gt.lattice([4, 4])
+    >>> counts, bins, ecc, dist_sum, reach = gt.distance_statistics(g)
+    >>> print(counts)
+    [ 0 48 68 64 40 16  4]
+    >>> print(ecc.a)
+    [ 6.  5.  5.  6.  5.  4.  4.  5.  5.  4.  4.  5.  6.  5.  5.  6.]
+    """
+
+    if directed is not None:
+        g = GraphView(g, directed=directed)
+
+    ecc = g.new_vertex_property("double")
+    dist_sum = g.new_vertex_property("double")
+    reach = g.new_vertex_property("int64_t")
+    counts, bins = libgraph_tool_topology.\
+        distance_stats(g._Graph__graph, _prop("e", g, weights),
+                       [float(x) for x in bins], _prop("v", g, ecc),
+                       _prop("v", g, dist_sum), _prop("v", g, reach))
+    return counts, bins, ecc, dist_sum, reach
+
 def shortest_path(g, source, target, weights=None, negative_weights=False,
                   pred_map=None):
     """Return the shortest path from `source` to `target`.